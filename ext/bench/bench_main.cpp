@@ -0,0 +1,120 @@
+#include "pch.h"
+#include "micro_benchmarks.h"
+#include "pipe_load.h"
+#include "trace_replay.h"
+#include <cstdio>
+#include <cstdlib>
+
+// The extension sources log through Logger, whose WinDbg output goes through
+// the extension APIs; a standalone process has none
+WINDBG_EXTENSION_APIS64 ExtensionApis = {};
+
+namespace {
+    void print_usage() {
+        std::printf(
+            "Usage:\n"
+            "  VibeDbgBench micro [--filter <text>] [--min-time <ms>]\n"
+            "      Serialization, parsing, output capture and routing benchmarks.\n"
+            "  VibeDbgBench load [--pipe <name>] [--connections <n>] [--duration <s>]\n"
+            "                    [--report-interval <s>] [--command <cmd>]... [--protocol 1|2]\n"
+            "                    [--timeout <ms>] [--stream]\n"
+            "      Closed-loop load against a running extension (!vibedbg_connect first).\n"
+            "  VibeDbgBench replay <trace> [--pipe <name>] [--max-speed]\n"
+            "      Replays a trace recorded with VIBEDBG_TRACE_FILE and compares latencies.\n");
+    }
+
+    bool parse_number(const char* text, long long* value) {
+        char* end = nullptr;
+        *value = std::strtoll(text, &end, 10);
+        return end != text && *end == '\0' && *value >= 0;
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        print_usage();
+        return 1;
+    }
+
+    std::string mode = argv[1];
+    vibedbg::bench::MicroOptions micro;
+    vibedbg::bench::LoadOptions load;
+    vibedbg::bench::ReplayOptions replay;
+    bool commands_given = false;
+
+    int first_option = 2;
+    if (mode == "replay") {
+        if (argc < 3) {
+            print_usage();
+            return 1;
+        }
+        replay.trace_path = argv[2];
+        first_option = 3;
+    }
+
+    for (int i = first_option; i < argc; ++i) {
+        std::string option = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        long long number = 0;
+        auto numeric = [&](long long* out) {
+            if (!value || !parse_number(value, out)) {
+                std::fprintf(stderr, "%s needs a non-negative number\n", option.c_str());
+                return false;
+            }
+            ++i;
+            return true;
+        };
+
+        if (option == "--stream") {
+            load.stream = true;
+        } else if (option == "--max-speed") {
+            replay.max_speed = true;
+        } else if (option == "--filter" && value) {
+            micro.filter = argv[++i];
+        } else if (option == "--pipe" && value) {
+            load.pipe_name = replay.pipe_name = argv[++i];
+        } else if (option == "--command" && value) {
+            if (!commands_given) {
+                load.commands.clear();
+                commands_given = true;
+            }
+            load.commands.emplace_back(argv[++i]);
+        } else if (option == "--min-time") {
+            if (!numeric(&number)) return 1;
+            micro.min_time = std::chrono::milliseconds(number);
+        } else if (option == "--connections") {
+            if (!numeric(&number) || number == 0) return 1;
+            load.connections = static_cast<size_t>(number);
+        } else if (option == "--duration") {
+            if (!numeric(&number)) return 1;
+            load.duration = std::chrono::seconds(number);
+        } else if (option == "--report-interval") {
+            if (!numeric(&number)) return 1;
+            load.report_interval = std::chrono::seconds(number);
+        } else if (option == "--protocol") {
+            if (!numeric(&number) || (number != 1 && number != 2)) return 1;
+            load.protocol_version = static_cast<uint32_t>(number);
+        } else if (option == "--timeout") {
+            if (!numeric(&number)) return 1;
+            load.timeout = std::chrono::milliseconds(number);
+        } else {
+            std::fprintf(stderr, "Unknown option: %s\n", option.c_str());
+            print_usage();
+            return 1;
+        }
+    }
+
+    int exit_code = 1;
+    if (mode == "micro") {
+        exit_code = vibedbg::bench::run_micro_benchmarks(micro);
+    } else if (mode == "load") {
+        exit_code = vibedbg::bench::run_pipe_load(load);
+    } else if (mode == "replay") {
+        exit_code = vibedbg::bench::run_trace_replay(replay);
+    } else {
+        print_usage();
+    }
+
+    vibedbg::logging::Logger::Cleanup();
+    return exit_code;
+}
@@ -0,0 +1,235 @@
+#include "pch.h"
+#include "micro_benchmarks.h"
+#include "../inc/message_protocol.h"
+#include "../inc/command_table.h"
+#include "../src/utils/output_capture.h"
+#include "../src/utils/metrics.h"
+#include <cstdio>
+
+using namespace vibedbg::communication;
+using namespace vibedbg::utils;
+
+namespace {
+    constexpr size_t PAYLOAD_SIZES[] = {1024, 64 * 1024, 1024 * 1024, 8 * 1024 * 1024};
+
+    struct Result {
+        std::string name;
+        uint64_t operations{0};
+        uint64_t bytes{0};
+        std::chrono::nanoseconds elapsed{0};
+        HdrHistogram::Summary latency;      // Per sample
+    };
+
+    std::string size_label(size_t bytes) {
+        return bytes >= 1024 * 1024 ? std::to_string(bytes / (1024 * 1024)) + "MB"
+                                    : std::to_string(bytes / 1024) + "KB";
+    }
+
+    // Debugger-like text: addresses, symbols and hex dumps, with the quotes
+    // and backslashes that JSON has to escape
+    std::string make_output(size_t size) {
+        static constexpr std::string_view LINES[] = {
+            "00000000`0014f8a8 00007ff8`1a2b3c4d ntdll!RtlUserThreadStart+0x21\n",
+            "rax=0000000000000000 rbx=00000000000001ff rcx=00007ff81a2b3c4d\n",
+            "0:000> dx -r1 @$curprocess.Name : \"notepad.exe\"\n",
+            "Image path: C:\\Windows\\System32\\notepad.exe\n",
+        };
+        std::string output;
+        output.reserve(size);
+        for (size_t i = 0; output.size() < size; ++i) {
+            output += LINES[i % std::size(LINES)];
+        }
+        output.resize(size);
+        return output;
+    }
+
+    /**
+     * @brief Calls the body until min_time has passed, timing each call.
+     *
+     * @param[in] name Benchmark name
+     * @param[in] bytes Bytes processed per call, for throughput
+     * @param[in] operations Operations per call, for benchmarks that batch
+     * @param[in] min_time Minimum measuring time
+     * @param[in] body Work of one call
+     */
+    template <typename Body>
+    Result measure(std::string name, uint64_t bytes, uint64_t operations, std::chrono::milliseconds min_time, Body&& body) {
+        // One untimed call warms caches and grows any reused buffers
+        body();
+
+        HdrHistogram samples;
+        Result result;
+        result.name = std::move(name);
+        auto start = std::chrono::steady_clock::now();
+        auto now = start;
+        do {
+            auto sample_start = std::chrono::steady_clock::now();
+            body();
+            now = std::chrono::steady_clock::now();
+            samples.record(std::chrono::duration_cast<std::chrono::microseconds>(now - sample_start));
+            result.operations += operations;
+            result.bytes += bytes;
+        } while (now - start < min_time);
+
+        result.elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(now - start);
+        result.latency = samples.summarize();
+        return result;
+    }
+
+    void print_header() {
+        std::printf("%-40s %12s %12s %10s %10s %12s\n", "benchmark", "ops", "ns/op", "p50 us", "p99 us", "throughput");
+    }
+
+    void print_result(const Result& result) {
+        double seconds = std::chrono::duration<double>(result.elapsed).count();
+        double ns_per_op = result.operations > 0 ? seconds * 1e9 / static_cast<double>(result.operations) : 0;
+        char throughput[32];
+        if (result.bytes > 0) {
+            std::snprintf(throughput, sizeof(throughput), "%.1f MB/s", static_cast<double>(result.bytes) / seconds / (1024 * 1024));
+        } else {
+            std::snprintf(throughput, sizeof(throughput), "%.2f Mop/s", static_cast<double>(result.operations) / seconds / 1e6);
+        }
+        std::printf("%-40s %12llu %12.0f %10llu %10llu %12s\n", result.name.c_str(),
+                    static_cast<unsigned long long>(result.operations), ns_per_op,
+                    static_cast<unsigned long long>(result.latency.p50_us),
+                    static_cast<unsigned long long>(result.latency.p99_us), throughput);
+    }
+
+    class Runner {
+    public:
+        explicit Runner(const vibedbg::bench::MicroOptions& options) : options_(options) {}
+
+        bool selected(std::string_view name) const {
+            return options_.filter.empty() || name.find(options_.filter) != std::string_view::npos;
+        }
+
+        template <typename Body>
+        void run(std::string name, uint64_t bytes, uint64_t operations, Body&& body) {
+            if (selected(name)) {
+                print_result(measure(std::move(name), bytes, operations, options_.min_time, std::forward<Body>(body)));
+                ++ran_;
+            }
+        }
+
+        size_t ran() const noexcept { return ran_; }
+
+    private:
+        const vibedbg::bench::MicroOptions& options_;
+        size_t ran_{0};
+    };
+
+    void bench_serialize_response(Runner& runner) {
+        for (uint32_t version : {MessageProtocol::PROTOCOL_VERSION_V1, MessageProtocol::PROTOCOL_VERSION_V2}) {
+            for (size_t size : PAYLOAD_SIZES) {
+                std::string name = "serialize_response/v" + std::to_string(version) + "/" + size_label(size);
+                if (!runner.selected(name)) {
+                    continue;
+                }
+                CommandResponse response;
+                response.request_id = MessageProtocol::generate_request_id();
+                response.success = true;
+                response.output = make_output(size);
+                response.timestamp = std::chrono::steady_clock::now();
+                WireFormat format{version, PayloadEncoding::Json};
+                runner.run(name, size, 1, [&] {
+                    auto frame = MessageProtocol::serialize_response(response, format);
+                    if (frame.empty()) {
+                        std::abort();
+                    }
+                });
+            }
+        }
+    }
+
+    void bench_parse_command(Runner& runner) {
+        for (uint32_t version : {MessageProtocol::PROTOCOL_VERSION_V1, MessageProtocol::PROTOCOL_VERSION_V2}) {
+            for (size_t size : PAYLOAD_SIZES) {
+                std::string name = "parse_command/v" + std::to_string(version) + "/" + size_label(size);
+                if (!runner.selected(name)) {
+                    continue;
+                }
+                // Large requests carry their bulk in the parameters
+                CommandRequest request;
+                request.request_id = MessageProtocol::generate_request_id();
+                request.command = "execute_batch";
+                request.parameters = {{"commands", json::array({"r", "k"})}, {"data", make_output(size)}};
+                request.timestamp = std::chrono::steady_clock::now();
+                auto frame = MessageProtocol::serialize_command(request, WireFormat{version, PayloadEncoding::Json});
+                runner.run(name, frame.size(), 1, [&] {
+                    ErrorCode error = ErrorCode::None;
+                    auto parsed = MessageProtocol::parse_command(frame, &error);
+                    if (error != ErrorCode::None || parsed.command.empty()) {
+                        std::abort();
+                    }
+                });
+            }
+        }
+    }
+
+    // Each call captures about 256 KB, the capture buffer size kept between
+    // commands, so every call after the first reuses the buffer
+    void bench_output_capture(Runner& runner) {
+        constexpr size_t CAPTURED_BYTES = 256 * 1024;
+        for (size_t line_length : {40, 200, 4096}) {
+            std::string line(line_length - 1, 'x');
+            line += '\n';
+            size_t lines = CAPTURED_BYTES / line_length;
+
+            OutputCapture capture;
+            runner.run("output_capture/append/" + std::to_string(line_length) + "B", lines * line_length, lines, [&] {
+                capture.Reset({});
+                for (size_t i = 0; i < lines; ++i) {
+                    capture.Output(DEBUG_OUTPUT_NORMAL, line.c_str());
+                }
+            });
+
+            OutputCapture streaming;
+            size_t streamed = 0;
+            runner.run("output_capture/stream/" + std::to_string(line_length) + "B", lines * line_length, lines, [&] {
+                streaming.Reset([&streamed](std::string_view chunk) {
+                    streamed += chunk.size();
+                    return true;
+                });
+                for (size_t i = 0; i < lines; ++i) {
+                    streaming.Output(DEBUG_OUTPUT_NORMAL, line.c_str());
+                }
+            });
+        }
+    }
+
+    // Routing a command to its handler is a table lookup on its first token
+    // followed by an indexed call; the lookup is what varies with the input
+    void bench_route_lookup(Runner& runner) {
+        static constexpr std::string_view COMMANDS[] = {
+            "k", "lm", "r", "!analyze -v", "bp kernel32!CreateFileW", "dx @$curprocess",
+            "~*k", "DQ rsp L10", ".frame 2", "not_a_command 1 2 3",
+        };
+        constexpr uint64_t LOOKUPS = 1000;
+        size_t found = 0;
+        runner.run("route/lookup", 0, LOOKUPS, [&] {
+            for (uint64_t i = 0; i < LOOKUPS; ++i) {
+                std::string_view params;
+                const auto* info = vibedbg::core::find_command(vibedbg::core::command_token(COMMANDS[i % std::size(COMMANDS)], &params));
+                found += (info && info->route != vibedbg::core::CommandRoute::None) ? 1 : 0;
+            }
+        });
+        if (found == 0 && runner.selected("route/lookup")) {
+            std::abort();
+        }
+    }
+}
+
+int vibedbg::bench::run_micro_benchmarks(const MicroOptions& options) {
+    Runner runner(options);
+    print_header();
+    bench_serialize_response(runner);
+    bench_parse_command(runner);
+    bench_output_capture(runner);
+    bench_route_lookup(runner);
+
+    if (runner.ran() == 0) {
+        std::fprintf(stderr, "No benchmark matches '%s'\n", options.filter.c_str());
+        return 1;
+    }
+    return 0;
+}
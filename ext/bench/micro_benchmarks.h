@@ -0,0 +1,22 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+
+namespace vibedbg::bench {
+
+struct MicroOptions {
+    std::string filter;                             // Only benchmarks whose name contains this
+    std::chrono::milliseconds min_time{500};        // Minimum measuring time per benchmark
+};
+
+/**
+ * @brief Runs the serialization, parsing, capture and routing benchmarks.
+ *
+ * @param[in] options Filter and measuring time
+ *
+ * @return Process exit code
+ */
+int run_micro_benchmarks(const MicroOptions& options);
+
+} // namespace vibedbg::bench
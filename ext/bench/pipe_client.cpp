@@ -0,0 +1,59 @@
+#include "pch.h"
+#include "pipe_client.h"
+
+using namespace vibedbg::communication;
+using vibedbg::utils::HandleWrapper;
+
+HandleWrapper vibedbg::bench::connect_pipe(const std::string& pipe_name, std::chrono::steady_clock::time_point deadline) {
+    while (std::chrono::steady_clock::now() < deadline) {
+        HANDLE pipe = CreateFileA(pipe_name.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, 0, nullptr);
+        if (pipe != INVALID_HANDLE_VALUE) {
+            return HandleWrapper(pipe);
+        }
+        if (GetLastError() != ERROR_PIPE_BUSY || !WaitNamedPipeA(pipe_name.c_str(), 1000)) {
+            Sleep(100);
+        }
+    }
+    return HandleWrapper();
+}
+
+bool vibedbg::bench::write_all(HANDLE pipe, std::span<const std::byte> data) {
+    while (!data.empty()) {
+        DWORD written = 0;
+        if (!WriteFile(pipe, data.data(), static_cast<DWORD>((std::min<size_t>)(data.size(), MAXDWORD)), &written, nullptr) ||
+            written == 0) {
+            return false;
+        }
+        data = data.subspan(written);
+    }
+    return true;
+}
+
+std::optional<CommandResponse> vibedbg::bench::read_response(HANDLE pipe, MessageFramer& framer,
+                                                             const std::string& request_id, uint64_t* bytes_received) {
+    for (;;) {
+        ErrorCode error = ErrorCode::None;
+        while (auto frame = framer.next_frame(&error)) {
+            CommandResponse response = MessageProtocol::parse_response(*frame, &error);
+            if (error != ErrorCode::None) {
+                return std::nullopt;
+            }
+            if (response.final && response.request_id == request_id) {
+                return response;
+            }
+        }
+        if (error != ErrorCode::None) {
+            return std::nullopt;
+        }
+
+        auto destination = framer.prepare(READ_CHUNK_SIZE);
+        DWORD bytes_read = 0;
+        BOOL success = ReadFile(pipe, destination.data(), static_cast<DWORD>((std::min<size_t>)(destination.size(), MAXDWORD)),
+                                &bytes_read, nullptr);
+        if ((!success && GetLastError() != ERROR_MORE_DATA) || bytes_read == 0) {
+            return std::nullopt;
+        }
+        framer.commit(bytes_read);
+        if (bytes_received) *bytes_received += bytes_read;
+    }
+}
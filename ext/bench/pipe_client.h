@@ -0,0 +1,44 @@
+#pragma once
+
+#include <Windows.h>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include "../inc/handle_wrapper.h"
+#include "../inc/message_framer.h"
+#include "../inc/message_protocol.h"
+
+namespace vibedbg::bench {
+
+// Largest response frame the bench clients accept
+constexpr size_t MAX_RESPONSE_FRAME = 16 * 1024 * 1024;
+constexpr size_t READ_CHUNK_SIZE = 64 * 1024;
+
+/**
+ * @brief Opens a client end of the pipe, waiting while all instances are busy.
+ *
+ * @return The pipe, or an invalid handle if the deadline passed first
+ */
+utils::HandleWrapper connect_pipe(const std::string& pipe_name, std::chrono::steady_clock::time_point deadline);
+
+bool write_all(HANDLE pipe, std::span<const std::byte> data);
+
+/**
+ * @brief Reads frames until the final response to request_id arrives.
+ *
+ * Chunk frames of streamed responses and responses to other requests are
+ * skipped.
+ *
+ * @param[in] pipe Connected pipe
+ * @param[in,out] framer Bytes received on the pipe so far
+ * @param[in] request_id Request whose response is awaited
+ * @param[in,out] bytes_received Incremented by every byte read
+ *
+ * @return The final response, or std::nullopt on a transport or parse error
+ */
+std::optional<communication::CommandResponse> read_response(HANDLE pipe, communication::MessageFramer& framer,
+                                                            const std::string& request_id, uint64_t* bytes_received);
+
+} // namespace vibedbg::bench
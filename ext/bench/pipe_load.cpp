@@ -0,0 +1,170 @@
+#include "pch.h"
+#include "pipe_load.h"
+#include "pipe_client.h"
+#include "../src/utils/metrics.h"
+#include <psapi.h>
+#include <cstdio>
+
+using namespace vibedbg::bench;
+using namespace vibedbg::communication;
+using namespace vibedbg::utils;
+
+namespace {
+    struct MemoryUsage {
+        uint64_t working_set{0};
+        uint64_t private_bytes{0};
+    };
+
+    std::optional<MemoryUsage> process_memory(HANDLE process) {
+        PROCESS_MEMORY_COUNTERS_EX counters{};
+        counters.cb = sizeof(counters);
+        if (!process || !GetProcessMemoryInfo(process, reinterpret_cast<PROCESS_MEMORY_COUNTERS*>(&counters), sizeof(counters))) {
+            return std::nullopt;
+        }
+        return MemoryUsage{counters.WorkingSetSize, counters.PrivateUsage};
+    }
+
+    // Latencies of the whole run plus those since the last report
+    struct LoadStats {
+        HdrHistogram total;
+        HdrHistogram interval;
+        std::atomic<uint64_t> failed_commands{0};   // Answered with success == false
+        std::atomic<uint64_t> transport_errors{0};  // Connect, write, read or parse failures
+        std::atomic<uint64_t> bytes_received{0};
+    };
+
+    void run_connection(const vibedbg::bench::LoadOptions& options, size_t connection_index,
+                        std::chrono::steady_clock::time_point deadline, LoadStats& stats) {
+        WireFormat format{options.protocol_version, PayloadEncoding::Json};
+        size_t next_command = connection_index;
+
+        while (std::chrono::steady_clock::now() < deadline) {
+            HandleWrapper pipe = connect_pipe(options.pipe_name, deadline);
+            if (!pipe) {
+                stats.transport_errors.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            MessageFramer framer(READ_CHUNK_SIZE, MAX_RESPONSE_FRAME);
+
+            while (std::chrono::steady_clock::now() < deadline) {
+                CommandRequest request;
+                request.request_id = MessageProtocol::generate_request_id();
+                request.command = options.commands[next_command++ % options.commands.size()];
+                request.timeout = options.timeout;
+                request.stream = options.stream;
+                request.timestamp = std::chrono::steady_clock::now();
+
+                auto start = std::chrono::steady_clock::now();
+                auto frame = MessageProtocol::serialize_command(request, format);
+                std::optional<CommandResponse> response;
+                uint64_t bytes_received = 0;
+                if (write_all(pipe.get(), frame)) {
+                    response = read_response(pipe.get(), framer, request.request_id, &bytes_received);
+                }
+                stats.bytes_received.fetch_add(bytes_received, std::memory_order_relaxed);
+                if (!response) {
+                    // The stream cannot be trusted after a failure; reconnect
+                    stats.transport_errors.fetch_add(1, std::memory_order_relaxed);
+                    break;
+                }
+
+                auto latency = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+                stats.total.record(latency);
+                stats.interval.record(latency);
+                if (!response->success) {
+                    stats.failed_commands.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        }
+    }
+
+    void print_line(const char* label, const HdrHistogram::Summary& summary, double seconds,
+                    const LoadStats& stats, const std::optional<MemoryUsage>& server_memory) {
+        std::printf("%-8s requests=%-8llu rps=%-9.1f p50=%-7llu p90=%-7llu p99=%-7llu max=%-8llu us  failed=%llu errors=%llu",
+                    label,
+                    static_cast<unsigned long long>(summary.count),
+                    seconds > 0 ? static_cast<double>(summary.count) / seconds : 0.0,
+                    static_cast<unsigned long long>(summary.p50_us),
+                    static_cast<unsigned long long>(summary.p90_us),
+                    static_cast<unsigned long long>(summary.p99_us),
+                    static_cast<unsigned long long>(summary.max_us),
+                    static_cast<unsigned long long>(stats.failed_commands.load()),
+                    static_cast<unsigned long long>(stats.transport_errors.load()));
+        if (server_memory) {
+            std::printf("  server ws=%.1fMB private=%.1fMB",
+                        static_cast<double>(server_memory->working_set) / (1024 * 1024),
+                        static_cast<double>(server_memory->private_bytes) / (1024 * 1024));
+        }
+        std::printf("\n");
+        std::fflush(stdout);
+    }
+
+    /**
+     * @brief Opens the process serving the pipe, so its memory can be sampled.
+     */
+    HandleWrapper open_server_process(const std::string& pipe_name) {
+        HandleWrapper probe = connect_pipe(pipe_name, std::chrono::steady_clock::now() + std::chrono::seconds(5));
+        ULONG server_pid = 0;
+        if (!probe || !GetNamedPipeServerProcessId(probe.get(), &server_pid)) {
+            return HandleWrapper();
+        }
+        return HandleWrapper(OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, server_pid));
+    }
+}
+
+int vibedbg::bench::run_pipe_load(const LoadOptions& options) {
+    HandleWrapper server = open_server_process(options.pipe_name);
+    if (!server) {
+        std::fprintf(stderr, "Could not reach the extension on %s; run !vibedbg_connect first\n",
+                     options.pipe_name.c_str());
+        return 1;
+    }
+    auto memory_before = process_memory(server.get());
+
+    std::printf("Driving %s with %zu connections for %llds (protocol v%u, %zu commands)\n",
+                options.pipe_name.c_str(), options.connections, static_cast<long long>(options.duration.count()),
+                options.protocol_version, options.commands.size());
+
+    LoadStats stats;
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + options.duration;
+
+    std::vector<std::thread> connections;
+    connections.reserve(options.connections);
+    for (size_t i = 0; i < options.connections; ++i) {
+        connections.emplace_back(run_connection, std::cref(options), i, deadline, std::ref(stats));
+    }
+
+    // Interval reports sample the server's memory, so a leak under sustained
+    // load shows as a climbing working set
+    if (options.report_interval.count() > 0) {
+        auto next_report = start + options.report_interval;
+        while (next_report <= deadline) {
+            std::this_thread::sleep_until(next_report);
+            auto interval = stats.interval.summarize();
+            stats.interval.reset();
+            char label[16];
+            std::snprintf(label, sizeof(label), "[%llds]",
+                          static_cast<long long>(std::chrono::duration_cast<std::chrono::seconds>(next_report - start).count()));
+            print_line(label, interval, static_cast<double>(options.report_interval.count()), stats, process_memory(server.get()));
+            next_report += options.report_interval;
+        }
+    }
+
+    for (auto& connection : connections) {
+        connection.join();
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    auto total = stats.total.summarize();
+    auto memory_after = process_memory(server.get());
+    print_line("total", total, seconds, stats, memory_after);
+    std::printf("received %.1f MB", static_cast<double>(stats.bytes_received.load()) / (1024 * 1024));
+    if (memory_before && memory_after) {
+        std::printf(", server private bytes %+.1f MB over the run",
+                    (static_cast<double>(memory_after->private_bytes) - static_cast<double>(memory_before->private_bytes)) / (1024 * 1024));
+    }
+    std::printf("\n");
+
+    return total.count > stats.failed_commands.load() ? 0 : 1;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace vibedbg::bench {
+
+struct LoadOptions {
+    std::string pipe_name = R"(\\.\pipe\vibedbg_debug)";
+    size_t connections = 4;
+    std::chrono::seconds duration{10};
+    std::chrono::seconds report_interval{0};        // 0 for a single summary at the end
+    std::vector<std::string> commands{"r"};         // Sent round-robin by every connection
+    uint32_t protocol_version = 2;
+    std::chrono::milliseconds timeout{30000};       // Request timeout sent to the extension
+    bool stream = false;                            // Ask for streamed responses
+};
+
+/**
+ * @brief Drives the extension's pipe with concurrent closed-loop clients.
+ *
+ * Every connection sends a request, waits for its final response frame and
+ * sends the next one until the duration has passed. Latency is measured from
+ * the write of the request to the read of its final frame.
+ *
+ * @param[in] options Pipe, concurrency, duration and request mix
+ *
+ * @return Process exit code; nonzero if no request succeeded
+ */
+int run_pipe_load(const LoadOptions& options);
+
+} // namespace vibedbg::bench
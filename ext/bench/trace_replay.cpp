@@ -0,0 +1,191 @@
+#include "pch.h"
+#include "trace_replay.h"
+#include "pipe_client.h"
+#include "../inc/command_table.h"
+#include "../inc/trace_recorder.h"
+#include "../src/utils/metrics.h"
+#include <cstdio>
+#include <unordered_map>
+
+using namespace vibedbg::bench;
+using namespace vibedbg::communication;
+using namespace vibedbg::utils;
+
+namespace {
+    struct ReplayRequest {
+        TraceEntry entry;
+        std::string request_id;
+        std::string command;                        // Command name, for the per-command table
+    };
+
+    struct CommandStats {
+        HdrHistogram recorded;
+        HdrHistogram replayed;
+    };
+
+    struct ReplayStats {
+        HdrHistogram recorded;
+        HdrHistogram replayed;
+        std::unordered_map<std::string, std::unique_ptr<CommandStats>> commands;
+        std::atomic<uint64_t> answered{0};
+        std::atomic<uint64_t> outcome_changed{0};   // Succeeded in one run and failed in the other
+        std::atomic<uint64_t> transport_errors{0};
+        std::atomic<uint64_t> recorded_bytes{0};
+        std::atomic<uint64_t> replayed_bytes{0};
+        std::atomic<int64_t> max_lag_us{0};         // Furthest a send fell behind the recorded schedule
+    };
+
+    /**
+     * @brief Sends one recorded connection's requests in order.
+     *
+     * @param[in] start Replay start, corresponding to the trace's first request
+     * @param[in] first_received_us Recorded offset of the trace's first request
+     */
+    void run_connection(const std::vector<const ReplayRequest*>& requests, const ReplayOptions& options,
+                        std::chrono::steady_clock::time_point start, uint64_t first_received_us, ReplayStats& stats) {
+        HandleWrapper pipe;
+        MessageFramer framer(READ_CHUNK_SIZE, MAX_RESPONSE_FRAME);
+
+        for (size_t i = 0; i < requests.size(); ++i) {
+            const ReplayRequest* request = requests[i];
+            const TraceRecordHeader& recorded = request->entry.header;
+            if (!options.max_speed) {
+                auto scheduled = start + std::chrono::microseconds(recorded.received_us - first_received_us);
+                std::this_thread::sleep_until(scheduled);
+                auto lag = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - scheduled).count();
+                int64_t max_lag = stats.max_lag_us.load(std::memory_order_relaxed);
+                while (lag > max_lag && !stats.max_lag_us.compare_exchange_weak(max_lag, lag, std::memory_order_relaxed)) {
+                }
+            }
+
+            if (!pipe) {
+                pipe = connect_pipe(options.pipe_name, std::chrono::steady_clock::now() + std::chrono::seconds(10));
+                framer.reset();
+                if (!pipe) {
+                    // The extension is gone; the rest of this connection cannot be replayed
+                    stats.transport_errors.fetch_add(requests.size() - i, std::memory_order_relaxed);
+                    return;
+                }
+            }
+
+            auto sent_at = std::chrono::steady_clock::now();
+            uint64_t bytes_received = 0;
+            std::optional<CommandResponse> response;
+            if (write_all(pipe.get(), request->entry.request)) {
+                response = read_response(pipe.get(), framer, request->request_id, &bytes_received);
+            }
+            if (!response) {
+                stats.transport_errors.fetch_add(1, std::memory_order_relaxed);
+                pipe.reset();
+                continue;
+            }
+
+            auto replayed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - sent_at);
+            auto original = std::chrono::microseconds(recorded.duration_us);
+            stats.recorded.record(original);
+            stats.replayed.record(replayed);
+            CommandStats& command = *stats.commands.at(request->command);
+            command.recorded.record(original);
+            command.replayed.record(replayed);
+
+            stats.answered.fetch_add(1, std::memory_order_relaxed);
+            stats.recorded_bytes.fetch_add(recorded.response_bytes, std::memory_order_relaxed);
+            stats.replayed_bytes.fetch_add(bytes_received, std::memory_order_relaxed);
+            if (response->success != (recorded.success != 0)) {
+                stats.outcome_changed.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void print_comparison(const std::string& label, const HdrHistogram::Summary& recorded, const HdrHistogram::Summary& replayed) {
+        auto change = [](uint64_t before, uint64_t after) {
+            return before > 0 ? (static_cast<double>(after) - static_cast<double>(before)) * 100.0 / static_cast<double>(before) : 0.0;
+        };
+        std::printf("%-24s %8llu  p50 %7llu -> %-7llu (%+6.1f%%)  p99 %8llu -> %-8llu (%+6.1f%%)\n",
+                    label.c_str(), static_cast<unsigned long long>(replayed.count),
+                    static_cast<unsigned long long>(recorded.p50_us), static_cast<unsigned long long>(replayed.p50_us),
+                    change(recorded.p50_us, replayed.p50_us),
+                    static_cast<unsigned long long>(recorded.p99_us), static_cast<unsigned long long>(replayed.p99_us),
+                    change(recorded.p99_us, replayed.p99_us));
+    }
+}
+
+int vibedbg::bench::run_trace_replay(const ReplayOptions& options) {
+    TraceReader reader;
+    std::string error;
+    if (!reader.open(options.trace_path, &error)) {
+        std::fprintf(stderr, "Cannot replay %s: %s\n", options.trace_path.c_str(), error.c_str());
+        return 1;
+    }
+
+    // The frames are sent as recorded; parsing them through the protocol
+    // gives the request id to wait for and the command to report under
+    std::vector<ReplayRequest> requests;
+    ReplayStats stats;
+    size_t unparsable = 0;
+    while (auto entry = reader.next()) {
+        ErrorCode parse_error = ErrorCode::None;
+        CommandRequest request = MessageProtocol::parse_command(entry->request, &parse_error);
+        if (parse_error != ErrorCode::None) {
+            ++unparsable;
+            continue;
+        }
+        std::string command(vibedbg::core::command_token(request.command));
+        if (!stats.commands.contains(command)) {
+            stats.commands.emplace(command, std::make_unique<CommandStats>());
+        }
+        requests.push_back(ReplayRequest{*entry, request.request_id, std::move(command)});
+    }
+    if (requests.empty()) {
+        std::fprintf(stderr, "%s holds no replayable commands\n", options.trace_path.c_str());
+        return 1;
+    }
+
+    // Requests keep their recorded connection, and so their recorded order
+    // and concurrency
+    std::unordered_map<uint32_t, std::vector<const ReplayRequest*>> connections;
+    uint64_t first_received_us = UINT64_MAX;
+    for (const ReplayRequest& request : requests) {
+        connections[request.entry.header.connection].push_back(&request);
+        first_received_us = (std::min)(first_received_us, request.entry.header.received_us);
+    }
+
+    std::printf("Replaying %zu commands on %zu connections from %s at %s speed\n", requests.size(), connections.size(),
+                options.trace_path.c_str(), options.max_speed ? "maximum" : "original");
+    if (unparsable > 0) {
+        std::printf("Skipped %zu records that did not parse as commands\n", unparsable);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    threads.reserve(connections.size());
+    for (const auto& [connection, connection_requests] : connections) {
+        threads.emplace_back(run_connection, std::cref(connection_requests), std::cref(options), start, first_received_us, std::ref(stats));
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::printf("\nLatency in us, recorded -> replayed\n");
+    print_comparison("all", stats.recorded.summarize(), stats.replayed.summarize());
+    for (const auto& [command, command_stats] : stats.commands) {
+        auto replayed = command_stats->replayed.summarize();
+        if (replayed.count > 0) {
+            print_comparison("  " + command, command_stats->recorded.summarize(), replayed);
+        }
+    }
+
+    std::printf("\nanswered=%llu errors=%llu outcome_changed=%llu in %.1fs",
+                static_cast<unsigned long long>(stats.answered.load()),
+                static_cast<unsigned long long>(stats.transport_errors.load()),
+                static_cast<unsigned long long>(stats.outcome_changed.load()), seconds);
+    if (!options.max_speed) {
+        std::printf(", max lag behind schedule %.1fms", static_cast<double>(stats.max_lag_us.load()) / 1000.0);
+    }
+    std::printf("\nresponse bytes recorded %.1f MB, replayed %.1f MB\n",
+                static_cast<double>(stats.recorded_bytes.load()) / (1024 * 1024),
+                static_cast<double>(stats.replayed_bytes.load()) / (1024 * 1024));
+
+    return stats.answered.load() > 0 ? 0 : 1;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+
+namespace vibedbg::bench {
+
+struct ReplayOptions {
+    std::string trace_path;
+    std::string pipe_name = R"(\\.\pipe\vibedbg_debug)";
+    bool max_speed = false;                         // Send back to back instead of on the recorded schedule
+};
+
+/**
+ * @brief Replays a command trace recorded by the extension (VIBEDBG_TRACE_FILE).
+ *
+ * Each recorded connection gets its own pipe connection, so the recorded
+ * concurrency is kept. Requests are sent as the recorded frames; at original
+ * speed each is sent at its recorded offset from the start of the trace, or
+ * as soon as the previous request on its connection has been answered if the
+ * replay has fallen behind. Recorded and replayed latencies are printed side
+ * by side, overall and per command.
+ *
+ * @param[in] options Trace file, pipe and pacing
+ *
+ * @return Process exit code; nonzero if the trace could not be read or
+ *         no request was answered
+ */
+int run_trace_replay(const ReplayOptions& options);
+
+} // namespace vibedbg::bench
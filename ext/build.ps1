@@ -6,7 +6,8 @@ param(
     [ValidateSet("x64")]
     [string]$Platform = "x64",
     [switch]$Clean,
-    [switch]$Test
+    [switch]$Test,
+    [switch]$Bench
 )
 
 Set-StrictMode -Version Latest
@@ -17,6 +18,7 @@ $ScriptDir = Split-Path -Parent $MyInvocation.MyCommand.Path
 $RootDir = Split-Path -Parent $ScriptDir
 $SolutionFile = Join-Path $ScriptDir "VibeDbg.sln"
 $ProjectFile = Join-Path $ScriptDir "VibeDbg.vcxproj"
+$BenchProjectFile = Join-Path $ScriptDir "bench\VibeDbgBench.vcxproj"
 $BinDir = Join-Path $ScriptDir "bin\$Platform\$Configuration"
 $ObjDir = Join-Path $ScriptDir "obj\$Platform\$Configuration"
 
@@ -109,6 +111,35 @@ function Build-Extension {
     Write-ColorOutput "Output: $BinDir" "Cyan"
 }
 
+function Build-Bench {
+    Write-ColorOutput "Building VibeDbgBench ($Configuration|$Platform)..." "Cyan"
+
+    # The bench compiles some extension sources itself, so it keeps its own
+    # intermediate directory instead of sharing the solution's
+    $buildArgs = @(
+        $BenchProjectFile,
+        "/p:Configuration=$Configuration",
+        "/p:Platform=$Platform",
+        "/m",
+        "/v:minimal",
+        "/nologo"
+    )
+
+    if ($Clean) {
+        $buildArgs += "/t:Clean"
+    }
+
+    & $MSBuildPath @buildArgs
+
+    if ($LASTEXITCODE -ne 0) {
+        Write-ColorOutput "Bench build failed with exit code $LASTEXITCODE" "Red"
+        exit 1
+    }
+
+    Write-ColorOutput "VibeDbgBench built successfully" "Green"
+    Write-ColorOutput "  $BinDir\VibeDbgBench.exe micro" "Yellow"
+}
+
 function Test-BuildOutput {
     Write-ColorOutput "Verifying build output..." "Cyan"
     
@@ -159,6 +190,10 @@ if ($Clean) {
 # Build extension
 Build-Extension
 
+if ($Bench) {
+    Build-Bench
+}
+
 # Verify output
 if (Test-BuildOutput) {
     Write-ColorOutput "Build verification completed successfully!" "Green"
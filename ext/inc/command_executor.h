@@ -1,19 +1,23 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <future>
 #include <chrono>
 #include <functional>
 #include <vector>
 #include <optional>
 #include <memory>
-#include <queue>
+#include <unordered_map>
 #include <mutex>
-#include <condition_variable>
 #include <thread>
 #include "session_manager.h"
 #include "json.h"
 
+namespace vibedbg::utils {
+class OutputFilter;
+}
+
 namespace vibedbg::core {
 
 using json = nlohmann::json;
@@ -28,12 +32,29 @@ enum class ExecutionError : uint32_t {
     Cancelled = 6
 };
 
+// Scheduling lane of a command on the engine thread; lower values run first
+enum class CommandPriority : uint8_t {
+    Interactive = 0, // Quick reads such as "r" or "k"
+    Normal = 1,
+    Background = 2,  // Long jobs such as "!analyze -v" or ".reload /f"
+    Count
+};
+
+// Receives command output in chunks while the command runs; returning false
+// stops further delivery and the remaining output is buffered as usual
+using OutputSink = std::function<bool(std::string_view chunk)>;
+
 struct ExecutionOptions {
-    std::chrono::milliseconds timeout{30000};
+    std::chrono::milliseconds timeout{0}; // Zero uses timeout_utils::calculate_adaptive_timeout
     bool validate_command{true};
     bool capture_detailed_output{false};
     int retry_count{0};
     std::chrono::milliseconds retry_delay{1000};
+    OutputSink output_sink; // Optional; output not handed to it ends up in CommandResult::output
+    std::shared_ptr<const utils::OutputFilter> output_filter; // Optional; applied to the output before it is kept
+    bool use_cache{true};   // Serve read-only commands from the result cache when state is unchanged
+    bool stop_on_error{false}; // execute_batch skips the remaining commands after the first failure
+    std::optional<CommandPriority> priority; // Derived from the command table when unset
 };
 
 struct CommandResult {
@@ -43,6 +64,7 @@ struct CommandResult {
     std::chrono::milliseconds execution_time{0};
     uint32_t exit_code{0};
     std::string command_executed;
+    size_t streamed_bytes{0}; // Output already delivered through ExecutionOptions::output_sink
     json metadata;
     std::chrono::time_point<std::chrono::steady_clock> timestamp;
 };
@@ -51,10 +73,15 @@ struct BatchResult {
     std::vector<CommandResult> results;
     size_t successful_commands{0};
     size_t failed_commands{0};
+    size_t skipped_commands{0}; // Not run because an earlier command failed with stop_on_error set
     std::chrono::milliseconds total_execution_time{0};
     bool all_successful{false};
 };
 
+class EngineScheduler;
+class SessionContexts;
+struct RequestContext;
+
 class CommandExecutor {
 public:
     using CommandCallback = std::function<void(const CommandResult&)>;
@@ -79,16 +106,31 @@ public:
                            const ExecutionOptions& options = {},
                            ProgressCallback progress_callback = nullptr);
 
+    // Runs a direct engine query (no command text) on the engine thread, so
+    // it never enters DbgEng while a command is running; returns false if
+    // the work was cancelled before it ran
+    bool execute_on_engine(CommandPriority priority, std::function<void()> work);
+
     // Command validation and preparation
     std::string prepare_command(std::string_view raw_command, ExecutionError* error = nullptr);
     
     bool validate_command_syntax(std::string_view command);
     std::vector<std::string> get_command_suggestions(std::string_view partial_command);
 
-    // Execution control
+    // Execution control; cancelling a running command interrupts it in the debugger
     void cancel_all_pending();
+    void cancel_request(std::string_view request_id);
     size_t get_pending_count() const;
     bool is_busy() const;
+    bool is_engine_started() const; // The engine thread starts with the first scheduled work
+
+    // Runs read-only commands in the background lane to fill the result cache
+    // while the engine is idle; any other work submitted meanwhile ends it
+    void prefetch(std::vector<std::string> commands);
+
+    // Result cache; entries are only valid for the state generation they were produced in
+    void invalidate_cache();
+    uint64_t get_state_generation() const { return current_generation(); }
 
     // Performance and monitoring
     struct ExecutorStats {
@@ -96,6 +138,8 @@ public:
         uint64_t successful_commands = 0;
         uint64_t failed_commands = 0;
         uint64_t timed_out_commands = 0;
+        uint64_t cache_hits = 0;
+        uint64_t cache_misses = 0;
         std::chrono::milliseconds total_execution_time{0};
         std::chrono::milliseconds average_execution_time{0};
         std::chrono::time_point<std::chrono::steady_clock> start_time;
@@ -107,21 +151,52 @@ public:
 private:
     std::shared_ptr<SessionManager> session_manager_;
     
-    // Async execution management
-    std::queue<std::function<void()>> pending_tasks_;
-    mutable std::mutex tasks_mutex_;
-    std::condition_variable tasks_cv_;
-    std::vector<std::thread> worker_threads_;
-    std::atomic<bool> shutdown_requested_{false};
+    // Every command runs on the scheduler's engine thread, interactive lanes first
+    std::unique_ptr<EngineScheduler> scheduler_;
     
-    // Statistics
-    mutable std::mutex stats_mutex_;
-    ExecutorStats stats_;
+    // Process, thread and frame of each client session; engine thread only
+    std::unique_ptr<SessionContexts> session_contexts_;
+    
+    // Statistics live in the metrics registry; only the time they were last reset is kept here
+    std::atomic<std::chrono::steady_clock::rep> stats_start_time_{0};
+
+    // Result cache for read-only commands, keyed by the engine context and the
+    // command. Entries belong to the sum of our generation counter and the
+    // session state's generation.
+    struct CachedResult {
+        std::string output;
+        std::chrono::milliseconds execution_time{0};
+        bool prefetched{false}; // Stored by a prefetch and not served since
+    };
+    static constexpr size_t MAX_CACHED_OUTPUT_SIZE = 256 * 1024; // Larger results are not cached
+    static constexpr size_t MAX_CACHE_SIZE = 8 * 1024 * 1024;    // Total cached output
+    std::unordered_map<std::string, CachedResult> result_cache_;
+    size_t cached_bytes_{0};
+    uint64_t cache_generation_{0}; // Generation every entry in result_cache_ belongs to
+    mutable std::mutex cache_mutex_;
+    std::atomic<uint64_t> state_generation_{0};
+
+    // Speculative prefetch. Every other submission cancels the prefetch jobs
+    // by their tag and bumps the epoch a running one checks between commands
+    static constexpr std::string_view PREFETCH_TAG = "vibedbg:prefetch";
+    std::atomic<bool> prefetch_queued_{false}; // A prefetch job waits for the engine; stops coalesce into it
+    std::atomic<size_t> prefetch_jobs_{0};     // Prefetch jobs queued or running
+    std::atomic<uint64_t> prefetch_epoch_{0};
+    bool prefetching_{false};                  // Engine thread only: the running job is a prefetch
+    void yield_prefetch();
+
+    uint64_t current_generation() const;
+    std::optional<CachedResult> lookup_cached_result(const std::string& key);
+    void store_cached_result(const std::string& key, const CommandResult& result, uint64_t generation);
 
     // Core execution implementation
     CommandResult execute_command_internal(std::string_view command, const ExecutionOptions& options, ExecutionError* error = nullptr);
 
-    std::string execute_windbg_command(std::string_view command, std::chrono::milliseconds timeout, ExecutionError* error = nullptr);
+    std::string execute_windbg_command(std::string_view command, std::chrono::milliseconds timeout,
+                                       const OutputSink& output_sink,
+                                       std::shared_ptr<const utils::OutputFilter> output_filter,
+                                       size_t* streamed_bytes = nullptr,
+                                       ExecutionError* error = nullptr);
 
     // Command processing pipeline
     std::string validate_and_prepare_command(std::string_view command, const ExecutionOptions& options, ExecutionError* error = nullptr);
@@ -134,10 +209,13 @@ private:
     // Retry logic
     CommandResult execute_with_retry(std::string_view command, const ExecutionOptions& options, ExecutionError* error = nullptr);
 
-    // Worker thread management
-    void start_worker_threads(size_t thread_count = 2);
-    void stop_worker_threads();
-    void worker_thread_loop();
+    // Engine thread scheduling
+    BatchResult execute_batch_internal(const std::vector<std::string>& commands, const ExecutionOptions& options,
+                                       ProgressCallback progress_callback);
+    std::future<CommandResult> schedule_command(std::string command, const ExecutionOptions& options,
+                                                RequestContext* context, std::shared_ptr<ExecutionError> error);
+    std::future<BatchResult> schedule_batch(const std::vector<std::string>& commands, const ExecutionOptions& options,
+                                            ProgressCallback progress_callback, RequestContext* context);
 
     // Statistics helpers
     void update_stats_on_success(const CommandResult& result);
@@ -153,15 +231,19 @@ private:
 namespace command_validation {
     bool is_read_only_command(std::string_view command);
     bool is_state_changing_command(std::string_view command);
+    bool is_symbol_changing_command(std::string_view command);
+    bool resumes_target(std::string_view command);
     bool is_potentially_harmful_command(std::string_view command);
     std::vector<std::string> get_safe_commands_for_automation();
     std::optional<std::string> get_command_description(std::string_view command);
+    CommandPriority get_command_priority(std::string_view command);
 }
 
 // Timeout calculation utilities
 namespace timeout_utils {
     std::chrono::milliseconds get_default_timeout_for_command(std::string_view command);
     std::chrono::milliseconds calculate_adaptive_timeout(std::string_view command);
+    void record_command_latency(std::string_view command, std::chrono::milliseconds latency);
     bool is_long_running_command(std::string_view command);
 }
 
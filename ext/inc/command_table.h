@@ -0,0 +1,321 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace vibedbg::core {
+
+// Specialized handler a command token is routed to by CommandHandlers;
+// None means the command is executed as typed
+enum class CommandRoute : uint8_t {
+    None = 0,
+    StackTrace,
+    ListThreads,
+    ListProcesses,
+    ListModules,
+    ShowRegisters,
+    Continue,
+    StepOver,
+    StepInto,
+    StepOut,
+    ContinueHandled,
+    ContinueNotHandled,
+    ListBreakpoints,
+    LoadUserSymbols,
+    LoadAllSymbols,
+    GetParentProcess,
+    SetBreakpoint,
+    ClearBreakpoint,
+    DisableBreakpoint,
+    EnableBreakpoint,
+    AttachProcess,
+    DetachProcess,
+    CreateProcess,
+    RestartProcess,
+    TerminateProcess,
+    LoadDump,
+    AnalyzeCrash,
+    DisplayMemory,
+    Count
+};
+
+// Classification bits of a command token
+enum class CommandTrait : uint16_t {
+    None = 0x0000,
+    ReadOnly = 0x0001,          // Output depends only on target state
+    ReadOnlyWithArgs = 0x0002,  // Read-only only with explicit arguments; bare forms continue from the last address
+    Assignable = 0x0004,        // An '=' in the arguments turns it into a write ("r rax=0", "dx @$x = 1")
+    StateChanging = 0x0008,     // Resumes the target or changes the context later commands are evaluated in
+    Dangerous = 0x0010,         // Rejected by CommandExecutor::validate_command_syntax
+    LongRunning = 0x0020,       // Gets the long default timeout
+    SymbolChanging = 0x0040,    // Reloads symbols or changes how addresses resolve to them
+    ResumesTarget = 0x0080      // Runs, steps or replaces the target, leaving a new event thread current
+};
+
+struct CommandInfo {
+    std::string_view name;          // Lower-case command token
+    CommandRoute route;
+    uint16_t traits;                // CommandTrait bits
+    std::string_view description;
+
+    constexpr bool has(CommandTrait trait) const noexcept {
+        return (traits & static_cast<uint16_t>(trait)) != 0;
+    }
+};
+
+namespace command_table_detail {
+
+    using enum CommandRoute;
+
+    // Trait bits as plain integers so entries can combine them
+    constexpr uint16_t NoTraits = static_cast<uint16_t>(CommandTrait::None);
+    constexpr uint16_t ReadOnly = static_cast<uint16_t>(CommandTrait::ReadOnly);
+    constexpr uint16_t ReadOnlyWithArgs = static_cast<uint16_t>(CommandTrait::ReadOnlyWithArgs);
+    constexpr uint16_t Assignable = static_cast<uint16_t>(CommandTrait::Assignable);
+    constexpr uint16_t StateChanging = static_cast<uint16_t>(CommandTrait::StateChanging);
+    constexpr uint16_t Dangerous = static_cast<uint16_t>(CommandTrait::Dangerous);
+    constexpr uint16_t LongRunning = static_cast<uint16_t>(CommandTrait::LongRunning);
+    constexpr uint16_t SymbolChanging = static_cast<uint16_t>(CommandTrait::SymbolChanging);
+    constexpr uint16_t ResumesTarget = static_cast<uint16_t>(CommandTrait::ResumesTarget);
+
+    // Every command the extension knows something about. Thread ("~3s") and
+    // process ("|1s") prefixes carry a spec inside the token and are
+    // classified by command_validation rather than looked up here.
+    inline constexpr CommandInfo ENTRIES[] = {
+        // Stacks
+        {"k", StackTrace, ReadOnly, "Display stack backtrace"},
+        {"kb", None, ReadOnly, "Display stack backtrace with arguments"},
+        {"kc", None, ReadOnly, "Display stack backtrace, symbols only"},
+        {"kd", None, ReadOnly, "Display raw stack data"},
+        {"kl", StackTrace, ReadOnly, "Display stack backtrace"},
+        {"kn", StackTrace, ReadOnly, "Display stack backtrace with frame numbers"},
+        {"kp", StackTrace, ReadOnly, "Display stack backtrace with parameters"},
+        {"kv", StackTrace, ReadOnly, "Display stack backtrace with FPO data"},
+
+        // Processes, threads and modules
+        {"~", ListThreads, ReadOnly, "List threads"},
+        {"|", None, ReadOnly, "List processes"},
+        {"!process", ListProcesses, NoTraits, "Display process information"},
+        {"!processes", ListProcesses, NoTraits, "Display process information"},
+        {"lm", ListModules, ReadOnly, "List loaded modules"},
+        {"lmv", None, ReadOnly, "List loaded modules verbosely"},
+        {"!modules", ListModules, NoTraits, "List loaded modules"},
+        {"!peb", None, ReadOnly, "Display process environment block"},
+        {"!teb", None, ReadOnly, "Display thread environment block"},
+        {"vertarget", None, ReadOnly, "Display target computer version"},
+        {"version", None, ReadOnly, "Display debugger and target version"},
+        {"getparentprocess", GetParentProcess, NoTraits, "Find the parent process"},
+        {"get_parent_process", GetParentProcess, NoTraits, "Find the parent process"},
+        {"parentprocess", GetParentProcess, NoTraits, "Find the parent process"},
+        {"parent_process", GetParentProcess, NoTraits, "Find the parent process"},
+
+        // Registers
+        {"r", ShowRegisters, ReadOnly | Assignable, "Display or set registers"},
+        {"registers", ShowRegisters, NoTraits, "Display registers"},
+
+        // Execution control
+        {"g", Continue, StateChanging | ResumesTarget | LongRunning, "Go"},
+        {"go", Continue, StateChanging | ResumesTarget | LongRunning, "Go"},
+        {"gh", ContinueHandled, StateChanging | ResumesTarget | LongRunning, "Go with exception handled"},
+        {"gn", ContinueNotHandled, StateChanging | ResumesTarget | LongRunning, "Go with exception not handled"},
+        {"gu", StepOut, StateChanging | ResumesTarget | LongRunning, "Go up (step out)"},
+        {"stepout", StepOut, StateChanging | ResumesTarget | LongRunning, "Go up (step out)"},
+        {"p", StepOver, StateChanging | ResumesTarget, "Step over"},
+        {"step", StepOver, StateChanging | ResumesTarget, "Step over"},
+        {"pa", None, StateChanging | ResumesTarget, "Step to address"},
+        {"pc", None, StateChanging | ResumesTarget, "Step to next call"},
+        {"pt", None, StateChanging | ResumesTarget, "Step to next return"},
+        {"t", StepInto, StateChanging | ResumesTarget, "Trace (step into)"},
+        {"trace", StepInto, StateChanging | ResumesTarget, "Trace (step into)"},
+        {"ta", None, StateChanging | ResumesTarget, "Trace to address"},
+        {"tc", None, StateChanging | ResumesTarget, "Trace to next call"},
+        {"tt", None, StateChanging | ResumesTarget, "Trace to next return"},
+        {"wt", None, StateChanging | ResumesTarget, "Trace and watch data"},
+
+        // Breakpoints
+        {"bl", ListBreakpoints, NoTraits, "List breakpoints"},
+        {"breakpoints", ListBreakpoints, NoTraits, "List breakpoints"},
+        {"bp", SetBreakpoint, NoTraits, "Set breakpoint"},
+        {"breakpoint", SetBreakpoint, NoTraits, "Set breakpoint"},
+        {"bc", ClearBreakpoint, NoTraits, "Clear breakpoint"},
+        {"clear", ClearBreakpoint, NoTraits, "Clear breakpoint"},
+        {"bd", DisableBreakpoint, NoTraits, "Disable breakpoint"},
+        {"disable", DisableBreakpoint, NoTraits, "Disable breakpoint"},
+        {"be", EnableBreakpoint, NoTraits, "Enable breakpoint"},
+        {"enable", EnableBreakpoint, NoTraits, "Enable breakpoint"},
+
+        // Sessions and targets
+        {".attach", AttachProcess, StateChanging | ResumesTarget, "Attach to process"},
+        {".detach", DetachProcess, StateChanging | ResumesTarget | Dangerous, "Detach from process"},
+        {".create", CreateProcess, StateChanging | ResumesTarget, "Create process"},
+        {".restart", RestartProcess, StateChanging | ResumesTarget, "Restart target"},
+        {".kill", TerminateProcess, StateChanging | ResumesTarget | Dangerous, "Kill process"},
+        {".dump", LoadDump, NoTraits, "Create dump file"},
+        {".opendump", None, StateChanging | ResumesTarget, "Open dump file"},
+        {".reboot", None, Dangerous, "Reboot target computer"},
+        {".crash", None, Dangerous, "Force system crash"},
+
+        // Context
+        {".thread", None, StateChanging, "Set register context thread"},
+        {".process", None, StateChanging, "Set process context"},
+        {".frame", None, StateChanging, "Set local context frame"},
+        {".cxr", None, StateChanging, "Set context record"},
+        {".ecxr", None, StateChanging, "Set exception context record"},
+
+        // Symbols
+        {".reload", None, StateChanging | LongRunning | SymbolChanging, "Reload modules"},
+        {".sympath", None, StateChanging | SymbolChanging, "Set symbol path"},
+        {"ld", None, StateChanging | SymbolChanging, "Load symbols"},
+        {"x", None, ReadOnly, "Examine symbols"},
+        {"ln", None, ReadOnly, "List nearest symbols"},
+        {"dt", None, ReadOnly, "Display type"},
+        {"dv", None, ReadOnly, "Display local variables"},
+        {"loadusersymbols", LoadUserSymbols, NoTraits, "Load user-mode symbols"},
+        {"load_user_symbols", LoadUserSymbols, NoTraits, "Load user-mode symbols"},
+        {"loadallsymbols", LoadAllSymbols, NoTraits, "Load all symbols"},
+        {"load_all_symbols", LoadAllSymbols, NoTraits, "Load all symbols"},
+
+        // Memory
+        {"db", DisplayMemory, ReadOnlyWithArgs, "Display memory as bytes"},
+        {"dw", DisplayMemory, ReadOnlyWithArgs, "Display memory as words"},
+        {"dd", DisplayMemory, ReadOnlyWithArgs, "Display memory as double words"},
+        {"dq", DisplayMemory, ReadOnlyWithArgs, "Display memory as quad words"},
+        {"dc", None, ReadOnlyWithArgs, "Display memory as double words and ASCII"},
+        {"da", None, ReadOnlyWithArgs, "Display ASCII string"},
+        {"du", None, ReadOnlyWithArgs, "Display Unicode string"},
+        {"dp", None, ReadOnlyWithArgs, "Display pointer-sized memory"},
+        {"dps", None, ReadOnlyWithArgs, "Display pointers with symbols"},
+        {"dqs", None, ReadOnlyWithArgs, "Display quad words with symbols"},
+        {"dds", None, ReadOnlyWithArgs, "Display double words with symbols"},
+        {"dx", None, ReadOnlyWithArgs | Assignable, "Display debugger object model expression"},
+        {"u", None, ReadOnlyWithArgs, "Unassemble"},
+        {"ub", None, ReadOnlyWithArgs, "Unassemble backwards"},
+        {"uf", None, ReadOnlyWithArgs, "Unassemble function"},
+        {"eb", None, StateChanging | Dangerous, "Enter bytes"},
+        {"ew", None, StateChanging | Dangerous, "Enter words"},
+        {"ed", None, StateChanging | Dangerous, "Enter double words"},
+        {"eq", None, StateChanging | Dangerous, "Enter quad words"},
+        {"ea", None, StateChanging, "Enter ASCII string"},
+        {"eu", None, StateChanging, "Enter Unicode string"},
+        {"ep", None, StateChanging, "Enter pointer-sized values"},
+        {"f", None, StateChanging, "Fill memory"},
+
+        // Exceptions and analysis
+        {"sxe", None, Dangerous, "Break on exception"},
+        {"sxd", None, Dangerous, "Disable exception break"},
+        {"!analyze", AnalyzeCrash, LongRunning, "Analyze exception or bug check"},
+    };
+
+    constexpr char to_lower(char c) noexcept {
+        return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+    }
+
+    // FNV-1a over the lower-cased token, so lookups never copy the command
+    constexpr uint32_t hash_token(std::string_view token) noexcept {
+        uint32_t hash = 2166136261u;
+        for (char c : token) {
+            hash ^= static_cast<uint8_t>(to_lower(c));
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
+    constexpr bool equals_ignore_case(std::string_view token, std::string_view name) noexcept {
+        if (token.size() != name.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < token.size(); ++i) {
+            if (to_lower(token[i]) != name[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    constexpr size_t ENTRY_COUNT = std::size(ENTRIES);
+    constexpr size_t SLOT_COUNT = 256; // Power of two, kept under half full
+    constexpr uint8_t EMPTY_SLOT = 0xFF;
+    static_assert(ENTRY_COUNT * 2 <= SLOT_COUNT, "Command table too full; raise SLOT_COUNT");
+    static_assert(ENTRY_COUNT < EMPTY_SLOT, "Command table indices must fit a slot");
+
+    // Open-addressed slots holding entry indices, filled at compile time
+    constexpr std::array<uint8_t, SLOT_COUNT> build_slots() {
+        std::array<uint8_t, SLOT_COUNT> slots{};
+        for (auto& slot : slots) {
+            slot = EMPTY_SLOT;
+        }
+        for (size_t i = 0; i < ENTRY_COUNT; ++i) {
+            size_t slot = hash_token(ENTRIES[i].name) & (SLOT_COUNT - 1);
+            while (slots[slot] != EMPTY_SLOT) {
+                slot = (slot + 1) & (SLOT_COUNT - 1);
+            }
+            slots[slot] = static_cast<uint8_t>(i);
+        }
+        return slots;
+    }
+
+    inline constexpr std::array<uint8_t, SLOT_COUNT> SLOTS = build_slots();
+
+    constexpr bool has_unique_lowercase_names() {
+        for (size_t i = 0; i < ENTRY_COUNT; ++i) {
+            for (char c : ENTRIES[i].name) {
+                if (c != to_lower(c)) {
+                    return false;
+                }
+            }
+            for (size_t j = i + 1; j < ENTRY_COUNT; ++j) {
+                if (ENTRIES[i].name == ENTRIES[j].name) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+    static_assert(has_unique_lowercase_names(), "Command table names must be unique and lower-case");
+
+} // namespace command_table_detail
+
+// Looks up a command token case-insensitively; nullptr if the table has no entry
+constexpr const CommandInfo* find_command(std::string_view token) noexcept {
+    using namespace command_table_detail;
+    size_t slot = hash_token(token) & (SLOT_COUNT - 1);
+    while (SLOTS[slot] != EMPTY_SLOT) {
+        const CommandInfo& entry = ENTRIES[SLOTS[slot]];
+        if (equals_ignore_case(token, entry.name)) {
+            return &entry;
+        }
+        slot = (slot + 1) & (SLOT_COUNT - 1);
+    }
+    return nullptr;
+}
+
+// First token of a command without surrounding whitespace, e.g. "LM" for
+// "  LM vm ntdll"; the trimmed remainder goes to *arguments
+constexpr std::string_view command_token(std::string_view command, std::string_view* arguments = nullptr) noexcept {
+    constexpr std::string_view whitespace = " \t\r\n";
+    size_t start = command.find_first_not_of(whitespace);
+    if (start == std::string_view::npos) {
+        if (arguments) *arguments = {};
+        return {};
+    }
+    command.remove_prefix(start);
+
+    size_t end = command.find_first_of(whitespace);
+    std::string_view token = command.substr(0, end);
+    if (arguments) {
+        std::string_view rest = end == std::string_view::npos ? std::string_view{} : command.substr(end);
+        size_t rest_start = rest.find_first_not_of(whitespace);
+        size_t rest_end = rest.find_last_not_of(whitespace);
+        *arguments = rest_start == std::string_view::npos ? std::string_view{} : rest.substr(rest_start, rest_end - rest_start + 1);
+    }
+    return token;
+}
+
+static_assert(find_command("LM") && find_command("lm")->route == CommandRoute::ListModules);
+static_assert(find_command("!Analyze") && find_command("!analyze")->has(CommandTrait::LongRunning));
+static_assert(find_command("lmvm") == nullptr);
+static_assert(command_token("  kn 10 ") == "kn");
+
+} // namespace vibedbg::core
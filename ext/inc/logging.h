@@ -6,24 +6,71 @@
 #include <iomanip>
 #include <chrono>
 #include <mutex>
+#include <atomic>
+#include <cstdint>
 
-namespace vibedbg::logging {
+// Levels below VIBEDBG_MIN_LOG_LEVEL are compiled out of the LOG_* macros,
+// arguments included. Release builds keep Info and above unless the build
+// defines the minimum itself.
+#define VIBEDBG_LOG_LEVEL_TRACE   0
+#define VIBEDBG_LOG_LEVEL_DEBUG   1
+#define VIBEDBG_LOG_LEVEL_INFO    2
+#define VIBEDBG_LOG_LEVEL_WARNING 3
+#define VIBEDBG_LOG_LEVEL_ERROR   4
+#define VIBEDBG_LOG_LEVEL_FATAL   5
 
+#ifndef VIBEDBG_MIN_LOG_LEVEL
+#ifdef _DEBUG
+#define VIBEDBG_MIN_LOG_LEVEL VIBEDBG_LOG_LEVEL_TRACE
+#else
+#define VIBEDBG_MIN_LOG_LEVEL VIBEDBG_LOG_LEVEL_INFO
+#endif
+#endif
 
+namespace vibedbg::logging {
 
+enum class Level : uint8_t {
+    Trace = VIBEDBG_LOG_LEVEL_TRACE,
+    Debug = VIBEDBG_LOG_LEVEL_DEBUG,
+    Info = VIBEDBG_LOG_LEVEL_INFO,
+    Warning = VIBEDBG_LOG_LEVEL_WARNING,
+    Error = VIBEDBG_LOG_LEVEL_ERROR,
+    Fatal = VIBEDBG_LOG_LEVEL_FATAL
+};
+
+/**
+ * @class Logger
+ * @brief Buffered logger writing to the debugger output and an optional file.
+ *
+ * Logging threads copy each message into a fixed-size lock-free ring and
+ * return; a background thread adds the timestamp and writes the messages to
+ * OutputDebugString, and to the file named by VIBEDBG_LOG_FILE if set. When
+ * the ring is full, messages are dropped and the drop is reported, so that
+ * logging never blocks a request. Before Initialize and after Cleanup,
+ * messages are written directly.
+ *
+ * The VIBEDBG_LOG_LEVEL environment variable (trace, debug, info, warning,
+ * error or fatal) raises the level at runtime above the compiled minimum.
+ */
 class Logger {
 public:
     static void Initialize(const std::string& component_name = "VibeDbg");
     static void Cleanup();
-    
-    // Simple logging methods that use OutputDebugString
+
+    static bool IsEnabled(Level level) noexcept {
+        return level >= min_level_.load(std::memory_order_relaxed);
+    }
+    static void SetLevel(Level level) noexcept { min_level_.store(level, std::memory_order_relaxed); }
+    static Level GetLevel() noexcept { return min_level_.load(std::memory_order_relaxed); }
+
+    // Logging methods; prefer the LOG_* macros, which skip disabled levels
     static void Trace(const std::string& context, const std::string& message);
     static void Debug(const std::string& context, const std::string& message);
     static void Info(const std::string& context, const std::string& message);
     static void Warning(const std::string& context, const std::string& message);
     static void Error(const std::string& context, const std::string& message);
     static void Fatal(const std::string& context, const std::string& message);
-    
+
     // Logging with details
     static void Trace(const std::string& context, const std::string& message, const std::string& details);
     static void Debug(const std::string& context, const std::string& message, const std::string& details);
@@ -31,39 +78,48 @@ public:
     static void Warning(const std::string& context, const std::string& message, const std::string& details);
     static void Error(const std::string& context, const std::string& message, const std::string& details);
     static void Fatal(const std::string& context, const std::string& message, const std::string& details);
-    
 
-    
     // WinDbg UI logging methods (these show up in WinDbg UI)
     static void LogToWinDbg(const std::string& context, const std::string& message);
     static void LogToWinDbg(const std::string& context, const std::string& message, const std::string& details);
-    
+
 private:
-    static std::string GetTimestamp();
-    static void WriteToDebugView(const std::string& message);
-    static std::string FormatLogMessage(const std::string& level, const std::string& context, const std::string& message, const std::string& details = "");
-    static void Log(const std::string& level_str, const std::string& context, const std::string& message, const std::string& details = "");
-    
+    static std::string GetTimestamp(std::chrono::system_clock::time_point time);
+    static std::string FormatLogMessage(std::chrono::system_clock::time_point time, Level level, std::string_view text);
+    static void Log(Level level, const std::string& context, const std::string& message, const std::string& details = "");
+    static void WriteLine(const std::string& line);
+    static void DrainLoop();
+
     static std::string component_name_;
-    static std::mutex log_mutex_;
-    static bool initialized_;
+    static std::mutex lifecycle_mutex_;     // Serializes Initialize and Cleanup only
+    static inline std::atomic<Level> min_level_{static_cast<Level>(VIBEDBG_MIN_LOG_LEVEL)};
 };
 
+// Evaluates the logging call only if its level is compiled in and enabled
+#define VIBEDBG_LOG_AT(level, call) \
+    do { \
+        if constexpr (static_cast<int>(level) >= VIBEDBG_MIN_LOG_LEVEL) { \
+            if (vibedbg::logging::Logger::IsEnabled(level)) { \
+                call; \
+            } \
+        } \
+    } while (0)
+
 // Macro for easier logging with automatic context
-#define LOG_TRACE(context, message) vibedbg::logging::Logger::Trace(context, message)
-#define LOG_DEBUG(context, message) vibedbg::logging::Logger::Debug(context, message)
-#define LOG_INFO(context, message) vibedbg::logging::Logger::Info(context, message)
-#define LOG_WARNING(context, message) vibedbg::logging::Logger::Warning(context, message)
-#define LOG_ERROR(context, message) vibedbg::logging::Logger::Error(context, message)
-#define LOG_FATAL(context, message) vibedbg::logging::Logger::Fatal(context, message)
+#define LOG_TRACE(context, message) VIBEDBG_LOG_AT(vibedbg::logging::Level::Trace, vibedbg::logging::Logger::Trace(context, message))
+#define LOG_DEBUG(context, message) VIBEDBG_LOG_AT(vibedbg::logging::Level::Debug, vibedbg::logging::Logger::Debug(context, message))
+#define LOG_INFO(context, message) VIBEDBG_LOG_AT(vibedbg::logging::Level::Info, vibedbg::logging::Logger::Info(context, message))
+#define LOG_WARNING(context, message) VIBEDBG_LOG_AT(vibedbg::logging::Level::Warning, vibedbg::logging::Logger::Warning(context, message))
+#define LOG_ERROR(context, message) VIBEDBG_LOG_AT(vibedbg::logging::Level::Error, vibedbg::logging::Logger::Error(context, message))
+#define LOG_FATAL(context, message) VIBEDBG_LOG_AT(vibedbg::logging::Level::Fatal, vibedbg::logging::Logger::Fatal(context, message))
 
 // Macro for logging with details
-#define LOG_TRACE_DETAIL(context, message, details) vibedbg::logging::Logger::Trace(context, message, details)
-#define LOG_DEBUG_DETAIL(context, message, details) vibedbg::logging::Logger::Debug(context, message, details)
-#define LOG_INFO_DETAIL(context, message, details) vibedbg::logging::Logger::Info(context, message, details)
-#define LOG_WARNING_DETAIL(context, message, details) vibedbg::logging::Logger::Warning(context, message, details)
-#define LOG_ERROR_DETAIL(context, message, details) vibedbg::logging::Logger::Error(context, message, details)
-#define LOG_FATAL_DETAIL(context, message, details) vibedbg::logging::Logger::Fatal(context, message, details)
+#define LOG_TRACE_DETAIL(context, message, details) VIBEDBG_LOG_AT(vibedbg::logging::Level::Trace, vibedbg::logging::Logger::Trace(context, message, details))
+#define LOG_DEBUG_DETAIL(context, message, details) VIBEDBG_LOG_AT(vibedbg::logging::Level::Debug, vibedbg::logging::Logger::Debug(context, message, details))
+#define LOG_INFO_DETAIL(context, message, details) VIBEDBG_LOG_AT(vibedbg::logging::Level::Info, vibedbg::logging::Logger::Info(context, message, details))
+#define LOG_WARNING_DETAIL(context, message, details) VIBEDBG_LOG_AT(vibedbg::logging::Level::Warning, vibedbg::logging::Logger::Warning(context, message, details))
+#define LOG_ERROR_DETAIL(context, message, details) VIBEDBG_LOG_AT(vibedbg::logging::Level::Error, vibedbg::logging::Logger::Error(context, message, details))
+#define LOG_FATAL_DETAIL(context, message, details) VIBEDBG_LOG_AT(vibedbg::logging::Level::Fatal, vibedbg::logging::Logger::Fatal(context, message, details))
 
 // WinDbg UI logging macros
 #define LOG_WINDBG(context, message) vibedbg::logging::Logger::LogToWinDbg(context, message)
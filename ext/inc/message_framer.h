@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <vector>
+#include "message_protocol.h"
+
+namespace vibedbg::communication {
+
+// Incremental framer for a byte stream carrying protocol messages, either
+// delimited v1 text or length-prefixed v2 frames.
+//
+// Bytes are received directly into the framer (prepare/commit) and complete
+// frames are returned as views into its storage. The delimiter scan resumes
+// where the previous one stopped, so each byte is examined once no matter how
+// many reads a frame is split across. A view returned by next_frame() stays
+// valid until the next call to prepare() or append().
+class MessageFramer {
+public:
+    explicit MessageFramer(size_t initial_capacity = 64 * 1024,
+                           size_t max_frame_size = MessageProtocol::MAX_MESSAGE_SIZE);
+
+    // Producer side
+    std::span<std::byte> prepare(size_t min_size);
+    void commit(size_t bytes_written);
+    void append(std::span<const std::byte> data);
+
+    // Consumer side
+    std::optional<std::span<const std::byte>> next_frame(ErrorCode* error = nullptr);
+
+    size_t buffered_size() const noexcept { return write_pos_ - read_pos_; }
+    bool has_partial_frame() const noexcept { return write_pos_ > read_pos_; }
+    void reset() noexcept;
+
+private:
+    std::vector<std::byte> buffer_;
+    size_t read_pos_ = 0;   // Start of the first unconsumed frame
+    size_t write_pos_ = 0;  // End of received data
+    size_t scan_pos_ = 0;   // Delimiter search resumes here
+    size_t max_frame_size_;
+
+    void make_room(size_t min_size);
+};
+
+} // namespace vibedbg::communication
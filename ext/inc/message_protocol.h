@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <optional>
 #include <chrono>
 #include <cstdint>
@@ -17,7 +18,21 @@ enum class MessageType : uint8_t {
     Command = 1,
     Response = 2,
     Error = 3,
-    Heartbeat = 4
+    Heartbeat = 4,
+    Subscribe = 5,  // Client selects the events pushed to its connection
+    Event = 6       // Debugger event pushed by the server, never a reply
+};
+
+// Debugger events a connection can subscribe to, combined as a bit set
+enum class EventKind : uint32_t {
+    None = 0,
+    Breakpoint = 1 << 0,
+    Exception = 1 << 1,
+    ModuleLoad = 1 << 2,
+    ModuleUnload = 1 << 3,
+    ProcessExit = 1 << 4,
+    StateChange = 1 << 5,
+    SymbolLoad = 1 << 6     // Progress of a background symbol load
 };
 
 enum class ErrorCode : uint32_t {
@@ -43,7 +58,8 @@ enum class ErrorCode : uint32_t {
     ClientNotConnected = 19,
     SendFailed = 20,
     HandlerException = 21,
-    PipeCreationFailed = 22
+    PipeCreationFailed = 22,
+    Busy = 23               // Refused by admission control; the details carry retry_after_ms
 };
 
 struct CommandRequest {
@@ -51,6 +67,9 @@ struct CommandRequest {
     std::string command;
     json parameters;
     std::chrono::milliseconds timeout{30000};
+    bool stream{false}; // Client accepts the output as a sequence of chunk frames
+    std::string session_id; // Agent session whose process, thread and frame the command runs in; empty for the shared context
+    uint32_t protocol_version{1}; // Version the request arrived in; v2 responses can carry binary output
     std::chrono::time_point<std::chrono::steady_clock> timestamp;
 };
 
@@ -61,6 +80,9 @@ struct CommandResponse {
     std::string error_message;
     std::chrono::milliseconds execution_time{0};
     json session_data;
+    json data;            // Structured result of requests such as read_memory; null for text commands
+    uint32_t sequence{0}; // Position within a streamed response; chunks count up from 0
+    bool final{true};     // false for chunk frames, true for the frame completing the response
     std::chrono::time_point<std::chrono::steady_clock> timestamp;
 };
 
@@ -91,33 +113,113 @@ struct HeartbeatMessage {
     std::chrono::time_point<std::chrono::steady_clock> timestamp;
 };
 
+struct SubscribeRequest {
+    std::string request_id;
+    std::vector<std::string> events; // Event names to push; empty unsubscribes
+    std::chrono::time_point<std::chrono::steady_clock> timestamp;
+};
+
+struct EventMessage {
+    EventKind kind{EventKind::None};
+    json data;
+    uint64_t sequence{0};   // Counts the events delivered on the connection
+    uint32_t coalesced{0};  // Earlier state changes this one replaced before delivery
+    uint64_t dropped{0};    // Events discarded for backpressure since the previous one
+    std::chrono::time_point<std::chrono::steady_clock> timestamp;
+};
+
+// Protocol v2 frame flags
+enum class FrameFlags : uint16_t {
+    None = 0x0000,
+    RawBody = 0x0001,         // Body is [u32 envelope size][envelope][raw output bytes]
+    Partial = 0x0002,         // Response chunk; more frames for the same request follow
+    EncodingMask = 0x0300     // PayloadEncoding of the envelope, shifted by ENCODING_FLAG_SHIFT
+};
+
+// Envelope encoding for protocol v2 frames (v1 frames are always JSON text)
+enum class PayloadEncoding : uint8_t {
+    Json = 0,
+    MessagePack = 1,
+    Cbor = 2
+};
+
+// Fixed little-endian header preceding every protocol v2 frame
+#pragma pack(push, 1)
+struct FrameHeader {
+    uint32_t magic;    // MessageProtocol::FRAME_MAGIC
+    uint8_t version;   // MessageProtocol::PROTOCOL_VERSION_V2
+    uint8_t type;      // MessageType
+    uint16_t flags;    // FrameFlags
+    uint32_t length;   // Body size in bytes, excluding this header
+};
+#pragma pack(pop)
+static_assert(sizeof(FrameHeader) == 12, "FrameHeader must be 12 bytes");
+
+// How a peer frames its messages; responses mirror the request's format
+struct WireFormat {
+    uint32_t version = 1;
+    PayloadEncoding encoding = PayloadEncoding::Json;
+};
+
+// A frame split into its header fields, envelope and optional raw body
+struct DecodedMessage {
+    WireFormat format;
+    MessageType type{0};
+    uint16_t flags{0};
+    json payload;
+    std::span<const std::byte> raw_body;
+};
+
 class MessageProtocol {
 public:
-    static constexpr uint32_t PROTOCOL_VERSION = 1;
+    static constexpr uint32_t PROTOCOL_VERSION_V1 = 1; // JSON text terminated by MESSAGE_DELIMITER
+    static constexpr uint32_t PROTOCOL_VERSION_V2 = 2; // FrameHeader followed by a length-delimited body
+    static constexpr uint32_t PROTOCOL_VERSION = PROTOCOL_VERSION_V2; // Highest supported version
     static constexpr size_t MAX_MESSAGE_SIZE = 1024 * 1024; // 1MB
     static constexpr std::string_view MESSAGE_DELIMITER = "\r\n\r\n";
+    static constexpr uint32_t FRAME_MAGIC = 0x32424456; // "VDB2"
+    static constexpr size_t FRAME_HEADER_SIZE = sizeof(FrameHeader);
+    static constexpr uint16_t ENCODING_FLAG_SHIFT = 8;
 
     // Serialization
     static std::vector<std::byte> serialize_command(const CommandRequest& request, ErrorCode* error = nullptr);
+    static std::vector<std::byte> serialize_command(const CommandRequest& request, const WireFormat& format, ErrorCode* error = nullptr);
     
     static std::vector<std::byte> serialize_response(const CommandResponse& response, ErrorCode* error = nullptr);
+    static std::vector<std::byte> serialize_response(const CommandResponse& response, const WireFormat& format, ErrorCode* error = nullptr);
     
     static std::vector<std::byte> serialize_error(const ErrorMessage& error_msg, ErrorCode* error = nullptr);
+    static std::vector<std::byte> serialize_error(const ErrorMessage& error_msg, const WireFormat& format, ErrorCode* error = nullptr);
     
     static std::vector<std::byte> serialize_heartbeat(const HeartbeatMessage& heartbeat, ErrorCode* error = nullptr);
+    static std::vector<std::byte> serialize_heartbeat(const HeartbeatMessage& heartbeat, const WireFormat& format, ErrorCode* error = nullptr);
+    
+    static std::vector<std::byte> serialize_event(const EventMessage& event, const WireFormat& format, ErrorCode* error = nullptr);
 
     // Deserialization
+    static DecodedMessage decode_message(std::span<const std::byte> data, ErrorCode* error = nullptr);
+    
     static CommandRequest parse_command(std::span<const std::byte> data, ErrorCode* error = nullptr);
+    static CommandRequest parse_command(const DecodedMessage& message, ErrorCode* error = nullptr);
     
     static CommandResponse parse_response(std::span<const std::byte> data, ErrorCode* error = nullptr);
     
     static ErrorMessage parse_error(std::span<const std::byte> data, ErrorCode* error = nullptr);
     
     static HeartbeatMessage parse_heartbeat(std::span<const std::byte> data, ErrorCode* error = nullptr);
+    static HeartbeatMessage parse_heartbeat(const DecodedMessage& message, ErrorCode* error = nullptr);
+    
+    static SubscribeRequest parse_subscribe(const DecodedMessage& message, ErrorCode* error = nullptr);
 
     // Utility functions
     static MessageType get_message_type(std::span<const std::byte> data);
     static bool validate_message_size(size_t size);
+    static bool is_binary_frame(std::span<const std::byte> data);
+    static std::optional<FrameHeader> read_frame_header(std::span<const std::byte> data);
+    static std::string_view encoding_name(PayloadEncoding encoding);
+    static std::optional<PayloadEncoding> parse_encoding_name(std::string_view name);
+    static std::string_view event_name(EventKind kind);
+    static std::optional<EventKind> parse_event_name(std::string_view name);
     static std::string generate_request_id();
     
     // Error handling utilities
@@ -128,9 +230,10 @@ public:
 
 private:
     static json bytes_to_json(std::span<const std::byte> data, ErrorCode* error = nullptr);
-    static std::vector<std::byte> json_to_bytes(const json& j);
-    static std::vector<std::byte> add_header(MessageType type, std::span<const std::byte> payload);
-    static std::span<const std::byte> extract_payload(std::span<const std::byte> data, ErrorCode* error = nullptr);
+    static json decode_envelope(std::span<const std::byte> data, PayloadEncoding encoding, ErrorCode* error = nullptr);
+    static std::string encode_envelope(const json& payload, PayloadEncoding encoding);
+    static std::vector<std::byte> frame_message(MessageType type, const json& payload, const WireFormat& format,
+                                                uint16_t flags = 0, std::string_view raw_body = {});
 };
 
 } // namespace vibedbg::communication
\ No newline at end of file
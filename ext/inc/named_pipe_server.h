@@ -4,155 +4,101 @@
 #include <string>
 #include <thread>
 #include <atomic>
-#include <functional>
 #include <memory>
 #include <vector>
-#include <queue>
-#include <mutex>
-#include <shared_mutex>
-#include <condition_variable>
-#include <span>
 #include <chrono>
-#include "message_protocol.h"
+#include "transport_server.h"
 #include "handle_wrapper.h"
 
 namespace vibedbg::communication {
 
-class ClientConnection;
+class PipeConnection;
 
-enum class PipeServerError : uint32_t {
-    None = 0,
-    CreationFailed = 1,
-    ConnectionFailed = 2,
-    ReadFailed = 3,
-    WriteFailed = 4,
-    Timeout = 5,
-    Disconnected = 6
+enum class PipeIoMode : uint32_t {
+    Polling = 0,    // Legacy: one thread per client polling with PeekNamedPipe
+    Overlapped = 1  // FILE_FLAG_OVERLAPPED pipes serviced by an I/O completion port
 };
 
-struct PipeServerConfig {
+struct PipeServerConfig : TransportConfig {
     std::string pipe_name = R"(\\.\pipe\vibedbg_debug)";
-    uint32_t max_connections = 10;
     uint32_t buffer_size = 64 * 1024; // 64KB
-    std::chrono::milliseconds read_timeout{30000};
-    std::chrono::milliseconds write_timeout{5000};
     bool enable_heartbeat = true;
     std::chrono::milliseconds heartbeat_interval{10000};
+    PipeIoMode io_mode = PipeIoMode::Overlapped;
+    uint32_t completion_threads = 2; // Worker pool size for PipeIoMode::Overlapped
 };
 
-class NamedPipeServer {
+class NamedPipeServer : public TransportServer {
 public:
-    using MessageHandler = std::function<CommandResponse(const CommandRequest&, ErrorCode* error)>;
-
     explicit NamedPipeServer(const PipeServerConfig& config = {});
-    ~NamedPipeServer();
+    ~NamedPipeServer() override;
 
     // Server lifecycle
-    PipeServerError start();
-    void stop();
-    bool is_running() const noexcept { return running_.load(); }
-
-    // Message handling
-    void set_message_handler(MessageHandler handler) { message_handler_ = std::move(handler); }
-
-    // Statistics and monitoring
-    struct ServerStats {
-        uint64_t total_connections = 0;
-        uint64_t active_connections = 0;
-        uint64_t total_messages_processed = 0;
-        uint64_t total_errors = 0;
-        std::chrono::time_point<std::chrono::steady_clock> start_time;
-        std::chrono::milliseconds uptime{0};
-    };
-
-    ServerStats get_stats() const;
-    std::vector<std::string> get_active_connection_ids() const;
+    PipeServerError start() override;
+    void stop() override;
 
     // Configuration
     const PipeServerConfig& get_config() const noexcept { return config_; }
 
 private:
     PipeServerConfig config_;
-    std::atomic<bool> running_{false};
     std::unique_ptr<std::thread> server_thread_;
-    MessageHandler message_handler_;
-
-    // Connection management
-    mutable std::shared_mutex connections_mutex_;
-    std::vector<std::unique_ptr<ClientConnection>> connections_;
     std::vector<std::thread> client_threads_;
 
-    // Statistics
-    mutable std::mutex stats_mutex_;
-    ServerStats stats_;
+    // Overlapped I/O
+    utils::HandleWrapper completion_port_{nullptr};
+    std::vector<std::thread> completion_threads_;
+    std::atomic<uint32_t> pending_io_{0};
 
     // Server implementation
     void server_loop();
+    void overlapped_server_loop();
+    void completion_worker_loop();
     HANDLE create_pipe_instance(PipeServerError* error = nullptr);
     void handle_client_connection(HANDLE pipe_handle);
-    void cleanup_disconnected_connections();
+
+    // Overlapped I/O
+    bool wait_for_overlapped_connect(HANDLE pipe_handle);
+    void begin_overlapped_read(PipeConnection& client);
+    void handle_read_completion(PipeConnection& client, DWORD bytes_transferred, DWORD error_code);
+    void cancel_overlapped_io();
 
     // Message processing
-    PipeServerError process_client_messages(ClientConnection& client);
-    CommandResponse handle_command(const CommandRequest& request, ErrorCode* error = nullptr);
-    void send_heartbeat(ClientConnection& client);
-
-    // Error handling
-    void update_stats_on_error();
-    void update_stats_on_message();
-    void update_stats_on_connection();
+    PipeServerError process_client_messages(PipeConnection& client);
 };
 
-class ClientConnection {
+class PipeConnection : public ClientConnection {
 public:
-    explicit ClientConnection(HANDLE pipe_handle, const std::string& connection_id);
-    ~ClientConnection();
+    explicit PipeConnection(HANDLE pipe_handle, const std::string& connection_id, bool overlapped = false);
+    ~PipeConnection() override;
 
-    // Connection management
-    bool is_active() const noexcept { return active_.load(); }
-    void mark_inactive() { active_.store(false); }
-    const std::string& get_id() const noexcept { return connection_id_; }
     HANDLE get_handle() const noexcept { return pipe_handle_.get(); }
 
-    // Message I/O
-    std::vector<std::byte> read_message(std::chrono::milliseconds timeout, PipeServerError* error = nullptr);
-    
-    PipeServerError write_message(std::span<const std::byte> data, std::chrono::milliseconds timeout);
+    // Polled reads (PipeIoMode::Polling only)
+    PipeServerError receive(std::chrono::milliseconds timeout);
 
-    // Statistics
-    struct ConnectionStats {
-        std::chrono::time_point<std::chrono::steady_clock> connection_time;
-        uint64_t messages_received = 0;
-        uint64_t messages_sent = 0;
-        uint64_t bytes_received = 0;
-        uint64_t bytes_sent = 0;
-        std::chrono::time_point<std::chrono::steady_clock> last_activity;
-    };
+    // Overlapped I/O (PipeIoMode::Overlapped only)
+    bool is_overlapped() const noexcept { return overlapped_; }
+    PipeServerError begin_read();
+    PipeServerError complete_read(DWORD bytes_transferred, DWORD error_code);
 
-    const ConnectionStats& get_stats() const noexcept { return stats_; }
+protected:
+    PipeServerError write_bytes(std::span<const std::byte> data, std::chrono::milliseconds timeout) override;
+    void cancel_read() override;
 
 private:
     utils::HandleWrapper pipe_handle_;
-    std::string connection_id_;
-    std::atomic<bool> active_{true};
-    
-    // I/O buffers
-    std::vector<std::byte> read_buffer_;
-    std::vector<std::byte> message_buffer_;
-    
-    // Statistics
-    ConnectionStats stats_;
-    mutable std::mutex stats_mutex_;
-
-    // I/O implementation
-    void update_read_stats(size_t bytes_read);
-    void update_write_stats(size_t bytes_written);
-    bool find_complete_message();
+    bool overlapped_ = false;
+
+    // Overlapped I/O state
+    OVERLAPPED read_overlapped_{};
+    utils::HandleWrapper write_event_{nullptr};
+
+    std::chrono::steady_clock::time_point last_receive_time_{}; // Last polled read that returned data
 };
 
 // Utility functions
-std::string generate_connection_id();
 std::string format_pipe_error(DWORD error_code);
 bool is_pipe_error_recoverable(DWORD error_code);
 
-} // namespace vibedbg::communication
\ No newline at end of file
+} // namespace vibedbg::communication
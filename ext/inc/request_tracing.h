@@ -0,0 +1,98 @@
+#pragma once
+
+#include <Windows.h>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace vibedbg::utils {
+
+/**
+ * @brief Stages of a request that are traced as ETW activities.
+ */
+enum class TraceStage : uint8_t {
+    PipeRead,   // First bytes of a frame until the frame is complete
+    Parse,      // Decoding the frame into a command request
+    Route,      // A command routed to its specific handler
+    Execute,    // IDebugControl::Execute
+    Capture,    // Collecting the captured output after execution
+    Serialize,  // Encoding a response frame
+    Write       // Writing a frame until the client has taken it
+};
+
+/**
+ * @class RequestTracing
+ * @brief The "VibeDbg" TraceLogging provider.
+ *
+ * Provider GUID {9d255b09-7cd8-5037-6d51-8d64d7bcf2c9}, derived from the
+ * name, so "wpr -start" profiles and "tracelog" can enable it as *VibeDbg.
+ * Every event carries the RequestId field, so that WPA can group a request's
+ * stages across the pipe and engine threads.
+ */
+class RequestTracing {
+public:
+    static constexpr uint64_t KEYWORD_REQUEST = 0x1;
+
+    /**
+     * @brief Registers the provider; later calls do nothing.
+     */
+    static void register_provider() noexcept;
+
+    /**
+     * @brief Unregisters the provider; must run before the DLL unloads.
+     */
+    static void unregister_provider() noexcept;
+
+    /**
+     * @return true if a session is listening for request events
+     */
+    static bool enabled() noexcept;
+};
+
+/**
+ * @class TraceActivity
+ * @brief Start and stop events of one stage, written only while a trace
+ *        session is listening.
+ *
+ * The stop event is written when the activity is stopped or destroyed. When
+ * nobody listens, constructing and destroying an activity costs one enabled
+ * check and copies nothing.
+ */
+class TraceActivity {
+public:
+    TraceActivity() noexcept = default;
+
+    /**
+     * @brief Starts the stage if the provider is enabled.
+     *
+     * @param[in] stage Stage the activity covers
+     * @param[in] request_id Request being served; may be empty until set_request_id
+     */
+    TraceActivity(TraceStage stage, std::string_view request_id);
+
+    ~TraceActivity() { stop(); }
+
+    TraceActivity(TraceActivity&& other) noexcept;
+    TraceActivity& operator=(TraceActivity&& other) noexcept;
+    TraceActivity(const TraceActivity&) = delete;
+    TraceActivity& operator=(const TraceActivity&) = delete;
+
+    /**
+     * @brief Names the request once it is known; the stop event carries it.
+     */
+    void set_request_id(std::string_view request_id);
+
+    void set_failed() noexcept { failed_ = true; }
+    bool active() const noexcept { return active_; }
+
+    void stop() noexcept;
+
+private:
+    TraceStage stage_{TraceStage::PipeRead};
+    bool active_{false};
+    bool failed_{false};
+    GUID activity_id_{};
+    std::string request_id_;
+};
+
+} // namespace vibedbg::utils
@@ -4,7 +4,11 @@
 #include <string>
 #include <chrono>
 #include <optional>
-#include <shared_mutex>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <thread>
+#include <vector>
 #include <atomic>
 #include "json.h"
 
@@ -38,28 +42,41 @@ struct ThreadInfo {
     uintptr_t stack_limit = 0;
 };
 
+// Kept current by the engine's event callbacks, so reading it never runs a
+// command or queries the engine. Published as immutable snapshots: a change
+// copies the state and replaces the snapshot, never the state in place
 struct SessionState {
     std::optional<ProcessInfo> current_process;
     std::optional<ThreadInfo> current_thread;
     std::chrono::time_point<std::chrono::steady_clock> session_start;
     bool is_connected{false};
     bool is_target_running{false};
+    size_t thread_count{0};         // Threads of the current process
+    size_t module_count{0};         // Modules loaded in the current process
+    uint64_t generation{0};         // Bumped by every change, including memory and register writes
     json metadata;
 };
 
+using SessionSnapshot = std::shared_ptr<const SessionState>;
+
 class SessionManager {
 public:
     SessionManager();
-    ~SessionManager() = default;
+    ~SessionManager();
 
     // Session lifecycle
     SessionError initialize();
     void shutdown();
     bool is_initialized() const noexcept { return initialized_.load(); }
 
-    // State management  
-    const SessionState& get_state() const;
+    // State management; get_state() returns the current snapshot without
+    // ever waiting for an update or a state change callback
+    SessionSnapshot get_state() const;
     SessionError update_state(const SessionState& new_state);
+
+    // Publishes a copy of the state with one change applied and notifies the
+    // state change callbacks; the engine event callbacks report through this
+    void modify_state(const std::function<void(SessionState&)>& change);
     
     // Command suggestions
     std::vector<std::string> get_suggested_commands() const;
@@ -76,15 +93,26 @@ public:
     json serialize_state() const;
     SessionError deserialize_state(const json& state_data);
 
-    // Event notifications
+    // Event notifications. Callbacks run on a notification thread of their
+    // own, after the change is published; changes made while they run are
+    // reported together, from the oldest unreported state to the newest
     using StateChangeCallback = std::function<void(const SessionState&, const SessionState&)>;
     void register_state_change_callback(StateChangeCallback callback);
 
 private:
-    mutable std::shared_mutex state_mutex_;
-    SessionState state_;
+    std::atomic<SessionSnapshot> state_;
+    std::mutex update_mutex_;           // Serializes writers; readers never take it
     std::atomic<bool> initialized_{false};
     std::vector<StateChangeCallback> state_change_callbacks_;
+    std::mutex callbacks_mutex_;
+
+    // Changes not yet reported to the callbacks; started with the first callback
+    std::thread notify_thread_;
+    std::mutex notify_mutex_;
+    std::condition_variable notify_cv_;
+    SessionSnapshot unreported_old_;
+    SessionSnapshot unreported_new_;
+    bool stopping_{false};
 
     // WinDbg interface helpers
     std::string execute_windbg_command(std::string_view command, SessionError* error = nullptr);
@@ -96,8 +124,12 @@ private:
     // Command validation helpers
     bool is_dangerous_command(std::string_view command) const;
     
+    // Publishes a changed copy of the current state; returns the old and new snapshots
+    std::pair<SessionSnapshot, SessionSnapshot> replace_state(const std::function<void(SessionState&)>& change);
+
     // State change notification
-    void notify_state_change(const SessionState& old_state, const SessionState& new_state);
+    void notify_state_change(SessionSnapshot old_state, SessionSnapshot new_state);
+    void notify_loop();
 };
 
 // No utility functions needed for user mode only debugging
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <mswsock.h>
+#define SECURITY_WIN32
+#include <security.h>
+#include <schannel.h>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <chrono>
+#include "transport_server.h"
+#include "handle_wrapper.h"
+
+namespace vibedbg::communication {
+
+class SocketConnection;
+
+struct SocketServerConfig : TransportConfig {
+    std::string bind_address = "127.0.0.1"; // Numeric address or host name; "0.0.0.0" or "::" listens everywhere
+    uint16_t port = 5710;
+    std::string tls_certificate;     // Subject or SHA-1 thumbprint of a certificate in the MY store; empty serves plain TCP
+    std::string auth_token;          // Required in the first heartbeat of a connection when set
+    uint32_t completion_threads = 2; // Worker pool servicing accepts and reads
+    uint32_t pending_accepts = 4;    // AcceptEx calls kept posted on the listening socket
+};
+
+/**
+ * @class SocketServer
+ * @brief Serves the pipe protocol over TCP, optionally wrapped in TLS.
+ *
+ * Lets a client on another machine drive the debugger. Connections are
+ * accepted with AcceptEx and read with WSARecv, all completing on one I/O
+ * completion port; framing, dispatch and events come from TransportServer,
+ * so the frames on the wire are the ones the named pipe carries.
+ *
+ * TLS is Schannel with the configured server certificate. When an auth token
+ * is configured, a connection's first message must be a heartbeat carrying
+ * it in session_info.auth_token; anything else closes the connection.
+ */
+class SocketServer : public TransportServer {
+public:
+    explicit SocketServer(const SocketServerConfig& config = {});
+    ~SocketServer() override;
+
+    // Server lifecycle
+    PipeServerError start() override;
+    void stop() override;
+
+    // Configuration
+    const SocketServerConfig& get_config() const noexcept { return config_; }
+
+protected:
+    json build_capabilities() const override;
+    bool admit_message(ClientConnection& client, const DecodedMessage& message) override;
+
+private:
+    // An AcceptEx kept posted on the listening socket
+    struct PendingAccept {
+        OVERLAPPED overlapped{};
+        SOCKET socket = INVALID_SOCKET;
+        char addresses[2 * (sizeof(SOCKADDR_STORAGE) + 16)]{};
+    };
+
+    SocketServerConfig config_;
+    bool winsock_started_ = false;
+    SOCKET listen_socket_ = INVALID_SOCKET;
+    int address_family_ = AF_INET;
+    LPFN_ACCEPTEX accept_ex_ = nullptr;
+    std::vector<std::unique_ptr<PendingAccept>> accepts_;
+
+    utils::HandleWrapper completion_port_{nullptr};
+    std::vector<std::thread> completion_threads_;
+    std::atomic<uint32_t> pending_io_{0};
+
+    // Server credentials, acquired once for every TLS connection
+    CredHandle credentials_{};
+    bool has_credentials_ = false;
+
+    PipeServerError open_listener();
+    bool acquire_credentials();
+    void completion_worker_loop();
+    void post_accept(PendingAccept& accept);
+    void handle_accept(PendingAccept& accept, DWORD error_code);
+    void begin_read(SocketConnection& client);
+    void handle_read_completion(SocketConnection& client, DWORD bytes_transferred, DWORD error_code);
+    void close_connection(SocketConnection& client);
+    void cancel_io();
+    void release_resources();
+};
+
+class SocketConnection : public ClientConnection {
+public:
+    SocketConnection(SOCKET socket, const std::string& connection_id, CredHandle* credentials);
+    ~SocketConnection() override;
+
+    SOCKET get_socket() const noexcept { return socket_; }
+    bool is_authorized() const noexcept { return authorized_.load(); }
+    void set_authorized() noexcept { authorized_.store(true); }
+
+    // Reads complete on the server's completion port
+    PipeServerError begin_read();
+    PipeServerError complete_read(DWORD bytes_transferred, DWORD error_code);
+
+protected:
+    PipeServerError write_bytes(std::span<const std::byte> data, std::chrono::milliseconds timeout) override;
+    void cancel_read() override;
+
+private:
+    SOCKET socket_;
+    std::atomic<bool> authorized_{false};
+    OVERLAPPED read_overlapped_{};
+
+    // TLS state; credentials_ is null on a plain TCP connection
+    CredHandle* credentials_;
+    CtxtHandle context_{};
+    bool has_context_ = false;
+    bool handshake_done_ = false;
+    SecPkgContext_StreamSizes stream_sizes_{};
+    std::vector<std::byte> tls_input_;      // Ciphertext received and not yet decrypted
+    size_t tls_input_size_ = 0;
+    std::vector<std::byte> tls_output_;     // Record being encrypted for a write
+    std::mutex tls_mutex_;                  // Decryption on a reader and encryption on a writer share the context
+
+    PipeServerError continue_handshake();
+    PipeServerError decrypt_received();
+    PipeServerError send_all(std::span<const std::byte> data);
+};
+
+} // namespace vibedbg::communication
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <Windows.h>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <shared_mutex>
+#include <span>
+#include <string>
+#include "handle_wrapper.h"
+
+namespace vibedbg::communication {
+
+// On-disk layout of a command trace, little-endian.
+//
+// A trace is a TraceFileHeader followed by records, each a TraceRecordHeader
+// and the request frame exactly as it was received, padded to 8 bytes. The
+// file is zero-filled ahead of the writer, so a record size of 0 marks the end;
+// a trace cut short by a crash still ends cleanly at its last complete record.
+struct TraceFileHeader {
+    char magic[8];                  // "VDBGTRC\0"
+    uint32_t version;
+    uint32_t header_size;           // sizeof(TraceFileHeader)
+    uint64_t start_time_us;         // Wall clock at the start, microseconds since the Unix epoch
+    uint64_t reserved;
+};
+
+struct TraceRecordHeader {
+    uint32_t record_size;           // Header, frame and padding
+    uint32_t request_size;          // Bytes of the request frame
+    uint64_t received_us;           // Since the start of the trace
+    uint64_t duration_us;           // Receipt to the final response written
+    uint64_t response_bytes;        // All response frames, chunks included
+    uint32_t chunk_count;
+    uint32_t connection;            // Hash of the connection id; groups one client's requests
+    uint8_t success;
+    uint8_t reserved[7];
+};
+
+static_assert(sizeof(TraceFileHeader) == 32);
+static_assert(sizeof(TraceRecordHeader) == 48);
+
+// What the server saw of one request, besides its frame
+struct TraceOutcome {
+    std::chrono::steady_clock::time_point received_at;
+    std::chrono::steady_clock::time_point completed_at;
+    uint64_t response_bytes = 0;
+    uint32_t chunk_count = 0;
+    uint32_t connection = 0;
+    bool success = false;
+};
+
+// Append-only writer of command traces.
+//
+// The file is mapped into memory and grown by doubling, so recording a
+// request is an atomic reservation and a copy into the mapping under a shared
+// lock; only the rare remap takes the lock exclusively. append() may be called
+// from any number of connection threads.
+class TraceRecorder {
+public:
+    static constexpr char MAGIC[8] = {'V', 'D', 'B', 'G', 'T', 'R', 'C', '\0'};
+    static constexpr uint32_t FORMAT_VERSION = 1;
+
+    TraceRecorder() = default;
+    ~TraceRecorder();
+
+    TraceRecorder(const TraceRecorder&) = delete;
+    TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+    bool is_open() const noexcept { return recording_.load(std::memory_order_acquire); }
+
+    void append(std::span<const std::byte> request_frame, const TraceOutcome& outcome);
+
+    uint64_t records() const noexcept { return records_.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr uint64_t INITIAL_CAPACITY = 16 * 1024 * 1024;
+
+    utils::HandleWrapper file_;
+    utils::HandleWrapper mapping_{nullptr};
+    std::byte* view_ = nullptr;
+    uint64_t capacity_ = 0;                     // Mapped bytes; guarded by mapping_mutex_
+    std::shared_mutex mapping_mutex_;
+    std::atomic<uint64_t> end_{0};              // Next free offset
+    std::atomic<uint64_t> records_{0};
+    std::atomic<bool> recording_{false};
+    std::chrono::steady_clock::time_point start_;
+
+    bool map(uint64_t capacity);
+    void unmap() noexcept;
+};
+
+// One record of a trace; request points into the reader's mapping
+struct TraceEntry {
+    TraceRecordHeader header;
+    std::span<const std::byte> request;
+};
+
+// Sequential reader of a trace written by TraceRecorder
+class TraceReader {
+public:
+    TraceReader() = default;
+    ~TraceReader();
+
+    TraceReader(const TraceReader&) = delete;
+    TraceReader& operator=(const TraceReader&) = delete;
+
+    bool open(const std::string& path, std::string* error = nullptr);
+    const TraceFileHeader& header() const noexcept { return header_; }
+
+    // Returns std::nullopt at the end of the trace or at a damaged record
+    std::optional<TraceEntry> next();
+
+private:
+    utils::HandleWrapper file_;
+    utils::HandleWrapper mapping_{nullptr};
+    const std::byte* view_ = nullptr;
+    uint64_t size_ = 0;
+    uint64_t position_ = 0;
+    TraceFileHeader header_{};
+};
+
+} // namespace vibedbg::communication
@@ -0,0 +1,318 @@
+#pragma once
+
+#include <Windows.h>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <span>
+#include <optional>
+#include <chrono>
+#include "message_protocol.h"
+#include "message_framer.h"
+#include "request_tracing.h"
+#include "trace_recorder.h"
+
+namespace vibedbg::communication {
+
+class ClientConnection;
+
+enum class PipeServerError : uint32_t {
+    None = 0,
+    CreationFailed = 1,
+    ConnectionFailed = 2,
+    ReadFailed = 3,
+    WriteFailed = 4,
+    Timeout = 5,
+    Disconnected = 6
+};
+
+// Settings every transport shares; each transport's config extends them
+struct TransportConfig {
+    uint32_t max_connections = 10;   // Connections past this are answered Busy and closed
+    std::chrono::milliseconds read_timeout{30000};
+    std::chrono::milliseconds write_timeout{5000};
+    std::string trace_path;          // Record every command to this file when set
+    uint32_t max_pending_events = 256; // Events queued per subscriber before the oldest are dropped
+    uint32_t max_in_flight = 8;      // Requests a connection may have outstanding; 1 answers them in order
+    uint32_t request_threads = 16;   // Worker pool running the requests of every connection
+    uint32_t max_queued_requests = 64; // Requests waiting for a worker, across connections, before new ones are refused
+    uint32_t max_engine_queue = 128; // Engine jobs waiting before new requests are refused; 0 for no limit
+};
+
+/**
+ * @class TransportServer
+ * @brief Everything a transport does once bytes have arrived.
+ *
+ * A transport accepts connections and moves bytes; this base splits them
+ * into frames, answers heartbeats and subscriptions, runs commands through
+ * the message handler on its request workers, and pushes events. The named
+ * pipe and the socket transport both derive from it, so a client sees the
+ * same protocol on either.
+ */
+class TransportServer {
+public:
+    // Sends one chunk of a streamed response; returns false once the client is gone
+    using ChunkWriter = std::function<bool(std::string_view chunk)>;
+    // write_chunk is empty unless the request asked for a streamed response
+    using MessageHandler = std::function<CommandResponse(const CommandRequest&, const ChunkWriter& write_chunk, ErrorCode* error)>;
+
+    explicit TransportServer(const TransportConfig& config);
+    virtual ~TransportServer();
+
+    TransportServer(const TransportServer&) = delete;
+    TransportServer& operator=(const TransportServer&) = delete;
+
+    // Server lifecycle
+    virtual PipeServerError start() = 0;
+    virtual void stop() = 0;
+    bool is_running() const noexcept { return running_.load(); }
+
+    // Message handling; set before start()
+    void set_message_handler(MessageHandler handler) { message_handler_ = std::move(handler); }
+
+    // Engine jobs waiting to run, checked against max_engine_queue before a
+    // request is admitted; set before start()
+    using LoadProbe = std::function<size_t()>;
+    void set_load_probe(LoadProbe probe) { load_probe_ = std::move(probe); }
+
+    // Server-push events; the data is only built if a connection subscribed
+    // to the kind. Never waits on I/O, so engine callbacks can publish.
+    using EventBuilder = std::function<json()>;
+    void publish_event(EventKind kind, const EventBuilder& build_data);
+
+    // Statistics and monitoring
+    struct ServerStats {
+        uint64_t total_connections = 0;
+        uint64_t active_connections = 0;
+        uint64_t total_messages_processed = 0;
+        uint64_t total_errors = 0;
+        uint64_t rejected_requests = 0;      // Answered Busy by admission control
+        uint64_t rejected_connections = 0;   // Refused past max_connections
+        uint64_t queued_requests = 0;        // Waiting for a request worker now
+        std::chrono::milliseconds retry_after{0}; // Hint a refused request would carry now
+        std::chrono::time_point<std::chrono::steady_clock> start_time;
+        std::chrono::milliseconds uptime{0};
+    };
+
+    ServerStats get_stats() const;
+    std::vector<std::string> get_active_connection_ids() const;
+
+protected:
+    TransportConfig transport_config_;
+    std::atomic<bool> running_{false};
+    MessageHandler message_handler_;
+    LoadProbe load_probe_;
+
+    // Connection management
+    mutable std::shared_mutex connections_mutex_;
+    std::vector<std::shared_ptr<ClientConnection>> connections_;
+
+    // Statistics are counted in the metrics registry
+    std::atomic<std::chrono::steady_clock::rep> start_time_{0};
+
+    // Commands are recorded for replay when the trace path is set
+    TraceRecorder trace_recorder_;
+
+    // Started by the transport's start() once running_ is set, stopped by
+    // its stop(): events first, workers once no connection reads frames
+    void start_workers();
+    void stop_events();
+    void stop_workers();
+
+    void add_connection(std::shared_ptr<ClientConnection> connection);
+    void cleanup_disconnected_connections();
+
+    // Message processing, shared by every transport
+    PipeServerError process_buffered_messages(ClientConnection& client);
+    virtual json build_capabilities() const;
+
+    // A transport may refuse a message before it is answered, as the socket
+    // transport does until a connection has authenticated
+    virtual bool admit_message(ClientConnection& client, const DecodedMessage& message);
+
+    void update_stats_on_error();
+    void update_stats_on_message();
+    void update_stats_on_connection();
+    void update_stats_on_disconnection();
+
+private:
+    // Bounds of the retry hint sent with a Busy error
+    static constexpr std::chrono::milliseconds MIN_RETRY_AFTER{50};
+    static constexpr std::chrono::milliseconds MAX_RETRY_AFTER{5000};
+
+    // Commands run on a worker pool, so a connection's later requests are
+    // read and answered while an earlier one is still running
+    std::vector<std::thread> request_threads_;
+    mutable std::mutex request_mutex_;
+    std::condition_variable request_cv_;
+    std::deque<std::function<void()>> request_queue_;
+    bool requests_stopping_{false};
+    std::atomic<int64_t> average_request_us_{0}; // Moving average of answered requests, for the retry hint
+
+    // Pushed events are written by a thread of their own, never the publisher's
+    std::thread event_thread_;
+    std::mutex event_mutex_;
+    std::condition_variable event_cv_;
+    bool events_pending_{false};
+    std::atomic<uint32_t> subscribed_events_{0}; // EventKind bits any connection subscribed to
+
+    PipeServerError dispatch_message(ClientConnection& client, std::span<const std::byte> message_data);
+    PipeServerError answer_heartbeat(ClientConnection& client, const DecodedMessage& message);
+    PipeServerError answer_subscribe(ClientConnection& client, const DecodedMessage& message);
+    PipeServerError answer_command(ClientConnection& client, const CommandRequest& request, const WireFormat& format,
+                                   std::chrono::steady_clock::time_point received_at, std::span<const std::byte> message_data);
+    CommandResponse handle_command(const CommandRequest& request, const ChunkWriter& write_chunk, ErrorCode* error = nullptr);
+
+    // Admission control: a refused request is answered Busy with a retry hint
+    PipeServerError refuse_busy(ClientConnection& client, const std::string& request_id, std::string_view reason,
+                                size_t depth, size_t limit);
+    std::chrono::milliseconds retry_after(size_t depth) const;
+    void record_request_time(std::chrono::steady_clock::duration elapsed);
+
+    // Request pool; a job is refused once max_queued_requests are waiting
+    void request_worker_loop();
+    bool try_submit_request(std::function<void()> job, size_t* depth);
+    size_t queued_request_count() const;
+    void stop_request_workers();
+
+    // Pushed events
+    void event_writer_loop();
+    void write_events(ClientConnection& client);
+    void update_subscribed_events();
+};
+
+/**
+ * @class ClientConnection
+ * @brief One client's stream of frames, whatever carries it.
+ *
+ * Holds the framer, the wire format, the request slots and the pushed
+ * events. A transport's connection feeds received bytes into the framer and
+ * implements write_bytes; writes are serialized here.
+ */
+class ClientConnection : public std::enable_shared_from_this<ClientConnection> {
+public:
+    virtual ~ClientConnection();
+
+    ClientConnection(const ClientConnection&) = delete;
+    ClientConnection& operator=(const ClientConnection&) = delete;
+
+    // Connection management. A connection stays active, and listed, until
+    // its read path has given up and no read is outstanding; only then may
+    // it be erased. Any other thread that finds the connection broken asks
+    // the read path to close it instead.
+    bool is_active() const noexcept { return active_.load(); }
+    bool is_open() const noexcept { return active_.load() && !closing_.load(); }
+    void mark_inactive();
+    void request_close();
+    const std::string& get_id() const noexcept { return connection_id_; }
+
+    // Reference a posted read holds, so the connection outlives its
+    // completion; taken before the read is posted, released once it completed
+    void hold_for_read() { read_hold_ = shared_from_this(); }
+    std::shared_ptr<ClientConnection> release_read_hold() noexcept { return std::move(read_hold_); }
+
+    // Message I/O
+    std::optional<std::span<const std::byte>> next_message(ErrorCode* error = nullptr);
+
+    // Trace of the frame last returned by next_message, from its first bytes
+    utils::TraceActivity take_read_activity() noexcept { return std::move(completed_read_); }
+
+    PipeServerError write_message(std::span<const std::byte> data, std::chrono::milliseconds timeout);
+
+    // Wire format last used by the client; server-initiated messages use it too
+    WireFormat get_wire_format() const noexcept { return wire_format_.load(); }
+    void set_wire_format(const WireFormat& format) noexcept { wire_format_.store(format); }
+
+    // Requests outstanding on the connection; begin fails at once while
+    // max_in_flight are, and once the connection is gone
+    bool try_begin_request(uint32_t max_in_flight);
+    void end_request();
+
+    // Set on a connection accepted past max_connections; its first frame is answered Busy
+    void set_refused() noexcept { refused_.store(true); }
+    bool is_refused() const noexcept { return refused_.load(); }
+
+    // Event subscription; events wait here until the event thread writes them
+    void subscribe(uint32_t kinds, const WireFormat& format);
+    uint32_t get_subscriptions() const noexcept { return subscriptions_.load(); }
+    void queue_event(EventMessage event, size_t max_pending);
+    std::vector<EventMessage> take_events(WireFormat* format);
+
+    // Statistics
+    struct ConnectionStats {
+        std::chrono::time_point<std::chrono::steady_clock> connection_time;
+        uint64_t messages_received = 0;
+        uint64_t messages_sent = 0;
+        uint64_t bytes_received = 0;
+        uint64_t bytes_sent = 0;
+        std::chrono::time_point<std::chrono::steady_clock> last_activity;
+    };
+
+    ConnectionStats get_stats() const noexcept;
+
+protected:
+    explicit ClientConnection(const std::string& connection_id);
+
+    std::atomic<bool> active_{true};
+    std::atomic<bool> closing_{false};      // Set by request_close; the read path then closes the connection
+
+    // Cancels the outstanding read, if any, so its completion closes the
+    // connection; safe from any thread. Nothing to cancel by default
+    virtual void cancel_read() {}
+
+    // Received bytes, split into frames as they arrive
+    MessageFramer framer_;
+    static constexpr size_t READ_CHUNK_SIZE = 64 * 1024;
+
+    // Writes one frame's bytes; called with the write lock held on an active connection
+    virtual PipeServerError write_bytes(std::span<const std::byte> data, std::chrono::milliseconds timeout) = 0;
+
+    // Bytes received into framer_.prepare(), or copied in by append_received
+    void commit_received(size_t bytes_read);
+    void append_received(std::span<const std::byte> data);
+
+private:
+    std::string connection_id_;
+    std::atomic<WireFormat> wire_format_{WireFormat{}};
+    std::mutex write_mutex_;                // Responses and pushed events share the stream
+    std::shared_ptr<ClientConnection> read_hold_;
+
+    // Requests handed to the pool and not yet answered
+    std::mutex requests_mutex_;
+    uint32_t requests_in_flight_ = 0;
+    std::atomic<bool> refused_{false};
+
+    // Pushed events; a state change replaces one still pending, and the
+    // oldest events are dropped when the client falls max_pending behind
+    std::atomic<uint32_t> subscriptions_{0};
+    std::mutex events_mutex_;
+    std::deque<EventMessage> pending_events_;
+    WireFormat event_format_;               // Format of the subscribe message
+    uint64_t events_delivered_ = 0;
+    uint64_t events_dropped_ = 0;           // Since the last event taken
+
+    utils::TraceActivity read_activity_;    // Frame currently arriving
+    utils::TraceActivity completed_read_;   // Frame last returned by next_message
+
+    // Statistics; single atomics, as only this connection's threads update them
+    std::chrono::steady_clock::time_point connection_time_;
+    std::atomic<uint64_t> messages_received_{0};
+    std::atomic<uint64_t> messages_sent_{0};
+    std::atomic<uint64_t> bytes_received_{0};
+    std::atomic<uint64_t> bytes_sent_{0};
+    std::atomic<std::chrono::steady_clock::rep> last_activity_{0};
+
+    void update_read_stats(size_t bytes_read);
+    void update_write_stats(size_t bytes_written);
+};
+
+std::string generate_connection_id();
+
+} // namespace vibedbg::communication
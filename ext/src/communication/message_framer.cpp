@@ -0,0 +1,172 @@
+#include "pch.h"
+#include "../../inc/message_framer.h"
+#include <cstring>
+#include <string_view>
+
+using namespace vibedbg::communication;
+
+/**
+ * @brief Constructs a framer with the given initial buffer capacity.
+ *
+ * @param[in] initial_capacity Initial size of the receive buffer in bytes
+ * @param[in] max_frame_size Largest frame accepted before the stream is rejected
+ */
+MessageFramer::MessageFramer(_In_ size_t initial_capacity, _In_ size_t max_frame_size)
+    : buffer_(initial_capacity)
+    , max_frame_size_(max_frame_size) {
+}
+
+/**
+ * @brief Returns writable space at the end of the buffer.
+ *
+ * The caller reads directly into the returned span and then calls commit()
+ * with the number of bytes actually written. Spans previously returned by
+ * next_frame() are invalidated.
+ *
+ * @param[in] min_size Minimum number of writable bytes required
+ *
+ * @return Span covering at least min_size writable bytes
+ */
+std::span<std::byte> MessageFramer::prepare(_In_ size_t min_size) {
+    make_room(min_size);
+    return std::span<std::byte>(buffer_.data() + write_pos_, buffer_.size() - write_pos_);
+}
+
+/**
+ * @brief Marks bytes written into the span from prepare() as received.
+ *
+ * @param[in] bytes_written Number of bytes placed in the prepared span
+ */
+void MessageFramer::commit(_In_ size_t bytes_written) {
+    write_pos_ += (std::min)(bytes_written, buffer_.size() - write_pos_);
+}
+
+/**
+ * @brief Copies received bytes into the framer.
+ *
+ * @param[in] data Bytes to append
+ */
+void MessageFramer::append(_In_ std::span<const std::byte> data) {
+    if (data.empty()) {
+        return;
+    }
+
+    auto destination = prepare(data.size());
+    std::memcpy(destination.data(), data.data(), data.size());
+    commit(data.size());
+}
+
+/**
+ * @brief Extracts the next complete frame, if one has been received.
+ *
+ * Protocol v2 frames are recognised by their magic and sized from the
+ * header. Otherwise the returned view runs up to and including the trailing
+ * MESSAGE_DELIMITER; when no complete frame is buffered the scan position is
+ * remembered so the next call only examines newly received bytes.
+ *
+ * @param[out] error Optional pointer to receive error information; set to
+ *                   ErrorCode::InvalidMessage if a frame exceeds the size limit
+ *
+ * @return View of the complete frame, or std::nullopt if more data is needed
+ */
+std::optional<std::span<const std::byte>> MessageFramer::next_frame(_Out_opt_ ErrorCode* error) {
+    if (error) *error = ErrorCode::None;
+
+    constexpr std::string_view delimiter = MessageProtocol::MESSAGE_DELIMITER;
+
+    if (write_pos_ == read_pos_) {
+        return std::nullopt;
+    }
+
+    std::span<const std::byte> buffered(buffer_.data() + read_pos_, write_pos_ - read_pos_);
+
+    // Protocol v2 frames announce their length up front
+    if (buffered.front() == static_cast<std::byte>(MessageProtocol::FRAME_MAGIC & 0xFF)) {
+        if (buffered.size() < MessageProtocol::FRAME_HEADER_SIZE) {
+            return std::nullopt;
+        }
+        if (auto header = MessageProtocol::read_frame_header(buffered)) {
+            if (header->length > max_frame_size_) {
+                if (error) *error = ErrorCode::InvalidMessage;
+                return std::nullopt;
+            }
+
+            size_t frame_size = MessageProtocol::FRAME_HEADER_SIZE + header->length;
+            if (buffered.size() < frame_size) {
+                return std::nullopt;
+            }
+
+            std::span<const std::byte> frame = buffered.first(frame_size);
+            read_pos_ += frame_size;
+            scan_pos_ = read_pos_;
+            return frame;
+        }
+    }
+
+    const char* base = reinterpret_cast<const char*>(buffer_.data());
+    std::string_view pending(base + read_pos_, write_pos_ - read_pos_);
+    size_t offset = pending.find(delimiter, scan_pos_ > read_pos_ ? scan_pos_ - read_pos_ : 0);
+
+    if (offset == std::string_view::npos) {
+        // Keep the last delimiter.size() - 1 bytes in the search window in
+        // case the delimiter straddles two reads.
+        size_t keep = delimiter.size() - 1;
+        scan_pos_ = pending.size() > keep ? write_pos_ - keep : read_pos_;
+
+        if (pending.size() > max_frame_size_) {
+            if (error) *error = ErrorCode::InvalidMessage;
+        }
+        return std::nullopt;
+    }
+
+    size_t frame_size = offset + delimiter.size();
+    if (frame_size > max_frame_size_ + delimiter.size()) {
+        if (error) *error = ErrorCode::InvalidMessage;
+        return std::nullopt;
+    }
+
+    std::span<const std::byte> frame(buffer_.data() + read_pos_, frame_size);
+    read_pos_ += frame_size;
+    scan_pos_ = read_pos_;
+    return frame;
+}
+
+/**
+ * @brief Discards all buffered data.
+ */
+void MessageFramer::reset() noexcept {
+    read_pos_ = 0;
+    write_pos_ = 0;
+    scan_pos_ = 0;
+}
+
+/**
+ * @brief Ensures at least min_size bytes are writable after write_pos_.
+ *
+ * Consumed frames are reclaimed first by sliding the unconsumed tail to the
+ * front of the buffer; the buffer only grows when the pending partial frame
+ * itself needs the space.
+ *
+ * @param[in] min_size Minimum number of writable bytes required
+ */
+void MessageFramer::make_room(_In_ size_t min_size) {
+    if (read_pos_ == write_pos_) {
+        reset();
+    }
+
+    if (buffer_.size() - write_pos_ >= min_size) {
+        return;
+    }
+
+    if (read_pos_ > 0) {
+        size_t pending = write_pos_ - read_pos_;
+        std::memmove(buffer_.data(), buffer_.data() + read_pos_, pending);
+        scan_pos_ -= read_pos_;
+        write_pos_ = pending;
+        read_pos_ = 0;
+    }
+
+    if (buffer_.size() - write_pos_ < min_size) {
+        buffer_.resize((std::max)(buffer_.size() * 2, write_pos_ + min_size));
+    }
+}
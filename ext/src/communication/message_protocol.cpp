@@ -4,11 +4,34 @@
 #include <random>
 #include <iomanip>
 #include <sstream>
+#include <cstring>
 
 using namespace vibedbg::communication;
 using json = nlohmann::json;
 
+namespace {
+
+constexpr WireFormat kLegacyFormat{MessageProtocol::PROTOCOL_VERSION_V1};
+
+int64_t to_epoch_ms(std::chrono::time_point<std::chrono::steady_clock> timestamp) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(timestamp.time_since_epoch()).count();
+}
+
+std::chrono::time_point<std::chrono::steady_clock> timestamp_from(const json& payload) {
+    if (payload.contains("timestamp")) {
+        auto timestamp_ms = std::chrono::milliseconds(payload["timestamp"].get<int64_t>());
+        return std::chrono::steady_clock::time_point(timestamp_ms);
+    }
+    return std::chrono::steady_clock::now();
+}
+
+} // namespace
+
 std::vector<std::byte> MessageProtocol::serialize_command(const CommandRequest& request, ErrorCode* error) {
+    return serialize_command(request, kLegacyFormat, error);
+}
+
+std::vector<std::byte> MessageProtocol::serialize_command(const CommandRequest& request, const WireFormat& format, ErrorCode* error) {
     try {
         json message_json = {
             {"type", "command"},
@@ -16,28 +39,18 @@ std::vector<std::byte> MessageProtocol::serialize_command(const CommandRequest&
             {"command", request.command},
             {"parameters", request.parameters},
             {"timeout_ms", request.timeout.count()},
-            {"timestamp", std::chrono::duration_cast<std::chrono::milliseconds>(
-                request.timestamp.time_since_epoch()).count()}
-        };
-        
-        json full_message = {
-            {"protocol_version", PROTOCOL_VERSION},
-            {"message_type", static_cast<uint8_t>(MessageType::Command)},
-            {"payload", message_json}
+            {"timestamp", to_epoch_ms(request.timestamp)}
         };
         
-        std::string json_str = full_message.dump();
-        std::vector<std::byte> result;
-        result.reserve(json_str.size() + MESSAGE_DELIMITER.size());
-        
-        std::transform(json_str.begin(), json_str.end(), std::back_inserter(result),
-                      [](char c) { return static_cast<std::byte>(c); });
+        if (request.stream) {
+            message_json["stream"] = true;
+        }
         
-        // Add delimiter
-        for (char c : MESSAGE_DELIMITER) {
-            result.push_back(static_cast<std::byte>(c));
+        if (!request.session_id.empty()) {
+            message_json["session_id"] = request.session_id;
         }
         
+        auto result = frame_message(MessageType::Command, message_json, format);
         if (error) *error = ErrorCode::None;
         return result;
     } catch (...) {
@@ -47,35 +60,38 @@ std::vector<std::byte> MessageProtocol::serialize_command(const CommandRequest&
 }
 
 std::vector<std::byte> MessageProtocol::serialize_response(const CommandResponse& response, ErrorCode* error) {
+    return serialize_response(response, kLegacyFormat, error);
+}
+
+std::vector<std::byte> MessageProtocol::serialize_response(const CommandResponse& response, const WireFormat& format, ErrorCode* error) {
     try {
         json message_json = {
             {"type", "response"},
             {"request_id", response.request_id},
             {"success", response.success},
-            {"output", response.output},
             {"error_message", response.error_message},
             {"execution_time_ms", response.execution_time.count()},
             {"session_data", response.session_data},
-            {"timestamp", std::chrono::duration_cast<std::chrono::milliseconds>(
-                response.timestamp.time_since_epoch()).count()}
+            {"sequence", response.sequence},
+            {"final", response.final},
+            {"timestamp", to_epoch_ms(response.timestamp)}
         };
         
-        json full_message = {
-            {"protocol_version", PROTOCOL_VERSION},
-            {"message_type", static_cast<uint8_t>(MessageType::Response)},
-            {"payload", message_json}
-        };
+        if (!response.data.is_null()) {
+            message_json["data"] = response.data;
+        }
         
-        std::string json_str = full_message.dump();
         std::vector<std::byte> result;
-        result.reserve(json_str.size() + MESSAGE_DELIMITER.size());
-        
-        std::transform(json_str.begin(), json_str.end(), std::back_inserter(result),
-                      [](char c) { return static_cast<std::byte>(c); });
-        
-        // Add delimiter
-        for (char c : MESSAGE_DELIMITER) {
-            result.push_back(static_cast<std::byte>(c));
+        if (format.version >= PROTOCOL_VERSION_V2) {
+            // Output travels after the envelope as raw bytes, without JSON escaping
+            uint16_t flags = static_cast<uint16_t>(FrameFlags::RawBody);
+            if (!response.final) {
+                flags |= static_cast<uint16_t>(FrameFlags::Partial);
+            }
+            result = frame_message(MessageType::Response, message_json, format, flags, response.output);
+        } else {
+            message_json["output"] = response.output;
+            result = frame_message(MessageType::Response, message_json, format);
         }
         
         if (error) *error = ErrorCode::None;
@@ -87,6 +103,10 @@ std::vector<std::byte> MessageProtocol::serialize_response(const CommandResponse
 }
 
 std::vector<std::byte> MessageProtocol::serialize_error(const ErrorMessage& error_msg, ErrorCode* error) {
+    return serialize_error(error_msg, kLegacyFormat, error);
+}
+
+std::vector<std::byte> MessageProtocol::serialize_error(const ErrorMessage& error_msg, const WireFormat& format, ErrorCode* error) {
     try {
         json message_json = {
             {"type", "error"},
@@ -95,32 +115,14 @@ std::vector<std::byte> MessageProtocol::serialize_error(const ErrorMessage& erro
             {"error_message", error_msg.error_message},
             {"suggestion", error_msg.suggestion},
             {"details", error_msg.details},
-            {"timestamp", std::chrono::duration_cast<std::chrono::milliseconds>(
-                error_msg.timestamp.time_since_epoch()).count()}
+            {"timestamp", to_epoch_ms(error_msg.timestamp)}
         };
         
         if (error_msg.request_id) {
             message_json["request_id"] = *error_msg.request_id;
         }
         
-        json full_message = {
-            {"protocol_version", PROTOCOL_VERSION},
-            {"message_type", static_cast<uint8_t>(MessageType::Error)},
-            {"payload", message_json}
-        };
-        
-        std::string json_str = full_message.dump();
-        std::vector<std::byte> result;
-        result.reserve(json_str.size() + MESSAGE_DELIMITER.size());
-        
-        std::transform(json_str.begin(), json_str.end(), std::back_inserter(result),
-                      [](char c) { return static_cast<std::byte>(c); });
-        
-        // Add delimiter
-        for (char c : MESSAGE_DELIMITER) {
-            result.push_back(static_cast<std::byte>(c));
-        }
-        
+        auto result = frame_message(MessageType::Error, message_json, format);
         if (error) *error = ErrorCode::None;
         return result;
     } catch (...) {
@@ -130,32 +132,45 @@ std::vector<std::byte> MessageProtocol::serialize_error(const ErrorMessage& erro
 }
 
 std::vector<std::byte> MessageProtocol::serialize_heartbeat(const HeartbeatMessage& heartbeat, ErrorCode* error) {
+    return serialize_heartbeat(heartbeat, kLegacyFormat, error);
+}
+
+std::vector<std::byte> MessageProtocol::serialize_heartbeat(const HeartbeatMessage& heartbeat, const WireFormat& format, ErrorCode* error) {
     try {
         json message_json = {
             {"type", "heartbeat"},
             {"session_info", heartbeat.session_info},
-            {"timestamp", std::chrono::duration_cast<std::chrono::milliseconds>(
-                heartbeat.timestamp.time_since_epoch()).count()}
+            {"timestamp", to_epoch_ms(heartbeat.timestamp)}
         };
         
-        json full_message = {
-            {"protocol_version", PROTOCOL_VERSION},
-            {"message_type", static_cast<uint8_t>(MessageType::Heartbeat)},
-            {"payload", message_json}
+        auto result = frame_message(MessageType::Heartbeat, message_json, format);
+        if (error) *error = ErrorCode::None;
+        return result;
+    } catch (...) {
+        if (error) *error = ErrorCode::InvalidMessage;
+        return {};
+    }
+}
+
+std::vector<std::byte> MessageProtocol::serialize_event(const EventMessage& event, const WireFormat& format, ErrorCode* error) {
+    try {
+        json message_json = {
+            {"type", "event"},
+            {"event", event_name(event.kind)},
+            {"data", event.data},
+            {"sequence", event.sequence},
+            {"timestamp", to_epoch_ms(event.timestamp)}
         };
         
-        std::string json_str = full_message.dump();
-        std::vector<std::byte> result;
-        result.reserve(json_str.size() + MESSAGE_DELIMITER.size());
-        
-        std::transform(json_str.begin(), json_str.end(), std::back_inserter(result),
-                      [](char c) { return static_cast<std::byte>(c); });
+        if (event.coalesced > 0) {
+            message_json["coalesced"] = event.coalesced;
+        }
         
-        // Add delimiter
-        for (char c : MESSAGE_DELIMITER) {
-            result.push_back(static_cast<std::byte>(c));
+        if (event.dropped > 0) {
+            message_json["dropped"] = event.dropped;
         }
         
+        auto result = frame_message(MessageType::Event, message_json, format);
         if (error) *error = ErrorCode::None;
         return result;
     } catch (...) {
@@ -164,15 +179,53 @@ std::vector<std::byte> MessageProtocol::serialize_heartbeat(const HeartbeatMessa
     }
 }
 
-CommandRequest MessageProtocol::parse_command(std::span<const std::byte> data, ErrorCode* error) {
-    CommandRequest request;
+DecodedMessage MessageProtocol::decode_message(std::span<const std::byte> data, ErrorCode* error) {
+    DecodedMessage message;
     
     try {
-        ErrorCode json_error;
+        if (auto header = read_frame_header(data)) {
+            if (header->version != PROTOCOL_VERSION_V2 ||
+                data.size() != FRAME_HEADER_SIZE + header->length) {
+                if (error) *error = ErrorCode::InvalidMessage;
+                return message;
+            }
+            
+            message.format.version = header->version;
+            message.format.encoding = static_cast<PayloadEncoding>(
+                (header->flags & static_cast<uint16_t>(FrameFlags::EncodingMask)) >>
+                ENCODING_FLAG_SHIFT);
+            message.type = static_cast<MessageType>(header->type);
+            message.flags = header->flags;
+            
+            auto body = data.subspan(FRAME_HEADER_SIZE);
+            auto envelope = body;
+            
+            if (header->flags & static_cast<uint16_t>(FrameFlags::RawBody)) {
+                uint32_t envelope_size = 0;
+                if (body.size() < sizeof(envelope_size)) {
+                    if (error) *error = ErrorCode::InvalidMessage;
+                    return message;
+                }
+                std::memcpy(&envelope_size, body.data(), sizeof(envelope_size));
+                if (body.size() - sizeof(envelope_size) < envelope_size) {
+                    if (error) *error = ErrorCode::InvalidMessage;
+                    return message;
+                }
+                envelope = body.subspan(sizeof(envelope_size), envelope_size);
+                message.raw_body = body.subspan(sizeof(envelope_size) + envelope_size);
+            }
+            
+            ErrorCode json_error = ErrorCode::None;
+            message.payload = decode_envelope(envelope, message.format.encoding, &json_error);
+            if (error) *error = json_error;
+            return message;
+        }
+        
+        ErrorCode json_error = ErrorCode::None;
         auto parsed_json = bytes_to_json(data, &json_error);
         if (json_error != ErrorCode::None) {
             if (error) *error = json_error;
-            return request;
+            return message;
         }
         
         // Validate message structure
@@ -180,10 +233,36 @@ CommandRequest MessageProtocol::parse_command(std::span<const std::byte> data, E
             !parsed_json.contains("message_type") || 
             !parsed_json.contains("payload")) {
             if (error) *error = ErrorCode::InvalidMessage;
-            return request;
+            return message;
         }
         
-        auto& payload = parsed_json["payload"];
+        message.format.version = PROTOCOL_VERSION_V1;
+        message.type = static_cast<MessageType>(parsed_json["message_type"].get<uint8_t>());
+        message.payload = std::move(parsed_json["payload"]);
+        
+        if (error) *error = ErrorCode::None;
+        return message;
+    } catch (...) {
+        if (error) *error = ErrorCode::InvalidMessage;
+        return message;
+    }
+}
+
+CommandRequest MessageProtocol::parse_command(std::span<const std::byte> data, ErrorCode* error) {
+    ErrorCode decode_error = ErrorCode::None;
+    DecodedMessage message = decode_message(data, &decode_error);
+    if (decode_error != ErrorCode::None) {
+        if (error) *error = decode_error;
+        return {};
+    }
+    return parse_command(message, error);
+}
+
+CommandRequest MessageProtocol::parse_command(const DecodedMessage& message, ErrorCode* error) {
+    CommandRequest request;
+    
+    try {
+        const auto& payload = message.payload;
         if (!payload.contains("request_id") || !payload.contains("command")) {
             if (error) *error = ErrorCode::InvalidMessage;
             return request;
@@ -201,13 +280,17 @@ CommandRequest MessageProtocol::parse_command(std::span<const std::byte> data, E
             request.timeout = std::chrono::milliseconds(payload["timeout_ms"]);
         }
         
-        if (payload.contains("timestamp")) {
-            auto timestamp_ms = std::chrono::milliseconds(payload["timestamp"]);
-            request.timestamp = std::chrono::steady_clock::time_point(timestamp_ms);
-        } else {
-            request.timestamp = std::chrono::steady_clock::now();
+        if (payload.contains("stream")) {
+            request.stream = payload["stream"];
         }
         
+        if (payload.contains("session_id")) {
+            request.session_id = payload["session_id"];
+        }
+        
+        request.protocol_version = message.format.version;
+        request.timestamp = timestamp_from(payload);
+        
         if (error) *error = ErrorCode::None;
         return request;
     } catch (...) {
@@ -220,20 +303,14 @@ CommandResponse MessageProtocol::parse_response(std::span<const std::byte> data,
     CommandResponse response;
     
     try {
-        ErrorCode json_error;
-        auto parsed_json = bytes_to_json(data, &json_error);
-        if (json_error != ErrorCode::None) {
-            if (error) *error = json_error;
+        ErrorCode decode_error = ErrorCode::None;
+        DecodedMessage message = decode_message(data, &decode_error);
+        if (decode_error != ErrorCode::None) {
+            if (error) *error = decode_error;
             return response;
         }
         
-        // Validate message structure
-        if (!parsed_json.contains("payload")) {
-            if (error) *error = ErrorCode::InvalidMessage;
-            return response;
-        }
-        
-        auto& payload = parsed_json["payload"];
+        const auto& payload = message.payload;
         
         // Extract data
         if (payload.contains("request_id")) {
@@ -244,7 +321,10 @@ CommandResponse MessageProtocol::parse_response(std::span<const std::byte> data,
             response.success = payload["success"];
         }
         
-        if (payload.contains("output")) {
+        if (message.flags & static_cast<uint16_t>(FrameFlags::RawBody)) {
+            response.output.assign(reinterpret_cast<const char*>(message.raw_body.data()),
+                                   message.raw_body.size());
+        } else if (payload.contains("output")) {
             response.output = payload["output"];
         }
         
@@ -260,13 +340,20 @@ CommandResponse MessageProtocol::parse_response(std::span<const std::byte> data,
             response.session_data = payload["session_data"];
         }
         
-        if (payload.contains("timestamp")) {
-            auto timestamp_ms = std::chrono::milliseconds(payload["timestamp"]);
-            response.timestamp = std::chrono::steady_clock::time_point(timestamp_ms);
-        } else {
-            response.timestamp = std::chrono::steady_clock::now();
+        if (payload.contains("data")) {
+            response.data = payload["data"];
+        }
+        
+        if (payload.contains("sequence")) {
+            response.sequence = payload["sequence"];
+        }
+        
+        if (payload.contains("final")) {
+            response.final = payload["final"];
         }
         
+        response.timestamp = timestamp_from(payload);
+        
         if (error) *error = ErrorCode::None;
         return response;
     } catch (...) {
@@ -279,20 +366,14 @@ ErrorMessage MessageProtocol::parse_error(std::span<const std::byte> data, Error
     ErrorMessage error_message;
     
     try {
-        ErrorCode json_error;
-        auto parsed_json = bytes_to_json(data, &json_error);
-        if (json_error != ErrorCode::None) {
-            if (error) *error = json_error;
+        ErrorCode decode_error = ErrorCode::None;
+        DecodedMessage message = decode_message(data, &decode_error);
+        if (decode_error != ErrorCode::None) {
+            if (error) *error = decode_error;
             return error_message;
         }
         
-        // Validate message structure
-        if (!parsed_json.contains("payload")) {
-            if (error) *error = ErrorCode::InvalidMessage;
-            return error_message;
-        }
-        
-        auto& payload = parsed_json["payload"];
+        const auto& payload = message.payload;
         
         // Extract data
         if (payload.contains("request_id")) {
@@ -319,12 +400,7 @@ ErrorMessage MessageProtocol::parse_error(std::span<const std::byte> data, Error
             error_message.details = payload["details"];
         }
         
-        if (payload.contains("timestamp")) {
-            auto timestamp_ms = std::chrono::milliseconds(payload["timestamp"]);
-            error_message.timestamp = std::chrono::steady_clock::time_point(timestamp_ms);
-        } else {
-            error_message.timestamp = std::chrono::steady_clock::now();
-        }
+        error_message.timestamp = timestamp_from(payload);
         
         if (error) *error = ErrorCode::None;
         return error_message;
@@ -335,35 +411,27 @@ ErrorMessage MessageProtocol::parse_error(std::span<const std::byte> data, Error
 }
 
 HeartbeatMessage MessageProtocol::parse_heartbeat(std::span<const std::byte> data, ErrorCode* error) {
+    ErrorCode decode_error = ErrorCode::None;
+    DecodedMessage message = decode_message(data, &decode_error);
+    if (decode_error != ErrorCode::None) {
+        if (error) *error = decode_error;
+        return {};
+    }
+    return parse_heartbeat(message, error);
+}
+
+HeartbeatMessage MessageProtocol::parse_heartbeat(const DecodedMessage& message, ErrorCode* error) {
     HeartbeatMessage heartbeat;
     
     try {
-        ErrorCode json_error;
-        auto parsed_json = bytes_to_json(data, &json_error);
-        if (json_error != ErrorCode::None) {
-            if (error) *error = json_error;
-            return heartbeat;
-        }
-        
-        // Validate message structure
-        if (!parsed_json.contains("payload")) {
-            if (error) *error = ErrorCode::InvalidMessage;
-            return heartbeat;
-        }
-        
-        auto& payload = parsed_json["payload"];
+        const auto& payload = message.payload;
         
         // Extract data
         if (payload.contains("session_info")) {
             heartbeat.session_info = payload["session_info"];
         }
         
-        if (payload.contains("timestamp")) {
-            auto timestamp_ms = std::chrono::milliseconds(payload["timestamp"]);
-            heartbeat.timestamp = std::chrono::steady_clock::time_point(timestamp_ms);
-        } else {
-            heartbeat.timestamp = std::chrono::steady_clock::now();
-        }
+        heartbeat.timestamp = timestamp_from(payload);
         
         if (error) *error = ErrorCode::None;
         return heartbeat;
@@ -373,22 +441,116 @@ HeartbeatMessage MessageProtocol::parse_heartbeat(std::span<const std::byte> dat
     }
 }
 
-MessageType MessageProtocol::get_message_type(std::span<const std::byte> data) {
+SubscribeRequest MessageProtocol::parse_subscribe(const DecodedMessage& message, ErrorCode* error) {
+    SubscribeRequest request;
+    
     try {
-        ErrorCode json_error;
-        auto parsed_json = bytes_to_json(data, &json_error);
-        if (json_error != ErrorCode::None) {
-            return static_cast<MessageType>(0); // Invalid type
+        const auto& payload = message.payload;
+        if (!payload.contains("events") || !payload["events"].is_array()) {
+            if (error) *error = ErrorCode::InvalidMessage;
+            return request;
         }
         
-        if (parsed_json.contains("message_type")) {
-            return static_cast<MessageType>(parsed_json["message_type"]);
+        if (payload.contains("request_id")) {
+            request.request_id = payload["request_id"];
         }
         
-        return static_cast<MessageType>(0); // Invalid type
+        for (const auto& name : payload["events"]) {
+            request.events.push_back(name.get<std::string>());
+        }
+        
+        request.timestamp = timestamp_from(payload);
+        
+        if (error) *error = ErrorCode::None;
+        return request;
     } catch (...) {
+        if (error) *error = ErrorCode::InvalidMessage;
+        return request;
+    }
+}
+
+MessageType MessageProtocol::get_message_type(std::span<const std::byte> data) {
+    if (auto header = read_frame_header(data)) {
+        return static_cast<MessageType>(header->type);
+    }
+    
+    ErrorCode decode_error = ErrorCode::None;
+    DecodedMessage message = decode_message(data, &decode_error);
+    if (decode_error != ErrorCode::None) {
         return static_cast<MessageType>(0); // Invalid type
     }
+    return message.type;
+}
+
+bool MessageProtocol::is_binary_frame(std::span<const std::byte> data) {
+    uint32_t magic = 0;
+    if (data.size() < sizeof(magic)) {
+        return false;
+    }
+    std::memcpy(&magic, data.data(), sizeof(magic));
+    return magic == FRAME_MAGIC;
+}
+
+std::string_view MessageProtocol::encoding_name(PayloadEncoding encoding) {
+    switch (encoding) {
+        case PayloadEncoding::MessagePack:
+            return "msgpack";
+        case PayloadEncoding::Cbor:
+            return "cbor";
+        case PayloadEncoding::Json:
+        default:
+            return "json";
+    }
+}
+
+std::optional<PayloadEncoding> MessageProtocol::parse_encoding_name(std::string_view name) {
+    if (name == "json") return PayloadEncoding::Json;
+    if (name == "msgpack") return PayloadEncoding::MessagePack;
+    if (name == "cbor") return PayloadEncoding::Cbor;
+    return std::nullopt;
+}
+
+std::string_view MessageProtocol::event_name(EventKind kind) {
+    switch (kind) {
+        case EventKind::Breakpoint:
+            return "breakpoint";
+        case EventKind::Exception:
+            return "exception";
+        case EventKind::ModuleLoad:
+            return "module_load";
+        case EventKind::ModuleUnload:
+            return "module_unload";
+        case EventKind::ProcessExit:
+            return "process_exit";
+        case EventKind::StateChange:
+            return "state_change";
+        case EventKind::SymbolLoad:
+            return "symbol_load";
+        case EventKind::None:
+        default:
+            return "none";
+    }
+}
+
+std::optional<EventKind> MessageProtocol::parse_event_name(std::string_view name) {
+    if (name == "breakpoint") return EventKind::Breakpoint;
+    if (name == "exception") return EventKind::Exception;
+    if (name == "module_load") return EventKind::ModuleLoad;
+    if (name == "module_unload") return EventKind::ModuleUnload;
+    if (name == "process_exit") return EventKind::ProcessExit;
+    if (name == "state_change") return EventKind::StateChange;
+    if (name == "symbol_load") return EventKind::SymbolLoad;
+    return std::nullopt;
+}
+
+std::optional<FrameHeader> MessageProtocol::read_frame_header(std::span<const std::byte> data) {
+    if (data.size() < FRAME_HEADER_SIZE || !is_binary_frame(data)) {
+        return std::nullopt;
+    }
+    
+    FrameHeader header{};
+    std::memcpy(&header, data.data(), FRAME_HEADER_SIZE);
+    return header;
 }
 
 bool MessageProtocol::validate_message_size(size_t size) {
@@ -419,6 +581,7 @@ ErrorCategory MessageProtocol::classify_error(ErrorCode error_code) {
             
         case ErrorCode::Timeout:
         case ErrorCode::ConnectionLost:
+        case ErrorCode::Busy:
             return ErrorCategory::Communication;
             
         case ErrorCode::ProcessNotFound:
@@ -454,6 +617,8 @@ std::string MessageProtocol::get_error_suggestion(ErrorCode error_code) {
             return "Ensure the target process is running and accessible";
         case ErrorCode::MemoryAccessError:
             return "Check memory addresses and permissions";
+        case ErrorCode::Busy:
+            return "Retry after the retry_after_ms in the details, with fewer requests at once";
         default:
             return "Check the logs for more detailed error information";
     }
@@ -480,29 +645,46 @@ ErrorMessage MessageProtocol::create_error_message(const std::string& request_id
 
 json MessageProtocol::bytes_to_json(std::span<const std::byte> data, ErrorCode* error) {
     try {
-        if (data.empty()) {
+        // Parse in place; a v1 frame still carries its trailing delimiter
+        std::string_view text(reinterpret_cast<const char*>(data.data()), data.size());
+        if (text.ends_with(MESSAGE_DELIMITER)) {
+            text.remove_suffix(MESSAGE_DELIMITER.size());
+        }
+        
+        if (text.empty()) {
             if (error) *error = ErrorCode::InvalidMessage;
             return json{};
         }
         
-        // Convert bytes to string
-        std::string json_str;
-        json_str.reserve(data.size());
-        for (auto byte : data) {
-            json_str.push_back(static_cast<char>(byte));
-        }
+        auto parsed = json::parse(text.begin(), text.end());
         
-        // Remove delimiter if present
-        if (json_str.size() >= MESSAGE_DELIMITER.size()) {
-            auto delimiter_pos = json_str.find(MESSAGE_DELIMITER);
-            if (delimiter_pos != std::string::npos) {
-                json_str = json_str.substr(0, delimiter_pos);
-            }
+        if (error) *error = ErrorCode::None;
+        return parsed;
+    } catch (...) {
+        if (error) *error = ErrorCode::InvalidMessage;
+        return json{};
+    }
+}
+
+json MessageProtocol::decode_envelope(std::span<const std::byte> data, PayloadEncoding encoding, ErrorCode* error) {
+    try {
+        const auto* bytes = reinterpret_cast<const std::uint8_t*>(data.data());
+        json parsed;
+        
+        switch (encoding) {
+            case PayloadEncoding::Json:
+                return bytes_to_json(data, error);
+            case PayloadEncoding::MessagePack:
+                parsed = json::from_msgpack(bytes, bytes + data.size());
+                break;
+            case PayloadEncoding::Cbor:
+                parsed = json::from_cbor(bytes, bytes + data.size());
+                break;
+            default:
+                if (error) *error = ErrorCode::InvalidMessage;
+                return json{};
         }
         
-        // Parse JSON
-        auto parsed = json::parse(json_str);
-        
         if (error) *error = ErrorCode::None;
         return parsed;
     } catch (...) {
@@ -511,42 +693,71 @@ json MessageProtocol::bytes_to_json(std::span<const std::byte> data, ErrorCode*
     }
 }
 
-std::vector<std::byte> MessageProtocol::json_to_bytes(const json& j) {
-    std::string json_str = j.dump();
+std::string MessageProtocol::encode_envelope(const json& payload, PayloadEncoding encoding) {
+    std::string envelope;
+    switch (encoding) {
+        case PayloadEncoding::MessagePack:
+            json::to_msgpack(payload, envelope);
+            break;
+        case PayloadEncoding::Cbor:
+            json::to_cbor(payload, envelope);
+            break;
+        case PayloadEncoding::Json:
+        default:
+            envelope = payload.dump();
+            break;
+    }
+    return envelope;
+}
+
+std::vector<std::byte> MessageProtocol::frame_message(MessageType type, const json& payload, const WireFormat& format,
+                                                      uint16_t flags, std::string_view raw_body) {
     std::vector<std::byte> result;
-    result.reserve(json_str.size());
     
-    std::transform(json_str.begin(), json_str.end(), std::back_inserter(result),
-                  [](char c) { return static_cast<std::byte>(c); });
+    if (format.version < PROTOCOL_VERSION_V2) {
+        json full_message = {
+            {"protocol_version", PROTOCOL_VERSION_V1},
+            {"message_type", static_cast<uint8_t>(type)},
+            {"payload", payload}
+        };
+        
+        std::string json_str = full_message.dump();
+        result.resize(json_str.size() + MESSAGE_DELIMITER.size());
+        std::memcpy(result.data(), json_str.data(), json_str.size());
+        std::memcpy(result.data() + json_str.size(), MESSAGE_DELIMITER.data(), MESSAGE_DELIMITER.size());
+        return result;
+    }
     
-    return result;
-}
-
-std::vector<std::byte> MessageProtocol::add_header(MessageType type, std::span<const std::byte> payload) {
-    json header = {
-        {"protocol_version", PROTOCOL_VERSION},
-        {"message_type", static_cast<uint8_t>(type)},
-        {"payload_size", payload.size()}
-    };
+    std::string envelope = encode_envelope(payload, format.encoding);
+    flags |= static_cast<uint16_t>(static_cast<uint16_t>(format.encoding)
+                                   << ENCODING_FLAG_SHIFT);
+    bool raw = (flags & static_cast<uint16_t>(FrameFlags::RawBody)) != 0;
+    size_t body_size = raw ? sizeof(uint32_t) + envelope.size() + raw_body.size() : envelope.size();
     
-    auto header_bytes = json_to_bytes(header);
-    std::vector<std::byte> result;
-    result.reserve(header_bytes.size() + payload.size());
+    FrameHeader header{};
+    header.magic = FRAME_MAGIC;
+    header.version = static_cast<uint8_t>(PROTOCOL_VERSION_V2);
+    header.type = static_cast<uint8_t>(type);
+    header.flags = flags;
+    header.length = static_cast<uint32_t>(body_size);
     
-    result.insert(result.end(), header_bytes.begin(), header_bytes.end());
-    result.insert(result.end(), payload.begin(), payload.end());
+    result.resize(FRAME_HEADER_SIZE + body_size);
+    std::byte* cursor = result.data();
+    std::memcpy(cursor, &header, FRAME_HEADER_SIZE);
+    cursor += FRAME_HEADER_SIZE;
+    
+    if (raw) {
+        uint32_t envelope_size = static_cast<uint32_t>(envelope.size());
+        std::memcpy(cursor, &envelope_size, sizeof(envelope_size));
+        cursor += sizeof(envelope_size);
+    }
+    
+    std::memcpy(cursor, envelope.data(), envelope.size());
+    cursor += envelope.size();
+    
+    if (raw && !raw_body.empty()) {
+        std::memcpy(cursor, raw_body.data(), raw_body.size());
+    }
     
     return result;
 }
-
-std::span<const std::byte> MessageProtocol::extract_payload(std::span<const std::byte> data, ErrorCode* error) {
-    try {
-        // For simplified implementation, just return the data as-is
-        // In a more complex implementation, this would parse headers
-        if (error) *error = ErrorCode::None;
-        return data;
-    } catch (...) {
-        if (error) *error = ErrorCode::InvalidMessage;
-        return {};
-    }
-}
\ No newline at end of file
@@ -3,8 +3,6 @@
 #include "../../inc/message_protocol.h"
 #include "../../inc/error_handling.h"
 #include <format>
-#include <cstring>
-#include <sstream>
 
 using namespace vibedbg::communication;
 
@@ -14,9 +12,8 @@ using namespace vibedbg::communication;
  * @param[in] config Configuration parameters for the pipe server
  */
 NamedPipeServer::NamedPipeServer(const PipeServerConfig& config)
-    : config_(config)
-    , running_(false) {
-    stats_.start_time = std::chrono::steady_clock::now();
+    : TransportServer(config)
+    , config_(config) {
 }
 
 /**
@@ -33,7 +30,11 @@ NamedPipeServer::~NamedPipeServer() {
  * @brief Starts the named pipe server.
  * 
  * This method creates a background thread that runs the server loop,
- * accepting client connections and handling them in separate threads.
+ * accepting client connections. In PipeIoMode::Polling each client is
+ * handled in a separate thread; in PipeIoMode::Overlapped reads are
+ * serviced by a fixed pool of completion port worker threads. Commands run
+ * on a pool of request workers, and one more thread writes the events
+ * pushed to subscribed connections.
  * The server will continue running until stop() is called.
  * 
  * @return PipeServerError::None on success, PipeServerError::CreationFailed on failure
@@ -41,18 +42,36 @@ NamedPipeServer::~NamedPipeServer() {
  * @note This method is thread-safe and can only be called once per instance.
  */
 PipeServerError NamedPipeServer::start() {
-    if (running_.load()) {
+    if (running_.exchange(true)) {
         return PipeServerError::CreationFailed;
     }
     
     try {
-        // Start the server thread
-        server_thread_ = std::make_unique<std::thread>(&NamedPipeServer::server_loop, this);
-        running_.store(true);
-        stats_.start_time = std::chrono::steady_clock::now();
+        start_workers();
+        
+        if (config_.io_mode == PipeIoMode::Overlapped) {
+            completion_port_.reset(CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 0));
+            if (!completion_port_.is_valid()) {
+                running_.store(false);
+                stop_events();
+                stop_workers();
+                return PipeServerError::CreationFailed;
+            }
+            
+            uint32_t worker_count = config_.completion_threads > 0 ? config_.completion_threads : 1;
+            for (uint32_t i = 0; i < worker_count; ++i) {
+                completion_threads_.emplace_back(&NamedPipeServer::completion_worker_loop, this);
+            }
+            server_thread_ = std::make_unique<std::thread>(&NamedPipeServer::overlapped_server_loop, this);
+        } else {
+            server_thread_ = std::make_unique<std::thread>(&NamedPipeServer::server_loop, this);
+        }
         
         return PipeServerError::None;
     } catch (...) {
+        running_.store(false);
+        stop_events();
+        stop_workers();
         return PipeServerError::CreationFailed;
     }
 }
@@ -61,8 +80,10 @@ PipeServerError NamedPipeServer::start() {
  * @brief Stops the named pipe server and cleans up resources.
  * 
  * This method signals the server to stop, waits for all threads to complete,
- * and cleans up all client connections. It ensures a graceful shutdown
- * of the entire server infrastructure.
+ * and cleans up all client connections. In overlapped mode outstanding reads
+ * are cancelled and drained before the completion workers are released, so no
+ * connection is destroyed while the kernel still references its OVERLAPPED.
+ * Requests already handed to the request workers run to completion.
  * 
  * @note This method is thread-safe and can be called multiple times safely.
  */
@@ -72,6 +93,7 @@ void NamedPipeServer::stop() {
     }
     
     running_.store(false);
+    stop_events();
     
     // Wait for server thread to finish
     if (server_thread_ && server_thread_->joinable()) {
@@ -86,47 +108,25 @@ void NamedPipeServer::stop() {
     }
     client_threads_.clear();
     
-    // Cleanup client connections
-    cleanup_disconnected_connections();
-    
-    server_thread_.reset();
-}
-
-/**
- * @brief Gets a list of active connection IDs.
- * 
- * This method returns the IDs of all currently active client connections.
- * The list is thread-safe and provides a snapshot of the current state.
- * 
- * @return Vector of connection ID strings
- */
-std::vector<std::string> NamedPipeServer::get_active_connection_ids() const {
-    std::shared_lock<std::shared_mutex> lock(connections_mutex_);
-    
-    std::vector<std::string> connection_ids;
-    for (const auto& connection : connections_) {
-        if (connection && connection->is_active()) {
-            connection_ids.push_back(connection->get_id());
+    if (completion_port_.is_valid()) {
+        cancel_overlapped_io();
+        
+        for (size_t i = 0; i < completion_threads_.size(); ++i) {
+            PostQueuedCompletionStatus(completion_port_.get(), 0, 0, nullptr);
+        }
+        for (auto& thread : completion_threads_) {
+            if (thread.joinable()) {
+                thread.join();
+            }
         }
+        completion_threads_.clear();
+        completion_port_.reset(nullptr);
     }
     
-    return connection_ids;
-}
-
-/**
- * @brief Gets current server statistics.
- * 
- * This method returns a snapshot of the current server statistics including
- * uptime, connection counts, and message processing statistics.
- * 
- * @return ServerStats structure containing current statistics
- */
-NamedPipeServer::ServerStats NamedPipeServer::get_stats() const {
-    std::lock_guard<std::mutex> lock(stats_mutex_);
-    ServerStats current_stats = stats_;
-    current_stats.uptime = std::chrono::duration_cast<std::chrono::milliseconds>(
-        std::chrono::steady_clock::now() - stats_.start_time);
-    return current_stats;
+    // Nothing reads frames any more; the requests already read are answered
+    stop_workers();
+    
+    server_thread_.reset();
 }
 
 /**
@@ -161,17 +161,214 @@ void NamedPipeServer::server_loop() {
         
         // Create client connection
         std::string connection_id = generate_connection_id();
-        auto connection = std::make_unique<ClientConnection>(pipe_handle, connection_id);
+        add_connection(std::make_shared<PipeConnection>(pipe_handle, connection_id));
         
-        {
-            std::unique_lock<std::shared_mutex> lock(connections_mutex_);
-            connections_.push_back(std::move(connection));
+        // Handle client in a separate thread
+        client_threads_.emplace_back(&NamedPipeServer::handle_client_connection, this, pipe_handle);
+    }
+}
+
+/**
+ * @brief Accept loop for PipeIoMode::Overlapped.
+ * 
+ * Creates overlapped pipe instances, waits for a client with an overlapped
+ * ConnectNamedPipe, associates the connected handle with the completion port
+ * and posts the first read. No thread is dedicated to the connection
+ * afterwards; reads complete on the worker pool as data arrives.
+ * 
+ * @note This method runs in the server thread and should not be called directly.
+ */
+void NamedPipeServer::overlapped_server_loop() {
+    while (running_.load()) {
+        PipeServerError error = PipeServerError::None;
+        HANDLE pipe_handle = create_pipe_instance(&error);
+        
+        if (pipe_handle == INVALID_HANDLE_VALUE) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            continue;
+        }
+        
+        if (!wait_for_overlapped_connect(pipe_handle)) {
+            CloseHandle(pipe_handle);
+            continue;
         }
         
-        update_stats_on_connection();
+        std::string connection_id = generate_connection_id();
+        auto connection = std::make_shared<PipeConnection>(pipe_handle, connection_id, true);
         
-        // Handle client in a separate thread
-        client_threads_.emplace_back(&NamedPipeServer::handle_client_connection, this, pipe_handle);
+        // The connection pointer is the completion key; every posted read
+        // holds a reference, so it stays alive until its last read completed
+        if (!CreateIoCompletionPort(pipe_handle, completion_port_.get(),
+                                    reinterpret_cast<ULONG_PTR>(connection.get()), 0)) {
+            update_stats_on_error();
+            continue;
+        }
+        
+        add_connection(connection);
+        begin_overlapped_read(*connection);
+    }
+}
+
+/**
+ * @brief Waits for a client to connect to an overlapped pipe instance.
+ * 
+ * The wait is sliced so that stop() is observed promptly instead of blocking
+ * forever inside ConnectNamedPipe.
+ * 
+ * @param[in] pipe_handle Overlapped pipe instance created by create_pipe_instance
+ * 
+ * @return true when a client is connected, false on failure or shutdown
+ */
+bool NamedPipeServer::wait_for_overlapped_connect(_In_ HANDLE pipe_handle) {
+    utils::HandleWrapper connect_event(CreateEventA(nullptr, TRUE, FALSE, nullptr));
+    if (!connect_event.is_valid()) {
+        return false;
+    }
+    
+    OVERLAPPED overlapped{};
+    overlapped.hEvent = connect_event.get();
+    
+    if (ConnectNamedPipe(pipe_handle, &overlapped)) {
+        return true;
+    }
+    
+    DWORD last_error = GetLastError();
+    if (last_error == ERROR_PIPE_CONNECTED) {
+        return true;
+    }
+    if (last_error != ERROR_IO_PENDING) {
+        update_stats_on_error();
+        return false;
+    }
+    
+    while (running_.load()) {
+        DWORD wait_result = WaitForSingleObject(connect_event.get(), 250);
+        if (wait_result == WAIT_OBJECT_0) {
+            DWORD unused = 0;
+            if (GetOverlappedResult(pipe_handle, &overlapped, &unused, FALSE)) {
+                return true;
+            }
+            update_stats_on_error();
+            return false;
+        }
+        if (wait_result != WAIT_TIMEOUT) {
+            break;
+        }
+    }
+    
+    // Shutting down: the pending connect must be cancelled and drained before
+    // the OVERLAPPED on this stack frame goes away.
+    CancelIoEx(pipe_handle, &overlapped);
+    DWORD unused = 0;
+    GetOverlappedResult(pipe_handle, &overlapped, &unused, TRUE);
+    return false;
+}
+
+/**
+ * @brief Completion port worker loop.
+ * 
+ * Dequeues read completions and hands them to handle_read_completion. The
+ * reference the read held is released once the completion is handled, after
+ * the next read took its own. A packet with a null OVERLAPPED is the
+ * shutdown signal posted by stop().
+ * 
+ * @note This method runs in a completion worker thread and should not be called directly.
+ */
+void NamedPipeServer::completion_worker_loop() {
+    while (true) {
+        DWORD bytes_transferred = 0;
+        ULONG_PTR completion_key = 0;
+        LPOVERLAPPED overlapped = nullptr;
+        
+        BOOL success = GetQueuedCompletionStatus(
+            completion_port_.get(), &bytes_transferred, &completion_key, &overlapped, INFINITE);
+        
+        if (!overlapped) {
+            // Shutdown packet or the port itself was closed
+            break;
+        }
+        
+        DWORD error_code = success ? ERROR_SUCCESS : GetLastError();
+        auto* client = reinterpret_cast<PipeConnection*>(completion_key);
+        auto hold = client->release_read_hold();
+        handle_read_completion(*client, bytes_transferred, error_code);
+        hold.reset();
+        pending_io_.fetch_sub(1);
+    }
+}
+
+/**
+ * @brief Posts the next overlapped read for a connection.
+ * 
+ * @param[in,out] client Connection to read from
+ */
+void NamedPipeServer::begin_overlapped_read(_Inout_ PipeConnection& client) {
+    if (!running_.load()) {
+        client.mark_inactive();
+        return;
+    }
+    
+    pending_io_.fetch_add(1);
+    client.hold_for_read();
+    if (client.begin_read() != PipeServerError::None) {
+        client.release_read_hold();
+        pending_io_.fetch_sub(1);
+        client.mark_inactive();
+        update_stats_on_disconnection();
+        cleanup_disconnected_connections();
+    }
+}
+
+/**
+ * @brief Handles a completed overlapped read.
+ * 
+ * The received bytes are added to the connection's framer and every frame
+ * completed by them is dispatched on the worker thread. The next read is
+ * posted once all of those responses have been written.
+ * 
+ * @param[in,out] client Connection the read completed on
+ * @param[in] bytes_transferred Number of bytes placed in the read buffer
+ * @param[in] error_code ERROR_SUCCESS or the failure reported by the completion
+ */
+void NamedPipeServer::handle_read_completion(
+    _Inout_ PipeConnection& client,
+    _In_ DWORD bytes_transferred,
+    _In_ DWORD error_code) {
+    PipeServerError error = client.complete_read(bytes_transferred, error_code);
+    if (error == PipeServerError::None) {
+        error = process_buffered_messages(client);
+    }
+    
+    if (error != PipeServerError::None) {
+        client.mark_inactive();
+        update_stats_on_disconnection();
+        cleanup_disconnected_connections();
+        return;
+    }
+    
+    begin_overlapped_read(client);
+}
+
+/**
+ * @brief Cancels outstanding overlapped reads and waits for them to drain.
+ * 
+ * Called from stop() before the worker pool is released so every connection's
+ * OVERLAPPED has been returned by the kernel before the connection is freed.
+ */
+void NamedPipeServer::cancel_overlapped_io() {
+    {
+        std::shared_lock<std::shared_mutex> lock(connections_mutex_);
+        for (const auto& connection : connections_) {
+            auto* pipe = static_cast<PipeConnection*>(connection.get());
+            if (pipe && pipe->is_overlapped()) {
+                CancelIoEx(pipe->get_handle(), nullptr);
+            }
+        }
+    }
+    
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (pending_io_.load() > 0 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
     }
 }
 
@@ -187,26 +384,33 @@ void NamedPipeServer::server_loop() {
  * @note This method runs in a client thread and should not be called directly.
  */
 void NamedPipeServer::handle_client_connection(_In_ HANDLE pipe_handle) {
-    // Find the connection object
-    std::unique_ptr<ClientConnection> connection;
+    // Find the connection object; the lock is not held while servicing it so
+    // the accept loop can register new connections concurrently.
+    std::shared_ptr<PipeConnection> connection;
     {
         std::shared_lock<std::shared_mutex> lock(connections_mutex_);
-        for (auto& conn : connections_) {
-            if (conn && conn->get_handle() == pipe_handle) {
-                // Process messages for this connection
-                while (running_.load() && conn->is_active()) {
-                    PipeServerError error = process_client_messages(*conn);
-                    if (error != PipeServerError::None) {
-                        conn->mark_inactive();
-                        break;
-                    }
-                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
-                }
+        for (const auto& conn : connections_) {
+            auto pipe = std::static_pointer_cast<PipeConnection>(conn);
+            if (pipe && pipe->get_handle() == pipe_handle) {
+                connection = std::move(pipe);
                 break;
             }
         }
     }
     
+    if (connection) {
+        // Process messages for this connection
+        while (running_.load() && connection->is_active()) {
+            PipeServerError error = process_client_messages(*connection);
+            if (error != PipeServerError::None) {
+                connection->mark_inactive();
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        update_stats_on_disconnection();
+    }
+    
     // Cleanup disconnected connections
     cleanup_disconnected_connections();
 }
@@ -223,11 +427,16 @@ void NamedPipeServer::handle_client_connection(_In_ HANDLE pipe_handle) {
  * @return Handle to the created pipe, or INVALID_HANDLE_VALUE on failure
  */
 HANDLE NamedPipeServer::create_pipe_instance(_Out_opt_ PipeServerError* error) {
+    DWORD open_mode = PIPE_ACCESS_DUPLEX;
+    if (config_.io_mode == PipeIoMode::Overlapped) {
+        open_mode |= FILE_FLAG_OVERLAPPED;
+    }
+    
     HANDLE pipe_handle = CreateNamedPipeA(
         config_.pipe_name.c_str(),
-        PIPE_ACCESS_DUPLEX,
+        open_mode,
         PIPE_TYPE_MESSAGE | PIPE_READMODE_MESSAGE | PIPE_WAIT,
-        config_.max_connections,
+        PIPE_UNLIMITED_INSTANCES, // max_connections is enforced with a Busy answer, see add_connection
         config_.buffer_size,
         config_.buffer_size,
         static_cast<DWORD>(config_.read_timeout.count()),
@@ -254,157 +463,40 @@ HANDLE NamedPipeServer::create_pipe_instance(_Out_opt_ PipeServerError* error) {
  * 
  * @return PipeServerError::None on success, appropriate error code on failure
  */
-PipeServerError NamedPipeServer::process_client_messages(_Inout_ ClientConnection& client) {
+PipeServerError NamedPipeServer::process_client_messages(_Inout_ PipeConnection& client) {
     try {
-        // Read message from client
-        PipeServerError error = PipeServerError::None;
-        auto message_data = client.read_message(config_.read_timeout, &error);
-        
+        // Read whatever the client has sent so far
+        PipeServerError error = client.receive(config_.read_timeout);
         if (error != PipeServerError::None) {
             return error;
         }
         
-        if (message_data.empty()) {
-            return PipeServerError::None; // No message available
-        }
-        
-        // Parse the incoming command from message_data
-        ErrorCode parse_error = ErrorCode::None;
-        std::span<const std::byte> data_span(message_data.data(), message_data.size());
-        CommandRequest request = MessageProtocol::parse_command(data_span, &parse_error);
-        
-        if (parse_error != ErrorCode::None) {
-            // If parsing failed, create error response
-            CommandResponse error_response;
-            error_response.success = false;
-            error_response.error_message = "Failed to parse command";
-            error_response.request_id = "unknown";
-            
-            std::vector<std::byte> response_data = MessageProtocol::serialize_response(error_response);
-            PipeServerError send_error = client.write_message(response_data, config_.write_timeout);
-            return send_error == PipeServerError::None ? PipeServerError::None : send_error;
-        }
-        
-        // Handle the command
-        ErrorCode cmd_error = ErrorCode::None;
-        CommandResponse response = handle_command(request, &cmd_error);
-        
-        // Properly serialize the response using MessageProtocol
-        std::vector<std::byte> response_data = MessageProtocol::serialize_response(response, &cmd_error);
-        if (cmd_error != ErrorCode::None) {
-            // If serialization failed, create a simple error response
-            std::string error_response = R"({"protocol_version":1,"message_type":3,"payload":{"type":"error","error_message":"Failed to serialize response"}})";
-            error_response += "\r\n\r\n";
-            response_data.resize(error_response.size());
-            std::memcpy(response_data.data(), error_response.data(), error_response.size());
-        }
-        
-        PipeServerError send_error = client.write_message(response_data, config_.write_timeout);
-        if (send_error != PipeServerError::None) {
-            return send_error;
-        }
-        
-        update_stats_on_message();
-        return PipeServerError::None;
+        return process_buffered_messages(client);
         
     } catch (...) {
         return PipeServerError::ReadFailed;
     }
 }
 
-/**
- * @brief Cleans up disconnected client connections.
- * 
- * This method removes all inactive client connections from the connections
- * list. It uses a thread-safe approach to avoid race conditions during
- * cleanup operations.
- */
-void NamedPipeServer::cleanup_disconnected_connections() {
-    std::unique_lock<std::shared_mutex> lock(connections_mutex_);
-    
-    connections_.erase(
-        std::remove_if(connections_.begin(), connections_.end(),
-            [](const std::unique_ptr<ClientConnection>& conn) {
-                return !conn || !conn->is_active();
-            }),
-        connections_.end());
-}
-
-/**
- * @brief Updates statistics when a new connection is established.
- * 
- * This method increments the connection counters in a thread-safe manner.
- */
-void NamedPipeServer::update_stats_on_connection() {
-    std::lock_guard<std::mutex> lock(stats_mutex_);
-    stats_.total_connections++;
-    stats_.active_connections++;
-}
-
-/**
- * @brief Updates statistics when a message is processed.
- * 
- * This method increments the message processing counters in a thread-safe manner.
- */
-void NamedPipeServer::update_stats_on_message() {
-    std::lock_guard<std::mutex> lock(stats_mutex_);
-    stats_.total_messages_processed++;
-}
-
-/**
- * @brief Updates statistics when an error occurs.
- * 
- * This method increments the error counters in a thread-safe manner.
- */
-void NamedPipeServer::update_stats_on_error() {
-    std::lock_guard<std::mutex> lock(stats_mutex_);
-    stats_.total_errors++;
-}
-
-/**
- * @brief Handles a command request using the configured message handler.
- * 
- * This method delegates command processing to the configured message handler.
- * If no handler is configured, it returns a default error response.
- * 
- * @param[in] request The command request to handle
- * @param[out] error Optional pointer to receive error information
- * 
- * @return CommandResponse containing the result of command execution
- */
-CommandResponse NamedPipeServer::handle_command(
-    _In_ const CommandRequest& request, 
-    _Out_opt_ ErrorCode* error) {
-    if (message_handler_) {
-        return message_handler_(request, error);
-    }
-    
-    // Default response when no handler is set
-    CommandResponse response;
-    response.success = false;
-    response.error_message = "No message handler configured";
-    if (error) *error = ErrorCode::InternalError;
-    return response;
-}
-
-// ClientConnection implementation
+// PipeConnection implementation
 
 /**
  * @brief Constructs a client connection with the specified pipe handle and ID.
  * 
  * @param[in] pipe_handle Handle to the client's pipe connection
  * @param[in] connection_id Unique identifier for this connection
+ * @param[in] overlapped true if the handle was opened with FILE_FLAG_OVERLAPPED
  */
-ClientConnection::ClientConnection(
+PipeConnection::PipeConnection(
     _In_ HANDLE pipe_handle, 
-    _In_ const std::string& connection_id)
-    : pipe_handle_(pipe_handle)
-    , connection_id_(connection_id)
-    , active_(true)
-    , read_buffer_(64 * 1024)  // 64KB buffer
-    , message_buffer_(64 * 1024) {
-    stats_.connection_time = std::chrono::steady_clock::now();
-    stats_.last_activity = stats_.connection_time;
+    _In_ const std::string& connection_id,
+    _In_ bool overlapped)
+    : ClientConnection(connection_id)
+    , pipe_handle_(pipe_handle)
+    , overlapped_(overlapped) {
+    if (overlapped_) {
+        write_event_.reset(CreateEventA(nullptr, TRUE, FALSE, nullptr));
+    }
 }
 
 /**
@@ -413,30 +505,30 @@ ClientConnection::ClientConnection(
  * The HandleWrapper automatically closes the pipe handle when this
  * object is destroyed.
  */
-ClientConnection::~ClientConnection() {
+PipeConnection::~PipeConnection() {
     // HandleWrapper automatically closes the handle
 }
 
 /**
- * @brief Reads a message from the client connection.
+ * @brief Receives any data the client has sent (polling mode).
+ * 
+ * This method reads the bytes currently available on the pipe directly into
+ * the connection's framer. Complete frames are then retrieved with
+ * next_message(). It handles various error conditions including
+ * disconnection scenarios.
  * 
- * This method reads available data from the pipe and returns it as a
- * byte vector. It handles various error conditions including disconnection
- * and timeout scenarios.
+ * An idle connection is never timed out; a frame that stays incomplete for
+ * longer than the timeout is, since the client has stopped mid-message and
+ * the stream can no longer be resynchronized.
  * 
- * @param[in] timeout Maximum time to wait for data
- * @param[out] error Optional pointer to receive error information
+ * @param[in] timeout Maximum time a partially received frame may go without new data
  * 
- * @return Vector of bytes containing the message data, or empty vector on error
+ * @return PipeServerError::None on success (including when no data is available),
+ *         PipeServerError::Timeout if a partial frame stalled, appropriate error code on failure
  */
-std::vector<std::byte> ClientConnection::read_message(
-    _In_ [[maybe_unused]] std::chrono::milliseconds timeout, 
-    _Out_opt_ PipeServerError* error) {
-    if (error) *error = PipeServerError::None;
-    
-    if (!active_.load() || !pipe_handle_.is_valid()) {
-        if (error) *error = PipeServerError::Disconnected;
-        return {};
+PipeServerError PipeConnection::receive(_In_ std::chrono::milliseconds timeout) {
+    if (!is_open() || !pipe_handle_.is_valid()) {
+        return PipeServerError::Disconnected;
     }
     
     // Check if data is available
@@ -445,78 +537,119 @@ std::vector<std::byte> ClientConnection::read_message(
         DWORD last_error = GetLastError();
         if (last_error == ERROR_BROKEN_PIPE || last_error == ERROR_PIPE_NOT_CONNECTED) {
             active_.store(false);
-            if (error) *error = PipeServerError::Disconnected;
-        } else {
-            if (error) *error = PipeServerError::ReadFailed;
+            return PipeServerError::Disconnected;
         }
-        return {};
+        return PipeServerError::ReadFailed;
     }
     
+    auto now = std::chrono::steady_clock::now();
     if (bytes_available == 0) {
-        return {}; // No data available
+        if (framer_.has_partial_frame() && timeout.count() > 0 && now - last_receive_time_ > timeout) {
+            return PipeServerError::Timeout;
+        }
+        return PipeServerError::None;
     }
+    last_receive_time_ = now;
     
-    // Read available data
-    DWORD bytes_read = 0;
-    DWORD bytes_to_read = static_cast<DWORD>(bytes_available < read_buffer_.size() ? bytes_available : read_buffer_.size());
-    BOOL success = ReadFile(
-        pipe_handle_.get(),
-        static_cast<void*>(read_buffer_.data()),
-        bytes_to_read,
-        &bytes_read,
-        nullptr);
-    
-    if (!success || bytes_read == 0) {
-        DWORD last_error = GetLastError();
-        if (last_error == ERROR_BROKEN_PIPE || last_error == ERROR_PIPE_NOT_CONNECTED) {
-            active_.store(false);
-            if (error) *error = PipeServerError::Disconnected;
-        } else {
-            if (error) *error = PipeServerError::ReadFailed;
+    while (bytes_available > 0) {
+        auto destination = framer_.prepare((std::min)<size_t>(bytes_available, READ_CHUNK_SIZE));
+        DWORD bytes_to_read = static_cast<DWORD>((std::min)<size_t>(destination.size(), bytes_available));
+        DWORD bytes_read = 0;
+        
+        BOOL success = ReadFile(
+            pipe_handle_.get(),
+            static_cast<void*>(destination.data()),
+            bytes_to_read,
+            &bytes_read,
+            nullptr);
+        
+        // ERROR_MORE_DATA only means the pipe message continues past this read
+        if ((!success && GetLastError() != ERROR_MORE_DATA) || bytes_read == 0) {
+            DWORD last_error = GetLastError();
+            if (last_error == ERROR_BROKEN_PIPE || last_error == ERROR_PIPE_NOT_CONNECTED) {
+                active_.store(false);
+                return PipeServerError::Disconnected;
+            }
+            return PipeServerError::ReadFailed;
         }
-        return {};
+        
+        commit_received(bytes_read);
+        bytes_available -= (std::min)(bytes_available, bytes_read);
     }
     
-    update_read_stats(bytes_read);
-    
-    // Return the read data
-    std::vector<std::byte> message_data(bytes_read);
-    std::memcpy(message_data.data(), read_buffer_.data(), bytes_read);
-    
-    return message_data;
+    return PipeServerError::None;
 }
 
 /**
- * @brief Writes a message to the client connection.
+ * @brief Writes a frame to the pipe.
  * 
  * This method writes the provided data to the pipe and ensures it is
  * properly flushed. It handles various error conditions including
  * disconnection scenarios.
  * 
+ * On overlapped connections a write the client does not drain within the
+ * timeout is cancelled and the connection is closed, as part of the message
+ * may already be on the wire. The writer does not close it itself: it
+ * cancels the pending read, whose completion takes the disconnect path.
+ * Synchronous writes cannot be bounded and ignore the timeout.
+ * 
  * @param[in] data Data to write to the client
  * @param[in] timeout Maximum time to wait for write completion
  * 
- * @return PipeServerError::None on success, appropriate error code on failure
+ * @return PipeServerError::None on success, PipeServerError::Timeout if the
+ *         write did not complete in time, appropriate error code on failure
  */
-PipeServerError ClientConnection::write_message(
+PipeServerError PipeConnection::write_bytes(
     _In_ std::span<const std::byte> data, 
-    _In_ [[maybe_unused]] std::chrono::milliseconds timeout) {
-    if (!active_.load() || !pipe_handle_.is_valid()) {
+    _In_ std::chrono::milliseconds timeout) {
+    if (!pipe_handle_.is_valid()) {
         return PipeServerError::Disconnected;
     }
     
     DWORD bytes_written = 0;
-    BOOL success = WriteFile(
-        pipe_handle_.get(),
-        static_cast<const void*>(data.data()),
-        static_cast<DWORD>(data.size()),
-        &bytes_written,
-        nullptr);
+    BOOL success = FALSE;
+    
+    if (overlapped_) {
+        // The low-order bit on hEvent keeps this write from being queued to the
+        // completion port; the writer waits for it here instead.
+        OVERLAPPED overlapped{};
+        overlapped.hEvent = reinterpret_cast<HANDLE>(
+            reinterpret_cast<ULONG_PTR>(write_event_.get()) | 1);
+        
+        success = WriteFile(
+            pipe_handle_.get(),
+            static_cast<const void*>(data.data()),
+            static_cast<DWORD>(data.size()),
+            nullptr,
+            &overlapped);
+        if (!success && GetLastError() == ERROR_IO_PENDING) {
+            DWORD wait_ms = timeout.count() > 0 ? static_cast<DWORD>(timeout.count()) : INFINITE;
+            if (WaitForSingleObject(write_event_.get(), wait_ms) == WAIT_TIMEOUT) {
+                // The OVERLAPPED lives on this stack frame, so the cancelled
+                // write must be drained before returning
+                CancelIoEx(pipe_handle_.get(), &overlapped);
+                GetOverlappedResult(pipe_handle_.get(), &overlapped, &bytes_written, TRUE);
+                request_close();
+                return PipeServerError::Timeout;
+            }
+            success = TRUE;
+        }
+        if (success) {
+            success = GetOverlappedResult(pipe_handle_.get(), &overlapped, &bytes_written, FALSE);
+        }
+    } else {
+        success = WriteFile(
+            pipe_handle_.get(),
+            static_cast<const void*>(data.data()),
+            static_cast<DWORD>(data.size()),
+            &bytes_written,
+            nullptr);
+    }
     
     if (!success || bytes_written != data.size()) {
         DWORD last_error = GetLastError();
         if (last_error == ERROR_BROKEN_PIPE || last_error == ERROR_PIPE_NOT_CONNECTED) {
-            active_.store(false);
+            request_close();
             return PipeServerError::Disconnected;
         }
         return PipeServerError::WriteFailed;
@@ -525,84 +658,84 @@ PipeServerError ClientConnection::write_message(
     // Flush to ensure message is sent
     FlushFileBuffers(pipe_handle_.get());
     
-    update_write_stats(bytes_written);
-    
     return PipeServerError::None;
 }
 
 /**
- * @brief Updates read statistics for the client connection.
- * 
- * @param[in] bytes_read Number of bytes read in the last operation
- */
-void ClientConnection::update_read_stats(_In_ size_t bytes_read) {
-    std::lock_guard<std::mutex> lock(stats_mutex_);
-    stats_.messages_received++;
-    stats_.bytes_received += bytes_read;
-    stats_.last_activity = std::chrono::steady_clock::now();
-}
-
-/**
- * @brief Updates write statistics for the client connection.
- * 
- * @param[in] bytes_written Number of bytes written in the last operation
- */
-void ClientConnection::update_write_stats(_In_ size_t bytes_written) {
-    std::lock_guard<std::mutex> lock(stats_mutex_);
-    stats_.messages_sent++;
-    stats_.bytes_sent += bytes_written;
-    stats_.last_activity = std::chrono::steady_clock::now();
-}
-
-/**
- * @brief Searches for a complete message in the message buffer.
+ * @brief Posts an overlapped read directly into the connection's framer.
  * 
- * This method looks for message delimiters in the buffer to determine
- * if a complete message is available for processing.
+ * Completion is reported through the completion port the handle is
+ * associated with, including when ReadFile finishes synchronously.
  * 
- * @return true if a complete message is found, false otherwise
+ * @return PipeServerError::None if the read is pending, appropriate error code on failure
  */
-bool ClientConnection::find_complete_message() {
-    // Look for message delimiter in the buffer
-    // Messages should end with double CRLF (\r\n\r\n)
-    const std::string delimiter = "\r\n\r\n";
-    const auto* delimiter_bytes = reinterpret_cast<const std::byte*>(delimiter.data());
-    
-    // Search for delimiter in the message buffer
-    for (size_t i = 0; i <= message_buffer_.size() - delimiter.size(); ++i) {
-        bool found = true;
-        for (size_t j = 0; j < delimiter.size(); ++j) {
-            if (message_buffer_[i + j] != delimiter_bytes[j]) {
-                found = false;
-                break;
-            }
-        }
-        if (found) {
-            return true;
+PipeServerError PipeConnection::begin_read() {
+    if (!is_open() || !pipe_handle_.is_valid()) {
+        return PipeServerError::Disconnected;
+    }
+    
+    read_overlapped_ = {};
+    auto destination = framer_.prepare(READ_CHUNK_SIZE);
+    BOOL success = ReadFile(
+        pipe_handle_.get(),
+        static_cast<void*>(destination.data()),
+        static_cast<DWORD>((std::min)<size_t>(destination.size(), MAXDWORD)),
+        nullptr,
+        &read_overlapped_);
+    
+    if (!success) {
+        DWORD last_error = GetLastError();
+        if (last_error != ERROR_IO_PENDING && last_error != ERROR_MORE_DATA) {
+            return (last_error == ERROR_BROKEN_PIPE || last_error == ERROR_PIPE_NOT_CONNECTED)
+                ? PipeServerError::Disconnected
+                : PipeServerError::ReadFailed;
         }
     }
     
-    return false;
+    // A close requested while the read was being posted found nothing to
+    // cancel; the read is cancelled here instead
+    if (closing_.load()) {
+        cancel_read();
+    }
+    return PipeServerError::None;
 }
 
-// Utility functions
+// Polled connections have no outstanding read; their thread sees closing_
+void PipeConnection::cancel_read() {
+    if (overlapped_ && pipe_handle_.is_valid()) {
+        CancelIoEx(pipe_handle_.get(), &read_overlapped_);
+    }
+}
 
 /**
- * @brief Generates a unique connection ID.
+ * @brief Consumes a completed overlapped read.
  * 
- * This function creates a unique identifier for client connections using
- * a combination of timestamp and atomic counter to ensure uniqueness.
+ * The bytes transferred are committed to the framer. A message-mode pipe
+ * reports ERROR_MORE_DATA when a client message is larger than the read;
+ * framing does not depend on pipe message boundaries, so that is treated
+ * as success and the remainder arrives with the next read.
  * 
- * @return Unique connection ID string
+ * @param[in] bytes_transferred Number of bytes placed in the prepared region
+ * @param[in] error_code ERROR_SUCCESS, ERROR_MORE_DATA or a failure code
+ * 
+ * @return PipeServerError::None on success, appropriate error code on failure
  */
-std::string vibedbg::communication::generate_connection_id() {
-    static std::atomic<uint32_t> counter{0};
-    auto timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
-        std::chrono::steady_clock::now().time_since_epoch()).count();
+PipeServerError PipeConnection::complete_read(
+    _In_ DWORD bytes_transferred,
+    _In_ DWORD error_code) {
+    if (error_code != ERROR_SUCCESS && error_code != ERROR_MORE_DATA) {
+        return (error_code == ERROR_BROKEN_PIPE || error_code == ERROR_PIPE_NOT_CONNECTED ||
+                error_code == ERROR_OPERATION_ABORTED)
+            ? PipeServerError::Disconnected
+            : PipeServerError::ReadFailed;
+    }
     
-    return std::format("conn_{}_{}", timestamp, counter.fetch_add(1));
+    commit_received(bytes_transferred);
+    return PipeServerError::None;
 }
 
+// Utility functions
+
 /**
  * @brief Formats a pipe error code into a human-readable string.
  * 
@@ -634,4 +767,4 @@ bool is_pipe_error_recoverable(_In_ DWORD error_code) {
         default:
             return true;
     }
-}
\ No newline at end of file
+}
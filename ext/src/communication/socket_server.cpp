@@ -0,0 +1,868 @@
+#include "pch.h"
+#include "../../inc/socket_server.h"
+#include "../../inc/message_protocol.h"
+#include "../../inc/error_handling.h"
+#include "../utils/metrics.h"
+#include <wincrypt.h>
+#include <cctype>
+#include <climits>
+#include <cstring>
+#include <utility>
+
+using namespace vibedbg::communication;
+using vibedbg::utils::MetricsRegistry;
+
+namespace {
+    // Compares without an early exit, so the time taken says nothing about
+    // how much of the token was right
+    bool tokens_equal(std::string_view given, std::string_view expected) {
+        if (expected.empty() || given.size() != expected.size()) {
+            return false;
+        }
+        unsigned char difference = 0;
+        for (size_t i = 0; i < given.size(); ++i) {
+            difference |= static_cast<unsigned char>(given[i] ^ expected[i]);
+        }
+        return difference == 0;
+    }
+
+    bool is_disconnect(int error_code) {
+        switch (error_code) {
+            case WSAECONNRESET:
+            case WSAECONNABORTED:
+            case WSAENOTCONN:
+            case WSAESHUTDOWN:
+            case ERROR_NETNAME_DELETED:
+            case ERROR_CONNECTION_ABORTED:
+            case ERROR_OPERATION_ABORTED:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    /**
+     * @brief Finds a certificate by SHA-1 thumbprint, or else by subject.
+     *
+     * @param[in] store Certificate store to search
+     * @param[in] name Thumbprint in hex, spaces allowed, or a subject substring
+     *
+     * @return Certificate context the caller frees, or nullptr
+     */
+    PCCERT_CONTEXT find_certificate(_In_ HCERTSTORE store, _In_ const std::string& name) {
+        std::string hex;
+        for (char c : name) {
+            if (c != ' ') {
+                hex.push_back(c);
+            }
+        }
+
+        BYTE thumbprint[20]{};
+        bool is_thumbprint = hex.size() == 2 * sizeof(thumbprint) &&
+            std::all_of(hex.begin(), hex.end(), [](char c) { return std::isxdigit(static_cast<unsigned char>(c)) != 0; });
+        if (is_thumbprint) {
+            for (size_t i = 0; i < sizeof(thumbprint); ++i) {
+                thumbprint[i] = static_cast<BYTE>(std::stoul(hex.substr(2 * i, 2), nullptr, 16));
+            }
+            CRYPT_HASH_BLOB hash{sizeof(thumbprint), thumbprint};
+            return CertFindCertificateInStore(store, X509_ASN_ENCODING | PKCS_7_ASN_ENCODING, 0,
+                                              CERT_FIND_HASH, &hash, nullptr);
+        }
+
+        return CertFindCertificateInStore(store, X509_ASN_ENCODING | PKCS_7_ASN_ENCODING, 0,
+                                          CERT_FIND_SUBJECT_STR_A, name.c_str(), nullptr);
+    }
+}
+
+/**
+ * @brief Constructs a socket server with the specified configuration.
+ *
+ * @param[in] config Bind address, port, TLS certificate and auth token
+ */
+SocketServer::SocketServer(const SocketServerConfig& config)
+    : TransportServer(config)
+    , config_(config) {
+}
+
+SocketServer::~SocketServer() {
+    stop();
+}
+
+/**
+ * @brief Starts listening and accepting connections.
+ *
+ * Acquires the TLS credentials when a certificate is configured, binds the
+ * listening socket and posts the first accepts. Accepts and reads complete
+ * on a pool of completion port workers; commands run on the request workers
+ * as they do for the named pipe.
+ *
+ * @return PipeServerError::None on success, PipeServerError::CreationFailed on failure
+ */
+PipeServerError SocketServer::start() {
+    if (running_.exchange(true)) {
+        return PipeServerError::CreationFailed;
+    }
+
+    try {
+        WSADATA wsa_data{};
+        if (WSAStartup(MAKEWORD(2, 2), &wsa_data) != 0) {
+            running_.store(false);
+            return PipeServerError::CreationFailed;
+        }
+        winsock_started_ = true;
+
+        completion_port_.reset(CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 0));
+        if (!completion_port_.is_valid() ||
+            (!config_.tls_certificate.empty() && !acquire_credentials()) ||
+            open_listener() != PipeServerError::None) {
+            running_.store(false);
+            release_resources();
+            return PipeServerError::CreationFailed;
+        }
+
+        start_workers();
+        uint32_t worker_count = config_.completion_threads > 0 ? config_.completion_threads : 1;
+        for (uint32_t i = 0; i < worker_count; ++i) {
+            completion_threads_.emplace_back(&SocketServer::completion_worker_loop, this);
+        }
+
+        uint32_t accept_count = config_.pending_accepts > 0 ? config_.pending_accepts : 1;
+        for (uint32_t i = 0; i < accept_count; ++i) {
+            accepts_.push_back(std::make_unique<PendingAccept>());
+            post_accept(*accepts_.back());
+        }
+
+        LOG_INFO("SocketServer", "Listening on " + config_.bind_address + ":" + std::to_string(config_.port) +
+                                 (has_credentials_ ? " (TLS)" : " (TCP)"));
+        return PipeServerError::None;
+    } catch (...) {
+        stop();
+        return PipeServerError::CreationFailed;
+    }
+}
+
+/**
+ * @brief Stops accepting, closes every connection and releases Winsock.
+ *
+ * Closing the listening socket fails the posted accepts and cancelling each
+ * connection's read fails that; both are drained before the completion
+ * workers are released, so nothing the kernel still references is freed.
+ * Requests already handed to the request workers run to completion.
+ */
+void SocketServer::stop() {
+    if (!running_.load()) {
+        return;
+    }
+
+    running_.store(false);
+    stop_events();
+
+    if (listen_socket_ != INVALID_SOCKET) {
+        closesocket(listen_socket_);
+        listen_socket_ = INVALID_SOCKET;
+    }
+    cancel_io();
+
+    for (size_t i = 0; i < completion_threads_.size(); ++i) {
+        PostQueuedCompletionStatus(completion_port_.get(), 0, 0, nullptr);
+    }
+    for (auto& thread : completion_threads_) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    completion_threads_.clear();
+
+    // Nothing reads frames any more; the requests already read are answered
+    stop_workers();
+    release_resources();
+}
+
+/**
+ * @brief Adds the transport to the capabilities the base advertises.
+ *
+ * @return JSON object advertised in heartbeat responses
+ */
+json SocketServer::build_capabilities() const {
+    json capabilities = TransportServer::build_capabilities();
+    capabilities["transport"] = has_credentials_ ? "tls" : "tcp";
+    capabilities["auth_required"] = !config_.auth_token.empty();
+    return capabilities;
+}
+
+/**
+ * @brief Holds back every message of a connection until it has authenticated.
+ *
+ * The first message must be a heartbeat whose session_info carries the
+ * configured token; it is then answered as usual. Anything else is answered
+ * with an error and closes the connection.
+ *
+ * @param[in,out] client Connection the message was received on
+ * @param[in] message Decoded frame
+ *
+ * @return true to answer the message, false to drop the connection
+ */
+bool SocketServer::admit_message(_Inout_ ClientConnection& client, _In_ const DecodedMessage& message) {
+    auto& connection = static_cast<SocketConnection&>(client);
+    if (connection.is_authorized()) {
+        return true;
+    }
+
+    if (message.type == MessageType::Heartbeat) {
+        HeartbeatMessage heartbeat = MessageProtocol::parse_heartbeat(message);
+        const json& info = heartbeat.session_info;
+        if (info.is_object() && info.contains("auth_token") && info["auth_token"].is_string() &&
+            tokens_equal(info["auth_token"].get<std::string>(), config_.auth_token)) {
+            connection.set_authorized();
+            return true;
+        }
+    }
+
+    MetricsRegistry::instance().increment(MetricsRegistry::Counter::AuthFailures);
+    LOG_WARNING("SocketServer", "Connection " + client.get_id() + " closed: not authenticated");
+
+    CommandResponse response;
+    response.success = false;
+    response.error_message = "Authentication required";
+    response.request_id = "unknown";
+    client.write_message(MessageProtocol::serialize_response(response, client.get_wire_format()), config_.write_timeout);
+    return false;
+}
+
+/**
+ * @brief Binds the listening socket and associates it with the completion port.
+ *
+ * @return PipeServerError::None on success, PipeServerError::CreationFailed on failure
+ */
+PipeServerError SocketServer::open_listener() {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_protocol = IPPROTO_TCP;
+    hints.ai_flags = AI_PASSIVE;
+
+    addrinfo* addresses = nullptr;
+    std::string port = std::to_string(config_.port);
+    const char* host = config_.bind_address.empty() ? nullptr : config_.bind_address.c_str();
+    if (getaddrinfo(host, port.c_str(), &hints, &addresses) != 0 || !addresses) {
+        LOG_ERROR("SocketServer", "Cannot resolve bind address " + config_.bind_address);
+        return PipeServerError::CreationFailed;
+    }
+    std::unique_ptr<addrinfo, decltype(&freeaddrinfo)> address(addresses, &freeaddrinfo);
+
+    listen_socket_ = WSASocketW(address->ai_family, address->ai_socktype, address->ai_protocol,
+                                nullptr, 0, WSA_FLAG_OVERLAPPED);
+    if (listen_socket_ == INVALID_SOCKET) {
+        return PipeServerError::CreationFailed;
+    }
+    address_family_ = address->ai_family;
+
+    // No other process may bind the same port and take connections over
+    BOOL exclusive = TRUE;
+    setsockopt(listen_socket_, SOL_SOCKET, SO_EXCLUSIVEADDRUSE, reinterpret_cast<const char*>(&exclusive), sizeof(exclusive));
+
+    if (bind(listen_socket_, address->ai_addr, static_cast<int>(address->ai_addrlen)) == SOCKET_ERROR ||
+        listen(listen_socket_, SOMAXCONN) == SOCKET_ERROR) {
+        LOG_ERROR_DETAIL("SocketServer", "Cannot listen on " + config_.bind_address + ":" + port,
+                         "WSA error: " + std::to_string(WSAGetLastError()));
+        return PipeServerError::CreationFailed;
+    }
+
+    GUID accept_ex_id = WSAID_ACCEPTEX;
+    DWORD bytes = 0;
+    if (WSAIoctl(listen_socket_, SIO_GET_EXTENSION_FUNCTION_POINTER, &accept_ex_id, sizeof(accept_ex_id),
+                 &accept_ex_, sizeof(accept_ex_), &bytes, nullptr, nullptr) == SOCKET_ERROR) {
+        return PipeServerError::CreationFailed;
+    }
+
+    // Completion key 0 marks an accept; every connection's key is its pointer
+    if (!CreateIoCompletionPort(reinterpret_cast<HANDLE>(listen_socket_), completion_port_.get(), 0, 0)) {
+        return PipeServerError::CreationFailed;
+    }
+
+    bool loopback = config_.bind_address == "127.0.0.1" || config_.bind_address == "::1" ||
+                    config_.bind_address == "localhost";
+    if (!loopback && (!has_credentials_ || config_.auth_token.empty())) {
+        LOG_WARNING("SocketServer", "Listening beyond loopback without both TLS and an auth token");
+    }
+    return PipeServerError::None;
+}
+
+/**
+ * @brief Acquires Schannel server credentials for the configured certificate.
+ *
+ * The certificate is looked up in the local machine's MY store first and
+ * the current user's second.
+ *
+ * @return true if every TLS connection can use the credentials
+ */
+bool SocketServer::acquire_credentials() {
+    PCCERT_CONTEXT certificate = nullptr;
+    for (DWORD location : {CERT_SYSTEM_STORE_LOCAL_MACHINE, CERT_SYSTEM_STORE_CURRENT_USER}) {
+        HCERTSTORE store = CertOpenStore(CERT_STORE_PROV_SYSTEM_A, 0, 0,
+                                         location | CERT_STORE_READONLY_FLAG | CERT_STORE_OPEN_EXISTING_FLAG, "MY");
+        if (!store) {
+            continue;
+        }
+        certificate = find_certificate(store, config_.tls_certificate);
+        // The certificate context keeps what it needs of the store
+        CertCloseStore(store, 0);
+        if (certificate) {
+            break;
+        }
+    }
+    if (!certificate) {
+        LOG_ERROR("SocketServer", "TLS certificate not found: " + config_.tls_certificate);
+        return false;
+    }
+
+    SCHANNEL_CRED credential{};
+    credential.dwVersion = SCHANNEL_CRED_VERSION;
+    credential.cCreds = 1;
+    credential.paCred = &certificate;
+    credential.grbitEnabledProtocols = SP_PROT_TLS1_2_SERVER;
+    credential.dwFlags = SCH_USE_STRONG_CRYPTO;
+
+    SECURITY_STATUS status = AcquireCredentialsHandleA(
+        nullptr, const_cast<char*>(UNISP_NAME_A), SECPKG_CRED_INBOUND, nullptr,
+        &credential, nullptr, nullptr, &credentials_, nullptr);
+    CertFreeCertificateContext(certificate);
+    if (status != SEC_E_OK) {
+        LOG_ERROR_DETAIL("SocketServer", "Cannot acquire TLS credentials",
+                         "SECURITY_STATUS: " + std::to_string(status));
+        return false;
+    }
+    has_credentials_ = true;
+    return true;
+}
+
+/**
+ * @brief Completion port worker loop.
+ *
+ * Dequeues accept and read completions. A packet with a null OVERLAPPED is
+ * the shutdown signal posted by stop().
+ *
+ * @note This method runs in a completion worker thread and should not be called directly.
+ */
+void SocketServer::completion_worker_loop() {
+    while (true) {
+        DWORD bytes_transferred = 0;
+        ULONG_PTR completion_key = 0;
+        LPOVERLAPPED overlapped = nullptr;
+
+        BOOL success = GetQueuedCompletionStatus(
+            completion_port_.get(), &bytes_transferred, &completion_key, &overlapped, INFINITE);
+
+        if (!overlapped) {
+            // Shutdown packet or the port itself was closed
+            break;
+        }
+
+        DWORD error_code = success ? ERROR_SUCCESS : GetLastError();
+        if (completion_key == 0) {
+            handle_accept(*CONTAINING_RECORD(overlapped, PendingAccept, overlapped), error_code);
+        } else {
+            auto* client = reinterpret_cast<SocketConnection*>(completion_key);
+            auto hold = client->release_read_hold();
+            handle_read_completion(*client, bytes_transferred, error_code);
+        }
+        pending_io_.fetch_sub(1);
+    }
+}
+
+/**
+ * @brief Posts an AcceptEx on the listening socket.
+ *
+ * No data is read with the accept, so it completes as soon as a client
+ * connects rather than once it has sent something.
+ *
+ * @param[in,out] accept Slot to accept into; its previous socket has been handed off
+ */
+void SocketServer::post_accept(_Inout_ PendingAccept& accept) {
+    if (!running_.load() || listen_socket_ == INVALID_SOCKET) {
+        return;
+    }
+
+    accept.socket = WSASocketW(address_family_, SOCK_STREAM, IPPROTO_TCP, nullptr, 0, WSA_FLAG_OVERLAPPED);
+    if (accept.socket == INVALID_SOCKET) {
+        update_stats_on_error();
+        return;
+    }
+
+    accept.overlapped = {};
+    pending_io_.fetch_add(1);
+    DWORD bytes_received = 0;
+    constexpr DWORD ADDRESS_LENGTH = sizeof(SOCKADDR_STORAGE) + 16;
+    if (!accept_ex_(listen_socket_, accept.socket, accept.addresses, 0, ADDRESS_LENGTH, ADDRESS_LENGTH,
+                    &bytes_received, &accept.overlapped) &&
+        WSAGetLastError() != ERROR_IO_PENDING) {
+        pending_io_.fetch_sub(1);
+        closesocket(accept.socket);
+        accept.socket = INVALID_SOCKET;
+        update_stats_on_error();
+    }
+}
+
+/**
+ * @brief Sets up an accepted connection and posts its first read.
+ *
+ * The next accept is posted first, so a burst of clients does not wait on
+ * the setup of each one.
+ *
+ * @param[in,out] accept Slot the accept completed on
+ * @param[in] error_code ERROR_SUCCESS or the failure reported by the completion
+ */
+void SocketServer::handle_accept(_Inout_ PendingAccept& accept, _In_ DWORD error_code) {
+    SOCKET socket = std::exchange(accept.socket, INVALID_SOCKET);
+    if (!running_.load() || error_code != ERROR_SUCCESS) {
+        if (socket != INVALID_SOCKET) {
+            closesocket(socket);
+        }
+        if (running_.load()) {
+            update_stats_on_error();
+            post_accept(accept);
+        }
+        return;
+    }
+
+    setsockopt(socket, SOL_SOCKET, SO_UPDATE_ACCEPT_CONTEXT,
+               reinterpret_cast<const char*>(&listen_socket_), sizeof(listen_socket_));
+    post_accept(accept);
+
+    size_t active = 0;
+    {
+        std::shared_lock<std::shared_mutex> lock(connections_mutex_);
+        active = std::count_if(connections_.begin(), connections_.end(),
+                               [](const auto& connection) { return connection && connection->is_active(); });
+    }
+    // Refused before the handshake, which costs more than the refusal; pipe
+    // clients are told Busy instead, see add_connection
+    if (active >= config_.max_connections) {
+        LOG_WARNING("SocketServer", "Connection refused: " + std::to_string(active) + " clients connected");
+        MetricsRegistry::instance().increment(MetricsRegistry::Counter::ConnectionsRejected);
+        closesocket(socket);
+        return;
+    }
+
+    // Responses are small frames that should not wait for more to coalesce;
+    // keep-alives notice clients that vanished without closing
+    BOOL enabled = TRUE;
+    setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&enabled), sizeof(enabled));
+    setsockopt(socket, SOL_SOCKET, SO_KEEPALIVE, reinterpret_cast<const char*>(&enabled), sizeof(enabled));
+    DWORD send_timeout = static_cast<DWORD>(config_.write_timeout.count());
+    setsockopt(socket, SOL_SOCKET, SO_SNDTIMEO, reinterpret_cast<const char*>(&send_timeout), sizeof(send_timeout));
+
+    auto connection = std::make_shared<SocketConnection>(
+        socket, generate_connection_id(), has_credentials_ ? &credentials_ : nullptr);
+
+    // The connection pointer is the completion key; every posted read
+    // holds a reference, so it stays alive until its last read completed
+    if (!CreateIoCompletionPort(reinterpret_cast<HANDLE>(socket), completion_port_.get(),
+                                reinterpret_cast<ULONG_PTR>(connection.get()), 0)) {
+        update_stats_on_error();
+        return;
+    }
+    if (config_.auth_token.empty()) {
+        connection->set_authorized();
+    }
+
+    add_connection(connection);
+    begin_read(*connection);
+}
+
+/**
+ * @brief Posts the next read for a connection.
+ *
+ * @param[in,out] client Connection to read from
+ */
+void SocketServer::begin_read(_Inout_ SocketConnection& client) {
+    if (!running_.load()) {
+        close_connection(client);
+        return;
+    }
+
+    pending_io_.fetch_add(1);
+    client.hold_for_read();
+    if (client.begin_read() != PipeServerError::None) {
+        client.release_read_hold();
+        pending_io_.fetch_sub(1);
+        close_connection(client);
+    }
+}
+
+/**
+ * @brief Handles a completed read.
+ *
+ * The received bytes, decrypted first on a TLS connection, are added to the
+ * connection's framer and every frame completed by them is dispatched. The
+ * next read is posted once they have been.
+ *
+ * @param[in,out] client Connection the read completed on
+ * @param[in] bytes_transferred Number of bytes received
+ * @param[in] error_code ERROR_SUCCESS or the failure reported by the completion
+ */
+void SocketServer::handle_read_completion(
+    _Inout_ SocketConnection& client,
+    _In_ DWORD bytes_transferred,
+    _In_ DWORD error_code) {
+    PipeServerError error = client.complete_read(bytes_transferred, error_code);
+    if (error == PipeServerError::None) {
+        error = process_buffered_messages(client);
+    }
+
+    if (error != PipeServerError::None) {
+        close_connection(client);
+        return;
+    }
+
+    begin_read(client);
+}
+
+void SocketServer::close_connection(_Inout_ SocketConnection& client) {
+    // Read path only; no read of the connection is outstanding here
+    client.mark_inactive();
+    update_stats_on_disconnection();
+    cleanup_disconnected_connections();
+}
+
+/**
+ * @brief Cancels outstanding reads and accepts and waits for them to drain.
+ */
+void SocketServer::cancel_io() {
+    {
+        std::shared_lock<std::shared_mutex> lock(connections_mutex_);
+        for (const auto& connection : connections_) {
+            auto* socket = static_cast<SocketConnection*>(connection.get());
+            if (socket) {
+                CancelIoEx(reinterpret_cast<HANDLE>(socket->get_socket()), nullptr);
+            }
+        }
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (pending_io_.load() > 0 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+void SocketServer::release_resources() {
+    for (auto& accept : accepts_) {
+        if (accept->socket != INVALID_SOCKET) {
+            closesocket(accept->socket);
+        }
+    }
+    accepts_.clear();
+
+    if (listen_socket_ != INVALID_SOCKET) {
+        closesocket(listen_socket_);
+        listen_socket_ = INVALID_SOCKET;
+    }
+    if (has_credentials_) {
+        FreeCredentialsHandle(&credentials_);
+        has_credentials_ = false;
+    }
+    completion_port_.reset(nullptr);
+    if (winsock_started_) {
+        WSACleanup();
+        winsock_started_ = false;
+    }
+}
+
+// SocketConnection implementation
+
+/**
+ * @brief Constructs a connection on an accepted socket.
+ *
+ * @param[in] socket Accepted socket; the connection closes it
+ * @param[in] connection_id Unique identifier for this connection
+ * @param[in] credentials Server TLS credentials, or nullptr for plain TCP
+ */
+SocketConnection::SocketConnection(
+    _In_ SOCKET socket,
+    _In_ const std::string& connection_id,
+    _In_opt_ CredHandle* credentials)
+    : ClientConnection(connection_id)
+    , socket_(socket)
+    , credentials_(credentials) {
+    if (credentials_) {
+        tls_input_.resize(READ_CHUNK_SIZE);
+    }
+}
+
+SocketConnection::~SocketConnection() {
+    if (has_context_) {
+        DeleteSecurityContext(&context_);
+    }
+    if (socket_ != INVALID_SOCKET) {
+        closesocket(socket_);
+    }
+}
+
+/**
+ * @brief Posts an overlapped receive.
+ *
+ * Plain TCP receives straight into the framer; TLS receives behind the
+ * ciphertext not yet decrypted.
+ *
+ * @return PipeServerError::None if the read is pending, appropriate error code on failure
+ */
+PipeServerError SocketConnection::begin_read() {
+    if (!is_open() || socket_ == INVALID_SOCKET) {
+        return PipeServerError::Disconnected;
+    }
+
+    WSABUF buffer{};
+    if (credentials_) {
+        if (tls_input_.size() - tls_input_size_ < READ_CHUNK_SIZE / 4) {
+            tls_input_.resize(tls_input_size_ + READ_CHUNK_SIZE);
+        }
+        buffer.buf = reinterpret_cast<CHAR*>(tls_input_.data() + tls_input_size_);
+        buffer.len = static_cast<ULONG>(tls_input_.size() - tls_input_size_);
+    } else {
+        auto destination = framer_.prepare(READ_CHUNK_SIZE);
+        buffer.buf = reinterpret_cast<CHAR*>(destination.data());
+        buffer.len = static_cast<ULONG>((std::min)(destination.size(), static_cast<size_t>(ULONG_MAX)));
+    }
+
+    read_overlapped_ = {};
+    DWORD flags = 0;
+    if (WSARecv(socket_, &buffer, 1, nullptr, &flags, &read_overlapped_, nullptr) == SOCKET_ERROR) {
+        int last_error = WSAGetLastError();
+        if (last_error != WSA_IO_PENDING) {
+            return is_disconnect(last_error) ? PipeServerError::Disconnected : PipeServerError::ReadFailed;
+        }
+    }
+
+    // A close requested while the read was being posted found nothing to
+    // cancel; the read is cancelled here instead
+    if (closing_.load()) {
+        cancel_read();
+    }
+    return PipeServerError::None;
+}
+
+void SocketConnection::cancel_read() {
+    if (socket_ != INVALID_SOCKET) {
+        CancelIoEx(reinterpret_cast<HANDLE>(socket_), &read_overlapped_);
+    }
+}
+
+/**
+ * @brief Consumes a completed receive.
+ *
+ * A receive of zero bytes is the client closing its side. On a TLS
+ * connection the bytes first drive the handshake, then are decrypted into
+ * the framer.
+ *
+ * @param[in] bytes_transferred Number of bytes received
+ * @param[in] error_code ERROR_SUCCESS or a failure code
+ *
+ * @return PipeServerError::None on success, appropriate error code on failure
+ */
+PipeServerError SocketConnection::complete_read(
+    _In_ DWORD bytes_transferred,
+    _In_ DWORD error_code) {
+    if (error_code != ERROR_SUCCESS || bytes_transferred == 0) {
+        return (bytes_transferred == 0 || is_disconnect(static_cast<int>(error_code)))
+            ? PipeServerError::Disconnected
+            : PipeServerError::ReadFailed;
+    }
+
+    if (!credentials_) {
+        commit_received(bytes_transferred);
+        return PipeServerError::None;
+    }
+
+    std::lock_guard<std::mutex> lock(tls_mutex_);
+    tls_input_size_ += bytes_transferred;
+    return handshake_done_ ? decrypt_received() : continue_handshake();
+}
+
+/**
+ * @brief Advances the TLS handshake with the bytes received so far.
+ *
+ * Tokens Schannel produces are sent at once. Bytes received past the end of
+ * the handshake already belong to the first records and are decrypted.
+ * Called with the TLS lock held.
+ *
+ * @return PipeServerError::None while the handshake proceeds or once it is done
+ */
+PipeServerError SocketConnection::continue_handshake() {
+    while (tls_input_size_ > 0) {
+        SecBuffer input[2] = {
+            {static_cast<ULONG>(tls_input_size_), SECBUFFER_TOKEN, tls_input_.data()},
+            {0, SECBUFFER_EMPTY, nullptr}
+        };
+        SecBufferDesc input_desc{SECBUFFER_VERSION, 2, input};
+        SecBuffer output[1] = {{0, SECBUFFER_TOKEN, nullptr}};
+        SecBufferDesc output_desc{SECBUFFER_VERSION, 1, output};
+
+        ULONG attributes = 0;
+        SECURITY_STATUS status = AcceptSecurityContext(
+            credentials_, has_context_ ? &context_ : nullptr, &input_desc,
+            ASC_REQ_SEQUENCE_DETECT | ASC_REQ_REPLAY_DETECT | ASC_REQ_CONFIDENTIALITY |
+            ASC_REQ_STREAM | ASC_REQ_ALLOCATE_MEMORY | ASC_REQ_EXTENDED_ERROR,
+            0, &context_, &output_desc, &attributes, nullptr);
+
+        if (status == SEC_E_INCOMPLETE_MESSAGE) {
+            return PipeServerError::None;
+        }
+        if (status == SEC_E_OK || status == SEC_I_CONTINUE_NEEDED) {
+            has_context_ = true;
+        }
+
+        // A failure may still produce a token, which carries the alert
+        if (output[0].pvBuffer) {
+            PipeServerError send_error = PipeServerError::None;
+            if (output[0].cbBuffer > 0) {
+                send_error = send_all({static_cast<const std::byte*>(output[0].pvBuffer), output[0].cbBuffer});
+            }
+            FreeContextBuffer(output[0].pvBuffer);
+            if (send_error != PipeServerError::None) {
+                return send_error;
+            }
+        }
+        if (FAILED(status)) {
+            LOG_DEBUG("SocketServer", "TLS handshake failed: " + std::to_string(status));
+            return PipeServerError::ReadFailed;
+        }
+
+        size_t consumed = tls_input_size_;
+        if (input[1].BufferType == SECBUFFER_EXTRA) {
+            consumed -= input[1].cbBuffer;
+        }
+        std::memmove(tls_input_.data(), tls_input_.data() + consumed, tls_input_size_ - consumed);
+        tls_input_size_ -= consumed;
+
+        if (status == SEC_E_OK) {
+            if (QueryContextAttributesA(&context_, SECPKG_ATTR_STREAM_SIZES, &stream_sizes_) != SEC_E_OK) {
+                return PipeServerError::ReadFailed;
+            }
+            handshake_done_ = true;
+            return decrypt_received();
+        }
+    }
+    return PipeServerError::None;
+}
+
+/**
+ * @brief Decrypts every complete record received and frames the plaintext.
+ *
+ * Called with the TLS lock held. Renegotiation is refused by closing the
+ * connection.
+ *
+ * @return PipeServerError::None on success, PipeServerError::Disconnected once the client closed TLS
+ */
+PipeServerError SocketConnection::decrypt_received() {
+    while (tls_input_size_ > 0) {
+        SecBuffer buffers[4] = {
+            {static_cast<ULONG>(tls_input_size_), SECBUFFER_DATA, tls_input_.data()},
+            {0, SECBUFFER_EMPTY, nullptr},
+            {0, SECBUFFER_EMPTY, nullptr},
+            {0, SECBUFFER_EMPTY, nullptr}
+        };
+        SecBufferDesc desc{SECBUFFER_VERSION, 4, buffers};
+
+        SECURITY_STATUS status = DecryptMessage(&context_, &desc, 0, nullptr);
+        if (status == SEC_E_INCOMPLETE_MESSAGE) {
+            return PipeServerError::None;
+        }
+        if (status != SEC_E_OK) {
+            return status == SEC_I_CONTEXT_EXPIRED ? PipeServerError::Disconnected : PipeServerError::ReadFailed;
+        }
+
+        // Records are decrypted in place, so the plaintext is taken before
+        // the remaining ciphertext moves to the front
+        const SecBuffer* extra = nullptr;
+        for (const auto& buffer : buffers) {
+            if (buffer.BufferType == SECBUFFER_DATA && buffer.cbBuffer > 0) {
+                append_received({static_cast<const std::byte*>(buffer.pvBuffer), buffer.cbBuffer});
+            } else if (buffer.BufferType == SECBUFFER_EXTRA) {
+                extra = &buffer;
+            }
+        }
+        if (extra) {
+            std::memmove(tls_input_.data(), extra->pvBuffer, extra->cbBuffer);
+            tls_input_size_ = extra->cbBuffer;
+        } else {
+            tls_input_size_ = 0;
+        }
+    }
+    return PipeServerError::None;
+}
+
+/**
+ * @brief Writes a frame, encrypting it first on a TLS connection.
+ *
+ * Sends block for at most the send timeout set when the connection was
+ * accepted; one that times out closes the connection, as part of the frame
+ * may already be on the wire. The writer only cancels the pending read; its
+ * completion closes the connection.
+ *
+ * @param[in] data Frame to write
+ * @param[in] timeout Unused; the socket's send timeout applies
+ *
+ * @return PipeServerError::None on success, appropriate error code on failure
+ */
+PipeServerError SocketConnection::write_bytes(
+    _In_ std::span<const std::byte> data,
+    _In_ [[maybe_unused]] std::chrono::milliseconds timeout) {
+    if (socket_ == INVALID_SOCKET) {
+        return PipeServerError::Disconnected;
+    }
+    if (!credentials_) {
+        return send_all(data);
+    }
+
+    while (!data.empty()) {
+        {
+            std::lock_guard<std::mutex> lock(tls_mutex_);
+            if (!handshake_done_) {
+                return PipeServerError::WriteFailed;
+            }
+
+            size_t chunk = (std::min)(data.size(), static_cast<size_t>(stream_sizes_.cbMaximumMessage));
+            size_t header = stream_sizes_.cbHeader;
+            tls_output_.resize(header + chunk + stream_sizes_.cbTrailer);
+            std::memcpy(tls_output_.data() + header, data.data(), chunk);
+
+            SecBuffer buffers[4] = {
+                {stream_sizes_.cbHeader, SECBUFFER_STREAM_HEADER, tls_output_.data()},
+                {static_cast<ULONG>(chunk), SECBUFFER_DATA, tls_output_.data() + header},
+                {stream_sizes_.cbTrailer, SECBUFFER_STREAM_TRAILER, tls_output_.data() + header + chunk},
+                {0, SECBUFFER_EMPTY, nullptr}
+            };
+            SecBufferDesc desc{SECBUFFER_VERSION, 4, buffers};
+            if (EncryptMessage(&context_, 0, &desc, 0) != SEC_E_OK) {
+                request_close();
+                return PipeServerError::WriteFailed;
+            }
+            tls_output_.resize(buffers[0].cbBuffer + buffers[1].cbBuffer + buffers[2].cbBuffer);
+            data = data.subspan(chunk);
+        }
+
+        // Writes are serialized by the connection, so the record is ours until sent
+        PipeServerError error = send_all(tls_output_);
+        if (error != PipeServerError::None) {
+            return error;
+        }
+    }
+    return PipeServerError::None;
+}
+
+PipeServerError SocketConnection::send_all(_In_ std::span<const std::byte> data) {
+    while (!data.empty()) {
+        int length = static_cast<int>((std::min)(data.size(), static_cast<size_t>(INT_MAX)));
+        int sent = send(socket_, reinterpret_cast<const char*>(data.data()), length, 0);
+        if (sent == SOCKET_ERROR) {
+            int last_error = WSAGetLastError();
+            request_close();
+            if (last_error == WSAETIMEDOUT) {
+                return PipeServerError::Timeout;
+            }
+            return is_disconnect(last_error) ? PipeServerError::Disconnected : PipeServerError::WriteFailed;
+        }
+        data = data.subspan(static_cast<size_t>(sent));
+    }
+    return PipeServerError::None;
+}
@@ -0,0 +1,245 @@
+#include "pch.h"
+#include "../../inc/trace_recorder.h"
+#include <cstring>
+
+using namespace vibedbg::communication;
+
+namespace {
+    constexpr uint64_t align_record(uint64_t size) noexcept {
+        return (size + 7) & ~uint64_t{7};
+    }
+
+    uint64_t microseconds_between(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to) {
+        return to > from ? static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(to - from).count()) : 0;
+    }
+}
+
+TraceRecorder::~TraceRecorder() {
+    close();
+}
+
+/**
+ * @brief Creates the trace file and writes its header.
+ *
+ * An existing file at the path is replaced.
+ *
+ * @param[in] path Trace file to create
+ *
+ * @return true when recording has started
+ */
+bool TraceRecorder::open(const std::string& path) {
+    std::unique_lock lock(mapping_mutex_);
+    if (recording_.load()) {
+        return false;
+    }
+
+    file_.reset(CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+                            CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr));
+    if (!file_.is_valid()) {
+        LOG_ERROR_DETAIL("TraceRecorder", "Failed to create trace file", path + ", error " + std::to_string(GetLastError()));
+        return false;
+    }
+    if (!map(INITIAL_CAPACITY)) {
+        file_.reset();
+        return false;
+    }
+
+    TraceFileHeader header{};
+    std::memcpy(header.magic, MAGIC, sizeof(header.magic));
+    header.version = FORMAT_VERSION;
+    header.header_size = sizeof(TraceFileHeader);
+    header.start_time_us = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+    std::memcpy(view_, &header, sizeof(header));
+
+    start_ = std::chrono::steady_clock::now();
+    end_.store(sizeof(TraceFileHeader));
+    records_.store(0);
+    recording_.store(true, std::memory_order_release);
+    LOG_INFO_DETAIL("TraceRecorder", "Recording commands", path);
+    return true;
+}
+
+/**
+ * @brief Stops recording and trims the file to the records written.
+ *
+ * Callers must have stopped calling append(); the pipe server closes the
+ * recorder after joining its connection threads.
+ */
+void TraceRecorder::close() {
+    std::unique_lock lock(mapping_mutex_);
+    if (!recording_.exchange(false)) {
+        return;
+    }
+
+    // Reservations past a failed growth never made it into the mapping
+    uint64_t length = (std::min)(end_.load(), capacity_);
+    unmap();
+
+    LARGE_INTEGER end_of_file{};
+    end_of_file.QuadPart = static_cast<LONGLONG>(length);
+    if (!SetFilePointerEx(file_.get(), end_of_file, nullptr, FILE_BEGIN) || !SetEndOfFile(file_.get())) {
+        LOG_WARNING("TraceRecorder", "Failed to trim trace file; it ends in zero padding");
+    }
+    file_.reset();
+    LOG_INFO_DETAIL("TraceRecorder", "Recording stopped", std::to_string(records_.load()) + " commands");
+}
+
+/**
+ * @brief Records one request and how it was answered.
+ *
+ * The frame is copied before the header, so a record whose size is set is
+ * complete even if the process dies mid-append.
+ *
+ * @param[in] request_frame Request frame as received, delimiter included
+ * @param[in] outcome Timing, response size and result of the request
+ */
+void TraceRecorder::append(std::span<const std::byte> request_frame, const TraceOutcome& outcome) {
+    if (!recording_.load(std::memory_order_acquire) || request_frame.size() > UINT32_MAX - sizeof(TraceRecordHeader) - 8) {
+        return;
+    }
+
+    TraceRecordHeader header{};
+    uint64_t record_size = align_record(sizeof(TraceRecordHeader) + request_frame.size());
+    header.record_size = static_cast<uint32_t>(record_size);
+    header.request_size = static_cast<uint32_t>(request_frame.size());
+    header.received_us = microseconds_between(start_, outcome.received_at);
+    header.duration_us = microseconds_between(outcome.received_at, outcome.completed_at);
+    header.response_bytes = outcome.response_bytes;
+    header.chunk_count = outcome.chunk_count;
+    header.connection = outcome.connection;
+    header.success = outcome.success ? 1 : 0;
+
+    uint64_t offset = end_.fetch_add(record_size, std::memory_order_relaxed);
+    auto write_record = [&] {
+        std::memcpy(view_ + offset + sizeof(TraceRecordHeader), request_frame.data(), request_frame.size());
+        std::memcpy(view_ + offset, &header, sizeof(header));
+        records_.fetch_add(1, std::memory_order_relaxed);
+    };
+
+    {
+        std::shared_lock lock(mapping_mutex_);
+        if (view_ && offset + record_size <= capacity_) {
+            write_record();
+            return;
+        }
+    }
+
+    std::unique_lock lock(mapping_mutex_);
+    if (!view_) {
+        return;
+    }
+    if (offset + record_size > capacity_) {
+        uint64_t capacity = capacity_;
+        while (capacity < offset + record_size) {
+            capacity *= 2;
+        }
+        if (!map(capacity)) {
+            // Stop rather than leave a hole that would end the trace early
+            // for readers while later records were still being written
+            recording_.store(false, std::memory_order_release);
+            LOG_ERROR("TraceRecorder", "Trace file could not grow; recording stopped");
+            return;
+        }
+    }
+    write_record();
+}
+
+/**
+ * @brief Maps the file at the given size, growing it if needed.
+ *
+ * Called with mapping_mutex_ held exclusively. Growing a file through its
+ * mapping zero-fills the new range.
+ */
+bool TraceRecorder::map(uint64_t capacity) {
+    unmap();
+    mapping_.reset(CreateFileMappingW(file_.get(), nullptr, PAGE_READWRITE,
+                                      static_cast<DWORD>(capacity >> 32), static_cast<DWORD>(capacity), nullptr));
+    if (mapping_.is_valid()) {
+        view_ = static_cast<std::byte*>(MapViewOfFile(mapping_.get(), FILE_MAP_WRITE, 0, 0, 0));
+    }
+    if (!view_) {
+        LOG_ERROR_DETAIL("TraceRecorder", "Failed to map trace file", "error " + std::to_string(GetLastError()));
+        mapping_.reset(nullptr);
+        capacity_ = 0;
+        return false;
+    }
+    capacity_ = capacity;
+    return true;
+}
+
+void TraceRecorder::unmap() noexcept {
+    if (view_) {
+        UnmapViewOfFile(view_);
+        view_ = nullptr;
+    }
+    mapping_.reset(nullptr);
+}
+
+TraceReader::~TraceReader() {
+    if (view_) {
+        UnmapViewOfFile(view_);
+    }
+}
+
+/**
+ * @brief Maps a trace file for reading and validates its header.
+ *
+ * @param[in] path Trace file written by TraceRecorder
+ * @param[out] error Reason the file was rejected
+ *
+ * @return true when the file is a readable trace
+ */
+bool TraceReader::open(const std::string& path, std::string* error) {
+    auto fail = [error](std::string message) {
+        if (error) *error = std::move(message);
+        return false;
+    };
+
+    file_.reset(CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr));
+    LARGE_INTEGER file_size{};
+    if (!file_.is_valid() || !GetFileSizeEx(file_.get(), &file_size)) {
+        return fail("cannot open " + path + ", error " + std::to_string(GetLastError()));
+    }
+    size_ = static_cast<uint64_t>(file_size.QuadPart);
+    if (size_ < sizeof(TraceFileHeader)) {
+        return fail("too short to be a trace");
+    }
+
+    mapping_.reset(CreateFileMappingW(file_.get(), nullptr, PAGE_READONLY, 0, 0, nullptr));
+    if (mapping_.is_valid()) {
+        view_ = static_cast<const std::byte*>(MapViewOfFile(mapping_.get(), FILE_MAP_READ, 0, 0, 0));
+    }
+    if (!view_) {
+        return fail("cannot map " + path + ", error " + std::to_string(GetLastError()));
+    }
+
+    std::memcpy(&header_, view_, sizeof(header_));
+    if (std::memcmp(header_.magic, TraceRecorder::MAGIC, sizeof(header_.magic)) != 0) {
+        return fail("not a VibeDbg command trace");
+    }
+    if (header_.version != TraceRecorder::FORMAT_VERSION || header_.header_size < sizeof(TraceFileHeader) ||
+        header_.header_size > size_) {
+        return fail("unsupported trace version " + std::to_string(header_.version));
+    }
+    position_ = header_.header_size;
+    return true;
+}
+
+std::optional<TraceEntry> TraceReader::next() {
+    if (!view_ || size_ - position_ < sizeof(TraceRecordHeader)) {
+        return std::nullopt;
+    }
+
+    TraceEntry entry;
+    std::memcpy(&entry.header, view_ + position_, sizeof(entry.header));
+    uint64_t record_size = entry.header.record_size;
+    if (record_size < sizeof(TraceRecordHeader) + entry.header.request_size || record_size > size_ - position_) {
+        // Zero padding after the last record, or a record the writer never finished
+        return std::nullopt;
+    }
+
+    entry.request = std::span<const std::byte>(view_ + position_ + sizeof(TraceRecordHeader), entry.header.request_size);
+    position_ += record_size;
+    return entry;
+}
@@ -0,0 +1,1162 @@
+#include "pch.h"
+#include "../../inc/transport_server.h"
+#include "../../inc/message_protocol.h"
+#include "../../inc/error_handling.h"
+#include "../utils/metrics.h"
+#include <format>
+#include <cstring>
+
+using namespace vibedbg::communication;
+using vibedbg::utils::MetricsRegistry;
+
+/**
+ * @brief Constructs the transport-independent part of a server.
+ * 
+ * @param[in] config Settings shared by every transport
+ */
+TransportServer::TransportServer(const TransportConfig& config)
+    : transport_config_(config) {
+    start_time_.store(std::chrono::steady_clock::now().time_since_epoch().count());
+}
+
+/**
+ * @brief Destructor; the transport's own destructor has already stopped it.
+ */
+TransportServer::~TransportServer() = default;
+
+/**
+ * @brief Starts the request workers and the event thread.
+ * 
+ * Called by the transport's start() once running_ is set and before its
+ * first connection is accepted.
+ */
+void TransportServer::start_workers() {
+    start_time_.store(std::chrono::steady_clock::now().time_since_epoch().count());
+    
+    // A trace that cannot be created is logged but does not stop the server
+    if (!transport_config_.trace_path.empty()) {
+        trace_recorder_.open(transport_config_.trace_path);
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(request_mutex_);
+        requests_stopping_ = false;
+    }
+    uint32_t request_workers = transport_config_.request_threads > 0 ? transport_config_.request_threads : 1;
+    for (uint32_t i = 0; i < request_workers; ++i) {
+        request_threads_.emplace_back(&TransportServer::request_worker_loop, this);
+    }
+    event_thread_ = std::thread(&TransportServer::event_writer_loop, this);
+}
+
+/**
+ * @brief Stops the event thread; called once running_ has been cleared.
+ */
+void TransportServer::stop_events() {
+    // Taking the lock orders the store before the event thread's next wait
+    {
+        std::lock_guard<std::mutex> lock(event_mutex_);
+    }
+    event_cv_.notify_all();
+    if (event_thread_.joinable()) {
+        event_thread_.join();
+    }
+}
+
+/**
+ * @brief Stops the request workers and drops every connection.
+ * 
+ * Called once no connection reads frames any more; the requests already
+ * read are answered first.
+ */
+void TransportServer::stop_workers() {
+    stop_request_workers();
+    cleanup_disconnected_connections();
+    
+    // No worker is left to append to the trace
+    trace_recorder_.close();
+}
+
+/**
+ * @brief Registers an accepted connection.
+ * 
+ * @param[in] connection Connection to serve
+ */
+void TransportServer::add_connection(std::shared_ptr<ClientConnection> connection) {
+    {
+        std::unique_lock<std::shared_mutex> lock(connections_mutex_);
+        // A connection past the limit is still read once, so the client gets
+        // a Busy error with a retry hint rather than a pipe that never opens
+        size_t active = std::count_if(connections_.begin(), connections_.end(), [](const auto& existing) {
+            return existing && existing->is_active() && !existing->is_refused();
+        });
+        if (active >= transport_config_.max_connections) {
+            connection->set_refused();
+            MetricsRegistry::instance().increment(MetricsRegistry::Counter::ConnectionsRejected);
+        }
+        connections_.push_back(std::move(connection));
+    }
+    update_stats_on_connection();
+}
+
+/**
+ * @brief Lets every message through; transports that authenticate override it.
+ * 
+ * @param[in,out] client Connection the message was received on
+ * @param[in] message Decoded frame
+ * 
+ * @return true to answer the message, false to drop the connection
+ */
+bool TransportServer::admit_message(
+    _Inout_ [[maybe_unused]] ClientConnection& client,
+    _In_ [[maybe_unused]] const DecodedMessage& message) {
+    return true;
+}
+
+/**
+ * @brief Gets a list of active connection IDs.
+ * 
+ * This method returns the IDs of all currently active client connections.
+ * The list is thread-safe and provides a snapshot of the current state.
+ * 
+ * @return Vector of connection ID strings
+ */
+std::vector<std::string> TransportServer::get_active_connection_ids() const {
+    std::shared_lock<std::shared_mutex> lock(connections_mutex_);
+    
+    std::vector<std::string> connection_ids;
+    for (const auto& connection : connections_) {
+        if (connection && connection->is_active()) {
+            connection_ids.push_back(connection->get_id());
+        }
+    }
+    
+    return connection_ids;
+}
+
+/**
+ * @brief Gets current server statistics.
+ * 
+ * This method returns a snapshot of the current server statistics including
+ * uptime, connection counts, and message processing statistics.
+ * 
+ * @return ServerStats structure containing current statistics
+ */
+TransportServer::ServerStats TransportServer::get_stats() const {
+    using Counter = MetricsRegistry::Counter;
+    auto& metrics = MetricsRegistry::instance();
+    
+    ServerStats current_stats;
+    current_stats.total_connections = metrics.value(Counter::PipeConnections);
+    uint64_t disconnections = metrics.value(Counter::PipeDisconnections);
+    current_stats.active_connections = current_stats.total_connections > disconnections
+        ? current_stats.total_connections - disconnections : 0;
+    current_stats.total_messages_processed = metrics.value(Counter::PipeMessages);
+    current_stats.total_errors = metrics.value(Counter::PipeErrors);
+    current_stats.rejected_requests = metrics.value(Counter::RequestsRejected);
+    current_stats.rejected_connections = metrics.value(Counter::ConnectionsRejected);
+    current_stats.queued_requests = queued_request_count();
+    current_stats.retry_after = retry_after(current_stats.queued_requests);
+    current_stats.start_time = std::chrono::steady_clock::time_point(
+        std::chrono::steady_clock::duration(start_time_.load()));
+    current_stats.uptime = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - current_stats.start_time);
+    return current_stats;
+}
+
+/**
+ * @brief Request worker loop.
+ * 
+ * Runs the queued requests of every connection until stop_request_workers()
+ * is called and the queue is empty.
+ * 
+ * @note This method runs in a request worker thread and should not be called directly.
+ */
+void TransportServer::request_worker_loop() {
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(request_mutex_);
+            request_cv_.wait(lock, [this] { return requests_stopping_ || !request_queue_.empty(); });
+            if (request_queue_.empty()) {
+                return;
+            }
+            job = std::move(request_queue_.front());
+            request_queue_.pop_front();
+        }
+        job();
+    }
+}
+
+/**
+ * @brief Queues a request for the workers unless max_queued_requests are waiting.
+ * 
+ * @param[in] job Request to run
+ * @param[out] depth Requests waiting when the job was offered
+ * 
+ * @return true if the job was queued
+ */
+bool TransportServer::try_submit_request(std::function<void()> job, size_t* depth) {
+    {
+        std::lock_guard<std::mutex> lock(request_mutex_);
+        *depth = request_queue_.size();
+        if (transport_config_.max_queued_requests > 0 && *depth >= transport_config_.max_queued_requests) {
+            return false;
+        }
+        request_queue_.push_back(std::move(job));
+    }
+    request_cv_.notify_one();
+    return true;
+}
+
+size_t TransportServer::queued_request_count() const {
+    std::lock_guard<std::mutex> lock(request_mutex_);
+    return request_queue_.size();
+}
+
+void TransportServer::stop_request_workers() {
+    {
+        std::lock_guard<std::mutex> lock(request_mutex_);
+        requests_stopping_ = true;
+    }
+    request_cv_.notify_all();
+    for (auto& thread : request_threads_) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    request_threads_.clear();
+}
+
+/**
+ * @brief Dispatches every complete frame buffered on a connection.
+ * 
+ * Several requests may arrive in a single read, and one request may span
+ * several reads; the connection's framer resolves both cases. Frames are
+ * read in arrival order; commands are answered as they complete, which is
+ * not arrival order once more than one may be in flight.
+ * 
+ * @param[in,out] client Connection whose buffered frames should be processed
+ * 
+ * @return PipeServerError::None on success, appropriate error code on failure
+ */
+PipeServerError TransportServer::process_buffered_messages(_Inout_ ClientConnection& client) {
+    while (true) {
+        ErrorCode frame_error = ErrorCode::None;
+        auto frame = client.next_message(&frame_error);
+        
+        if (frame_error != ErrorCode::None) {
+            // The stream cannot be resynchronised after an oversized frame
+            CommandResponse error_response;
+            error_response.success = false;
+            error_response.error_message = "Message exceeds maximum size";
+            error_response.request_id = "unknown";
+            
+            std::vector<std::byte> response_data = MessageProtocol::serialize_response(error_response, client.get_wire_format());
+            client.write_message(response_data, transport_config_.write_timeout);
+            update_stats_on_error();
+            return PipeServerError::ReadFailed;
+        }
+        
+        if (!frame) {
+            return PipeServerError::None;
+        }
+        
+        PipeServerError error = dispatch_message(client, *frame);
+        if (error != PipeServerError::None) {
+            return error;
+        }
+    }
+}
+
+/**
+ * @brief Parses a single message and answers or dispatches it.
+ * 
+ * Shared by every transport. Heartbeats, subscriptions and
+ * frames that fail to parse are answered at once. A command is handed to the
+ * request workers while the connection has fewer than max_in_flight
+ * requests outstanding. With max_in_flight at 1 the command runs here, and
+ * responses keep the order of the requests.
+ * 
+ * Admission control answers a command with a Busy error instead of
+ * queueing it when the connection already has max_in_flight outstanding,
+ * max_queued_requests wait for a worker, or max_engine_queue jobs wait for the
+ * engine. A connection accepted past max_connections gets Busy for its
+ * first frame and is dropped.
+ * 
+ * @param[in,out] client Connection the message was received on
+ * @param[in] message_data Complete frame, including its delimiter
+ * 
+ * @return PipeServerError::None on success, appropriate error code on failure
+ */
+PipeServerError TransportServer::dispatch_message(
+    _Inout_ ClientConnection& client,
+    _In_ std::span<const std::byte> message_data) {
+    try {
+        auto received_at = std::chrono::steady_clock::now();
+        utils::TraceActivity read_activity = client.take_read_activity();
+        utils::TraceActivity parse_activity(utils::TraceStage::Parse, {});
+        
+        // Decode the frame; the response mirrors the request's wire format
+        ErrorCode parse_error = ErrorCode::None;
+        DecodedMessage message = MessageProtocol::decode_message(message_data, &parse_error);
+        
+        CommandRequest request;
+        if (parse_error == ErrorCode::None) {
+            client.set_wire_format(message.format);
+            
+            if (!admit_message(client, message)) {
+                return PipeServerError::Disconnected;
+            }
+            
+            if (client.is_refused()) {
+                std::string request_id = message.payload.is_object() ? message.payload.value("request_id", std::string()) : std::string();
+                refuse_busy(client, request_id, "connections", transport_config_.max_connections,
+                            transport_config_.max_connections);
+                return PipeServerError::Disconnected;
+            }
+            
+            if (message.type == MessageType::Heartbeat) {
+                return answer_heartbeat(client, message);
+            }
+            
+            if (message.type == MessageType::Subscribe) {
+                return answer_subscribe(client, message);
+            }
+            
+            request = MessageProtocol::parse_command(message, &parse_error);
+        }
+        
+        // The read and the parse are only keyed once the request id is known
+        read_activity.set_request_id(request.request_id);
+        parse_activity.set_request_id(request.request_id);
+        if (parse_error != ErrorCode::None) {
+            parse_activity.set_failed();
+        }
+        parse_activity.stop();
+        read_activity.stop();
+        
+        if (parse_error != ErrorCode::None) {
+            // If parsing failed, create error response
+            CommandResponse error_response;
+            error_response.success = false;
+            error_response.error_message = "Failed to parse command";
+            error_response.request_id = "unknown";
+            
+            std::vector<std::byte> response_data = MessageProtocol::serialize_response(error_response, client.get_wire_format());
+            PipeServerError send_error = client.write_message(response_data, transport_config_.write_timeout);
+            return send_error == PipeServerError::None ? PipeServerError::None : send_error;
+        }
+        
+        // The engine runs one job at a time; past this many waiting, a new
+        // request would only wait longer than the client is prepared to
+        if (load_probe_ && transport_config_.max_engine_queue > 0) {
+            size_t engine_depth = load_probe_();
+            if (engine_depth >= transport_config_.max_engine_queue) {
+                return refuse_busy(client, request.request_id, "engine_queue", engine_depth,
+                                   transport_config_.max_engine_queue);
+            }
+        }
+        
+        if (transport_config_.max_in_flight <= 1) {
+            return answer_command(client, request, message.format, received_at, message_data);
+        }
+        
+        if (!client.try_begin_request(transport_config_.max_in_flight)) {
+            if (!client.is_open()) {
+                return PipeServerError::Disconnected;
+            }
+            return refuse_busy(client, request.request_id, "connection_queue", transport_config_.max_in_flight,
+                               transport_config_.max_in_flight);
+        }
+        
+        // The frame's bytes belong to the framer; only a recorded trace needs them later
+        std::vector<std::byte> recorded;
+        if (trace_recorder_.is_open()) {
+            recorded.assign(message_data.begin(), message_data.end());
+        }
+        std::string request_id = request.request_id;
+        size_t depth = 0;
+        bool queued = try_submit_request([this, connection = client.shared_from_this(), request = std::move(request),
+                                          format = message.format, received_at, recorded = std::move(recorded)]() {
+            if (answer_command(*connection, request, format, received_at, recorded) != PipeServerError::None) {
+                // Its read may still be outstanding; the read path drops it
+                connection->request_close();
+            }
+            connection->end_request();
+        }, &depth);
+        if (!queued) {
+            client.end_request();
+            return refuse_busy(client, request_id, "server_queue", depth, transport_config_.max_queued_requests);
+        }
+        return PipeServerError::None;
+        
+    } catch (...) {
+        return PipeServerError::WriteFailed;
+    }
+}
+
+/**
+ * @brief Executes a command and writes its response.
+ * 
+ * For requests with the stream flag the handler may first emit any number of
+ * chunk frames; the final frame's sequence is the number of chunks that
+ * preceded it. Every frame carries the request id, so chunks of concurrent
+ * requests may interleave.
+ * 
+ * @param[in,out] client Connection the command was received on
+ * @param[in] request Parsed command
+ * @param[in] format Wire format of the request, which the response mirrors
+ * @param[in] received_at When the frame was taken from the framer
+ * @param[in] message_data The request frame; empty unless a trace is recorded
+ * 
+ * @return PipeServerError::None on success, appropriate error code on failure
+ */
+PipeServerError TransportServer::answer_command(
+    _Inout_ ClientConnection& client,
+    _In_ const CommandRequest& request,
+    _In_ const WireFormat& format,
+    _In_ std::chrono::steady_clock::time_point received_at,
+    _In_ std::span<const std::byte> message_data) {
+    try {
+        // Streamed requests get their output as chunk frames while the command
+        // runs; the final response frame then only carries what is left
+        uint32_t chunks_sent = 0;
+        uint64_t response_bytes = 0;
+        ChunkWriter write_chunk;
+        if (request.stream) {
+            write_chunk = [this, &client, &request, &format, &chunks_sent, &response_bytes](std::string_view chunk) {
+                CommandResponse chunk_response;
+                chunk_response.request_id = request.request_id;
+                chunk_response.success = true;
+                chunk_response.output = chunk;
+                chunk_response.sequence = chunks_sent;
+                chunk_response.final = false;
+                chunk_response.timestamp = std::chrono::steady_clock::now();
+                
+                std::vector<std::byte> chunk_data;
+                {
+                    utils::StageTimer serialize_timer(MetricsRegistry::Stage::Serialization);
+                    utils::TraceActivity serialize_activity(utils::TraceStage::Serialize, request.request_id);
+                    chunk_data = MessageProtocol::serialize_response(chunk_response, format);
+                }
+                if (chunk_data.empty()) {
+                    return false;
+                }
+                utils::TraceActivity write_activity(utils::TraceStage::Write, request.request_id);
+                if (client.write_message(chunk_data, transport_config_.write_timeout) != PipeServerError::None) {
+                    write_activity.set_failed();
+                    return false;
+                }
+                chunks_sent++;
+                response_bytes += chunk_data.size();
+                return true;
+            };
+        }
+        
+        // Handle the command
+        ErrorCode cmd_error = ErrorCode::None;
+        CommandResponse response = handle_command(request, write_chunk, &cmd_error);
+        response.sequence = chunks_sent;
+        response.final = true;
+        
+        // Properly serialize the response using MessageProtocol
+        std::vector<std::byte> response_data;
+        {
+            utils::StageTimer serialize_timer(MetricsRegistry::Stage::Serialization);
+            utils::TraceActivity serialize_activity(utils::TraceStage::Serialize, request.request_id);
+            response_data = MessageProtocol::serialize_response(response, format, &cmd_error);
+            if (cmd_error != ErrorCode::None) {
+                serialize_activity.set_failed();
+            }
+        }
+        if (cmd_error != ErrorCode::None) {
+            // If serialization failed, create a simple error response
+            std::string error_response = R"({"protocol_version":1,"message_type":3,"payload":{"type":"error","error_message":"Failed to serialize response"}})";
+            error_response += "\r\n\r\n";
+            response_data.resize(error_response.size());
+            std::memcpy(response_data.data(), error_response.data(), error_response.size());
+        }
+        
+        utils::TraceActivity write_activity(utils::TraceStage::Write, request.request_id);
+        PipeServerError send_error = client.write_message(response_data, transport_config_.write_timeout);
+        if (send_error != PipeServerError::None) {
+            write_activity.set_failed();
+            return send_error;
+        }
+        write_activity.stop();
+        
+        auto completed_at = std::chrono::steady_clock::now();
+        if (trace_recorder_.is_open() && !message_data.empty()) {
+            TraceOutcome outcome;
+            outcome.received_at = received_at;
+            outcome.completed_at = completed_at;
+            outcome.response_bytes = response_bytes + response_data.size();
+            outcome.chunk_count = chunks_sent;
+            outcome.connection = static_cast<uint32_t>(std::hash<std::string>{}(client.get_id()));
+            outcome.success = response.success;
+            trace_recorder_.append(message_data, outcome);
+        }
+        
+        MetricsRegistry::instance().record(MetricsRegistry::Stage::Request, completed_at - received_at);
+        record_request_time(completed_at - received_at);
+        update_stats_on_message();
+        return PipeServerError::None;
+        
+    } catch (...) {
+        return PipeServerError::WriteFailed;
+    }
+}
+
+/**
+ * @brief Answers a request that admission control refused with a Busy error.
+ * 
+ * The error's details name the limit that was hit and carry retry_after_ms,
+ * so the client backs off for about as long as the work ahead of it takes
+ * instead of resending at once.
+ * 
+ * @param[in,out] client Connection the request was received on
+ * @param[in] request_id Id of the refused request; empty if it had none
+ * @param[in] reason "connections", "connection_queue", "server_queue" or "engine_queue"
+ * @param[in] depth Occupancy of the limit that was hit
+ * @param[in] limit The configured limit
+ * 
+ * @return PipeServerError::None once the error is written, the write's error otherwise
+ */
+PipeServerError TransportServer::refuse_busy(
+    _Inout_ ClientConnection& client,
+    _In_ const std::string& request_id,
+    _In_ std::string_view reason,
+    _In_ size_t depth,
+    _In_ size_t limit) {
+    auto retry = retry_after(depth);
+    ErrorMessage busy = MessageProtocol::create_error_message(
+        request_id, ErrorCode::Busy, std::format("Server busy: {} at its limit of {}", reason, limit));
+    busy.details = json{
+        {"reason", reason},
+        {"retry_after_ms", retry.count()},
+        {"depth", depth},
+        {"limit", limit}
+    };
+    MetricsRegistry::instance().increment(MetricsRegistry::Counter::RequestsRejected);
+    
+    std::vector<std::byte> error_data = MessageProtocol::serialize_error(busy, client.get_wire_format());
+    return client.write_message(error_data, transport_config_.write_timeout);
+}
+
+/**
+ * @brief Estimates how long a refused client should wait before retrying.
+ * 
+ * The moving average of request times, scaled by how many rounds of
+ * the worker pool the waiting requests take, kept between MIN_RETRY_AFTER
+ * and MAX_RETRY_AFTER.
+ * 
+ * @param[in] depth Requests ahead of the one refused
+ * 
+ * @return Retry hint for a Busy error
+ */
+std::chrono::milliseconds TransportServer::retry_after(_In_ size_t depth) const {
+    size_t workers = (std::max)(transport_config_.request_threads, 1u);
+    auto average = std::chrono::microseconds(average_request_us_.load(std::memory_order_relaxed));
+    auto estimate = std::chrono::duration_cast<std::chrono::milliseconds>(
+        average * static_cast<int64_t>(depth / workers + 1));
+    return std::clamp(estimate, MIN_RETRY_AFTER, MAX_RETRY_AFTER);
+}
+
+/**
+ * @brief Folds an answered request's time into the moving average, weighted 1/8.
+ * 
+ * @param[in] elapsed From the request's arrival until its response was written
+ */
+void TransportServer::record_request_time(_In_ std::chrono::steady_clock::duration elapsed) {
+    int64_t sample = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+    int64_t average = average_request_us_.load(std::memory_order_relaxed);
+    while (!average_request_us_.compare_exchange_weak(average, average + (sample - average) / 8,
+                                                      std::memory_order_relaxed)) {
+    }
+}
+
+/**
+ * @brief Answers a client heartbeat with the server's capabilities.
+ * 
+ * Clients use the heartbeat exchange to negotiate: they send a v1 heartbeat
+ * listing the protocol versions they support and switch to the highest
+ * version both sides advertise.
+ * 
+ * @param[in,out] client Connection the heartbeat was received on
+ * @param[in] message Decoded heartbeat frame
+ * 
+ * @return PipeServerError::None on success, appropriate error code on failure
+ */
+PipeServerError TransportServer::answer_heartbeat(
+    _Inout_ ClientConnection& client,
+    _In_ [[maybe_unused]] const DecodedMessage& message) {
+    HeartbeatMessage heartbeat;
+    heartbeat.session_info = build_capabilities();
+    heartbeat.timestamp = std::chrono::steady_clock::now();
+    
+    std::vector<std::byte> heartbeat_data = MessageProtocol::serialize_heartbeat(heartbeat, client.get_wire_format());
+    PipeServerError send_error = client.write_message(heartbeat_data, transport_config_.write_timeout);
+    if (send_error == PipeServerError::None) {
+        update_stats_on_message();
+    }
+    return send_error;
+}
+
+/**
+ * @brief Replaces the set of events pushed to a connection.
+ * 
+ * The reply is a response frame whose data lists the events now subscribed
+ * to; an empty list unsubscribes. Event frames may reach the client before
+ * the reply, and between the frames of any later response.
+ * 
+ * @param[in,out] client Connection the subscription was received on
+ * @param[in] message Decoded subscribe frame
+ * 
+ * @return PipeServerError::None on success, appropriate error code on failure
+ */
+PipeServerError TransportServer::answer_subscribe(
+    _Inout_ ClientConnection& client,
+    _In_ const DecodedMessage& message) {
+    ErrorCode parse_error = ErrorCode::None;
+    SubscribeRequest request = MessageProtocol::parse_subscribe(message, &parse_error);
+    
+    CommandResponse response;
+    response.request_id = request.request_id;
+    response.timestamp = std::chrono::steady_clock::now();
+    
+    uint32_t kinds = 0;
+    for (const auto& name : request.events) {
+        auto kind = MessageProtocol::parse_event_name(name);
+        if (!kind) {
+            response.error_message = "Unknown event: " + name;
+            break;
+        }
+        kinds |= static_cast<uint32_t>(*kind);
+    }
+    
+    if (parse_error != ErrorCode::None) {
+        response.error_message = "Failed to parse subscription";
+    } else if (response.error_message.empty()) {
+        client.subscribe(kinds, client.get_wire_format());
+        update_subscribed_events();
+        
+        json events = json::array();
+        for (uint32_t bit = 1; bit != 0 && bit <= kinds; bit <<= 1) {
+            if (kinds & bit) {
+                events.push_back(MessageProtocol::event_name(static_cast<EventKind>(bit)));
+            }
+        }
+        response.success = true;
+        response.data = {{"events", std::move(events)}};
+    }
+    
+    std::vector<std::byte> response_data = MessageProtocol::serialize_response(response, client.get_wire_format());
+    PipeServerError send_error = client.write_message(response_data, transport_config_.write_timeout);
+    if (send_error == PipeServerError::None) {
+        update_stats_on_message();
+    }
+    return send_error;
+}
+
+/**
+ * @brief Queues an event for every connection subscribed to its kind.
+ * 
+ * Only the queueing happens on the caller's thread; the event thread
+ * serializes and writes the frames, so a client that reads slowly never
+ * holds up the debugger engine.
+ * 
+ * @param[in] kind Kind of the event
+ * @param[in] build_data Builds the event's data; not called when nobody subscribed
+ */
+void TransportServer::publish_event(_In_ EventKind kind, _In_ const EventBuilder& build_data) {
+    uint32_t bit = static_cast<uint32_t>(kind);
+    if (!running_.load() || (subscribed_events_.load(std::memory_order_relaxed) & bit) == 0) {
+        return;
+    }
+    
+    EventMessage event;
+    event.kind = kind;
+    event.data = build_data ? build_data() : json::object();
+    event.timestamp = std::chrono::steady_clock::now();
+    
+    bool queued = false;
+    {
+        std::shared_lock<std::shared_mutex> lock(connections_mutex_);
+        for (const auto& connection : connections_) {
+            if (connection && connection->is_active() && (connection->get_subscriptions() & bit) != 0) {
+                connection->queue_event(event, transport_config_.max_pending_events);
+                queued = true;
+            }
+        }
+    }
+    
+    if (queued) {
+        {
+            std::lock_guard<std::mutex> lock(event_mutex_);
+            events_pending_ = true;
+        }
+        event_cv_.notify_one();
+    }
+}
+
+/**
+ * @brief Writes queued events to their connections until the server stops.
+ * 
+ * @note This method runs in the event thread and should not be called directly.
+ */
+void TransportServer::event_writer_loop() {
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(event_mutex_);
+            event_cv_.wait(lock, [this] { return events_pending_ || !running_.load(); });
+            if (!running_.load()) {
+                return;
+            }
+            events_pending_ = false;
+        }
+        
+        std::vector<std::shared_ptr<ClientConnection>> subscribers;
+        {
+            std::shared_lock<std::shared_mutex> lock(connections_mutex_);
+            for (const auto& connection : connections_) {
+                if (connection && connection->is_active() && connection->get_subscriptions() != 0) {
+                    subscribers.push_back(connection);
+                }
+            }
+        }
+        
+        for (const auto& subscriber : subscribers) {
+            write_events(*subscriber);
+        }
+    }
+}
+
+/**
+ * @brief Writes the events queued for one connection.
+ * 
+ * A write that fails asks the connection's read path to close it; the
+ * events not written are lost with it. The event thread never drops the
+ * connection itself, as a read of it may still be outstanding.
+ * 
+ * @param[in,out] client Subscribed connection
+ */
+void TransportServer::write_events(_Inout_ ClientConnection& client) {
+    WireFormat format;
+    std::vector<EventMessage> events = client.take_events(&format);
+    
+    for (const auto& event : events) {
+        std::vector<std::byte> event_data;
+        {
+            utils::StageTimer serialize_timer(MetricsRegistry::Stage::Serialization);
+            event_data = MessageProtocol::serialize_event(event, format);
+        }
+        if (event_data.empty()) {
+            continue;
+        }
+        if (client.write_message(event_data, transport_config_.write_timeout) != PipeServerError::None) {
+            update_stats_on_error();
+            client.request_close();
+            return;
+        }
+        MetricsRegistry::instance().increment(MetricsRegistry::Counter::EventsPushed);
+    }
+}
+
+/**
+ * @brief Recomputes the events any connection is subscribed to.
+ * 
+ * publish_event reads the result without a lock to skip events nobody
+ * listens to.
+ */
+void TransportServer::update_subscribed_events() {
+    uint32_t kinds = 0;
+    {
+        std::shared_lock<std::shared_mutex> lock(connections_mutex_);
+        for (const auto& connection : connections_) {
+            if (connection && connection->is_active()) {
+                kinds |= connection->get_subscriptions();
+            }
+        }
+    }
+    subscribed_events_.store(kinds, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Describes the protocol features this server supports.
+ * 
+ * @return JSON object advertised in heartbeat responses
+ */
+json TransportServer::build_capabilities() const {
+    return json{
+        {"protocol_versions", json::array({MessageProtocol::PROTOCOL_VERSION_V1,
+                                           MessageProtocol::PROTOCOL_VERSION_V2})},
+        {"encodings", json::array({MessageProtocol::encoding_name(PayloadEncoding::Json),
+                                   MessageProtocol::encoding_name(PayloadEncoding::MessagePack),
+                                   MessageProtocol::encoding_name(PayloadEncoding::Cbor)})},
+        {"max_message_size", MessageProtocol::MAX_MESSAGE_SIZE},
+        {"max_in_flight", (std::max)(transport_config_.max_in_flight, 1u)},
+        {"max_queued_requests", transport_config_.max_queued_requests},
+        {"queued_requests", queued_request_count()},
+        {"retry_after_ms", retry_after(queued_request_count()).count()}
+    };
+}
+
+/**
+ * @brief Cleans up disconnected client connections.
+ * 
+ * This method removes all inactive client connections from the connections
+ * list. Only a read path marks a connection inactive, once no read of it is
+ * outstanding, so no connection is erased under a pending read.
+ */
+void TransportServer::cleanup_disconnected_connections() {
+    {
+        std::unique_lock<std::shared_mutex> lock(connections_mutex_);
+        
+        connections_.erase(
+            std::remove_if(connections_.begin(), connections_.end(),
+                [](const std::shared_ptr<ClientConnection>& conn) {
+                    return !conn || !conn->is_active();
+                }),
+            connections_.end());
+    }
+    
+    update_subscribed_events();
+}
+
+/**
+ * @brief Updates statistics when a new connection is established.
+ */
+void TransportServer::update_stats_on_connection() {
+    MetricsRegistry::instance().increment(MetricsRegistry::Counter::PipeConnections);
+}
+
+/**
+ * @brief Updates statistics when a connection is closed.
+ * 
+ * Active connections are the difference between the two counters.
+ */
+void TransportServer::update_stats_on_disconnection() {
+    MetricsRegistry::instance().increment(MetricsRegistry::Counter::PipeDisconnections);
+}
+
+/**
+ * @brief Updates statistics when a message is processed.
+ */
+void TransportServer::update_stats_on_message() {
+    MetricsRegistry::instance().increment(MetricsRegistry::Counter::PipeMessages);
+}
+
+/**
+ * @brief Updates statistics when an error occurs.
+ */
+void TransportServer::update_stats_on_error() {
+    MetricsRegistry::instance().increment(MetricsRegistry::Counter::PipeErrors);
+}
+
+/**
+ * @brief Handles a command request using the configured message handler.
+ * 
+ * This method delegates command processing to the configured message handler.
+ * If no handler is configured, it returns a default error response.
+ * 
+ * @param[in] request The command request to handle
+ * @param[in] write_chunk Writer for streamed output chunks; empty for non-streamed requests
+ * @param[out] error Optional pointer to receive error information
+ * 
+ * @return CommandResponse containing the result of command execution
+ */
+CommandResponse TransportServer::handle_command(
+    _In_ const CommandRequest& request, 
+    _In_ const ChunkWriter& write_chunk,
+    _Out_opt_ ErrorCode* error) {
+    if (message_handler_) {
+        return message_handler_(request, write_chunk, error);
+    }
+    
+    // Default response when no handler is set
+    CommandResponse response;
+    response.success = false;
+    response.error_message = "No message handler configured";
+    if (error) *error = ErrorCode::InternalError;
+    return response;
+}
+
+// ClientConnection implementation
+
+/**
+ * @brief Constructs the transport-independent part of a connection.
+ * 
+ * @param[in] connection_id Unique identifier for this connection
+ */
+ClientConnection::ClientConnection(_In_ const std::string& connection_id)
+    : active_(true)
+    , framer_(READ_CHUNK_SIZE)
+    , connection_id_(connection_id) {
+    connection_time_ = std::chrono::steady_clock::now();
+    last_activity_.store(connection_time_.time_since_epoch().count());
+}
+
+ClientConnection::~ClientConnection() = default;
+
+// Read path only, once no read of the connection is outstanding
+void ClientConnection::mark_inactive() {
+    active_.store(false);
+}
+
+/**
+ * @brief Asks the read path to close the connection.
+ * 
+ * Called by writers that found the connection broken. Writes and new
+ * requests stop at once; the outstanding read is cancelled, and its
+ * completion closes the connection while the connection is still owned.
+ */
+void ClientConnection::request_close() {
+    closing_.store(true);
+    cancel_read();
+}
+
+/**
+ * @brief Takes one of the connection's request slots.
+ * 
+ * Never waits: a client that pipelines more than max_in_flight requests
+ * has the extra ones refused, which a blocked reader could not tell it.
+ * 
+ * @param[in] max_in_flight Requests the connection may have outstanding
+ * 
+ * @return true if a slot was taken, false if none is free or the connection is closing
+ */
+bool ClientConnection::try_begin_request(_In_ uint32_t max_in_flight) {
+    std::lock_guard<std::mutex> lock(requests_mutex_);
+    if (!is_open() || requests_in_flight_ >= max_in_flight) {
+        return false;
+    }
+    ++requests_in_flight_;
+    return true;
+}
+
+void ClientConnection::end_request() {
+    std::lock_guard<std::mutex> lock(requests_mutex_);
+    --requests_in_flight_;
+}
+
+/**
+ * @brief Returns the next complete frame received on this connection.
+ * 
+ * @param[out] error Optional pointer to receive error information
+ * 
+ * @return View of the frame, valid until the next receive, or std::nullopt
+ */
+std::optional<std::span<const std::byte>> ClientConnection::next_message(_Out_opt_ ErrorCode* error) {
+    auto frame = framer_.next_frame(error);
+    if (frame) {
+        messages_received_.fetch_add(1, std::memory_order_relaxed);
+        MetricsRegistry::instance().increment(MetricsRegistry::Counter::FramesReceived);
+        
+        // Bytes left over belong to the next frame, which has started arriving
+        completed_read_ = std::move(read_activity_);
+        if (framer_.has_partial_frame()) {
+            read_activity_ = utils::TraceActivity(utils::TraceStage::PipeRead, {});
+        }
+    }
+    return frame;
+}
+
+/**
+ * @brief Writes a message to the client connection.
+ * 
+ * Writes are serialized, as pushed events are written from the event
+ * thread while a response may be written from a request worker. The
+ * transport decides how the timeout bounds the write.
+ * 
+ * @param[in] data Data to write to the client
+ * @param[in] timeout Maximum time to wait for write completion
+ * 
+ * @return PipeServerError::None on success, PipeServerError::Timeout if the
+ *         write did not complete in time, appropriate error code on failure
+ */
+PipeServerError ClientConnection::write_message(
+    _In_ std::span<const std::byte> data, 
+    _In_ std::chrono::milliseconds timeout) {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    if (!is_open()) {
+        return PipeServerError::Disconnected;
+    }
+    
+    utils::StageTimer write_timer(MetricsRegistry::Stage::PipeWrite);
+    PipeServerError error = write_bytes(data, timeout);
+    if (error == PipeServerError::None) {
+        update_write_stats(data.size());
+    }
+    return error;
+}
+
+/**
+ * @brief Replaces the events pushed to this connection.
+ * 
+ * @param[in] kinds EventKind bits; 0 unsubscribes and discards pending events
+ * @param[in] format Wire format the event frames are written in
+ */
+void ClientConnection::subscribe(_In_ uint32_t kinds, _In_ const WireFormat& format) {
+    std::lock_guard<std::mutex> lock(events_mutex_);
+    event_format_ = format;
+    subscriptions_.store(kinds);
+    if (kinds == 0) {
+        pending_events_.clear();
+        events_dropped_ = 0;
+    }
+}
+
+/**
+ * @brief Queues an event until the event thread writes it.
+ * 
+ * A state change or symbol load progress event still pending is replaced,
+ * since only the latest of those matters. When max_pending events are
+ * already waiting the oldest is dropped; the next event delivered says how
+ * many were.
+ * 
+ * @param[in] event Event to deliver
+ * @param[in] max_pending Events this connection may have waiting; 0 for no limit
+ */
+void ClientConnection::queue_event(_In_ EventMessage event, _In_ size_t max_pending) {
+    std::lock_guard<std::mutex> lock(events_mutex_);
+    
+    if (event.kind == EventKind::StateChange || event.kind == EventKind::SymbolLoad) {
+        auto previous = std::find_if(pending_events_.begin(), pending_events_.end(),
+                                     [kind = event.kind](const EventMessage& pending) { return pending.kind == kind; });
+        if (previous != pending_events_.end()) {
+            event.coalesced = previous->coalesced + 1;
+            pending_events_.erase(previous);
+        }
+    }
+    
+    if (max_pending > 0 && pending_events_.size() >= max_pending) {
+        pending_events_.pop_front();
+        ++events_dropped_;
+        MetricsRegistry::instance().increment(MetricsRegistry::Counter::EventsDropped);
+    }
+    pending_events_.push_back(std::move(event));
+}
+
+/**
+ * @brief Takes every pending event, numbered in delivery order.
+ * 
+ * @param[out] format Receives the wire format to write them in
+ * 
+ * @return Events to write, oldest first
+ */
+std::vector<EventMessage> ClientConnection::take_events(_Out_ WireFormat* format) {
+    std::lock_guard<std::mutex> lock(events_mutex_);
+    *format = event_format_;
+    
+    std::vector<EventMessage> events(std::make_move_iterator(pending_events_.begin()),
+                                     std::make_move_iterator(pending_events_.end()));
+    pending_events_.clear();
+    
+    if (!events.empty()) {
+        events.front().dropped = events_dropped_;
+        events_dropped_ = 0;
+    }
+    for (auto& event : events) {
+        event.sequence = events_delivered_++;
+    }
+    return events;
+}
+
+/**
+ * @brief Hands bytes read into the framer's prepared region to the framer.
+ * 
+ * The first bytes of a frame start its PipeRead trace.
+ * 
+ * @param[in] bytes_read Number of bytes placed in the prepared region
+ */
+void ClientConnection::commit_received(_In_ size_t bytes_read) {
+    if (bytes_read == 0) {
+        framer_.commit(0);
+        return;
+    }
+    if (!read_activity_.active()) {
+        read_activity_ = utils::TraceActivity(utils::TraceStage::PipeRead, {});
+    }
+    framer_.commit(bytes_read);
+    update_read_stats(bytes_read);
+}
+
+/**
+ * @brief Copies received bytes into the framer.
+ * 
+ * For transports that cannot receive into the framer directly, such as a
+ * TLS connection, whose bytes arrive only once they are decrypted.
+ * 
+ * @param[in] data Bytes received
+ */
+void ClientConnection::append_received(_In_ std::span<const std::byte> data) {
+    while (!data.empty()) {
+        auto destination = framer_.prepare((std::min)(data.size(), READ_CHUNK_SIZE));
+        size_t bytes = (std::min)(destination.size(), data.size());
+        std::memcpy(destination.data(), data.data(), bytes);
+        commit_received(bytes);
+        data = data.subspan(bytes);
+    }
+}
+
+/**
+ * @brief Updates read statistics for the client connection.
+ * 
+ * @param[in] bytes_read Number of bytes read in the last operation
+ */
+void ClientConnection::update_read_stats(_In_ size_t bytes_read) {
+    bytes_received_.fetch_add(bytes_read, std::memory_order_relaxed);
+    last_activity_.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+    MetricsRegistry::instance().increment(MetricsRegistry::Counter::BytesReceived, bytes_read);
+}
+
+/**
+ * @brief Updates write statistics for the client connection.
+ * 
+ * @param[in] bytes_written Number of bytes written in the last operation
+ */
+void ClientConnection::update_write_stats(_In_ size_t bytes_written) {
+    messages_sent_.fetch_add(1, std::memory_order_relaxed);
+    bytes_sent_.fetch_add(bytes_written, std::memory_order_relaxed);
+    last_activity_.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+    
+    auto& metrics = MetricsRegistry::instance();
+    metrics.increment(MetricsRegistry::Counter::FramesSent);
+    metrics.increment(MetricsRegistry::Counter::BytesSent, bytes_written);
+}
+
+/**
+ * @brief Gets a snapshot of this connection's statistics.
+ * 
+ * @return ConnectionStats with the counts at the time of the call
+ */
+ClientConnection::ConnectionStats ClientConnection::get_stats() const noexcept {
+    ConnectionStats stats;
+    stats.connection_time = connection_time_;
+    stats.messages_received = messages_received_.load(std::memory_order_relaxed);
+    stats.messages_sent = messages_sent_.load(std::memory_order_relaxed);
+    stats.bytes_received = bytes_received_.load(std::memory_order_relaxed);
+    stats.bytes_sent = bytes_sent_.load(std::memory_order_relaxed);
+    stats.last_activity = std::chrono::steady_clock::time_point(
+        std::chrono::steady_clock::duration(last_activity_.load(std::memory_order_relaxed)));
+    return stats;
+}
+
+// Utility functions
+
+/**
+ * @brief Generates a unique connection ID.
+ * 
+ * This function creates a unique identifier for client connections using
+ * a combination of timestamp and atomic counter to ensure uniqueness.
+ * 
+ * @return Unique connection ID string
+ */
+std::string vibedbg::communication::generate_connection_id() {
+    static std::atomic<uint32_t> counter{0};
+    auto timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    
+    return std::format("conn_{}_{}", timestamp, counter.fetch_add(1));
+}
@@ -1,52 +1,271 @@
 #include "pch.h"
 #include "../../inc/command_executor.h"
+#include "../../inc/command_table.h"
 #include "../../inc/error_handling.h"
 #include "../utils/windbg_helpers.h"
+#include "../utils/symbol_cache.h"
+#include "../utils/metrics.h"
+#include "../utils/output_filter.h"
+#include "engine_scheduler.h"
+#include "session_contexts.h"
+#include "request_context.h"
+#include <algorithm>
+#include <array>
+#include <bit>
 
 using namespace vibedbg::core;
 using namespace vibedbg::utils;
 
+namespace {
+    // Read-only output depends on the process, thread and scope frame it was
+    // produced in, so sessions in different contexts never share a result.
+    // Engine thread only
+    std::string result_cache_key(const std::string& command) {
+        HRESULT hr = S_OK;
+        EngineContext context = WinDbgHelpers::get_engine_context(&hr);
+        if (FAILED(hr)) {
+            return command;
+        }
+        return std::format("{}:{}:{}:{:x}:{:x} {}", context.process_id, context.thread_id,
+                           context.frame.FrameNumber, context.frame.InstructionOffset,
+                           context.frame.StackOffset, command);
+    }
+}
+
 CommandExecutor::CommandExecutor(std::shared_ptr<SessionManager> session_manager)
-    : session_manager_(std::move(session_manager))
-    , shutdown_requested_(false) {
-    
-    stats_.start_time = std::chrono::steady_clock::now();
-    start_worker_threads(2); // Start 2 worker threads
+    : session_manager_(std::move(session_manager)) {
+    
+    stats_start_time_.store(std::chrono::steady_clock::now().time_since_epoch().count());
+    
+    // DbgEng is not reentrant; one engine thread runs every command and
+    // SetInterrupt, which is safe from any thread, cancels the running one.
+    // The thread starts with the first command, not here
+    scheduler_ = std::make_unique<EngineScheduler>([] {
+        WinDbgHelpers::interrupt_execution();
+    }, [] {
+        WinDbgHelpers::clear_interrupt();
+    });
+    session_contexts_ = std::make_unique<SessionContexts>();
 }
 
 CommandExecutor::~CommandExecutor() {
-    stop_worker_threads();
+    scheduler_->stop();
 }
 
 CommandResult CommandExecutor::execute_command(std::string_view command, const ExecutionOptions& options, ExecutionError* error) {
     ExecutionError exec_error = ExecutionError::None;
-    CommandResult result = execute_command_internal(command, options, &exec_error);
+    CommandResult result;
+    
+    // Work already running on the engine thread executes nested commands inline
+    if (scheduler_->on_engine_thread()) {
+        result = execute_command_internal(command, options, &exec_error);
+    } else {
+        auto shared_error = std::make_shared<ExecutionError>(ExecutionError::None);
+        result = schedule_command(std::string(command), options, RequestContext::current(), shared_error).get();
+        exec_error = *shared_error;
+    }
+    
     if (error) *error = exec_error;
     return result;
 }
 
 std::future<CommandResult> CommandExecutor::execute_command_async(std::string_view command, const ExecutionOptions& options) {
-    auto promise = std::make_shared<std::promise<CommandResult>>();
+    return schedule_command(std::string(command), options, nullptr,
+                            std::make_shared<ExecutionError>(ExecutionError::None));
+}
+
+BatchResult CommandExecutor::execute_batch(const std::vector<std::string>& commands, 
+                              const ExecutionOptions& options,
+                              ProgressCallback progress_callback,
+                              ExecutionError* error) {
+    if (error) *error = ExecutionError::None;
+    if (scheduler_->on_engine_thread()) {
+        return execute_batch_internal(commands, options, progress_callback);
+    }
+    return schedule_batch(commands, options, std::move(progress_callback), RequestContext::current()).get();
+}
+
+std::future<BatchResult> CommandExecutor::execute_batch_async(const std::vector<std::string>& commands,
+                                    const ExecutionOptions& options,
+                                    ProgressCallback progress_callback) {
+    return schedule_batch(commands, options, std::move(progress_callback), nullptr);
+}
+
+// Exceptions thrown by the work are rethrown to the caller; the context and
+// the session's engine context are reinstalled on the engine thread as for commands
+bool CommandExecutor::execute_on_engine(CommandPriority priority, std::function<void()> work) {
+    if (scheduler_->on_engine_thread()) {
+        work();
+        return true;
+    }
+    
+    auto promise = std::make_shared<std::promise<bool>>();
     auto future = promise->get_future();
+    auto* context = RequestContext::current();
+    std::string_view tag = context ? std::string_view(context->request_id) : std::string_view{};
     
-    // Queue task for worker thread
-    {
-        std::lock_guard<std::mutex> lock(tasks_mutex_);
-        pending_tasks_.push([this, command = std::string(command), options, promise]() {
-            ExecutionError error;
+    auto run = [this, work = std::move(work), promise, context]() {
+        std::optional<RequestScope> scope;
+        if (context) {
+            scope.emplace(*context);
+        }
+        SessionActivation session(*session_contexts_, context ? context->session_id : std::string());
+        try {
+            work();
+            promise->set_value(true);
+        } catch (...) {
+            promise->set_exception(std::current_exception());
+        }
+    };
+    yield_prefetch();
+    scheduler_->submit(priority, std::move(run), [promise]() { promise->set_value(false); }, tag);
+    return future.get();
+}
+
+/**
+ * @brief Queues read-only commands to run while the engine is idle.
+ *
+ * Called when the target stops, ahead of the requests that usually follow a
+ * stop. The commands run in one Background-lane job with the shared engine
+ * context, which every session follows after the target ran, and store their
+ * output in the result cache as any read-only command does. The job gives
+ * up as soon as other work is queued, the target runs again or another
+ * submission yields it; an interrupted command stores nothing. Stops that
+ * arrive while a job is still queued are served by that job.
+ *
+ * @param[in] commands Read-only commands, run in order; others are skipped
+ */
+void CommandExecutor::prefetch(_In_ std::vector<std::string> commands) {
+    if (commands.empty() || prefetch_queued_.exchange(true)) {
+        return;
+    }
+    
+    // The epoch is taken at submission: a yield that arrives before the job
+    // starts still stops it, even if the interrupt found nothing to stop
+    auto run = [this, commands = std::move(commands), epoch = prefetch_epoch_.load()]() {
+        prefetch_queued_.store(false);
+        auto& metrics = MetricsRegistry::instance();
+        SessionActivation session(*session_contexts_, std::string());
+        
+        ExecutionOptions options;
+        options.priority = CommandPriority::Background;
+        prefetching_ = true;
+        for (const auto& command : commands) {
+            if (prefetch_epoch_.load() != epoch || scheduler_->pending_count() > 0 ||
+                session_manager_->get_state()->is_target_running) {
+                metrics.increment(MetricsRegistry::Counter::PrefetchesYielded);
+                break;
+            }
+            if (!command_validation::is_read_only_command(command)) {
+                continue;
+            }
+            ExecutionError error = ExecutionError::None;
             auto result = execute_command_internal(command, options, &error);
-            promise->set_value(result);
-        });
+            if (!result.metadata.value("cache_hit", false)) {
+                metrics.increment(MetricsRegistry::Counter::CommandPrefetches);
+            }
+        }
+        prefetching_ = false;
+        prefetch_jobs_.fetch_sub(1);
+    };
+    auto cancelled = [this]() {
+        prefetch_queued_.store(false);
+        prefetch_jobs_.fetch_sub(1);
+        MetricsRegistry::instance().increment(MetricsRegistry::Counter::PrefetchesYielded);
+    };
+    
+    prefetch_jobs_.fetch_add(1);
+    scheduler_->submit(CommandPriority::Background, std::move(run), std::move(cancelled), PREFETCH_TAG);
+}
+
+// Drops queued prefetch jobs and interrupts a running one, so the work being
+// submitted never waits behind a speculative command. The scheduler checks
+// the running tag and interrupts in one step, so only a prefetch is stopped
+void CommandExecutor::yield_prefetch() {
+    if (prefetch_jobs_.load() > 0) {
+        prefetch_epoch_.fetch_add(1);
+        scheduler_->cancel_tagged(PREFETCH_TAG);
     }
-    tasks_cv_.notify_one();
+}
+
+// Queues a command for the engine thread. Synchronous callers pass their
+// request context: they block on the future, so the context (streaming sink,
+// request id) stays alive and is installed on the engine thread while the
+// command runs, and cancel_request() can find the command by request id.
+std::future<CommandResult> CommandExecutor::schedule_command(std::string command, const ExecutionOptions& options,
+                                                             RequestContext* context,
+                                                             std::shared_ptr<ExecutionError> error) {
+    auto promise = std::make_shared<std::promise<CommandResult>>();
+    auto future = promise->get_future();
+    auto priority = options.priority.value_or(command_validation::get_command_priority(command));
+    std::string_view tag = context ? std::string_view(context->request_id) : std::string_view{};
+    
+    auto run = [this, command, options, promise, error, context]() {
+        std::optional<RequestScope> scope;
+        if (context) {
+            scope.emplace(*context);
+        }
+        SessionActivation session(*session_contexts_, context ? context->session_id : std::string());
+        auto result = execute_command_internal(command, options, error.get());
+        promise->set_value(std::move(result));
+    };
+    auto cancelled = [command, promise, error]() {
+        CommandResult result;
+        result.success = false;
+        result.error_message = "Command cancelled";
+        result.command_executed = command;
+        result.timestamp = std::chrono::steady_clock::now();
+        *error = ExecutionError::Cancelled;
+        promise->set_value(std::move(result));
+    };
     
+    yield_prefetch();
+    scheduler_->submit(priority, std::move(run), std::move(cancelled), tag);
     return future;
 }
 
-BatchResult CommandExecutor::execute_batch(const std::vector<std::string>& commands, 
-                              const ExecutionOptions& options,
-                              ProgressCallback progress_callback,
-                              ExecutionError* error) {
+// Queues a batch as one engine job, so its commands run back-to-back in
+// the lane of its slowest command; a cancelled batch reports every command
+// as skipped
+std::future<BatchResult> CommandExecutor::schedule_batch(const std::vector<std::string>& commands,
+                                                         const ExecutionOptions& options,
+                                                         ProgressCallback progress_callback,
+                                                         RequestContext* context) {
+    auto promise = std::make_shared<std::promise<BatchResult>>();
+    auto future = promise->get_future();
+    
+    CommandPriority priority = CommandPriority::Interactive;
+    if (options.priority) {
+        priority = *options.priority;
+    } else {
+        for (const auto& command : commands) {
+            priority = (std::max)(priority, command_validation::get_command_priority(command));
+        }
+    }
+    std::string_view tag = context ? std::string_view(context->request_id) : std::string_view{};
+    
+    auto run = [this, commands, options, progress_callback, promise, context]() {
+        std::optional<RequestScope> scope;
+        if (context) {
+            scope.emplace(*context);
+        }
+        SessionActivation session(*session_contexts_, context ? context->session_id : std::string());
+        promise->set_value(execute_batch_internal(commands, options, progress_callback));
+    };
+    auto cancelled = [count = commands.size(), promise]() {
+        BatchResult batch_result;
+        batch_result.skipped_commands = count;
+        promise->set_value(std::move(batch_result));
+    };
+    
+    yield_prefetch();
+    scheduler_->submit(priority, std::move(run), std::move(cancelled), tag);
+    return future;
+}
+
+BatchResult CommandExecutor::execute_batch_internal(const std::vector<std::string>& commands,
+                                                    const ExecutionOptions& options,
+                                                    ProgressCallback progress_callback) {
     BatchResult batch_result;
     batch_result.results.reserve(commands.size());
     
@@ -56,8 +275,9 @@ BatchResult CommandExecutor::execute_batch(const std::vector<std::string>& comma
         ExecutionError exec_error;
         auto result = execute_command_internal(commands[i], options, &exec_error);
         
-        batch_result.results.push_back(result);
-        if (result.success) {
+        bool succeeded = result.success;
+        batch_result.results.push_back(std::move(result));
+        if (succeeded) {
             batch_result.successful_commands++;
         } else {
             batch_result.failed_commands++;
@@ -67,6 +287,11 @@ BatchResult CommandExecutor::execute_batch(const std::vector<std::string>& comma
         if (progress_callback) {
             progress_callback(i + 1, commands.size());
         }
+        
+        if (!succeeded && options.stop_on_error) {
+            batch_result.skipped_commands = commands.size() - i - 1;
+            break;
+        }
     }
     
     auto end_time = std::chrono::steady_clock::now();
@@ -74,30 +299,9 @@ BatchResult CommandExecutor::execute_batch(const std::vector<std::string>& comma
         end_time - start_time);
     batch_result.all_successful = (batch_result.failed_commands == 0);
     
-    if (error) *error = ExecutionError::None;
     return batch_result;
 }
 
-std::future<BatchResult> CommandExecutor::execute_batch_async(const std::vector<std::string>& commands,
-                                    const ExecutionOptions& options,
-                                    ProgressCallback progress_callback) {
-    auto promise = std::make_shared<std::promise<BatchResult>>();
-    auto future = promise->get_future();
-    
-    // Queue batch task
-    {
-        std::lock_guard<std::mutex> lock(tasks_mutex_);
-        pending_tasks_.push([this, commands, options, progress_callback, promise]() {
-            ExecutionError error;
-            auto result = execute_batch(commands, options, progress_callback, &error);
-            promise->set_value(result);
-        });
-    }
-    tasks_cv_.notify_one();
-    
-    return future;
-}
-
 std::string CommandExecutor::prepare_command(std::string_view raw_command, ExecutionError* error) {
     if (!session_manager_) {
         if (error) *error = ExecutionError::InternalError;
@@ -154,27 +358,40 @@ std::vector<std::string> CommandExecutor::get_command_suggestions(std::string_vi
 }
 
 void CommandExecutor::cancel_all_pending() {
-    std::lock_guard<std::mutex> lock(tasks_mutex_);
-    
-    // Clear the queue
-    while (!pending_tasks_.empty()) {
-        pending_tasks_.pop();
-    }
+    // Queued commands complete with ExecutionError::Cancelled
+    scheduler_->cancel_all();
+}
+
+void CommandExecutor::cancel_request(std::string_view request_id) {
+    scheduler_->cancel_tagged(request_id);
 }
 
 size_t CommandExecutor::get_pending_count() const {
-    std::lock_guard<std::mutex> lock(tasks_mutex_);
-    return pending_tasks_.size();
+    return scheduler_->pending_count();
 }
 
 bool CommandExecutor::is_busy() const {
-    std::lock_guard<std::mutex> lock(tasks_mutex_);
-    return !pending_tasks_.empty();
+    return scheduler_->is_busy();
+}
+
+bool CommandExecutor::is_engine_started() const {
+    return scheduler_->is_started();
 }
 
 CommandExecutor::ExecutorStats CommandExecutor::get_stats() const {
-    std::lock_guard<std::mutex> lock(stats_mutex_);
-    auto stats = stats_;
+    using Counter = MetricsRegistry::Counter;
+    auto& metrics = MetricsRegistry::instance();
+    
+    ExecutorStats stats;
+    stats.total_commands_executed = metrics.value(Counter::CommandsExecuted);
+    stats.successful_commands = metrics.value(Counter::CommandsSucceeded);
+    stats.failed_commands = metrics.value(Counter::CommandsFailed);
+    stats.timed_out_commands = metrics.value(Counter::CommandsTimedOut);
+    stats.cache_hits = metrics.value(Counter::ResultCacheHits);
+    stats.cache_misses = metrics.value(Counter::ResultCacheMisses);
+    stats.total_execution_time = std::chrono::milliseconds(metrics.value(Counter::CommandTimeMs));
+    stats.start_time = std::chrono::steady_clock::time_point(
+        std::chrono::steady_clock::duration(stats_start_time_.load()));
     
     // Calculate average execution time
     if (stats.total_commands_executed > 0) {
@@ -185,10 +402,25 @@ CommandExecutor::ExecutorStats CommandExecutor::get_stats() const {
     return stats;
 }
 
+// For target changes the executor cannot observe, e.g. commands typed directly into the debugger
+void CommandExecutor::invalidate_cache() {
+    state_generation_.fetch_add(1);
+    
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    result_cache_.clear();
+    cached_bytes_ = 0;
+}
+
+// Latency histograms are left alone; they describe the extension, not one executor
 void CommandExecutor::reset_stats() {
-    std::lock_guard<std::mutex> lock(stats_mutex_);
-    stats_ = ExecutorStats{};
-    stats_.start_time = std::chrono::steady_clock::now();
+    using Counter = MetricsRegistry::Counter;
+    auto& metrics = MetricsRegistry::instance();
+    for (Counter counter : {Counter::CommandsExecuted, Counter::CommandsSucceeded, Counter::CommandsFailed,
+                            Counter::CommandsTimedOut, Counter::ResultCacheHits, Counter::ResultCacheMisses,
+                            Counter::CommandTimeMs}) {
+        metrics.reset(counter);
+    }
+    stats_start_time_.store(std::chrono::steady_clock::now().time_since_epoch().count());
 }
 
 // Private implementation methods
@@ -238,17 +470,78 @@ CommandResult CommandExecutor::execute_command_internal(std::string_view command
         return result;
     }
     
+    // Read-only commands are answered from the cache while the target state
+    // is unchanged and the engine is in the context the result was produced
+    // in; the generation is sampled before executing so a result racing with
+    // a state change is never stored as current. Filtered output is not the
+    // command's output, so it is filtered from the cache but never stored in it
+    bool read_only = command_validation::is_read_only_command(prepared_command);
+    bool cacheable = options.use_cache && read_only;
+    uint64_t generation = current_generation();
+    std::string cache_key = cacheable ? result_cache_key(prepared_command) : std::string();
+    
+    if (cacheable) {
+        if (auto cached = lookup_cached_result(cache_key)) {
+            result.success = true;
+            result.output = options.output_filter ? options.output_filter->apply(cached->output)
+                                                  : std::move(cached->output);
+            result.execution_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - start_time);
+            result.metadata["cache_hit"] = true;
+            result.metadata["cached_execution_time_ms"] = cached->execution_time.count();
+            result.metadata["state_generation"] = generation;
+            update_stats_on_success(result);
+            if (error) *error = ExecutionError::None;
+            return result;
+        }
+    }
+    
     // Execute command
     ExecutionError exec_error;
-    auto output = execute_windbg_command(prepared_command, options.timeout, &exec_error);
+    auto timeout = get_timeout_for_command(prepared_command, options);
+    auto engine_start = std::chrono::steady_clock::now();
+    auto output = execute_windbg_command(prepared_command, timeout, options.output_sink, options.output_filter,
+                                         &result.streamed_bytes, &exec_error);
+    auto engine_time = std::chrono::steady_clock::now() - engine_start;
+    MetricsRegistry::instance().record(MetricsRegistry::Stage::EngineTime, engine_time);
+    MetricsRegistry::instance().record_command(command_token(prepared_command), engine_time,
+                                               exec_error == ExecutionError::None);
+    
+    // Anything that is not known to be read-only may have moved the target,
+    // which can load or unload modules. The symbol cache hears about those
+    // through event callbacks as well, but does not depend on them
+    if (!read_only) {
+        state_generation_.fetch_add(1);
+        SymbolCache::instance().invalidate_modules();
+        if (command_validation::is_symbol_changing_command(prepared_command)) {
+            SymbolCache::instance().clear();
+        }
+        if (command_validation::resumes_target(prepared_command)) {
+            session_contexts_->target_resumed();
+        }
+    }
     
     auto end_time = std::chrono::steady_clock::now();
     result.execution_time = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+    result.metadata["cache_hit"] = false;
+    result.metadata["state_generation"] = current_generation();
+    result.metadata["timeout_ms"] = timeout.count();
+    timeout_utils::record_command_latency(prepared_command, result.execution_time);
     
     if (exec_error == ExecutionError::None) {
         result.success = true;
-        result.output = output;
+        result.output = std::move(output);
+        if (cacheable && !options.output_filter) {
+            store_cached_result(cache_key, result, generation);
+        }
         update_stats_on_success(result);
+    } else if (exec_error == ExecutionError::Timeout) {
+        // The watchdog interrupted the command; keep what it printed so far
+        result.success = false;
+        result.output = std::move(output);
+        result.error_message = "Command timed out after " + std::to_string(timeout.count()) + " ms";
+        result.metadata["timed_out"] = true;
+        update_stats_on_failure(exec_error);
     } else {
         result.success = false;
         result.error_message = "Command execution failed";
@@ -259,13 +552,33 @@ CommandResult CommandExecutor::execute_command_internal(std::string_view command
     return result;
 }
 
-std::string CommandExecutor::execute_windbg_command(std::string_view command, std::chrono::milliseconds timeout, ExecutionError* error) {
+std::string CommandExecutor::execute_windbg_command(std::string_view command, std::chrono::milliseconds timeout,
+                                                    const OutputSink& output_sink,
+                                                    std::shared_ptr<const OutputFilter> output_filter,
+                                                    size_t* streamed_bytes, ExecutionError* error) {
+    if (streamed_bytes) *streamed_bytes = 0;
+    
     try {
         HRESULT hr;
-        auto result = WinDbgHelpers::execute_command_with_timeout(command, timeout, &hr);
+        OutputSink counting_sink;
+        if (output_sink) {
+            counting_sink = [&output_sink, streamed_bytes](std::string_view chunk) {
+                if (!output_sink(chunk)) {
+                    return false;
+                }
+                if (streamed_bytes) *streamed_bytes += chunk.size();
+                return true;
+            };
+        }
+        
+        auto result = WinDbgHelpers::execute_command_with_timeout(command, timeout, &hr, counting_sink,
+                                                                  std::move(output_filter));
         if (SUCCEEDED(hr)) {
             if (error) *error = ExecutionError::None;
             return result;
+        } else if (hr == HRESULT_FROM_WIN32(ERROR_TIMEOUT)) {
+            if (error) *error = ExecutionError::Timeout;
+            return result;
         } else {
             if (error) *error = ExecutionError::CommandFailed;
             return "";
@@ -336,91 +649,110 @@ CommandResult CommandExecutor::execute_with_retry(std::string_view command, cons
     return failed_result;
 }
 
-void CommandExecutor::start_worker_threads(size_t thread_count) {
-    shutdown_requested_ = false;
-    worker_threads_.reserve(thread_count);
+// An explicit timeout wins; otherwise the adaptive timeout applies, capped by
+// the deadline of the client request being served since nobody waits past it
+std::chrono::milliseconds CommandExecutor::get_timeout_for_command(std::string_view command, const ExecutionOptions& options) {
+    if (options.timeout.count() > 0) {
+        return options.timeout;
+    }
     
-    for (size_t i = 0; i < thread_count; ++i) {
-        worker_threads_.emplace_back(&CommandExecutor::worker_thread_loop, this);
+    auto timeout = timeout_utils::calculate_adaptive_timeout(command);
+    if (auto* context = RequestContext::current(); context && context->timeout.count() > 0) {
+        timeout = (std::min)(timeout, context->timeout);
     }
+    return timeout;
 }
 
-void CommandExecutor::stop_worker_threads() {
-    shutdown_requested_ = true;
-    tasks_cv_.notify_all();
-    
-    for (auto& thread : worker_threads_) {
-        if (thread.joinable()) {
-            thread.join();
-        }
-    }
-    worker_threads_.clear();
+// Our own count of the commands that may have changed the target, plus the
+// session's, which the engine's event callbacks bump; the session snapshot is
+// read without waiting, so every lookup sees a change as soon as it is published
+uint64_t CommandExecutor::current_generation() const {
+    uint64_t generation = state_generation_.load();
+    if (session_manager_) {
+        generation += session_manager_->get_state()->generation;
+    }
+    return generation;
 }
 
-void CommandExecutor::worker_thread_loop() {
-    while (!shutdown_requested_) {
-        std::function<void()> task;
-        
-        {
-            std::unique_lock<std::mutex> lock(tasks_mutex_);
-            tasks_cv_.wait(lock, [this] { return !pending_tasks_.empty() || shutdown_requested_; });
-            
-            if (shutdown_requested_ && pending_tasks_.empty()) {
-                break;
-            }
-            
-            if (!pending_tasks_.empty()) {
-                task = std::move(pending_tasks_.front());
-                pending_tasks_.pop();
+std::optional<CommandExecutor::CachedResult> CommandExecutor::lookup_cached_result(const std::string& key) {
+    std::optional<CachedResult> cached;
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex_);
+        if (cache_generation_ == current_generation()) {
+            auto it = result_cache_.find(key);
+            if (it != result_cache_.end()) {
+                cached = it->second;
+                if (!prefetching_) {
+                    it->second.prefetched = false;
+                }
             }
         }
-        
-        if (task) {
-            task();
-        }
     }
+    
+    auto& metrics = MetricsRegistry::instance();
+    metrics.increment(cached ? MetricsRegistry::Counter::ResultCacheHits
+                             : MetricsRegistry::Counter::ResultCacheMisses);
+    if (cached && cached->prefetched && !prefetching_) {
+        metrics.increment(MetricsRegistry::Counter::PrefetchHits);
+    }
+    return cached;
+}
+
+// Results from an outdated generation, streamed results and oversized outputs
+// are not cached; entries of older generations are dropped as soon as the
+// first result of a newer generation is stored
+void CommandExecutor::store_cached_result(const std::string& key, const CommandResult& result, uint64_t generation) {
+    if (result.streamed_bytes > 0 || result.output.size() > MAX_CACHED_OUTPUT_SIZE) {
+        return;
+    }
+    
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    if (generation != current_generation()) {
+        return;
+    }
+    
+    if (cache_generation_ != generation || cached_bytes_ + result.output.size() > MAX_CACHE_SIZE) {
+        result_cache_.clear();
+        cached_bytes_ = 0;
+        cache_generation_ = generation;
+    }
+    
+    auto& entry = result_cache_[key];
+    cached_bytes_ -= entry.output.size();
+    entry.output = result.output;
+    entry.execution_time = result.execution_time;
+    entry.prefetched = prefetching_;
+    cached_bytes_ += entry.output.size();
 }
 
 void CommandExecutor::update_stats_on_success(const CommandResult& result) {
-    std::lock_guard<std::mutex> lock(stats_mutex_);
-    stats_.total_commands_executed++;
-    stats_.successful_commands++;
-    stats_.total_execution_time += result.execution_time;
+    auto& metrics = MetricsRegistry::instance();
+    metrics.increment(MetricsRegistry::Counter::CommandsExecuted);
+    metrics.increment(MetricsRegistry::Counter::CommandsSucceeded);
+    metrics.increment(MetricsRegistry::Counter::CommandTimeMs, static_cast<uint64_t>(result.execution_time.count()));
 }
 
 void CommandExecutor::update_stats_on_failure(ExecutionError error) {
-    std::lock_guard<std::mutex> lock(stats_mutex_);
-    stats_.total_commands_executed++;
-    stats_.failed_commands++;
+    auto& metrics = MetricsRegistry::instance();
+    metrics.increment(MetricsRegistry::Counter::CommandsExecuted);
+    metrics.increment(MetricsRegistry::Counter::CommandsFailed);
     
     if (error == ExecutionError::Timeout) {
-        stats_.timed_out_commands++;
+        metrics.increment(MetricsRegistry::Counter::CommandsTimedOut);
     }
 }
 
 bool CommandExecutor::is_dangerous_command(std::string_view command) const {
-    // Check for dangerous commands that could modify memory or system state
-    static const std::vector<std::string_view> dangerous_prefixes = {
-        "ed ", "eb ", "ew ", "eq ",  // Memory editing commands
-        ".reboot", ".crash",         // System control
-        "!process 0 7",             // Can cause system freeze
-        ".detach", ".kill",         // Process control
-        "sxe", "sxd",              // Exception handling changes
-    };
-    
-    // Convert command to lowercase for comparison
-    std::string lower_cmd;
-    lower_cmd.reserve(command.size());
-    std::transform(command.begin(), command.end(), std::back_inserter(lower_cmd), 
-                   [](unsigned char c) { return static_cast<char>(::tolower(c)); });
-    
-    for (const auto& prefix : dangerous_prefixes) {
-        if (lower_cmd.find(prefix) == 0) {
-            return true;
-        }
+    // Memory edits, system control, process control and exception handling
+    // changes are marked Dangerous in the command table
+    std::string_view arguments;
+    const CommandInfo* info = find_command(command_token(command, &arguments));
+    if (info && info->has(CommandTrait::Dangerous)) {
+        return true;
     }
     
-    return false;
+    // "!process 0 7" walks every thread of every process and can freeze the system
+    return info && info->name == "!process" && arguments.starts_with("0 7");
 }
 
 bool CommandExecutor::requires_special_handling(std::string_view command) const {
@@ -430,31 +762,79 @@ bool CommandExecutor::requires_special_handling(std::string_view command) const
 }
 
 std::string CommandExecutor::extract_command_name(std::string_view command) const {
-    auto space_pos = command.find(' ');
-    if (space_pos != std::string_view::npos) {
-        return std::string(command.substr(0, space_pos));
-    }
-    return std::string(command);
+    return std::string(command_token(command));
 }
 
-// Command validation utilities implementation
+// Command validation utilities implementation; classification comes from
+// the shared command table so routing and validation cannot disagree
 namespace vibedbg::core::command_validation {
+    // Read-only means the output depends only on the target state, so it can
+    // be cached until the next state change. Commands that continue from the
+    // previous address ("u", "dd" without arguments), assignments and
+    // compound commands are excluded.
     bool is_read_only_command(std::string_view command) {
-        return command.find("r") == 0 || 
-               command.find("u") == 0 ||
-               command.find("d") == 0 ||
-               command.find("k") == 0;
+        if (command.find(';') != std::string_view::npos) {
+            return false;
+        }
+        
+        std::string_view arguments;
+        std::string_view name = command_token(command, &arguments);
+        if (name.empty()) {
+            return false;
+        }
+        
+        // "~" lists threads and "~*k" / "~3k" walk stacks; "~3s" switches thread
+        if (name[0] == '~') {
+            size_t spec_end = name.find_first_not_of("~*.#0123456789");
+            return spec_end == std::string_view::npos || name[spec_end] == 'k' || name[spec_end] == 'K';
+        }
+        
+        const CommandInfo* info = find_command(name);
+        if (!info) {
+            return false;
+        }
+        if (info->has(CommandTrait::Assignable) && arguments.find('=') != std::string_view::npos) {
+            return false;
+        }
+        return info->has(CommandTrait::ReadOnly) ||
+               (info->has(CommandTrait::ReadOnlyWithArgs) && !arguments.empty());
     }
     
+    // Commands that resume or reset the target, or change the process,
+    // thread, frame or symbol context later commands are evaluated in
     bool is_state_changing_command(std::string_view command) {
-        return command.find("g") == 0 || 
-               command.find("p") == 0 ||
-               command.find("t") == 0;
+        std::string_view name = command_token(command);
+        if (name.empty()) {
+            return false;
+        }
+        
+        if (name[0] == '~' || name[0] == '|') {
+            // "~3s", "|1s" switch context; "~3f" / "~3u" freeze and unfreeze
+            char action = command_table_detail::to_lower(name.back());
+            return name.size() > 1 && (action == 's' || action == 'f' || action == 'u');
+        }
+        
+        const CommandInfo* info = find_command(name);
+        return info && info->has(CommandTrait::StateChanging);
+    }
+    
+    bool is_symbol_changing_command(std::string_view command) {
+        const CommandInfo* info = find_command(command_token(command));
+        return info && info->has(CommandTrait::SymbolChanging);
+    }
+    
+    bool resumes_target(std::string_view command) {
+        const CommandInfo* info = find_command(command_token(command));
+        return info && info->has(CommandTrait::ResumesTarget);
     }
     
     bool is_potentially_harmful_command(std::string_view command) {
-        return command.find("!") == 0 || 
-               command.find("ed ") == 0;
+        std::string_view name = command_token(command);
+        if (name.starts_with("!")) {
+            return true;
+        }
+        const CommandInfo* info = find_command(name);
+        return info && info->has(CommandTrait::Dangerous);
     }
     
     std::vector<std::string> get_safe_commands_for_automation() {
@@ -462,15 +842,55 @@ namespace vibedbg::core::command_validation {
     }
     
     std::optional<std::string> get_command_description(std::string_view command) {
-        if (command == "r") return "Display registers";
-        if (command == "u") return "Unassemble";
         if (command == "d") return "Display memory";
-        return std::nullopt;
+        const CommandInfo* info = find_command(command_token(command));
+        if (!info) {
+            return std::nullopt;
+        }
+        return std::string(info->description);
+    }
+    
+    // Reads jump ahead of ordinary commands; long-running ones queue behind both
+    CommandPriority get_command_priority(std::string_view command) {
+        const CommandInfo* info = find_command(command_token(command));
+        if (info && info->has(CommandTrait::LongRunning) && !info->has(CommandTrait::StateChanging)) {
+            return CommandPriority::Background;
+        }
+        return is_read_only_command(command) ? CommandPriority::Interactive : CommandPriority::Normal;
     }
 }
 
 // Timeout utilities implementation
 namespace vibedbg::core::timeout_utils {
+    namespace {
+        // Bucket i counts executions that took [2^i, 2^(i+1)) ms; bucket 0 also holds 0 ms
+        constexpr size_t LATENCY_BUCKETS = 24;
+        constexpr uint32_t MIN_LATENCY_SAMPLES = 8;     // Below this the defaults apply
+        constexpr uint32_t LATENCY_DECAY_SAMPLES = 1024; // Counts are halved here so old runs fade
+        constexpr size_t MAX_LATENCY_HISTOGRAMS = 256;
+        constexpr int64_t TIMEOUT_HEADROOM = 4;          // Multiple of the observed p99
+        constexpr std::chrono::milliseconds MIN_ADAPTIVE_TIMEOUT{5000};
+        constexpr std::chrono::milliseconds MAX_ADAPTIVE_TIMEOUT{600000};
+        
+        struct LatencyHistogram {
+            std::array<uint32_t, LATENCY_BUCKETS> buckets{};
+            uint32_t samples{0};
+        };
+        
+        std::mutex latency_mutex;
+        std::unordered_map<std::string, LatencyHistogram> latency_histograms;
+        
+        // Histograms are kept per command name; arguments rarely change how
+        // long a command takes by orders of magnitude, the command itself does
+        std::string latency_key(std::string_view command) {
+            std::string key(command_token(command));
+            for (char& c : key) {
+                c = command_table_detail::to_lower(c);
+            }
+            return key;
+        }
+    }
+    
     std::chrono::milliseconds get_default_timeout_for_command(std::string_view command) {
         if (is_long_running_command(command)) {
             return std::chrono::milliseconds(60000); // 60 seconds
@@ -478,12 +898,76 @@ namespace vibedbg::core::timeout_utils {
         return std::chrono::milliseconds(5000); // 5 seconds
     }
     
+    // Commands seen often enough get a multiple of their observed p99, so a
+    // slow "!analyze" on a large dump is not cut short and a hung "r" is not
+    // waited on for a minute; the rest keep the table-derived defaults
     std::chrono::milliseconds calculate_adaptive_timeout(std::string_view command) {
-        return get_default_timeout_for_command(command);
+        std::string key = latency_key(command);
+        if (key.empty()) {
+            return get_default_timeout_for_command(command);
+        }
+        
+        LatencyHistogram histogram;
+        {
+            std::lock_guard<std::mutex> lock(latency_mutex);
+            auto it = latency_histograms.find(key);
+            if (it == latency_histograms.end()) {
+                return get_default_timeout_for_command(command);
+            }
+            histogram = it->second;
+        }
+        if (histogram.samples < MIN_LATENCY_SAMPLES) {
+            return get_default_timeout_for_command(command);
+        }
+        
+        uint64_t target = (static_cast<uint64_t>(histogram.samples) * 99 + 99) / 100;
+        uint64_t seen = 0;
+        size_t bucket = 0;
+        for (; bucket < LATENCY_BUCKETS - 1; ++bucket) {
+            seen += histogram.buckets[bucket];
+            if (seen >= target) {
+                break;
+            }
+        }
+        
+        std::chrono::milliseconds p99_bound(int64_t{1} << (bucket + 1));
+        return std::clamp(p99_bound * TIMEOUT_HEADROOM, MIN_ADAPTIVE_TIMEOUT, MAX_ADAPTIVE_TIMEOUT);
+    }
+    
+    // Timed-out runs are recorded at their timeout, which pushes the p99 of a
+    // command that keeps hitting its deadline up until the deadline fits
+    void record_command_latency(std::string_view command, std::chrono::milliseconds latency) {
+        std::string key = latency_key(command);
+        if (key.empty()) {
+            return;
+        }
+        
+        uint64_t ms = static_cast<uint64_t>((std::max)(latency.count(), int64_t{0}));
+        size_t bucket = (std::min)(static_cast<size_t>(ms > 0 ? std::bit_width(ms) - 1 : 0), LATENCY_BUCKETS - 1);
+        
+        std::lock_guard<std::mutex> lock(latency_mutex);
+        auto it = latency_histograms.find(key);
+        if (it == latency_histograms.end()) {
+            if (latency_histograms.size() >= MAX_LATENCY_HISTOGRAMS) {
+                return;
+            }
+            it = latency_histograms.emplace(std::move(key), LatencyHistogram{}).first;
+        }
+        
+        auto& histogram = it->second;
+        if (histogram.samples >= LATENCY_DECAY_SAMPLES) {
+            histogram.samples = 0;
+            for (auto& count : histogram.buckets) {
+                count /= 2;
+                histogram.samples += count;
+            }
+        }
+        histogram.buckets[bucket]++;
+        histogram.samples++;
     }
     
     bool is_long_running_command(std::string_view command) {
-        return command.find("g") == 0 || 
-               command.find("!analyze") == 0;
+        const CommandInfo* info = find_command(command_token(command));
+        return info && info->has(CommandTrait::LongRunning);
     }
-}
\ No newline at end of file
+}
@@ -1,10 +1,17 @@
 #include "pch.h"
 #include "command_handlers.h"
 #include "constants.h"
+#include "request_context.h"
+#include "dump_analyzer.h"
+#include "symbol_loader.h"
+#include "heap_scanner.h"
 #include "../utils/windbg_helpers.h"
+#include "../utils/data_model_query.h"
 #include "../utils/command_utils.h"
-#include <regex>
+#include "../utils/constants.h"
+#include "../../inc/request_tracing.h"
 #include <sstream>
+#include <charconv>
 
 using namespace vibedbg::core;
 using namespace vibedbg::constants;
@@ -23,6 +30,102 @@ namespace {
         oss << EXTENSION_NAME << " v" << EXTENSION_VERSION << "\n" << EXTENSION_DESCRIPTION;
         return oss.str();
     }
+    
+    // Parses a 0x-prefixed hex number or a decimal number
+    std::optional<uint64_t> parse_number(std::string_view text) {
+        int base = 10;
+        if (text.size() > 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X')) {
+            text.remove_prefix(2);
+            base = 16;
+        }
+        
+        // WinDbg prints 64-bit addresses as 00007ff6`12340000
+        std::string digits;
+        digits.reserve(text.size());
+        for (char c : text) {
+            if (c != '`') {
+                digits += c;
+            }
+        }
+        
+        uint64_t value = 0;
+        auto [end, ec] = std::from_chars(digits.data(), digits.data() + digits.size(), value, base);
+        if (ec != std::errc() || end != digits.data() + digits.size() || digits.empty()) {
+            return std::nullopt;
+        }
+        return value;
+    }
+    
+    // Addresses arrive either as JSON numbers or as strings, since not every
+    // client can represent a full 64-bit address as a number
+    std::optional<uint64_t> json_to_number(const nlohmann::json& value) {
+        if (value.is_number_unsigned()) {
+            return value.get<uint64_t>();
+        }
+        if (value.is_number_integer() && value.get<int64_t>() >= 0) {
+            return static_cast<uint64_t>(value.get<int64_t>());
+        }
+        if (value.is_string()) {
+            return parse_number(value.get<std::string>());
+        }
+        return std::nullopt;
+    }
+    
+    size_t requested_frame_count(const nlohmann::json& parameters) {
+        if (parameters.contains("max_frames")) {
+            auto requested = json_to_number(parameters["max_frames"]);
+            if (requested && *requested > 0) {
+                return static_cast<size_t>((std::min<uint64_t>)(*requested, Constants::MAX_STACK_FRAMES));
+            }
+        }
+        return Constants::DEFAULT_STACK_FRAMES;
+    }
+    
+    // dx_query parameters; the page and depth are clamped, the expression is required
+    bool parse_data_model_query(const nlohmann::json& parameters, DataModelQueryOptions* options,
+                                std::string* error_message) {
+        if (!parameters.contains("expression") || !parameters["expression"].is_string() ||
+            CommandUtils::trim(parameters["expression"].get<std::string>()).empty()) {
+            *error_message = "dx_query requires a non-empty 'expression'";
+            return false;
+        }
+        options->expression = CommandUtils::trim(parameters["expression"].get<std::string>());
+        if (options->expression.size() > Constants::MAX_COMMAND_LENGTH) {
+            *error_message = "dx_query 'expression' is too long";
+            return false;
+        }
+        
+        if (parameters.contains("offset")) {
+            auto offset = json_to_number(parameters["offset"]);
+            if (!offset) {
+                *error_message = "dx_query 'offset' must be a non-negative number";
+                return false;
+            }
+            options->offset = static_cast<size_t>(*offset);
+        }
+        if (parameters.contains("limit")) {
+            auto limit = json_to_number(parameters["limit"]);
+            if (!limit || *limit == 0) {
+                *error_message = "dx_query 'limit' must be a positive number";
+                return false;
+            }
+            options->limit = static_cast<size_t>((std::min<uint64_t>)(*limit, Constants::MAX_DX_PAGE_SIZE));
+        }
+        if (parameters.contains("depth")) {
+            auto depth = json_to_number(parameters["depth"]);
+            if (!depth) {
+                *error_message = "dx_query 'depth' must be a non-negative number";
+                return false;
+            }
+            options->depth = static_cast<unsigned int>((std::min<uint64_t>)(*depth, Constants::MAX_DX_DEPTH));
+        }
+        options->raw = parameters.value("raw", false);
+        return true;
+    }
+    
+    std::string format_address(uint64_t address) {
+        return std::format("{:08x}`{:08x}", static_cast<uint32_t>(address >> 32), static_cast<uint32_t>(address));
+    }
 }
 
 /**
@@ -30,12 +133,15 @@ namespace {
  * 
  * @param[in] session_manager Shared pointer to the session manager for session operations
  * @param[in] command_executor Shared pointer to the command executor for WinDbg command execution
+ * @param[in] symbol_loader Background symbol loader; symbol loads are unavailable without one
  */
 CommandHandlers::CommandHandlers(
     _In_ std::shared_ptr<SessionManager> session_manager,
-    _In_ std::shared_ptr<CommandExecutor> command_executor)
+    _In_ std::shared_ptr<CommandExecutor> command_executor,
+    _In_opt_ std::shared_ptr<SymbolLoader> symbol_loader)
     : session_manager_(std::move(session_manager))
-    , command_executor_(std::move(command_executor)) {
+    , command_executor_(std::move(command_executor))
+    , symbol_loader_(std::move(symbol_loader)) {
 }
 
 /**
@@ -193,14 +299,26 @@ std::string CommandHandlers::handle_execute_command(_In_ std::string_view comman
     }
     
     ExecutionOptions options;
+    if (auto* context = RequestContext::current()) {
+        options.output_sink = context->output_sink;
+        options.output_filter = context->output_filter;
+    }
+    
     ExecutionError error = ExecutionError::None;
     auto result = command_executor_->execute_command(command, options, &error);
     
     bool success = (error == ExecutionError::None && result.success);
-    CommandUtils::log_command_result(command, success, result.output.length());
+    CommandUtils::log_command_result(command, success, result.streamed_bytes + result.output.length());
     
     if (success) {
-        return CommandUtils::format_success_message(command, result.output);
+        if (result.streamed_bytes > 0) {
+            // The client already has the bulk of the output; return only the tail
+            return std::move(result.output);
+        }
+        return CommandUtils::format_success_message(command, std::move(result.output));
+    } else if (error == ExecutionError::Timeout && !result.output.empty()) {
+        return CommandUtils::format_error_message(result.error_message + "; partial output:\n" + result.output,
+                                                  "command execution");
     } else {
         return CommandUtils::format_error_message(result.error_message, "command execution");
     }
@@ -282,15 +400,17 @@ std::string CommandHandlers::handle_call_stack() {
 /**
  * @brief Handles memory reading requests.
  * 
+ * Memory is read directly through IDebugDataSpaces and formatted like the
+ * output of db; the text command is only used when the data spaces
+ * interface is unavailable.
+ * 
  * @param[in] address Memory address to read from
  * @param[in] size Number of bytes to read
  * 
  * @return Formatted memory dump
  */
 std::string CommandHandlers::handle_read_memory(_In_ uintptr_t address, _In_ size_t size) {
-    std::ostringstream oss;
-    oss << "db " << format_hex(address) << " L" << format_hex(size);
-    return handle_execute_command(oss.str());
+    return handle_display_memory(address, size, 1);
 }
 
 /**
@@ -298,13 +418,39 @@ std::string CommandHandlers::handle_read_memory(_In_ uintptr_t address, _In_ siz
  * 
  * @param[in] address Memory address to display
  * @param[in] size Number of bytes to display
+ * @param[in] element_size Size of each displayed value: 1 (db), 2 (dw), 4 (dd) or 8 (dq)
  * 
  * @return Formatted memory display
  */
-std::string CommandHandlers::handle_display_memory(_In_ uintptr_t address, _In_ size_t size) {
-    std::ostringstream oss;
-    oss << "dd " << format_hex(address) << " L" << format_hex(size / 4);
-    return handle_execute_command(oss.str());
+std::string CommandHandlers::handle_display_memory(_In_ uintptr_t address, _In_ size_t size, _In_ size_t element_size) {
+    if (element_size != 1 && element_size != 2 && element_size != 4 && element_size != 8) {
+        return "Error: Unsupported memory element size " + std::to_string(element_size);
+    }
+    
+    size -= size % element_size;
+    if (size == 0 || size > Constants::MAX_MEMORY_READ_SIZE) {
+        return "Error: Memory display size must be between 1 and " + std::to_string(Constants::MAX_MEMORY_READ_SIZE) + " bytes";
+    }
+    
+    // The data spaces belong to the engine thread and the session's context
+    HRESULT hr = E_FAIL;
+    std::string buffer;
+    std::vector<MemoryRangeResult> results;
+    MemoryRange range{address, size};
+    if (command_executor_ && !command_executor_->execute_on_engine(CommandPriority::Interactive, [&]() {
+            results = WinDbgHelpers::read_memory_ranges(std::span(&range, 1), buffer, &hr);
+        })) {
+        return "Error: Memory display cancelled";
+    }
+    if (FAILED(hr) || results.empty()) {
+        static constexpr std::string_view display_commands[] = {"db", "dw", "", "dd", "", "", "", "dq"};
+        std::ostringstream oss;
+        oss << display_commands[element_size - 1] << " " << format_hex(address) << " L" << format_hex(size / element_size);
+        return handle_execute_command(oss.str());
+    }
+    
+    auto* data = reinterpret_cast<const uint8_t*>(buffer.data());
+    return format_memory_display(address, std::span(data, size), results[0].bytes_read, element_size);
 }
 
 /**
@@ -589,6 +735,9 @@ std::string CommandHandlers::handle_analyze_crash() {
  * @return Comprehensive deadlock analysis report
  */
 std::string CommandHandlers::handle_analyze_deadlock() {
+    // Section headers are interleaved with command output, so keep it buffered
+    StreamingSuspension buffered_output;
+    
     // Specific analysis for deadlock scenarios
     std::string result;
     
@@ -597,9 +746,10 @@ std::string CommandHandlers::handle_analyze_deadlock() {
     result += handle_execute_command("~");
     result += "\n\n";
     
-    // Get stack traces for all threads
-    result += "=== Stack Traces ===\n";
-    result += handle_execute_command("~*k");
+    // Threads blocked on the same lock share a stack, so identical stacks
+    // are folded; thousands of threads usually reduce to a few dozen buckets
+    result += "=== Unique Stacks ===\n";
+    result += format_stack_buckets();
     result += "\n\n";
     
     // Check for locks and synchronization objects
@@ -614,6 +764,55 @@ std::string CommandHandlers::handle_analyze_deadlock() {
     return result;
 }
 
+/**
+ * @brief Walks every thread's stack and formats the distinct stacks with their thread counts.
+ * 
+ * @return One block per distinct stack, most common first, or an error message
+ */
+std::string CommandHandlers::format_stack_buckets() {
+    if (!command_executor_) {
+        return CommandUtils::format_error_message("Internal error");
+    }
+    
+    HRESULT hr = S_OK;
+    size_t thread_count = 0;
+    std::vector<StackBucket> buckets;
+    bool ran = command_executor_->execute_on_engine(CommandPriority::Normal, [&]() {
+        buckets = WinDbgHelpers::get_stack_buckets(Constants::DEFAULT_STACK_FRAMES, &thread_count, &hr);
+    });
+    if (!ran) {
+        return CommandUtils::format_error_message("Stack collection cancelled");
+    }
+    if (FAILED(hr)) {
+        return CommandUtils::format_error_message("Stack collection failed: " + WinDbgHelpers::format_windbg_error(hr));
+    }
+    
+    std::string result = std::format("{} threads, {} unique stacks\n", thread_count, buckets.size());
+    for (const auto& bucket : buckets) {
+        result += std::format("\n{} thread(s):", bucket.system_ids.size());
+        size_t shown = (std::min)(bucket.system_ids.size(), MAX_BUCKET_THREADS_SHOWN);
+        for (size_t i = 0; i < shown; ++i) {
+            result += std::format(" {:x}", bucket.system_ids[i]);
+        }
+        if (shown < bucket.system_ids.size()) {
+            result += std::format(" ... (+{})", bucket.system_ids.size() - shown);
+        }
+        result += "\n";
+        
+        for (const auto& frame : bucket.frames) {
+            result += std::format("  {:02x} {} ", frame.frame_number, format_address(frame.instruction_offset));
+            if (frame.symbol.empty()) {
+                result += "<unknown>\n";
+            } else if (frame.displacement > 0) {
+                result += std::format("{}+0x{:x}\n", frame.symbol, frame.displacement);
+            } else {
+                result += frame.symbol + "\n";
+            }
+        }
+    }
+    return result;
+}
+
 // Register and Memory Analysis
 
 /**
@@ -675,31 +874,38 @@ std::string CommandHandlers::handle_show_symbol_info(_In_ std::string_view symbo
  * @brief Handles user-mode symbol loading requests.
  * 
  * This method loads user-mode symbols which are required for accessing
- * application structures and debugging user-mode processes.
+ * application structures and debugging user-mode processes. Every module
+ * whose symbols are still deferred is loaded in the background, the ones
+ * on the current thread's stack first, so the request returns at once.
  * 
- * @return Result of user-mode symbol loading operation
+ * @return Description of the symbol load that was started
  */
 std::string CommandHandlers::handle_load_user_symbols() {
-    std::string result;
-    
-    // Load user-mode symbols
-    result += "=== Loading User-Mode Symbols ===\n";
-    result += handle_execute_command(".reload /user");
-    result += "\n\n";
-    
-    // Check if symbols loaded successfully
-    result += "=== Verifying Symbol Loading ===\n";
-    result += handle_execute_command("x kernel32!GetLastError");
-    result += "\n\n";
+    return start_symbol_load({});
+}
+
+/**
+ * @brief Starts a background symbol load and describes it.
+ * 
+ * @param[in] options Modules and prefetch workers of the load
+ * 
+ * @return What was started, or the progress of the load already running
+ */
+std::string CommandHandlers::start_symbol_load(_In_ const SymbolLoadOptions& options) {
+    if (!symbol_loader_) {
+        return "Error: Symbol loader not available";
+    }
     
-    // Also try to load other essential user-mode modules
-    result += "=== Loading Additional User-Mode Modules ===\n";
-    result += handle_execute_command(".reload ntdll");
-    result += "\n";
-    result += handle_execute_command(".reload kernel32");
-    result += "\n\n";
+    std::string error_message;
+    if (!symbol_loader_->start(options, &error_message)) {
+        SymbolLoadStatus status = symbol_loader_->get_status();
+        return error_message + ": " + std::to_string(status.loaded + status.failed) + " of " +
+               std::to_string(status.total) + " modules done\n";
+    }
     
-    return result;
+    return "Loading symbols in the background, modules on the current thread's stack first.\n"
+           "Commands keep running meanwhile; get_symbol_load_status reports progress and\n"
+           "subscribers receive a symbol_load event as each module is done.\n";
 }
 
 /**
@@ -711,6 +917,8 @@ std::string CommandHandlers::handle_load_user_symbols() {
  * @return Formatted parent process information
  */
 std::string CommandHandlers::handle_get_parent_process() {
+    StreamingSuspension buffered_output;
+    
     std::string result;
     
     // Check if we're in user mode debugging
@@ -747,35 +955,23 @@ std::string CommandHandlers::handle_get_parent_process() {
 /**
  * @brief Handles comprehensive symbol loading for debugging.
  * 
- * This method loads all necessary symbols for comprehensive debugging,
- * including user-mode symbols and common modules.
+ * This method sets the public symbol server path, then loads the symbols of
+ * every module in the background. The symbol path is set first so the load
+ * already downloads from it.
  * 
- * @return Result of comprehensive symbol loading
+ * @return Result of setting the symbol path and the symbol load that was started
  */
 std::string CommandHandlers::handle_load_all_symbols() {
-    std::string result;
-    
-    result += "=== Loading User-Mode Symbols ===\n";
-    result += handle_execute_command(".reload /user");
-    result += "\n\n";
+    StreamingSuspension buffered_output;
     
-    result += "=== Loading Common System Modules ===\n";
-    result += handle_execute_command(".reload ntdll");
-    result += "\n";
-    result += handle_execute_command(".reload kernel32");
-    result += "\n";
-    result += handle_execute_command(".reload user32");
-    result += "\n\n";
+    std::string result;
     
     result += "=== Setting Symbol Path ===\n";
     result += handle_execute_command(".sympath srv*C:\\Symbols*http://msdl.microsoft.com/download/symbols");
     result += "\n\n";
     
-    result += "=== Verifying Symbol Loading ===\n";
-    result += handle_execute_command("x kernel32!GetLastError");
-    result += "\n";
-    result += handle_execute_command("x ntdll!NtCreateProcess");
-    result += "\n\n";
+    result += "=== Loading Symbols ===\n";
+    result += start_symbol_load({});
     
     return result;
 }
@@ -785,9 +981,12 @@ std::string CommandHandlers::handle_load_all_symbols() {
 /**
  * @brief Handles memory search requests.
  * 
+ * Byte patterns are searched with IDebugDataSpaces::SearchVirtual. Patterns
+ * that are not a list of hex bytes fall back to the s -b command.
+ * 
  * @param[in] start_address Starting address for search
  * @param[in] end_address Ending address for search
- * @param[in] pattern Pattern to search for
+ * @param[in] pattern Pattern to search for, as hex bytes ("41 42 43")
  * 
  * @return Search results
  */
@@ -795,316 +994,1205 @@ std::string CommandHandlers::handle_search_memory(
     _In_ uintptr_t start_address, 
     _In_ uintptr_t end_address, 
     _In_ std::string_view pattern) {
-    std::ostringstream oss;
-    oss << "s -b " << format_hex(start_address) << " " << format_hex(end_address) << " " << pattern;
-    return handle_execute_command(oss.str());
+    if (end_address > start_address && end_address - start_address > Constants::MAX_MEMORY_SEARCH_LENGTH) {
+        return "Error: Memory search is limited to " + std::to_string(Constants::MAX_MEMORY_SEARCH_LENGTH) + " bytes";
+    }
+    
+    auto pattern_bytes = WinDbgHelpers::parse_hex_bytes(pattern);
+    HRESULT hr = E_FAIL;
+    std::vector<uintptr_t> hits;
+    if (pattern_bytes && end_address > start_address && command_executor_ &&
+        !command_executor_->execute_on_engine(CommandPriority::Interactive, [&]() {
+            hits = WinDbgHelpers::search_memory(start_address, end_address - start_address,
+                                                *pattern_bytes, Constants::MAX_SEARCH_HITS, &hr);
+        })) {
+        return "Error: Memory search cancelled";
+    }
+    
+    if (FAILED(hr)) {
+        std::ostringstream oss;
+        oss << "s -b " << format_hex(start_address) << " " << format_hex(end_address) << " " << pattern;
+        return handle_execute_command(oss.str());
+    }
+    
+    std::string result = std::format("Found {} match(es)", hits.size());
+    if (hits.size() == Constants::MAX_SEARCH_HITS) {
+        result += " (limit reached)";
+    }
+    result += "\n";
+    for (auto hit : hits) {
+        result += format_address(hit) + "\n";
+    }
+    return result;
 }
 
 /**
- * @brief Handles memory region information requests.
- * 
- * @param[in] address Address to get region information for
- * 
- * @return Formatted memory region information
+ * @brief Handles structured memory requests that return raw bytes.
+ * 
+ * Supported operations:
+ * - read_memory: parameters {"ranges": [{"address", "size"}, ...]}. The
+ *   bytes of all ranges are concatenated in request order; data lists each
+ *   range's offset, bytes_read and status.
+ * - search_memory: parameters {"address", "length", "pattern", "max_hits"}
+ *   with pattern as hex bytes; data lists the matching addresses.
+ * 
+ * @param[in] operation Request command name
+ * @param[in] parameters Request parameters
+ * @param[in] binary_output true if output may hold raw bytes (protocol v2), false to base64 encode it
+ * @param[out] output Receives the memory contents
+ * @param[out] data Receives the structured result
+ * @param[out] error_message Receives the reason a request was rejected
+ * 
+ * @return true if the operation is a structured memory request, whether or not it succeeded
  */
-std::string CommandHandlers::handle_show_memory_region(_In_ uintptr_t address) {
-    std::ostringstream oss;
-    oss << "!address " << format_hex(address);
-    return handle_execute_command(oss.str());
+bool CommandHandlers::handle_memory_request(
+    _In_ std::string_view operation,
+    _In_ const nlohmann::json& parameters,
+    _In_ bool binary_output,
+    _Out_ std::string* output,
+    _Out_ nlohmann::json* data,
+    _Out_ std::string* error_message) {
+    
+    if (operation == "read_memory") {
+        if (!parameters.contains("ranges") || !parameters["ranges"].is_array() || parameters["ranges"].empty()) {
+            *error_message = "read_memory requires a non-empty 'ranges' array";
+            return true;
+        }
+        
+        std::vector<MemoryRange> ranges;
+        size_t total_size = 0;
+        for (const auto& entry : parameters["ranges"]) {
+            auto address = entry.is_object() && entry.contains("address") ? json_to_number(entry["address"]) : std::nullopt;
+            auto size = entry.is_object() && entry.contains("size") ? json_to_number(entry["size"]) : std::nullopt;
+            if (!address || !size || *size == 0) {
+                *error_message = "Each range needs an address and a non-zero size";
+                return true;
+            }
+            total_size += *size;
+            if (*size > Constants::MAX_MEMORY_READ_SIZE || total_size > Constants::MAX_MEMORY_READ_SIZE) {
+                *error_message = "read_memory is limited to " + std::to_string(Constants::MAX_MEMORY_READ_SIZE) + " bytes per request";
+                return true;
+            }
+            ranges.push_back({static_cast<uintptr_t>(*address), static_cast<size_t>(*size)});
+        }
+        
+        if (!command_executor_) {
+            *error_message = "Command executor not available";
+            return true;
+        }
+        
+        // Reads jump ahead of queued commands and see the session's process
+        HRESULT hr = S_OK;
+        std::string bytes;
+        std::vector<MemoryRangeResult> results;
+        if (!command_executor_->execute_on_engine(CommandPriority::Interactive, [&]() {
+                results = WinDbgHelpers::read_memory_ranges(ranges, bytes, &hr);
+            })) {
+            *error_message = "read_memory cancelled";
+            return true;
+        }
+        if (FAILED(hr)) {
+            *error_message = "Memory access unavailable: " + WinDbgHelpers::format_windbg_error(hr);
+            return true;
+        }
+        
+        nlohmann::json range_results = nlohmann::json::array();
+        for (size_t i = 0; i < ranges.size(); ++i) {
+            const auto& result = results[i];
+            nlohmann::json range_json = {
+                {"address", ranges[i].address},
+                {"size", ranges[i].size},
+                {"offset", result.offset},
+                {"bytes_read", result.bytes_read},
+                {"status", result.bytes_read == ranges[i].size ? "ok" : result.bytes_read > 0 ? "partial" : "error"}
+            };
+            if (FAILED(result.hr)) {
+                range_json["error"] = WinDbgHelpers::format_windbg_error(result.hr);
+            }
+            range_results.push_back(std::move(range_json));
+        }
+        
+        *data = {
+            {"encoding", binary_output ? "raw" : "base64"},
+            {"ranges", std::move(range_results)}
+        };
+        *output = binary_output ? std::move(bytes) : WinDbgHelpers::encode_base64(bytes);
+        return true;
+    }
+    
+    if (operation == "search_memory") {
+        auto address = parameters.contains("address") ? json_to_number(parameters["address"]) : std::nullopt;
+        auto length = parameters.contains("length") ? json_to_number(parameters["length"]) : std::nullopt;
+        auto pattern = parameters.contains("pattern") && parameters["pattern"].is_string()
+            ? WinDbgHelpers::parse_hex_bytes(parameters["pattern"].get<std::string>()) : std::nullopt;
+        if (!address || !length || !pattern) {
+            *error_message = "search_memory requires 'address', 'length' and a hex byte 'pattern'";
+            return true;
+        }
+        if (*length > Constants::MAX_MEMORY_SEARCH_LENGTH || *address + *length < *address) {
+            *error_message = "search_memory is limited to " + std::to_string(Constants::MAX_MEMORY_SEARCH_LENGTH) +
+                             " bytes that do not wrap the address space";
+            return true;
+        }
+        if (!command_executor_) {
+            *error_message = "Command executor not available";
+            return true;
+        }
+        
+        size_t max_hits = Constants::MAX_SEARCH_HITS;
+        if (parameters.contains("max_hits")) {
+            auto requested = json_to_number(parameters["max_hits"]);
+            if (requested && *requested > 0) {
+                max_hits = static_cast<size_t>((std::min<uint64_t>)(*requested, Constants::MAX_SEARCH_HITS));
+            }
+        }
+        
+        HRESULT hr = S_OK;
+        std::vector<uintptr_t> hits;
+        if (!command_executor_->execute_on_engine(CommandPriority::Interactive, [&]() {
+                hits = WinDbgHelpers::search_memory(static_cast<uintptr_t>(*address), *length, *pattern, max_hits, &hr);
+            })) {
+            *error_message = "search_memory cancelled";
+            return true;
+        }
+        if (FAILED(hr)) {
+            *error_message = "Memory search failed: " + WinDbgHelpers::format_windbg_error(hr);
+            return true;
+        }
+        
+        *data = {
+            {"hits", hits},
+            {"truncated", hits.size() == max_hits}
+        };
+        output->clear();
+        return true;
+    }
+    
+    return false;
 }
 
 /**
- * @brief Handles generic command execution for LLM-driven debugging.
+ * @brief Handles a batch request carrying several commands.
  * 
- * This method provides a flexible command routing system that can handle
- * various command formats and route them to appropriate handlers. It
- * includes command normalization, parameter parsing, and fallback to
- * direct execution when no specific handler is available.
+ * The commands run back-to-back on the calling thread, so they share its
+ * capture session and the executor's result cache, and the client gets all
+ * results in one response instead of paying a round-trip per command.
+ * Commands are executed as typed, without routing to specific handlers.
  * 
- * @param[in] command The command to execute
+ * - execute_batch: parameters {"commands": [...], "stop_on_error",
+ *   "timeout_per_command_ms"}. data mirrors BatchResult, with one entry
+ *   per executed command holding its output and execution time. An output
+ *   filter in the request applies to each command's output.
  * 
- * @return Result of command execution
+ * @param[in] operation Request command name
+ * @param[in] parameters Request parameters
+ * @param[in] default_timeout Timeout per command when the request does not set one
+ * @param[out] data Receives the structured result
+ * @param[out] error_message Receives the reason a request was rejected
+ * 
+ * @return true if the operation is a batch request, whether or not it succeeded
  */
-std::string CommandHandlers::handle_generic_command(_In_ std::string_view command) {
-    LOG_INFO("CommandHandlers", "Processing command: " + std::string(command));
-    
-    if (!command_executor_) {
-        LOG_ERROR("CommandHandlers", "No command executor available");
-        return "Error: Internal error";
+bool CommandHandlers::handle_batch_request(
+    _In_ std::string_view operation,
+    _In_ const nlohmann::json& parameters,
+    _In_ std::chrono::milliseconds default_timeout,
+    _Out_ nlohmann::json* data,
+    _Out_ std::string* error_message) {
+    
+    if (operation != "execute_batch") {
+        return false;
     }
     
-    // Normalize command for routing
-    std::string normalized_command = std::string(command);
-    std::transform(normalized_command.begin(), normalized_command.end(), 
-                   normalized_command.begin(), 
-                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
-    
-    LOG_DEBUG("CommandHandlers", "Normalized command: " + normalized_command);
+    if (!parameters.contains("commands") || !parameters["commands"].is_array() || parameters["commands"].empty()) {
+        *error_message = "execute_batch requires a non-empty 'commands' array";
+        return true;
+    }
+    if (parameters["commands"].size() > Constants::MAX_BATCH_COMMANDS) {
+        *error_message = "execute_batch is limited to " + std::to_string(Constants::MAX_BATCH_COMMANDS) + " commands per request";
+        return true;
+    }
     
-    // Remove leading/trailing whitespace
-    auto trimmed_command = std::string_view(normalized_command).substr(
-        normalized_command.find_first_not_of(" \t\n\r"),
-        normalized_command.find_last_not_of(" \t\n\r") - normalized_command.find_first_not_of(" \t\n\r") + 1
-    );
+    std::vector<std::string> commands;
+    commands.reserve(parameters["commands"].size());
+    for (const auto& entry : parameters["commands"]) {
+        if (!entry.is_string() || CommandUtils::trim(entry.get<std::string>()).empty()) {
+            *error_message = "Each batch command must be a non-empty string";
+            return true;
+        }
+        commands.push_back(entry.get<std::string>());
+    }
     
-    LOG_DEBUG("CommandHandlers", "Trimmed command: " + std::string(trimmed_command));
+    ExecutionOptions options;
+    options.timeout = default_timeout;
+    options.stop_on_error = parameters.value("stop_on_error", false);
+    if (auto* context = RequestContext::current()) {
+        options.output_filter = context->output_filter;
+    }
+    if (parameters.contains("timeout_per_command_ms")) {
+        auto timeout = json_to_number(parameters["timeout_per_command_ms"]);
+        if (timeout && *timeout > 0) {
+            options.timeout = std::chrono::milliseconds(*timeout);
+        }
+    }
     
-    // Try to route to specific handlers first (for better error handling and structured responses)
-    LOG_DEBUG("CommandHandlers", "Trying specific handlers");
-    auto routed_result = try_route_to_specific_handler(trimmed_command, command);
-    if (!routed_result.empty()) {
-        LOG_INFO_DETAIL("CommandHandlers", "Routed to specific handler", "Result length: " + std::to_string(routed_result.length()));
-        return routed_result;
+    LOG_INFO("CommandHandlers", "Executing batch of " + std::to_string(commands.size()) + " commands");
+    ExecutionError batch_error;
+    auto batch = command_executor_->execute_batch(commands, options, nullptr, &batch_error);
+    
+    // Outputs share one response, so once the budget is spent the remaining
+    // outputs are cut; the commands themselves still ran
+    size_t output_budget = Constants::MAX_BATCH_OUTPUT_SIZE;
+    nlohmann::json results = nlohmann::json::array();
+    for (auto& result : batch.results) {
+        bool truncated = result.output.size() > output_budget;
+        if (truncated) {
+            result.output.resize(output_budget);
+        }
+        output_budget -= result.output.size();
+        
+        nlohmann::json result_json = {
+            {"command", result.command_executed},
+            {"success", result.success},
+            {"output", std::move(result.output)},
+            {"execution_time_ms", result.execution_time.count()},
+            {"cache_hit", result.metadata.value("cache_hit", false)}
+        };
+        if (!result.success) {
+            result_json["error_message"] = result.error_message;
+        }
+        if (truncated) {
+            result_json["truncated"] = true;
+        }
+        results.push_back(std::move(result_json));
     }
     
-    // If no specific handler, execute directly
-    LOG_DEBUG("CommandHandlers", "No specific handler found, executing directly");
-    return handle_execute_command(command);
+    *data = {
+        {"results", std::move(results)},
+        {"successful_commands", batch.successful_commands},
+        {"failed_commands", batch.failed_commands},
+        {"skipped_commands", batch.skipped_commands},
+        {"total_execution_time_ms", batch.total_execution_time.count()},
+        {"all_successful", batch.all_successful}
+    };
+    return true;
 }
 
 /**
- * @brief Attempts to route a command to a specific handler.
+ * @brief Handles a request to analyze several crash dumps in parallel.
+ * 
+ * Each dump is opened by a worker debugger process of its own, so the dumps
+ * are analyzed side by side and the debugger this extension is loaded in
+ * keeps its target. Results are tagged with the dump they came from.
  * 
- * This method implements a command routing system that recognizes common
- * WinDbg commands and routes them to appropriate specialized handlers.
- * It provides better error handling and structured responses for known
- * command types while falling back to direct execution for unknown commands.
+ * - analyze_dumps: parameters {"dumps": [...], "commands": [...],
+ *   "max_parallel", "timeout_per_dump_ms", "symbol_path"}. The worker
+ *   debugger is chosen on the extension side, never by the request.
+ *   data {"results": [{dump, success, exit_code, timed_out, output,
+ *   execution_time_ms}, ...], "successful_dumps", "failed_dumps",
+ *   "total_execution_time_ms"}.
  * 
- * @param[in] normalized_command Normalized command string for routing
- * @param[in] original_command Original command string for parameter extraction
+ * @param[in] operation Request command name
+ * @param[in] parameters Request parameters
+ * @param[out] data Receives the structured result
+ * @param[out] error_message Receives the reason a request was rejected
  * 
- * @return Result from specific handler, or empty string if no handler found
+ * @return true if the operation is a dump analysis request, whether or not it succeeded
  */
-std::string CommandHandlers::try_route_to_specific_handler(
-    _In_ std::string_view normalized_command, 
-    _In_ std::string_view original_command) {
-    // Extract command and parameters
-    auto space_pos = normalized_command.find(' ');
-    auto cmd = space_pos != std::string::npos ? normalized_command.substr(0, space_pos) : normalized_command;
-    auto params = space_pos != std::string::npos ? normalized_command.substr(space_pos + 1) : std::string_view{};
-    
-    // Route based on command type
-    if (cmd == "k" || cmd == "kn" || cmd == "kl" || cmd == "kp" || cmd == "kv") {
-        return handle_show_stack_trace();
+bool CommandHandlers::handle_dump_request(
+    _In_ std::string_view operation,
+    _In_ const nlohmann::json& parameters,
+    _Out_ nlohmann::json* data,
+    _Out_ std::string* error_message) {
+    
+    if (operation != "analyze_dumps") {
+        return false;
     }
     
-    if (cmd == "~") {
-        return handle_list_threads();
-    }
+    auto read_strings = [&parameters, error_message](const char* key, std::vector<std::string>* values) {
+        if (!parameters.contains(key) || !parameters[key].is_array() || parameters[key].empty()) {
+            *error_message = std::string("analyze_dumps requires a non-empty '") + key + "' array";
+            return false;
+        }
+        for (const auto& entry : parameters[key]) {
+            if (!entry.is_string() || CommandUtils::trim(entry.get<std::string>()).empty()) {
+                *error_message = std::string("Each entry of '") + key + "' must be a non-empty string";
+                return false;
+            }
+            values->push_back(entry.get<std::string>());
+        }
+        return true;
+    };
     
-    if (cmd == "!process" || cmd == "!processes") {
-        return handle_list_processes();
+    std::vector<std::string> dumps;
+    DumpAnalysisOptions options;
+    if (!read_strings("dumps", &dumps) || !read_strings("commands", &options.commands)) {
+        return true;
     }
-    
-    if (cmd == "lm" || cmd == "!modules") {
-        return handle_list_modules();
+    if (dumps.size() > Constants::MAX_DUMPS_PER_REQUEST) {
+        *error_message = "analyze_dumps is limited to " + std::to_string(Constants::MAX_DUMPS_PER_REQUEST) + " dumps per request";
+        return true;
     }
-    
-    if (cmd == "r" || cmd == "registers") {
-        return handle_show_registers();
+    if (options.commands.size() > Constants::MAX_BATCH_COMMANDS) {
+        *error_message = "analyze_dumps is limited to " + std::to_string(Constants::MAX_BATCH_COMMANDS) + " commands per request";
+        return true;
     }
     
-    if (cmd == "g" || cmd == "go") {
-        return handle_continue_execution();
+    // The script holds one command per line, and the workers get the same
+    // protection against dangerous commands as the attached engine
+    for (const auto& command : options.commands) {
+        if (command.find_first_of("\r\n") != std::string::npos || !command_executor_->validate_command_syntax(command)) {
+            *error_message = "Command rejected for dump analysis: " + command;
+            return true;
+        }
     }
     
-    if (cmd == "p" || cmd == "step") {
-        return handle_step_over();
+    if (parameters.contains("max_parallel")) {
+        options.max_parallel = static_cast<size_t>(json_to_number(parameters["max_parallel"]).value_or(0));
     }
-    
-    if (cmd == "t" || cmd == "trace") {
-        return handle_step_into();
+    if (parameters.contains("timeout_per_dump_ms")) {
+        auto timeout = json_to_number(parameters["timeout_per_dump_ms"]);
+        if (timeout && *timeout > 0) {
+            options.timeout_per_dump = std::chrono::milliseconds(
+                (std::min<uint64_t>)(*timeout, Constants::DUMP_ANALYSIS_TIMEOUT_MS));
+        }
     }
+    options.symbol_path = parameters.value("symbol_path", std::string());
     
-    if (cmd == "gu" || cmd == "stepout") {
-        return handle_step_out();
+    auto start_time = std::chrono::steady_clock::now();
+    auto results = DumpAnalyzer::analyze(dumps, options, error_message);
+    if (!error_message->empty()) {
+        return true;
     }
     
-    if (cmd == "gh") {
-        return handle_continue_with_exception_handled();
+    // Outputs share one response, so once the budget is spent the remaining
+    // outputs are cut; the analyses themselves still ran
+    size_t output_budget = Constants::MAX_BATCH_OUTPUT_SIZE;
+    size_t successful = 0;
+    nlohmann::json results_json = nlohmann::json::array();
+    for (auto& result : results) {
+        bool truncated = result.truncated || result.output.size() > output_budget;
+        if (result.output.size() > output_budget) {
+            result.output.resize(output_budget);
+        }
+        output_budget -= result.output.size();
+        successful += result.success ? 1 : 0;
+        
+        nlohmann::json result_json = {
+            {"dump", std::move(result.dump_path)},
+            {"success", result.success},
+            {"exit_code", result.exit_code},
+            {"timed_out", result.timed_out},
+            {"output", std::move(result.output)},
+            {"execution_time_ms", result.execution_time.count()}
+        };
+        if (!result.error_message.empty()) {
+            result_json["error_message"] = std::move(result.error_message);
+        }
+        if (truncated) {
+            result_json["truncated"] = true;
+        }
+        results_json.push_back(std::move(result_json));
     }
     
-    if (cmd == "gn") {
-        return handle_continue_with_exception_not_handled();
+    *data = {
+        {"results", std::move(results_json)},
+        {"successful_dumps", successful},
+        {"failed_dumps", results.size() - successful},
+        {"total_execution_time_ms", std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start_time).count()}
+    };
+    return true;
+}
+
+/**
+ * @brief Handles a request to count the objects in the target's memory.
+ * 
+ * Replaces "!heap -stat" and "s -d" loops: the committed regions are read in
+ * large blocks and matched on a thread pool, and what comes back is a
+ * histogram instead of text.
+ * 
+ * - scan_heap: parameters {"region_types": ["private", "mapped", "image"],
+ *   "max_bytes", "max_parallel", "top", "vtables_only", "patterns": [hex, ...]}.
+ *   data {"histogram": [{value, symbol, count, bytes}, ...], "patterns":
+ *   [{pattern, count, hits}, ...], "regions", "bytes_scanned",
+ *   "bytes_unreadable", "distinct_pointers", "resolved", "truncated",
+ *   "pointer_size", "threads", "elapsed_ms"}.
+ * 
+ * @param[in] operation Request command name
+ * @param[in] parameters Request parameters
+ * @param[out] data Receives the histograms
+ * @param[out] error_message Receives the reason a request was rejected
+ * 
+ * @return true if the operation is a heap scan request, whether or not it succeeded
+ */
+bool CommandHandlers::handle_heap_request(
+    _In_ std::string_view operation,
+    _In_ const nlohmann::json& parameters,
+    _Out_ nlohmann::json* data,
+    _Out_ std::string* error_message) {
+    
+    if (operation != "scan_heap") {
+        return false;
+    }
+    if (!command_executor_) {
+        *error_message = "Command executor not available";
+        return true;
     }
     
-    if (cmd == "bl" || cmd == "breakpoints") {
-        return handle_list_breakpoints();
+    HeapScanOptions options;
+    if (parameters.contains("region_types")) {
+        static constexpr std::pair<std::string_view, uint32_t> region_types[] = {
+            {"private", MEM_PRIVATE}, {"mapped", MEM_MAPPED}, {"image", MEM_IMAGE}};
+        if (!parameters["region_types"].is_array() || parameters["region_types"].empty()) {
+            *error_message = "scan_heap 'region_types' must be a non-empty array";
+            return true;
+        }
+        options.region_types = 0;
+        for (const auto& entry : parameters["region_types"]) {
+            auto type = std::find_if(std::begin(region_types), std::end(region_types), [&entry](const auto& known) {
+                return entry.is_string() && entry.get<std::string>() == known.first;
+            });
+            if (type == std::end(region_types)) {
+                *error_message = "scan_heap 'region_types' entries must be private, mapped or image";
+                return true;
+            }
+            options.region_types |= type->second;
+        }
+    }
+    if (parameters.contains("max_bytes")) {
+        auto max_bytes = json_to_number(parameters["max_bytes"]);
+        if (!max_bytes || *max_bytes == 0) {
+            *error_message = "scan_heap 'max_bytes' must be a positive number";
+            return true;
+        }
+        options.max_bytes = *max_bytes;
+    }
+    if (parameters.contains("max_parallel")) {
+        options.max_parallel = static_cast<size_t>(json_to_number(parameters["max_parallel"]).value_or(0));
+    }
+    if (parameters.contains("top")) {
+        auto top = json_to_number(parameters["top"]);
+        if (!top || *top == 0) {
+            *error_message = "scan_heap 'top' must be a positive number";
+            return true;
+        }
+        options.top = static_cast<size_t>((std::min<uint64_t>)(*top, Constants::MAX_HEAP_SCAN_TOP));
+    }
+    options.vtables_only = parameters.value("vtables_only", true);
+    if (parameters.contains("patterns")) {
+        if (!parameters["patterns"].is_array() || parameters["patterns"].size() > Constants::MAX_HEAP_SCAN_PATTERNS) {
+            *error_message = "scan_heap 'patterns' must be an array of at most " +
+                             std::to_string(Constants::MAX_HEAP_SCAN_PATTERNS) + " hex strings";
+            return true;
+        }
+        for (const auto& entry : parameters["patterns"]) {
+            auto bytes = entry.is_string() ? WinDbgHelpers::parse_hex_bytes(entry.get<std::string>()) : std::nullopt;
+            if (!bytes || bytes->empty() || bytes->size() > Constants::MAX_HEAP_SCAN_PATTERN_SIZE) {
+                *error_message = "Each scan_heap pattern must be 1 to " +
+                                 std::to_string(Constants::MAX_HEAP_SCAN_PATTERN_SIZE) + " bytes of hex";
+                return true;
+            }
+            options.patterns.push_back(std::move(*bytes));
+        }
     }
     
-    // Symbol loading commands
-            if (cmd == "loadusersymbols" || cmd == "load_user_symbols") {
-            return handle_load_user_symbols();
+    auto result = HeapScanner::scan(*command_executor_, options, error_message);
+    
+    static constexpr char hex_digits[] = "0123456789abcdef";
+    nlohmann::json histogram = nlohmann::json::array();
+    for (auto& entry : result.pointers) {
+        histogram.push_back({
+            {"value", entry.value},
+            {"symbol", std::move(entry.symbol)},
+            {"count", entry.count},
+            {"bytes", entry.bytes}
+        });
+    }
+    nlohmann::json patterns = nlohmann::json::array();
+    for (const auto& pattern : result.patterns) {
+        std::string hex;
+        for (uint8_t byte : pattern.pattern) {
+            hex += hex_digits[byte >> 4];
+            hex += hex_digits[byte & 0xf];
         }
+        patterns.push_back({{"pattern", std::move(hex)}, {"count", pattern.count}, {"hits", pattern.hits}});
+    }
+    *data = {
+        {"histogram", std::move(histogram)},
+        {"patterns", std::move(patterns)},
+        {"regions", result.regions},
+        {"bytes_scanned", result.bytes_scanned},
+        {"bytes_unreadable", result.bytes_unreadable},
+        {"distinct_pointers", result.distinct_pointers},
+        {"resolved", result.resolved},
+        {"truncated", result.truncated},
+        {"pointer_size", result.pointer_size},
+        {"threads", result.threads},
+        {"elapsed_ms", result.elapsed.count()}
+    };
+    return true;
+}
+
+/**
+ * @brief Handles a request to disassemble several ranges in one round-trip.
+ * 
+ * Replaces one "u" or "ub" per stack frame. Every range is decoded with
+ * Disassemble in one engine job, with the symbol and source line of each
+ * instruction, and instructions decoded before come from the disassembly
+ * cache instead of the engine.
+ * 
+ * - disassemble: parameters {"ranges": [{"address", "count", "before",
+ *   "end"}, ...], "stack_frames", "count", "before"}. A range starts
+ *   "before" instructions ahead of its address and runs for "count" more,
+ *   or up to "end". "stack_frames" adds a range around each of the current
+ *   thread's first N frames. The top-level "count" and "before" replace the
+ *   defaults of every range. data {"ranges": [{"address", "frame", "start",
+ *   "instructions": [{address, size, text, symbol, displacement, line,
+ *   file}, ...], "cached", "error"}, ...], "instructions",
+ *   "cached_instructions", "truncated", "elapsed_ms"}. An instruction
+ *   carries symbol and displacement only where the symbol changes, and
+ *   file only where the file changes.
+ * 
+ * @param[in] operation Request command name
+ * @param[in] parameters Request parameters
+ * @param[out] data Receives the decoded ranges
+ * @param[out] error_message Receives the reason a request was rejected
+ * 
+ * @return true if the operation is a disassembly request, whether or not it succeeded
+ */
+bool CommandHandlers::handle_disassembly_request(
+    _In_ std::string_view operation,
+    _In_ const nlohmann::json& parameters,
+    _Out_ nlohmann::json* data,
+    _Out_ std::string* error_message) {
+    
+    if (operation != "disassemble") {
+        return false;
+    }
+    if (!command_executor_) {
+        *error_message = "Command executor not available";
+        return true;
+    }
     
-    if (cmd == "loadallsymbols" || cmd == "load_all_symbols") {
-        return handle_load_all_symbols();
+    auto read_size = [error_message](const nlohmann::json& object, const char* name, size_t maximum, size_t* value) {
+        if (!object.contains(name)) {
+            return true;
+        }
+        auto number = json_to_number(object[name]);
+        if (!number || *number > maximum) {
+            *error_message = std::format("disassemble '{}' must be a number up to {}", name, maximum);
+            return false;
+        }
+        *value = static_cast<size_t>(*number);
+        return true;
+    };
+    
+    struct Range {
+        uint64_t address{0};
+        size_t before{0};
+        size_t count{0};
+        uint64_t end{0};
+        std::optional<uint32_t> frame;
+    };
+    
+    size_t count = Constants::DEFAULT_DISASSEMBLY_COUNT;
+    size_t before = 0;
+    size_t frame_count = Constants::DEFAULT_FRAME_DISASSEMBLY_COUNT;
+    size_t frame_before = Constants::DEFAULT_FRAME_DISASSEMBLY_BEFORE;
+    if (parameters.contains("count") &&
+        (!read_size(parameters, "count", Constants::MAX_DISASSEMBLY_COUNT, &count) || count == 0)) {
+        *error_message = "disassemble 'count' must be 1 to " + std::to_string(Constants::MAX_DISASSEMBLY_COUNT);
+        return true;
+    }
+    if (!read_size(parameters, "before", Constants::MAX_DISASSEMBLY_BEFORE, &before)) {
+        return true;
+    }
+    if (parameters.contains("count")) {
+        frame_count = count;
+    }
+    if (parameters.contains("before")) {
+        frame_before = before;
     }
     
-    // Parent process information
-    if (cmd == "getparentprocess" || cmd == "get_parent_process" || cmd == "parentprocess" || cmd == "parent_process") {
-        return handle_get_parent_process();
+    size_t stack_frames = 0;
+    if (!read_size(parameters, "stack_frames", Constants::MAX_DISASSEMBLY_RANGES, &stack_frames)) {
+        return true;
     }
     
-    // Handle breakpoint commands with parameters
-    if (cmd == "bp" || cmd == "breakpoint") {
-        if (!params.empty()) {
-            // Try to parse as address or symbol
-            if (params.find("0x") == 0 || params.find_first_of("0123456789abcdefABCDEF") == 0) {
-                // Likely an address
-                try {
-                    uintptr_t addr = std::stoull(std::string(params), nullptr, 16);
-                    return handle_set_breakpoint(addr);
-                } catch (const std::invalid_argument& e) {
-                    LOG_WARNING("CommandHandlers", "Invalid address format: " + std::string(params) + " - " + e.what());
-                    return "Error: Invalid address format '" + std::string(params) + "'";
-                } catch (const std::out_of_range& e) {
-                    LOG_WARNING("CommandHandlers", "Address out of range: " + std::string(params) + " - " + e.what());
-                    return "Error: Address '" + std::string(params) + "' is out of range";
-                } catch (const std::exception& e) {
-                    LOG_WARNING("CommandHandlers", "Exception parsing address: " + std::string(params) + " - " + e.what());
-                    return "Error: Failed to parse address '" + std::string(params) + "'";
-                } catch (...) {
-                    LOG_WARNING("CommandHandlers", "Unknown exception parsing address: " + std::string(params));
-                    return "Error: Unknown error parsing address '" + std::string(params) + "'";
+    std::vector<Range> ranges;
+    if (parameters.contains("ranges")) {
+        if (!parameters["ranges"].is_array() ||
+            parameters["ranges"].size() + stack_frames > Constants::MAX_DISASSEMBLY_RANGES) {
+            *error_message = "disassemble takes an array of at most " +
+                             std::to_string(Constants::MAX_DISASSEMBLY_RANGES) + " ranges and stack frames";
+            return true;
+        }
+        for (const auto& entry : parameters["ranges"]) {
+            auto address = entry.is_object() && entry.contains("address") ? json_to_number(entry["address"]) : std::nullopt;
+            if (!address) {
+                *error_message = "Each disassemble range needs an address";
+                return true;
+            }
+            
+            Range range{*address, before, count};
+            if (entry.contains("end")) {
+                auto end = json_to_number(entry["end"]);
+                if (!end || *end <= *address || *end - *address > Constants::MAX_DISASSEMBLY_RANGE_BYTES) {
+                    *error_message = "A disassemble range's 'end' must lie within " +
+                                     std::to_string(Constants::MAX_DISASSEMBLY_RANGE_BYTES) + " bytes after its address";
+                    return true;
                 }
-            } else {
-                // Likely a symbol
-                return handle_set_symbol_breakpoint(params);
+                range.end = *end;
+                range.count = Constants::MAX_DISASSEMBLY_COUNT;
+            }
+            if (!read_size(entry, "count", Constants::MAX_DISASSEMBLY_COUNT, &range.count) ||
+                !read_size(entry, "before", Constants::MAX_DISASSEMBLY_BEFORE, &range.before)) {
+                return true;
             }
+            ranges.push_back(range);
         }
     }
+    if (ranges.empty() && stack_frames == 0) {
+        *error_message = "disassemble requires 'ranges' or 'stack_frames'";
+        return true;
+    }
     
-    if (cmd == "bc" || cmd == "clear") {
-        if (!params.empty()) {
-            try {
-                uint32_t bp_id = std::stoul(std::string(params));
-                return handle_clear_breakpoint(bp_id);
-            } catch (const std::invalid_argument& e) {
-                LOG_WARNING("CommandHandlers", "Invalid breakpoint ID format: " + std::string(params) + " - " + e.what());
-                return "Error: Invalid breakpoint ID format '" + std::string(params) + "'";
-            } catch (const std::out_of_range& e) {
-                LOG_WARNING("CommandHandlers", "Breakpoint ID out of range: " + std::string(params) + " - " + e.what());
-                return "Error: Breakpoint ID '" + std::string(params) + "' is out of range";
-            } catch (const std::exception& e) {
-                LOG_WARNING("CommandHandlers", "Exception parsing breakpoint ID: " + std::string(params) + " - " + e.what());
-                return "Error: Failed to parse breakpoint ID '" + std::string(params) + "'";
-            } catch (...) {
-                LOG_WARNING("CommandHandlers", "Unknown exception parsing breakpoint ID: " + std::string(params));
-                return "Error: Unknown error parsing breakpoint ID '" + std::string(params) + "'";
+    // Stack frames are walked on the engine, in the same job that decodes
+    // them, so the ranges describe one target state
+    auto start_time = std::chrono::steady_clock::now();
+    nlohmann::json range_results = nlohmann::json::array();
+    size_t total = 0;
+    size_t total_cached = 0;
+    bool truncated = false;
+    HRESULT hr = S_OK;
+    bool ran = command_executor_->execute_on_engine(CommandPriority::Interactive, [&]() {
+        if (stack_frames > 0) {
+            auto offsets = WinDbgHelpers::get_stack_offsets(stack_frames, &hr);
+            if (FAILED(hr)) {
+                return;
+            }
+            for (size_t i = 0; i < offsets.size(); ++i) {
+                ranges.push_back({offsets[i], frame_before, frame_count, 0, static_cast<uint32_t>(i)});
             }
         }
-    }
-    
-    if (cmd == "bd" || cmd == "disable") {
-        if (!params.empty()) {
-            try {
-                uint32_t bp_id = std::stoul(std::string(params));
-                return handle_disable_breakpoint(bp_id);
-            } catch (const std::invalid_argument& e) {
-                LOG_WARNING("CommandHandlers", "Invalid breakpoint ID format: " + std::string(params) + " - " + e.what());
-                return "Error: Invalid breakpoint ID format '" + std::string(params) + "'";
-            } catch (const std::out_of_range& e) {
-                LOG_WARNING("CommandHandlers", "Breakpoint ID out of range: " + std::string(params) + " - " + e.what());
-                return "Error: Breakpoint ID '" + std::string(params) + "' is out of range";
-            } catch (const std::exception& e) {
-                LOG_WARNING("CommandHandlers", "Exception parsing breakpoint ID: " + std::string(params) + " - " + e.what());
-                return "Error: Failed to parse breakpoint ID '" + std::string(params) + "'";
-            } catch (...) {
-                LOG_WARNING("CommandHandlers", "Unknown exception parsing breakpoint ID: " + std::string(params));
-                return "Error: Unknown error parsing breakpoint ID '" + std::string(params) + "'";
+        
+        for (const auto& range : ranges) {
+            size_t budget = Constants::MAX_DISASSEMBLY_INSTRUCTIONS - total;
+            if (budget == 0) {
+                truncated = true;
+                break;
+            }
+            size_t wanted = range.end ? range.count : range.before + range.count;
+            if (wanted > budget) {
+                wanted = budget;
+                truncated = true;
             }
+            
+            // Backwards decoding that fails starts the range at its address
+            HRESULT range_hr = S_OK;
+            uint64_t start = WinDbgHelpers::get_instruction_before(range.address, range.before, &range_hr);
+            size_t cached = 0;
+            auto instructions = WinDbgHelpers::disassemble(start, wanted, range.end, &cached, &range_hr);
+            
+            nlohmann::json instruction_results = nlohmann::json::array();
+            const DecodedInstruction* previous = nullptr;
+            for (auto& instruction : instructions) {
+                nlohmann::json entry = {
+                    {"address", instruction.address},
+                    {"size", instruction.size},
+                    {"text", std::move(instruction.text)}
+                };
+                if (!instruction.symbol.empty() && (!previous || previous->symbol != instruction.symbol)) {
+                    entry["symbol"] = instruction.symbol;
+                    entry["displacement"] = instruction.displacement;
+                }
+                if (instruction.line != 0) {
+                    entry["line"] = instruction.line;
+                    if (!previous || previous->file != instruction.file) {
+                        entry["file"] = instruction.file;
+                    }
+                }
+                instruction_results.push_back(std::move(entry));
+                previous = &instruction;
+            }
+            
+            nlohmann::json result = {
+                {"address", range.address},
+                {"start", start},
+                {"instructions", std::move(instruction_results)},
+                {"cached", cached}
+            };
+            if (range.frame) {
+                result["frame"] = *range.frame;
+            }
+            if (FAILED(range_hr)) {
+                result["error"] = WinDbgHelpers::format_windbg_error(range_hr);
+            }
+            range_results.push_back(std::move(result));
+            total += instructions.size();
+            total_cached += cached;
         }
+    });
+    if (!ran) {
+        *error_message = "disassemble cancelled";
+        return true;
+    }
+    if (FAILED(hr)) {
+        *error_message = "disassemble could not walk the stack: " + WinDbgHelpers::format_windbg_error(hr);
+        return true;
+    }
+    
+    *data = {
+        {"ranges", std::move(range_results)},
+        {"instructions", total},
+        {"cached_instructions", total_cached},
+        {"truncated", truncated},
+        {"elapsed_ms", std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start_time).count()}
+    };
+    return true;
+}
+
+/**
+ * @brief Handles requests that start, follow or stop a background symbol load.
+ * 
+ * None of them waits for the load; its progress is in the status they
+ * return and in the symbol_load events pushed to subscribers.
+ * 
+ * - load_symbols: parameters {"modules": [...], "max_parallel", "prefetch",
+ *   "symbol_path"}; without modules, every module whose symbols are deferred
+ *   is loaded. Fails if a load is already running.
+ * - get_symbol_load_status: the status of the running or the last load.
+ * - cancel_symbol_load: stops the running load.
+ * 
+ * Each returns data {job, running, cancelled, total, completed, loaded,
+ * failed, prefetched, stack_modules, failures, elapsed_ms}.
+ * 
+ * @param[in] operation Request command name
+ * @param[in] parameters Request parameters
+ * @param[out] data Receives the load status
+ * @param[out] error_message Receives the reason a request was rejected
+ * 
+ * @return true if the operation is a symbol load request, whether or not it succeeded
+ */
+bool CommandHandlers::handle_symbol_request(
+    _In_ std::string_view operation,
+    _In_ const nlohmann::json& parameters,
+    _Out_ nlohmann::json* data,
+    _Out_ std::string* error_message) {
+    
+    if (operation != "load_symbols" && operation != "get_symbol_load_status" && operation != "cancel_symbol_load") {
+        return false;
+    }
+    if (!symbol_loader_) {
+        *error_message = "Symbol loader not available";
+        return true;
     }
     
-    if (cmd == "be" || cmd == "enable") {
-        if (!params.empty()) {
-            try {
-                uint32_t bp_id = std::stoul(std::string(params));
-                return handle_enable_breakpoint(bp_id);
-            } catch (const std::invalid_argument& e) {
-                LOG_WARNING("CommandHandlers", "Invalid breakpoint ID format: " + std::string(params) + " - " + e.what());
-                return "Error: Invalid breakpoint ID format '" + std::string(params) + "'";
-            } catch (const std::out_of_range& e) {
-                LOG_WARNING("CommandHandlers", "Breakpoint ID out of range: " + std::string(params) + " - " + e.what());
-                return "Error: Breakpoint ID '" + std::string(params) + "' is out of range";
-            } catch (const std::exception& e) {
-                LOG_WARNING("CommandHandlers", "Exception parsing breakpoint ID: " + std::string(params) + " - " + e.what());
-                return "Error: Failed to parse breakpoint ID '" + std::string(params) + "'";
-            } catch (...) {
-                LOG_WARNING("CommandHandlers", "Unknown exception parsing breakpoint ID: " + std::string(params));
-                return "Error: Unknown error parsing breakpoint ID '" + std::string(params) + "'";
+    if (operation == "load_symbols") {
+        SymbolLoadOptions options;
+        if (parameters.contains("modules")) {
+            if (!parameters["modules"].is_array()) {
+                *error_message = "load_symbols 'modules' must be an array of module names";
+                return true;
             }
+            for (const auto& module : parameters["modules"]) {
+                if (!module.is_string() || CommandUtils::trim(module.get<std::string>()).empty()) {
+                    *error_message = "Each entry of 'modules' must be a non-empty string";
+                    return true;
+                }
+                options.modules.push_back(CommandUtils::trim(module.get<std::string>()));
+            }
+        }
+        if (parameters.contains("max_parallel")) {
+            options.max_parallel = static_cast<size_t>(json_to_number(parameters["max_parallel"]).value_or(0));
         }
+        options.prefetch = parameters.value("prefetch", true);
+        options.symbol_path = parameters.value("symbol_path", std::string());
+        
+        if (!symbol_loader_->start(options, error_message)) {
+            *data = SymbolLoader::status_json(symbol_loader_->get_status());
+            return true;
+        }
+    } else if (operation == "cancel_symbol_load") {
+        symbol_loader_->cancel();
     }
     
-    if (cmd == ".attach") {
-        if (!params.empty()) {
-            try {
-                uint32_t pid = std::stoul(std::string(params), nullptr, 16);
-                return handle_attach_process(pid);
-            } catch (const std::invalid_argument& e) {
-                LOG_WARNING("CommandHandlers", "Invalid process ID format: " + std::string(params) + " - " + e.what());
-                return "Error: Invalid process ID format '" + std::string(params) + "'";
-            } catch (const std::out_of_range& e) {
-                LOG_WARNING("CommandHandlers", "Process ID out of range: " + std::string(params) + " - " + e.what());
-                return "Error: Process ID '" + std::string(params) + "' is out of range";
-            } catch (const std::exception& e) {
-                LOG_WARNING("CommandHandlers", "Exception parsing process ID: " + std::string(params) + " - " + e.what());
-                return "Error: Failed to parse process ID '" + std::string(params) + "'";
-            } catch (...) {
-                LOG_WARNING("CommandHandlers", "Unknown exception parsing process ID: " + std::string(params));
-                return "Error: Unknown error parsing process ID '" + std::string(params) + "'";
+    *data = SymbolLoader::status_json(symbol_loader_->get_status());
+    return true;
+}
+
+/**
+ * @brief Handles structured state requests answered straight from DbgEng.
+ * 
+ * The text handlers run "lm", "~", "k" or "r" and leave the client to parse
+ * the output; these operations read the same state through the debugger
+ * interfaces and return it as JSON, with no command text in between.
+ * 
+ * - get_modules: session_data {"modules": [{name, image_name, base, size,
+ *   timestamp, checksum, symbol_type, unloaded}, ...]}.
+ * - get_threads: session_data {"threads": [{engine_id, system_id, current}, ...]}.
+ * - get_stack_trace: parameters {"max_frames"}; session_data {"frames":
+ *   [{frame_number, instruction_offset, return_offset, frame_offset,
+ *   stack_offset, symbol, displacement}, ...]}.
+ * - get_thread_stacks: parameters {"max_frames"}; session_data {"thread_count",
+ *   "unique_stacks", "buckets": [{count, threads, frames: [{instruction_offset,
+ *   symbol, displacement}, ...]}, ...]} with identical stacks folded, most
+ *   common first.
+ * - get_registers: session_data {"registers": {name: value, ...}}.
+ * - get_session_state: session_data as SessionManager::serialize_state()
+ *   returns it; read from the state the event callbacks keep, so it does not
+ *   wait for the engine thread.
+ * - dx_query: parameters {"expression", "offset", "limit", "depth", "raw"};
+ *   session_data as DataModelQuery::evaluate() returns it, a typed tree of
+ *   the data model objects the expression yields with collections paged.
+ * 
+ * @param[in] operation Request command name
+ * @param[in] parameters Request parameters
+ * @param[out] session_data Receives the structured state
+ * @param[out] error_message Receives the reason a request failed
+ * 
+ * @return true if the operation is a structured state request, whether or not it succeeded
+ */
+bool CommandHandlers::handle_state_request(
+    _In_ std::string_view operation,
+    _In_ const nlohmann::json& parameters,
+    _Out_ nlohmann::json* session_data,
+    _Out_ std::string* error_message) {
+    
+    using Query = void (*)(const nlohmann::json& parameters, nlohmann::json* session_data, HRESULT* hr);
+    static constexpr std::pair<std::string_view, Query> queries[] = {
+        {"get_modules", [](const nlohmann::json&, nlohmann::json* session_data, HRESULT* hr) {
+            static constexpr const char* symbol_types[] = {
+                "none", "coff", "codeview", "pdb", "export", "deferred", "sym", "dia"};
+            nlohmann::json modules = nlohmann::json::array();
+            for (auto& module : WinDbgHelpers::get_module_entries(hr)) {
+                modules.push_back({
+                    {"name", std::move(module.name)},
+                    {"image_name", std::move(module.image_name)},
+                    {"base", module.base},
+                    {"size", module.size},
+                    {"timestamp", module.timestamp},
+                    {"checksum", module.checksum},
+                    {"symbol_type", module.symbol_type < std::size(symbol_types) ? symbol_types[module.symbol_type] : "unknown"},
+                    {"unloaded", module.unloaded}
+                });
             }
+            *session_data = {{"modules", std::move(modules)}};
+        }},
+        {"get_threads", [](const nlohmann::json&, nlohmann::json* session_data, HRESULT* hr) {
+            nlohmann::json threads = nlohmann::json::array();
+            for (const auto& thread : WinDbgHelpers::get_thread_entries(hr)) {
+                threads.push_back({
+                    {"engine_id", thread.engine_id},
+                    {"system_id", thread.system_id},
+                    {"current", thread.current}
+                });
+            }
+            *session_data = {{"threads", std::move(threads)}};
+        }},
+        {"get_stack_trace", [](const nlohmann::json& parameters, nlohmann::json* session_data, HRESULT* hr) {
+            size_t max_frames = requested_frame_count(parameters);
+            nlohmann::json frames = nlohmann::json::array();
+            for (auto& frame : WinDbgHelpers::get_stack_frames(max_frames, hr)) {
+                frames.push_back({
+                    {"frame_number", frame.frame_number},
+                    {"instruction_offset", frame.instruction_offset},
+                    {"return_offset", frame.return_offset},
+                    {"frame_offset", frame.frame_offset},
+                    {"stack_offset", frame.stack_offset},
+                    {"symbol", std::move(frame.symbol)},
+                    {"displacement", frame.displacement}
+                });
+            }
+            *session_data = {{"frames", std::move(frames)}};
+        }},
+        {"get_thread_stacks", [](const nlohmann::json& parameters, nlohmann::json* session_data, HRESULT* hr) {
+            size_t max_frames = requested_frame_count(parameters);
+            size_t thread_count = 0;
+            nlohmann::json buckets = nlohmann::json::array();
+            for (auto& bucket : WinDbgHelpers::get_stack_buckets(max_frames, &thread_count, hr)) {
+                nlohmann::json frames = nlohmann::json::array();
+                for (auto& frame : bucket.frames) {
+                    frames.push_back({
+                        {"instruction_offset", frame.instruction_offset},
+                        {"symbol", std::move(frame.symbol)},
+                        {"displacement", frame.displacement}
+                    });
+                }
+                buckets.push_back({
+                    {"count", bucket.system_ids.size()},
+                    {"threads", std::move(bucket.system_ids)},
+                    {"frames", std::move(frames)}
+                });
+            }
+            *session_data = {
+                {"thread_count", thread_count},
+                {"unique_stacks", buckets.size()},
+                {"buckets", std::move(buckets)}
+            };
+        }},
+        {"get_registers", [](const nlohmann::json&, nlohmann::json* session_data, HRESULT* hr) {
+            nlohmann::json registers = nlohmann::json::object();
+            for (const auto& reg : WinDbgHelpers::get_register_values(hr)) {
+                if (reg.float_value) {
+                    registers[reg.name] = *reg.float_value;
+                } else {
+                    registers[reg.name] = reg.value;
+                }
+            }
+            *session_data = {{"registers", std::move(registers)}};
+        }},
+    };
+    
+    if (operation == "get_session_state") {
+        if (!session_manager_) {
+            *error_message = "Session manager not available";
+        } else {
+            *session_data = session_manager_->serialize_state();
         }
+        return true;
     }
     
-    if (cmd == ".detach") {
-        return handle_detach_process();
+    if (operation == "dx_query") {
+        DataModelQueryOptions options;
+        if (!parse_data_model_query(parameters, &options, error_message)) {
+            return true;
+        }
+        if (!command_executor_) {
+            *error_message = "Command executor not available";
+            return true;
+        }
+        
+        HRESULT hr = S_OK;
+        std::string query_error;
+        bool ran = command_executor_->execute_on_engine(CommandPriority::Interactive, [&]() {
+            *session_data = DataModelQuery::evaluate(options, &hr, &query_error);
+        });
+        if (!ran) {
+            *error_message = "dx_query cancelled";
+        } else if (FAILED(hr)) {
+            *error_message = "dx_query failed: " + (query_error.empty() ? WinDbgHelpers::format_windbg_error(hr) : query_error);
+        }
+        return true;
     }
     
-    if (cmd == ".create") {
-        if (!params.empty()) {
-            return handle_create_process(params);
-        }
+    auto query = std::find_if(std::begin(queries), std::end(queries),
+                              [operation](const auto& entry) { return entry.first == operation; });
+    if (query == std::end(queries)) {
+        return false;
     }
     
-    if (cmd == ".restart") {
-        return handle_restart_process();
+    if (!command_executor_) {
+        *error_message = "Command executor not available";
+        return true;
     }
     
-    if (cmd == ".kill") {
-        return handle_terminate_process();
+    // Reads jump ahead of queued commands, like the text commands they replace
+    HRESULT hr = S_OK;
+    bool ran = command_executor_->execute_on_engine(CommandPriority::Interactive, [&]() {
+        query->second(parameters, session_data, &hr);
+    });
+    if (!ran) {
+        *error_message = std::string(operation) + " cancelled";
+    } else if (FAILED(hr)) {
+        *error_message = std::string(operation) + " failed: " + WinDbgHelpers::format_windbg_error(hr);
     }
+    return true;
+}
+
+/**
+ * @brief Handles memory region information requests.
+ * 
+ * @param[in] address Address to get region information for
+ * 
+ * @return Formatted memory region information
+ */
+std::string CommandHandlers::handle_show_memory_region(_In_ uintptr_t address) {
+    std::ostringstream oss;
+    oss << "!address " << format_hex(address);
+    return handle_execute_command(oss.str());
+}
+
+/**
+ * @brief Handles generic command execution for LLM-driven debugging.
+ * 
+ * This method provides a flexible command routing system that can handle
+ * various command formats and route them to appropriate handlers. It
+ * looks the command token up in the shared command table (command_table.h)
+ * and falls back to direct execution when no specific handler applies.
+ * 
+ * @param[in] command The command to execute
+ * 
+ * @return Result of command execution
+ */
+std::string CommandHandlers::handle_generic_command(_In_ std::string_view command) {
+    LOG_INFO("CommandHandlers", "Processing command: " + std::string(command));
     
-    if (cmd == ".dump") {
-        if (!params.empty()) {
-            return handle_load_dump(params);
-        }
+    if (!command_executor_) {
+        LOG_ERROR("CommandHandlers", "No command executor available");
+        return "Error: Internal error";
     }
     
-    if (cmd == "!analyze") {
-        return handle_analyze_crash();
+    // Route known commands to specific handlers first (for better error
+    // handling and structured responses); the lookup is case-insensitive and
+    // parameters keep their original case
+    std::string_view params;
+    const CommandInfo* info = find_command(command_token(command, &params));
+    if (info && info->route != CommandRoute::None) {
+        LOG_DEBUG("CommandHandlers", "Trying specific handler for: " + std::string(info->name));
+        auto* context = RequestContext::current();
+        TraceActivity route_activity(TraceStage::Route, context ? std::string_view(context->request_id) : std::string_view());
+        auto routed_result = try_route_to_specific_handler(info->route, params, command);
+        route_activity.stop();
+        if (!routed_result.empty()) {
+            LOG_INFO_DETAIL("CommandHandlers", "Routed to specific handler", "Result length: " + std::to_string(routed_result.length()));
+            return routed_result;
+        }
     }
     
-    // Memory commands
-    if (cmd == "db" || cmd == "dd" || cmd == "dw" || cmd == "dq") {
-        // Parse memory display commands
-        auto memory_result = try_parse_memory_command(original_command);
-        if (!memory_result.empty()) {
-            return memory_result;
+    // If no specific handler, execute directly
+    LOG_DEBUG("CommandHandlers", "No specific handler found, executing directly");
+    return handle_execute_command(command);
+}
+
+/**
+ * @brief Runs the specific handler a command table entry routes to.
+ * 
+ * Handlers are indexed by CommandRoute, so dispatch is a single array
+ * access. Handlers without parameters only take bare commands ("k", not
+ * "k 10"), and handlers that need parameters only take commands that have
+ * them; anything else, including parameters that do not parse, is left to
+ * direct execution so the debugger sees the command as typed.
+ * 
+ * @param[in] route Route from the command's table entry
+ * @param[in] params Trimmed parameters following the command token
+ * @param[in] original_command Original command string
+ * 
+ * @return Result from specific handler, or empty string if it does not apply
+ */
+std::string CommandHandlers::try_route_to_specific_handler(
+    _In_ CommandRoute route,
+    _In_ std::string_view params,
+    _In_ std::string_view original_command) {
+    enum class Arity : uint8_t { NoParams, Params, Any };
+    using Handler = std::string (*)(CommandHandlers& self, std::string_view params, std::string_view command);
+    struct RouteTarget {
+        CommandRoute route;
+        Arity arity;
+        Handler handler;
+    };
+    
+    static constexpr RouteTarget targets[] = {
+        {CommandRoute::None, Arity::Any,
+         [](CommandHandlers&, std::string_view, std::string_view) { return std::string(); }},
+        {CommandRoute::StackTrace, Arity::NoParams,
+         [](CommandHandlers& self, std::string_view, std::string_view) { return self.handle_show_stack_trace(); }},
+        {CommandRoute::ListThreads, Arity::NoParams,
+         [](CommandHandlers& self, std::string_view, std::string_view) { return self.handle_list_threads(); }},
+        {CommandRoute::ListProcesses, Arity::NoParams,
+         [](CommandHandlers& self, std::string_view, std::string_view) { return self.handle_list_processes(); }},
+        {CommandRoute::ListModules, Arity::NoParams,
+         [](CommandHandlers& self, std::string_view, std::string_view) { return self.handle_list_modules(); }},
+        {CommandRoute::ShowRegisters, Arity::NoParams,
+         [](CommandHandlers& self, std::string_view, std::string_view) { return self.handle_show_registers(); }},
+        {CommandRoute::Continue, Arity::NoParams,
+         [](CommandHandlers& self, std::string_view, std::string_view) { return self.handle_continue_execution(); }},
+        {CommandRoute::StepOver, Arity::NoParams,
+         [](CommandHandlers& self, std::string_view, std::string_view) { return self.handle_step_over(); }},
+        {CommandRoute::StepInto, Arity::NoParams,
+         [](CommandHandlers& self, std::string_view, std::string_view) { return self.handle_step_into(); }},
+        {CommandRoute::StepOut, Arity::NoParams,
+         [](CommandHandlers& self, std::string_view, std::string_view) { return self.handle_step_out(); }},
+        {CommandRoute::ContinueHandled, Arity::NoParams,
+         [](CommandHandlers& self, std::string_view, std::string_view) { return self.handle_continue_with_exception_handled(); }},
+        {CommandRoute::ContinueNotHandled, Arity::NoParams,
+         [](CommandHandlers& self, std::string_view, std::string_view) { return self.handle_continue_with_exception_not_handled(); }},
+        {CommandRoute::ListBreakpoints, Arity::NoParams,
+         [](CommandHandlers& self, std::string_view, std::string_view) { return self.handle_list_breakpoints(); }},
+        {CommandRoute::LoadUserSymbols, Arity::NoParams,
+         [](CommandHandlers& self, std::string_view, std::string_view) { return self.handle_load_user_symbols(); }},
+        {CommandRoute::LoadAllSymbols, Arity::NoParams,
+         [](CommandHandlers& self, std::string_view, std::string_view) { return self.handle_load_all_symbols(); }},
+        {CommandRoute::GetParentProcess, Arity::NoParams,
+         [](CommandHandlers& self, std::string_view, std::string_view) { return self.handle_get_parent_process(); }},
+        {CommandRoute::SetBreakpoint, Arity::Params,
+         [](CommandHandlers& self, std::string_view params, std::string_view) {
+             // WinDbg reads bare numbers as hex; anything else is a symbol or expression
+             auto address = parse_number(params.starts_with("0x") || params.starts_with("0X")
+                                         ? std::string(params) : "0x" + std::string(params));
+             return address ? self.handle_set_breakpoint(static_cast<uintptr_t>(*address))
+                            : self.handle_set_symbol_breakpoint(params);
+         }},
+        {CommandRoute::ClearBreakpoint, Arity::Params,
+         [](CommandHandlers& self, std::string_view params, std::string_view) {
+             // Lists and wildcards ("bc 1-3", "bc *") go to the debugger
+             auto id = parse_number(params);
+             return id && *id <= UINT32_MAX ? self.handle_clear_breakpoint(static_cast<uint32_t>(*id)) : std::string();
+         }},
+        {CommandRoute::DisableBreakpoint, Arity::Params,
+         [](CommandHandlers& self, std::string_view params, std::string_view) {
+             auto id = parse_number(params);
+             return id && *id <= UINT32_MAX ? self.handle_disable_breakpoint(static_cast<uint32_t>(*id)) : std::string();
+         }},
+        {CommandRoute::EnableBreakpoint, Arity::Params,
+         [](CommandHandlers& self, std::string_view params, std::string_view) {
+             auto id = parse_number(params);
+             return id && *id <= UINT32_MAX ? self.handle_enable_breakpoint(static_cast<uint32_t>(*id)) : std::string();
+         }},
+        {CommandRoute::AttachProcess, Arity::Params,
+         [](CommandHandlers& self, std::string_view params, std::string_view) {
+             // .attach takes the process ID in hex
+             auto pid = parse_number(params.starts_with("0x") || params.starts_with("0X")
+                                     ? std::string(params) : "0x" + std::string(params));
+             return pid && *pid <= UINT32_MAX ? self.handle_attach_process(static_cast<uint32_t>(*pid)) : std::string();
+         }},
+        {CommandRoute::DetachProcess, Arity::NoParams,
+         [](CommandHandlers& self, std::string_view, std::string_view) { return self.handle_detach_process(); }},
+        {CommandRoute::CreateProcess, Arity::Params,
+         [](CommandHandlers& self, std::string_view params, std::string_view) { return self.handle_create_process(params); }},
+        {CommandRoute::RestartProcess, Arity::NoParams,
+         [](CommandHandlers& self, std::string_view, std::string_view) { return self.handle_restart_process(); }},
+        {CommandRoute::TerminateProcess, Arity::NoParams,
+         [](CommandHandlers& self, std::string_view, std::string_view) { return self.handle_terminate_process(); }},
+        {CommandRoute::LoadDump, Arity::Params,
+         [](CommandHandlers& self, std::string_view params, std::string_view) { return self.handle_load_dump(params); }},
+        {CommandRoute::AnalyzeCrash, Arity::Any,
+         [](CommandHandlers& self, std::string_view, std::string_view) { return self.handle_analyze_crash(); }},
+        {CommandRoute::DisplayMemory, Arity::Params,
+         [](CommandHandlers& self, std::string_view, std::string_view command) { return self.try_parse_memory_command(command); }},
+    };
+    static_assert(std::size(targets) == static_cast<size_t>(CommandRoute::Count),
+                  "Every CommandRoute needs a handler");
+    static_assert([] {
+        for (size_t i = 0; i < std::size(targets); ++i) {
+            if (static_cast<size_t>(targets[i].route) != i) {
+                return false;
+            }
         }
+        return true;
+    }(), "Route handlers must be listed in CommandRoute order");
+    
+    size_t index = static_cast<size_t>(route);
+    if (index >= std::size(targets)) {
+        return "";
     }
     
-    // Return empty to indicate no specific handler found
-    return "";
+    const RouteTarget& target = targets[index];
+    if ((target.arity == Arity::NoParams && !params.empty()) ||
+        (target.arity == Arity::Params && params.empty())) {
+        return "";
+    }
+    return target.handler(*this, params, original_command);
 }
 
 /**
  * @brief Attempts to parse and handle memory display commands.
  * 
  * This method parses memory display commands like "db 0x12345678 L0x100"
- * and routes them to appropriate memory handling methods.
+ * and routes them to appropriate memory handling methods. Only plain
+ * addresses and element counts are handled here; anything else (symbols,
+ * registers, expressions) is left to the debugger.
  * 
  * @param[in] command The memory command to parse
  * 
@@ -1112,49 +2200,47 @@ std::string CommandHandlers::try_route_to_specific_handler(
  */
 std::string CommandHandlers::try_parse_memory_command(_In_ std::string_view command) {
     // Parse commands like "db 0x12345678 L0x100" or "dd 0x12345678"
-    std::string cmd_str = std::string(command);
-    std::transform(cmd_str.begin(), cmd_str.end(), cmd_str.begin(), 
-                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
-    
-    // Extract address and size
-    std::regex memory_regex(R"((db|dd|dw|dq)\s+(0x[0-9a-fA-F]+)(?:\s+L(0x[0-9a-fA-F]+))?)");
-    std::smatch match;
-    
-        if (std::regex_search(cmd_str, match, memory_regex)) {
-            try {
-                uintptr_t address = std::stoull(match[2].str(), nullptr, 16);
-                size_t size = 0x100; // Default size
-                
-                if (match[3].matched) {
-                    size = std::stoull(match[3].str(), nullptr, 16);
-                }
-                
-                std::string cmd_type = match[1].str();
-                if (cmd_type == "db") {
-                    return handle_read_memory(address, size);
-                } else if (cmd_type == "dd") {
-                    return handle_display_memory(address, size);
-                } else if (cmd_type == "dw") {
-                    return handle_display_memory(address, size * 2);
-                } else if (cmd_type == "dq") {
-                    return handle_display_memory(address, size * 8);
-                }
-            } catch (const std::invalid_argument& e) {
-                LOG_WARNING("CommandHandlers", "Invalid memory address/size format: " + std::string(command) + " - " + e.what());
-                return "Error: Invalid memory address/size format in command '" + std::string(command) + "'";
-            } catch (const std::out_of_range& e) {
-                LOG_WARNING("CommandHandlers", "Memory address/size out of range: " + std::string(command) + " - " + e.what());
-                return "Error: Memory address/size in command '" + std::string(command) + "' is out of range";
-            } catch (const std::exception& e) {
-                LOG_WARNING("CommandHandlers", "Exception parsing memory command: " + std::string(command) + " - " + e.what());
-                return "Error: Failed to parse memory command '" + std::string(command) + "'";
-            } catch (...) {
-                LOG_WARNING("CommandHandlers", "Unknown exception parsing memory command: " + std::string(command));
-                return "Error: Unknown error parsing memory command '" + std::string(command) + "'";
-            }
+    std::string cmd_str = CommandUtils::to_lower(CommandUtils::trim(command));
+    std::istringstream tokens(cmd_str);
+    std::string cmd_type, address_token, length_token, extra;
+    tokens >> cmd_type >> address_token >> length_token >> extra;
+    
+    size_t element_size = 0;
+    if (cmd_type == "db") element_size = 1;
+    else if (cmd_type == "dw") element_size = 2;
+    else if (cmd_type == "dd") element_size = 4;
+    else if (cmd_type == "dq") element_size = 8;
+    
+    if (element_size == 0 || !address_token.starts_with("0x") || !extra.empty()) {
+        return "";
+    }
+    
+    auto address = parse_number(address_token);
+    if (!address) {
+        return "";
+    }
+    
+    // Without a length WinDbg shows 0x80 bytes
+    uint64_t count = 0x80 / element_size;
+    if (!length_token.empty()) {
+        if (length_token[0] != 'l') {
+            return "";
+        }
+        // L counts elements; WinDbg reads the count as hex even without a prefix
+        std::string count_token = length_token.substr(1);
+        auto parsed = parse_number(count_token.starts_with("0x") ? count_token : "0x" + count_token);
+        if (!parsed || *parsed == 0) {
+            return "";
         }
+        count = *parsed;
+    }
+    
+    if (count > Constants::MAX_MEMORY_READ_SIZE / element_size) {
+        LOG_WARNING("CommandHandlers", "Memory display too large, passing through: " + std::string(command));
+        return "";
+    }
     
-    return "";
+    return handle_display_memory(static_cast<uintptr_t>(*address), static_cast<size_t>(count * element_size), element_size);
 }
 
 /**
@@ -1202,23 +2288,27 @@ std::string CommandHandlers::format_session_status() {
     
     std::string status;
     status += "VibeDbg Status:\n";
-    status += "  Connected: " + std::string(session_state.is_connected ? "Yes" : "No") + "\n";
-    status += "  Target Running: " + std::string(session_state.is_target_running ? "Yes" : "No") + "\n";
+    status += "  Connected: " + std::string(session_state->is_connected ? "Yes" : "No") + "\n";
+    status += "  Target Running: " + std::string(session_state->is_target_running ? "Yes" : "No") + "\n";
     
-        if (session_state.current_process) {
+        if (session_state->current_process) {
         std::ostringstream oss;
-        oss << "  Current Process: " << session_state.current_process->process_name 
-            << " (PID: " << session_state.current_process->process_id << ")\n";
+        oss << "  Current Process: " << session_state->current_process->process_name 
+            << " (PID: " << session_state->current_process->process_id << ")\n";
         status += oss.str();
     }
     
-    if (session_state.current_thread) {
+    if (session_state->current_thread) {
         std::ostringstream oss;
-        oss << "  Current Thread: " << session_state.current_thread->state 
-            << " (TID: " << session_state.current_thread->thread_id << ")\n";
+        oss << "  Current Thread: " << session_state->current_thread->state 
+            << " (TID: " << session_state->current_thread->thread_id << ")\n";
         status += oss.str();
     }
     
+    if (session_state->current_process) {
+        status += "  Threads: " + std::to_string(session_state->thread_count) + "\n";
+        status += "  Modules: " + std::to_string(session_state->module_count) + "\n";
+    }
     
     return status;
 }
@@ -1240,28 +2330,90 @@ std::string CommandHandlers::format_session_json() {
     auto session_state = session_manager_->get_state();
     
     nlohmann::json session_json;
-    session_json["connected"] = session_state.is_connected;
-    session_json["target_running"] = session_state.is_target_running;
+    session_json["connected"] = session_state->is_connected;
+    session_json["target_running"] = session_state->is_target_running;
+    session_json["thread_count"] = session_state->thread_count;
+    session_json["module_count"] = session_state->module_count;
+    session_json["generation"] = session_state->generation;
     session_json["session_start"] = std::chrono::duration_cast<std::chrono::seconds>(
-        session_state.session_start.time_since_epoch()).count();
+        session_state->session_start.time_since_epoch()).count();
     
-    if (session_state.current_process) {
+    if (session_state->current_process) {
         session_json["current_process"] = {
-            {"process_id", session_state.current_process->process_id},
-            {"process_name", session_state.current_process->process_name},
-            {"image_path", session_state.current_process->image_path},
-            {"is_attached", session_state.current_process->is_attached}
+            {"process_id", session_state->current_process->process_id},
+            {"process_name", session_state->current_process->process_name},
+            {"image_path", session_state->current_process->image_path},
+            {"is_attached", session_state->current_process->is_attached}
         };
     }
     
-    if (session_state.current_thread) {
+    if (session_state->current_thread) {
         session_json["current_thread"] = {
-            {"thread_id", session_state.current_thread->thread_id},
-            {"process_id", session_state.current_thread->process_id},
-            {"is_current", session_state.current_thread->is_current},
-            {"state", session_state.current_thread->state}
+            {"thread_id", session_state->current_thread->thread_id},
+            {"process_id", session_state->current_thread->process_id},
+            {"is_current", session_state->current_thread->is_current},
+            {"state", session_state->current_thread->state}
         };
     }
     
     return session_json.dump(2);
 }
+
+/**
+ * @brief Formats memory contents in the layout of the db/dw/dd/dq commands.
+ * 
+ * Each line shows 16 bytes; byte displays add an ASCII column. Bytes past
+ * bytes_read were unreadable and are shown as question marks.
+ * 
+ * @param[in] address Address of the first byte
+ * @param[in] data Memory contents
+ * @param[in] bytes_read Number of valid bytes at the start of data
+ * @param[in] element_size Size of each displayed value in bytes
+ * 
+ * @return Formatted memory display
+ */
+std::string CommandHandlers::format_memory_display(
+    _In_ uintptr_t address,
+    _In_ std::span<const uint8_t> data,
+    _In_ size_t bytes_read,
+    _In_ size_t element_size) {
+    constexpr size_t bytes_per_line = 16;
+    
+    std::string result;
+    result.reserve((data.size() / bytes_per_line + 1) * 80);
+    
+    for (size_t line = 0; line < data.size(); line += bytes_per_line) {
+        size_t line_size = (std::min)(bytes_per_line, data.size() - line);
+        result += format_address(address + line);
+        result += "  ";
+        
+        for (size_t i = 0; i < line_size; i += element_size) {
+            if (i > 0) {
+                result += (element_size == 1 && i == 8) ? '-' : ' ';
+            }
+            if (line + i + element_size > bytes_read) {
+                result.append(element_size * 2, '?');
+                continue;
+            }
+            
+            // Values are shown little-endian, as the target stores them
+            uint64_t value = 0;
+            for (size_t b = element_size; b-- > 0;) {
+                value = (value << 8) | data[line + i + b];
+            }
+            result += std::format("{:0{}x}", value, element_size * 2);
+        }
+        
+        if (element_size == 1) {
+            result.append((bytes_per_line - line_size) * 3 + 2, ' ');
+            for (size_t i = 0; i < line_size; ++i) {
+                uint8_t byte = data[line + i];
+                bool readable = line + i < bytes_read;
+                result += readable && byte >= 0x20 && byte < 0x7f ? static_cast<char>(byte) : (readable ? '.' : '?');
+            }
+        }
+        result += "\n";
+    }
+    
+    return result;
+}
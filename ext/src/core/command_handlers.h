@@ -3,13 +3,18 @@
 #include "../pch.h"
 #include "../../inc/session_manager.h"
 #include "../../inc/command_executor.h"
+#include "../../inc/command_table.h"
 
 namespace vibedbg::core {
 
+class SymbolLoader;
+struct SymbolLoadOptions;
+
 class CommandHandlers {
 public:
     explicit CommandHandlers(std::shared_ptr<SessionManager> session_manager,
-                           std::shared_ptr<CommandExecutor> command_executor);
+                           std::shared_ptr<CommandExecutor> command_executor,
+                           std::shared_ptr<SymbolLoader> symbol_loader = nullptr);
     
     // Basic command handlers
     std::string handle_version();
@@ -30,7 +35,7 @@ public:
     
     // Memory operations
     std::string handle_read_memory(uintptr_t address, size_t size);
-    std::string handle_display_memory(uintptr_t address, size_t size);
+    std::string handle_display_memory(uintptr_t address, size_t size, size_t element_size = 4);
     
     // Module operations
     std::string handle_list_modules();
@@ -87,6 +92,39 @@ public:
     // Memory Analysis
     std::string handle_search_memory(uintptr_t start_address, uintptr_t end_address, std::string_view pattern);
     std::string handle_show_memory_region(uintptr_t address);
+    
+    // Structured memory requests (read_memory, search_memory) returning raw bytes
+    bool handle_memory_request(std::string_view operation, const nlohmann::json& parameters, bool binary_output,
+                               std::string* output, nlohmann::json* data, std::string* error_message);
+    
+    // Batch requests (execute_batch) running several commands in one round-trip
+    bool handle_batch_request(std::string_view operation, const nlohmann::json& parameters,
+                              std::chrono::milliseconds default_timeout,
+                              nlohmann::json* data, std::string* error_message);
+    
+    // Dump analysis requests (analyze_dumps) running a script over several
+    // dumps in parallel worker debuggers
+    bool handle_dump_request(std::string_view operation, const nlohmann::json& parameters,
+                             nlohmann::json* data, std::string* error_message);
+    
+    // Heap scans (scan_heap) counting objects by vtable across committed memory
+    bool handle_heap_request(std::string_view operation, const nlohmann::json& parameters,
+                             nlohmann::json* data, std::string* error_message);
+    
+    // Batched disassembly (disassemble) of address ranges and stack frames,
+    // decoded through the per-module disassembly cache
+    bool handle_disassembly_request(std::string_view operation, const nlohmann::json& parameters,
+                                    nlohmann::json* data, std::string* error_message);
+    
+    // Background symbol loads (load_symbols, get_symbol_load_status,
+    // cancel_symbol_load); answered without waiting for the load
+    bool handle_symbol_request(std::string_view operation, const nlohmann::json& parameters,
+                               nlohmann::json* data, std::string* error_message);
+    
+    // Structured state requests (get_modules, get_threads, get_stack_trace,
+    // get_registers) read straight from DbgEng into session_data
+    bool handle_state_request(std::string_view operation, const nlohmann::json& parameters,
+                              nlohmann::json* session_data, std::string* error_message);
 
     // Generic command execution system for LLM-driven debugging
     std::string handle_generic_command(std::string_view command);
@@ -95,11 +133,19 @@ public:
 private:
     std::shared_ptr<SessionManager> session_manager_;
     std::shared_ptr<CommandExecutor> command_executor_;
+    std::shared_ptr<SymbolLoader> symbol_loader_;
+    
+    // Starts a background symbol load and describes it for the console
+    std::string start_symbol_load(const SymbolLoadOptions& options);
     
     // Helper methods for generic command routing
-    std::string try_route_to_specific_handler(std::string_view normalized_command, std::string_view original_command);
+    std::string try_route_to_specific_handler(CommandRoute route, std::string_view params, std::string_view original_command);
     std::string try_parse_memory_command(std::string_view command);
     
+    // Native all-thread stack sweep with identical stacks folded
+    std::string format_stack_buckets();
+    static constexpr size_t MAX_BUCKET_THREADS_SHOWN = 16;
+    
     // Utility functions for better code organization
     std::string format_session_status();
     std::string format_session_json();
@@ -107,7 +153,8 @@ private:
     // Helper methods
     std::string format_process_list(const std::vector<ProcessInfo>& processes);
     std::string format_thread_list(const std::vector<ThreadInfo>& threads);
-    std::string format_memory_display(uintptr_t address, const std::vector<uint8_t>& data);
+    std::string format_memory_display(uintptr_t address, std::span<const uint8_t> data,
+                                      size_t bytes_read, size_t element_size = 1);
     std::string format_module_list(const std::vector<std::string>& modules);
 };
 
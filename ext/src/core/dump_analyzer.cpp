@@ -0,0 +1,311 @@
+#include "pch.h"
+#include "dump_analyzer.h"
+#include "../../inc/handle_wrapper.h"
+#include <fstream>
+
+using namespace vibedbg::core;
+using namespace vibedbg::utils;
+
+namespace {
+    // Quotes an argument DumpAnalyzer::is_safe_argument accepted.
+    // Backslashes before the closing quote are doubled, or the last one
+    // would escape it and join the next argument to this one.
+    std::string quote_argument(const std::string& argument) {
+        size_t trailing = 0;
+        while (trailing < argument.size() && argument[argument.size() - 1 - trailing] == '\\') {
+            ++trailing;
+        }
+        return "\"" + argument + std::string(trailing, '\\') + "\"";
+    }
+
+    std::string last_error_message(std::string_view operation) {
+        return std::string(operation) + " failed (error " + std::to_string(GetLastError()) + ")";
+    }
+
+    // Removes the script file once every worker has exited
+    struct ScriptFile {
+        std::string path;
+        ~ScriptFile() {
+            if (!path.empty()) {
+                DeleteFileA(path.c_str());
+            }
+        }
+    };
+}
+
+/**
+ * @brief Analyzes every dump and returns one result per dump, in request order.
+ *
+ * At most max_parallel workers run at once; each pool thread takes the next
+ * dump until none are left.
+ *
+ * @param[in] dump_paths Dump files to open
+ * @param[in] options Commands, worker debugger and limits
+ * @param[out] error_message Set if the analysis could not start at all
+ *
+ * @return Per-dump results; empty when error_message is set
+ */
+std::vector<DumpAnalysisResult> DumpAnalyzer::analyze(
+    _In_ const std::vector<std::string>& dump_paths,
+    _In_ const DumpAnalysisOptions& options,
+    _Out_ std::string* error_message) {
+
+    error_message->clear();
+    if (dump_paths.empty()) {
+        return {};
+    }
+
+    std::string debugger = find_debugger();
+    if (!is_safe_argument(debugger) || !is_safe_argument(options.symbol_path)) {
+        *error_message = "The debugger or symbol path contains a quote or a control character";
+        return {};
+    }
+
+    // The commands go through a script file, so they need no quoting on the
+    // command line; the final "q" ends the worker once they have run
+    char temp_dir[MAX_PATH];
+    char temp_file[MAX_PATH];
+    if (GetTempPathA(MAX_PATH, temp_dir) == 0 || GetTempFileNameA(temp_dir, "vdb", 0, temp_file) == 0) {
+        *error_message = last_error_message("Creating the analysis script");
+        return {};
+    }
+    ScriptFile script{temp_file};
+    {
+        std::ofstream stream(script.path, std::ios::binary | std::ios::trunc);
+        for (const auto& command : options.commands) {
+            stream << command << "\n";
+        }
+        stream << "q\n";
+        if (!stream) {
+            *error_message = "Failed to write the analysis script";
+            return {};
+        }
+    }
+
+    std::string prefix = quote_argument(debugger) + " -cf " + quote_argument(script.path);
+    if (!options.symbol_path.empty()) {
+        prefix += " -y " + quote_argument(options.symbol_path);
+    }
+
+    // Workers die with the job, so none outlive an extension that unloads
+    // while an analysis is running
+    HandleWrapper job(CreateJobObjectA(nullptr, nullptr));
+    if (!job) {
+        *error_message = last_error_message("CreateJobObject");
+        return {};
+    }
+    JOBOBJECT_EXTENDED_LIMIT_INFORMATION limits{};
+    limits.BasicLimitInformation.LimitFlags = JOB_OBJECT_LIMIT_KILL_ON_JOB_CLOSE;
+    SetInformationJobObject(job.get(), JobObjectExtendedLimitInformation, &limits, sizeof(limits));
+
+    size_t parallel = options.max_parallel;
+    if (parallel == 0) {
+        parallel = (std::max)(std::thread::hardware_concurrency(), 1u);
+    }
+    parallel = (std::min)({parallel, Constants::MAX_PARALLEL_DUMPS, dump_paths.size()});
+
+    LOG_INFO("DumpAnalyzer", "Analyzing " + std::to_string(dump_paths.size()) + " dumps with " +
+                             std::to_string(parallel) + " workers using " + debugger);
+
+    std::vector<DumpAnalysisResult> results(dump_paths.size());
+    std::atomic<size_t> next{0};
+    auto work = [&] {
+        for (size_t i = next.fetch_add(1); i < dump_paths.size(); i = next.fetch_add(1)) {
+            results[i] = analyze_one(dump_paths[i], prefix, options.timeout_per_dump, job.get(), options.cancel_event);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(parallel - 1);
+    for (size_t i = 1; i < parallel; ++i) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    return results;
+}
+
+/**
+ * @brief Locates the console debugger the workers run.
+ *
+ * VIBEDBG_CDB_PATH names it when set. Otherwise, cdb.exe ships next to
+ * dbgeng.dll in the Debugging Tools for Windows, so the engine WinDbg
+ * loaded decides which debugger the workers use.
+ *
+ * @return Full path of cdb.exe, or "cdb.exe" to search the PATH
+ */
+std::string DumpAnalyzer::find_debugger() {
+    char configured[MAX_PATH];
+    DWORD configured_length = GetEnvironmentVariableA("VIBEDBG_CDB_PATH", configured, MAX_PATH);
+    if (configured_length > 0 && configured_length < MAX_PATH) {
+        return std::string(configured, configured_length);
+    }
+
+    HMODULE engine = GetModuleHandleA("dbgeng.dll");
+    char path[MAX_PATH];
+    DWORD length = engine ? GetModuleFileNameA(engine, path, MAX_PATH) : 0;
+    if (length > 0 && length < MAX_PATH) {
+        std::string candidate(path, length);
+        size_t separator = candidate.find_last_of("\\/");
+        if (separator != std::string::npos) {
+            candidate.resize(separator + 1);
+            candidate += "cdb.exe";
+            if (GetFileAttributesA(candidate.c_str()) != INVALID_FILE_ATTRIBUTES) {
+                return candidate;
+            }
+        }
+    }
+    return "cdb.exe";
+}
+
+/**
+ * @brief Checks that an argument cannot break out of its quotes.
+ *
+ * Windows paths never hold a quote or a control character, so refusing
+ * them costs nothing real while keeping the argument a single argument.
+ *
+ * @param[in] argument Path to place on the worker's command line
+ *
+ * @return true if the argument may be quoted onto the command line
+ */
+bool DumpAnalyzer::is_safe_argument(_In_ std::string_view argument) {
+    return std::none_of(argument.begin(), argument.end(), [](char c) {
+        return c == '"' || static_cast<unsigned char>(c) < 0x20 || c == 0x7f;
+    });
+}
+
+/**
+ * @brief Runs the analysis script against one dump in a worker process.
+ *
+ * The worker inherits only its own output pipe, so a worker started in
+ * parallel never holds another worker's pipe open. Output past
+ * MAX_DUMP_OUTPUT_SIZE is read and dropped, so the worker never blocks on
+ * a full pipe.
+ *
+ * @param[in] dump_path Dump file to open
+ * @param[in] command_line_prefix Quoted debugger, script and symbol path arguments
+ * @param[in] timeout Time the worker may run before it is terminated
+ * @param[in] job Job object the worker is placed in
+ * @param[in] cancel_event Terminates the worker when signalled; may be null
+ *
+ * @return Result for the dump
+ */
+DumpAnalysisResult DumpAnalyzer::analyze_one(
+    _In_ const std::string& dump_path,
+    _In_ const std::string& command_line_prefix,
+    _In_ std::chrono::milliseconds timeout,
+    _In_ HANDLE job,
+    _In_opt_ HANDLE cancel_event) {
+
+    DumpAnalysisResult result;
+    result.dump_path = dump_path;
+    auto start_time = std::chrono::steady_clock::now();
+    auto finish = [&result, start_time](std::string error) {
+        result.error_message = std::move(error);
+        result.execution_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start_time);
+        return result;
+    };
+
+    if (!is_safe_argument(dump_path)) {
+        return finish("Dump path contains a quote or a control character");
+    }
+    if (GetFileAttributesA(dump_path.c_str()) == INVALID_FILE_ATTRIBUTES) {
+        return finish("Dump file not found");
+    }
+
+    SECURITY_ATTRIBUTES inheritable{sizeof(SECURITY_ATTRIBUTES), nullptr, TRUE};
+    HandleWrapper read_end;
+    HandleWrapper write_end;
+    if (!CreatePipe(read_end.get_address_of(), write_end.get_address_of(), &inheritable, 0)) {
+        return finish(last_error_message("CreatePipe"));
+    }
+    SetHandleInformation(read_end.get(), HANDLE_FLAG_INHERIT, 0);
+
+    HandleWrapper null_input(CreateFileA("NUL", GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                                         &inheritable, OPEN_EXISTING, 0, nullptr));
+    if (!null_input) {
+        return finish(last_error_message("Opening NUL"));
+    }
+
+    HANDLE inherited[] = {write_end.get(), null_input.get()};
+    SIZE_T attribute_size = 0;
+    InitializeProcThreadAttributeList(nullptr, 1, 0, &attribute_size);
+    std::vector<uint8_t> attribute_storage(attribute_size);
+    auto* attributes = reinterpret_cast<LPPROC_THREAD_ATTRIBUTE_LIST>(attribute_storage.data());
+    if (!InitializeProcThreadAttributeList(attributes, 1, 0, &attribute_size)) {
+        return finish(last_error_message("InitializeProcThreadAttributeList"));
+    }
+    bool attributes_set = UpdateProcThreadAttribute(attributes, 0, PROC_THREAD_ATTRIBUTE_HANDLE_LIST,
+                                                    inherited, sizeof(inherited), nullptr, nullptr);
+
+    STARTUPINFOEXA startup{};
+    startup.StartupInfo.cb = sizeof(startup);
+    startup.StartupInfo.dwFlags = STARTF_USESTDHANDLES;
+    startup.StartupInfo.hStdInput = null_input.get();
+    startup.StartupInfo.hStdOutput = write_end.get();
+    startup.StartupInfo.hStdError = write_end.get();
+    startup.lpAttributeList = attributes;
+
+    // CreateProcess may write to the command line buffer
+    std::string command_line = command_line_prefix + " -z " + quote_argument(dump_path);
+    PROCESS_INFORMATION process{};
+    BOOL created = attributes_set && CreateProcessA(
+        nullptr, command_line.data(), nullptr, nullptr, TRUE,
+        CREATE_NO_WINDOW | CREATE_SUSPENDED | EXTENDED_STARTUPINFO_PRESENT,
+        nullptr, nullptr, &startup.StartupInfo, &process);
+    std::string create_error = created ? std::string() : last_error_message("Starting the worker debugger");
+    DeleteProcThreadAttributeList(attributes);
+    if (!created) {
+        return finish(std::move(create_error));
+    }
+
+    HandleWrapper process_handle(process.hProcess);
+    HandleWrapper thread_handle(process.hThread);
+    AssignProcessToJobObject(job, process_handle.get());
+    ResumeThread(thread_handle.get());
+
+    // Only the worker holds the write end now, so the pipe reports end of
+    // file once the worker exits
+    write_end.close();
+    null_input.close();
+
+    std::thread reader([&result, pipe = read_end.get()] {
+        char buffer[8192];
+        DWORD bytes_read = 0;
+        while (ReadFile(pipe, buffer, sizeof(buffer), &bytes_read, nullptr) && bytes_read > 0) {
+            size_t room = Constants::MAX_DUMP_OUTPUT_SIZE - (std::min)(result.output.size(), Constants::MAX_DUMP_OUTPUT_SIZE);
+            result.output.append(buffer, (std::min<size_t>)(bytes_read, room));
+            if (bytes_read > room) {
+                result.truncated = true;
+            }
+        }
+    });
+
+    HANDLE waits[] = {process_handle.get(), cancel_event};
+    DWORD wait = WaitForMultipleObjects(cancel_event ? 2 : 1, waits, FALSE, static_cast<DWORD>(timeout.count()));
+    if (wait != WAIT_OBJECT_0) {
+        result.cancelled = wait == WAIT_OBJECT_0 + 1;
+        result.timed_out = !result.cancelled;
+        TerminateProcess(process_handle.get(), static_cast<UINT>(result.cancelled ? ERROR_CANCELLED : ERROR_TIMEOUT));
+        WaitForSingleObject(process_handle.get(), INFINITE);
+    }
+    reader.join();
+
+    DWORD exit_code = 0;
+    GetExitCodeProcess(process_handle.get(), &exit_code);
+    result.exit_code = exit_code;
+    result.success = !result.timed_out && !result.cancelled && exit_code == 0;
+    if (result.cancelled) {
+        return finish("Analysis cancelled");
+    }
+    if (result.timed_out) {
+        return finish("Analysis timed out after " + std::to_string(timeout.count()) + " ms");
+    }
+    if (!result.success) {
+        return finish("Worker debugger exited with code " + std::to_string(exit_code));
+    }
+    return finish({});
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "../pch.h"
+#include "../utils/constants.h"
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace vibedbg::core {
+
+struct DumpAnalysisOptions {
+    std::vector<std::string> commands;  // Run in order against every dump
+    std::string symbol_path;            // Empty: the worker's own default (_NT_SYMBOL_PATH)
+    size_t max_parallel{0};             // Zero: one worker per core, at most MAX_PARALLEL_DUMPS
+    std::chrono::milliseconds timeout_per_dump{Constants::DUMP_ANALYSIS_TIMEOUT_MS};
+    HANDLE cancel_event{nullptr};       // Optional; once signalled, running workers are terminated
+};
+
+struct DumpAnalysisResult {
+    std::string dump_path;
+    bool success{false};
+    bool timed_out{false};
+    bool cancelled{false};
+    bool truncated{false};      // Output exceeded MAX_DUMP_OUTPUT_SIZE
+    uint32_t exit_code{0};
+    std::string output;
+    std::string error_message;
+    std::chrono::milliseconds execution_time{0};
+};
+
+/**
+ * @class DumpAnalyzer
+ * @brief Runs the same scripted analysis over several crash dumps in parallel.
+ *
+ * DbgEng supports a single engine per process and the extension's engine is
+ * attached to whatever WinDbg is debugging, so each dump is opened by a
+ * worker debugger process of its own. The workers share one script built
+ * from the commands, end with "q", and are placed in a job object that kills
+ * them if the extension goes away. Their console output is the result.
+ *
+ * The worker debugger is never chosen by a client: it is VIBEDBG_CDB_PATH,
+ * or the cdb.exe next to the engine. Paths reach the worker through its
+ * command line and are refused if they hold a quote or a control character,
+ * so a request cannot add arguments of its own to the worker.
+ *
+ * Nothing here touches the extension's engine, so an analysis does not hold
+ * up the engine thread and runs on the thread that serves the request.
+ */
+class DumpAnalyzer {
+public:
+    /**
+     * @brief Analyzes every dump and returns one result per dump, in request order.
+     *
+     * @param[in] dump_paths Dump files to open
+     * @param[in] options Commands, worker debugger and limits
+     * @param[out] error_message Set if the analysis could not start at all
+     * @return Per-dump results; empty when error_message is set
+     */
+    static std::vector<DumpAnalysisResult> analyze(const std::vector<std::string>& dump_paths,
+                                                   const DumpAnalysisOptions& options,
+                                                   std::string* error_message);
+
+private:
+    static std::string find_debugger();
+    static bool is_safe_argument(std::string_view argument);
+    static DumpAnalysisResult analyze_one(const std::string& dump_path, const std::string& command_line_prefix,
+                                          std::chrono::milliseconds timeout, HANDLE job, HANDLE cancel_event);
+};
+
+} // namespace vibedbg::core
@@ -0,0 +1,360 @@
+#include "pch.h"
+#include "engine_scheduler.h"
+#include "../utils/metrics.h"
+
+using namespace vibedbg::core;
+using namespace vibedbg::utils;
+
+/**
+ * @brief Creates the scheduler; the engine thread starts with the first submission.
+ *
+ * @param[in] interrupt Called from the cancelling thread to interrupt the running job
+ * @param[in] clear_interrupt Called on the engine thread to discard an interrupt its job ended before taking
+ */
+EngineScheduler::EngineScheduler(_In_ Work interrupt, _In_ Work clear_interrupt)
+    : interrupt_(std::move(interrupt))
+    , clear_interrupt_(std::move(clear_interrupt)) {
+}
+
+EngineScheduler::~EngineScheduler() {
+    stop();
+}
+
+/**
+ * @brief Queues work for the engine thread.
+ *
+ * @param[in] priority Lane the job is queued in
+ * @param[in] run Work to run on the engine thread
+ * @param[in] on_cancel Called instead of run if the job is cancelled or the scheduler stops
+ * @param[in] tag Optional key cancel_tagged() matches against
+ *
+ * @return Identifier for cancel()
+ *
+ * @note Once stop() was called the engine thread may be gone, so on_cancel
+ *       runs on the calling thread before this returns.
+ */
+EngineScheduler::JobId EngineScheduler::submit(
+    _In_ CommandPriority priority,
+    _In_ Work run,
+    _In_ Work on_cancel,
+    _In_ std::string_view tag) {
+
+    auto* job = new Job();
+    job->id = next_id_.fetch_add(1);
+    job->lane = (std::min)(static_cast<size_t>(priority), LANE_COUNT - 1);
+    job->tag_hash = tag.empty() ? 0 : hash_tag(tag);
+    job->cancel_epoch = cancel_epoch_.load();
+    job->submitted = std::chrono::steady_clock::now();
+    job->run = std::move(run);
+    job->on_cancel = std::move(on_cancel);
+    JobId id = job->id;
+
+    if (stopping_.load()) {
+        cancel_job(job);
+        return id;
+    }
+
+    queued_.fetch_add(1);
+    auto& head = incoming_[job->lane];
+    job->next = head.load(std::memory_order_relaxed);
+    while (!head.compare_exchange_weak(job->next, job, std::memory_order_release, std::memory_order_relaxed)) {
+    }
+
+    signal_.fetch_add(1, std::memory_order_release);
+    signal_.notify_one();
+    if (!started_.load(std::memory_order_acquire)) {
+        start_engine_thread();
+    }
+    return id;
+}
+
+/**
+ * @brief Starts the engine thread unless it is running or has been joined.
+ *
+ * Extension loads that never queue work, as scripted runs over many dumps
+ * often do, never pay for the thread.
+ */
+void EngineScheduler::start_engine_thread() {
+    std::lock_guard<std::mutex> lock(start_mutex_);
+    if (started_.load() || joined_) {
+        return;
+    }
+    engine_thread_ = std::thread(&EngineScheduler::engine_loop, this);
+    started_.store(true, std::memory_order_release);
+}
+
+void EngineScheduler::cancel(_In_ JobId id) {
+    request_cancellation(id, 0);
+}
+
+void EngineScheduler::cancel_tagged(_In_ std::string_view tag) {
+    if (!tag.empty()) {
+        request_cancellation(0, hash_tag(tag));
+    }
+}
+
+/**
+ * @brief Cancels every job submitted so far and interrupts the running one.
+ *
+ * Queued jobs compare their submission epoch against the current one when
+ * the engine reaches them, so this never has to walk the queues.
+ */
+void EngineScheduler::cancel_all() {
+    cancel_epoch_.fetch_add(1);
+    {
+        std::lock_guard<std::mutex> lock(running_mutex_);
+        if (running_id_.load() != 0 && interrupt_) {
+            interrupt_();
+            interrupted_ = true;
+        }
+    }
+    signal_.fetch_add(1, std::memory_order_release);
+    signal_.notify_one();
+}
+
+/**
+ * @brief Stops the engine thread; jobs still queued are cancelled.
+ */
+void EngineScheduler::stop() {
+    if (stopping_.exchange(true)) {
+        return;
+    }
+
+    signal_.fetch_add(1, std::memory_order_release);
+    signal_.notify_one();
+    
+    // Jobs queued while the thread was starting still need their cancel
+    // callbacks, so a thread that was never started is started to drain them
+    if (!started_.load() && queued_.load() > 0) {
+        start_engine_thread();
+    }
+    std::lock_guard<std::mutex> lock(start_mutex_);
+    joined_ = true;
+    if (engine_thread_.joinable()) {
+        engine_thread_.join();
+    }
+}
+
+/**
+ * @brief Queues a cancellation for the engine thread and interrupts a matching running job.
+ *
+ * The request is published before the running job is checked, while the
+ * engine publishes the job it is about to run before looking at requests,
+ * so at least one side sees the other and a job is never missed. The check
+ * and the interrupt hold running_mutex_, so the engine cannot move on to
+ * another job between them.
+ *
+ * @param[in] id Job to cancel, or 0 to match by tag
+ * @param[in] tag_hash Tag to cancel, or 0 to match by id
+ */
+void EngineScheduler::request_cancellation(_In_ JobId id, _In_ uint64_t tag_hash) {
+    auto* request = new CancelRequest{id, tag_hash, cancel_requests_.load(std::memory_order_relaxed)};
+    while (!cancel_requests_.compare_exchange_weak(request->next, request)) {
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(running_mutex_);
+        bool running = (id != 0 && running_id_.load() == id) ||
+                       (tag_hash != 0 && running_tag_.load() == tag_hash);
+        if (running && interrupt_) {
+            interrupt_();
+            interrupted_ = true;
+        }
+    }
+
+    signal_.fetch_add(1, std::memory_order_release);
+    signal_.notify_one();
+}
+
+/**
+ * @brief Engine thread body: takes submissions and runs them by priority.
+ */
+void EngineScheduler::engine_loop() {
+    engine_thread_id_.store(std::this_thread::get_id());
+    while (true) {
+        uint32_t signal = signal_.load(std::memory_order_acquire);
+        apply_cancellations(nullptr);
+
+        Job* job = next_job();
+        if (!job) {
+            if (stopping_.load()) {
+                break;
+            }
+            signal_.wait(signal, std::memory_order_acquire);
+            continue;
+        }
+
+        set_running(job);
+
+        bool cancelled = apply_cancellations(job) || job->cancel_epoch < cancel_epoch_.load();
+        if (cancelled || stopping_.load()) {
+            cancel_job(job);
+        } else {
+            MetricsRegistry::instance().record(MetricsRegistry::Stage::QueueWait,
+                                               std::chrono::steady_clock::now() - job->submitted);
+            try {
+                job->run();
+            } catch (...) {
+                LOG_ERROR("EngineScheduler", "Unhandled exception in engine job " + std::to_string(job->id));
+            }
+            delete job;
+        }
+
+        set_running(nullptr);
+    }
+
+    // Anything submitted while stopping is cancelled, never run
+    apply_cancellations(nullptr);
+    for (auto& lane : lanes_) {
+        for (Job* job : lane) {
+            queued_.fetch_sub(1);
+            cancel_job(job);
+        }
+        lane.clear();
+    }
+}
+
+/**
+ * @brief Publishes the job the engine thread runs, or that it runs none.
+ *
+ * An interrupt meant for the job that ended may not have been taken by any
+ * of its commands; it is cleared before the next job is published, while no
+ * job can be interrupted.
+ *
+ * @param[in] job Job about to run, or nullptr once it ended
+ */
+void EngineScheduler::set_running(_In_opt_ const Job* job) {
+    bool interrupted = false;
+    {
+        std::lock_guard<std::mutex> lock(running_mutex_);
+        running_tag_.store(job ? job->tag_hash : 0);
+        running_id_.store(job ? job->id : 0);
+        interrupted = std::exchange(interrupted_, false);
+    }
+    if (!job && interrupted && clear_interrupt_) {
+        clear_interrupt_();
+    }
+}
+
+/**
+ * @brief Moves every pushed job into the engine's FIFO lanes.
+ */
+void EngineScheduler::collect_submissions() {
+    for (size_t lane = 0; lane < LANE_COUNT; ++lane) {
+        Job* stack = incoming_[lane].exchange(nullptr, std::memory_order_acquire);
+
+        // The stack is newest first; reverse it to keep submission order
+        Job* ordered = nullptr;
+        while (stack) {
+            Job* next = stack->next;
+            stack->next = ordered;
+            ordered = stack;
+            stack = next;
+        }
+        for (; ordered; ordered = ordered->next) {
+            lanes_[lane].push_back(ordered);
+        }
+    }
+}
+
+/**
+ * @brief Collects new submissions and applies queued cancellation requests to them.
+ *
+ * Requests are taken before submissions are collected: a request was
+ * issued after its job was pushed, so every job a taken request refers to
+ * is in a lane by the time the requests are applied.
+ *
+ * @param[in] current Job about to run, which is no longer in a lane
+ *
+ * @return true if a request matched current
+ */
+bool EngineScheduler::apply_cancellations(_In_opt_ const Job* current) {
+    CancelRequest* request = cancel_requests_.exchange(nullptr);
+    collect_submissions();
+    bool current_cancelled = false;
+
+    while (request) {
+        auto matches = [request](const Job* job) {
+            return (request->id != 0 && job->id == request->id) ||
+                   (request->tag_hash != 0 && job->tag_hash == request->tag_hash);
+        };
+
+        if (current && matches(current)) {
+            current_cancelled = true;
+        }
+        for (auto& lane : lanes_) {
+            std::erase_if(lane, [this, &matches](Job* job) {
+                if (!matches(job)) {
+                    return false;
+                }
+                queued_.fetch_sub(1);
+                cancel_job(job);
+                return true;
+            });
+        }
+
+        CancelRequest* next = request->next;
+        delete request;
+        request = next;
+    }
+    return current_cancelled;
+}
+
+/**
+ * @brief Takes the next job to run, highest priority lane first.
+ *
+ * A lower lane that has been passed over LANE_BYPASS_LIMIT times goes
+ * next, so a steady stream of interactive commands cannot starve it.
+ *
+ * @return Job to run, or nullptr if every lane is empty
+ */
+EngineScheduler::Job* EngineScheduler::next_job() {
+    size_t chosen = LANE_COUNT;
+    for (size_t lane = 0; lane < LANE_COUNT; ++lane) {
+        if (lanes_[lane].empty()) {
+            continue;
+        }
+        if (chosen == LANE_COUNT) {
+            chosen = lane;
+        } else if (bypassed_[lane] >= LANE_BYPASS_LIMIT) {
+            chosen = lane;
+            break;
+        }
+    }
+    if (chosen == LANE_COUNT) {
+        return nullptr;
+    }
+
+    for (size_t lane = chosen + 1; lane < LANE_COUNT; ++lane) {
+        if (!lanes_[lane].empty()) {
+            bypassed_[lane]++;
+        }
+    }
+    bypassed_[chosen] = 0;
+
+    Job* job = lanes_[chosen].front();
+    lanes_[chosen].pop_front();
+    queued_.fetch_sub(1);
+    return job;
+}
+
+/**
+ * @brief Runs a job's cancel callback and frees it.
+ *
+ * @param[in] job Job that will not run, already removed from the lanes
+ */
+void EngineScheduler::cancel_job(_In_ Job* job) {
+    if (job->on_cancel) {
+        try {
+            job->on_cancel();
+        } catch (...) {
+            LOG_ERROR("EngineScheduler", "Unhandled exception cancelling engine job " + std::to_string(job->id));
+        }
+    }
+    delete job;
+}
+
+uint64_t EngineScheduler::hash_tag(_In_ std::string_view tag) noexcept {
+    uint64_t hash = std::hash<std::string_view>{}(tag);
+    return hash != 0 ? hash : 1;
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include "../pch.h"
+#include "../../inc/command_executor.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string_view>
+#include <thread>
+
+namespace vibedbg::core {
+
+/**
+ * @class EngineScheduler
+ * @brief Runs debugger work on a single engine thread, highest priority first.
+ *
+ * DbgEng is not reentrant, so concurrent callers would serialize on the
+ * engine anyway; funnelling every command through one thread makes the
+ * order explicit and lets interactive commands overtake queued long jobs.
+ * Producers push onto one lock-free stack per priority lane; the engine
+ * thread takes whole stacks at once and keeps the jobs in private FIFO
+ * lanes, so submitting never blocks on the engine.
+ *
+ * Jobs are not preempted. Cancelling a queued job drops it and runs its
+ * cancel callback on the engine thread; cancelling the running job asks the
+ * debugger to interrupt the command through the interrupt callback. The
+ * interrupt is delivered only while that job is running, and one that lands
+ * as the job ends is cleared before the next job starts. Work submitted once
+ * the scheduler is stopping is cancelled at once, on the submitting thread.
+ */
+class EngineScheduler {
+public:
+    using JobId = uint64_t;
+    using Work = std::function<void()>;
+
+    /**
+     * @brief Creates the scheduler; the engine thread starts with the first submission.
+     *
+     * @param[in] interrupt Called from the cancelling thread to interrupt the running job
+     * @param[in] clear_interrupt Called on the engine thread to discard an interrupt its job ended before taking
+     */
+    explicit EngineScheduler(Work interrupt, Work clear_interrupt = {});
+    ~EngineScheduler();
+
+    EngineScheduler(const EngineScheduler&) = delete;
+    EngineScheduler& operator=(const EngineScheduler&) = delete;
+
+    /**
+     * @brief Queues work for the engine thread.
+     *
+     * @param[in] priority Lane the job is queued in
+     * @param[in] run Work to run on the engine thread
+     * @param[in] on_cancel Called instead of run if the job is cancelled or the scheduler stops;
+     *                      on the calling thread, before submit returns, once stop() was called
+     * @param[in] tag Optional key (the MCP request id) cancel_tagged() matches against
+     * @return Identifier for cancel()
+     */
+    JobId submit(CommandPriority priority, Work run, Work on_cancel = {}, std::string_view tag = {});
+
+    /**
+     * @brief Cancels one job, interrupting it if it is running.
+     */
+    void cancel(JobId id);
+
+    /**
+     * @brief Cancels every job submitted with the given tag.
+     */
+    void cancel_tagged(std::string_view tag);
+
+    /**
+     * @brief Cancels every job submitted so far and interrupts the running one.
+     */
+    void cancel_all();
+
+    /**
+     * @brief Stops the engine thread; jobs still queued are cancelled.
+     */
+    void stop();
+
+    size_t pending_count() const noexcept { return queued_.load(); }
+    bool is_busy() const noexcept { return queued_.load() > 0 || running_id_.load() != 0; }
+    bool on_engine_thread() const noexcept { return std::this_thread::get_id() == engine_thread_id_.load(); }
+    bool is_started() const noexcept { return started_.load(); }
+
+private:
+    static constexpr size_t LANE_COUNT = static_cast<size_t>(CommandPriority::Count);
+    static constexpr uint32_t LANE_BYPASS_LIMIT = 8; // Higher-lane jobs a waiting lane lets pass before it runs
+
+    struct Job {
+        JobId id{0};
+        size_t lane{0};
+        uint64_t tag_hash{0};     // 0 when untagged
+        uint64_t cancel_epoch{0}; // cancel_all() calls made before submission
+        std::chrono::steady_clock::time_point submitted;
+        Work run;
+        Work on_cancel;
+        Job* next{nullptr};
+    };
+
+    struct CancelRequest {
+        JobId id{0};
+        uint64_t tag_hash{0};
+        CancelRequest* next{nullptr};
+    };
+
+    void start_engine_thread();
+    void engine_loop();
+    void collect_submissions();
+    bool apply_cancellations(const Job* current);
+    Job* next_job();
+    void cancel_job(Job* job);
+    void request_cancellation(JobId id, uint64_t tag_hash);
+    void set_running(const Job* job);
+    static uint64_t hash_tag(std::string_view tag) noexcept;
+
+    Work interrupt_;
+    Work clear_interrupt_;
+
+    // Shared with producers
+    std::array<std::atomic<Job*>, LANE_COUNT> incoming_{};
+    std::atomic<CancelRequest*> cancel_requests_{nullptr};
+    std::atomic<uint32_t> signal_{0};
+    std::atomic<JobId> next_id_{1};
+    std::atomic<uint64_t> cancel_epoch_{0};
+    std::atomic<size_t> queued_{0};
+    std::atomic<JobId> running_id_{0};
+    std::atomic<uint64_t> running_tag_{0};
+    std::mutex running_mutex_;      // Held across running_* changes and interrupts, so only the job checked is interrupted
+    bool interrupted_{false};       // Guarded by running_mutex_; the running job was interrupted
+    std::atomic<bool> stopping_{false};
+
+    // Owned by the engine thread
+    std::array<std::deque<Job*>, LANE_COUNT> lanes_;
+    std::array<uint32_t, LANE_COUNT> bypassed_{};
+
+    std::mutex start_mutex_;
+    std::atomic<bool> started_{false};
+    bool joined_{false};        // Guarded by start_mutex_; no thread starts after stop()
+    std::thread engine_thread_;
+    std::atomic<std::thread::id> engine_thread_id_{};
+};
+
+} // namespace vibedbg::core
@@ -1,9 +1,19 @@
 #include "pch.h"
 #include "extension_impl.h"
+#include "request_context.h"
+#include "../utils/capture_session.h"
+#include "../utils/command_watchdog.h"
+#include "../utils/symbol_cache.h"
+#include "../utils/disassembly_cache.h"
+#include "../utils/metrics.h"
+#include "../utils/output_filter.h"
+#include "../utils/symbol_event_callbacks.h"
+#include "../utils/session_event_callbacks.h"
 #include "../../inc/error_handling.h"
 
 using namespace vibedbg::core;
 using namespace vibedbg::communication;
+using vibedbg::utils::MetricsRegistry;
 
 /**
  * @brief Gets the singleton instance of the extension implementation.
@@ -22,11 +32,16 @@ ExtensionImpl& ExtensionImpl::get_instance() {
 /**
  * @brief Initializes the extension with the provided debug client.
  * 
- * This method performs complete initialization of the extension in a specific
- * order to ensure proper dependency resolution:
+ * This method performs the initialization every command needs, in a
+ * specific order to ensure proper dependency resolution:
  * 1. Debugger interfaces initialization
  * 2. Core components initialization  
- * 3. Communication infrastructure initialization
+ * 
+ * Neither step starts a thread: the engine thread starts with the first
+ * command scheduled on it and the session manager initializes on first
+ * use. The pipe and socket servers start in start_communication(), on
+ * "!vibedbg_connect", so scripted runs that only use "!vibedbg_execute"
+ * never create them. Each phase's duration is kept for get_stats().
  * 
  * If any step fails, the method performs cleanup of already initialized
  * components and returns an appropriate error code.
@@ -45,10 +60,13 @@ ExtensionError ExtensionImpl::initialize(_In_ IDebugClient* debug_client) {
     }
     
     debug_client_ = debug_client;
+    auto since = [](std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    };
     
     // Initialize debugger interfaces
-    LOG_WINDBG("Extension", "Initializing debugger interfaces...");
     LOG_INFO("Extension", "Initializing debugger interfaces");
+    auto phase_start = std::chrono::steady_clock::now();
     ExtensionError result = initialize_debugger_interfaces();
     if (result != ExtensionError::None) {
         LOG_WINDBG("Extension", "Failed to initialize debugger interfaces");
@@ -56,11 +74,11 @@ ExtensionError ExtensionImpl::initialize(_In_ IDebugClient* debug_client) {
         cleanup_interfaces();
         return result;
     }
-    LOG_WINDBG("Extension", "Debugger interfaces initialized");
+    interfaces_init_duration_ = since(phase_start);
     LOG_INFO("Extension", "Debugger interfaces initialized");
     
     // Initialize core components
-    LOG_WINDBG("Extension", "Initializing core components...");
+    phase_start = std::chrono::steady_clock::now();
     result = initialize_core_components();
     if (result != ExtensionError::None) {
         LOG_WINDBG("Extension", "Failed to initialize core components");
@@ -69,25 +87,47 @@ ExtensionError ExtensionImpl::initialize(_In_ IDebugClient* debug_client) {
         cleanup_interfaces();
         return result;
     }
-    LOG_WINDBG("Extension", "Core components initialized");
+    components_init_duration_ = since(phase_start);
+    LOG_INFO("Extension", "Core components initialized");
+    
+    init_time_ = std::chrono::steady_clock::now();
+    initialized_.store(true);
+    
+    LOG_INFO("Extension", "VibeDbg extension initialized successfully");
+    return ExtensionError::None;
+}
+
+/**
+ * @brief Starts the named pipe server, and the TCP/TLS listener when configured.
+ * 
+ * Runs once per initialization; later calls return at once. The servers
+ * are stopped by shutdown().
+ * 
+ * @return ExtensionError::None when the servers are running, appropriate error code on failure
+ */
+ExtensionError ExtensionImpl::start_communication() {
+    if (!initialized_.load()) {
+        return ExtensionError::NotInitialized;
+    }
+    
+    std::lock_guard<std::mutex> lock(communication_mutex_);
+    if (serving_.load()) {
+        return ExtensionError::None;
+    }
     
-    // Initialize communication
     LOG_WINDBG("Extension", "Initializing communication...");
-    result = initialize_communication();
+    auto phase_start = std::chrono::steady_clock::now();
+    ExtensionError result = initialize_communication();
     if (result != ExtensionError::None) {
         LOG_WINDBG("Extension", "Failed to initialize communication");
         LOG_ERROR_DETAIL("Extension", "Failed to initialize communication", "Error code: " + std::to_string(static_cast<int>(result)));
         cleanup_communication();
-        cleanup_components();
-        cleanup_interfaces();
         return result;
     }
+    communication_init_duration_ = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - phase_start);
+    serving_.store(true);
     LOG_WINDBG("Extension", "Communication initialized");
-    
-    stats_.init_time = std::chrono::steady_clock::now();
-    initialized_.store(true);
-    
-    LOG_INFO("Extension", "VibeDbg extension initialized successfully");
     return ExtensionError::None;
 }
 
@@ -96,7 +136,7 @@ ExtensionError ExtensionImpl::initialize(_In_ IDebugClient* debug_client) {
  * 
  * This method performs a complete shutdown of the extension in the reverse
  * order of initialization to ensure proper cleanup:
- * 1. Communication infrastructure cleanup
+ * 1. Communication infrastructure cleanup, if it was started
  * 2. Core components cleanup
  * 3. Debugger interfaces cleanup
  * 
@@ -109,7 +149,12 @@ void ExtensionImpl::shutdown() {
     
     LOG_INFO("Extension", "Shutting down VibeDbg extension");
     
-    cleanup_communication();
+    {
+        std::lock_guard<std::mutex> lock(communication_mutex_);
+        cleanup_communication();
+        serving_.store(false);
+        communication_init_duration_ = std::chrono::microseconds{0};
+    }
     cleanup_components();
     cleanup_interfaces();
     
@@ -145,25 +190,23 @@ std::string ExtensionImpl::execute_extension_command(
         ExecutionError exec_error;
         auto result = command_executor_->execute_command(command, {}, &exec_error);
         
+        auto& metrics = MetricsRegistry::instance();
+        metrics.increment(MetricsRegistry::Counter::ExtensionCommands);
         if (exec_error == ExecutionError::None && result.success) {
-            std::lock_guard<std::mutex> lock(stats_mutex_);
-            stats_.total_commands++;
-            stats_.successful_commands++;
+            metrics.increment(MetricsRegistry::Counter::ExtensionCommandsSucceeded);
             
             if (error) *error = ExtensionError::None;
             return result.output;
         } else {
-            std::lock_guard<std::mutex> lock(stats_mutex_);
-            stats_.total_commands++;
-            stats_.failed_commands++;
+            metrics.increment(MetricsRegistry::Counter::ExtensionCommandsFailed);
             
             if (error) *error = ExtensionError::InternalError;
             return "";
         }
     } catch (...) {
-        std::lock_guard<std::mutex> lock(stats_mutex_);
-        stats_.total_commands++;
-        stats_.failed_commands++;
+        auto& metrics = MetricsRegistry::instance();
+        metrics.increment(MetricsRegistry::Counter::ExtensionCommands);
+        metrics.increment(MetricsRegistry::Counter::ExtensionCommandsFailed);
         
         if (error) *error = ExtensionError::InternalError;
         return "";
@@ -180,8 +223,61 @@ std::string ExtensionImpl::execute_extension_command(
  * @return Copy of the current statistics
  */
 ExtensionImpl::Stats ExtensionImpl::get_stats() const {
-    std::lock_guard<std::mutex> lock(stats_mutex_);
-    return stats_;
+    auto& metrics = MetricsRegistry::instance();
+    Stats stats;
+    stats.init_time = init_time_;
+    stats.total_connections = metrics.value(MetricsRegistry::Counter::McpRequests);
+    stats.total_commands = metrics.value(MetricsRegistry::Counter::ExtensionCommands);
+    stats.successful_commands = metrics.value(MetricsRegistry::Counter::ExtensionCommandsSucceeded);
+    stats.failed_commands = metrics.value(MetricsRegistry::Counter::ExtensionCommandsFailed);
+    
+    auto symbol_stats = vibedbg::utils::SymbolCache::instance().get_stats();
+    stats.symbol_cache_hits = symbol_stats.hits;
+    stats.symbol_cache_misses = symbol_stats.misses;
+    
+    stats.interfaces_init_time = interfaces_init_duration_;
+    stats.components_init_time = components_init_duration_;
+    stats.communication_init_time = communication_init_duration_;
+    stats.communication_started = serving_.load();
+    stats.engine_thread_started = command_executor_ && command_executor_->is_engine_started();
+    return stats;
+}
+
+/**
+ * @brief Collects the metrics registry, the scheduler queue and the symbol
+ *        and disassembly caches into the document the "metrics" request returns.
+ * 
+ * @return JSON object with counters, stage and per-command latencies
+ */
+nlohmann::json ExtensionImpl::build_metrics() const {
+    auto metrics = MetricsRegistry::to_json(MetricsRegistry::instance().snapshot());
+    
+    auto symbol_stats = vibedbg::utils::SymbolCache::instance().get_stats();
+    metrics["symbol_cache"] = {
+        {"hits", symbol_stats.hits},
+        {"misses", symbol_stats.misses},
+        {"entries", symbol_stats.entries},
+        {"invalidations", symbol_stats.invalidations}
+    };
+    auto disassembly_stats = vibedbg::utils::DisassemblyCache::instance().get_stats();
+    metrics["disassembly_cache"] = {
+        {"hits", disassembly_stats.hits},
+        {"misses", disassembly_stats.misses},
+        {"entries", disassembly_stats.entries},
+        {"invalidations", disassembly_stats.invalidations}
+    };
+    if (command_executor_) {
+        metrics["pending_commands"] = command_executor_->get_pending_count();
+    }
+    
+    auto stats = get_stats();
+    metrics["init"] = {
+        {"interfaces_us", stats.interfaces_init_time.count()},
+        {"components_us", stats.components_init_time.count()},
+        {"communication_us", stats.communication_init_time.count()},
+        {"engine_thread_started", stats.engine_thread_started}
+    };
+    return metrics;
 }
 
 // Private implementation methods
@@ -194,6 +290,7 @@ ExtensionImpl::Stats ExtensionImpl::get_stats() const {
  * - IDebugDataSpaces for memory access
  * - IDebugRegisters for register access
  * - IDebugSymbols for symbol resolution
+ * - IDebugSystemObjects for process and thread enumeration
  * 
  * @return ExtensionError::None on success, ExtensionError::DebuggerInterfaceError on failure
  */
@@ -232,6 +329,27 @@ ExtensionError ExtensionImpl::initialize_debugger_interfaces() {
         return ExtensionError::DebuggerInterfaceError;
     }
     
+    // Get IDebugSystemObjects interface
+    hr = debug_client_->QueryInterface(__uuidof(IDebugSystemObjects),
+                                      reinterpret_cast<void**>(&debug_system_objects_));
+    if (FAILED(hr)) {
+        LOG_ERROR("Extension", "Failed to get IDebugSystemObjects interface");
+        return ExtensionError::DebuggerInterfaceError;
+    }
+    
+    // Event callbacks go on a client of our own so WinDbg keeps its own. The
+    // symbol cache works without them, only with fewer hits, so a failure
+    // here is not fatal
+    hr = debug_client_->CreateClient(&event_client_);
+    if (SUCCEEDED(hr)) {
+        symbol_events_ = new SymbolEventCallbacks();
+        hr = event_client_->SetEventCallbacks(symbol_events_);
+    }
+    if (FAILED(hr)) {
+        LOG_WARNING("Extension", "Failed to install symbol event callbacks, symbol cache relies on command tracking");
+        release_event_callbacks();
+    }
+    
     return ExtensionError::None;
 }
 
@@ -241,6 +359,8 @@ ExtensionError ExtensionImpl::initialize_debugger_interfaces() {
  * This method creates and initializes the core components of the extension:
  * - SessionManager for managing debugging sessions
  * - CommandExecutor for executing WinDbg commands
+ * - SymbolLoader for background symbol loads
+ * - SessionEventCallbacks keeping the session state current
  * 
  * @return ExtensionError::None on success, ExtensionError::InitializationFailed on failure
  */
@@ -260,6 +380,26 @@ ExtensionError ExtensionImpl::initialize_core_components() {
         command_executor_ = std::make_shared<CommandExecutor>(session_manager_);
         LOG_INFO("Extension", "Command executor created successfully");
         
+        symbol_loader_ = std::make_shared<SymbolLoader>(command_executor_);
+        
+        // Created before the servers start: their request workers share it
+        // and only ever read the pointer
+        command_handlers_ = std::make_unique<CommandHandlers>(session_manager_, command_executor_, symbol_loader_);
+        
+        // The session state follows the engine's events from here on; without
+        // the callbacks it only records that a debugger is connected
+        HRESULT hr = debug_client_->CreateClient(&session_event_client_);
+        if (SUCCEEDED(hr)) {
+            session_events_ = new SessionEventCallbacks(session_manager_, session_event_client_);
+            session_events_->refresh();
+            hr = session_event_client_->SetEventCallbacks(session_events_);
+        }
+        if (FAILED(hr)) {
+            LOG_WARNING("Extension", "Failed to install session event callbacks, session state will not follow the target");
+            release_session_event_callbacks();
+        }
+        initialize_prefetch();
+        
         return ExtensionError::None;
     } catch (...) {
         LOG_ERROR("Extension", "Exception during core components initialization");
@@ -267,12 +407,69 @@ ExtensionError ExtensionImpl::initialize_core_components() {
     }
 }
 
+/**
+ * @brief Installs the prefetch of the commands VIBEDBG_PREFETCH lists, if any.
+ * 
+ * After a breakpoint or an exception, agents nearly always ask for the
+ * registers, the stack and the threads next. With VIBEDBG_PREFETCH set,
+ * each stop queues those commands in the background lane, so the requests
+ * that follow are answered from the result cache. "1" selects
+ * DEFAULT_PREFETCH_COMMANDS; otherwise the variable lists the commands,
+ * separated by ';', such as "r;k;~;lm". Commands that are not read-only are
+ * ignored. Prefetching is off by default: it keeps the engine busy after
+ * every stop, which scripts that step through a target do not want.
+ */
+void ExtensionImpl::initialize_prefetch() {
+    if (!session_events_) {
+        return;
+    }
+    
+    char value[1024];
+    DWORD length = GetEnvironmentVariableA("VIBEDBG_PREFETCH", value, sizeof(value));
+    if (length == 0 || length >= sizeof(value)) {
+        return;
+    }
+    std::string list(value, length);
+    if (list == "0") {
+        return;
+    }
+    if (list == "1") {
+        list = Constants::DEFAULT_PREFETCH_COMMANDS;
+    }
+    
+    std::vector<std::string> commands;
+    std::istringstream entries(list);
+    std::string entry;
+    while (std::getline(entries, entry, ';') && commands.size() < Constants::MAX_PREFETCH_COMMANDS) {
+        auto first = entry.find_first_not_of(" \t");
+        if (first == std::string::npos) {
+            continue;
+        }
+        entry = entry.substr(first, entry.find_last_not_of(" \t") - first + 1);
+        if (!command_validation::is_read_only_command(entry)) {
+            LOG_WARNING("Extension", "Not prefetching '" + entry + "', it is not a read-only command");
+            continue;
+        }
+        commands.push_back(std::move(entry));
+    }
+    if (commands.empty()) {
+        return;
+    }
+    
+    // The listener is cleared before the executor goes away
+    session_events_->set_stop_listener([executor = command_executor_.get(), commands]() {
+        executor->prefetch(commands);
+    });
+    LOG_INFO("Extension", "Prefetching " + std::to_string(commands.size()) + " commands after each stop");
+}
+
 /**
  * @brief Initializes communication infrastructure.
  * 
  * This method sets up the named pipe server for MCP client communication.
  * It creates the pipe server with appropriate configuration and sets up
- * the message handler for processing incoming commands.
+ * the message handler for processing incoming commands. The TCP/TLS
+ * listener, when configured, serves the same handler.
  * 
  * @return ExtensionError::None on success, ExtensionError::CommunicationSetupFailed on failure
  */
@@ -284,17 +481,31 @@ ExtensionError ExtensionImpl::initialize_communication() {
         config.pipe_name = R"(\\.\pipe\vibedbg_debug)";
         config.max_connections = 10;
         
+        // VIBEDBG_TRACE_FILE records every command for offline replay
+        char trace_path[MAX_PATH];
+        DWORD trace_path_length = GetEnvironmentVariableA("VIBEDBG_TRACE_FILE", trace_path, MAX_PATH);
+        if (trace_path_length > 0 && trace_path_length < MAX_PATH) {
+            config.trace_path.assign(trace_path, trace_path_length);
+        }
+        
         LOG_INFO("Extension", "Creating pipe server instance...");
         pipe_server_ = std::make_unique<NamedPipeServer>(config);
         
         LOG_INFO("Extension", "Setting message handler...");
         // Set message handler
         pipe_server_->set_message_handler(
-            [this](const CommandRequest& request, ErrorCode* error) -> CommandResponse {
-                return handle_mcp_command(request, error);
+            [this](const CommandRequest& request, const TransportServer::ChunkWriter& write_chunk,
+                   ErrorCode* error) -> CommandResponse {
+                return handle_mcp_command(request, write_chunk, error);
             }
         );
         
+        // Requests are refused with a Busy error once the engine has a full
+        // queue, rather than left to wait behind it
+        pipe_server_->set_load_probe([this]() -> size_t {
+            return command_executor_ ? command_executor_->get_pending_count() : 0;
+        });
+        
         LOG_INFO("Extension", "Starting pipe server...");
         // Start the server (async - don't wait for full initialization)
         PipeServerError pipe_error = pipe_server_->start();
@@ -303,8 +514,35 @@ ExtensionError ExtensionImpl::initialize_communication() {
             return ExtensionError::CommunicationSetupFailed;
         }
         
-        // Give the server a moment to initialize but don't wait indefinitely
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        initialize_socket_server();
+        
+        // Debugger events reach the clients subscribed to them from here on;
+        // the data is built once for both transports
+        auto publish = [pipe = pipe_server_.get(), socket = socket_server_.get()](
+                           EventKind kind, const TransportServer::EventBuilder& build_data) {
+            if (!socket) {
+                pipe->publish_event(kind, build_data);
+                return;
+            }
+            std::optional<json> data;
+            TransportServer::EventBuilder build_once = [&data, &build_data]() {
+                if (!data) {
+                    data = build_data ? build_data() : json::object();
+                }
+                return *data;
+            };
+            pipe->publish_event(kind, build_once);
+            socket->publish_event(kind, build_once);
+        };
+        if (session_events_) {
+            session_events_->set_event_publisher(publish);
+        }
+        if (symbol_loader_) {
+            symbol_loader_->set_event_publisher(publish);
+        }
+        
+        // Clients retry their connect until the first pipe instance is
+        // listening, so there is nothing to wait for here
         LOG_INFO("Extension", "Pipe server started successfully");
         return ExtensionError::None;
     } catch (...) {
@@ -313,6 +551,76 @@ ExtensionError ExtensionImpl::initialize_communication() {
     }
 }
 
+/**
+ * @brief Starts the TCP/TLS listener configured by VIBEDBG_LISTEN, if any.
+ * 
+ * VIBEDBG_LISTEN is "host:port", "[address]:port" for IPv6, or a bare port,
+ * which listens on loopback only. VIBEDBG_TLS_CERT names the server
+ * certificate by subject or thumbprint, and VIBEDBG_AUTH_TOKEN the token a
+ * client must present in its first heartbeat. Without them the listener
+ * serves plain, unauthenticated TCP.
+ */
+void ExtensionImpl::initialize_socket_server() {
+    auto read_variable = [](const char* name) {
+        char value[1024];
+        DWORD length = GetEnvironmentVariableA(name, value, sizeof(value));
+        return length > 0 && length < sizeof(value) ? std::string(value, length) : std::string();
+    };
+    
+    std::string listen = read_variable("VIBEDBG_LISTEN");
+    if (listen.empty()) {
+        return;
+    }
+    
+    communication::SocketServerConfig config;
+    std::string host;
+    std::string port_text = listen;
+    if (listen.front() == '[') {
+        size_t close = listen.find("]:");
+        host = close == std::string::npos ? std::string() : listen.substr(1, close - 1);
+        port_text = close == std::string::npos ? std::string() : listen.substr(close + 2);
+    } else if (size_t separator = listen.find(':'); separator != std::string::npos) {
+        host = listen.substr(0, separator);
+        port_text = listen.substr(separator + 1);
+    }
+    if (!host.empty()) {
+        config.bind_address = host;
+    }
+    
+    unsigned long port = 0;
+    try {
+        size_t used = 0;
+        port = std::stoul(port_text, &used);
+        if (used != port_text.size()) {
+            port = 0;
+        }
+    } catch (...) {
+        port = 0;
+    }
+    if (port == 0 || port > 65535) {
+        LOG_ERROR("Extension", "VIBEDBG_LISTEN must be host:port, [address]:port or a port: " + listen);
+        return;
+    }
+    config.port = static_cast<uint16_t>(port);
+    config.tls_certificate = read_variable("VIBEDBG_TLS_CERT");
+    config.auth_token = read_variable("VIBEDBG_AUTH_TOKEN");
+    
+    socket_server_ = std::make_unique<SocketServer>(config);
+    socket_server_->set_message_handler(
+        [this](const CommandRequest& request, const TransportServer::ChunkWriter& write_chunk,
+               ErrorCode* error) -> CommandResponse {
+            return handle_mcp_command(request, write_chunk, error);
+        }
+    );
+    socket_server_->set_load_probe([this]() -> size_t {
+        return command_executor_ ? command_executor_->get_pending_count() : 0;
+    });
+    if (socket_server_->start() != PipeServerError::None) {
+        LOG_ERROR("Extension", "Failed to start the socket server on " + listen);
+        socket_server_.reset();
+    }
+}
+
 /**
  * @brief Handles MCP command requests from the named pipe server.
  * 
@@ -321,21 +629,46 @@ ExtensionError ExtensionImpl::initialize_communication() {
  * and returns structured responses. The method also tracks connection
  * statistics for monitoring purposes.
  * 
+ * When the server supplies a chunk writer, output produced while the
+ * command runs is streamed through it and the returned response only holds
+ * the remaining tail together with the execution time. Output filter
+ * parameters in the request apply to the output of the commands it runs.
+ * 
  * @param[in] request The command request to process
+ * @param[in] write_chunk Writer for streamed output; empty if the client did not ask for streaming
  * @param[out] error Optional pointer to receive error information
  * 
  * @return CommandResponse containing the result of command execution
  */
 CommandResponse ExtensionImpl::handle_mcp_command(
     _In_ const CommandRequest& request, 
+    _In_ const TransportServer::ChunkWriter& write_chunk,
     _Out_opt_ ErrorCode* error) {
     CommandResponse response;
     response.request_id = request.request_id;
     response.timestamp = std::chrono::steady_clock::now();
     
+    size_t streamed_bytes = 0;
+    RequestContext context;
+    context.request_id = request.request_id;
+    context.session_id = request.session_id;
+    context.timeout = request.timeout;
+    if (write_chunk) {
+        context.output_sink = [&write_chunk, &streamed_bytes](std::string_view chunk) {
+            if (!write_chunk(chunk)) {
+                return false;
+            }
+            streamed_bytes += chunk.size();
+            return true;
+        };
+    }
+    RequestScope request_scope(context);
+    
     // Log command reception via OutputDebugString for DebugView
     LOG_INFO("MCP", "Received MCP command: " + request.command);
     
+    MetricsRegistry::instance().increment(MetricsRegistry::Counter::McpRequests);
+    
     try {
         if (!initialized_.load()) {
             response.success = false;
@@ -345,42 +678,150 @@ CommandResponse ExtensionImpl::handle_mcp_command(
             return response;
         }
         
+        // Session ids are kept for as long as the session is among the most
+        // recently used, so they are bounded like any other retained input
+        if (request.session_id.size() > Constants::MAX_SESSION_ID_LENGTH) {
+            response.success = false;
+            response.error_message = "Session id longer than " + std::to_string(Constants::MAX_SESSION_ID_LENGTH) + " characters";
+            if (error) *error = ErrorCode::InvalidParameter;
+            return response;
+        }
+        
+        // grep, head, tail, max_bytes and fields slice the output as the
+        // command writes it, so what is dropped never crosses the pipe
+        std::string filter_error;
+        context.output_filter = vibedbg::utils::OutputFilter::from_parameters(request.parameters, &filter_error);
+        if (!filter_error.empty()) {
+            response.success = false;
+            response.error_message = "Invalid output filter: " + filter_error;
+            if (error) *error = ErrorCode::InvalidParameter;
+            return response;
+        }
+        
+        // Metrics are read without the engine, so they can be watched while
+        // the engine thread is saturated
+        if (request.command == "metrics") {
+            response.data = build_metrics();
+            response.success = true;
+            response.execution_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - response.timestamp);
+            if (error) *error = ErrorCode::None;
+            return response;
+        }
+        
         // Use the new generic command system for LLM-driven debugging
-        if (!command_executor_) {
+        if (!command_executor_ || !command_handlers_) {
             response.success = false;
             response.error_message = "Command executor not available";
             if (error) *error = ErrorCode::InternalError;
             return response;
         }
         
-        // Create command handlers if not already created
-        if (!command_handlers_) {
-            command_handlers_ = std::make_unique<CommandHandlers>(session_manager_, command_executor_);
+        // Structured memory requests return bytes rather than command text;
+        // v2 frames carry them raw, v1 clients get them base64 encoded
+        std::string error_message;
+        bool binary_output = request.protocol_version >= MessageProtocol::PROTOCOL_VERSION_V2;
+        if (command_handlers_->handle_memory_request(request.command, request.parameters, binary_output,
+                                                     &response.output, &response.data, &error_message)) {
+            response.execution_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - response.timestamp);
+            response.success = error_message.empty();
+            response.error_message = std::move(error_message);
+            if (error) *error = response.success ? ErrorCode::None : ErrorCode::MemoryAccessError;
+            return response;
+        }
+        
+        // Batch requests run several commands in one round-trip; the
+        // per-command results travel in data rather than as streamed output
+        if (command_handlers_->handle_batch_request(request.command, request.parameters, request.timeout,
+                                                    &response.data, &error_message)) {
+            response.execution_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - response.timestamp);
+            response.success = error_message.empty();
+            response.error_message = std::move(error_message);
+            if (error) *error = response.success ? ErrorCode::None : ErrorCode::InvalidParameter;
+            return response;
+        }
+        
+        // Dump analyses run in worker debuggers of their own and never reach
+        // the attached engine; results come back tagged by dump
+        if (command_handlers_->handle_dump_request(request.command, request.parameters,
+                                                   &response.data, &error_message)) {
+            response.execution_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - response.timestamp);
+            response.success = error_message.empty();
+            response.error_message = std::move(error_message);
+            if (error) *error = response.success ? ErrorCode::None : ErrorCode::CommandFailed;
+            return response;
+        }
+        
+        // Heap scans read in background-lane jobs, so the engine keeps
+        // serving other requests between batches
+        if (command_handlers_->handle_heap_request(request.command, request.parameters,
+                                                   &response.data, &error_message)) {
+            response.execution_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - response.timestamp);
+            response.success = error_message.empty();
+            response.error_message = std::move(error_message);
+            if (error) *error = response.success ? ErrorCode::None : ErrorCode::CommandFailed;
+            return response;
+        }
+        
+        // Disassembly of many ranges at once, decoded in one engine job and
+        // served from the disassembly cache where it was decoded before
+        if (command_handlers_->handle_disassembly_request(request.command, request.parameters,
+                                                          &response.data, &error_message)) {
+            response.execution_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - response.timestamp);
+            response.success = error_message.empty();
+            response.error_message = std::move(error_message);
+            if (error) *error = response.success ? ErrorCode::None : ErrorCode::CommandFailed;
+            return response;
+        }
+        
+        // Symbol loads run in the background; these requests start, follow
+        // or stop one and never wait for it
+        if (command_handlers_->handle_symbol_request(request.command, request.parameters,
+                                                     &response.data, &error_message)) {
+            response.execution_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - response.timestamp);
+            response.success = error_message.empty();
+            response.error_message = std::move(error_message);
+            if (error) *error = response.success ? ErrorCode::None : ErrorCode::CommandFailed;
+            return response;
         }
         
+        // Module, thread, stack and register state read through the debugger
+        // interfaces; clients get JSON instead of text they would re-parse
+        if (command_handlers_->handle_state_request(request.command, request.parameters,
+                                                    &response.session_data, &error_message)) {
+            response.execution_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - response.timestamp);
+            response.success = error_message.empty();
+            response.error_message = std::move(error_message);
+            if (error) *error = response.success ? ErrorCode::None : ErrorCode::CommandFailed;
+            return response;
+        }
+
         // Execute using the LLM-friendly command system
         LOG_INFO("MCP", "Executing command via LLM handler");
         auto output = command_handlers_->handle_llm_command(request.command, true);
+        response.execution_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - response.timestamp);
         
-        if (!output.empty()) {
+        if (!output.empty() || streamed_bytes > 0) {
             response.success = true;
-            response.output = output;
+            response.output = std::move(output);
             if (error) *error = ErrorCode::None;
             
-            LOG_INFO_DETAIL("MCP", "Command executed successfully", "Output length: " + std::to_string(output.length()));
+            LOG_INFO_DETAIL("MCP", "Command executed successfully", "Output length: " + std::to_string(streamed_bytes + response.output.length()));
         } else {
             response.success = false;
             response.error_message = "Command execution failed or returned no output";
             LOG_ERROR("MCP", "Command execution failed or returned empty result");
             if (error) *error = ErrorCode::CommandFailed;
         }
-        
-        // Update stats
-        {
-            std::lock_guard<std::mutex> lock(stats_mutex_);
-            stats_.total_connections++;
-        }
-        
+
         return response;
     } catch (...) {
         response.success = false;
@@ -398,7 +839,19 @@ CommandResponse ExtensionImpl::handle_mcp_command(
  * reference counting by calling Release() on each interface.
  */
 void ExtensionImpl::cleanup_interfaces() {
+    // Capture clients were created from debug_client_, release them first
+    vibedbg::utils::CommandWatchdog::instance().shutdown();
+    vibedbg::utils::CaptureSession::shutdown_all();
+    release_event_callbacks();
+    vibedbg::utils::SymbolCache::instance().clear();
+    vibedbg::utils::DisassemblyCache::instance().clear();
+    
     // Cleanup in reverse order of initialization to avoid dependency issues
+    if (debug_system_objects_) {
+        debug_system_objects_->Release();
+        debug_system_objects_ = nullptr;
+    }
+    
     if (debug_symbols_) {
         debug_symbols_->Release();
         debug_symbols_ = nullptr;
@@ -423,6 +876,43 @@ void ExtensionImpl::cleanup_interfaces() {
     debug_client_ = nullptr;
 }
 
+/**
+ * @brief Removes the symbol and session event callbacks and releases their clients.
+ *
+ * The callbacks are detached before the client is released so no event
+ * arrives while either is being torn down.
+ */
+void ExtensionImpl::release_event_callbacks() {
+    if (event_client_) {
+        event_client_->SetEventCallbacks(nullptr);
+        event_client_->Release();
+        event_client_ = nullptr;
+    }
+    
+    if (symbol_events_) {
+        symbol_events_->Release();
+        symbol_events_ = nullptr;
+    }
+    
+    release_session_event_callbacks();
+}
+
+/**
+ * @brief Removes the session event callbacks and releases their client.
+ */
+void ExtensionImpl::release_session_event_callbacks() {
+    if (session_event_client_) {
+        session_event_client_->SetEventCallbacks(nullptr);
+        session_event_client_->Release();
+        session_event_client_ = nullptr;
+    }
+    
+    if (session_events_) {
+        session_events_->Release();
+        session_events_ = nullptr;
+    }
+}
+
 /**
  * @brief Cleans up core extension components.
  * 
@@ -431,8 +921,14 @@ void ExtensionImpl::cleanup_interfaces() {
  * and resource deallocation.
  */
 void ExtensionImpl::cleanup_components() {
-    // Cleanup in reverse order of initialization
+    // Cleanup in reverse order of initialization; the symbol loader stops
+    // its load before the executor it runs on goes away, and stops no
+    // longer queue prefetches on it
+    if (session_events_) {
+        session_events_->set_stop_listener(nullptr);
+    }
     command_handlers_.reset();
+    symbol_loader_.reset();
     command_executor_.reset();
     session_manager_.reset();
 }
@@ -445,6 +941,18 @@ void ExtensionImpl::cleanup_components() {
  * and the pipe server is stopped gracefully.
  */
 void ExtensionImpl::cleanup_communication() {
+    // Returns once no event is being published to the server
+    if (session_events_) {
+        session_events_->set_event_publisher(nullptr);
+    }
+    if (symbol_loader_) {
+        symbol_loader_->set_event_publisher(nullptr);
+    }
+    
+    if (socket_server_) {
+        socket_server_->stop();
+        socket_server_.reset();
+    }
     if (pipe_server_) {
         pipe_server_->stop();
         pipe_server_.reset();
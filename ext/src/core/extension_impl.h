@@ -5,9 +5,14 @@
 #include "../../inc/session_manager.h"
 #include "../../inc/command_executor.h"
 #include "../../inc/named_pipe_server.h"
+#include "../../inc/socket_server.h"
 #include "../../inc/error_handling.h"
 #include "constants.h"
 #include "command_handlers.h"
+#include "symbol_loader.h"
+
+class SymbolEventCallbacks;
+class SessionEventCallbacks;
 
 namespace vibedbg::core {
 
@@ -45,10 +50,9 @@ namespace vibedbg::core {
         /**
          * @brief Initializes the extension with the provided debug client.
          * 
-         * This method performs complete initialization of the extension,
-         * including debugger interfaces, core components, and communication
-         * infrastructure. It follows a specific initialization order to
-         * ensure proper dependency resolution.
+         * This method initializes debugger interfaces and core components.
+         * It starts no threads and no servers; those start on first use and
+         * in start_communication().
          * 
          * @param[in] debug_client Pointer to the WinDbg debug client interface
          * 
@@ -59,6 +63,15 @@ namespace vibedbg::core {
          */
         ExtensionError initialize(_In_ IDebugClient* debug_client);
 
+        /**
+         * @brief Starts the named pipe server, and the TCP/TLS listener when configured.
+         * 
+         * @return ExtensionError::None when the servers are running, appropriate error code on failure
+         * 
+         * @note Requires initialize(); calls after the first successful one return at once.
+         */
+        ExtensionError start_communication();
+
         /**
          * @brief Shuts down the extension and cleans up all resources.
          * 
@@ -81,6 +94,13 @@ namespace vibedbg::core {
          */
         bool is_initialized() const noexcept { return initialized_.load(); }
 
+        /**
+         * @brief Checks if the pipe server was started by start_communication().
+         * 
+         * @return true while MCP clients can connect, false otherwise
+         */
+        bool is_serving() const noexcept { return serving_.load(); }
+
         // Debugger interface access
         /**
          * @brief Gets the WinDbg debug client interface.
@@ -117,6 +137,13 @@ namespace vibedbg::core {
          */
         IDebugSymbols* get_debug_symbols() const noexcept { return debug_symbols_; }
 
+        /**
+         * @brief Gets the WinDbg debug system objects interface.
+         * 
+         * @return Pointer to the debug system objects interface, or nullptr if not initialized
+         */
+        IDebugSystemObjects* get_debug_system_objects() const noexcept { return debug_system_objects_; }
+
         // Component access
         /**
          * @brief Gets the session manager component.
@@ -164,10 +191,17 @@ namespace vibedbg::core {
          */
         struct Stats {
             std::chrono::time_point<std::chrono::steady_clock> init_time;  ///< Extension initialization time
-            uint64_t total_connections = 0;      ///< Total number of MCP connections
+            uint64_t total_connections = 0;      ///< Total number of MCP requests received
             uint64_t total_commands = 0;         ///< Total number of commands executed
             uint64_t successful_commands = 0;    ///< Number of successfully executed commands
             uint64_t failed_commands = 0;        ///< Number of failed command executions
+            uint64_t symbol_cache_hits = 0;      ///< Symbol lookups answered from the symbol cache
+            uint64_t symbol_cache_misses = 0;    ///< Symbol lookups that went to DbgEng
+            std::chrono::microseconds interfaces_init_time{0};    ///< Time spent acquiring debugger interfaces
+            std::chrono::microseconds components_init_time{0};    ///< Time spent creating the core components
+            std::chrono::microseconds communication_init_time{0}; ///< Time spent starting the servers; zero until started
+            bool communication_started = false;  ///< Whether start_communication() has run
+            bool engine_thread_started = false;  ///< Whether a command has started the engine thread
         };
 
         /**
@@ -180,6 +214,13 @@ namespace vibedbg::core {
          */
         Stats get_stats() const;
 
+        /**
+         * @brief Builds the document answered to "metrics" requests and shown by !vibedbg_stats.
+         * 
+         * @return Counters, stage latencies and per-command latencies as JSON
+         */
+        nlohmann::json build_metrics() const;
+
     private:
         /**
          * @brief Private constructor for singleton pattern.
@@ -202,6 +243,8 @@ namespace vibedbg::core {
         ExtensionImpl& operator=(const ExtensionImpl&) = delete;
 
         std::atomic<bool> initialized_{ false };  ///< Thread-safe initialization flag
+        std::atomic<bool> serving_{ false };      ///< Set once the pipe server runs
+        std::mutex communication_mutex_;          ///< Serializes starting and stopping the servers
 
         // WinDbg interfaces
         IDebugClient* debug_client_{ nullptr };       ///< WinDbg debug client interface
@@ -209,16 +252,25 @@ namespace vibedbg::core {
         IDebugDataSpaces* debug_data_spaces_{ nullptr }; ///< WinDbg debug data spaces interface
         IDebugRegisters* debug_registers_{ nullptr }; ///< WinDbg debug registers interface
         IDebugSymbols* debug_symbols_{ nullptr };     ///< WinDbg debug symbols interface
+        IDebugSystemObjects* debug_system_objects_{ nullptr }; ///< WinDbg debug system objects interface
+        IDebugClient* event_client_{ nullptr };       ///< Client owning the symbol event callbacks
+        SymbolEventCallbacks* symbol_events_{ nullptr }; ///< Keeps the symbol cache coherent
+        IDebugClient* session_event_client_{ nullptr }; ///< Client owning the session event callbacks
+        SessionEventCallbacks* session_events_{ nullptr }; ///< Keeps the session state current
 
         // Core components
         std::shared_ptr<SessionManager> session_manager_;           ///< Session management component
         std::shared_ptr<CommandExecutor> command_executor_;         ///< Command execution component
+        std::shared_ptr<SymbolLoader> symbol_loader_;               ///< Background symbol loads
         std::unique_ptr<communication::NamedPipeServer> pipe_server_; ///< Named pipe communication server
+        std::unique_ptr<communication::SocketServer> socket_server_; ///< TCP/TLS listener; only when VIBEDBG_LISTEN is set
         std::unique_ptr<CommandHandlers> command_handlers_;         ///< Command routing and handling
 
         // Statistics
-        mutable std::mutex stats_mutex_;  ///< Mutex for protecting statistics access
-        Stats stats_;                     ///< Current extension statistics
+        std::chrono::time_point<std::chrono::steady_clock> init_time_;  ///< Counts live in the metrics registry
+        std::chrono::microseconds interfaces_init_duration_{ 0 };    ///< Measured by initialize()
+        std::chrono::microseconds components_init_duration_{ 0 };    ///< Measured by initialize()
+        std::chrono::microseconds communication_init_duration_{ 0 }; ///< Measured by start_communication()
 
         // Initialization helpers
         /**
@@ -242,17 +294,31 @@ namespace vibedbg::core {
          */
         ExtensionError initialize_communication();
 
+        /**
+         * @brief Starts the TCP/TLS listener configured by VIBEDBG_LISTEN, if any.
+         * 
+         * A listener that fails to start is logged; the named pipe keeps serving.
+         */
+        void initialize_socket_server();
+
+        /**
+         * @brief Installs the prefetch of the commands VIBEDBG_PREFETCH lists, if any.
+         */
+        void initialize_prefetch();
+
         // Message handling
         /**
          * @brief Handles MCP command requests from the named pipe server.
          * 
          * @param[in] request The command request to process
+         * @param[in] write_chunk Writer for streamed output; empty if the client did not ask for streaming
          * @param[out] error Optional pointer to receive error information
          * 
          * @return CommandResponse containing the result of command execution
          */
         communication::CommandResponse handle_mcp_command(
             _In_ const communication::CommandRequest& request, 
+            _In_ const communication::TransportServer::ChunkWriter& write_chunk,
             _Out_opt_ communication::ErrorCode* error = nullptr);
 
         // Cleanup
@@ -261,6 +327,16 @@ namespace vibedbg::core {
          */
         void cleanup_interfaces();
 
+        /**
+         * @brief Removes the symbol and session event callbacks and releases their clients.
+         */
+        void release_event_callbacks();
+
+        /**
+         * @brief Removes the session event callbacks and releases their client.
+         */
+        void release_session_event_callbacks();
+
         /**
          * @brief Cleans up core extension components.
          */
@@ -0,0 +1,483 @@
+#include "pch.h"
+#include "heap_scanner.h"
+#include "../utils/metrics.h"
+#include "../utils/windbg_helpers.h"
+#include <emmintrin.h>
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <deque>
+#include <unordered_map>
+
+using namespace vibedbg::core;
+using namespace vibedbg::utils;
+
+namespace {
+    constexpr uint32_t READABLE_PROTECTION = PAGE_READONLY | PAGE_READWRITE | PAGE_WRITECOPY |
+                                             PAGE_EXECUTE_READ | PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY;
+    constexpr size_t MAX_HIGH_DWORDS = 8;       // Upper halves compared per vector before falling back to scalar
+    constexpr size_t BATCHES_IN_FLIGHT = 2;     // The batch being matched and the one the engine reads
+    constexpr size_t RESOLVE_CHUNK = 256;       // Pointers resolved per engine job
+
+    struct ImageRange {
+        uint64_t base{0};
+        uint64_t end{0};
+    };
+
+    // Decides whether a value points into a loaded image
+    class ImageMap {
+    public:
+        explicit ImageMap(std::vector<ImageRange> ranges) : ranges_(std::move(ranges)) {
+            std::sort(ranges_.begin(), ranges_.end(),
+                      [](const ImageRange& a, const ImageRange& b) { return a.base < b.base; });
+            for (const auto& range : ranges_) {
+                for (uint64_t high = range.base >> 32; high <= (range.end - 1) >> 32; ++high) {
+                    if (std::find(high_dwords_.begin(), high_dwords_.end(), static_cast<uint32_t>(high)) ==
+                        high_dwords_.end()) {
+                        high_dwords_.push_back(static_cast<uint32_t>(high));
+                    }
+                    if (high_dwords_.size() > MAX_HIGH_DWORDS) {
+                        break;
+                    }
+                }
+            }
+            if (high_dwords_.size() > MAX_HIGH_DWORDS) {
+                high_dwords_.clear();
+                vector_filter_ = false;
+            }
+        }
+
+        bool contains(uint64_t value) const noexcept {
+            if (ranges_.empty() || value < ranges_.front().base) {
+                return false;
+            }
+            auto next = std::upper_bound(ranges_.begin(), ranges_.end(), value,
+                                         [](uint64_t v, const ImageRange& range) { return v < range.base; });
+            return value < std::prev(next)->end;
+        }
+
+        bool empty() const noexcept { return ranges_.empty(); }
+
+        // Upper halves of every image address; empty when too many to compare as vectors
+        const std::vector<uint32_t>& high_dwords() const noexcept { return high_dwords_; }
+        bool has_vector_filter() const noexcept { return vector_filter_; }
+
+    private:
+        std::vector<ImageRange> ranges_;
+        std::vector<uint32_t> high_dwords_;
+        bool vector_filter_ = true;
+    };
+
+    // One block of a batch; bytes past size are the overlap that lets a
+    // pattern straddle into the next block
+    struct ScanBlock {
+        uint64_t address{0};
+        size_t offset{0};       // Into the batch buffer
+        size_t size{0};         // Bytes this block matches from
+        size_t requested{0};    // size plus the overlap
+        size_t bytes_read{0};
+    };
+
+    struct ScanBatch {
+        std::vector<ScanBlock> blocks;
+        std::string buffer;
+        std::atomic<size_t> remaining{0};
+    };
+
+    struct PointerTally {
+        uint64_t count{0};
+        uint64_t bytes{0};
+    };
+
+    // What one matching thread found; merged once every thread is done
+    struct ScanTally {
+        std::unordered_map<uint64_t, PointerTally> pointers;
+        std::vector<uint64_t> pattern_counts;
+        std::vector<std::vector<uint64_t>> pattern_hits;
+    };
+
+    void keep_lowest_hits(std::vector<uint64_t>* hits) {
+        std::sort(hits->begin(), hits->end());
+        if (hits->size() > Constants::MAX_HEAP_SCAN_HITS) {
+            hits->resize(Constants::MAX_HEAP_SCAN_HITS);
+        }
+    }
+
+    // Counts the aligned values that point into an image. Each is charged
+    // the bytes up to the next such value, as the object it starts.
+    void scan_pointers(const uint8_t* data, size_t size, uint32_t pointer_size, const ImageMap& images,
+                       ScanTally* tally) {
+        size_t previous = SIZE_MAX;
+        uint64_t previous_value = 0;
+        auto found = [&](size_t offset, uint64_t value) {
+            if (previous != SIZE_MAX) {
+                auto& entry = tally->pointers[previous_value];
+                ++entry.count;
+                entry.bytes += (std::min)(offset - previous, Constants::MAX_HEAP_SCAN_OBJECT_SIZE);
+            }
+            previous = offset;
+            previous_value = value;
+        };
+
+        if (pointer_size == 8) {
+            size_t count = size / 8;
+            auto check = [&](size_t index) {
+                uint64_t value;
+                std::memcpy(&value, data + index * 8, sizeof(value));
+                if (images.contains(value)) {
+                    found(index * 8, value);
+                }
+            };
+
+            // Two values per vector; only those whose upper half matches an
+            // image's reach the range lookup
+            size_t index = 0;
+            const auto& highs = images.high_dwords();
+            if (images.has_vector_filter()) {
+                __m128i keys[MAX_HIGH_DWORDS];
+                for (size_t k = 0; k < highs.size(); ++k) {
+                    keys[k] = _mm_set1_epi32(static_cast<int>(highs[k]));
+                }
+                for (; index + 2 <= count; index += 2) {
+                    __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + index * 8));
+                    __m128i hits = _mm_setzero_si128();
+                    for (size_t k = 0; k < highs.size(); ++k) {
+                        hits = _mm_or_si128(hits, _mm_cmpeq_epi32(values, keys[k]));
+                    }
+                    int mask = _mm_movemask_epi8(hits);
+                    if (mask & 0x00F0) {
+                        check(index);
+                    }
+                    if (mask & 0xF000) {
+                        check(index + 1);
+                    }
+                }
+            }
+            for (; index < count; ++index) {
+                check(index);
+            }
+        } else {
+            for (size_t offset = 0; offset + 4 <= size; offset += 4) {
+                uint32_t value;
+                std::memcpy(&value, data + offset, sizeof(value));
+                if (images.contains(value)) {
+                    found(offset, value);
+                }
+            }
+        }
+
+        if (previous != SIZE_MAX) {
+            auto& entry = tally->pointers[previous_value];
+            ++entry.count;
+            entry.bytes += (std::min)(size - previous, Constants::MAX_HEAP_SCAN_OBJECT_SIZE);
+        }
+    }
+
+    // Counts the matches starting in the first `size` bytes; the rest of
+    // `available` is read only to finish a match
+    void scan_pattern(const uint8_t* data, size_t size, size_t available, uint64_t address,
+                      const std::vector<uint8_t>& pattern, uint64_t* count, std::vector<uint64_t>* hits) {
+        size_t length = pattern.size();
+        auto matches_at = [&](size_t offset) {
+            if (offset < size && offset + length <= available &&
+                std::memcmp(data + offset, pattern.data(), length) == 0) {
+                ++*count;
+                if (hits->size() < 2 * Constants::MAX_HEAP_SCAN_HITS) {
+                    hits->push_back(address + offset);
+                }
+            }
+        };
+
+        // Sixteen starting offsets at a time, keeping those whose first two
+        // bytes match the pattern's
+        size_t offset = 0;
+        __m128i first = _mm_set1_epi8(static_cast<char>(pattern[0]));
+        __m128i second = _mm_set1_epi8(static_cast<char>(length > 1 ? pattern[1] : pattern[0]));
+        for (; offset < size && offset + 17 <= available; offset += 16) {
+            __m128i current = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + offset));
+            __m128i candidates = _mm_cmpeq_epi8(current, first);
+            if (length > 1) {
+                __m128i following = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + offset + 1));
+                candidates = _mm_and_si128(candidates, _mm_cmpeq_epi8(following, second));
+            }
+            auto mask = static_cast<unsigned int>(_mm_movemask_epi8(candidates));
+            while (mask != 0) {
+                matches_at(offset + static_cast<size_t>(std::countr_zero(mask)));
+                mask &= mask - 1;
+            }
+        }
+        for (; offset < size; ++offset) {
+            matches_at(offset);
+        }
+    }
+
+    bool names_vtable(std::string_view symbol) {
+        return symbol.find("`vftable'") != std::string_view::npos && symbol.find("+0x") == std::string_view::npos;
+    }
+}
+
+/**
+ * @brief Scans the target and returns the histograms.
+ *
+ * The regions, modules and pointer size are read in one engine job. The
+ * regions are then cut into blocks of HEAP_SCAN_BLOCK_SIZE and read in
+ * batches of HEAP_SCAN_BATCH_SIZE. At most two batches are in memory: the
+ * one the threads match and the one the engine fills. A dump reads as fast
+ * as its file maps, so the matching is what runs in parallel.
+ *
+ * @param[in] command_executor Runs the reads and symbol lookups on the engine thread
+ * @param[in] options Regions, limits and patterns
+ * @param[out] error_message Set if the scan could not run or was cancelled
+ *
+ * @return The histograms; partial when error_message is set after the scan started
+ */
+HeapScanResult HeapScanner::scan(
+    _In_ CommandExecutor& command_executor,
+    _In_ const HeapScanOptions& options,
+    _Out_ std::string* error_message) {
+
+    error_message->clear();
+    HeapScanResult result;
+    auto start_time = std::chrono::steady_clock::now();
+    auto finish = [&result, start_time]() {
+        result.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start_time);
+        MetricsRegistry::instance().increment(MetricsRegistry::Counter::HeapBytesScanned, result.bytes_scanned);
+        return result;
+    };
+
+    std::vector<MemoryRegion> regions;
+    std::vector<ImageRange> image_ranges;
+    HRESULT hr = S_OK;
+    bool ran = command_executor.execute_on_engine(CommandPriority::Background, [&]() {
+        result.pointer_size = WinDbgHelpers::get_pointer_size(&hr);
+        if (SUCCEEDED(hr)) {
+            regions = WinDbgHelpers::get_committed_regions(&hr);
+        }
+        HRESULT module_hr = S_OK;
+        for (const auto& module : WinDbgHelpers::get_module_entries(&module_hr)) {
+            if (!module.unloaded && module.size > 0) {
+                image_ranges.push_back({module.base, module.base + module.size});
+            }
+        }
+    });
+    if (!ran) {
+        *error_message = "Heap scan cancelled";
+        return finish();
+    }
+    if (FAILED(hr)) {
+        *error_message = "Cannot enumerate the target's memory: " + WinDbgHelpers::format_windbg_error(hr);
+        return finish();
+    }
+    ImageMap images(std::move(image_ranges));
+
+    // Blocks of the regions to scan, grouped into batches the engine reads
+    // in one job each
+    size_t overlap = 0;
+    for (const auto& pattern : options.patterns) {
+        overlap = (std::max)(overlap, pattern.size() - 1);
+    }
+    std::vector<std::shared_ptr<ScanBatch>> batches;
+    uint64_t planned = 0;
+    size_t batch_bytes = Constants::HEAP_SCAN_BATCH_SIZE;
+    for (const auto& region : regions) {
+        if ((region.type & options.region_types) == 0 || (region.protect & READABLE_PROTECTION) == 0 ||
+            (region.protect & PAGE_GUARD) != 0) {
+            continue;
+        }
+        if (planned >= options.max_bytes) {
+            result.truncated = true;
+            break;
+        }
+        ++result.regions;
+        uint64_t region_size = (std::min)(region.size, options.max_bytes - planned);
+        result.truncated = result.truncated || region_size < region.size;
+        planned += region_size;
+
+        for (uint64_t block_start = 0; block_start < region_size; block_start += Constants::HEAP_SCAN_BLOCK_SIZE) {
+            ScanBlock block;
+            block.address = region.base + block_start;
+            block.size = static_cast<size_t>((std::min<uint64_t>)(Constants::HEAP_SCAN_BLOCK_SIZE, region_size - block_start));
+            block.requested = block.size + static_cast<size_t>((std::min<uint64_t>)(overlap, region_size - block_start - block.size));
+            if (batch_bytes + block.requested > Constants::HEAP_SCAN_BATCH_SIZE) {
+                batches.push_back(std::make_shared<ScanBatch>());
+                batch_bytes = 0;
+            }
+            block.offset = batch_bytes;
+            batch_bytes += block.requested;
+            batches.back()->blocks.push_back(block);
+        }
+    }
+
+    size_t parallel = options.max_parallel;
+    if (parallel == 0) {
+        parallel = (std::max)(std::thread::hardware_concurrency(), 1u);
+    }
+    parallel = (std::min)(parallel, Constants::MAX_PARALLEL_HEAP_SCAN);
+    result.threads = parallel;
+
+    // Matching threads take blocks as batches arrive; the reader waits while
+    // BATCHES_IN_FLIGHT batches are still being matched
+    std::mutex queue_mutex;
+    std::condition_variable queue_cv;
+    std::condition_variable reader_cv;
+    std::deque<std::pair<std::shared_ptr<ScanBatch>, size_t>> queue;
+    size_t batches_in_flight = 0;
+    bool reading_done = false;
+
+    std::vector<ScanTally> tallies(parallel);
+    auto match = [&](ScanTally& tally) {
+        tally.pattern_counts.assign(options.patterns.size(), 0);
+        tally.pattern_hits.assign(options.patterns.size(), {});
+        for (;;) {
+            std::shared_ptr<ScanBatch> batch;
+            size_t index = 0;
+            {
+                std::unique_lock<std::mutex> lock(queue_mutex);
+                queue_cv.wait(lock, [&] { return !queue.empty() || reading_done; });
+                if (queue.empty()) {
+                    return;
+                }
+                std::tie(batch, index) = std::move(queue.front());
+                queue.pop_front();
+            }
+
+            const auto& block = batch->blocks[index];
+            const auto* data = reinterpret_cast<const uint8_t*>(batch->buffer.data() + block.offset);
+            if (!images.empty()) {
+                scan_pointers(data, (std::min)(block.size, block.bytes_read), result.pointer_size, images, &tally);
+            }
+            for (size_t i = 0; i < options.patterns.size(); ++i) {
+                scan_pattern(data, (std::min)(block.size, block.bytes_read), block.bytes_read, block.address,
+                             options.patterns[i], &tally.pattern_counts[i], &tally.pattern_hits[i]);
+                if (tally.pattern_hits[i].size() >= 2 * Constants::MAX_HEAP_SCAN_HITS) {
+                    keep_lowest_hits(&tally.pattern_hits[i]);
+                }
+            }
+
+            if (batch->remaining.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> lock(queue_mutex);
+                --batches_in_flight;
+                reader_cv.notify_one();
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(parallel);
+    for (size_t i = 0; i < parallel; ++i) {
+        threads.emplace_back(match, std::ref(tallies[i]));
+    }
+
+    for (auto& batch : batches) {
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            reader_cv.wait(lock, [&] { return batches_in_flight < BATCHES_IN_FLIGHT; });
+        }
+
+        std::vector<MemoryRange> ranges;
+        ranges.reserve(batch->blocks.size());
+        for (const auto& block : batch->blocks) {
+            ranges.push_back({static_cast<uintptr_t>(block.address), block.requested});
+        }
+        std::vector<MemoryRangeResult> reads;
+        ran = command_executor.execute_on_engine(CommandPriority::Background, [&]() {
+            reads = WinDbgHelpers::read_memory_ranges(ranges, batch->buffer);
+        });
+        if (!ran) {
+            *error_message = "Heap scan cancelled";
+            break;
+        }
+
+        for (size_t i = 0; i < batch->blocks.size() && i < reads.size(); ++i) {
+            auto& block = batch->blocks[i];
+            block.bytes_read = reads[i].bytes_read;
+            result.bytes_scanned += (std::min)(block.size, block.bytes_read);
+            result.bytes_unreadable += block.size - (std::min)(block.size, block.bytes_read);
+        }
+        batch->remaining = batch->blocks.size();
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            ++batches_in_flight;
+            for (size_t i = 0; i < batch->blocks.size(); ++i) {
+                queue.emplace_back(batch, i);
+            }
+        }
+        queue_cv.notify_all();
+        batch.reset();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        reading_done = true;
+    }
+    queue_cv.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    // Merge what each thread found
+    std::unordered_map<uint64_t, PointerTally> pointers;
+    result.patterns.resize(options.patterns.size());
+    for (size_t i = 0; i < options.patterns.size(); ++i) {
+        result.patterns[i].pattern = options.patterns[i];
+    }
+    for (auto& tally : tallies) {
+        if (pointers.empty()) {
+            pointers = std::move(tally.pointers);
+        } else {
+            for (const auto& [value, entry] : tally.pointers) {
+                auto& merged = pointers[value];
+                merged.count += entry.count;
+                merged.bytes += entry.bytes;
+            }
+        }
+        for (size_t i = 0; i < tally.pattern_counts.size(); ++i) {
+            result.patterns[i].count += tally.pattern_counts[i];
+            result.patterns[i].hits.insert(result.patterns[i].hits.end(),
+                                           tally.pattern_hits[i].begin(), tally.pattern_hits[i].end());
+        }
+    }
+    for (auto& pattern : result.patterns) {
+        keep_lowest_hits(&pattern.hits);
+    }
+    result.distinct_pointers = pointers.size();
+
+    std::vector<PointerHistogramEntry> ranked;
+    ranked.reserve(pointers.size());
+    for (const auto& [value, entry] : pointers) {
+        ranked.push_back({value, entry.count, entry.bytes, {}});
+    }
+    pointers.clear();
+    std::sort(ranked.begin(), ranked.end(), [](const auto& a, const auto& b) {
+        return a.count != b.count ? a.count > b.count : a.value < b.value;
+    });
+
+    // The most frequent pointers are resolved until enough vtables are
+    // found; most heap values pointing into an image are not vtables
+    size_t top = (std::min)(options.top, Constants::MAX_HEAP_SCAN_TOP);
+    size_t limit = options.vtables_only ? (std::min)(ranked.size(), Constants::MAX_HEAP_SCAN_RESOLVED)
+                                        : (std::min)(ranked.size(), top);
+    size_t next = 0;
+    while (next < limit && result.pointers.size() < top && error_message->empty()) {
+        size_t end = (std::min)(next + RESOLVE_CHUNK, limit);
+        ran = command_executor.execute_on_engine(CommandPriority::Background, [&]() {
+            for (size_t i = next; i < end; ++i) {
+                ranked[i].symbol = WinDbgHelpers::get_symbol_name(static_cast<uintptr_t>(ranked[i].value));
+            }
+        });
+        if (!ran) {
+            *error_message = "Heap scan cancelled";
+            break;
+        }
+        for (size_t i = next; i < end && result.pointers.size() < top; ++i) {
+            if (!options.vtables_only || names_vtable(ranked[i].symbol)) {
+                result.pointers.push_back(std::move(ranked[i]));
+            }
+        }
+        result.resolved = end;
+        next = end;
+    }
+
+    return finish();
+}
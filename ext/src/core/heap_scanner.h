@@ -0,0 +1,82 @@
+#pragma once
+
+#include "../pch.h"
+#include "../../inc/command_executor.h"
+#include "../utils/constants.h"
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace vibedbg::core {
+
+struct HeapScanOptions {
+    uint32_t region_types{MEM_PRIVATE};     // MEM_PRIVATE, MEM_MAPPED and MEM_IMAGE regions to scan
+    uint64_t max_bytes{Constants::DEFAULT_HEAP_SCAN_BYTES}; // Regions past this much committed memory are skipped
+    size_t max_parallel{0};                 // Matching threads; zero: one per core, at most MAX_PARALLEL_HEAP_SCAN
+    size_t top{Constants::DEFAULT_HEAP_SCAN_TOP}; // Histogram entries returned
+    bool vtables_only{true};                // Keep only pointers that resolve to a vftable symbol
+    std::vector<std::vector<uint8_t>> patterns; // Byte signatures counted alongside the pointers
+};
+
+// Pointer into a loaded image, as often as it was found in the scanned memory
+struct PointerHistogramEntry {
+    uint64_t value{0};
+    uint64_t count{0};
+    uint64_t bytes{0};      // Estimated: up to the next image pointer, at most MAX_HEAP_SCAN_OBJECT_SIZE each
+    std::string symbol;     // Empty when the pointer did not resolve
+};
+
+struct PatternScanResult {
+    std::vector<uint8_t> pattern;
+    uint64_t count{0};
+    std::vector<uint64_t> hits; // Lowest MAX_HEAP_SCAN_HITS addresses
+};
+
+struct HeapScanResult {
+    std::vector<PointerHistogramEntry> pointers; // Most frequent first
+    std::vector<PatternScanResult> patterns;     // In request order
+    size_t regions{0};
+    uint64_t bytes_scanned{0};
+    uint64_t bytes_unreadable{0};               // Committed but not readable, as in a dump that left them out
+    uint64_t distinct_pointers{0};              // Distinct image pointers before the histogram was cut
+    size_t resolved{0};                         // Pointers resolved while looking for vtables
+    bool truncated{false};                      // Regions past max_bytes were skipped
+    uint32_t pointer_size{0};
+    size_t threads{0};
+    std::chrono::milliseconds elapsed{0};
+};
+
+/**
+ * @class HeapScanner
+ * @brief Counts the objects in a target's memory by the vtables they point to.
+ *
+ * Replaces "!heap -stat" and "s -d" loops whose text the client had to
+ * parse. Committed regions come from QueryVirtual. They are read in large
+ * blocks, one batch per engine job in the background lane, so other
+ * commands run between batches. While the engine reads the next batch, a
+ * pool of threads matches the one before.
+ *
+ * Matching looks at every aligned pointer-sized value. Values that point
+ * into a loaded image are counted, and SSE2 compares discard most other
+ * values sixteen bytes at a time. The most frequent values are then resolved
+ * on the engine; with vtables_only, only those that name a vftable are
+ * kept. Byte patterns are counted in the same pass.
+ *
+ * Without heap metadata, object sizes are estimated. Each object is assumed
+ * to run up to the next image pointer or the end of the block.
+ */
+class HeapScanner {
+public:
+    /**
+     * @brief Scans the target and returns the histograms.
+     *
+     * @param[in] command_executor Runs the reads and symbol lookups on the engine thread
+     * @param[in] options Regions, limits and patterns
+     * @param[out] error_message Set if the scan could not run or was cancelled
+     * @return The histograms; partial when error_message is set after the scan started
+     */
+    static HeapScanResult scan(CommandExecutor& command_executor, const HeapScanOptions& options,
+                               std::string* error_message);
+};
+
+} // namespace vibedbg::core
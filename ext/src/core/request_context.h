@@ -0,0 +1,91 @@
+#pragma once
+
+#include "../pch.h"
+#include "../../inc/command_executor.h"
+
+namespace vibedbg::core {
+
+    /**
+     * @brief Per-request state visible to the handlers serving an MCP request.
+     *
+     * Command handlers are reached through several layers of routing that do
+     * not know about the pipe connection. Rather than threading transport
+     * details through every handler signature, the request being served is
+     * installed for the executing thread with a RequestScope and handlers
+     * consult RequestContext::current() where it matters.
+     */
+    struct RequestContext {
+        std::string request_id;     ///< Identifier of the request being served
+        std::string session_id;     ///< Client session whose engine context commands run in; empty for none
+        OutputSink output_sink;     ///< Set when the client accepts a streamed response
+        std::shared_ptr<const utils::OutputFilter> output_filter; ///< Set when the client asked for a slice of the output
+        std::chrono::milliseconds timeout{0}; ///< Client deadline; commands are not given longer
+
+        /**
+         * @brief Gets the context installed on the calling thread.
+         *
+         * @return Pointer to the active context, or nullptr outside a request
+         */
+        static RequestContext* current() noexcept { return slot(); }
+
+    private:
+        friend class RequestScope;
+
+        static RequestContext*& slot() noexcept {
+            thread_local RequestContext* active = nullptr;
+            return active;
+        }
+    };
+
+    /**
+     * @brief Installs a RequestContext on the current thread for its lifetime.
+     *
+     * Scopes nest; the previously active context is restored on destruction.
+     */
+    class RequestScope {
+    public:
+        explicit RequestScope(RequestContext& context) noexcept
+            : previous_(RequestContext::slot()) {
+            RequestContext::slot() = &context;
+        }
+
+        ~RequestScope() { RequestContext::slot() = previous_; }
+
+        RequestScope(const RequestScope&) = delete;
+        RequestScope& operator=(const RequestScope&) = delete;
+
+    private:
+        RequestContext* previous_;
+    };
+
+    /**
+     * @brief Disables streaming for handlers that compose several commands.
+     *
+     * Composite handlers interleave their own text with command output, so
+     * streaming individual commands would reorder the response. Within this
+     * scope output is buffered and returned with the final response frame.
+     */
+    class StreamingSuspension {
+    public:
+        StreamingSuspension() noexcept : context_(RequestContext::current()) {
+            if (context_) {
+                suspended_sink_ = std::move(context_->output_sink);
+                context_->output_sink = nullptr;
+            }
+        }
+
+        ~StreamingSuspension() {
+            if (context_) {
+                context_->output_sink = std::move(suspended_sink_);
+            }
+        }
+
+        StreamingSuspension(const StreamingSuspension&) = delete;
+        StreamingSuspension& operator=(const StreamingSuspension&) = delete;
+
+    private:
+        RequestContext* context_;
+        OutputSink suspended_sink_;
+    };
+
+} // namespace vibedbg::core
@@ -0,0 +1,75 @@
+#include "pch.h"
+#include "session_contexts.h"
+#include <algorithm>
+
+using namespace vibedbg::core;
+using namespace vibedbg::utils;
+
+namespace {
+    thread_local bool restoring_context = false;
+}
+
+bool SessionContexts::restoring() noexcept {
+    return restoring_context;
+}
+
+void SessionContexts::activate(const std::string& session_id) {
+    // The engine context stays with whoever changes it next; a session whose
+    // commands ran last is already current, including any change made at the
+    // debugger console since
+    if (session_id.empty() || session_id == active_session_) {
+        active_session_ = session_id;
+        return;
+    }
+    active_session_ = session_id;
+
+    auto it = contexts_.find(session_id);
+    if (it == contexts_.end() || it->second.target_epoch != target_epoch_) {
+        return;
+    }
+    it->second.last_used = ++use_count_;
+
+    restoring_context = true;
+    HRESULT hr = WinDbgHelpers::set_engine_context(it->second.context);
+    restoring_context = false;
+    if (FAILED(hr)) {
+        // The thread or process may have exited; the session continues in
+        // the current context and saves that one instead
+        LOG_DEBUG("SessionContexts", "Could not restore the context of session " + session_id + ": " +
+                                     WinDbgHelpers::format_windbg_error(hr));
+    }
+}
+
+void SessionContexts::save(const std::string& session_id) {
+    if (session_id.empty()) {
+        return;
+    }
+
+    HRESULT hr = S_OK;
+    EngineContext context = WinDbgHelpers::get_engine_context(&hr);
+    if (FAILED(hr)) {
+        // No target; nothing to restore later either
+        contexts_.erase(session_id);
+        return;
+    }
+
+    auto it = contexts_.find(session_id);
+    if (it == contexts_.end()) {
+        if (contexts_.size() >= Constants::MAX_SESSIONS) {
+            evict_least_recent();
+        }
+        it = contexts_.emplace(session_id, SavedContext{}).first;
+    }
+    it->second.context = context;
+    it->second.target_epoch = target_epoch_;
+    it->second.last_used = ++use_count_;
+}
+
+void SessionContexts::evict_least_recent() {
+    auto oldest = std::min_element(contexts_.begin(), contexts_.end(), [](const auto& a, const auto& b) {
+        return a.second.last_used < b.second.last_used;
+    });
+    if (oldest != contexts_.end()) {
+        contexts_.erase(oldest);
+    }
+}
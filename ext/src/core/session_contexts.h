@@ -0,0 +1,97 @@
+#pragma once
+
+#include "../pch.h"
+#include "../utils/constants.h"
+#include "../utils/windbg_helpers.h"
+#include <string>
+#include <unordered_map>
+
+namespace vibedbg::core {
+
+/**
+ * @class SessionContexts
+ * @brief Remembers the process, thread and frame each client session left
+ *        the engine in, and makes them current again before its next command.
+ *
+ * Every client shares one engine, so a "~3s" or ".frame 2" from one agent
+ * would otherwise change what the commands of every other agent see. A
+ * session's context is saved after each of its engine jobs and restored
+ * before the next one; while the same session keeps running, or the engine
+ * is already in its context, nothing is switched.
+ *
+ * Once the target has run, the saved contexts describe a state that no longer
+ * exists, and every session follows the engine to the new event thread.
+ * Requests without a session id share the engine context as before.
+ *
+ * A restore is not a change anyone asked for: cached command results are
+ * keyed by the context they were produced in, and the session event
+ * callbacks ignore the thread switches a restore reports.
+ *
+ * Engine thread only.
+ */
+class SessionContexts {
+public:
+    /**
+     * @brief Makes the session's saved context the engine's current one.
+     *
+     * @param[in] session_id Session the next engine job belongs to; empty for none
+     */
+    void activate(const std::string& session_id);
+
+    /**
+     * @brief Saves the engine's current context as the session's.
+     *
+     * @param[in] session_id Session whose engine job just finished; empty for none
+     */
+    void save(const std::string& session_id);
+
+    /**
+     * @brief Marks every saved context stale after the target ran.
+     */
+    void target_resumed() noexcept { ++target_epoch_; }
+
+    /**
+     * @brief Tells whether the calling thread is restoring a session's
+     *        context, so engine notifications it raises are not user changes.
+     */
+    static bool restoring() noexcept;
+
+    size_t size() const noexcept { return contexts_.size(); }
+
+private:
+    struct SavedContext {
+        utils::EngineContext context;
+        uint64_t target_epoch{0};
+        uint64_t last_used{0};
+    };
+
+    void evict_least_recent();
+
+    std::unordered_map<std::string, SavedContext> contexts_;
+    std::string active_session_;    // Session the engine context currently belongs to
+    uint64_t target_epoch_{0};
+    uint64_t use_count_{0};
+};
+
+/**
+ * @brief Activates a session for the lifetime of one engine job and saves
+ *        its context when the job ends.
+ */
+class SessionActivation {
+public:
+    SessionActivation(SessionContexts& contexts, std::string session_id)
+        : contexts_(contexts), session_id_(std::move(session_id)) {
+        contexts_.activate(session_id_);
+    }
+
+    ~SessionActivation() { contexts_.save(session_id_); }
+
+    SessionActivation(const SessionActivation&) = delete;
+    SessionActivation& operator=(const SessionActivation&) = delete;
+
+private:
+    SessionContexts& contexts_;
+    std::string session_id_;
+};
+
+} // namespace vibedbg::core
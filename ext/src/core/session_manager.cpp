@@ -1,62 +1,41 @@
 #include "pch.h"
 #include "../../inc/session_manager.h"
 #include "../../inc/error_handling.h"
-#include "../utils/windbg_helpers.h"
 
 using namespace vibedbg::core;
-using namespace vibedbg::utils;
 
 SessionManager::SessionManager() {
-    state_.session_start = std::chrono::steady_clock::now();
+    auto state = std::make_shared<SessionState>();
+    state->session_start = std::chrono::steady_clock::now();
+    state_.store(std::move(state));
+}
+
+SessionManager::~SessionManager() {
+    {
+        std::lock_guard<std::mutex> lock(notify_mutex_);
+        stopping_ = true;
+    }
+    notify_cv_.notify_all();
+    if (notify_thread_.joinable()) {
+        notify_thread_.join();
+    }
 }
 
 SessionError SessionManager::initialize() {
     LOG_INFO("SessionManager", "initialize() started");
-    std::unique_lock<std::shared_mutex> lock(state_mutex_);
-    LOG_DEBUG("SessionManager", "Got state mutex lock");
+    std::lock_guard<std::mutex> lock(update_mutex_);
+    LOG_DEBUG("SessionManager", "Got state update lock");
     
     // Assume user-mode debugging by default (original goal was user-mode processes only)
     LOG_INFO("SessionManager", "Setting up for user-mode debugging");
-    state_.is_connected = true;
+    auto state = std::make_shared<SessionState>(*state_.load());
+    state->is_connected = true;
+    state_.store(std::move(state));
     LOG_INFO("SessionManager", "Connected to debugger");
     
-    // Try to get current process info
-    LOG_DEBUG("SessionManager", "Getting current process info");
-    HRESULT hr_pid, hr_name;
-    uint32_t process_id = WinDbgHelpers::get_current_process_id(&hr_pid);
-    std::string process_name = WinDbgHelpers::get_current_process_name(&hr_name);
-    
-    if (SUCCEEDED(hr_pid) && SUCCEEDED(hr_name)) {
-        LOG_DEBUG("SessionManager", "Successfully got process info");
-        ProcessInfo process_info;
-        process_info.process_id = process_id;
-        process_info.process_name = process_name;
-        process_info.is_attached = true;
-        process_info.attach_time = std::chrono::steady_clock::now();
-        
-        state_.current_process = process_info;
-    } else {
-        LOG_WARNING("SessionManager", "Failed to get process info, continuing anyway");
-    }
-    
-    // Try to get current thread info
-    LOG_DEBUG("SessionManager", "Getting current thread info");
-    HRESULT hr_tid;
-    uint32_t thread_id = WinDbgHelpers::get_current_thread_id(&hr_tid);
-    if (SUCCEEDED(hr_tid)) {
-        LOG_DEBUG("SessionManager", "Successfully got thread info");
-        ThreadInfo thread_info;
-        thread_info.thread_id = thread_id;
-        if (state_.current_process) {
-            thread_info.process_id = state_.current_process->process_id;
-        }
-        thread_info.is_current = true;
-        thread_info.state = "Running";
-        
-        state_.current_thread = thread_info;
-    } else {
-        LOG_WARNING("SessionManager", "Failed to get thread info, continuing anyway");
-    }
+    // Process, thread and module state arrives through SessionEventCallbacks,
+    // which read the initial state when they are installed and follow the
+    // engine's events from then on; nothing is queried here
     
     initialized_.store(true);
     LOG_INFO("SessionManager", "Initialization completed successfully");
@@ -64,28 +43,113 @@ SessionError SessionManager::initialize() {
 }
 
 void SessionManager::shutdown() {
-    std::unique_lock<std::shared_mutex> lock(state_mutex_);
+    std::lock_guard<std::mutex> lock(update_mutex_);
     initialized_.store(false);
-    state_.is_connected = false;
+    auto state = std::make_shared<SessionState>(*state_.load());
+    state->is_connected = false;
+    state_.store(std::move(state));
 }
 
 // detect_current_mode removed - we now assume user-mode debugging by default
 // Original hanging issue was caused by WinDbgHelpers::detect_debugging_mode()
 
-const SessionState& SessionManager::get_state() const {
+SessionSnapshot SessionManager::get_state() const {
     // Lazy initialization check
     const_cast<SessionManager*>(this)->ensure_initialized();
     
-    std::shared_lock<std::shared_mutex> lock(state_mutex_);
-    return state_;
+    // The snapshot stays valid however the state changes after
+    return state_.load();
 }
 
+// The generation keeps counting up whatever new_state holds, so a state
+// replaced wholesale is never taken for an earlier one
 SessionError SessionManager::update_state(const SessionState& new_state) {
-    std::unique_lock<std::shared_mutex> lock(state_mutex_);
-    state_ = new_state;
+    auto [old_state, published] = replace_state([&new_state](SessionState& state) {
+        uint64_t generation = state.generation;
+        state = new_state;
+        state.generation = generation + 1;
+    });
+    
+    notify_state_change(std::move(old_state), std::move(published));
     return SessionError::None;
 }
 
+void SessionManager::modify_state(const std::function<void(SessionState&)>& change) {
+    auto [old_state, new_state] = replace_state([&change](SessionState& state) {
+        change(state);
+        ++state.generation;
+    });
+    notify_state_change(std::move(old_state), std::move(new_state));
+}
+
+/**
+ * @brief Publishes a copy of the current state with a change applied.
+ * 
+ * Writers take turns copying the current snapshot, so no change is lost;
+ * readers keep loading the previous snapshot until the new one is stored.
+ * 
+ * @param[in] change Applied to the copy before it is published
+ * 
+ * @return The snapshots before and after the change
+ */
+std::pair<SessionSnapshot, SessionSnapshot> SessionManager::replace_state(
+    _In_ const std::function<void(SessionState&)>& change) {
+    std::lock_guard<std::mutex> lock(update_mutex_);
+    SessionSnapshot old_state = state_.load();
+    auto new_state = std::make_shared<SessionState>(*old_state);
+    change(*new_state);
+    state_.store(new_state);
+    return {std::move(old_state), std::move(new_state)};
+}
+
+ProcessInfo SessionManager::get_current_process_info(SessionError* error) {
+    SessionSnapshot state = state_.load();
+    if (!state->current_process) {
+        if (error) *error = SessionError::InvalidState;
+        return {};
+    }
+    if (error) *error = SessionError::None;
+    return *state->current_process;
+}
+
+ThreadInfo SessionManager::get_current_thread_info(SessionError* error) {
+    SessionSnapshot state = state_.load();
+    if (!state->current_thread) {
+        if (error) *error = SessionError::InvalidState;
+        return {};
+    }
+    if (error) *error = SessionError::None;
+    return *state->current_thread;
+}
+
+json SessionManager::serialize_state() const {
+    SessionSnapshot state = get_state();
+    
+    json data = {
+        {"connected", state->is_connected},
+        {"target_running", state->is_target_running},
+        {"thread_count", state->thread_count},
+        {"module_count", state->module_count},
+        {"generation", state->generation}
+    };
+    if (state->current_process) {
+        data["current_process"] = {
+            {"process_id", state->current_process->process_id},
+            {"process_name", state->current_process->process_name},
+            {"image_path", state->current_process->image_path},
+            {"is_attached", state->current_process->is_attached}
+        };
+    }
+    if (state->current_thread) {
+        data["current_thread"] = {
+            {"thread_id", state->current_thread->thread_id},
+            {"process_id", state->current_thread->process_id},
+            {"state", state->current_thread->state}
+        };
+    }
+    return data;
+}
+
 std::vector<std::string> SessionManager::get_suggested_commands() const {
     // Return basic user-mode debugging commands
     return {
@@ -107,28 +171,100 @@ std::vector<std::string> SessionManager::get_suggested_commands() const {
 
 SessionError SessionManager::switch_to_thread(uint32_t thread_id) {
     try {
-        std::unique_lock<std::shared_mutex> lock(state_mutex_);
-        
         // Update the state first
-        if (state_.current_thread) {
-            state_.current_thread->thread_id = thread_id;
-            state_.current_thread->is_current = true;
-        } else {
-            ThreadInfo thread_info;
-            thread_info.thread_id = thread_id;
-            thread_info.is_current = true;
-            thread_info.state = "running";
-            state_.current_thread = thread_info;
-        }
+        auto [old_state, new_state] = replace_state([thread_id](SessionState& state) {
+            if (state.current_thread) {
+                state.current_thread->thread_id = thread_id;
+                state.current_thread->is_current = true;
+            } else {
+                ThreadInfo thread_info;
+                thread_info.thread_id = thread_id;
+                thread_info.is_current = true;
+                thread_info.state = "running";
+                state.current_thread = thread_info;
+            }
+        });
         
         // Thread switching will be implemented when debugger interfaces are available
         
+        notify_state_change(std::move(old_state), std::move(new_state));
         return SessionError::None;
     } catch (...) {
         return SessionError::InternalError;
     }
 }
 
+void SessionManager::register_state_change_callback(StateChangeCallback callback) {
+    {
+        std::lock_guard<std::mutex> lock(callbacks_mutex_);
+        state_change_callbacks_.push_back(std::move(callback));
+    }
+    
+    std::lock_guard<std::mutex> lock(notify_mutex_);
+    if (!notify_thread_.joinable() && !stopping_) {
+        notify_thread_ = std::thread(&SessionManager::notify_loop, this);
+    }
+}
+
+/**
+ * @brief Hands a change to the notification thread.
+ * 
+ * The caller never waits for a callback. A change the callbacks have not
+ * seen yet is merged with this one, so a slow callback sees fewer, larger
+ * changes rather than a growing backlog.
+ * 
+ * @param[in] old_state Snapshot before the change
+ * @param[in] new_state Snapshot after the change
+ */
+void SessionManager::notify_state_change(_In_ SessionSnapshot old_state, _In_ SessionSnapshot new_state) {
+    {
+        std::lock_guard<std::mutex> lock(notify_mutex_);
+        if (!notify_thread_.joinable()) {
+            return;
+        }
+        if (!unreported_old_) {
+            unreported_old_ = std::move(old_state);
+        }
+        unreported_new_ = std::move(new_state);
+    }
+    notify_cv_.notify_one();
+}
+
+/**
+ * @brief Runs the state change callbacks until the session manager is destroyed.
+ * 
+ * @note This method runs in the notification thread and should not be called directly.
+ */
+void SessionManager::notify_loop() {
+    while (true) {
+        SessionSnapshot old_state;
+        SessionSnapshot new_state;
+        {
+            std::unique_lock<std::mutex> lock(notify_mutex_);
+            notify_cv_.wait(lock, [this] { return unreported_new_ || stopping_; });
+            if (stopping_) {
+                return;
+            }
+            old_state = std::move(unreported_old_);
+            new_state = std::move(unreported_new_);
+        }
+        
+        std::vector<StateChangeCallback> callbacks;
+        {
+            std::lock_guard<std::mutex> lock(callbacks_mutex_);
+            callbacks = state_change_callbacks_;
+        }
+        
+        for (const auto& callback : callbacks) {
+            try {
+                callback(*old_state, *new_state);
+            } catch (...) {
+                LOG_WARNING("SessionManager", "State change callback threw an exception");
+            }
+        }
+    }
+}
+
 void SessionManager::ensure_initialized() {
     LOG_DEBUG("SessionManager", "ensure_initialized() called");
     if (!initialized_.load()) {
@@ -0,0 +1,335 @@
+#include "pch.h"
+#include "symbol_loader.h"
+#include "dump_analyzer.h"
+#include "../utils/command_utils.h"
+#include "../utils/metrics.h"
+#include "../utils/windbg_helpers.h"
+#include <algorithm>
+
+using namespace vibedbg::core;
+using namespace vibedbg::utils;
+
+namespace {
+    bool same_module(std::string_view name, std::string_view requested) {
+        return CommandUtils::to_lower(name) == CommandUtils::to_lower(requested);
+    }
+}
+
+SymbolLoader::SymbolLoader(std::shared_ptr<CommandExecutor> command_executor)
+    : command_executor_(std::move(command_executor)),
+      cancel_event_(CreateEventA(nullptr, TRUE, FALSE, nullptr)) {
+}
+
+SymbolLoader::~SymbolLoader() {
+    cancel();
+    std::lock_guard<std::mutex> lock(start_mutex_);
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+}
+
+/**
+ * @brief Starts a background load and returns at once.
+ *
+ * The load runs on a thread of its own; get_status() and the symbol_load
+ * events report how far it got.
+ *
+ * @param[in] options Modules, symbol path and prefetch workers
+ * @param[out] error_message Set if a load is already running
+ *
+ * @return true if the load was started
+ */
+bool SymbolLoader::start(_In_ const SymbolLoadOptions& options, _Out_ std::string* error_message) {
+    error_message->clear();
+    std::lock_guard<std::mutex> lock(start_mutex_);
+    {
+        std::lock_guard<std::mutex> status_lock(status_mutex_);
+        if (status_.running) {
+            *error_message = "A symbol load is already running";
+            return false;
+        }
+        uint64_t job = status_.job + 1;
+        status_ = SymbolLoadStatus{};
+        status_.job = job;
+        status_.running = true;
+        started_ = std::chrono::steady_clock::now();
+    }
+
+    // The previous load has finished; its thread only has to be collected
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+    cancelled_.store(false);
+    if (cancel_event_) {
+        ResetEvent(cancel_event_.get());
+    }
+    worker_ = std::thread(&SymbolLoader::run, this, options);
+    return true;
+}
+
+void SymbolLoader::cancel() {
+    cancelled_.store(true);
+    if (cancel_event_) {
+        SetEvent(cancel_event_.get());
+    }
+}
+
+SymbolLoadStatus SymbolLoader::get_status() const {
+    std::lock_guard<std::mutex> lock(status_mutex_);
+    SymbolLoadStatus status = status_;
+    if (status.running) {
+        status.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - started_);
+    }
+    return status;
+}
+
+nlohmann::json SymbolLoader::status_json(_In_ const SymbolLoadStatus& status) {
+    nlohmann::json data = {
+        {"job", status.job},
+        {"running", status.running},
+        {"cancelled", status.cancelled},
+        {"total", status.total},
+        {"completed", status.loaded + status.failed},
+        {"loaded", status.loaded},
+        {"failed", status.failed},
+        {"prefetched", status.prefetched},
+        {"stack_modules", status.stack_modules},
+        {"failures", status.failures},
+        {"elapsed_ms", status.elapsed.count()}
+    };
+    if (!status.error_message.empty()) {
+        data["error_message"] = status.error_message;
+    }
+    return data;
+}
+
+void SymbolLoader::set_event_publisher(EventPublisher publisher) {
+    std::lock_guard<std::mutex> lock(publisher_mutex_);
+    publisher_ = std::move(publisher);
+}
+
+/**
+ * @brief Plans the load, then loads every module with a pool of workers.
+ *
+ * Workers take the modules in priority order, so the stack modules are the
+ * first to be downloaded and the first to reach the engine.
+ *
+ * @param[in] options Options the load was started with
+ */
+void SymbolLoader::run(SymbolLoadOptions options) {
+    std::vector<PlannedModule> modules;
+    std::string symbol_path;
+    if (!plan(options, &modules, &symbol_path)) {
+        return;
+    }
+    publish_progress({});
+    if (modules.empty()) {
+        finish();
+        return;
+    }
+
+    size_t parallel = options.max_parallel;
+    if (parallel == 0) {
+        parallel = (std::max)(std::thread::hardware_concurrency(), 1u);
+    }
+    parallel = (std::min)({parallel, Constants::MAX_PARALLEL_SYMBOL_PREFETCH, modules.size()});
+
+    LOG_INFO("SymbolLoader", "Loading symbols for " + std::to_string(modules.size()) + " modules with " +
+                             std::to_string(parallel) + " workers");
+
+    std::atomic<size_t> next{0};
+    auto work = [&] {
+        for (size_t i = next.fetch_add(1); i < modules.size() && !cancelled_.load(); i = next.fetch_add(1)) {
+            bool loaded = load_module(modules[i], options, symbol_path);
+            if (!loaded && cancelled_.load()) {
+                break;
+            }
+            {
+                std::lock_guard<std::mutex> lock(status_mutex_);
+                if (loaded) {
+                    ++status_.loaded;
+                } else {
+                    ++status_.failed;
+                    status_.failures.push_back(modules[i].name);
+                }
+            }
+            MetricsRegistry::instance().increment(loaded ? MetricsRegistry::Counter::SymbolModulesLoaded
+                                                         : MetricsRegistry::Counter::SymbolModulesFailed);
+            publish_progress(modules[i].name);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(parallel - 1);
+    for (size_t i = 1; i < parallel; ++i) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    finish();
+}
+
+/**
+ * @brief Picks the modules to load, the current thread's stack modules first.
+ *
+ * The module list and the stack offsets come from one engine job. The
+ * offsets are not resolved, since resolving them would load the very
+ * symbols this load is about to load.
+ *
+ * @param[in] options Modules requested, if any
+ * @param[out] modules Receives the modules in the order they are loaded
+ * @param[out] symbol_path Receives the symbol path the workers download with
+ *
+ * @return false if the load ended here; the status then says why
+ */
+bool SymbolLoader::plan(
+    _In_ const SymbolLoadOptions& options,
+    _Out_ std::vector<PlannedModule>* modules,
+    _Out_ std::string* symbol_path) {
+
+    std::vector<ModuleEntry> entries;
+    std::vector<uint64_t> stack_offsets;
+    HRESULT hr = S_OK;
+    *symbol_path = options.symbol_path;
+    bool ran = command_executor_->execute_on_engine(CommandPriority::Normal, [&] {
+        entries = WinDbgHelpers::get_module_entries(&hr);
+        stack_offsets = WinDbgHelpers::get_stack_offsets(Constants::DEFAULT_STACK_FRAMES);
+        if (symbol_path->empty()) {
+            *symbol_path = WinDbgHelpers::get_symbol_path();
+        }
+    });
+    if (!ran || cancelled_.load()) {
+        finish("Symbol load cancelled before it was planned");
+        return false;
+    }
+    if (FAILED(hr)) {
+        finish("Failed to read the module list: " + WinDbgHelpers::format_windbg_error(hr));
+        return false;
+    }
+
+    // A module's rank is the first stack frame that lies in it
+    std::vector<std::pair<size_t, PlannedModule>> ranked;
+    for (const auto& entry : entries) {
+        if (entry.unloaded) {
+            continue;
+        }
+        bool wanted = options.modules.empty()
+            ? entry.symbol_type == DEBUG_SYMTYPE_DEFERRED
+            : std::any_of(options.modules.begin(), options.modules.end(),
+                          [&entry](const std::string& name) { return same_module(entry.name, name); });
+        if (!wanted) {
+            continue;
+        }
+
+        auto frame = std::find_if(stack_offsets.begin(), stack_offsets.end(), [&entry](uint64_t offset) {
+            return offset >= entry.base && offset - entry.base < entry.size;
+        });
+        ranked.emplace_back(static_cast<size_t>(frame - stack_offsets.begin()),
+                            PlannedModule{entry.name, entry.image_name});
+    }
+    std::stable_sort(ranked.begin(), ranked.end(),
+                     [](const auto& left, const auto& right) { return left.first < right.first; });
+
+    size_t stack_modules = std::count_if(ranked.begin(), ranked.end(), [&stack_offsets](const auto& module) {
+        return module.first < stack_offsets.size();
+    });
+    modules->reserve(ranked.size());
+    for (auto& module : ranked) {
+        modules->push_back(std::move(module.second));
+    }
+
+    std::lock_guard<std::mutex> lock(status_mutex_);
+    status_.total = modules->size();
+    status_.stack_modules = stack_modules;
+    return true;
+}
+
+/**
+ * @brief Loads one module's symbols.
+ *
+ * The worker debugger opens the module's image file by itself and loads its
+ * symbols, which leaves them in the downstream store of the symbol path.
+ * Images that are not on this machine, as for many dumps, skip straight to
+ * the engine, which downloads them itself.
+ *
+ * @param[in] module Module to load
+ * @param[in] options Whether to prefetch, and the limits to do it with
+ * @param[in] symbol_path Symbol path the worker downloads with
+ *
+ * @return true if the engine loaded the symbols
+ */
+bool SymbolLoader::load_module(
+    _In_ const PlannedModule& module,
+    _In_ const SymbolLoadOptions& options,
+    _In_ const std::string& symbol_path) {
+
+    if (options.prefetch && !module.image_name.empty() &&
+        GetFileAttributesA(module.image_name.c_str()) != INVALID_FILE_ATTRIBUTES) {
+        DumpAnalysisOptions prefetch;
+        prefetch.commands = {".reload /f"};
+        prefetch.symbol_path = symbol_path;
+        prefetch.max_parallel = 1;
+        prefetch.timeout_per_dump = std::chrono::milliseconds(Constants::SYMBOL_PREFETCH_TIMEOUT_MS);
+        prefetch.cancel_event = cancel_event_.get();
+
+        std::string error_message;
+        auto results = DumpAnalyzer::analyze({module.image_name}, prefetch, &error_message);
+        if (!results.empty() && results.front().success) {
+            std::lock_guard<std::mutex> lock(status_mutex_);
+            ++status_.prefetched;
+            MetricsRegistry::instance().increment(MetricsRegistry::Counter::SymbolPrefetches);
+        } else if (!results.empty()) {
+            error_message = results.front().error_message;
+        }
+        if (!error_message.empty()) {
+            LOG_DEBUG("SymbolLoader", "Prefetch of " + module.name + " failed: " + error_message);
+        }
+    }
+    if (cancelled_.load()) {
+        return false;
+    }
+
+    HRESULT hr = E_FAIL;
+    bool ran = command_executor_->execute_on_engine(CommandPriority::Background, [&] {
+        hr = WinDbgHelpers::reload_module_symbols(module.name);
+    });
+    if (!ran || FAILED(hr)) {
+        return false;
+    }
+
+    // Output cached before the load was written without these symbols
+    command_executor_->invalidate_cache();
+    return true;
+}
+
+void SymbolLoader::finish(std::string error_message) {
+    {
+        std::lock_guard<std::mutex> lock(status_mutex_);
+        status_.running = false;
+        status_.cancelled = cancelled_.load();
+        status_.error_message = std::move(error_message);
+        status_.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - started_);
+    }
+    LOG_INFO("SymbolLoader", "Symbol load finished");
+    publish_progress({});
+}
+
+// The pipe server keeps only the latest progress event for a client that has
+// not caught up, so one per module is cheap
+void SymbolLoader::publish_progress(std::string_view module) {
+    std::lock_guard<std::mutex> lock(publisher_mutex_);
+    if (!publisher_) {
+        return;
+    }
+    publisher_(communication::EventKind::SymbolLoad, [this, module]() {
+        nlohmann::json data = status_json(get_status());
+        if (!module.empty()) {
+            data["module"] = module;
+        }
+        return data;
+    });
+}
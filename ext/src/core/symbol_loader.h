@@ -0,0 +1,113 @@
+#pragma once
+
+#include "../pch.h"
+#include "../../inc/command_executor.h"
+#include "../../inc/handle_wrapper.h"
+#include "../../inc/message_protocol.h"
+#include "../utils/constants.h"
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace vibedbg::core {
+
+struct SymbolLoadOptions {
+    std::vector<std::string> modules;   // Empty: every loaded module whose symbols are still deferred
+    std::string symbol_path;            // Empty: the engine's symbol path
+    size_t max_parallel{0};             // Prefetch workers; zero: one per core, at most MAX_PARALLEL_SYMBOL_PREFETCH
+    bool prefetch{true};                // Download symbol files in worker debuggers before the engine loads them
+};
+
+struct SymbolLoadStatus {
+    uint64_t job{0};                    // Counts the loads started; 0 before the first
+    bool running{false};
+    bool cancelled{false};
+    size_t total{0};                    // Modules to load; known once the load is planned
+    size_t stack_modules{0};            // Modules on the current thread's stack, loaded first
+    size_t loaded{0};
+    size_t failed{0};
+    size_t prefetched{0};               // Symbol files a worker downloaded ahead of the engine
+    std::vector<std::string> failures;  // Modules whose symbols could not be loaded
+    std::string error_message;          // Why the load stopped before it was planned
+    std::chrono::milliseconds elapsed{0};
+};
+
+/**
+ * @class SymbolLoader
+ * @brief Loads module symbols in the background, stack modules first.
+ *
+ * A load is planned with one quick engine job that reads the module list and
+ * the current thread's stack offsets. Modules are then taken in priority
+ * order by a pool of workers. Each worker first downloads the module's
+ * symbol files into the symbol cache in a worker debugger process, so the
+ * downloads from cold symbol servers run side by side. Then it has the
+ * engine load the symbols, which mostly reads them from the cache.
+ *
+ * DbgEng loads symbols on the engine thread only. Each module is a job of
+ * its own in the background lane, so commands other clients send run
+ * between modules rather than after the whole load.
+ */
+class SymbolLoader {
+public:
+    using EventPublisher = std::function<void(communication::EventKind, const std::function<nlohmann::json()>&)>;
+
+    explicit SymbolLoader(std::shared_ptr<CommandExecutor> command_executor);
+    ~SymbolLoader();
+
+    SymbolLoader(const SymbolLoader&) = delete;
+    SymbolLoader& operator=(const SymbolLoader&) = delete;
+
+    /**
+     * @brief Starts a background load and returns at once.
+     *
+     * @param[in] options Modules, symbol path and prefetch workers
+     * @param[out] error_message Set if a load is already running
+     * @return true if the load was started
+     */
+    bool start(const SymbolLoadOptions& options, std::string* error_message);
+
+    /**
+     * @brief Stops the running load; modules already loaded keep their symbols.
+     */
+    void cancel();
+
+    SymbolLoadStatus get_status() const;
+    static nlohmann::json status_json(const SymbolLoadStatus& status);
+
+    // Progress goes out as symbol_load events; nullptr stops publishing and
+    // returns once no event is being published
+    void set_event_publisher(EventPublisher publisher);
+
+private:
+    struct PlannedModule {
+        std::string name;
+        std::string image_name;
+    };
+
+    std::shared_ptr<CommandExecutor> command_executor_;
+
+    std::mutex start_mutex_;            // Serializes start and the destructor
+    std::thread worker_;
+    std::atomic<bool> cancelled_{false};
+    utils::HandleWrapper cancel_event_; // Terminates running prefetch workers
+
+    mutable std::mutex status_mutex_;
+    SymbolLoadStatus status_;
+    std::chrono::steady_clock::time_point started_;
+
+    std::mutex publisher_mutex_;
+    EventPublisher publisher_;
+
+    void run(SymbolLoadOptions options);
+    bool plan(const SymbolLoadOptions& options, std::vector<PlannedModule>* modules, std::string* symbol_path);
+    bool load_module(const PlannedModule& module, const SymbolLoadOptions& options, const std::string& symbol_path);
+    void finish(std::string error_message = {});
+    void publish_progress(std::string_view module);
+};
+
+} // namespace vibedbg::core
@@ -1,5 +1,7 @@
 #include "pch.h"
 #include "core/extension_impl.h"
+#include "utils/metrics.h"
+#include "../inc/request_tracing.h"
 
 using namespace vibedbg::core;
 using namespace vibedbg::constants;
@@ -87,6 +89,10 @@ extern "C" HRESULT CALLBACK DebugExtensionInitialize(
         OutputDebugStringA("VibeDbg: Unknown exception during ExtensionApis initialization\n");
     }
     
+    // Registered at load rather than on connect, so a trace can be running
+    // before the first client arrives
+    vibedbg::utils::RequestTracing::register_provider();
+    
     *version = DEBUG_EXTENSION_VERSION(1, 0);
     *flags = 0;
     
@@ -116,6 +122,9 @@ extern "C" void CALLBACK DebugExtensionUninitialize() {
         OutputDebugStringA("VibeDbg: Unknown exception during extension shutdown\n");
     }
     
+    // The provider's callbacks must be gone before the DLL unloads
+    vibedbg::utils::RequestTracing::unregister_provider();
+    
     // Cleanup logging system
     try {
         vibedbg::logging::Logger::Cleanup();
@@ -146,7 +155,8 @@ extern "C" void CALLBACK DebugExtensionUninitialize() {
  * @return HRESULT S_OK on success, E_FAIL on failure
  * 
  * @note This command initializes the logging system and creates the named
- *       pipe server for MCP client communication.
+ *       pipe server for MCP client communication. It is the only command
+ *       that starts the pipe server.
  */
 STDAPI vibedbg_connect(
     _In_opt_ IDebugClient* client, 
@@ -159,7 +169,7 @@ STDAPI vibedbg_connect(
         
         auto& extension = ExtensionImpl::get_instance();
         
-        if (extension.is_initialized()) {
+        if (extension.is_serving()) {
             LOG_WINDBG("Connect", "Already connected");
             return S_OK;
         }
@@ -167,8 +177,12 @@ STDAPI vibedbg_connect(
         LOG_WINDBG("Connect", "Initializing VibeDbg extension...");
         LOG_INFO("Connect", "Starting extension initialization");
         
-        // Try to initialize with basic components first
-        auto result = extension.initialize(client);
+        // "!vibedbg_execute" may have initialized the core already; only the
+        // servers are left to start then
+        auto result = extension.is_initialized() ? ExtensionError::None : extension.initialize(client);
+        if (result == ExtensionError::None) {
+            result = extension.start_communication();
+        }
         if (result == ExtensionError::None) {
             LOG_WINDBG("Connect", "Connected successfully");
             LOG_INFO("Connect", "Extension initialized successfully");
@@ -261,7 +275,7 @@ STDAPI vibedbg_status(
             return S_OK;
         }
         
-        LOG_WINDBG("Status", "Connected");
+        LOG_WINDBG("Status", extension.is_serving() ? "Connected" : "Initialized, pipe server not started");
         
         // Show basic statistics safely
         auto stats = extension.get_stats();
@@ -273,6 +287,12 @@ STDAPI vibedbg_status(
         LOG_WINDBG("Status", "Successful: " + std::to_string(stats.successful_commands));
         LOG_WINDBG("Status", "Failed: " + std::to_string(stats.failed_commands));
         LOG_WINDBG("Status", "Total connections: " + std::to_string(stats.total_connections));
+        LOG_WINDBG("Status", "Symbol cache: " + std::to_string(stats.symbol_cache_hits) + " hits, " +
+                             std::to_string(stats.symbol_cache_misses) + " misses");
+        LOG_WINDBG("Status", "Init: interfaces " + std::to_string(stats.interfaces_init_time.count()) +
+                             " us, components " + std::to_string(stats.components_init_time.count()) +
+                             " us, communication " + std::to_string(stats.communication_init_time.count()) + " us");
+        LOG_WINDBG("Status", "Engine thread: " + std::string(stats.engine_thread_started ? "Started" : "Not started"));
         
         // Show pipe server status safely
         if (auto* pipe_server = extension.get_pipe_server()) {
@@ -280,6 +300,9 @@ STDAPI vibedbg_status(
                 auto pipe_stats = pipe_server->get_stats();
                 LOG_WINDBG("Status", "Pipe connections: " + std::to_string(pipe_stats.active_connections) + " active");
                 LOG_WINDBG("Status", "Pipe messages: " + std::to_string(pipe_stats.total_messages_processed) + " processed");
+                LOG_WINDBG("Status", "Pipe admission: " + std::to_string(pipe_stats.queued_requests) + " queued, " +
+                                     std::to_string(pipe_stats.rejected_requests) + " requests and " +
+                                     std::to_string(pipe_stats.rejected_connections) + " connections refused busy");
             } catch (...) {
                 LOG_WINDBG("Status", "Pipe server status: Error reading stats");
             }
@@ -291,10 +314,10 @@ STDAPI vibedbg_status(
         if (auto session_manager = extension.get_session_manager()) {
             try {
                 auto session_state = session_manager->get_state();
-                LOG_WINDBG("Status", "Target connected: " + std::string(session_state.is_connected ? "Yes" : "No"));
+                LOG_WINDBG("Status", "Target connected: " + std::string(session_state->is_connected ? "Yes" : "No"));
                 
-                if (session_state.current_process) {
-                    LOG_WINDBG("Status", "Current process: " + session_state.current_process->process_name + " (PID: " + std::to_string(session_state.current_process->process_id) + ")");
+                if (session_state->current_process) {
+                    LOG_WINDBG("Status", "Current process: " + session_state->current_process->process_name + " (PID: " + std::to_string(session_state->current_process->process_id) + ")");
                 }
             } catch (...) {
                 LOG_WINDBG("Status", "Session state: Error reading state");
@@ -316,6 +339,74 @@ STDAPI vibedbg_status(
     return S_OK;
 }
 
+/**
+ * @brief Shows where request latency goes, from the extension's metrics registry.
+ * 
+ * Prints the request counters, p50/p90/p99 of each request stage (scheduler
+ * queue wait, engine time, serialization, pipe write) and the commands that
+ * took the most engine time. "!vibedbg_stats reset" clears the registry.
+ * 
+ * @param[in] client WinDbg debug client interface (unused)
+ * @param[in] args "reset" to clear the metrics, otherwise unused
+ * 
+ * @return HRESULT S_OK on success, E_FAIL on failure
+ */
+STDAPI vibedbg_stats(
+    _In_opt_ IDebugClient* client, 
+    _In_opt_ PCSTR args) {
+    UNREFERENCED_PARAMETER(client);
+    
+    using vibedbg::utils::MetricsRegistry;
+    constexpr size_t MAX_COMMANDS_SHOWN = 20;
+    
+    try {
+        auto& registry = MetricsRegistry::instance();
+        if (args && std::string_view(args).find("reset") != std::string_view::npos) {
+            registry.reset();
+            LOG_WINDBG("Stats", "Metrics reset");
+            return S_OK;
+        }
+        
+        auto snapshot = registry.snapshot();
+        dprintf("Uptime: %llu seconds\n", static_cast<unsigned long long>(snapshot.uptime.count() / 1000));
+        
+        dprintf("\nCounters:\n");
+        for (size_t i = 0; i < MetricsRegistry::COUNTER_COUNT; ++i) {
+            auto name = MetricsRegistry::counter_name(static_cast<MetricsRegistry::Counter>(i));
+            dprintf("%s\n", std::format("  {:<30}{:>14}", name, snapshot.counters[i]).c_str());
+        }
+        
+        auto print_latency = [](std::string_view name, uint64_t failures, const vibedbg::utils::HdrHistogram::Summary& summary) {
+            uint64_t mean = summary.count > 0 ? summary.total_us / summary.count : 0;
+            dprintf("%s\n", std::format("  {:<20}{:>10}{:>10}{:>12}{:>12}{:>12}{:>12}{:>12}",
+                                        name, summary.count, failures, mean, summary.p50_us,
+                                        summary.p90_us, summary.p99_us, summary.max_us).c_str());
+        };
+        std::string header = std::format("  {:<20}{:>10}{:>10}{:>12}{:>12}{:>12}{:>12}{:>12}",
+                                         "", "count", "failed", "mean us", "p50 us", "p90 us", "p99 us", "max us");
+        
+        dprintf("\nStages:\n%s\n", header.c_str());
+        for (size_t i = 0; i < MetricsRegistry::STAGE_COUNT; ++i) {
+            print_latency(MetricsRegistry::stage_name(static_cast<MetricsRegistry::Stage>(i)), 0, snapshot.stages[i]);
+        }
+        
+        dprintf("\nCommands by engine time:\n%s\n", header.c_str());
+        size_t shown = (std::min)(snapshot.commands.size(), MAX_COMMANDS_SHOWN);
+        for (size_t i = 0; i < shown; ++i) {
+            const auto& command = snapshot.commands[i];
+            print_latency(command.command, command.failures, command.latency);
+        }
+        if (snapshot.commands.size() > shown) {
+            dprintf("  ... %zu more\n", snapshot.commands.size() - shown);
+        }
+    } catch (const std::exception& e) {
+        LOG_WINDBG("Stats", "Error reading metrics: " + std::string(e.what()));
+        return E_FAIL;
+    }
+    
+    return S_OK;
+}
+
 /**
  * @brief Executes a WinDbg command through the VibeDbg extension.
  * 
@@ -328,21 +419,24 @@ STDAPI vibedbg_status(
  * 
  * @return HRESULT S_OK on success, E_FAIL on failure, E_INVALIDARG if no command provided
  * 
- * @note This command requires the extension to be connected via vibedbg_connect.
- *       The command is executed through the extension's command executor which
- *       provides additional safety and logging.
+ * @note The first call initializes the extension without starting the pipe
+ *       server, so scripted runs pay only for what they use. The command is
+ *       executed through the extension's command executor which provides
+ *       additional safety and logging.
  */
 STDAPI vibedbg_execute(
     _In_opt_ IDebugClient* client, 
     _In_opt_ PCSTR args) {
-    UNREFERENCED_PARAMETER(client);
-    
     try {
         auto& extension = ExtensionImpl::get_instance();
         
         if (!extension.is_initialized()) {
-            LOG_WINDBG("Execute", "Not connected. Use 'vibedbg_connect' first.");
-            return E_FAIL;
+            vibedbg::logging::Logger::Initialize("VibeDbg");
+            auto init_error = extension.initialize(client);
+            if (init_error != ExtensionError::None && init_error != ExtensionError::AlreadyInitialized) {
+                LOG_WINDBG("Execute", "Failed to initialize (error code: " + std::to_string(static_cast<int>(init_error)) + ")");
+                return E_FAIL;
+            }
         }
         
         if (!args || strlen(args) == 0) {
@@ -418,6 +512,7 @@ STDAPI vibedbg_help(
     LOG_WINDBG("Help", "  vibedbg_connect     - Initialize VibeDbg extension");
     LOG_WINDBG("Help", "  vibedbg_disconnect  - Shutdown VibeDbg extension");
     LOG_WINDBG("Help", "  vibedbg_status      - Show extension status");
+    LOG_WINDBG("Help", "  vibedbg_stats [reset] - Show latency metrics, or clear them");
     LOG_WINDBG("Help", "  vibedbg_execute <cmd> - Execute a WinDbg command through VibeDbg");
     LOG_WINDBG("Help", "  vibedbg_version     - Show version information");
     LOG_WINDBG("Help", "  vibedbg_help        - Show this help");
@@ -0,0 +1,220 @@
+#include "pch.h"
+#include "capture_session.h"
+#include "../core/extension_impl.h"
+#include "../core/request_context.h"
+#include "../../inc/request_tracing.h"
+#include <atomic>
+#include <vector>
+
+using namespace vibedbg::utils;
+using namespace vibedbg::core;
+
+namespace {
+
+    // Sessions live in thread_local storage but hold interfaces derived from
+    // the extension's client, so the registry lets shutdown_all() release all
+    // of them. Bumping the epoch makes every thread build a fresh session.
+    std::mutex registry_mutex;
+    std::vector<std::weak_ptr<CaptureSession>> registry;
+    std::atomic<uint64_t> registry_epoch{1};
+
+} // namespace
+
+CaptureSession::~CaptureSession() {
+    release_interfaces();
+}
+
+/**
+ * @brief Gets the capture session of the calling thread, creating it on first use.
+ *
+ * @param[out] hr Receives the failure code when the session cannot be created
+ *
+ * @return Session for the calling thread, or nullptr if the debugger is unavailable
+ */
+CaptureSession* CaptureSession::for_current_thread(_Out_opt_ HRESULT* hr) {
+    if (hr) *hr = S_OK;
+
+    thread_local std::shared_ptr<CaptureSession> session;
+
+    uint64_t epoch = registry_epoch.load();
+    if (session && session->epoch_ == epoch) {
+        return session.get();
+    }
+    session.reset();
+
+    IDebugClient* source_client = ExtensionImpl::get_instance().get_debug_client();
+    if (!source_client) {
+        if (hr) *hr = E_FAIL;
+        return nullptr;
+    }
+
+    std::shared_ptr<CaptureSession> fresh(new CaptureSession());
+    HRESULT result = fresh->initialize(source_client);
+    if (FAILED(result)) {
+        LOG_ERROR_DETAIL("CaptureSession", "Failed to create capture client", "HRESULT: " + std::to_string(result));
+        if (hr) *hr = result;
+        return nullptr;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        // A shutdown that ran while we were creating the client has already
+        // swept the registry, so this session would never be released
+        if (registry_epoch.load() != epoch) {
+            if (hr) *hr = E_FAIL;
+            return nullptr;
+        }
+        std::erase_if(registry, [](const auto& entry) { return entry.expired(); });
+        registry.push_back(fresh);
+    }
+
+    fresh->epoch_ = epoch;
+    session = std::move(fresh);
+    return session.get();
+}
+
+/**
+ * @brief Releases the debugger interfaces held by every session.
+ *
+ * Sessions stay allocated until their owning thread exits but no longer
+ * reference the debugger; the epoch change makes them rebuild on next use.
+ */
+void CaptureSession::shutdown_all() {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    registry_epoch.fetch_add(1);
+
+    for (auto& entry : registry) {
+        if (auto session = entry.lock()) {
+            std::lock_guard<std::mutex> session_lock(session->mutex_);
+            session->release_interfaces();
+        }
+    }
+    registry.clear();
+}
+
+/**
+ * @brief Executes a command on the session's client and collects its output.
+ *
+ * @param[in] command Command to execute
+ * @param[in] output_sink Optional sink receiving output while the command runs
+ * @param[in] output_filter Optional filter the output goes through before it is kept
+ * @param[in] output_mask Output classes to capture (DEBUG_OUTPUT_*)
+ * @param[out] streamed_bytes Receives the number of bytes handed to the sink
+ * @param[out] hr Receives the result of IDebugControl::Execute
+ *
+ * @return Output that was not delivered through the sink, including the
+ *         partial output of a command that failed or was interrupted
+ */
+std::string CaptureSession::execute(
+    _In_ std::string_view command,
+    _In_ const OutputSink& output_sink,
+    _In_opt_ std::shared_ptr<const OutputFilter> output_filter,
+    _In_ ULONG output_mask,
+    _Out_opt_ size_t* streamed_bytes,
+    _Out_opt_ HRESULT* hr) {
+
+    if (hr) *hr = S_OK;
+    if (streamed_bytes) *streamed_bytes = 0;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!debug_control_ || !output_capture_) {
+        if (hr) *hr = E_FAIL;
+        return "";
+    }
+
+    if (output_mask != output_mask_) {
+        HRESULT result = debug_client_->SetOutputMask(output_mask);
+        if (FAILED(result)) {
+            if (hr) *hr = result;
+            return "";
+        }
+        output_mask_ = output_mask;
+    }
+
+    output_capture_->Reset(output_sink, std::move(output_filter));
+
+    auto* context = RequestContext::current();
+    std::string_view request_id = context ? std::string_view(context->request_id) : std::string_view();
+
+    std::string command_str(command);
+    TraceActivity execute_activity(TraceStage::Execute, request_id);
+    HRESULT result = debug_control_->Execute(DEBUG_OUTCTL_THIS_CLIENT,
+                                             command_str.c_str(),
+                                             DEBUG_EXECUTE_DEFAULT);
+    if (FAILED(result)) {
+        execute_activity.set_failed();
+    }
+    execute_activity.stop();
+
+    TraceActivity capture_activity(TraceStage::Capture, request_id);
+    output_capture_->Finish();
+    if (streamed_bytes) *streamed_bytes = output_capture_->GetStreamedBytes();
+    std::string output = output_capture_->TakeOutput();
+    capture_activity.stop();
+
+    // Drop the sink now; it refers to the request that is being served
+    output_capture_->Reset({});
+
+    if (hr) *hr = result;
+    return output;
+}
+
+/**
+ * @brief Creates the dedicated client and installs the output capture on it.
+ *
+ * @param[in] source_client Client the session's client is derived from
+ *
+ * @return HRESULT S_OK on success, the failing call's code otherwise
+ */
+HRESULT CaptureSession::initialize(_In_ IDebugClient* source_client) {
+    HRESULT hr = source_client->CreateClient(&debug_client_);
+    if (FAILED(hr)) {
+        debug_client_ = nullptr;
+        return hr;
+    }
+
+    hr = debug_client_->QueryInterface(__uuidof(IDebugControl), (void**)&debug_control_);
+    if (FAILED(hr)) {
+        release_interfaces();
+        return hr;
+    }
+
+    output_capture_ = new OutputCapture();
+    hr = debug_client_->SetOutputCallbacks(output_capture_);
+    if (FAILED(hr)) {
+        release_interfaces();
+        return hr;
+    }
+
+    hr = debug_client_->GetOutputMask(&output_mask_);
+    if (FAILED(hr)) {
+        release_interfaces();
+        return hr;
+    }
+
+    return S_OK;
+}
+
+/**
+ * @brief Uninstalls the capture and releases the session's interfaces.
+ */
+void CaptureSession::release_interfaces() {
+    if (debug_client_) {
+        debug_client_->SetOutputCallbacks(nullptr);
+    }
+
+    if (output_capture_) {
+        output_capture_->Release();
+        output_capture_ = nullptr;
+    }
+
+    if (debug_control_) {
+        debug_control_->Release();
+        debug_control_ = nullptr;
+    }
+
+    if (debug_client_) {
+        debug_client_->Release();
+        debug_client_ = nullptr;
+    }
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "../pch.h"
+#include "output_capture.h"
+#include "../../inc/command_executor.h"
+#include <string>
+#include <string_view>
+#include <memory>
+#include <mutex>
+
+namespace vibedbg::utils {
+
+/**
+ * @class CaptureSession
+ * @brief Dedicated debug client with a persistent output capture installed.
+ *
+ * Each thread that executes commands gets its own client, created from the
+ * extension's client with CreateClient, so installing callbacks never races
+ * with WinDbg's own output or with other threads. The capture is installed
+ * once and reset between commands, which keeps its buffer allocated instead
+ * of creating, installing and restoring a callback object per command.
+ */
+class CaptureSession {
+public:
+    ~CaptureSession();
+
+    CaptureSession(const CaptureSession&) = delete;
+    CaptureSession& operator=(const CaptureSession&) = delete;
+
+    /**
+     * @brief Gets the capture session of the calling thread, creating it on first use.
+     *
+     * @param[out] hr Receives the failure code when the session cannot be created
+     * @return Session for the calling thread, or nullptr if the debugger is unavailable
+     */
+    static CaptureSession* for_current_thread(HRESULT* hr = nullptr);
+
+    /**
+     * @brief Releases the debugger interfaces held by every session.
+     *
+     * Called when the extension releases its own interfaces; sessions are
+     * recreated lazily if the extension is initialized again.
+     */
+    static void shutdown_all();
+
+    /**
+     * @brief Executes a command and returns the output that was not streamed.
+     *
+     * @param[in] command Command to execute
+     * @param[in] output_sink Optional sink receiving output while the command runs
+     * @param[in] output_filter Optional filter the output goes through before it is kept
+     * @param[in] output_mask Output classes to capture (DEBUG_OUTPUT_*)
+     * @param[out] streamed_bytes Receives the number of bytes handed to the sink
+     * @param[out] hr Receives the result of IDebugControl::Execute
+     * @return Captured output, also when the command failed or was interrupted
+     */
+    std::string execute(std::string_view command,
+                        const core::OutputSink& output_sink = {},
+                        std::shared_ptr<const OutputFilter> output_filter = nullptr,
+                        ULONG output_mask = DEBUG_OUTPUT_NORMAL,
+                        size_t* streamed_bytes = nullptr,
+                        HRESULT* hr = nullptr);
+
+private:
+    CaptureSession() = default;
+
+    HRESULT initialize(IDebugClient* source_client);
+    void release_interfaces();
+
+    IDebugClient* debug_client_{nullptr};
+    IDebugControl* debug_control_{nullptr};
+    OutputCapture* output_capture_{nullptr};
+    ULONG output_mask_{0};
+    uint64_t epoch_{0};
+    std::mutex mutex_;
+};
+
+} // namespace vibedbg::utils
@@ -59,7 +59,7 @@ std::string CommandUtils::normalize_command(std::string_view command) {
     return trim(command);
 }
 
-std::string CommandUtils::format_success_message(std::string_view command, const std::string& output) {
+std::string CommandUtils::format_success_message(std::string_view command, std::string output) {
     if (output.empty()) {
         if (is_empty_result_expected(command)) {
             return "Command executed successfully";
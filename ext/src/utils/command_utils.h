@@ -20,7 +20,7 @@ public:
     static std::string normalize_command(std::string_view command);
     
     // Result formatting
-    static std::string format_success_message(std::string_view command, const std::string& output);
+    static std::string format_success_message(std::string_view command, std::string output);
     static std::string format_error_message(const std::string& error, const std::string& context = "");
     
     // String utilities
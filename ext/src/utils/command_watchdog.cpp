@@ -0,0 +1,125 @@
+#include "pch.h"
+#include "command_watchdog.h"
+#include "windbg_helpers.h"
+
+using namespace vibedbg::utils;
+
+CommandWatchdog& CommandWatchdog::instance() {
+    static CommandWatchdog watchdog;
+    return watchdog;
+}
+
+/**
+ * @brief Arms a deadline for the command about to run on the calling thread.
+ *
+ * @param[in] timeout Time the command may run; zero or negative arms nothing
+ *
+ * @return Guard that keeps the deadline armed
+ */
+CommandWatchdog::Guard CommandWatchdog::arm(_In_ std::chrono::milliseconds timeout) {
+    if (timeout.count() <= 0) {
+        return Guard();
+    }
+
+    auto deadline = std::make_shared<Deadline>();
+    deadline->at = std::chrono::steady_clock::now() + timeout;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!thread_.joinable()) {
+        stopping_ = false;
+        thread_ = std::thread(&CommandWatchdog::watch_loop, this);
+    }
+
+    // Only a new earliest deadline changes how long the thread sleeps
+    bool earliest = deadlines_.empty() || deadline->at < deadlines_.begin()->first;
+    deadlines_.emplace(deadline->at, deadline);
+    if (earliest) {
+        cv_.notify_one();
+    }
+    return Guard(std::move(deadline));
+}
+
+/**
+ * @brief Stops the watchdog thread; armed deadlines no longer fire.
+ */
+void CommandWatchdog::shutdown() {
+    std::thread thread;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+        deadlines_.clear();
+        thread = std::move(thread_);
+    }
+    cv_.notify_one();
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+bool CommandWatchdog::Guard::disarm() {
+    if (deadline_) {
+        fired_ = instance().disarm(deadline_);
+        deadline_.reset();
+    }
+    return fired_;
+}
+
+/**
+ * @brief Removes a deadline and reports whether it fired.
+ *
+ * Firing and removal both happen under the mutex, so a command that
+ * finishes just before its deadline never sees a late interrupt.
+ *
+ * @param[in] deadline Deadline created by arm()
+ *
+ * @return true if the watchdog interrupted the command
+ */
+bool CommandWatchdog::disarm(_In_ const std::shared_ptr<Deadline>& deadline) {
+    bool fired = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        fired = deadline->fired;
+        auto [first, last] = deadlines_.equal_range(deadline->at);
+        for (auto it = first; it != last; ++it) {
+            if (it->second == deadline) {
+                deadlines_.erase(it);
+                break;
+            }
+        }
+    }
+
+    if (fired) {
+        WinDbgHelpers::clear_interrupt();
+    }
+    return fired;
+}
+
+/**
+ * @brief Watchdog thread body: sleeps until the earliest deadline and interrupts the engine.
+ */
+void CommandWatchdog::watch_loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+        if (deadlines_.empty()) {
+            cv_.wait(lock);
+            continue;
+        }
+
+        auto earliest = deadlines_.begin()->first;
+        if (std::chrono::steady_clock::now() < earliest) {
+            cv_.wait_until(lock, earliest);
+            continue;
+        }
+
+        // The guard still holds each expired deadline, so disarm() can
+        // report it after it leaves the map
+        auto now = std::chrono::steady_clock::now();
+        while (!deadlines_.empty() && deadlines_.begin()->first <= now) {
+            deadlines_.begin()->second->fired = true;
+            deadlines_.erase(deadlines_.begin());
+        }
+
+        LOG_WARNING("CommandWatchdog", "Command deadline passed, interrupting the engine");
+        WinDbgHelpers::interrupt_execution();
+    }
+}
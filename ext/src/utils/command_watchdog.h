@@ -0,0 +1,96 @@
+#pragma once
+
+#include "../pch.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace vibedbg::utils {
+
+/**
+ * @class CommandWatchdog
+ * @brief Interrupts the debugger engine when a command outlives its deadline.
+ *
+ * IDebugControl::Execute has no timeout of its own and blocks the thread
+ * that called it, so deadlines are watched from a separate thread that calls
+ * SetInterrupt when one passes. The running command then returns as if
+ * Ctrl+Break had been pressed, with whatever output it produced so far.
+ *
+ * The thread starts on the first arm() and is stopped by shutdown(), which
+ * the extension calls before releasing its debugger interfaces.
+ */
+class CommandWatchdog {
+    struct Deadline {
+        std::chrono::steady_clock::time_point at;
+        bool fired{false}; // Guarded by the watchdog mutex
+    };
+
+public:
+    /**
+     * @class Guard
+     * @brief Keeps a deadline armed for as long as it is alive.
+     */
+    class Guard {
+    public:
+        Guard() = default;
+        ~Guard() { disarm(); }
+
+        // The source is left empty, so its destructor disarms nothing
+        Guard(Guard&& other) noexcept
+            : deadline_(std::exchange(other.deadline_, nullptr)), fired_(std::exchange(other.fired_, false)) {}
+        Guard& operator=(Guard&&) = delete;
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+        /**
+         * @brief Removes the deadline.
+         *
+         * A deadline that already fired leaves an interrupt pending in the
+         * engine; it is cleared here so the next command does not inherit it.
+         *
+         * @return true if the deadline fired before it was removed
+         */
+        bool disarm();
+
+    private:
+        friend class CommandWatchdog;
+        explicit Guard(std::shared_ptr<Deadline> deadline) : deadline_(std::move(deadline)) {}
+
+        std::shared_ptr<Deadline> deadline_;
+        bool fired_{false};
+    };
+
+    static CommandWatchdog& instance();
+
+    /**
+     * @brief Arms a deadline for the command about to run on the calling thread.
+     *
+     * @param[in] timeout Time the command may run; zero or negative arms nothing
+     * @return Guard that keeps the deadline armed
+     */
+    Guard arm(std::chrono::milliseconds timeout);
+
+    /**
+     * @brief Stops the watchdog thread; armed deadlines no longer fire.
+     */
+    void shutdown();
+
+private:
+    CommandWatchdog() = default;
+
+    bool disarm(const std::shared_ptr<Deadline>& deadline);
+    void watch_loop();
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::multimap<std::chrono::steady_clock::time_point, std::shared_ptr<Deadline>> deadlines_;
+    std::thread thread_;
+    bool stopping_{false};
+};
+
+} // namespace vibedbg::utils
@@ -13,8 +13,56 @@ namespace Constants {
     
     // Performance settings
     constexpr size_t MAX_OUTPUT_SIZE = 1048576; // 1MB
+    constexpr size_t STREAM_CHUNK_SIZE = 65536; // 64KB flush threshold for streamed output
+    constexpr size_t CAPTURE_CHUNK_SIZE = STREAM_CHUNK_SIZE; // Capture arena chunk; each streamed chunk is one
+    constexpr size_t CAPTURE_BUFFER_RETAIN_SIZE = 262144; // 256KB capture buffer kept between commands
     constexpr size_t MAX_COMMAND_LENGTH = 4096;
     constexpr size_t MAX_MESSAGE_SIZE = 1048576; // 1MB
+    constexpr size_t MAX_MEMORY_READ_SIZE = 524288; // 512KB per memory request, base64 still fits a message
+    constexpr size_t MAX_SEARCH_HITS = 1024;
+    constexpr uint64_t MAX_MEMORY_SEARCH_LENGTH = 0x10000000; // 256MB per search, as s allows without L?
+    constexpr size_t MAX_BATCH_COMMANDS = 64;
+    constexpr size_t MAX_BATCH_OUTPUT_SIZE = 786432; // 768KB of command output per batch response
+    constexpr size_t MAX_GREP_PATTERN_LENGTH = 256;
+    constexpr size_t MAX_OUTPUT_FIELDS = 64; // Columns a line is split into for the fields filter
+    constexpr size_t DEFAULT_STACK_FRAMES = 256;
+    constexpr size_t MAX_STACK_FRAMES = 1024;
+    constexpr size_t SYMBOL_CACHE_ENTRIES = 16384; // Per direction, split across the cache shards
+    constexpr size_t MAX_DUMPS_PER_REQUEST = 64;
+    constexpr size_t MAX_PARALLEL_DUMPS = 8;
+    constexpr size_t MAX_DUMP_OUTPUT_SIZE = 262144; // 256KB of worker output kept per dump
+    constexpr unsigned int DUMP_ANALYSIS_TIMEOUT_MS = 600000;
+    constexpr size_t MAX_PARALLEL_SYMBOL_PREFETCH = 8;
+    constexpr unsigned int SYMBOL_PREFETCH_TIMEOUT_MS = 300000; // One module's symbol download in a worker
+    constexpr size_t MAX_SESSIONS = 256; // Saved client contexts; the least recently used is dropped
+    constexpr size_t MAX_SESSION_ID_LENGTH = 128;
+    constexpr size_t DEFAULT_DX_PAGE_SIZE = 100; // Collection elements a data model query returns per page
+    constexpr size_t MAX_DX_PAGE_SIZE = 1000;
+    constexpr unsigned int DEFAULT_DX_DEPTH = 1; // Levels expanded below the queried object, like "dx" without -r
+    constexpr unsigned int MAX_DX_DEPTH = 8;
+    constexpr size_t MAX_DX_NODES = 10000; // Objects described by one query, whatever the depth and page
+    constexpr size_t HEAP_SCAN_BLOCK_SIZE = 1048576; // Bytes one scan worker matches at a time
+    constexpr size_t HEAP_SCAN_BATCH_SIZE = 16777216; // Bytes read per engine job; other commands run between jobs
+    constexpr unsigned long long DEFAULT_HEAP_SCAN_BYTES = 4294967296; // Committed memory scanned unless the request sets max_bytes
+    constexpr size_t MAX_PARALLEL_HEAP_SCAN = 8;
+    constexpr size_t MAX_HEAP_SCAN_PATTERNS = 16;
+    constexpr size_t MAX_HEAP_SCAN_PATTERN_SIZE = 64;
+    constexpr size_t MAX_HEAP_SCAN_HITS = 16;    // Addresses kept per pattern
+    constexpr size_t DEFAULT_HEAP_SCAN_TOP = 50; // Histogram entries returned
+    constexpr size_t MAX_HEAP_SCAN_TOP = 1000;
+    constexpr size_t MAX_HEAP_SCAN_RESOLVED = 4096; // Distinct pointers resolved while looking for vtables
+    constexpr size_t MAX_HEAP_SCAN_OBJECT_SIZE = 65536; // Cap on the bytes estimate of one object
+    constexpr size_t MAX_DISASSEMBLY_RANGES = 128;
+    constexpr size_t DEFAULT_DISASSEMBLY_COUNT = 16; // Instructions per range, like "u"
+    constexpr size_t MAX_DISASSEMBLY_COUNT = 1024;
+    constexpr size_t MAX_DISASSEMBLY_INSTRUCTIONS = 8192; // Across every range of one request
+    constexpr size_t DEFAULT_FRAME_DISASSEMBLY_BEFORE = 8; // Instructions before each frame's offset, like "ub"
+    constexpr size_t DEFAULT_FRAME_DISASSEMBLY_COUNT = 8;
+    constexpr size_t MAX_DISASSEMBLY_BEFORE = 64;
+    constexpr size_t MAX_DISASSEMBLY_RANGE_BYTES = 65536; // Range given by an end address
+    constexpr size_t DISASSEMBLY_CACHE_INSTRUCTIONS = 262144; // Decoded instructions kept across modules
+    constexpr const char* DEFAULT_PREFETCH_COMMANDS = "r;k;~"; // Run after a stop when VIBEDBG_PREFETCH is "1"
+    constexpr size_t MAX_PREFETCH_COMMANDS = 8;
     
     // Server information
     constexpr const char* SERVER_VERSION = "VibeDbg v1.0.0";
@@ -0,0 +1,443 @@
+#include "pch.h"
+#include "data_model_query.h"
+#include "windbg_helpers.h"
+#include "../core/extension_impl.h"
+#include <DbgModel.h>
+#include <algorithm>
+
+using namespace vibedbg::utils;
+using namespace vibedbg::core;
+
+namespace {
+    std::string to_utf8(const wchar_t* text) {
+        if (!text || !*text) {
+            return {};
+        }
+        int size = WideCharToMultiByte(CP_UTF8, 0, text, -1, nullptr, 0, nullptr, nullptr);
+        if (size <= 1) {
+            return {};
+        }
+        std::string result(static_cast<size_t>(size - 1), '\0');
+        WideCharToMultiByte(CP_UTF8, 0, text, -1, result.data(), size, nullptr, nullptr);
+        return result;
+    }
+
+    std::wstring to_wide(std::string_view text) {
+        if (text.empty()) {
+            return {};
+        }
+        int size = MultiByteToWideChar(CP_UTF8, 0, text.data(), static_cast<int>(text.size()), nullptr, 0);
+        std::wstring result(static_cast<size_t>((std::max)(size, 0)), L'\0');
+        MultiByteToWideChar(CP_UTF8, 0, text.data(), static_cast<int>(text.size()), result.data(), size);
+        return result;
+    }
+
+    const char* kind_name(ModelObjectKind kind) {
+        switch (kind) {
+        case ObjectPropertyAccessor: return "property_accessor";
+        case ObjectContext: return "context";
+        case ObjectTargetObject: return "target_object";
+        case ObjectTargetObjectReference: return "target_object_reference";
+        case ObjectSynthetic: return "synthetic";
+        case ObjectNoValue: return "no_value";
+        case ObjectError: return "error";
+        case ObjectIntrinsic: return "intrinsic";
+        case ObjectMethod: return "method";
+        case ObjectKeyReference: return "key_reference";
+        default: return "unknown";
+        }
+    }
+
+    nlohmann::json intrinsic_json(const VARIANT& value) {
+        switch (value.vt) {
+        case VT_BOOL: return value.boolVal != VARIANT_FALSE;
+        case VT_I1: return static_cast<int64_t>(value.cVal);
+        case VT_I2: return static_cast<int64_t>(value.iVal);
+        case VT_I4: return static_cast<int64_t>(value.lVal);
+        case VT_I8: return static_cast<int64_t>(value.llVal);
+        case VT_UI1: return static_cast<uint64_t>(value.bVal);
+        case VT_UI2: return static_cast<uint64_t>(value.uiVal);
+        case VT_UI4: return static_cast<uint64_t>(value.ulVal);
+        case VT_UI8: return static_cast<uint64_t>(value.ullVal);
+        case VT_R4: return static_cast<double>(value.fltVal);
+        case VT_R8: return value.dblVal;
+        case VT_BSTR: return to_utf8(value.bstrVal);
+        default: return nullptr;
+        }
+    }
+
+    // Keys dx accepts after a dot; others, like "[Raw View]", have no path
+    bool is_identifier(std::string_view key) {
+        if (key.empty() || std::isdigit(static_cast<unsigned char>(key[0]))) {
+            return false;
+        }
+        return std::all_of(key.begin(), key.end(), [](char c) {
+            return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '$' || c == '@';
+        });
+    }
+
+    // The parent is parenthesized when a suffix would bind to part of it
+    std::string child_path(const std::string& parent, std::string_view suffix) {
+        if (parent.empty()) {
+            return {};
+        }
+        bool compound = parent.find_first_of(" +-*/%&|^=<>?,~") != std::string::npos;
+        return (compound ? "(" + parent + ")" : parent) + std::string(suffix);
+    }
+
+    std::string display_string(IModelObject* object) {
+        CComPtr<IUnknown> concept_unknown;
+        if (FAILED(object->GetConcept(__uuidof(IStringDisplayableConcept), &concept_unknown, nullptr))) {
+            return {};
+        }
+        CComPtr<IStringDisplayableConcept> displayable;
+        if (FAILED(concept_unknown->QueryInterface(__uuidof(IStringDisplayableConcept),
+                                                   reinterpret_cast<void**>(&displayable)))) {
+            return {};
+        }
+        CComBSTR text;
+        if (FAILED(displayable->ToDisplayString(object, nullptr, &text))) {
+            return {};
+        }
+        return to_utf8(text);
+    }
+
+    CComPtr<IIterableConcept> iterable_concept(IModelObject* object) {
+        CComPtr<IUnknown> concept_unknown;
+        CComPtr<IIterableConcept> iterable;
+        if (SUCCEEDED(object->GetConcept(__uuidof(IIterableConcept), &concept_unknown, nullptr))) {
+            concept_unknown->QueryInterface(__uuidof(IIterableConcept), reinterpret_cast<void**>(&iterable));
+        }
+        return iterable;
+    }
+
+    // Describes objects depth first until the node budget runs out
+    class ModelWalker {
+    public:
+        explicit ModelWalker(const DataModelQueryOptions& options) : options_(options) {}
+
+        nlohmann::json describe(IModelObject* object, const std::string& path, unsigned int depth, size_t offset);
+        bool truncated() const noexcept { return truncated_; }
+
+    private:
+        const DataModelQueryOptions& options_;
+        size_t nodes_left_ = Constants::MAX_DX_NODES;
+        bool truncated_ = false;
+
+        bool take_node() {
+            if (nodes_left_ == 0) {
+                truncated_ = true;
+                return false;
+            }
+            --nodes_left_;
+            return true;
+        }
+
+        bool has_children(IModelObject* object, ModelObjectKind kind);
+        void add_properties(IModelObject* object, const std::string& path, unsigned int depth, nlohmann::json* node);
+        void add_fields(IModelObject* object, const std::string& path, unsigned int depth, nlohmann::json* node);
+        void add_elements(IIterableConcept* iterable, IModelObject* object, const std::string& path,
+                          unsigned int depth, size_t offset, nlohmann::json* node);
+    };
+
+    nlohmann::json ModelWalker::describe(IModelObject* object, const std::string& path, unsigned int depth, size_t offset) {
+        nlohmann::json node = nlohmann::json::object();
+
+        // References are described as the object they refer to
+        CComPtr<IModelObject> current = object;
+        ModelObjectKind kind = ObjectNoValue;
+        current->GetKind(&kind);
+        if (kind == ObjectTargetObjectReference) {
+            CComPtr<IModelObject> referenced;
+            if (SUCCEEDED(current->Dereference(&referenced))) {
+                current = referenced;
+                current->GetKind(&kind);
+            }
+        }
+
+        node["kind"] = kind_name(kind);
+        if (!path.empty()) {
+            node["expression"] = path;
+        }
+
+        CComPtr<IDebugHostType> type;
+        if (SUCCEEDED(current->GetTypeInfo(&type)) && type) {
+            CComBSTR type_name;
+            if (SUCCEEDED(type->GetName(&type_name))) {
+                node["type"] = to_utf8(type_name);
+            }
+        }
+
+        if (kind == ObjectTargetObject) {
+            Location location;
+            if (SUCCEEDED(current->GetLocation(&location))) {
+                node["location"] = location.Offset;
+            }
+        }
+
+        if (kind == ObjectIntrinsic) {
+            CComVariant value;
+            if (SUCCEEDED(current->GetIntrinsicValue(&value))) {
+                auto intrinsic = intrinsic_json(value);
+                if (!intrinsic.is_null()) {
+                    node["value"] = std::move(intrinsic);
+                }
+            }
+            return node;
+        }
+
+        std::string display = display_string(current);
+        if (!display.empty()) {
+            node["display"] = std::move(display);
+        }
+        if (kind == ObjectError || kind == ObjectNoValue || kind == ObjectMethod) {
+            return node;
+        }
+
+        if (depth == 0) {
+            node["expandable"] = has_children(current, kind);
+            return node;
+        }
+
+        add_properties(current, path, depth - 1, &node);
+
+        // Native fields show when no visualizer supplied keys, as dx shows them
+        if (kind == ObjectTargetObject && (options_.raw || !node.contains("properties"))) {
+            add_fields(current, path, depth - 1, &node);
+        }
+
+        if (auto iterable = iterable_concept(current)) {
+            add_elements(iterable, current, path, depth - 1, offset, &node);
+        }
+        return node;
+    }
+
+    bool ModelWalker::has_children(IModelObject* object, ModelObjectKind kind) {
+        if (iterable_concept(object)) {
+            return true;
+        }
+        CComPtr<IKeyEnumerator> keys;
+        if (SUCCEEDED(object->EnumerateKeys(&keys))) {
+            CComBSTR key;
+            if (SUCCEEDED(keys->GetNext(&key, nullptr, nullptr))) {
+                return true;
+            }
+        }
+        if (kind == ObjectTargetObject) {
+            CComPtr<IRawEnumerator> fields;
+            if (SUCCEEDED(object->EnumerateRawValues(SymbolField, RawSearchNone, &fields))) {
+                CComBSTR name;
+                SymbolKind symbol_kind;
+                CComPtr<IModelObject> value;
+                return SUCCEEDED(fields->GetNext(&name, &symbol_kind, &value));
+            }
+        }
+        return false;
+    }
+
+    void ModelWalker::add_properties(IModelObject* object, const std::string& path, unsigned int depth,
+                                     nlohmann::json* node) {
+        // Property accessors are read as the keys are enumerated
+        CComPtr<IKeyEnumerator> keys;
+        if (FAILED(object->EnumerateKeyValues(&keys))) {
+            return;
+        }
+
+        nlohmann::json properties = nlohmann::json::array();
+        for (;;) {
+            CComBSTR key;
+            CComPtr<IModelObject> value;
+            if (FAILED(keys->GetNext(&key, &value, nullptr))) {
+                break;
+            }
+            ModelObjectKind kind = ObjectNoValue;
+            if (!value || (SUCCEEDED(value->GetKind(&kind)) && kind == ObjectMethod)) {
+                continue;
+            }
+            if (!take_node()) {
+                break;
+            }
+            std::string name = to_utf8(key);
+            auto child = describe(value, is_identifier(name) ? child_path(path, "." + name) : std::string(),
+                                  depth, 0);
+            child["name"] = std::move(name);
+            properties.push_back(std::move(child));
+        }
+        if (!properties.empty()) {
+            (*node)["properties"] = std::move(properties);
+        }
+    }
+
+    void ModelWalker::add_fields(IModelObject* object, const std::string& path, unsigned int depth,
+                                 nlohmann::json* node) {
+        CComPtr<IRawEnumerator> fields;
+        if (FAILED(object->EnumerateRawValues(SymbolField, RawSearchNone, &fields))) {
+            return;
+        }
+
+        nlohmann::json described = nlohmann::json::array();
+        for (;;) {
+            CComBSTR name;
+            SymbolKind symbol_kind;
+            CComPtr<IModelObject> value;
+            if (FAILED(fields->GetNext(&name, &symbol_kind, &value))) {
+                break;
+            }
+            if (!value) {
+                continue;
+            }
+            if (!take_node()) {
+                break;
+            }
+            std::string field = to_utf8(name);
+            auto child = describe(value, is_identifier(field) ? child_path(path, "." + field) : std::string(),
+                                  depth, 0);
+            child["name"] = std::move(field);
+            described.push_back(std::move(child));
+        }
+        if (!described.empty()) {
+            (*node)["fields"] = std::move(described);
+        }
+    }
+
+    void ModelWalker::add_elements(IIterableConcept* iterable, IModelObject* object, const std::string& path,
+                                   unsigned int depth, size_t offset, nlohmann::json* node) {
+        CComPtr<IModelIterator> iterator;
+        if (FAILED(iterable->GetIterator(object, &iterator))) {
+            return;
+        }
+
+        // Elements indexed by a single value get a path such as Threads[0x1a2c]
+        ULONG64 dimensions = 0;
+        if (FAILED(iterable->GetDefaultIndexDimensionality(object, &dimensions)) || dimensions != 1) {
+            dimensions = 0;
+        }
+
+        // The data model only iterates forward, so the elements before the
+        // page are stepped over without being described
+        size_t skipped = 0;
+        for (; skipped < offset; ++skipped) {
+            CComPtr<IModelObject> element;
+            if (FAILED(iterator->GetNext(&element, 0, nullptr, nullptr))) {
+                break;
+            }
+        }
+
+        nlohmann::json elements = nlohmann::json::array();
+        bool has_more = false;
+        for (;;) {
+            CComPtr<IModelObject> element;
+            CComPtr<IModelObject> indexer;
+            IModelObject* indexers[1] = {nullptr};
+            if (FAILED(iterator->GetNext(&element, dimensions, dimensions ? indexers : nullptr, nullptr))) {
+                break;
+            }
+            indexer.Attach(indexers[0]);
+            if (elements.size() >= options_.limit || !take_node()) {
+                has_more = true;
+                break;
+            }
+
+            nlohmann::json index;
+            std::string element_path;
+            if (indexer) {
+                CComVariant value;
+                if (SUCCEEDED(indexer->GetIntrinsicValue(&value))) {
+                    index = intrinsic_json(value);
+                }
+                if (index.is_number_integer() || index.is_number_unsigned()) {
+                    element_path = child_path(path, "[" + index.dump() + "]");
+                }
+            }
+            auto child = describe(element, element_path, depth, 0);
+            if (!index.is_null()) {
+                child["index"] = std::move(index);
+            }
+            elements.push_back(std::move(child));
+        }
+
+        (*node)["offset"] = skipped;
+        (*node)["elements"] = std::move(elements);
+        (*node)["has_more"] = has_more;
+        if (has_more) {
+            (*node)["next_offset"] = skipped + (*node)["elements"].size();
+        }
+    }
+}
+
+/**
+ * @brief Evaluates the expression in the current context and describes the result.
+ *
+ * The expression is evaluated the way dx evaluates it, with the extended
+ * syntax (@$curprocess, LINQ methods, NatVis views). The result node is
+ * expanded options.depth levels; its own collection starts at
+ * options.offset and nested ones at their first element, each page holding
+ * at most options.limit elements. A query stops describing objects after
+ * MAX_DX_NODES and reports truncated.
+ *
+ * Each node has kind and, where they apply, expression, type, location,
+ * value, display, name (properties and fields), index (elements),
+ * properties, fields, elements with offset, has_more and next_offset, and
+ * expandable once the depth budget is spent.
+ *
+ * @param[in] options Expression, first page and depth budget
+ * @param[out] error Receives the failing HRESULT
+ * @param[out] error_message Receives the data model's error for the expression
+ *
+ * @return {"expression", "result", "truncated"}; empty on failure
+ */
+nlohmann::json DataModelQuery::evaluate(
+    _In_ const DataModelQueryOptions& options,
+    _Out_opt_ HRESULT* error,
+    _Out_opt_ std::string* error_message) {
+
+    if (error) *error = S_OK;
+
+    auto* client = ExtensionImpl::get_instance().get_debug_client();
+    if (!client) {
+        if (error) *error = E_FAIL;
+        return {};
+    }
+
+    CComPtr<IHostDataModelAccess> access;
+    HRESULT hr = client->QueryInterface(__uuidof(IHostDataModelAccess), reinterpret_cast<void**>(&access));
+    CComPtr<IDataModelManager> manager;
+    CComPtr<IDebugHost> host;
+    if (SUCCEEDED(hr)) {
+        hr = access->GetDataModel(&manager, &host);
+    }
+    CComPtr<IDebugHostEvaluator> evaluator;
+    if (SUCCEEDED(hr)) {
+        hr = host->QueryInterface(__uuidof(IDebugHostEvaluator), reinterpret_cast<void**>(&evaluator));
+    }
+    CComPtr<IDebugHostContext> context;
+    if (SUCCEEDED(hr)) {
+        hr = host->GetCurrentContext(&context);
+    }
+    if (FAILED(hr)) {
+        if (error) *error = hr;
+        if (error_message) *error_message = "Data model not available: " + WinDbgHelpers::format_windbg_error(hr);
+        return {};
+    }
+
+    // A failed evaluation may still return an error object explaining it
+    CComPtr<IModelObject> result;
+    std::wstring expression = to_wide(options.expression);
+    hr = evaluator->EvaluateExtendedExpression(context, expression.c_str(), nullptr, &result, nullptr);
+    if (FAILED(hr) || !result) {
+        if (error) *error = FAILED(hr) ? hr : E_FAIL;
+        if (error_message) {
+            std::string reason = result ? display_string(result) : std::string();
+            *error_message = reason.empty() ? WinDbgHelpers::format_windbg_error(FAILED(hr) ? hr : E_FAIL) : reason;
+        }
+        return {};
+    }
+
+    ModelWalker walker(options);
+    auto node = walker.describe(result, options.expression, options.depth, options.offset);
+    return {
+        {"expression", options.expression},
+        {"result", std::move(node)},
+        {"truncated", walker.truncated()}
+    };
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "../pch.h"
+#include "constants.h"
+#include <string>
+
+namespace vibedbg::utils {
+
+struct DataModelQueryOptions {
+    std::string expression;
+    size_t offset{0};                           // Elements of the result's collection skipped before the page
+    size_t limit{Constants::DEFAULT_DX_PAGE_SIZE}; // Elements returned per collection
+    unsigned int depth{Constants::DEFAULT_DX_DEPTH}; // Levels expanded below the result
+    bool raw{false};                            // List native fields even where a visualizer supplies the view
+};
+
+/**
+ * @class DataModelQuery
+ * @brief Evaluates a dx expression and walks the result through IModelObject.
+ *
+ * "dx -r3" formats the whole tree as text, collections included, and the
+ * client parses it back. Here the result comes back as a JSON tree of typed
+ * nodes: kind, type, location, intrinsic value, display string, properties
+ * and collection elements. The walk stops at the depth budget, where a node
+ * only says it is expandable, and a collection returns one page of elements
+ * with the offset of the next. Every node carries the expression that
+ * reaches it, so a client pages or expands it with another query rather
+ * than a deeper one.
+ *
+ * Must run on the engine thread.
+ */
+class DataModelQuery {
+public:
+    /**
+     * @brief Evaluates the expression in the current context and describes the result.
+     *
+     * @param[in] options Expression, first page and depth budget
+     * @param[out] hr Receives the failing HRESULT
+     * @param[out] error_message Receives the data model's error for the expression
+     * @return {"expression", "result", "truncated"}; empty on failure
+     */
+    static nlohmann::json evaluate(const DataModelQueryOptions& options, HRESULT* hr = nullptr,
+                                   std::string* error_message = nullptr);
+};
+
+} // namespace vibedbg::utils
@@ -0,0 +1,158 @@
+#include "pch.h"
+#include "disassembly_cache.h"
+
+using namespace vibedbg::utils;
+
+namespace {
+    // No x86 or x64 instruction is longer; an instruction overlapping a
+    // write starts at most this far before it
+    constexpr uint64_t MAX_INSTRUCTION_SIZE = 15;
+}
+
+DisassemblyCache& DisassemblyCache::instance() {
+    static DisassemblyCache cache;
+    return cache;
+}
+
+/**
+ * @brief Looks up the instruction decoded at an address.
+ *
+ * Entries of an image that was replaced by another at the same base are
+ * dropped on the first lookup that sees the new timestamp.
+ *
+ * @param[in] module Module the address lies in
+ * @param[in] address Address of the instruction
+ *
+ * @return Cached instruction, or nullopt on a miss
+ */
+std::optional<DecodedInstruction> DisassemblyCache::find(
+    _In_ const SymbolCache::ModuleIdentity& module, _In_ uint64_t address) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto entry = find_module(module);
+    if (entry == modules_.end()) {
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        return std::nullopt;
+    }
+
+    auto it = entry->second.instructions.find(address);
+    if (it == entry->second.instructions.end()) {
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        return std::nullopt;
+    }
+
+    lru_.splice(lru_.begin(), lru_, entry->second.lru);
+    hits_.fetch_add(1, std::memory_order_relaxed);
+    return it->second;
+}
+
+/**
+ * @brief Remembers a decoded instruction of a module.
+ *
+ * @param[in] module Module the instruction lies in
+ * @param[in] instruction Instruction as it was decoded
+ */
+void DisassemblyCache::store(_In_ const SymbolCache::ModuleIdentity& module, _In_ const DecodedInstruction& instruction) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto entry = find_module(module);
+    if (entry == modules_.end()) {
+        ModuleKey key{module.process_id, module.base};
+        lru_.push_front(key);
+        entry = modules_.emplace(key, ModuleInstructions{module.size, module.timestamp, {}, lru_.begin()}).first;
+    } else {
+        lru_.splice(lru_.begin(), lru_, entry->second.lru);
+    }
+
+    if (entry->second.instructions.insert_or_assign(instruction.address, instruction).second) {
+        ++entries_;
+    }
+
+    // Evicting the module just stored into would leave nothing to hit
+    while (entries_ > Constants::DISASSEMBLY_CACHE_INSTRUCTIONS && lru_.back() != entry->first) {
+        erase_module(modules_.find(lru_.back()));
+    }
+}
+
+void DisassemblyCache::invalidate_module(_In_ uint64_t base) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    bool erased = false;
+    for (auto entry = modules_.begin(); entry != modules_.end();) {
+        if (entry->first.second == base) {
+            erase_module(entry++);
+            erased = true;
+        } else {
+            ++entry;
+        }
+    }
+    if (erased) {
+        invalidations_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Drops the instructions overlapping memory that was written.
+ *
+ * @param[in] address First byte written
+ * @param[in] size Bytes written
+ */
+void DisassemblyCache::invalidate_range(_In_ uint64_t address, _In_ uint64_t size) {
+    if (size == 0) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t end = address + size;
+    for (auto& [key, module] : modules_) {
+        uint64_t base = key.second;
+        if (end <= base || address >= base + module.size) {
+            continue;
+        }
+
+        auto& instructions = module.instructions;
+        auto it = instructions.lower_bound(address > MAX_INSTRUCTION_SIZE ? address - MAX_INSTRUCTION_SIZE : 0);
+        while (it != instructions.end() && it->first < end) {
+            if (it->first + it->second.size > address) {
+                it = instructions.erase(it);
+                --entries_;
+            } else {
+                ++it;
+            }
+        }
+    }
+    invalidations_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void DisassemblyCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    modules_.clear();
+    lru_.clear();
+    entries_ = 0;
+    invalidations_.fetch_add(1, std::memory_order_relaxed);
+}
+
+DisassemblyCache::Stats DisassemblyCache::get_stats() const {
+    Stats stats;
+    stats.hits = hits_.load(std::memory_order_relaxed);
+    stats.misses = misses_.load(std::memory_order_relaxed);
+    stats.invalidations = invalidations_.load(std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats.entries = entries_;
+    return stats;
+}
+
+// Caller holds mutex_; a module found with another timestamp is dropped
+DisassemblyCache::Modules::iterator DisassemblyCache::find_module(_In_ const SymbolCache::ModuleIdentity& module) {
+    auto entry = modules_.find(ModuleKey{module.process_id, module.base});
+    if (entry != modules_.end() && entry->second.timestamp != module.timestamp) {
+        erase_module(entry);
+        return modules_.end();
+    }
+    return entry;
+}
+
+// Caller holds mutex_
+void DisassemblyCache::erase_module(_In_ Modules::iterator module) {
+    entries_ -= module->second.instructions.size();
+    lru_.erase(module->second.lru);
+    modules_.erase(module);
+}
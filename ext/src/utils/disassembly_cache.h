@@ -0,0 +1,113 @@
+#pragma once
+
+#include "../pch.h"
+#include "constants.h"
+#include "symbol_cache.h"
+#include <list>
+#include <map>
+#include <optional>
+#include <utility>
+
+namespace vibedbg::utils {
+
+// One instruction as Disassemble decoded it, with the symbol and source line
+// its address resolves to
+struct DecodedInstruction {
+    uint64_t address{0};
+    uint32_t size{0};
+    std::string text;         // Disassemble's line, without the line break
+    std::string symbol;       // Empty when the address has no symbol
+    uint64_t displacement{0};
+    std::string file;         // Empty without line information
+    uint32_t line{0};
+};
+
+/**
+ * @class DisassemblyCache
+ * @brief Bounded cache of decoded instructions, kept per module.
+ *
+ * Code in a loaded image rarely changes, so the instructions decoded for one
+ * request serve the next without another Disassemble call; a stack walked
+ * again after a step mostly disassembles the same functions. As in the
+ * symbol cache, a module is identified by its process, base and timestamp,
+ * so sessions debugging different processes never share instructions.
+ *
+ * A module's entries are dropped when it unloads, and when its symbols are
+ * reloaded, since the text names call targets by symbol; events name only
+ * the base, so the module is dropped from every process. Writes to target
+ * memory drop the instructions they overlap, in every process as well. Once
+ * the cache is full, the least recently used module is dropped as a whole.
+ */
+class DisassemblyCache {
+public:
+    struct Stats {
+        uint64_t hits{0};
+        uint64_t misses{0};
+        uint64_t entries{0};
+        uint64_t invalidations{0};
+    };
+
+    static DisassemblyCache& instance();
+
+    /**
+     * @brief Looks up the instruction decoded at an address.
+     *
+     * @param[in] module Module the address lies in
+     * @param[in] address Address of the instruction
+     *
+     * @return Cached instruction, or nullopt on a miss
+     */
+    std::optional<DecodedInstruction> find(const SymbolCache::ModuleIdentity& module, uint64_t address);
+
+    /**
+     * @brief Remembers a decoded instruction of a module.
+     */
+    void store(const SymbolCache::ModuleIdentity& module, const DecodedInstruction& instruction);
+
+    /**
+     * @brief Drops the instructions of one module that unloaded or whose symbols were reloaded.
+     *
+     * @param[in] base Base of the module
+     */
+    void invalidate_module(uint64_t base);
+
+    /**
+     * @brief Drops the instructions overlapping memory that was written.
+     */
+    void invalidate_range(uint64_t address, uint64_t size);
+
+    /**
+     * @brief Drops every instruction.
+     */
+    void clear();
+
+    Stats get_stats() const;
+
+private:
+    using ModuleKey = std::pair<uint32_t, uint64_t>; // Engine process id and module base
+
+    struct ModuleInstructions {
+        uint64_t size{0};
+        uint32_t timestamp{0};
+        std::map<uint64_t, DecodedInstruction> instructions; // By address
+        std::list<ModuleKey>::iterator lru;
+    };
+
+    using Modules = std::map<ModuleKey, ModuleInstructions>;
+
+    DisassemblyCache() = default;
+
+    Modules::iterator find_module(const SymbolCache::ModuleIdentity& module);
+    void erase_module(Modules::iterator module);
+
+    mutable std::mutex mutex_;
+    Modules modules_;
+    std::list<ModuleKey> lru_; // Most recently used first
+    size_t entries_{0};
+
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+    std::atomic<uint64_t> invalidations_{0};
+};
+
+} // namespace vibedbg::utils
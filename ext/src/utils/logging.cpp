@@ -2,6 +2,7 @@
 #include "../../inc/logging.h"
 #include <sstream>
 #include <iomanip>
+#include <fstream>
 
 using namespace vibedbg::logging;
 
@@ -11,79 +12,223 @@ using namespace vibedbg::logging;
 
 // Static member initialization
 std::string Logger::component_name_ = "VibeDbg";
-std::mutex Logger::log_mutex_;
-bool Logger::initialized_ = false;
+std::mutex Logger::lifecycle_mutex_;
+
+namespace {
+    constexpr size_t RING_SLOTS = 1024;         // Power of two
+    constexpr size_t MAX_RECORD_TEXT = 496;     // Longer messages are truncated
+
+    // One slot of a bounded multi-producer queue. A slot whose sequence
+    // equals the write position is free; one whose sequence is one past
+    // its position holds a record
+    struct Record {
+        std::atomic<size_t> sequence{0};
+        std::chrono::system_clock::time_point time;
+        Level level{Level::Info};
+        uint16_t length{0};
+        char text[MAX_RECORD_TEXT];
+    };
+
+    enum class State : uint8_t { NotStarted, Running, Stopped };
+
+    // Kept for the lifetime of the DLL, so a thread still logging while
+    // Cleanup runs never writes to freed memory
+    Record ring[RING_SLOTS];
+    std::atomic<size_t> write_position{0};
+    size_t read_position = 0;                   // Drain thread only
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<State> state{State::NotStarted};
+    std::atomic<bool> stopping{false};
+    std::atomic<bool> drainer_sleeping{false};
+    std::atomic<uint32_t> wake_ticket{0};
+    std::thread drain_thread;
+    std::ofstream log_file;                     // Opened before the drain thread starts, then drain thread only
+
+    std::string_view level_name(Level level) {
+        switch (level) {
+            case Level::Trace: return "TRACE";
+            case Level::Debug: return "DEBUG";
+            case Level::Info: return "INFO";
+            case Level::Warning: return "WARNING";
+            case Level::Error: return "ERROR";
+            case Level::Fatal: return "FATAL";
+        }
+        return "UNKNOWN";
+    }
+
+    bool parse_level(std::string value, Level* level) {
+        std::transform(value.begin(), value.end(), value.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        for (Level candidate : {Level::Trace, Level::Debug, Level::Info, Level::Warning, Level::Error, Level::Fatal}) {
+            std::string name(level_name(candidate));
+            std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+            if (value == name) {
+                *level = candidate;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::string environment_variable(const char* name) {
+        char buffer[MAX_PATH];
+        DWORD length = GetEnvironmentVariableA(name, buffer, MAX_PATH);
+        return (length > 0 && length < MAX_PATH) ? std::string(buffer, length) : std::string();
+    }
+
+    // Copies "[context] message | details" into the record, truncated to fit
+    uint16_t compose(char* text, const std::string& context, const std::string& message, const std::string& details) {
+        size_t length = 0;
+        auto append = [&](std::string_view part) {
+            size_t count = (std::min)(part.size(), MAX_RECORD_TEXT - length);
+            memcpy(text + length, part.data(), count);
+            length += count;
+        };
+        append("[");
+        append(context);
+        append("] ");
+        append(message);
+        if (!details.empty()) {
+            append(" | ");
+            append(details);
+        }
+        return static_cast<uint16_t>(length);
+    }
+
+    bool try_enqueue(Level level, const std::string& context, const std::string& message, const std::string& details) {
+        size_t position = write_position.load(std::memory_order_relaxed);
+        Record* record = nullptr;
+        for (;;) {
+            record = &ring[position & (RING_SLOTS - 1)];
+            size_t sequence = record->sequence.load(std::memory_order_acquire);
+            auto difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+            if (difference == 0) {
+                if (write_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (difference < 0) {
+                return false;
+            } else {
+                position = write_position.load(std::memory_order_relaxed);
+            }
+        }
+
+        record->time = std::chrono::system_clock::now();
+        record->level = level;
+        record->length = compose(record->text, context, message, details);
+        record->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Pairs with the fence in DrainLoop: either the drain thread sees the
+    // record before it sleeps, or this thread sees it sleeping and wakes it
+    void wake_drainer() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (drainer_sleeping.load(std::memory_order_relaxed)) {
+            wake_ticket.fetch_add(1, std::memory_order_relaxed);
+            wake_ticket.notify_one();
+        }
+    }
+}
 
 void Logger::Initialize(const std::string& component_name) {
-    std::lock_guard<std::mutex> lock(log_mutex_);
+    std::lock_guard<std::mutex> lock(lifecycle_mutex_);
     
-    if (!initialized_) {
-        component_name_ = component_name;
-        initialized_ = true;
-        // Don't call logging functions from within Initialize to avoid deadlock
-        // Just use OutputDebugString directly
-        OutputDebugStringA(("[" + component_name_ + "] Logging system initialized\n").c_str());
+    if (state.load(std::memory_order_acquire) != State::NotStarted) {
+        return;
+    }
+    component_name_ = component_name;
+
+    Level level;
+    if (parse_level(environment_variable("VIBEDBG_LOG_LEVEL"), &level)) {
+        SetLevel((std::max)(level, static_cast<Level>(VIBEDBG_MIN_LOG_LEVEL)));
     }
+    std::string file_path = environment_variable("VIBEDBG_LOG_FILE");
+    if (!file_path.empty()) {
+        log_file.open(file_path, std::ios::app);
+    }
+
+    for (size_t i = 0; i < RING_SLOTS; ++i) {
+        ring[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    drain_thread = std::thread(&Logger::DrainLoop);
+    state.store(State::Running, std::memory_order_release);
+
+    // Don't call logging functions from within Initialize to avoid deadlock
+    WriteLine("[" + component_name_ + "] Logging system initialized\n");
 }
 
 void Logger::Cleanup() {
-    std::lock_guard<std::mutex> lock(log_mutex_);
+    std::lock_guard<std::mutex> lock(lifecycle_mutex_);
     
-    if (initialized_) {
-        // Don't call logging functions from within Cleanup to avoid deadlock
-        OutputDebugStringA(("[" + component_name_ + "] Logging system shutting down\n").c_str());
-        initialized_ = false;
+    if (state.load(std::memory_order_acquire) != State::Running) {
+        return;
+    }
+
+    // Messages logged from here on are written directly; the drain thread
+    // writes what is already queued before it exits
+    state.store(State::Stopped, std::memory_order_release);
+    stopping.store(true, std::memory_order_relaxed);
+    wake_ticket.fetch_add(1, std::memory_order_relaxed);
+    wake_ticket.notify_one();
+    if (drain_thread.joinable()) {
+        drain_thread.join();
+    }
+
+    // Don't call logging functions from within Cleanup to avoid deadlock
+    WriteLine("[" + component_name_ + "] Logging system shutting down\n");
+    if (log_file.is_open()) {
+        log_file.close();
     }
 }
 
 // Simplified Log methods (no Level enum parameter in public interface anymore)
 void Logger::Trace(const std::string& context, const std::string& message) {
-    Log("TRACE", context, message, "");
+    Log(Level::Trace, context, message);
 }
 
 void Logger::Debug(const std::string& context, const std::string& message) {
-    Log("DEBUG", context, message, "");
+    Log(Level::Debug, context, message);
 }
 
 void Logger::Info(const std::string& context, const std::string& message) {
-    Log("INFO", context, message, "");
+    Log(Level::Info, context, message);
 }
 
 void Logger::Warning(const std::string& context, const std::string& message) {
-    Log("WARNING", context, message, "");
+    Log(Level::Warning, context, message);
 }
 
 void Logger::Error(const std::string& context, const std::string& message) {
-    Log("ERROR", context, message, "");
+    Log(Level::Error, context, message);
 }
 
 void Logger::Fatal(const std::string& context, const std::string& message) {
-    Log("FATAL", context, message, "");
+    Log(Level::Fatal, context, message);
 }
 
 // Logging with details
 void Logger::Trace(const std::string& context, const std::string& message, const std::string& details) {
-    Log("TRACE", context, message, details);
+    Log(Level::Trace, context, message, details);
 }
 
 void Logger::Debug(const std::string& context, const std::string& message, const std::string& details) {
-    Log("DEBUG", context, message, details);
+    Log(Level::Debug, context, message, details);
 }
 
 void Logger::Info(const std::string& context, const std::string& message, const std::string& details) {
-    Log("INFO", context, message, details);
+    Log(Level::Info, context, message, details);
 }
 
 void Logger::Warning(const std::string& context, const std::string& message, const std::string& details) {
-    Log("WARNING", context, message, details);
+    Log(Level::Warning, context, message, details);
 }
 
 void Logger::Error(const std::string& context, const std::string& message, const std::string& details) {
-    Log("ERROR", context, message, details);
+    Log(Level::Error, context, message, details);
 }
 
 void Logger::Fatal(const std::string& context, const std::string& message, const std::string& details) {
-    Log("FATAL", context, message, details);
+    Log(Level::Fatal, context, message, details);
 }
 
 // WinDbg UI logging methods - these output to WinDbg console
@@ -116,22 +261,85 @@ void Logger::LogToWinDbg(const std::string& context, const std::string& message,
     }
 }
 
-// Internal helper to format and write
-void Logger::Log(const std::string& level_str, const std::string& context, const std::string& message, const std::string& details) {
-    if (!initialized_) {
+// Internal helper to queue a message, or write it if the drain thread is not running
+void Logger::Log(Level level, const std::string& context, const std::string& message, const std::string& details) {
+    State current = state.load(std::memory_order_acquire);
+    if (current == State::NotStarted) {
         Initialize();
+        current = state.load(std::memory_order_acquire);
     }
-    
-    std::string formatted_message = FormatLogMessage(level_str, context, message, details);
-    
-    std::lock_guard<std::mutex> lock(log_mutex_);
-    WriteToDebugView(formatted_message);
+
+    if (current == State::Running) {
+        if (try_enqueue(level, context, message, details)) {
+            wake_drainer();
+        } else {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+        return;
+    }
+
+    char text[MAX_RECORD_TEXT];
+    uint16_t length = compose(text, context, message, details);
+    WriteLine(FormatLogMessage(std::chrono::system_clock::now(), level, std::string_view(text, length)));
 }
 
+/**
+ * @brief Writes queued messages until Cleanup, then writes what is left.
+ *
+ * The thread sleeps on wake_ticket while the ring is empty; producers only
+ * touch the ticket when they see the thread asleep.
+ */
+void Logger::DrainLoop() {
+    for (;;) {
+        bool wrote = false;
+        for (;;) {
+            Record& record = ring[read_position & (RING_SLOTS - 1)];
+            if (record.sequence.load(std::memory_order_acquire) != read_position + 1) {
+                break;
+            }
+            std::string line = FormatLogMessage(record.time, record.level, std::string_view(record.text, record.length));
+            WriteLine(line);
+            if (log_file.is_open()) {
+                log_file << line;
+            }
+            record.sequence.store(read_position + RING_SLOTS, std::memory_order_release);
+            ++read_position;
+            wrote = true;
+        }
 
+        uint64_t lost = dropped.exchange(0, std::memory_order_relaxed);
+        if (lost > 0) {
+            std::string line = FormatLogMessage(std::chrono::system_clock::now(), Level::Warning,
+                                                "[Logger] " + std::to_string(lost) + " log messages dropped, the log buffer was full");
+            WriteLine(line);
+            if (log_file.is_open()) {
+                log_file << line;
+            }
+            wrote = true;
+        }
+        if (wrote && log_file.is_open()) {
+            log_file.flush();
+        }
+
+        if (stopping.load(std::memory_order_relaxed)) {
+            if (ring[read_position & (RING_SLOTS - 1)].sequence.load(std::memory_order_acquire) != read_position + 1) {
+                return;
+            }
+            continue;
+        }
 
-std::string Logger::GetTimestamp() {
-    auto now = std::chrono::system_clock::now();
+        uint32_t ticket = wake_ticket.load(std::memory_order_relaxed);
+        drainer_sleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        bool empty = ring[read_position & (RING_SLOTS - 1)].sequence.load(std::memory_order_acquire) != read_position + 1;
+        if (empty && !stopping.load(std::memory_order_relaxed)) {
+            wake_ticket.wait(ticket, std::memory_order_relaxed);
+        }
+        drainer_sleeping.store(false, std::memory_order_relaxed);
+    }
+}
+
+std::string Logger::GetTimestamp(std::chrono::system_clock::time_point now) {
     auto time_t = std::chrono::system_clock::to_time_t(now);
     auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
         now.time_since_epoch()) % 1000;
@@ -145,24 +353,19 @@ std::string Logger::GetTimestamp() {
     return oss.str();
 }
 
-void Logger::WriteToDebugView(const std::string& message) {
+void Logger::WriteLine(const std::string& line) {
     // OutputDebugString is the key function that DebugView captures
-    OutputDebugStringA(message.c_str());
+    OutputDebugStringA(line.c_str());
 }
 
-std::string Logger::FormatLogMessage(const std::string& level, const std::string& context, const std::string& message, const std::string& details) {
+std::string Logger::FormatLogMessage(std::chrono::system_clock::time_point time, Level level, std::string_view text) {
     std::ostringstream oss;
     
     // Format: [Timestamp] [Level] [Component] [Context] Message [Details]
-    oss << "[" << GetTimestamp() << "] ";
-    oss << "[" << level << "] ";
+    oss << "[" << GetTimestamp(time) << "] ";
+    oss << "[" << level_name(level) << "] ";
     oss << "[" << component_name_ << "] ";
-    oss << "[" << context << "] ";
-    oss << message;
-    
-    if (!details.empty()) {
-        oss << " | " << details;
-    }
+    oss << text << "\n";
     
     return oss.str();
 }
@@ -0,0 +1,324 @@
+#include "pch.h"
+#include "metrics.h"
+#include <algorithm>
+#include <bit>
+
+using namespace vibedbg::utils;
+
+namespace {
+    constexpr std::string_view COUNTER_NAMES[] = {
+        "pipe_connections",
+        "pipe_disconnections",
+        "pipe_messages",
+        "pipe_errors",
+        "frames_received",
+        "frames_sent",
+        "bytes_received",
+        "bytes_sent",
+        "mcp_requests",
+        "commands_executed",
+        "commands_succeeded",
+        "commands_failed",
+        "commands_timed_out",
+        "result_cache_hits",
+        "result_cache_misses",
+        "command_time_ms",
+        "extension_commands",
+        "extension_commands_succeeded",
+        "extension_commands_failed",
+        "events_pushed",
+        "events_dropped",
+        "symbol_modules_loaded",
+        "symbol_modules_failed",
+        "symbol_prefetches",
+        "auth_failures",
+        "heap_bytes_scanned",
+        "requests_rejected",
+        "connections_rejected",
+        "command_prefetches",
+        "prefetch_hits",
+        "prefetches_yielded",
+    };
+    static_assert(std::size(COUNTER_NAMES) == MetricsRegistry::COUNTER_COUNT);
+
+    constexpr std::string_view STAGE_NAMES[] = {
+        "queue_wait",
+        "engine_time",
+        "serialization",
+        "pipe_write",
+        "request",
+    };
+    static_assert(std::size(STAGE_NAMES) == MetricsRegistry::STAGE_COUNT);
+
+    uint64_t hash_name(std::string_view name) noexcept {
+        uint64_t hash = 14695981039346656037ull;
+        for (char c : name) {
+            hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211ull;
+        }
+        return hash;
+    }
+
+    nlohmann::json summary_json(const HdrHistogram::Summary& summary) {
+        return {
+            {"count", summary.count},
+            {"mean_us", summary.count > 0 ? summary.total_us / summary.count : 0},
+            {"p50_us", summary.p50_us},
+            {"p90_us", summary.p90_us},
+            {"p99_us", summary.p99_us},
+            {"max_us", summary.max_us}
+        };
+    }
+}
+
+// Threads take slots round-robin as they first count something, so the
+// engine thread and the pipe threads end up on different cache lines
+size_t ShardedCounter::slot_of_this_thread() noexcept {
+    static std::atomic<size_t> next_slot{0};
+    thread_local size_t slot = next_slot.fetch_add(1, std::memory_order_relaxed) % SLOT_COUNT;
+    return slot;
+}
+
+void ShardedCounter::add(uint64_t amount) noexcept {
+    slots_[slot_of_this_thread()].value.fetch_add(amount, std::memory_order_relaxed);
+}
+
+uint64_t ShardedCounter::value() const noexcept {
+    uint64_t total = 0;
+    for (const auto& slot : slots_) {
+        total += slot.value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+void ShardedCounter::reset() noexcept {
+    for (auto& slot : slots_) {
+        slot.value.store(0, std::memory_order_relaxed);
+    }
+}
+
+// Values below 16 us get a bucket each; above that, the top bit picks the
+// power of two and the next four bits the sub-bucket within it
+size_t HdrHistogram::bucket_of(uint64_t value) noexcept {
+    if (value < SUB_BUCKETS) {
+        return static_cast<size_t>(value);
+    }
+    unsigned magnitude = static_cast<unsigned>(std::bit_width(value)) - 1;
+    if (magnitude >= MAX_MAGNITUDE) {
+        return BUCKET_COUNT - 1;
+    }
+    uint64_t sub_bucket = (value >> (magnitude - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+    return static_cast<size_t>((magnitude - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + sub_bucket);
+}
+
+uint64_t HdrHistogram::bucket_upper_bound(size_t bucket) noexcept {
+    if (bucket < SUB_BUCKETS) {
+        return bucket;
+    }
+    unsigned magnitude = static_cast<unsigned>(bucket / SUB_BUCKETS) + SUB_BUCKET_BITS - 1;
+    uint64_t sub_bucket = bucket % SUB_BUCKETS;
+    return ((SUB_BUCKETS + sub_bucket + 1) << (magnitude - SUB_BUCKET_BITS)) - 1;
+}
+
+void HdrHistogram::record(std::chrono::microseconds value) noexcept {
+    uint64_t us = static_cast<uint64_t>((std::max)(value.count(), int64_t{0}));
+    buckets_[bucket_of(us)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    total_.fetch_add(us, std::memory_order_relaxed);
+
+    uint64_t max = max_.load(std::memory_order_relaxed);
+    while (us > max && !max_.compare_exchange_weak(max, us, std::memory_order_relaxed)) {
+    }
+}
+
+// The buckets are read one at a time while other threads record, so the
+// count is taken from the buckets themselves to keep the ranks consistent
+HdrHistogram::Summary HdrHistogram::summarize() const noexcept {
+    std::array<uint64_t, BUCKET_COUNT> counts;
+    Summary summary;
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        counts[i] = buckets_[i].load(std::memory_order_relaxed);
+        summary.count += counts[i];
+    }
+    summary.total_us = total_.load(std::memory_order_relaxed);
+    summary.max_us = max_.load(std::memory_order_relaxed);
+    if (summary.count == 0) {
+        return summary;
+    }
+
+    auto rank = [&summary](uint64_t percent) {
+        return (summary.count * percent + 99) / 100;
+    };
+    const std::pair<uint64_t, uint64_t*> targets[] = {
+        {rank(50), &summary.p50_us}, {rank(90), &summary.p90_us}, {rank(99), &summary.p99_us}};
+
+    uint64_t seen = 0;
+    size_t next_target = 0;
+    for (size_t i = 0; i < BUCKET_COUNT && next_target < std::size(targets); ++i) {
+        seen += counts[i];
+        while (next_target < std::size(targets) && seen >= targets[next_target].first) {
+            *targets[next_target].second = (std::min)(bucket_upper_bound(i), summary.max_us);
+            ++next_target;
+        }
+    }
+    return summary;
+}
+
+void HdrHistogram::reset() noexcept {
+    for (auto& bucket : buckets_) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    total_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+MetricsRegistry& MetricsRegistry::instance() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+MetricsRegistry::MetricsRegistry() : start_time_(std::chrono::steady_clock::now()) {
+    other_commands_.name = "(other)";
+}
+
+MetricsRegistry::~MetricsRegistry() {
+    for (auto& slot : commands_) {
+        delete slot.load();
+    }
+}
+
+void MetricsRegistry::record(Stage stage, std::chrono::steady_clock::duration elapsed) noexcept {
+    stages_[static_cast<size_t>(stage)].record(std::chrono::duration_cast<std::chrono::microseconds>(elapsed));
+}
+
+void MetricsRegistry::record_command(std::string_view command_name, std::chrono::steady_clock::duration elapsed,
+                                     bool succeeded) {
+    auto& metrics = command_metrics(command_name);
+    metrics.latency.record(std::chrono::duration_cast<std::chrono::microseconds>(elapsed));
+    if (!succeeded) {
+        metrics.failures.add();
+    }
+}
+
+// Linear probing over slots that are only ever filled. A thread losing the
+// race for an empty slot checks whether the winner holds the same name
+// before probing on, so every name ends up in exactly one slot
+MetricsRegistry::CommandMetrics& MetricsRegistry::command_metrics(std::string_view command_name) {
+    char buffer[MAX_COMMAND_NAME];
+    size_t length = (std::min)(command_name.size(), MAX_COMMAND_NAME);
+    for (size_t i = 0; i < length; ++i) {
+        char c = command_name[i];
+        buffer[i] = (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+    }
+    std::string_view name(buffer, length);
+    if (name.empty()) {
+        return other_commands_;
+    }
+
+    size_t start = static_cast<size_t>(hash_name(name) % COMMAND_SLOTS);
+    CommandMetrics* created = nullptr;
+    for (size_t probe = 0; probe < COMMAND_SLOTS; ++probe) {
+        auto& slot = commands_[(start + probe) % COMMAND_SLOTS];
+        CommandMetrics* current = slot.load(std::memory_order_acquire);
+        if (!current) {
+            if (!created) {
+                created = new CommandMetrics();
+                created->name = name;
+            }
+            if (slot.compare_exchange_strong(current, created, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                return *created;
+            }
+        }
+        if (current->name == name) {
+            delete created;
+            return *current;
+        }
+    }
+    delete created;
+    return other_commands_;
+}
+
+MetricsRegistry::Snapshot MetricsRegistry::snapshot() const {
+    Snapshot snapshot;
+    snapshot.uptime = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start_time_);
+    for (size_t i = 0; i < COUNTER_COUNT; ++i) {
+        snapshot.counters[i] = counters_[i].value();
+    }
+    for (size_t i = 0; i < STAGE_COUNT; ++i) {
+        snapshot.stages[i] = stages_[i].summarize();
+    }
+
+    auto add_command = [&snapshot](const CommandMetrics& metrics) {
+        auto latency = metrics.latency.summarize();
+        if (latency.count > 0) {
+            snapshot.commands.push_back({metrics.name, metrics.failures.value(), latency});
+        }
+    };
+    for (const auto& slot : commands_) {
+        if (const auto* metrics = slot.load(std::memory_order_acquire)) {
+            add_command(*metrics);
+        }
+    }
+    add_command(other_commands_);
+
+    std::sort(snapshot.commands.begin(), snapshot.commands.end(), [](const auto& a, const auto& b) {
+        return a.latency.total_us > b.latency.total_us;
+    });
+    return snapshot;
+}
+
+// Command slots keep their names; only what they counted is dropped
+void MetricsRegistry::reset() {
+    for (auto& counter : counters_) {
+        counter.reset();
+    }
+    for (auto& stage : stages_) {
+        stage.reset();
+    }
+    for (auto& slot : commands_) {
+        if (auto* metrics = slot.load(std::memory_order_acquire)) {
+            metrics->latency.reset();
+            metrics->failures.reset();
+        }
+    }
+    other_commands_.latency.reset();
+    other_commands_.failures.reset();
+}
+
+std::string_view MetricsRegistry::counter_name(Counter counter) noexcept {
+    size_t index = static_cast<size_t>(counter);
+    return index < COUNTER_COUNT ? COUNTER_NAMES[index] : std::string_view("unknown");
+}
+
+std::string_view MetricsRegistry::stage_name(Stage stage) noexcept {
+    size_t index = static_cast<size_t>(stage);
+    return index < STAGE_COUNT ? STAGE_NAMES[index] : std::string_view("unknown");
+}
+
+nlohmann::json MetricsRegistry::to_json(const Snapshot& snapshot) {
+    nlohmann::json counters = nlohmann::json::object();
+    for (size_t i = 0; i < COUNTER_COUNT; ++i) {
+        counters[std::string(COUNTER_NAMES[i])] = snapshot.counters[i];
+    }
+
+    nlohmann::json stages = nlohmann::json::object();
+    for (size_t i = 0; i < STAGE_COUNT; ++i) {
+        stages[std::string(STAGE_NAMES[i])] = summary_json(snapshot.stages[i]);
+    }
+
+    nlohmann::json commands = nlohmann::json::array();
+    for (const auto& command : snapshot.commands) {
+        auto entry = summary_json(command.latency);
+        entry["command"] = command.command;
+        entry["failures"] = command.failures;
+        commands.push_back(std::move(entry));
+    }
+
+    return {
+        {"uptime_ms", snapshot.uptime.count()},
+        {"counters", std::move(counters)},
+        {"stages", std::move(stages)},
+        {"commands", std::move(commands)}
+    };
+}
@@ -0,0 +1,223 @@
+#pragma once
+
+#include "../pch.h"
+#include "../../inc/json.h"
+#include <array>
+#include <string_view>
+
+namespace vibedbg::utils {
+
+/**
+ * @class ShardedCounter
+ * @brief Monotonic counter whose increments never contend across threads.
+ *
+ * Each thread adds to one of several cache-line sized slots, picked once per
+ * thread; reading sums the slots. A read racing with increments sees some of
+ * them, which is all a statistic needs.
+ */
+class ShardedCounter {
+public:
+    void add(uint64_t amount = 1) noexcept;
+    uint64_t value() const noexcept;
+
+    /**
+     * @brief Zeroes the counter; increments racing with the reset may survive it.
+     */
+    void reset() noexcept;
+
+private:
+    static constexpr size_t SLOT_COUNT = 16;
+
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> value{0};
+    };
+
+    static size_t slot_of_this_thread() noexcept;
+
+    std::array<Slot, SLOT_COUNT> slots_;
+};
+
+/**
+ * @class HdrHistogram
+ * @brief Lock-free latency histogram with a bounded relative error.
+ *
+ * Values are recorded in microseconds into log-linear buckets: every power of
+ * two is split into 16 equal sub-buckets, so any reported percentile is
+ * within 1/16 of the recorded value, from 1 us up to about 19 hours. Recording
+ * is two relaxed atomic adds and an atomic max.
+ */
+class HdrHistogram {
+public:
+    struct Summary {
+        uint64_t count{0};
+        uint64_t total_us{0};
+        uint64_t p50_us{0};
+        uint64_t p90_us{0};
+        uint64_t p99_us{0};
+        uint64_t max_us{0};
+    };
+
+    void record(std::chrono::microseconds value) noexcept;
+    Summary summarize() const noexcept;
+    void reset() noexcept;
+
+private:
+    static constexpr unsigned SUB_BUCKET_BITS = 4;
+    static constexpr uint64_t SUB_BUCKETS = uint64_t{1} << SUB_BUCKET_BITS;
+    static constexpr unsigned MAX_MAGNITUDE = 36;  // Values from 2^36 us are counted in the last bucket
+    static constexpr size_t BUCKET_COUNT = (MAX_MAGNITUDE - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    static size_t bucket_of(uint64_t value) noexcept;
+    static uint64_t bucket_upper_bound(size_t bucket) noexcept;
+
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT> buckets_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> total_{0};
+    std::atomic<uint64_t> max_{0};
+};
+
+/**
+ * @class MetricsRegistry
+ * @brief Process-wide counters and latency histograms of the request path.
+ *
+ * A request's time is split into the stages it passes through: the wait in
+ * the engine scheduler's queue, the command running in the engine, response
+ * serialization and the pipe write. Commands also get a histogram per command
+ * name, so a slow "!analyze" does not hide in the engine time of every "r".
+ *
+ * Nothing here takes a lock: counters are sharded per thread, histograms are
+ * arrays of atomics, and per-command histograms are found in a fixed-size
+ * open-addressed table whose slots are claimed with a compare-and-swap and
+ * never freed until the registry goes away.
+ */
+class MetricsRegistry {
+public:
+    enum class Counter : uint8_t {
+        PipeConnections,
+        PipeDisconnections,
+        PipeMessages,
+        PipeErrors,
+        FramesReceived,
+        FramesSent,
+        BytesReceived,
+        BytesSent,
+        McpRequests,
+        CommandsExecuted,
+        CommandsSucceeded,
+        CommandsFailed,
+        CommandsTimedOut,
+        ResultCacheHits,
+        ResultCacheMisses,
+        CommandTimeMs,
+        ExtensionCommands,
+        ExtensionCommandsSucceeded,
+        ExtensionCommandsFailed,
+        EventsPushed,
+        EventsDropped,
+        SymbolModulesLoaded,
+        SymbolModulesFailed,
+        SymbolPrefetches,
+        AuthFailures,
+        HeapBytesScanned,
+        RequestsRejected,
+        ConnectionsRejected,
+        CommandPrefetches,
+        PrefetchHits,
+        PrefetchesYielded,
+        Count
+    };
+
+    enum class Stage : uint8_t {
+        QueueWait,      // Submission to the engine scheduler until the job starts
+        EngineTime,     // A command running in the debugger engine
+        Serialization,  // Encoding a response frame
+        PipeWrite,      // Writing a frame until the client has taken it
+        Request,        // A request from its arrival until its response is written
+        Count
+    };
+
+    static constexpr size_t COUNTER_COUNT = static_cast<size_t>(Counter::Count);
+    static constexpr size_t STAGE_COUNT = static_cast<size_t>(Stage::Count);
+
+    struct CommandSummary {
+        std::string command;
+        uint64_t failures{0};
+        HdrHistogram::Summary latency;
+    };
+
+    struct Snapshot {
+        std::chrono::milliseconds uptime{0};
+        std::array<uint64_t, COUNTER_COUNT> counters{};
+        std::array<HdrHistogram::Summary, STAGE_COUNT> stages{};
+        std::vector<CommandSummary> commands;   // Most total time first
+    };
+
+    static MetricsRegistry& instance();
+
+    void increment(Counter counter, uint64_t amount = 1) noexcept {
+        counters_[static_cast<size_t>(counter)].add(amount);
+    }
+    uint64_t value(Counter counter) const noexcept {
+        return counters_[static_cast<size_t>(counter)].value();
+    }
+    void reset(Counter counter) noexcept { counters_[static_cast<size_t>(counter)].reset(); }
+
+    void record(Stage stage, std::chrono::steady_clock::duration elapsed) noexcept;
+
+    /**
+     * @brief Records one execution of a command under its lower-cased name.
+     *
+     * @param[in] command_name First token of the command
+     * @param[in] elapsed Time the command ran in the engine
+     * @param[in] succeeded Whether the command succeeded
+     */
+    void record_command(std::string_view command_name, std::chrono::steady_clock::duration elapsed, bool succeeded);
+
+    Snapshot snapshot() const;
+    void reset();
+
+    static std::string_view counter_name(Counter counter) noexcept;
+    static std::string_view stage_name(Stage stage) noexcept;
+    static nlohmann::json to_json(const Snapshot& snapshot);
+
+private:
+    static constexpr size_t COMMAND_SLOTS = 256;     // Commands past this share the "(other)" entry
+    static constexpr size_t MAX_COMMAND_NAME = 32;
+
+    struct CommandMetrics {
+        std::string name;
+        HdrHistogram latency;
+        ShardedCounter failures;
+    };
+
+    MetricsRegistry();
+    ~MetricsRegistry();
+
+    CommandMetrics& command_metrics(std::string_view command_name);
+
+    std::chrono::steady_clock::time_point start_time_;
+    std::array<ShardedCounter, COUNTER_COUNT> counters_;
+    std::array<HdrHistogram, STAGE_COUNT> stages_;
+    std::array<std::atomic<CommandMetrics*>, COMMAND_SLOTS> commands_{};
+    CommandMetrics other_commands_;
+};
+
+/**
+ * @brief Records the time from construction to destruction as one stage.
+ */
+class StageTimer {
+public:
+    explicit StageTimer(MetricsRegistry::Stage stage) noexcept
+        : stage_(stage), start_(std::chrono::steady_clock::now()) {}
+
+    ~StageTimer() { MetricsRegistry::instance().record(stage_, std::chrono::steady_clock::now() - start_); }
+
+    StageTimer(const StageTimer&) = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+
+private:
+    MetricsRegistry::Stage stage_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+} // namespace vibedbg::utils
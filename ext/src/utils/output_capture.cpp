@@ -1,10 +1,14 @@
 #include "pch.h"
 #include "output_capture.h"
 #include "constants.h"
+#include "pattern_matcher.h"
 
 OutputCapture::OutputCapture() : ref_count_(1) {
 }
 
+OutputCapture::OutputCapture(ChunkSink sink) : sink_(std::move(sink)), ref_count_(1) {
+}
+
 OutputCapture::~OutputCapture() = default;
 
 STDMETHODIMP OutputCapture::QueryInterface(REFIID InterfaceId, PVOID* Interface) {
@@ -41,117 +45,254 @@ STDMETHODIMP OutputCapture::Output([[maybe_unused]] ULONG Mask, PCSTR Text) {
         return S_OK;
     }
 
+    std::string_view text(Text);
     std::lock_guard<std::mutex> lock(output_mutex_);
     
-    // Prevent output buffer from growing too large
-    if (output_.size() + strlen(Text) > Constants::MAX_OUTPUT_SIZE) {
-        output_ += "\n[Output truncated - maximum size exceeded]\n";
+    // Prevent output buffer from growing too large; a streaming capture
+    // drains the buffer instead, so only unstreamed output counts
+    if (truncated_) {
+        return S_OK;
+    }
+    if (filter_) {
+        filtered_.clear();
+        ProcessOutputText(text);
+        KeepFiltered();
+        return S_OK;
+    }
+    if (!sink_ && buffered_size_ + text.size() > Constants::MAX_OUTPUT_SIZE) {
+        Append("\n[Output truncated - maximum size exceeded]\n");
+        truncated_ = true;
         return S_OK;
     }
 
-    ProcessOutputText(std::string(Text));
+    ProcessOutputText(text);
     return S_OK;
 }
 
 std::string OutputCapture::GetOutput() const {
     std::lock_guard<std::mutex> lock(output_mutex_);
-    return output_;
+    return JoinChunks();
+}
+
+std::string OutputCapture::TakeOutput() {
+    std::lock_guard<std::mutex> lock(output_mutex_);
+    std::string output = JoinChunks();
+    ReleaseChunks();
+    return output;
+}
+
+size_t OutputCapture::GetStreamedBytes() const {
+    std::lock_guard<std::mutex> lock(output_mutex_);
+    return streamed_bytes_;
 }
 
 void OutputCapture::Clear() {
     std::lock_guard<std::mutex> lock(output_mutex_);
-    output_.clear();
+    ReleaseChunks();
+    filter_stream_ = filter_ ? vibedbg::utils::OutputFilter::Stream(*filter_) : vibedbg::utils::OutputFilter::Stream();
+    streamed_bytes_ = 0;
+    extension_error_ = false;
+    export_error_ = false;
+    truncated_ = false;
+}
+
+void OutputCapture::Reset(ChunkSink sink, std::shared_ptr<const vibedbg::utils::OutputFilter> filter) {
+    std::lock_guard<std::mutex> lock(output_mutex_);
+    ReleaseChunks();
+    sink_ = std::move(sink);
+    filter_ = std::move(filter);
+    filter_stream_ = filter_ ? vibedbg::utils::OutputFilter::Stream(*filter_) : vibedbg::utils::OutputFilter::Stream();
+    streamed_bytes_ = 0;
     extension_error_ = false;
     export_error_ = false;
+    truncated_ = false;
 }
 
-void OutputCapture::ProcessOutputText(const std::string& text) {
-    if (IsWarningMessage(text)) {
-        output_ += "Note: " + text + "\n";
-    } else if (IsExtensionError(text)) {
+void OutputCapture::Finish() {
+    std::lock_guard<std::mutex> lock(output_mutex_);
+    if (!filter_ || truncated_) {
+        return;
+    }
+    filtered_.clear();
+    filter_stream_.finish(&filtered_);
+    KeepFiltered();
+}
+
+void OutputCapture::ProcessOutputText(std::string_view text) {
+    switch (Classify(text)) {
+    case TextKind::Warning:
+        Emit("Note: ");
+        Emit(text);
+        Emit("\n");
+        break;
+    case TextKind::ExtensionError:
         if (!extension_error_) {
-            output_ += FormatErrorMessage(text);
+            Emit(FormatErrorMessage(TextKind::ExtensionError, text));
             extension_error_ = true;
         }
-    } else if (IsExportError(text)) {
+        break;
+    case TextKind::ExportError:
         if (!export_error_) {
-            output_ += FormatErrorMessage(text);
+            Emit(FormatErrorMessage(TextKind::ExportError, text));
             export_error_ = true;
         }
+        break;
+    default:
+        Emit(text);
+        break;
+    }
+}
+
+// Text the capture produces goes through the filter when there is one
+void OutputCapture::Emit(std::string_view text) {
+    if (filter_) {
+        filter_stream_.write(text, &filtered_);
     } else {
-        output_ += text;
+        Append(text);
     }
 }
 
-bool OutputCapture::IsWarningMessage(const std::string& text) {
-    return text.find("WARNING: .cache forcedecodeuser is not enabled") != std::string::npos;
+// Only what the filter kept counts against the size of the capture
+void OutputCapture::KeepFiltered() {
+    if (filtered_.empty()) {
+        return;
+    }
+    if (!sink_ && buffered_size_ + filtered_.size() > Constants::MAX_OUTPUT_SIZE) {
+        Append("\n[Output truncated - maximum size exceeded]\n");
+        truncated_ = true;
+        return;
+    }
+    Append(filtered_);
 }
 
-bool OutputCapture::IsExtensionError(const std::string& text) {
-    return text.find("is not extension gallery command") != std::string::npos;
+void OutputCapture::Append(std::string_view text) {
+    while (!text.empty()) {
+        if (chunks_.empty()) {
+            chunks_.push_back(AcquireChunk());
+        }
+        Chunk& chunk = chunks_.back();
+        size_t count = (std::min)(Constants::CAPTURE_CHUNK_SIZE - chunk.size, text.size());
+        memcpy(chunk.data.get() + chunk.size, text.data(), count);
+        chunk.size += count;
+        buffered_size_ += count;
+        text.remove_prefix(count);
+        if (chunk.size == Constants::CAPTURE_CHUNK_SIZE) {
+            CloseChunk();
+        }
+    }
 }
 
-bool OutputCapture::IsExportError(const std::string& text) {
-    return text.find("No export") != std::string::npos && text.find("found") != std::string::npos;
+// Ends the full last chunk at its last line break and opens the next one with
+// the partial line; a line longer than a chunk is split
+void OutputCapture::CloseChunk() {
+    Chunk next = AcquireChunk();
+    Chunk& full = chunks_.back();
+    size_t line_end = full.view().rfind('\n');
+    if (line_end != std::string_view::npos) {
+        next.size = full.size - (line_end + 1);
+        memcpy(next.data.get(), full.data.get() + line_end + 1, next.size);
+        full.size = line_end + 1;
+    }
+    chunks_.push_back(std::move(next));
+
+    if (sink_) {
+        FlushToSink();
+    }
 }
 
-std::string OutputCapture::FormatErrorMessage(const std::string& text) {
-    if (IsExtensionError(text)) {
-        auto pos = text.find(" is not extension gallery command");
-        if (pos != std::string::npos) {
-            auto cmdName = text.substr(0, pos);
-            if (cmdName == "modinfo") {
-                return "Note: The !modinfo command is not available. Using alternative lmv command instead.\n";
-            } else {
-                return "Error: Command '" + cmdName + "' is not available. Make sure the required extension is loaded.\n";
-            }
-        }
-    } else if (IsExportError(text)) {
-        auto pos = text.find(" found");
-        if (pos != std::string::npos) {
-            auto cmdName = text.substr(9, pos - 9);  // Extract name after "No export "
-            return "Note: Command '" + cmdName + "' is not available in the current debugging context.\n";
+// Streams every closed chunk, each in one call; the open chunk stays
+// buffered. If the sink refuses a chunk, capture falls back to buffering.
+void OutputCapture::FlushToSink() {
+    size_t flushed = 0;
+    while (flushed + 1 < chunks_.size()) {
+        Chunk& chunk = chunks_[flushed];
+        if (!sink_(chunk.view())) {
+            sink_ = nullptr;
+            break;
         }
+        streamed_bytes_ += chunk.size;
+        buffered_size_ -= chunk.size;
+        chunk.size = 0;
+        spare_chunks_.push_back(std::move(chunk));
+        ++flushed;
     }
-    return text;
+    chunks_.erase(chunks_.begin(), chunks_.begin() + flushed);
 }
 
-// OutputCaptureHelper implementation
-OutputCaptureHelper::OutputCaptureHelper(IDebugClient* debug_client) 
-    : debug_client_(debug_client), output_capture_(nullptr), previous_callbacks_(nullptr) {
-    
-    if (!debug_client_) {
-        return;
+// The only copy between capture and response: one pass over the chunks
+std::string OutputCapture::JoinChunks() const {
+    std::string output(buffered_size_, '\0');
+    size_t offset = 0;
+    for (const Chunk& chunk : chunks_) {
+        memcpy(output.data() + offset, chunk.data.get(), chunk.size);
+        offset += chunk.size;
     }
+    return output;
+}
 
-    // Create output capture instance
-    output_capture_ = new OutputCapture();
-    
-    // Get current callbacks to restore later
-    debug_client_->GetOutputCallbacks(&previous_callbacks_);
-    
-    // Set our capture callbacks
-    debug_client_->SetOutputCallbacks(output_capture_);
+OutputCapture::Chunk OutputCapture::AcquireChunk() {
+    if (!spare_chunks_.empty()) {
+        Chunk chunk = std::move(spare_chunks_.back());
+        spare_chunks_.pop_back();
+        return chunk;
+    }
+    return Chunk{std::make_unique_for_overwrite<char[]>(Constants::CAPTURE_CHUNK_SIZE), 0};
 }
 
-OutputCaptureHelper::~OutputCaptureHelper() {
-    if (debug_client_) {
-        // Restore previous callbacks
-        debug_client_->SetOutputCallbacks(previous_callbacks_);
-        
-        if (previous_callbacks_) {
-            previous_callbacks_->Release();
+// Keep a typical command's worth of chunks; don't pin a huge capture forever
+void OutputCapture::ReleaseChunks() {
+    constexpr size_t RETAINED_CHUNKS = Constants::CAPTURE_BUFFER_RETAIN_SIZE / Constants::CAPTURE_CHUNK_SIZE;
+    for (Chunk& chunk : chunks_) {
+        if (spare_chunks_.size() >= RETAINED_CHUNKS) {
+            break;
         }
+        chunk.size = 0;
+        spare_chunks_.push_back(std::move(chunk));
     }
-    
-    if (output_capture_) {
-        output_capture_->Release();
+    chunks_.clear();
+    buffered_size_ = 0;
+}
+
+// One pass over the text finds every message that is rewritten
+OutputCapture::TextKind OutputCapture::Classify(std::string_view text) {
+    enum : uint64_t { WARNING = 1 << 0, EXTENSION_ERROR = 1 << 1, NO_EXPORT = 1 << 2, FOUND = 1 << 3 };
+    static const vibedbg::utils::PatternMatcher matcher({
+        "WARNING: .cache forcedecodeuser is not enabled",
+        "is not extension gallery command",
+        "No export",
+        "found",
+    });
+
+    uint64_t found = matcher.match(text);
+    if (found & WARNING) {
+        return TextKind::Warning;
+    }
+    if (found & EXTENSION_ERROR) {
+        return TextKind::ExtensionError;
     }
+    if ((found & (NO_EXPORT | FOUND)) == (NO_EXPORT | FOUND)) {
+        return TextKind::ExportError;
+    }
+    return TextKind::Plain;
 }
 
-std::string OutputCaptureHelper::GetCapturedOutput() const {
-    if (output_capture_) {
-        return output_capture_->GetOutput();
+std::string OutputCapture::FormatErrorMessage(TextKind kind, std::string_view text) {
+    if (kind == TextKind::ExtensionError) {
+        auto pos = text.find(" is not extension gallery command");
+        if (pos != std::string_view::npos) {
+            std::string cmdName(text.substr(0, pos));
+            if (cmdName == "modinfo") {
+                return "Note: The !modinfo command is not available. Using alternative lmv command instead.\n";
+            } else {
+                return "Error: Command '" + cmdName + "' is not available. Make sure the required extension is loaded.\n";
+            }
+        }
+    } else if (kind == TextKind::ExportError) {
+        auto pos = text.find(" found");
+        if (pos != std::string_view::npos && pos >= 9) {
+            std::string cmdName(text.substr(9, pos - 9));  // Extract name after "No export "
+            return "Note: Command '" + cmdName + "' is not available in the current debugging context.\n";
+        }
     }
-    return "";
-}
\ No newline at end of file
+    return std::string(text);
+}
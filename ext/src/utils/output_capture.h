@@ -1,15 +1,33 @@
 #pragma once
 
 #include "pch.h"
+#include "output_filter.h"
 #include <string>
+#include <string_view>
+#include <functional>
+#include <memory>
+#include <vector>
 
 /**
  * @class OutputCapture
  * @brief Implements IDebugOutputCallbacks to capture debugger output.
+ *
+ * Output is appended to an arena of fixed-size chunks, so growing the capture
+ * never moves what was already captured. A full chunk is closed at its last
+ * line break and the partial line carries over to the next chunk; closed
+ * chunks of a streaming capture go to the sink as they are, and the output of
+ * a buffered capture is gathered into a string once, when it is taken.
+ *
+ * With an output filter installed, text goes through the filter first; what
+ * it drops is never buffered or streamed.
  */
 class OutputCapture : public IDebugOutputCallbacks {
 public:
+    // Receives completed lines while a command runs; returns false to stop streaming
+    using ChunkSink = std::function<bool(std::string_view chunk)>;
+
     OutputCapture();
+    explicit OutputCapture(ChunkSink sink);
     virtual ~OutputCapture();
 
     // IUnknown methods
@@ -22,36 +40,51 @@ public:
 
     // Get captured output
     std::string GetOutput() const;
+    std::string TakeOutput();   // Empties the capture, keeping its chunks for reuse
+    size_t GetStreamedBytes() const;
     void Clear();
 
+    // Prepare for the next command; the buffer's allocation is kept for reuse
+    void Reset(ChunkSink sink, std::shared_ptr<const vibedbg::utils::OutputFilter> filter = nullptr);
+
+    // The command has ended; keeps what the filter held back for its last lines
+    void Finish();
+
 private:
-    std::string output_;
+    struct Chunk {
+        std::unique_ptr<char[]> data;
+        size_t size{0};
+
+        std::string_view view() const noexcept { return {data.get(), size}; }
+    };
+
+    // What the callback text is, as far as the rewriting of known messages goes
+    enum class TextKind { Plain, Warning, ExtensionError, ExportError };
+
+    std::vector<Chunk> chunks_;         // Oldest first; the last one is being filled
+    std::vector<Chunk> spare_chunks_;   // Kept between commands, up to CAPTURE_BUFFER_RETAIN_SIZE
+    size_t buffered_size_{0};           // Bytes in chunks_
+    ChunkSink sink_;
+    size_t streamed_bytes_{0};
     LONG ref_count_;
     mutable std::mutex output_mutex_;
     bool extension_error_{false};
     bool export_error_{false};
+    bool truncated_{false};
+    std::shared_ptr<const vibedbg::utils::OutputFilter> filter_;
+    vibedbg::utils::OutputFilter::Stream filter_stream_;
+    std::string filtered_;              // What the filter kept of the current callback
     
     // Helper methods for intelligent output processing
-    void ProcessOutputText(const std::string& text);
-    bool IsWarningMessage(const std::string& text);
-    bool IsExtensionError(const std::string& text);
-    bool IsExportError(const std::string& text);
-    std::string FormatErrorMessage(const std::string& text);
+    void ProcessOutputText(std::string_view text);
+    void Emit(std::string_view text);
+    void KeepFiltered();
+    void Append(std::string_view text);
+    void CloseChunk();
+    void FlushToSink();
+    std::string JoinChunks() const;
+    Chunk AcquireChunk();
+    void ReleaseChunks();
+    static TextKind Classify(std::string_view text);
+    static std::string FormatErrorMessage(TextKind kind, std::string_view text);
 };
-
-/**
- * @class OutputCaptureHelper
- * @brief Helper class for automatic output capture management.
- */
-class OutputCaptureHelper {
-public:
-    OutputCaptureHelper(IDebugClient* debug_client);
-    ~OutputCaptureHelper();
-
-    std::string GetCapturedOutput() const;
-
-private:
-    IDebugClient* debug_client_;
-    OutputCapture* output_capture_;
-    IDebugOutputCallbacks* previous_callbacks_;
-};
\ No newline at end of file
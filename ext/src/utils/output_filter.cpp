@@ -0,0 +1,287 @@
+#include "pch.h"
+#include "output_filter.h"
+#include "constants.h"
+#include <array>
+
+using namespace vibedbg::utils;
+
+namespace {
+    // Limits are positive JSON integers; returns false if the key holds anything else
+    bool read_limit(const nlohmann::json& parameters, const char* key, size_t* value) {
+        auto it = parameters.find(key);
+        if (it == parameters.end()) {
+            return true;
+        }
+        if (it->is_number_unsigned()) {
+            *value = static_cast<size_t>((std::min<uint64_t>)(it->get<uint64_t>(), SIZE_MAX));
+        } else if (it->is_number_integer() && it->get<int64_t>() > 0) {
+            *value = static_cast<size_t>(it->get<int64_t>());
+        } else {
+            return false;
+        }
+        return *value > 0;
+    }
+
+    bool is_blank(char c) noexcept {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+    }
+}
+
+/**
+ * @brief Builds the filter a request's parameters ask for.
+ *
+ * - grep: a string or an array of strings; a line is kept if it contains any
+ * - head, tail: number of lines kept from the start or the end
+ * - max_bytes: bytes of filtered output at most
+ * - fields: zero-based whitespace-separated columns kept of each line
+ *
+ * @param[in] parameters Request parameters
+ * @param[out] error Reason the parameters were rejected
+ *
+ * @return The filter, or nullptr when none is asked for or the parameters are
+ *         invalid; error is set in the latter case
+ */
+std::shared_ptr<const OutputFilter> OutputFilter::from_parameters(
+    _In_ const nlohmann::json& parameters,
+    _Out_opt_ std::string* error) {
+
+    if (error) error->clear();
+    auto fail = [error](std::string message) -> std::shared_ptr<const OutputFilter> {
+        if (error) *error = std::move(message);
+        return nullptr;
+    };
+
+    if (!parameters.is_object()) {
+        return nullptr;
+    }
+
+    auto filter = std::make_shared<OutputFilter>();
+    bool filtering = false;
+
+    if (auto grep = parameters.find("grep"); grep != parameters.end()) {
+        if (grep->is_string()) {
+            filter->patterns_.push_back(grep->get<std::string>());
+        } else if (grep->is_array()) {
+            for (const auto& pattern : *grep) {
+                if (!pattern.is_string()) {
+                    return fail("grep patterns must be strings");
+                }
+                filter->patterns_.push_back(pattern.get<std::string>());
+            }
+        } else {
+            return fail("grep must be a string or an array of strings");
+        }
+        if (filter->patterns_.empty() || filter->patterns_.size() > PatternMatcher::MAX_PATTERNS) {
+            return fail(std::format("grep takes 1 to {} patterns", PatternMatcher::MAX_PATTERNS));
+        }
+        for (const auto& pattern : filter->patterns_) {
+            if (pattern.empty() || pattern.size() > Constants::MAX_GREP_PATTERN_LENGTH) {
+                return fail(std::format("grep patterns must be 1 to {} characters", Constants::MAX_GREP_PATTERN_LENGTH));
+            }
+        }
+        std::vector<std::string_view> patterns(filter->patterns_.begin(), filter->patterns_.end());
+        filter->matcher_ = PatternMatcher(patterns);
+        filtering = true;
+    }
+
+    for (auto [key, limit] : {std::pair{"head", &filter->head_}, std::pair{"tail", &filter->tail_},
+                              std::pair{"max_bytes", &filter->max_bytes_}}) {
+        if (!read_limit(parameters, key, limit)) {
+            return fail(std::string(key) + " must be a positive integer");
+        }
+        filtering = filtering || *limit > 0;
+    }
+
+    if (auto fields = parameters.find("fields"); fields != parameters.end()) {
+        if (!fields->is_array() || fields->empty() || fields->size() > Constants::MAX_OUTPUT_FIELDS) {
+            return fail(std::format("fields must be an array of 1 to {} column indexes", Constants::MAX_OUTPUT_FIELDS));
+        }
+        for (const auto& field : *fields) {
+            if (!field.is_number_integer() || field.get<int64_t>() < 0 ||
+                field.get<int64_t>() >= static_cast<int64_t>(Constants::MAX_OUTPUT_FIELDS)) {
+                return fail(std::format("fields are column indexes from 0 to {}", Constants::MAX_OUTPUT_FIELDS - 1));
+            }
+            filter->fields_.push_back(static_cast<size_t>(field.get<int64_t>()));
+        }
+        filtering = true;
+    }
+
+    if (!filtering) {
+        return nullptr;
+    }
+    return filter;
+}
+
+std::string OutputFilter::apply(std::string_view text) const {
+    Stream stream(*this);
+    std::string kept;
+    stream.write(text, &kept);
+    stream.finish(&kept);
+    return kept;
+}
+
+std::string_view OutputFilter::select(std::string_view line, std::string* scratch) const {
+    if (!matcher_.empty() && matcher_.match(line) == 0) {
+        return {};
+    }
+    if (fields_.empty()) {
+        return line;
+    }
+
+    std::array<std::string_view, Constants::MAX_OUTPUT_FIELDS> columns;
+    size_t column_count = 0;
+    size_t position = 0;
+    while (column_count < columns.size()) {
+        while (position < line.size() && is_blank(line[position])) {
+            ++position;
+        }
+        if (position == line.size()) {
+            break;
+        }
+        size_t start = position;
+        while (position < line.size() && !is_blank(line[position])) {
+            ++position;
+        }
+        columns[column_count++] = line.substr(start, position - start);
+    }
+
+    scratch->clear();
+    for (size_t field : fields_) {
+        if (field < column_count) {
+            if (!scratch->empty()) {
+                scratch->push_back(' ');
+            }
+            scratch->append(columns[field]);
+        }
+    }
+    if (scratch->empty()) {
+        return {};
+    }
+    if (line.back() == '\n') {
+        scratch->push_back('\n');
+    }
+    return *scratch;
+}
+
+/**
+ * @brief Filters the next piece of output.
+ *
+ * Text whose lines contain no grep pattern at all is dropped without being
+ * split into lines; only its unterminated end is held for the next piece.
+ *
+ * @param[in] text Output as the debugger wrote it
+ * @param[out] kept Receives the kept lines, appended
+ */
+void OutputFilter::Stream::write(_In_ std::string_view text, _Inout_ std::string* kept) {
+    if (!filter_) {
+        kept->append(text);
+        return;
+    }
+
+    if (partial_.empty() && !filter_->matcher_.empty() && filter_->matcher_.match(text) == 0) {
+        size_t last_line_end = text.rfind('\n');
+        partial_.assign(last_line_end == std::string_view::npos ? text : text.substr(last_line_end + 1));
+        return;
+    }
+
+    while (!text.empty()) {
+        size_t line_end = text.find('\n');
+        if (line_end == std::string_view::npos) {
+            // A line is never held back beyond what a capture could buffer
+            partial_.append(text);
+            if (partial_.size() >= Constants::MAX_OUTPUT_SIZE) {
+                take_line(partial_, kept);
+                partial_.clear();
+            }
+            return;
+        }
+
+        std::string_view line = text.substr(0, line_end + 1);
+        text.remove_prefix(line_end + 1);
+        if (partial_.empty()) {
+            take_line(line, kept);
+        } else {
+            partial_.append(line);
+            take_line(partial_, kept);
+            partial_.clear();
+        }
+    }
+}
+
+/**
+ * @brief Ends the output: the held back line and tail lines are kept.
+ *
+ * @param[out] kept Receives the rest of the filtered output, appended
+ */
+void OutputFilter::Stream::finish(_Inout_ std::string* kept) {
+    if (!filter_) {
+        return;
+    }
+
+    if (!partial_.empty()) {
+        take_line(partial_, kept);
+        partial_.clear();
+    }
+    for (const auto& line : tail_lines_) {
+        keep(line, kept);
+    }
+
+    // Dropping lines grep did not select is the point of a filter; lines it
+    // did select but that were cut off are worth knowing about
+    if (lines_omitted_ > 0) {
+        if (line_open_) {
+            kept->push_back('\n');
+        }
+        *kept += "[Output filter: " + std::to_string(lines_omitted_) + " more lines not shown]\n";
+    }
+
+    tail_lines_.clear();
+    tail_bytes_ = 0;
+    lines_selected_ = 0;
+    bytes_kept_ = 0;
+    lines_omitted_ = 0;
+    line_open_ = false;
+}
+
+void OutputFilter::Stream::take_line(std::string_view line, std::string* kept) {
+    std::string_view selected = filter_->select(line, &scratch_);
+    if (selected.empty()) {
+        return;
+    }
+
+    ++lines_selected_;
+    if (filter_->head_ > 0 && lines_selected_ > filter_->head_) {
+        ++lines_omitted_;
+        return;
+    }
+
+    if (filter_->tail_ > 0) {
+        tail_lines_.emplace_back(selected);
+        tail_bytes_ += selected.size();
+        while (tail_lines_.size() > filter_->tail_ || tail_bytes_ > Constants::MAX_OUTPUT_SIZE) {
+            tail_bytes_ -= tail_lines_.front().size();
+            tail_lines_.pop_front();
+            ++lines_omitted_;
+        }
+        return;
+    }
+
+    keep(selected, kept);
+}
+
+// Keeps a selected line within max_bytes; the line that reaches the limit is cut
+void OutputFilter::Stream::keep(std::string_view line, std::string* kept) {
+    if (filter_->max_bytes_ > 0) {
+        size_t room = filter_->max_bytes_ - bytes_kept_;
+        if (line.size() > room) {
+            ++lines_omitted_;
+            if (room == 0) {
+                return;
+            }
+            line = line.substr(0, room);
+        }
+    }
+    kept->append(line);
+    bytes_kept_ += line.size();
+    line_open_ = line.back() != '\n';
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "../pch.h"
+#include "pattern_matcher.h"
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace vibedbg::utils {
+
+/**
+ * @class OutputFilter
+ * @brief Slice of command output a client asked for, applied line by line.
+ *
+ * Built from the grep, head, tail, max_bytes and fields request parameters
+ * and applied in that order of concern: a line is kept when it contains any
+ * grep pattern and is cut down to the requested fields, head keeps the first
+ * lines that remain, tail the last of those, and max_bytes caps the text that
+ * results. The filter is immutable and shared by every command of a request;
+ * each command runs its output through a Stream of its own.
+ */
+class OutputFilter {
+public:
+    class Stream;
+
+    /**
+     * @brief Builds the filter a request's parameters ask for.
+     *
+     * @param[in] parameters Request parameters
+     * @param[out] error Reason the parameters were rejected
+     * @return The filter, or nullptr when none is asked for or the parameters
+     *         are invalid; error is set in the latter case
+     */
+    static std::shared_ptr<const OutputFilter> from_parameters(const nlohmann::json& parameters, std::string* error);
+
+    /**
+     * @brief Filters a complete output at once, as a Stream fed all of it would.
+     */
+    std::string apply(std::string_view text) const;
+
+private:
+    std::vector<std::string> patterns_;
+    PatternMatcher matcher_;            // Over patterns_; empty keeps every line
+    std::vector<size_t> fields_;        // Zero-based columns; empty keeps whole lines
+    size_t head_{0};                    // 0 for no limit, as for tail_ and max_bytes_
+    size_t tail_{0};
+    size_t max_bytes_{0};
+
+    // The line as it is kept, or an empty view if grep drops it; a projected
+    // line is built in scratch
+    std::string_view select(std::string_view line, std::string* scratch) const;
+};
+
+/**
+ * @class OutputFilter::Stream
+ * @brief Filters output that arrives in arbitrary pieces.
+ *
+ * Text is held back only while its line is incomplete, or while it may still
+ * be among the last lines tail keeps. The filter must outlive the stream.
+ */
+class OutputFilter::Stream {
+public:
+    Stream() = default;
+    explicit Stream(const OutputFilter& filter) : filter_(&filter) {}
+
+    bool active() const noexcept { return filter_ != nullptr; }
+
+    // Appends the text of every complete line that is kept to kept
+    void write(std::string_view text, std::string* kept);
+
+    // Appends what was held back and a note of the lines left out; the
+    // stream starts over afterwards
+    void finish(std::string* kept);
+
+private:
+    const OutputFilter* filter_{nullptr};
+    std::string partial_;                   // Start of a line not yet terminated
+    std::string scratch_;                   // Projection of the current line
+    std::deque<std::string> tail_lines_;
+    size_t tail_bytes_{0};
+    size_t lines_selected_{0};              // Lines grep kept, before head and tail
+    size_t bytes_kept_{0};
+    size_t lines_omitted_{0};               // Selected lines cut by head, tail or max_bytes
+    bool line_open_{false};                 // The last text kept did not end a line
+
+    void take_line(std::string_view line, std::string* kept);
+    void keep(std::string_view line, std::string* kept);
+};
+
+} // namespace vibedbg::utils
@@ -0,0 +1,197 @@
+#include "pch.h"
+#include "pattern_matcher.h"
+#include <bit>
+#include <queue>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define VIBEDBG_PATTERN_MATCHER_SSE2 1
+#endif
+
+using namespace vibedbg::utils;
+
+namespace {
+    constexpr uint32_t NO_STATE = UINT32_MAX;
+
+    unsigned char fold(unsigned char c, bool ignore_case) noexcept {
+        return (ignore_case && c >= 'A' && c <= 'Z') ? static_cast<unsigned char>(c - 'A' + 'a') : c;
+    }
+}
+
+PatternMatcher::PatternMatcher(std::initializer_list<std::string_view> patterns, bool ignore_case) {
+    build(patterns.begin(), patterns.size(), ignore_case);
+}
+
+PatternMatcher::PatternMatcher(const std::vector<std::string_view>& patterns, bool ignore_case) {
+    build(patterns.data(), patterns.size(), ignore_case);
+}
+
+void PatternMatcher::build(const std::string_view* patterns, size_t count, bool ignore_case) {
+    count = (std::min)(count, MAX_PATTERNS);
+
+    // Bytes that no pattern contains all behave alike, so they share class 0
+    for (size_t i = 0; i < count; ++i) {
+        for (char c : patterns[i]) {
+            unsigned char folded = fold(static_cast<unsigned char>(c), ignore_case);
+            if (byte_class_[folded] == 0) {
+                byte_class_[folded] = static_cast<uint16_t>(class_count_++);
+            }
+        }
+    }
+    if (ignore_case) {
+        for (unsigned char c = 'A'; c <= 'Z'; ++c) {
+            byte_class_[c] = byte_class_[fold(c, true)];
+        }
+    }
+
+    // Trie of the patterns
+    transitions_.assign(class_count_, NO_STATE);
+    outputs_.assign(1, 0);
+    for (size_t i = 0; i < count; ++i) {
+        if (patterns[i].empty()) {
+            continue;
+        }
+        State state = 0;
+        for (char c : patterns[i]) {
+            size_t edge = state * class_count_ + byte_class_[static_cast<unsigned char>(c)];
+            if (transitions_[edge] == NO_STATE) {
+                transitions_[edge] = static_cast<State>(outputs_.size());
+                transitions_.resize(transitions_.size() + class_count_, NO_STATE);
+                outputs_.push_back(0);
+            }
+            state = transitions_[edge];
+        }
+        outputs_[state] |= uint64_t{1} << i;
+        pattern_mask_ |= uint64_t{1} << i;
+    }
+
+    // The byte pairs patterns start with; a handful of them is searched for
+    // 16 positions at a time. Any one-byte pattern leaves the scalar skip.
+    bool vectorizable = true;
+    for (size_t first = 0; first < 256 && vectorizable; ++first) {
+        State child = transitions_[byte_class_[first]];
+        if (child == NO_STATE) {
+            continue;
+        }
+        if (outputs_[child] != 0) {
+            vectorizable = false;
+            break;
+        }
+        for (size_t second = 0; second < 256; ++second) {
+            if (transitions_[child * class_count_ + byte_class_[second]] == NO_STATE) {
+                continue;
+            }
+            if (start_pair_count_ == MAX_START_PAIRS) {
+                vectorizable = false;
+                break;
+            }
+            start_pairs_[start_pair_count_++] = {static_cast<unsigned char>(first), static_cast<unsigned char>(second)};
+        }
+    }
+    if (!vectorizable) {
+        start_pair_count_ = 0;
+    }
+
+    // Breadth-first, a missing transition takes the one of the longest proper
+    // suffix that is also a trie node, and a state reports every pattern that
+    // ends with the text it stands for
+    std::vector<State> failure(outputs_.size(), 0);
+    std::queue<State> pending;
+    for (size_t c = 0; c < class_count_; ++c) {
+        State& next = transitions_[c];
+        if (next == NO_STATE) {
+            next = 0;
+        } else {
+            pending.push(next);
+        }
+    }
+    while (!pending.empty()) {
+        State state = pending.front();
+        pending.pop();
+        for (size_t c = 0; c < class_count_; ++c) {
+            State& next = transitions_[state * class_count_ + c];
+            State fallback = transitions_[failure[state] * class_count_ + c];
+            if (next == NO_STATE) {
+                next = fallback;
+            } else {
+                failure[next] = fallback;
+                outputs_[next] |= outputs_[fallback];
+                pending.push(next);
+            }
+        }
+    }
+
+    // Store each target as its row offset, so a step is a single lookup, and
+    // flag the targets that report a pattern
+    for (State& next : transitions_) {
+        State target = next;
+        next = target * static_cast<State>(class_count_);
+        if (outputs_[target] != 0) {
+            next |= REPORTS;
+        }
+    }
+    for (size_t b = 0; b < 256; ++b) {
+        starts_pattern_[b] = transitions_[byte_class_[b]] != 0;
+    }
+}
+
+// Advances to the first position where a pattern may start
+const unsigned char* PatternMatcher::skip_to_candidate(const unsigned char* bytes, const unsigned char* end) const noexcept {
+#if VIBEDBG_PATTERN_MATCHER_SSE2
+    if (start_pair_count_ > 0) {
+        __m128i firsts[MAX_START_PAIRS];
+        __m128i seconds[MAX_START_PAIRS];
+        for (size_t i = 0; i < start_pair_count_; ++i) {
+            firsts[i] = _mm_set1_epi8(static_cast<char>(start_pairs_[i][0]));
+            seconds[i] = _mm_set1_epi8(static_cast<char>(start_pairs_[i][1]));
+        }
+        while (end - bytes > 16) {
+            __m128i current = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes));
+            __m128i following = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + 1));
+            __m128i hits = _mm_setzero_si128();
+            for (size_t i = 0; i < start_pair_count_; ++i) {
+                hits = _mm_or_si128(hits, _mm_and_si128(_mm_cmpeq_epi8(current, firsts[i]),
+                                                        _mm_cmpeq_epi8(following, seconds[i])));
+            }
+            if (int mask = _mm_movemask_epi8(hits)) {
+                return bytes + std::countr_zero(static_cast<unsigned>(mask));
+            }
+            bytes += 16;
+        }
+    }
+#endif
+    while (bytes != end && !starts_pattern_[*bytes]) {
+        ++bytes;
+    }
+    return bytes;
+}
+
+uint64_t PatternMatcher::match(std::string_view text) const noexcept {
+    if (pattern_mask_ == 0) {
+        return 0;
+    }
+
+    const auto* bytes = reinterpret_cast<const unsigned char*>(text.data());
+    const auto* end = bytes + text.size();
+    const State* transitions = transitions_.data();
+    uint64_t found = 0;
+    State state = 0;
+    while (bytes != end) {
+        // Most text never leaves the root; skip it without walking the table
+        if (state == 0) {
+            bytes = skip_to_candidate(bytes, end);
+            if (bytes == end) {
+                break;
+            }
+        }
+        State next = transitions[state + byte_class_[*bytes++]];
+        state = next & ~REPORTS;
+        if (next & REPORTS) {
+            found |= outputs_[state / class_count_];
+            if (found == pattern_mask_) {
+                break;
+            }
+        }
+    }
+    return found;
+}
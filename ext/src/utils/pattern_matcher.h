@@ -0,0 +1,64 @@
+#pragma once
+
+#include "../pch.h"
+#include <array>
+#include <initializer_list>
+#include <string_view>
+#include <vector>
+
+namespace vibedbg::utils {
+
+/**
+ * @class PatternMatcher
+ * @brief Finds which of a fixed set of substrings occur in a text, in one pass.
+ *
+ * The patterns are compiled into an Aho-Corasick automaton whose transitions
+ * are a dense table over the bytes that occur in the patterns; every other
+ * byte shares one column. Scanning is a table lookup per input byte no matter
+ * how many patterns there are, and stops as soon as every pattern was seen.
+ * While no pattern is partly matched, text is skipped 16 bytes at a time up
+ * to the next pair of bytes a pattern starts with.
+ */
+class PatternMatcher {
+public:
+    static constexpr size_t MAX_PATTERNS = 64;
+
+    PatternMatcher() = default;
+
+    /**
+     * @brief Compiles the patterns; empty patterns and those past MAX_PATTERNS are ignored.
+     *
+     * @param[in] patterns Substrings to look for; bit i of a match refers to patterns[i]
+     * @param[in] ignore_case Match ASCII letters case-insensitively
+     */
+    explicit PatternMatcher(std::initializer_list<std::string_view> patterns, bool ignore_case = false);
+    explicit PatternMatcher(const std::vector<std::string_view>& patterns, bool ignore_case = false);
+
+    /**
+     * @brief Scans the text once.
+     *
+     * @return Bit mask of the patterns found in the text
+     */
+    uint64_t match(std::string_view text) const noexcept;
+
+    bool empty() const noexcept { return pattern_mask_ == 0; }
+
+private:
+    using State = uint32_t;
+    static constexpr State REPORTS = 0x80000000;   // Transition into a state that reports patterns
+
+    std::array<uint16_t, 256> byte_class_{};     // 0 for bytes no pattern contains
+    size_t class_count_ = 1;
+    std::array<bool, 256> starts_pattern_{};    // Bytes that leave the root state
+    static constexpr size_t MAX_START_PAIRS = 8;
+    std::array<std::array<unsigned char, 2>, MAX_START_PAIRS> start_pairs_{};
+    size_t start_pair_count_ = 0;               // 0 when the pairs are too many to search as vectors
+    std::vector<State> transitions_;            // Row offset of the next state, by row offset + class
+    std::vector<uint64_t> outputs_;             // Patterns ending at each state, suffixes included
+    uint64_t pattern_mask_ = 0;
+
+    void build(const std::string_view* patterns, size_t count, bool ignore_case);
+    const unsigned char* skip_to_candidate(const unsigned char* bytes, const unsigned char* end) const noexcept;
+};
+
+} // namespace vibedbg::utils
@@ -0,0 +1,112 @@
+#include "pch.h"
+#include "../../inc/request_tracing.h"
+#include <TraceLoggingProvider.h>
+#include <winmeta.h>
+
+using namespace vibedbg::utils;
+
+TRACELOGGING_DEFINE_PROVIDER(
+    g_vibedbg_provider,
+    "VibeDbg",
+    (0x9d255b09, 0x7cd8, 0x5037, 0x6d, 0x51, 0x8d, 0x64, 0xd7, 0xbc, 0xf2, 0xc9));
+
+namespace {
+    std::atomic<bool> registered{false};
+
+    // Event names and opcodes are compiled into the event metadata, so each
+    // stage gets its own start and stop write
+#define VIBEDBG_WRITE_STAGE(name, opcode) \
+    TraceLoggingWriteActivity(g_vibedbg_provider, name, activity_id, nullptr, \
+        TraceLoggingOpcode(opcode), \
+        TraceLoggingLevel(WINEVENT_LEVEL_INFO), \
+        TraceLoggingKeyword(RequestTracing::KEYWORD_REQUEST), \
+        TraceLoggingCountedString(request_id.data(), static_cast<USHORT>((std::min)(request_id.size(), size_t{USHRT_MAX})), "RequestId"), \
+        TraceLoggingBool(succeeded, "Succeeded"))
+
+#define VIBEDBG_CASE_STAGE(stage) \
+    case TraceStage::stage: \
+        if (start) { \
+            VIBEDBG_WRITE_STAGE(#stage, WINEVENT_OPCODE_START); \
+        } else { \
+            VIBEDBG_WRITE_STAGE(#stage, WINEVENT_OPCODE_STOP); \
+        } \
+        break
+
+    void write_stage(TraceStage stage, bool start, const GUID* activity_id, std::string_view request_id, bool succeeded) {
+        switch (stage) {
+            VIBEDBG_CASE_STAGE(PipeRead);
+            VIBEDBG_CASE_STAGE(Parse);
+            VIBEDBG_CASE_STAGE(Route);
+            VIBEDBG_CASE_STAGE(Execute);
+            VIBEDBG_CASE_STAGE(Capture);
+            VIBEDBG_CASE_STAGE(Serialize);
+            VIBEDBG_CASE_STAGE(Write);
+        }
+    }
+
+#undef VIBEDBG_CASE_STAGE
+#undef VIBEDBG_WRITE_STAGE
+}
+
+void RequestTracing::register_provider() noexcept {
+    bool expected = false;
+    if (registered.compare_exchange_strong(expected, true)) {
+        TraceLoggingRegister(g_vibedbg_provider);
+    }
+}
+
+void RequestTracing::unregister_provider() noexcept {
+    bool expected = true;
+    if (registered.compare_exchange_strong(expected, false)) {
+        TraceLoggingUnregister(g_vibedbg_provider);
+    }
+}
+
+bool RequestTracing::enabled() noexcept {
+    return TraceLoggingProviderEnabled(g_vibedbg_provider, WINEVENT_LEVEL_INFO, KEYWORD_REQUEST);
+}
+
+TraceActivity::TraceActivity(TraceStage stage, std::string_view request_id) : stage_(stage) {
+    if (!RequestTracing::enabled()) {
+        return;
+    }
+    if (EventActivityIdControl(EVENT_ACTIVITY_CTRL_CREATE_ID, &activity_id_) != ERROR_SUCCESS) {
+        return;
+    }
+    active_ = true;
+    request_id_ = request_id;
+    write_stage(stage_, true, &activity_id_, request_id_, true);
+}
+
+TraceActivity::TraceActivity(TraceActivity&& other) noexcept
+    : stage_(other.stage_), active_(other.active_), failed_(other.failed_),
+      activity_id_(other.activity_id_), request_id_(std::move(other.request_id_)) {
+    other.active_ = false;
+}
+
+TraceActivity& TraceActivity::operator=(TraceActivity&& other) noexcept {
+    if (this != &other) {
+        stop();
+        stage_ = other.stage_;
+        active_ = other.active_;
+        failed_ = other.failed_;
+        activity_id_ = other.activity_id_;
+        request_id_ = std::move(other.request_id_);
+        other.active_ = false;
+    }
+    return *this;
+}
+
+void TraceActivity::set_request_id(std::string_view request_id) {
+    if (active_) {
+        request_id_ = request_id;
+    }
+}
+
+void TraceActivity::stop() noexcept {
+    if (!active_) {
+        return;
+    }
+    active_ = false;
+    write_stage(stage_, false, &activity_id_, request_id_, !failed_);
+}
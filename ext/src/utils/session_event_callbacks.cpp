@@ -0,0 +1,320 @@
+#include "pch.h"
+#include "session_event_callbacks.h"
+#include "../core/session_contexts.h"
+
+using namespace vibedbg::core;
+using vibedbg::communication::EventKind;
+
+namespace {
+    // Statuses in which the target runs; the rest, break and no debuggee
+    // among them, leave it stopped
+    bool is_running_status(ULONG status) noexcept {
+        switch (status & DEBUG_STATUS_MASK) {
+        case DEBUG_STATUS_GO:
+        case DEBUG_STATUS_GO_HANDLED:
+        case DEBUG_STATUS_GO_NOT_HANDLED:
+        case DEBUG_STATUS_STEP_OVER:
+        case DEBUG_STATUS_STEP_INTO:
+        case DEBUG_STATUS_STEP_BRANCH:
+            return true;
+        default:
+            return false;
+        }
+    }
+}
+
+SessionEventCallbacks::SessionEventCallbacks(std::weak_ptr<SessionManager> session_manager, IDebugClient* client)
+    : ref_count_(1), session_manager_(std::move(session_manager)) {
+    // Missing interfaces only leave the matching fields unset
+    client->QueryInterface(__uuidof(IDebugControl), reinterpret_cast<void**>(&control_));
+    client->QueryInterface(__uuidof(IDebugSymbols), reinterpret_cast<void**>(&symbols_));
+    client->QueryInterface(__uuidof(IDebugSystemObjects), reinterpret_cast<void**>(&system_objects_));
+}
+
+SessionEventCallbacks::~SessionEventCallbacks() {
+    if (system_objects_) {
+        system_objects_->Release();
+    }
+    if (symbols_) {
+        symbols_->Release();
+    }
+    if (control_) {
+        control_->Release();
+    }
+}
+
+void SessionEventCallbacks::refresh() {
+    update([this](SessionState& state) {
+        ULONG process_id = 0;
+        if (system_objects_ && SUCCEEDED(system_objects_->GetCurrentProcessSystemId(&process_id))) {
+            ProcessInfo process;
+            process.process_id = process_id;
+            process.is_attached = true;
+            process.attach_time = std::chrono::steady_clock::now();
+
+            char image[MAX_PATH] = {};
+            if (SUCCEEDED(system_objects_->GetCurrentProcessExecutableName(image, sizeof(image), nullptr))) {
+                process.image_path = image;
+                const char* name = strrchr(image, '\\');
+                process.process_name = name ? name + 1 : image;
+            }
+            state.current_process = std::move(process);
+        } else {
+            state.current_process.reset();
+        }
+
+        read_current_thread(state);
+
+        ULONG thread_count = 0;
+        state.thread_count = system_objects_ && SUCCEEDED(system_objects_->GetNumberThreads(&thread_count)) ? thread_count : 0;
+
+        ULONG loaded = 0;
+        ULONG unloaded = 0;
+        state.module_count = symbols_ && SUCCEEDED(symbols_->GetNumberModules(&loaded, &unloaded)) ? loaded : 0;
+
+        ULONG status = DEBUG_STATUS_NO_DEBUGGEE;
+        if (control_ && SUCCEEDED(control_->GetExecutionStatus(&status))) {
+            state.is_target_running = is_running_status(status);
+        }
+    });
+}
+
+void SessionEventCallbacks::set_event_publisher(EventPublisher publisher) {
+    std::lock_guard<std::mutex> lock(publisher_mutex_);
+    publisher_ = std::move(publisher);
+}
+
+void SessionEventCallbacks::set_stop_listener(StopListener listener) {
+    std::lock_guard<std::mutex> lock(stop_listener_mutex_);
+    stop_listener_ = std::move(listener);
+}
+
+STDMETHODIMP_(ULONG) SessionEventCallbacks::AddRef() {
+    return InterlockedIncrement(&ref_count_);
+}
+
+STDMETHODIMP_(ULONG) SessionEventCallbacks::Release() {
+    LONG result = InterlockedDecrement(&ref_count_);
+    if (result == 0) {
+        delete this;
+    }
+    return result;
+}
+
+STDMETHODIMP SessionEventCallbacks::GetInterestMask(PULONG Mask) {
+    if (!Mask) {
+        return E_POINTER;
+    }
+
+    *Mask = DEBUG_EVENT_BREAKPOINT | DEBUG_EVENT_EXCEPTION |
+            DEBUG_EVENT_CREATE_THREAD | DEBUG_EVENT_EXIT_THREAD |
+            DEBUG_EVENT_CREATE_PROCESS | DEBUG_EVENT_EXIT_PROCESS |
+            DEBUG_EVENT_LOAD_MODULE | DEBUG_EVENT_UNLOAD_MODULE |
+            DEBUG_EVENT_CHANGE_DEBUGGEE_STATE | DEBUG_EVENT_CHANGE_ENGINE_STATE;
+    return S_OK;
+}
+
+// Breakpoints and exceptions change no state; they are only published, and
+// leave the engine's handling of the event alone
+STDMETHODIMP SessionEventCallbacks::Breakpoint(PDEBUG_BREAKPOINT Bp) {
+    publish(EventKind::Breakpoint, [&]() {
+        ULONG id = DEBUG_ANY_ID;
+        ULONG64 offset = 0;
+        if (Bp) {
+            Bp->GetId(&id);
+            Bp->GetOffset(&offset);
+        }
+        return nlohmann::json{
+            {"id", id},
+            {"offset", offset},
+            {"thread_id", current_thread_system_id()}
+        };
+    });
+    return DEBUG_STATUS_NO_CHANGE;
+}
+
+STDMETHODIMP SessionEventCallbacks::Exception(PEXCEPTION_RECORD64 Exception, ULONG FirstChance) {
+    publish(EventKind::Exception, [&]() {
+        return nlohmann::json{
+            {"code", Exception ? Exception->ExceptionCode : 0},
+            {"address", Exception ? Exception->ExceptionAddress : 0},
+            {"first_chance", FirstChance != 0},
+            {"thread_id", current_thread_system_id()}
+        };
+    });
+    return DEBUG_STATUS_NO_CHANGE;
+}
+
+STDMETHODIMP SessionEventCallbacks::CreateThread(
+    [[maybe_unused]] ULONG64 Handle, [[maybe_unused]] ULONG64 DataOffset, [[maybe_unused]] ULONG64 StartOffset) {
+    update([](SessionState& state) { ++state.thread_count; });
+    return DEBUG_STATUS_NO_CHANGE;
+}
+
+STDMETHODIMP SessionEventCallbacks::ExitThread([[maybe_unused]] ULONG ExitCode) {
+    update([](SessionState& state) {
+        if (state.thread_count > 0) {
+            --state.thread_count;
+        }
+    });
+    return DEBUG_STATUS_NO_CHANGE;
+}
+
+// The engine makes the new process and its first thread current before it
+// reports the event
+STDMETHODIMP SessionEventCallbacks::CreateProcess(
+    [[maybe_unused]] ULONG64 ImageFileHandle, [[maybe_unused]] ULONG64 Handle,
+    [[maybe_unused]] ULONG64 BaseOffset, [[maybe_unused]] ULONG ModuleSize,
+    PCSTR ModuleName, PCSTR ImageName,
+    [[maybe_unused]] ULONG CheckSum, [[maybe_unused]] ULONG TimeDateStamp,
+    [[maybe_unused]] ULONG64 InitialThreadHandle, [[maybe_unused]] ULONG64 ThreadDataOffset,
+    [[maybe_unused]] ULONG64 StartOffset) {
+    update([&](SessionState& state) {
+        ProcessInfo process;
+        ULONG process_id = 0;
+        if (system_objects_ && SUCCEEDED(system_objects_->GetCurrentProcessSystemId(&process_id))) {
+            process.process_id = process_id;
+        }
+        process.process_name = ModuleName ? ModuleName : "";
+        process.image_path = ImageName ? ImageName : "";
+        process.is_attached = true;
+        process.attach_time = std::chrono::steady_clock::now();
+        state.current_process = std::move(process);
+
+        read_current_thread(state);
+        state.thread_count = 1;
+        state.module_count = 1;
+    });
+    return DEBUG_STATUS_NO_CHANGE;
+}
+
+STDMETHODIMP SessionEventCallbacks::ExitProcess(ULONG ExitCode) {
+    publish(EventKind::ProcessExit, [&]() {
+        auto session_manager = session_manager_.lock();
+        auto state = session_manager ? session_manager->get_state() : nullptr;
+        return nlohmann::json{
+            {"process_id", state && state->current_process ? state->current_process->process_id : 0},
+            {"exit_code", ExitCode}
+        };
+    });
+    update([](SessionState& state) {
+        state.current_process.reset();
+        state.current_thread.reset();
+        state.thread_count = 0;
+        state.module_count = 0;
+        state.is_target_running = false;
+    });
+    return DEBUG_STATUS_NO_CHANGE;
+}
+
+STDMETHODIMP SessionEventCallbacks::LoadModule(
+    [[maybe_unused]] ULONG64 ImageFileHandle, ULONG64 BaseOffset,
+    ULONG ModuleSize, PCSTR ModuleName,
+    PCSTR ImageName, [[maybe_unused]] ULONG CheckSum,
+    [[maybe_unused]] ULONG TimeDateStamp) {
+    publish(EventKind::ModuleLoad, [&]() {
+        return nlohmann::json{
+            {"name", ModuleName ? ModuleName : ""},
+            {"image_name", ImageName ? ImageName : ""},
+            {"base", BaseOffset},
+            {"size", ModuleSize}
+        };
+    });
+    update([](SessionState& state) { ++state.module_count; });
+    return DEBUG_STATUS_NO_CHANGE;
+}
+
+STDMETHODIMP SessionEventCallbacks::UnloadModule(PCSTR ImageBaseName, ULONG64 BaseOffset) {
+    publish(EventKind::ModuleUnload, [&]() {
+        return nlohmann::json{
+            {"name", ImageBaseName ? ImageBaseName : ""},
+            {"base", BaseOffset}
+        };
+    });
+    update([](SessionState& state) {
+        if (state.module_count > 0) {
+            --state.module_count;
+        }
+    });
+    return DEBUG_STATUS_NO_CHANGE;
+}
+
+// Memory and register writes change nothing the state records, but they make
+// earlier command output stale; the generation bump alone says so
+STDMETHODIMP SessionEventCallbacks::ChangeDebuggeeState(ULONG Flags, [[maybe_unused]] ULONG64 Argument) {
+    if ((Flags & (DEBUG_CDS_REGISTERS | DEBUG_CDS_DATA)) != 0) {
+        update([](SessionState&) {});
+    }
+    return S_OK;
+}
+
+STDMETHODIMP SessionEventCallbacks::ChangeEngineState(ULONG Flags, ULONG64 Argument) {
+    auto session_manager = session_manager_.lock();
+    if (!session_manager) {
+        return S_OK;
+    }
+
+    // Execution status is reported on every wait; only a change between
+    // running and stopped is one worth recording
+    if ((Flags & DEBUG_CES_EXECUTION_STATUS) != 0 && (Argument & DEBUG_STATUS_INSIDE_WAIT) == 0) {
+        bool running = is_running_status(static_cast<ULONG>(Argument));
+        if (session_manager->get_state()->is_target_running != running) {
+            update([running](SessionState& state) { state.is_target_running = running; });
+            if (!running) {
+                notify_stopped();
+            }
+        }
+    }
+    // A session's context being restored is not a switch anyone made; the
+    // state keeps the thread last chosen and nothing is published
+    if ((Flags & DEBUG_CES_CURRENT_THREAD) != 0 && !SessionContexts::restoring()) {
+        update([this](SessionState& state) { read_current_thread(state); });
+    }
+    return S_OK;
+}
+
+// Every change is published as a state change; the pipe server keeps only
+// the latest one for a client that has not caught up
+void SessionEventCallbacks::update(const std::function<void(SessionState&)>& change) {
+    if (auto session_manager = session_manager_.lock()) {
+        session_manager->modify_state(change);
+        publish(EventKind::StateChange, [&]() { return session_manager->serialize_state(); });
+    }
+}
+
+void SessionEventCallbacks::publish(EventKind kind, const std::function<nlohmann::json()>& build_data) {
+    std::lock_guard<std::mutex> lock(publisher_mutex_);
+    if (publisher_) {
+        publisher_(kind, build_data);
+    }
+}
+
+void SessionEventCallbacks::notify_stopped() {
+    std::lock_guard<std::mutex> lock(stop_listener_mutex_);
+    if (stop_listener_) {
+        stop_listener_();
+    }
+}
+
+uint32_t SessionEventCallbacks::current_thread_system_id() {
+    ULONG thread_id = 0;
+    if (system_objects_) {
+        system_objects_->GetCurrentThreadSystemId(&thread_id);
+    }
+    return thread_id;
+}
+
+void SessionEventCallbacks::read_current_thread(SessionState& state) {
+    ULONG thread_id = 0;
+    if (!system_objects_ || FAILED(system_objects_->GetCurrentThreadSystemId(&thread_id))) {
+        state.current_thread.reset();
+        return;
+    }
+
+    ThreadInfo thread;
+    thread.thread_id = thread_id;
+    thread.process_id = state.current_process ? state.current_process->process_id : 0;
+    thread.is_current = true;
+    thread.state = state.is_target_running ? "running" : "stopped";
+    state.current_thread = std::move(thread);
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "pch.h"
+#include "../../inc/session_manager.h"
+#include "../../inc/message_protocol.h"
+#include <functional>
+#include <memory>
+#include <mutex>
+
+/**
+ * @class SessionEventCallbacks
+ * @brief Implements IDebugEventCallbacks to keep the session state current.
+ *
+ * Process, thread and module events and engine state changes update the
+ * SessionManager's state as they happen, so a status request reads a
+ * snapshot instead of querying the engine. Every update bumps the state's
+ * generation, which also tells the command result cache that earlier output
+ * may be stale. Like SymbolEventCallbacks, they are installed on a client of
+ * their own.
+ *
+ * Breakpoints, exceptions, module loads and unloads, process exit and each
+ * state change are also handed to the event publisher, which pushes them to
+ * the pipe clients subscribed to them. The stop listener hears when the
+ * target breaks in, which is when commands can be prefetched.
+ */
+class SessionEventCallbacks : public DebugBaseEventCallbacks {
+public:
+    SessionEventCallbacks(std::weak_ptr<vibedbg::core::SessionManager> session_manager, IDebugClient* client);
+    virtual ~SessionEventCallbacks();
+
+    // Reads the state the session starts in; events keep it current afterwards
+    void refresh();
+
+    // Receives the events clients can subscribe to; build_data is only called
+    // if someone did. Called on the engine thread, so it must not block.
+    using EventPublisher = std::function<void(vibedbg::communication::EventKind kind,
+                                              const std::function<nlohmann::json()>& build_data)>;
+    void set_event_publisher(EventPublisher publisher);
+
+    // Called once the target stops after running, on the thread that reported
+    // the stop; like the publisher, it must not block
+    using StopListener = std::function<void()>;
+    void set_stop_listener(StopListener listener);
+
+    // IUnknown methods
+    STDMETHOD_(ULONG, AddRef)() override;
+    STDMETHOD_(ULONG, Release)() override;
+
+    // IDebugEventCallbacks methods
+    STDMETHOD(GetInterestMask)(PULONG Mask) override;
+    STDMETHOD(Breakpoint)(PDEBUG_BREAKPOINT Bp) override;
+    STDMETHOD(Exception)(PEXCEPTION_RECORD64 Exception, ULONG FirstChance) override;
+    STDMETHOD(CreateThread)(ULONG64 Handle, ULONG64 DataOffset, ULONG64 StartOffset) override;
+    STDMETHOD(ExitThread)(ULONG ExitCode) override;
+    STDMETHOD(CreateProcess)(ULONG64 ImageFileHandle, ULONG64 Handle, ULONG64 BaseOffset, ULONG ModuleSize,
+                             PCSTR ModuleName, PCSTR ImageName, ULONG CheckSum, ULONG TimeDateStamp,
+                             ULONG64 InitialThreadHandle, ULONG64 ThreadDataOffset, ULONG64 StartOffset) override;
+    STDMETHOD(ExitProcess)(ULONG ExitCode) override;
+    STDMETHOD(LoadModule)(ULONG64 ImageFileHandle, ULONG64 BaseOffset, ULONG ModuleSize, PCSTR ModuleName,
+                          PCSTR ImageName, ULONG CheckSum, ULONG TimeDateStamp) override;
+    STDMETHOD(UnloadModule)(PCSTR ImageBaseName, ULONG64 BaseOffset) override;
+    STDMETHOD(ChangeDebuggeeState)(ULONG Flags, ULONG64 Argument) override;
+    STDMETHOD(ChangeEngineState)(ULONG Flags, ULONG64 Argument) override;
+
+private:
+    LONG ref_count_;
+    std::weak_ptr<vibedbg::core::SessionManager> session_manager_;
+    IDebugControl* control_{ nullptr };
+    IDebugSymbols* symbols_{ nullptr };
+    IDebugSystemObjects* system_objects_{ nullptr };
+    std::mutex publisher_mutex_;   // Held while publishing, so a cleared publisher is no longer called
+    EventPublisher publisher_;
+    std::mutex stop_listener_mutex_; // Held while notifying, for the same reason
+    StopListener stop_listener_;
+
+    void update(const std::function<void(vibedbg::core::SessionState&)>& change);
+    void publish(vibedbg::communication::EventKind kind, const std::function<nlohmann::json()>& build_data);
+    void notify_stopped();
+    uint32_t current_thread_system_id();
+    void read_current_thread(vibedbg::core::SessionState& state);
+};
@@ -0,0 +1,257 @@
+#include "pch.h"
+#include "symbol_cache.h"
+
+using namespace vibedbg::utils;
+
+SymbolCache& SymbolCache::instance() {
+    static SymbolCache cache;
+    return cache;
+}
+
+size_t SymbolCache::AddressKeyHash::operator()(const AddressKey& key) const noexcept {
+    // splitmix64 finaliser over the fields; addresses within a module differ
+    // only in their low bits, which this spreads across the whole word
+    uint64_t x = key.address ^ (key.module_base * 0x9E3779B97F4A7C15ull) ^ key.timestamp ^
+                 (static_cast<uint64_t>(key.process_id) << 32);
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return static_cast<size_t>(x ^ (x >> 31));
+}
+
+// Maps use the low bits of a hash to pick buckets, so shards use the high ones
+size_t SymbolCache::shard_of(_In_ size_t hash) noexcept {
+    return static_cast<size_t>(static_cast<uint64_t>(hash) >> 32) % SHARD_COUNT;
+}
+
+bool SymbolCache::needs_module_refresh(_In_ uint32_t process_id) const {
+    if (snapshot_epoch_.load() != module_epoch_.load()) {
+        return true;
+    }
+    std::shared_lock<std::shared_mutex> lock(modules_mutex_);
+    return modules_process_ != process_id;
+}
+
+void SymbolCache::refresh_modules(_In_ uint32_t process_id, _In_ std::vector<ModuleIdentity> modules, _In_ uint64_t epoch) {
+    std::sort(modules.begin(), modules.end(), [](const ModuleIdentity& a, const ModuleIdentity& b) {
+        return a.base < b.base;
+    });
+
+    std::unique_lock<std::shared_mutex> lock(modules_mutex_);
+    modules_ = std::move(modules);
+    modules_process_ = process_id;
+    snapshot_epoch_.store(epoch);
+}
+
+/**
+ * @brief Looks up the symbol an address resolved to.
+ *
+ * @param[in] address Address inside a loaded module
+ *
+ * @return Cached symbol, or nullopt on a miss
+ */
+std::optional<ResolvedSymbol> SymbolCache::find_symbol(_In_ uint64_t address) {
+    auto module = module_for(address);
+    if (!module) {
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        return std::nullopt;
+    }
+
+    AddressKey key{module->process_id, module->base, module->timestamp, address};
+    size_t hash = AddressKeyHash{}(key);
+    auto& shard = symbol_shards_[shard_of(hash)];
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.index.find(key);
+    if (it == shard.index.end()) {
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        return std::nullopt;
+    }
+
+    shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+    hits_.fetch_add(1, std::memory_order_relaxed);
+    return it->second->second;
+}
+
+/**
+ * @brief Remembers the symbol an address resolved to.
+ *
+ * Addresses outside every known module have no identity to key on and are
+ * not cached.
+ *
+ * @param[in] address Address that was resolved
+ * @param[in] symbol Symbol it resolved to
+ */
+void SymbolCache::store_symbol(_In_ uint64_t address, _In_ const ResolvedSymbol& symbol) {
+    auto module = module_for(address);
+    if (!module) {
+        return;
+    }
+
+    AddressKey key{module->process_id, module->base, module->timestamp, address};
+    auto& shard = symbol_shards_[shard_of(AddressKeyHash{}(key))];
+    insert(shard, key, symbol, SHARD_CAPACITY);
+}
+
+/**
+ * @brief Looks up the address a symbol name resolved to.
+ *
+ * An entry whose module is no longer loaded with the same timestamp in the
+ * current process is dropped and reported as a miss.
+ *
+ * @param[in] name Symbol name as it was passed to GetOffsetByName
+ *
+ * @return Cached address, or nullopt on a miss
+ */
+std::optional<uint64_t> SymbolCache::find_address(_In_ std::string_view name) {
+    std::string key(name);
+    auto& shard = name_shards_[shard_of(std::hash<std::string>{}(key))];
+
+    std::optional<AddressValue> value;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.index.find(key);
+        if (it != shard.index.end()) {
+            shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+            value = it->second->second;
+        }
+    }
+
+    if (value && module_loaded(value->process_id, value->module_base, value->timestamp)) {
+        hits_.fetch_add(1, std::memory_order_relaxed);
+        return value->address;
+    }
+
+    if (value) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.index.find(key);
+        if (it != shard.index.end()) {
+            shard.entries.erase(it->second);
+            shard.index.erase(it);
+        }
+    }
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    return std::nullopt;
+}
+
+/**
+ * @brief Remembers the address a symbol name resolved to.
+ *
+ * @param[in] name Symbol name as it was passed to GetOffsetByName
+ * @param[in] address Address it resolved to
+ */
+void SymbolCache::store_address(_In_ std::string_view name, _In_ uint64_t address) {
+    auto module = module_for(address);
+    if (!module) {
+        return;
+    }
+
+    std::string key(name);
+    auto& shard = name_shards_[shard_of(std::hash<std::string>{}(key))];
+    insert(shard, std::move(key), AddressValue{address, module->process_id, module->base, module->timestamp},
+           SHARD_CAPACITY);
+}
+
+void SymbolCache::invalidate_modules() noexcept {
+    module_epoch_.fetch_add(1);
+}
+
+void SymbolCache::invalidate_module(_In_ uint64_t base) {
+    for (auto& shard : symbol_shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        std::erase_if(shard.entries, [&shard, base](const auto& entry) {
+            if (entry.first.module_base != base) {
+                return false;
+            }
+            shard.index.erase(entry.first);
+            return true;
+        });
+    }
+    for (auto& shard : name_shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        std::erase_if(shard.entries, [&shard, base](const auto& entry) {
+            if (entry.second.module_base != base) {
+                return false;
+            }
+            shard.index.erase(entry.first);
+            return true;
+        });
+    }
+    invalidations_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void SymbolCache::clear() {
+    for (auto& shard : symbol_shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.index.clear();
+        shard.entries.clear();
+    }
+    for (auto& shard : name_shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.index.clear();
+        shard.entries.clear();
+    }
+    invalidate_modules();
+    invalidations_.fetch_add(1, std::memory_order_relaxed);
+}
+
+SymbolCache::Stats SymbolCache::get_stats() const {
+    Stats stats;
+    stats.hits = hits_.load(std::memory_order_relaxed);
+    stats.misses = misses_.load(std::memory_order_relaxed);
+    stats.invalidations = invalidations_.load(std::memory_order_relaxed);
+    for (auto& shard : symbol_shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        stats.entries += shard.index.size();
+    }
+    for (auto& shard : name_shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        stats.entries += shard.index.size();
+    }
+    return stats;
+}
+
+/**
+ * @brief Finds the loaded module an address lies in.
+ *
+ * @param[in] address Address to look up
+ *
+ * @return Module identity, or nullopt if no known module contains it
+ */
+std::optional<SymbolCache::ModuleIdentity> SymbolCache::module_for(_In_ uint64_t address) const {
+    std::shared_lock<std::shared_mutex> lock(modules_mutex_);
+    auto it = std::upper_bound(modules_.begin(), modules_.end(), address,
+                               [](uint64_t value, const ModuleIdentity& module) {
+                                   return value < module.base;
+                               });
+    if (it == modules_.begin()) {
+        return std::nullopt;
+    }
+    --it;
+    if (address - it->base >= it->size) {
+        return std::nullopt;
+    }
+    return *it;
+}
+
+bool SymbolCache::module_loaded(_In_ uint32_t process_id, _In_ uint64_t base, _In_ uint32_t timestamp) const {
+    auto module = module_for(base);
+    return module && module->process_id == process_id && module->base == base && module->timestamp == timestamp;
+}
+
+template <typename Key, typename Value, typename Hash>
+void SymbolCache::insert(_Inout_ Shard<Key, Value, Hash>& shard, _In_ Key key, _In_ Value value, _In_ size_t capacity) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) {
+        it->second->second = std::move(value);
+        shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+        return;
+    }
+
+    if (shard.entries.size() >= capacity) {
+        shard.index.erase(shard.entries.back().first);
+        shard.entries.pop_back();
+    }
+    shard.entries.emplace_front(key, std::move(value));
+    shard.index.emplace(std::move(key), shard.entries.begin());
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include "../pch.h"
+#include "constants.h"
+#include <array>
+#include <list>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+
+namespace vibedbg::utils {
+
+// Symbol an address resolved to, as GetNameByOffset reports it
+struct ResolvedSymbol {
+    std::string name;
+    uint64_t displacement{0};
+};
+
+/**
+ * @class SymbolCache
+ * @brief Bounded cache of address to symbol and symbol to address lookups.
+ *
+ * Entries are keyed by the identity of the module the address lies in: the
+ * engine process it is loaded in, its base and its timestamp. A module that
+ * unloads and a different image that later loads at the same base never
+ * share entries, and neither do two processes. The module list is that of
+ * one process; it is read again after it changed or when another process
+ * becomes current. Entries of modules that are still loaded stay valid
+ * across module loads, while a symbol reload drops the affected ones.
+ *
+ * The cache is split into shards, each with its own lock and LRU list, so
+ * lookups from the engine thread and invalidations from event callbacks on
+ * the debugger thread rarely contend.
+ */
+class SymbolCache {
+public:
+    // Loaded module as the cache keys on it
+    struct ModuleIdentity {
+        uint32_t process_id{0}; // Engine id of the process the module is loaded in
+        uint64_t base{0};
+        uint64_t size{0};
+        uint32_t timestamp{0};
+    };
+
+    struct Stats {
+        uint64_t hits{0};
+        uint64_t misses{0};
+        uint64_t entries{0};
+        uint64_t invalidations{0};
+    };
+
+    static SymbolCache& instance();
+
+    /**
+     * @brief Tells whether the module list must be read again for a process.
+     *
+     * @param[in] process_id Engine id of the current process
+     */
+    bool needs_module_refresh(uint32_t process_id) const;
+
+    /**
+     * @brief Counter refresh_modules() is checked against; read it before
+     *        enumerating the modules.
+     */
+    uint64_t module_epoch() const noexcept { return module_epoch_.load(); }
+
+    /**
+     * @brief Replaces the module list lookups are keyed by.
+     *
+     * @param[in] process_id Engine id of the process the modules are loaded in
+     * @param[in] modules Modules currently loaded in it
+     * @param[in] epoch module_epoch() read before the modules were enumerated;
+     *                  a list that changed meanwhile is kept, but read again
+     *                  on the next lookup
+     */
+    void refresh_modules(uint32_t process_id, std::vector<ModuleIdentity> modules, uint64_t epoch);
+
+    /**
+     * @brief Finds the loaded module an address lies in, from the last module list read.
+     */
+    std::optional<ModuleIdentity> module_for(uint64_t address) const;
+
+    std::optional<ResolvedSymbol> find_symbol(uint64_t address);
+    void store_symbol(uint64_t address, const ResolvedSymbol& symbol);
+    std::optional<uint64_t> find_address(std::string_view name);
+    void store_address(std::string_view name, uint64_t address);
+
+    /**
+     * @brief Marks the module list stale after a module load or unload.
+     */
+    void invalidate_modules() noexcept;
+
+    /**
+     * @brief Drops the entries of one module whose symbols were reloaded.
+     *
+     * @param[in] base Base of the module
+     */
+    void invalidate_module(uint64_t base);
+
+    /**
+     * @brief Drops every entry, for a reload that touched all modules.
+     */
+    void clear();
+
+    Stats get_stats() const;
+
+private:
+    static constexpr size_t SHARD_COUNT = 16;
+    static constexpr size_t SHARD_CAPACITY = Constants::SYMBOL_CACHE_ENTRIES / SHARD_COUNT;
+
+    struct AddressKey {
+        uint32_t process_id{0};
+        uint64_t module_base{0};
+        uint32_t timestamp{0};
+        uint64_t address{0};
+
+        bool operator==(const AddressKey&) const = default;
+    };
+
+    struct AddressKeyHash {
+        size_t operator()(const AddressKey& key) const noexcept;
+    };
+
+    struct AddressValue {
+        uint64_t address{0};
+        uint32_t process_id{0};
+        uint64_t module_base{0};
+        uint32_t timestamp{0};
+    };
+
+    // One lock and one LRU list; the most recently used entry is at the front
+    template <typename Key, typename Value, typename Hash>
+    struct Shard {
+        using Entries = std::list<std::pair<Key, Value>>;
+
+        mutable std::mutex mutex;
+        Entries entries;
+        std::unordered_map<Key, typename Entries::iterator, Hash> index;
+    };
+
+    using SymbolShard = Shard<AddressKey, ResolvedSymbol, AddressKeyHash>;
+    using NameShard = Shard<std::string, AddressValue, std::hash<std::string>>;
+
+    SymbolCache() = default;
+
+    static size_t shard_of(size_t hash) noexcept;
+
+    bool module_loaded(uint32_t process_id, uint64_t base, uint32_t timestamp) const;
+
+    template <typename Key, typename Value, typename Hash>
+    static void insert(Shard<Key, Value, Hash>& shard, Key key, Value value, size_t capacity);
+
+    std::array<SymbolShard, SHARD_COUNT> symbol_shards_;
+    std::array<NameShard, SHARD_COUNT> name_shards_;
+
+    mutable std::shared_mutex modules_mutex_;
+    std::vector<ModuleIdentity> modules_; // Sorted by base
+    uint32_t modules_process_{0};         // Process modules_ was read from
+    std::atomic<uint64_t> module_epoch_{1};
+    std::atomic<uint64_t> snapshot_epoch_{0};
+
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+    std::atomic<uint64_t> invalidations_{0};
+};
+
+} // namespace vibedbg::utils
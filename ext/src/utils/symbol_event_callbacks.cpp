@@ -0,0 +1,95 @@
+#include "pch.h"
+#include "symbol_event_callbacks.h"
+#include "symbol_cache.h"
+#include "disassembly_cache.h"
+
+using namespace vibedbg::utils;
+
+SymbolEventCallbacks::SymbolEventCallbacks() : ref_count_(1) {
+}
+
+SymbolEventCallbacks::~SymbolEventCallbacks() = default;
+
+STDMETHODIMP_(ULONG) SymbolEventCallbacks::AddRef() {
+    return InterlockedIncrement(&ref_count_);
+}
+
+STDMETHODIMP_(ULONG) SymbolEventCallbacks::Release() {
+    LONG result = InterlockedDecrement(&ref_count_);
+    if (result == 0) {
+        delete this;
+    }
+    return result;
+}
+
+STDMETHODIMP SymbolEventCallbacks::GetInterestMask(PULONG Mask) {
+    if (!Mask) {
+        return E_POINTER;
+    }
+
+    *Mask = DEBUG_EVENT_CREATE_PROCESS | DEBUG_EVENT_EXIT_PROCESS |
+            DEBUG_EVENT_LOAD_MODULE | DEBUG_EVENT_UNLOAD_MODULE |
+            DEBUG_EVENT_CHANGE_DEBUGGEE_STATE | DEBUG_EVENT_CHANGE_SYMBOL_STATE;
+    return S_OK;
+}
+
+// A new or exited process replaces the whole module list; entries keyed by
+// an image that is loaded again at the same base with the same timestamp
+// stay valid, so only the list is read again
+STDMETHODIMP SymbolEventCallbacks::CreateProcess(
+    [[maybe_unused]] ULONG64 ImageFileHandle, [[maybe_unused]] ULONG64 Handle,
+    [[maybe_unused]] ULONG64 BaseOffset, [[maybe_unused]] ULONG ModuleSize,
+    [[maybe_unused]] PCSTR ModuleName, [[maybe_unused]] PCSTR ImageName,
+    [[maybe_unused]] ULONG CheckSum, [[maybe_unused]] ULONG TimeDateStamp,
+    [[maybe_unused]] ULONG64 InitialThreadHandle, [[maybe_unused]] ULONG64 ThreadDataOffset,
+    [[maybe_unused]] ULONG64 StartOffset) {
+    SymbolCache::instance().invalidate_modules();
+    return DEBUG_STATUS_NO_CHANGE;
+}
+
+STDMETHODIMP SymbolEventCallbacks::ExitProcess([[maybe_unused]] ULONG ExitCode) {
+    SymbolCache::instance().invalidate_modules();
+    return DEBUG_STATUS_NO_CHANGE;
+}
+
+STDMETHODIMP SymbolEventCallbacks::LoadModule(
+    [[maybe_unused]] ULONG64 ImageFileHandle, [[maybe_unused]] ULONG64 BaseOffset,
+    [[maybe_unused]] ULONG ModuleSize, [[maybe_unused]] PCSTR ModuleName,
+    [[maybe_unused]] PCSTR ImageName, [[maybe_unused]] ULONG CheckSum,
+    [[maybe_unused]] ULONG TimeDateStamp) {
+    SymbolCache::instance().invalidate_modules();
+    return DEBUG_STATUS_NO_CHANGE;
+}
+
+STDMETHODIMP SymbolEventCallbacks::UnloadModule([[maybe_unused]] PCSTR ImageBaseName, ULONG64 BaseOffset) {
+    SymbolCache::instance().invalidate_modules();
+    DisassemblyCache::instance().invalidate_module(BaseOffset);
+    return DEBUG_STATUS_NO_CHANGE;
+}
+
+// A memory write reports only the data space it changed, so an "eb" or "a"
+// from the console drops every cached instruction. DEBUG_CDS_ALL reports a
+// new target state rather than a write, and leaves code in images alone
+STDMETHODIMP SymbolEventCallbacks::ChangeDebuggeeState(ULONG Flags, ULONG64 Argument) {
+    if (Flags != DEBUG_CDS_ALL && (Flags & DEBUG_CDS_DATA) != 0 &&
+        (Argument == DEBUG_DATA_SPACE_VIRTUAL || Argument == DEBUG_DATA_SPACE_PHYSICAL)) {
+        DisassemblyCache::instance().clear();
+    }
+    return S_OK;
+}
+
+STDMETHODIMP SymbolEventCallbacks::ChangeSymbolState(ULONG Flags, ULONG64 Argument) {
+    auto& cache = SymbolCache::instance();
+
+    // Symbols replacing the exports of one module, as deferred loading does,
+    // report that module's base; anything broader drops the whole cache
+    if ((Flags & (DEBUG_CSS_LOADS | DEBUG_CSS_UNLOADS)) != 0 &&
+        (Flags & (DEBUG_CSS_PATHS | DEBUG_CSS_SYMBOL_OPTIONS)) == 0 && Argument != 0) {
+        cache.invalidate_module(Argument);
+        DisassemblyCache::instance().invalidate_module(Argument);
+    } else if ((Flags & (DEBUG_CSS_LOADS | DEBUG_CSS_UNLOADS | DEBUG_CSS_PATHS | DEBUG_CSS_SYMBOL_OPTIONS)) != 0) {
+        cache.clear();
+        DisassemblyCache::instance().clear();
+    }
+    return S_OK;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "pch.h"
+
+/**
+ * @class SymbolEventCallbacks
+ * @brief Implements IDebugEventCallbacks to keep the symbol cache coherent.
+ *
+ * Module loads and unloads mark the cache's module list stale; symbol loads,
+ * unloads and path or option changes drop the entries they affect. The
+ * disassembly cache follows the same events, since its text names symbols,
+ * and memory writes the engine reports without an address empty it. The
+ * callbacks are installed on a client of their own so WinDbg's own event
+ * callbacks are left in place.
+ */
+class SymbolEventCallbacks : public DebugBaseEventCallbacks {
+public:
+    SymbolEventCallbacks();
+    virtual ~SymbolEventCallbacks();
+
+    // IUnknown methods
+    STDMETHOD_(ULONG, AddRef)() override;
+    STDMETHOD_(ULONG, Release)() override;
+
+    // IDebugEventCallbacks methods
+    STDMETHOD(GetInterestMask)(PULONG Mask) override;
+    STDMETHOD(CreateProcess)(ULONG64 ImageFileHandle, ULONG64 Handle, ULONG64 BaseOffset, ULONG ModuleSize,
+                             PCSTR ModuleName, PCSTR ImageName, ULONG CheckSum, ULONG TimeDateStamp,
+                             ULONG64 InitialThreadHandle, ULONG64 ThreadDataOffset, ULONG64 StartOffset) override;
+    STDMETHOD(ExitProcess)(ULONG ExitCode) override;
+    STDMETHOD(LoadModule)(ULONG64 ImageFileHandle, ULONG64 BaseOffset, ULONG ModuleSize, PCSTR ModuleName,
+                          PCSTR ImageName, ULONG CheckSum, ULONG TimeDateStamp) override;
+    STDMETHOD(UnloadModule)(PCSTR ImageBaseName, ULONG64 BaseOffset) override;
+    STDMETHOD(ChangeDebuggeeState)(ULONG Flags, ULONG64 Argument) override;
+    STDMETHOD(ChangeSymbolState)(ULONG Flags, ULONG64 Argument) override;
+
+private:
+    LONG ref_count_;
+};
@@ -2,7 +2,8 @@
 #include "windbg_command_executor.h"
 #include "command_utils.h"
 #include "constants.h"
-#include "output_capture.h"
+#include "capture_session.h"
+#include "command_watchdog.h"
 
 using namespace vibedbg::utils;
 
@@ -10,24 +11,22 @@ using namespace vibedbg::utils;
  * @brief Constructs a WinDbg command executor and initializes debugger interfaces.
  * 
  * This constructor creates the WinDbg command executor and immediately
- * attempts to initialize the required debugger interfaces. The initialization
+ * checks that a capture session can be obtained. The initialization
  * is performed in the constructor to ensure the executor is ready for use
  * as soon as it's created.
  */
 WinDbgCommandExecutor::WinDbgCommandExecutor() 
-    : debug_client_(nullptr), debug_control_(nullptr), initialized_(false) {
+    : initialized_(false) {
     InitializeInterfaces();
 }
 
 /**
- * @brief Destructor that ensures proper cleanup of debugger interfaces.
+ * @brief Destructor.
  * 
- * This destructor calls CleanupInterfaces() to ensure all acquired
- * debugger interfaces are properly released and resources are cleaned up.
+ * The debugger interfaces belong to the per-thread capture sessions, which
+ * are released when the extension shuts down, so there is nothing to free.
  */
-WinDbgCommandExecutor::~WinDbgCommandExecutor() {
-    CleanupInterfaces();
-}
+WinDbgCommandExecutor::~WinDbgCommandExecutor() = default;
 
 /**
  * @brief Executes a WinDbg command with comprehensive error handling and logging.
@@ -39,13 +38,12 @@ WinDbgCommandExecutor::~WinDbgCommandExecutor() {
  * The method performs the following steps:
  * 1. Validates the executor is initialized
  * 2. Validates the command is safe to execute
- * 3. Creates an output capture helper
- * 4. Executes the command through the debug control interface
- * 5. Captures and formats the output
- * 6. Logs the results for debugging
+ * 3. Executes the command on the calling thread's capture session
+ * 4. Formats the captured output
+ * 5. Logs the results for debugging
  * 
  * @param[in] command The WinDbg command to execute
- * @param[in] timeout_ms Maximum time to wait for command completion (unused)
+ * @param[in] timeout_ms Time after which the command is interrupted (0 to wait indefinitely)
  * 
  * @return Formatted result of command execution, or error message on failure
  * 
@@ -53,7 +51,7 @@ WinDbgCommandExecutor::~WinDbgCommandExecutor() {
  */
 std::string WinDbgCommandExecutor::ExecuteCommand(
     _In_ const std::string& command, 
-    _In_ [[maybe_unused]] DWORD timeout_ms) {
+    _In_ DWORD timeout_ms) {
     CommandUtils::log_command_start(command);
     
     if (!initialized_) {
@@ -65,17 +63,24 @@ std::string WinDbgCommandExecutor::ExecuteCommand(
     }
 
     try {
-        LOG_DEBUG("WinDbgCommandExecutor", "Creating output capture helper");
-        // Create output capture helper
-        OutputCaptureHelper capture_helper(debug_client_);
-        
-        LOG_DEBUG("WinDbgCommandExecutor", "Calling debug_control_->Execute()");
-        // Execute the command
-        HRESULT hr = debug_control_->Execute(
-            DEBUG_OUTCTL_THIS_CLIENT,
-            command.c_str(),
-            DEBUG_EXECUTE_DEFAULT
-        );
+        HRESULT hr = S_OK;
+        auto* session = CaptureSession::for_current_thread(&hr);
+        if (!session) {
+            CommandUtils::log_command_result(command, false, 0);
+            return CommandUtils::format_error_message("Capture session unavailable (HRESULT: 0x" + 
+                   std::to_string(hr) + ")");
+        }
+
+        LOG_DEBUG("WinDbgCommandExecutor", "Executing command on capture session");
+        // Capture every output class, errors and warnings included
+        auto deadline = CommandWatchdog::instance().arm(std::chrono::milliseconds(timeout_ms));
+        std::string output = session->execute(command, {}, nullptr, DEBUG_OUTPUT_NORMAL | DEBUG_OUTPUT_ERROR | DEBUG_OUTPUT_WARNING, nullptr, &hr);
+
+        if (deadline.disarm()) {
+            CommandUtils::log_command_result(command, false, output.length());
+            return CommandUtils::format_error_message("Command timed out after " +
+                   std::to_string(timeout_ms) + " ms; partial output:\n" + output);
+        }
 
         if (FAILED(hr)) {
             CommandUtils::log_command_result(command, false, 0);
@@ -83,13 +88,9 @@ std::string WinDbgCommandExecutor::ExecuteCommand(
                    std::to_string(hr) + ")");
         }
 
-        LOG_DEBUG("WinDbgCommandExecutor", "Getting captured output");
-        // Get captured output
-        std::string output = capture_helper.GetCapturedOutput();
-        
         CommandUtils::log_command_result(command, true, output.length());
         
-        return CommandUtils::format_success_message(command, output);
+        return CommandUtils::format_success_message(command, std::move(output));
     }
     catch (const std::exception& e) {
         CommandUtils::log_command_result(command, false, 0);
@@ -124,11 +125,14 @@ HRESULT WinDbgCommandExecutor::ExecuteCommandSimple(_In_ const std::string& comm
         return E_INVALIDARG;
     }
 
-    return debug_control_->Execute(
-        DEBUG_OUTCTL_THIS_CLIENT,
-        command.c_str(),
-        DEBUG_EXECUTE_DEFAULT
-    );
+    HRESULT hr = S_OK;
+    auto* session = CaptureSession::for_current_thread(&hr);
+    if (!session) {
+        return FAILED(hr) ? hr : E_FAIL;
+    }
+
+    session->execute(command, {}, nullptr, DEBUG_OUTPUT_NORMAL, nullptr, &hr);
+    return hr;
 }
 
 /**
@@ -141,15 +145,12 @@ bool WinDbgCommandExecutor::IsInitialized() const {
 }
 
 /**
- * @brief Initializes the WinDbg debugger interfaces.
- * 
- * This method creates and acquires the necessary WinDbg debugger interfaces
- * required for command execution. It follows a specific initialization order:
- * 1. Creates the debug client interface
- * 2. Queries for the debug control interface
+ * @brief Verifies that commands can be executed on this thread.
  * 
- * If any step fails, the method performs cleanup and returns the appropriate
- * HRESULT error code.
+ * Commands run on the calling thread's capture session, a dedicated client
+ * derived from the extension's client with its output capture installed
+ * once. Creating the session here surfaces an unavailable debugger early;
+ * calls from other threads obtain their own session on first use.
  * 
  * @return HRESULT S_OK on success, appropriate error code on failure
  * 
@@ -157,44 +158,11 @@ bool WinDbgCommandExecutor::IsInitialized() const {
  *       not be called manually unless re-initialization is required.
  */
 HRESULT WinDbgCommandExecutor::InitializeInterfaces() {
-    // Create debug client
-    HRESULT hr = DebugCreate(__uuidof(IDebugClient), (void**)&debug_client_);
-    if (FAILED(hr)) {
-        return hr;
-    }
-
-    // Get control interface
-    hr = debug_client_->QueryInterface(__uuidof(IDebugControl), (void**)&debug_control_);
-    if (FAILED(hr)) {
-        CleanupInterfaces();
-        return hr;
+    HRESULT hr = S_OK;
+    if (!CaptureSession::for_current_thread(&hr)) {
+        return FAILED(hr) ? hr : E_FAIL;
     }
 
     initialized_ = true;
     return S_OK;
 }
-
-/**
- * @brief Cleans up the WinDbg debugger interfaces.
- * 
- * This method releases all acquired debugger interfaces in the reverse order
- * of acquisition to avoid dependency issues. It properly handles the
- * reference counting by calling Release() on each interface and resets
- * the initialization state.
- * 
- * @note This method is called automatically during destruction and can be
- *       called manually for cleanup if needed.
- */
-void WinDbgCommandExecutor::CleanupInterfaces() {
-    if (debug_control_) {
-        debug_control_->Release();
-        debug_control_ = nullptr;
-    }
-
-    if (debug_client_) {
-        debug_client_->Release();
-        debug_client_ = nullptr;
-    }
-
-    initialized_ = false;
-}
\ No newline at end of file
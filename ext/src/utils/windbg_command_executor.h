@@ -1,7 +1,7 @@
 #pragma once
 
 #include "pch.h"
-#include "output_capture.h"
+#include "capture_session.h"
 #include <string>
 
 /**
@@ -16,7 +16,7 @@ public:
     /**
      * @brief Execute a WinDbg command and capture its output.
      * @param command The command to execute
-     * @param timeout_ms Timeout in milliseconds (default: 30 seconds)
+     * @param timeout_ms Time after which the command is interrupted (default: 30 seconds)
      * @return Captured output or error message
      */
     std::string ExecuteCommand(const std::string& command, DWORD timeout_ms = 30000);
@@ -36,9 +36,6 @@ public:
 
 private:
     HRESULT InitializeInterfaces();
-    void CleanupInterfaces();
 
-    IDebugClient* debug_client_;
-    IDebugControl* debug_control_;
     bool initialized_;
 };
\ No newline at end of file
@@ -1,117 +1,75 @@
 #include "pch.h"
 #include "windbg_helpers.h"
 #include "constants.h"
+#include "capture_session.h"
+#include "command_watchdog.h"
+#include "symbol_cache.h"
+#include "disassembly_cache.h"
 #include "../core/extension_impl.h"
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
 
 using namespace vibedbg::utils;
 using namespace vibedbg::core;
 
-// Output callback class to capture WinDbg command output
-class OutputCallback : public IDebugOutputCallbacks {
-public:
-    OutputCallback() : ref_count_(1) {}
-    
-    // IUnknown methods
-    STDMETHOD_(ULONG, AddRef)() override {
-        return InterlockedIncrement(&ref_count_);
-    }
-    
-    STDMETHOD_(ULONG, Release)() override {
-        ULONG count = InterlockedDecrement(&ref_count_);
-        if (count == 0) {
-            delete this;
-        }
-        return count;
-    }
-    
-    STDMETHOD(QueryInterface)(REFIID riid, void** ppv) override {
-        if (riid == IID_IUnknown || riid == __uuidof(IDebugOutputCallbacks)) {
-            *ppv = this;
-            AddRef();
-            return S_OK;
-        }
-        return E_NOINTERFACE;
-    }
-    
-    // IDebugOutputCallbacks method
-    STDMETHOD(Output)(ULONG mask, PCSTR text) override {
-        if (text && (mask & DEBUG_OUTPUT_NORMAL)) {
-            output_stream_ << text;
-        }
-        return S_OK;
-    }
-    
-    std::string GetOutput() const {
-        return output_stream_.str();
-    }
-    
-    void ClearOutput() {
-        output_stream_.str("");
-        output_stream_.clear();
-    }
-    
-private:
-    LONG ref_count_;
-    std::ostringstream output_stream_;
-};
-
 std::string WinDbgHelpers::execute_command(std::string_view command, HRESULT* error) {
     return execute_command_with_timeout(command, std::chrono::milliseconds(30000), error);
 }
 
 std::string WinDbgHelpers::execute_command_with_timeout(
     std::string_view command, 
-    [[maybe_unused]] std::chrono::milliseconds timeout,
-    HRESULT* error) {
+    std::chrono::milliseconds timeout,
+    HRESULT* error,
+    const vibedbg::core::OutputSink& output_sink,
+    std::shared_ptr<const OutputFilter> output_filter) {
     
     if (error) *error = S_OK;
     
-    auto* debug_control = get_debug_control();
-    auto* debug_client = get_debug_client();
-    if (!debug_control || !debug_client) {
-        if (error) *error = E_FAIL;
+    // Commands run on the calling thread's dedicated client, whose capture
+    // callbacks stay installed between commands
+    HRESULT hr = S_OK;
+    auto* session = CaptureSession::for_current_thread(&hr);
+    if (!session) {
+        if (error) *error = FAILED(hr) ? hr : E_FAIL;
         return "";
     }
     
-    // Create output callback to capture command output
-    OutputCallback* output_callback = new OutputCallback();
-    
-    // Get current output callbacks to restore later
-    IDebugOutputCallbacks* old_callbacks = nullptr;
-    debug_client->GetOutputCallbacks(&old_callbacks);
-    
-    // Set our output callback
-    HRESULT hr = debug_client->SetOutputCallbacks(output_callback);
-    if (FAILED(hr)) {
-        output_callback->Release();
-        if (old_callbacks) old_callbacks->Release();
-        if (error) *error = hr;
-        return "";
+    // The watchdog interrupts the engine at the deadline; the command then
+    // returns early and whatever it printed so far is kept
+    auto deadline = CommandWatchdog::instance().arm(timeout);
+    std::string output = session->execute(command, output_sink, std::move(output_filter), DEBUG_OUTPUT_NORMAL, nullptr, &hr);
+    if (deadline.disarm()) {
+        if (error) *error = HRESULT_FROM_WIN32(ERROR_TIMEOUT);
+        return output;
     }
-    
-    // Execute the command
-    std::string command_str(command);
-    hr = debug_control->Execute(DEBUG_OUTCTL_THIS_CLIENT,
-                               command_str.c_str(),
-                               DEBUG_EXECUTE_DEFAULT);
-    
-    // Get the captured output
-    std::string output = output_callback->GetOutput();
-    
-    // Restore original output callbacks
-    debug_client->SetOutputCallbacks(old_callbacks);
-    if (old_callbacks) old_callbacks->Release();
-    output_callback->Release();
-    
     if (FAILED(hr)) {
         if (error) *error = hr;
         return "";
     }
     
-    // Return the actual command output
     return output;
 }
 
+HRESULT WinDbgHelpers::interrupt_execution() {
+    // SetInterrupt is one of the few DbgEng calls that may be made from a
+    // thread other than the one executing; it makes the running command
+    // return as if Ctrl+Break had been pressed
+    auto* debug_control = get_debug_control();
+    if (!debug_control) {
+        return E_FAIL;
+    }
+    return debug_control->SetInterrupt(DEBUG_INTERRUPT_ACTIVE);
+}
+
+void WinDbgHelpers::clear_interrupt() {
+    // GetInterrupt reports and resets a pending interrupt, so one that
+    // arrived after its command finished does not stop the next command
+    if (auto* debug_control = get_debug_control()) {
+        debug_control->GetInterrupt();
+    }
+}
+
 std::string WinDbgHelpers::capture_command_output(std::string_view command, HRESULT* error) {
     // Now we have proper output capture
     return execute_command_with_timeout(command, std::chrono::milliseconds(30000), error);
@@ -211,16 +169,256 @@ HRESULT WinDbgHelpers::write_memory(
         return E_FAIL;
     }
     
-    ULONG bytes_written;
+    ULONG bytes_written = 0;
     HRESULT hr = debug_data_spaces->WriteVirtual(
         address,
         const_cast<uint8_t*>(data.data()),
         static_cast<ULONG>(data.size()),
         &bytes_written);
     
+    // A failed write may still have changed part of the range
+    DisassemblyCache::instance().invalidate_range(address, data.size());
     return hr;
 }
 
+std::vector<MemoryRangeResult> WinDbgHelpers::read_memory_ranges(
+    std::span<const MemoryRange> ranges,
+    std::string& buffer,
+    HRESULT* error) {
+    
+    if (error) *error = S_OK;
+    
+    auto* debug_data_spaces = get_debug_data_spaces();
+    if (!debug_data_spaces) {
+        if (error) *error = E_FAIL;
+        return {};
+    }
+    
+    // Each range gets its own slot in the buffer, in request order
+    std::vector<MemoryRangeResult> results(ranges.size());
+    size_t total_size = 0;
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        results[i].offset = total_size;
+        total_size += ranges[i].size;
+    }
+    
+    size_t base = buffer.size();
+    buffer.resize(base + total_size);
+    auto* output = reinterpret_cast<uint8_t*>(buffer.data() + base);
+    
+    // Overlapping and adjacent ranges are coalesced so that each span of
+    // target memory costs one ReadVirtual round trip
+    std::vector<size_t> order(ranges.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&ranges](size_t a, size_t b) {
+        return ranges[a].address < ranges[b].address;
+    });
+    
+    std::vector<uint8_t> scratch;
+    size_t first = 0;
+    while (first < order.size()) {
+        uintptr_t span_start = ranges[order[first]].address;
+        uintptr_t span_end = span_start + ranges[order[first]].size;
+        size_t last = first + 1;
+        while (last < order.size() && ranges[order[last]].address <= span_end) {
+            span_end = (std::max)(span_end, ranges[order[last]].address + ranges[order[last]].size);
+            ++last;
+        }
+        
+        uint8_t* span_data = nullptr;
+        if (last - first == 1) {
+            span_data = output + results[order[first]].offset;
+        } else {
+            scratch.resize(span_end - span_start);
+            span_data = scratch.data();
+        }
+        
+        HRESULT hr = S_OK;
+        size_t span_read = read_virtual_span(debug_data_spaces, span_start, span_end - span_start, span_data, &hr);
+        
+        for (size_t i = first; i < last; ++i) {
+            const auto& range = ranges[order[i]];
+            auto& result = results[order[i]];
+            size_t start = range.address - span_start;
+            result.bytes_read = span_read > start ? (std::min)(range.size, span_read - start) : 0;
+            result.hr = result.bytes_read < range.size ? (FAILED(hr) ? hr : E_FAIL) : S_OK;
+            if (span_data != output + result.offset && result.bytes_read > 0) {
+                std::memcpy(output + result.offset, span_data + start, result.bytes_read);
+            }
+        }
+        first = last;
+    }
+    
+    return results;
+}
+
+std::vector<uintptr_t> WinDbgHelpers::search_memory(
+    uintptr_t address,
+    uint64_t length,
+    std::span<const uint8_t> pattern,
+    size_t max_hits,
+    HRESULT* error) {
+    
+    if (error) *error = S_OK;
+    
+    auto* debug_data_spaces = get_debug_data_spaces();
+    if (!debug_data_spaces) {
+        if (error) *error = E_FAIL;
+        return {};
+    }
+    
+    if (pattern.empty() || length < pattern.size() || length > Constants::MAX_MEMORY_SEARCH_LENGTH ||
+        address + length < address) {
+        if (error) *error = E_INVALIDARG;
+        return {};
+    }
+    
+    // SearchVirtual fails once no further match exists, which ends the scan
+    std::vector<uintptr_t> hits;
+    uint64_t offset = address;
+    uint64_t end = address + length;
+    while (hits.size() < max_hits && end - offset >= pattern.size()) {
+        ULONG64 match = 0;
+        HRESULT hr = debug_data_spaces->SearchVirtual(
+            offset,
+            end - offset,
+            const_cast<uint8_t*>(pattern.data()),
+            static_cast<ULONG>(pattern.size()),
+            1,
+            &match);
+        if (hr != S_OK) {
+            break;
+        }
+        hits.push_back(static_cast<uintptr_t>(match));
+        offset = match + 1;
+    }
+    
+    return hits;
+}
+
+std::vector<MemoryRegion> WinDbgHelpers::get_committed_regions(HRESULT* error) {
+    if (error) *error = S_OK;
+    
+    auto* debug_data_spaces = get_debug_data_spaces();
+    CComPtr<IDebugDataSpaces2> data_spaces;
+    HRESULT hr = debug_data_spaces
+        ? debug_data_spaces->QueryInterface(__uuidof(IDebugDataSpaces2), reinterpret_cast<void**>(&data_spaces))
+        : E_FAIL;
+    if (FAILED(hr)) {
+        if (error) *error = hr;
+        return {};
+    }
+    
+    // QueryVirtual describes the region at or after the offset, so each call
+    // moves past one region, committed or not, until the address space ends
+    std::vector<MemoryRegion> regions;
+    uint64_t offset = 0;
+    MEMORY_BASIC_INFORMATION64 info{};
+    while ((hr = data_spaces->QueryVirtual(offset, &info)) == S_OK) {
+        if (info.State == MEM_COMMIT) {
+            regions.push_back({info.BaseAddress, info.RegionSize, info.Type, info.Protect});
+        }
+        uint64_t next = info.BaseAddress + info.RegionSize;
+        if (next <= offset) {
+            break;
+        }
+        offset = next;
+    }
+    
+    // The walk ends with a failure past the last region; only a first call
+    // failing means the target has no address space to describe
+    if (regions.empty() && FAILED(hr)) {
+        if (error) *error = hr;
+    }
+    return regions;
+}
+
+uint32_t WinDbgHelpers::get_pointer_size(HRESULT* error) {
+    if (error) *error = S_OK;
+    
+    auto* debug_control = get_debug_control();
+    if (!debug_control) {
+        if (error) *error = E_FAIL;
+        return 0;
+    }
+    
+    HRESULT hr = debug_control->IsPointer64Bit();
+    if (FAILED(hr)) {
+        if (error) *error = hr;
+        return 0;
+    }
+    return hr == S_OK ? 8 : 4;
+}
+
+namespace {
+    // DbgEng reports the full length including the terminator even when it
+    // had to truncate the name to fit the buffer
+    std::string from_name_buffer(const char* buffer, size_t capacity, ULONG reported_size) {
+        size_t length = reported_size > 0 ? (std::min<size_t>)(reported_size, capacity) - 1 : 0;
+        return std::string(buffer, length);
+    }
+    
+    // The symbol cache keys entries by module identity; the module list is
+    // read again with one GetModuleParameters call only after it changed or
+    // another process became current
+    void refresh_symbol_modules(IDebugSymbols* debug_symbols) {
+        auto& cache = SymbolCache::instance();
+        ULONG process_id = 0;
+        auto* system_objects = ExtensionImpl::get_instance().get_debug_system_objects();
+        if (system_objects) {
+            system_objects->GetCurrentProcessId(&process_id);
+        }
+        if (!cache.needs_module_refresh(process_id)) {
+            return;
+        }
+        
+        uint64_t epoch = cache.module_epoch();
+        ULONG loaded = 0;
+        ULONG unloaded = 0;
+        if (FAILED(debug_symbols->GetNumberModules(&loaded, &unloaded))) {
+            return;
+        }
+        
+        std::vector<DEBUG_MODULE_PARAMETERS> parameters(loaded);
+        if (loaded > 0 && FAILED(debug_symbols->GetModuleParameters(loaded, nullptr, 0, parameters.data()))) {
+            return;
+        }
+        
+        std::vector<SymbolCache::ModuleIdentity> modules;
+        modules.reserve(loaded);
+        for (const auto& module : parameters) {
+            if (module.Base != DEBUG_INVALID_OFFSET && (module.Flags & DEBUG_MODULE_UNLOADED) == 0) {
+                modules.push_back({process_id, module.Base, module.Size, module.TimeDateStamp});
+            }
+        }
+        cache.refresh_modules(process_id, std::move(modules), epoch);
+    }
+    
+    std::optional<ResolvedSymbol> resolve_symbol(IDebugSymbols* debug_symbols, uint64_t address, HRESULT* error) {
+        auto& cache = SymbolCache::instance();
+        refresh_symbol_modules(debug_symbols);
+        if (auto cached = cache.find_symbol(address)) {
+            return cached;
+        }
+        
+        char name_buffer[512];
+        ULONG name_size = 0;
+        ULONG64 displacement = 0;
+        HRESULT hr = debug_symbols->GetNameByOffset(address, name_buffer, sizeof(name_buffer),
+                                                    &name_size, &displacement);
+        if (FAILED(hr)) {
+            if (error) *error = hr;
+            return std::nullopt;
+        }
+        
+        ResolvedSymbol symbol{from_name_buffer(name_buffer, sizeof(name_buffer), name_size), displacement};
+        cache.store_symbol(address, symbol);
+        return symbol;
+    }
+}
+
 uintptr_t WinDbgHelpers::get_symbol_address(std::string_view symbol, HRESULT* error) {
     if (error) *error = S_OK;
     
@@ -230,6 +428,12 @@ uintptr_t WinDbgHelpers::get_symbol_address(std::string_view symbol, HRESULT* er
         return 0;
     }
     
+    auto& cache = SymbolCache::instance();
+    refresh_symbol_modules(debug_symbols);
+    if (auto cached = cache.find_address(symbol)) {
+        return static_cast<uintptr_t>(*cached);
+    }
+    
     ULONG64 address;
     std::string symbol_str(symbol);
     HRESULT hr = debug_symbols->GetOffsetByName(symbol_str.c_str(), &address);
@@ -239,6 +443,7 @@ uintptr_t WinDbgHelpers::get_symbol_address(std::string_view symbol, HRESULT* er
         return 0;
     }
     
+    cache.store_address(symbol, address);
     return static_cast<uintptr_t>(address);
 }
 
@@ -251,28 +456,585 @@ std::string WinDbgHelpers::get_symbol_name(uintptr_t address, HRESULT* error) {
         return "";
     }
     
-    char name_buffer[256];
-    ULONG name_size;
-    ULONG64 displacement;
+    auto symbol = resolve_symbol(debug_symbols, address, error);
+    if (!symbol) {
+        return "";
+    }
+    
+    std::string result = std::move(symbol->name);
+    if (symbol->displacement > 0) {
+        result += std::format("+0x{:x}", symbol->displacement);
+    }
     
-    HRESULT hr = debug_symbols->GetNameByOffset(
-        address, 
-        name_buffer, 
-        sizeof(name_buffer), 
-        &name_size, 
-        &displacement);
+    return result;
+}
+
+std::string WinDbgHelpers::get_symbol_path(HRESULT* error) {
+    if (error) *error = S_OK;
+    
+    auto* debug_symbols = get_debug_symbols();
+    if (!debug_symbols) {
+        if (error) *error = E_FAIL;
+        return "";
+    }
+    
+    ULONG path_size = 0;
+    HRESULT hr = debug_symbols->GetSymbolPath(nullptr, 0, &path_size);
+    if (FAILED(hr) || path_size <= 1) {
+        if (error) *error = hr;
+        return "";
+    }
     
+    std::string path(path_size, '\0');
+    hr = debug_symbols->GetSymbolPath(path.data(), path_size, &path_size);
     if (FAILED(hr)) {
         if (error) *error = hr;
         return "";
     }
+    path.resize(path_size - 1);
+    return path;
+}
+
+// Loads the module's symbols now rather than on first use; the symbol event
+// callbacks drop what the symbol cache held for the module
+HRESULT WinDbgHelpers::reload_module_symbols(std::string_view module_name) {
+    auto* debug_symbols = get_debug_symbols();
+    if (!debug_symbols || module_name.empty()) {
+        return !debug_symbols ? E_FAIL : E_INVALIDARG;
+    }
+    
+    std::string arguments = "/f " + std::string(module_name);
+    return debug_symbols->Reload(arguments.c_str());
+}
+
+std::vector<ModuleEntry> WinDbgHelpers::get_module_entries(HRESULT* error) {
+    if (error) *error = S_OK;
+    
+    auto* debug_symbols = get_debug_symbols();
+    if (!debug_symbols) {
+        if (error) *error = E_FAIL;
+        return {};
+    }
     
-    std::string result(name_buffer, name_size > 0 ? name_size - 1 : 0);
-    if (displacement > 0) {
-        result += std::format("+0x{:x}", displacement);
+    ULONG loaded = 0;
+    ULONG unloaded = 0;
+    HRESULT hr = debug_symbols->GetNumberModules(&loaded, &unloaded);
+    if (FAILED(hr)) {
+        if (error) *error = hr;
+        return {};
     }
     
-    return result;
+    ULONG count = loaded + unloaded;
+    if (count == 0) {
+        return {};
+    }
+    
+    // One call returns base, size, timestamp and checksum of every module;
+    // entries it could not fill are left with an invalid base
+    std::vector<DEBUG_MODULE_PARAMETERS> parameters(count);
+    hr = debug_symbols->GetModuleParameters(count, nullptr, 0, parameters.data());
+    if (FAILED(hr)) {
+        if (error) *error = hr;
+        return {};
+    }
+    
+    std::vector<ModuleEntry> modules;
+    modules.reserve(count);
+    char module_name[256];
+    char image_name[1024];
+    for (ULONG i = 0; i < count; ++i) {
+        const auto& module = parameters[i];
+        if (module.Base == DEBUG_INVALID_OFFSET) {
+            continue;
+        }
+        
+        ModuleEntry entry;
+        entry.base = module.Base;
+        entry.size = module.Size;
+        entry.timestamp = module.TimeDateStamp;
+        entry.checksum = module.Checksum;
+        entry.symbol_type = module.SymbolType;
+        entry.unloaded = i >= loaded || (module.Flags & DEBUG_MODULE_UNLOADED) != 0;
+        
+        ULONG image_size = 0;
+        ULONG module_size = 0;
+        if (SUCCEEDED(debug_symbols->GetModuleNames(i, 0,
+                                                    image_name, sizeof(image_name), &image_size,
+                                                    module_name, sizeof(module_name), &module_size,
+                                                    nullptr, 0, nullptr))) {
+            entry.name = from_name_buffer(module_name, sizeof(module_name), module_size);
+            entry.image_name = from_name_buffer(image_name, sizeof(image_name), image_size);
+        }
+        modules.push_back(std::move(entry));
+    }
+    
+    return modules;
+}
+
+std::vector<ThreadEntry> WinDbgHelpers::get_thread_entries(HRESULT* error) {
+    if (error) *error = S_OK;
+    
+    auto* system_objects = get_debug_system_objects();
+    if (!system_objects) {
+        if (error) *error = E_FAIL;
+        return {};
+    }
+    
+    ULONG count = 0;
+    HRESULT hr = system_objects->GetNumberThreads(&count);
+    if (FAILED(hr)) {
+        if (error) *error = hr;
+        return {};
+    }
+    if (count == 0) {
+        return {};
+    }
+    
+    std::vector<ULONG> engine_ids(count);
+    std::vector<ULONG> system_ids(count);
+    hr = system_objects->GetThreadIdsByIndex(0, count, engine_ids.data(), system_ids.data());
+    if (FAILED(hr)) {
+        if (error) *error = hr;
+        return {};
+    }
+    
+    ULONG current = 0;
+    bool has_current = SUCCEEDED(system_objects->GetCurrentThreadId(&current));
+    
+    std::vector<ThreadEntry> threads(count);
+    for (ULONG i = 0; i < count; ++i) {
+        threads[i].engine_id = engine_ids[i];
+        threads[i].system_id = system_ids[i];
+        threads[i].current = has_current && engine_ids[i] == current;
+    }
+    
+    return threads;
+}
+
+std::vector<StackFrameEntry> WinDbgHelpers::get_stack_frames(size_t max_frames, HRESULT* error) {
+    if (error) *error = S_OK;
+    
+    auto* debug_control = get_debug_control();
+    auto* debug_symbols = get_debug_symbols();
+    if (!debug_control || !debug_symbols || max_frames == 0) {
+        if (error) *error = !debug_control || !debug_symbols ? E_FAIL : E_INVALIDARG;
+        return {};
+    }
+    
+    // Zero frame, stack and instruction offsets walk the current thread's stack
+    std::vector<DEBUG_STACK_FRAME> raw_frames(max_frames);
+    ULONG filled = 0;
+    HRESULT hr = debug_control->GetStackTrace(0, 0, 0, raw_frames.data(),
+                                              static_cast<ULONG>(raw_frames.size()), &filled);
+    if (FAILED(hr)) {
+        if (error) *error = hr;
+        return {};
+    }
+    
+    std::vector<StackFrameEntry> frames;
+    frames.reserve(filled);
+    for (ULONG i = 0; i < filled; ++i) {
+        const auto& raw = raw_frames[i];
+        StackFrameEntry frame;
+        frame.frame_number = raw.FrameNumber;
+        frame.instruction_offset = raw.InstructionOffset;
+        frame.return_offset = raw.ReturnOffset;
+        frame.frame_offset = raw.FrameOffset;
+        frame.stack_offset = raw.StackOffset;
+        
+        if (auto symbol = resolve_symbol(debug_symbols, raw.InstructionOffset, nullptr)) {
+            frame.symbol = std::move(symbol->name);
+            frame.displacement = symbol->displacement;
+        }
+        frames.push_back(std::move(frame));
+    }
+    
+    return frames;
+}
+
+/**
+ * @brief Decodes the instructions from an address on, through the disassembly cache.
+ *
+ * Each instruction carries the symbol and source line its address resolves
+ * to. Instructions inside a loaded module are cached by module; the rest,
+ * such as generated code, are decoded every time.
+ *
+ * @param[in] address First instruction
+ * @param[in] max_instructions Instructions decoded at most
+ * @param[in] end_address Decoding stops at this address; zero for no limit
+ * @param[out] cached Receives how many instructions came from the cache
+ * @param[out] error Set if the first instruction could not be decoded
+ *
+ * @return Instructions in address order; fewer than asked if decoding failed partway
+ */
+std::vector<DecodedInstruction> WinDbgHelpers::disassemble(
+    uint64_t address, size_t max_instructions, uint64_t end_address, size_t* cached, HRESULT* error) {
+    if (error) *error = S_OK;
+    if (cached) *cached = 0;
+    
+    auto* debug_control = get_debug_control();
+    auto* debug_symbols = get_debug_symbols();
+    if (!debug_control || !debug_symbols) {
+        if (error) *error = E_FAIL;
+        return {};
+    }
+    
+    auto& symbol_cache = SymbolCache::instance();
+    auto& cache = DisassemblyCache::instance();
+    refresh_symbol_modules(debug_symbols);
+    
+    std::vector<DecodedInstruction> instructions;
+    uint64_t offset = address;
+    while (instructions.size() < max_instructions && (end_address == 0 || offset < end_address)) {
+        auto module = symbol_cache.module_for(offset);
+        if (module) {
+            if (auto hit = cache.find(*module, offset)) {
+                offset += hit->size;
+                instructions.push_back(std::move(*hit));
+                if (cached) ++*cached;
+                continue;
+            }
+        }
+        
+        // No flags: effective addresses depend on the registers, which would
+        // make the text stale after the next step
+        char text[512];
+        ULONG text_size = 0;
+        ULONG64 next = 0;
+        HRESULT hr = debug_control->Disassemble(offset, 0, text, sizeof(text), &text_size, &next);
+        if (FAILED(hr) || next <= offset) {
+            if (instructions.empty() && error) *error = FAILED(hr) ? hr : E_FAIL;
+            break;
+        }
+        
+        DecodedInstruction instruction;
+        instruction.address = offset;
+        instruction.size = static_cast<uint32_t>(next - offset);
+        instruction.text = from_name_buffer(text, sizeof(text), text_size);
+        while (!instruction.text.empty() && std::isspace(static_cast<unsigned char>(instruction.text.back()))) {
+            instruction.text.pop_back();
+        }
+        if (auto symbol = resolve_symbol(debug_symbols, offset, nullptr)) {
+            instruction.symbol = std::move(symbol->name);
+            instruction.displacement = symbol->displacement;
+        }
+        
+        ULONG line = 0;
+        char file[MAX_PATH];
+        ULONG file_size = 0;
+        if (SUCCEEDED(debug_symbols->GetLineByOffset(offset, &line, file, sizeof(file), &file_size, nullptr))) {
+            instruction.file = from_name_buffer(file, sizeof(file), file_size);
+            instruction.line = line;
+        }
+        
+        if (module) {
+            cache.store(*module, instruction);
+        }
+        offset = next;
+        instructions.push_back(std::move(instruction));
+    }
+    
+    return instructions;
+}
+
+uint64_t WinDbgHelpers::get_instruction_before(uint64_t address, size_t count, HRESULT* error) {
+    if (error) *error = S_OK;
+    if (count == 0) {
+        return address;
+    }
+    
+    auto* debug_control = get_debug_control();
+    if (!debug_control) {
+        if (error) *error = E_FAIL;
+        return address;
+    }
+    
+    // Decoding backwards is a guess on x86, as it is for "ub"
+    ULONG64 start = 0;
+    HRESULT hr = debug_control->GetNearInstruction(address, -static_cast<LONG>(count), &start);
+    if (FAILED(hr)) {
+        if (error) *error = hr;
+        return address;
+    }
+    return start;
+}
+
+// Just the instruction offsets of the current thread's stack; resolving them
+// would load the symbols of every module on it
+std::vector<uint64_t> WinDbgHelpers::get_stack_offsets(size_t max_frames, HRESULT* error) {
+    if (error) *error = S_OK;
+    
+    auto* debug_control = get_debug_control();
+    if (!debug_control || max_frames == 0) {
+        if (error) *error = !debug_control ? E_FAIL : E_INVALIDARG;
+        return {};
+    }
+    
+    std::vector<DEBUG_STACK_FRAME> raw_frames(max_frames);
+    ULONG filled = 0;
+    HRESULT hr = debug_control->GetStackTrace(0, 0, 0, raw_frames.data(),
+                                              static_cast<ULONG>(raw_frames.size()), &filled);
+    if (FAILED(hr)) {
+        if (error) *error = hr;
+        return {};
+    }
+    
+    std::vector<uint64_t> offsets;
+    offsets.reserve(filled);
+    for (ULONG i = 0; i < filled; ++i) {
+        offsets.push_back(raw_frames[i].InstructionOffset);
+    }
+    return offsets;
+}
+
+// DbgEng can only walk the current thread's stack, so each thread is made
+// current in turn and the original thread is restored afterwards. Only the
+// instruction offsets are kept during the walk; identical stacks fold into
+// one bucket and symbols are resolved once per distinct address, which is
+// where a text "~*k" sweep spends most of its time.
+std::vector<StackBucket> WinDbgHelpers::get_stack_buckets(size_t max_frames, size_t* thread_count, HRESULT* error) {
+    if (error) *error = S_OK;
+    if (thread_count) *thread_count = 0;
+    
+    auto* debug_control = get_debug_control();
+    auto* debug_symbols = get_debug_symbols();
+    auto* system_objects = get_debug_system_objects();
+    if (!debug_control || !debug_symbols || !system_objects || max_frames == 0) {
+        if (error) *error = max_frames == 0 ? E_INVALIDARG : E_FAIL;
+        return {};
+    }
+    
+    ULONG count = 0;
+    HRESULT hr = system_objects->GetNumberThreads(&count);
+    if (FAILED(hr) || count == 0) {
+        if (error) *error = hr;
+        return {};
+    }
+    
+    std::vector<ULONG> engine_ids(count);
+    std::vector<ULONG> system_ids(count);
+    hr = system_objects->GetThreadIdsByIndex(0, count, engine_ids.data(), system_ids.data());
+    if (FAILED(hr)) {
+        if (error) *error = hr;
+        return {};
+    }
+    
+    ULONG original_thread = 0;
+    hr = system_objects->GetCurrentThreadId(&original_thread);
+    if (FAILED(hr)) {
+        if (error) *error = hr;
+        return {};
+    }
+    
+    struct OffsetsHash {
+        size_t operator()(const std::vector<uint64_t>& offsets) const noexcept {
+            uint64_t hash = 14695981039346656037ull;
+            for (uint64_t offset : offsets) {
+                hash = (hash ^ offset) * 1099511628211ull;
+            }
+            return static_cast<size_t>(hash);
+        }
+    };
+    
+    std::vector<DEBUG_STACK_FRAME> raw_frames(max_frames);
+    std::unordered_map<std::vector<uint64_t>, size_t, OffsetsHash> bucket_index;
+    std::vector<std::vector<uint64_t>> bucket_offsets;
+    std::vector<StackBucket> buckets;
+    
+    for (ULONG i = 0; i < count; ++i) {
+        // A thread that cannot be made current or walked is skipped; the
+        // remaining threads are still useful for spotting a deadlock
+        ULONG filled = 0;
+        if (FAILED(system_objects->SetCurrentThreadId(engine_ids[i])) ||
+            FAILED(debug_control->GetStackTrace(0, 0, 0, raw_frames.data(),
+                                                static_cast<ULONG>(raw_frames.size()), &filled))) {
+            continue;
+        }
+        
+        std::vector<uint64_t> offsets(filled);
+        for (ULONG f = 0; f < filled; ++f) {
+            offsets[f] = raw_frames[f].InstructionOffset;
+        }
+        
+        auto [it, inserted] = bucket_index.try_emplace(std::move(offsets), buckets.size());
+        if (inserted) {
+            bucket_offsets.push_back(it->first);
+            buckets.emplace_back();
+        }
+        buckets[it->second].system_ids.push_back(system_ids[i]);
+        if (thread_count) (*thread_count)++;
+    }
+    
+    hr = system_objects->SetCurrentThreadId(original_thread);
+    if (FAILED(hr)) {
+        LOG_WARNING("WinDbgHelpers", "Failed to restore the current thread after walking stacks");
+    }
+    
+    // Addresses outside any module are not kept by the symbol cache, so the
+    // sweep still remembers every address it resolved
+    std::unordered_map<uint64_t, ResolvedSymbol> symbols;
+    for (size_t b = 0; b < buckets.size(); ++b) {
+        const auto& offsets = bucket_offsets[b];
+        auto& frames = buckets[b].frames;
+        frames.reserve(offsets.size());
+        for (size_t f = 0; f < offsets.size(); ++f) {
+            auto [symbol, inserted] = symbols.try_emplace(offsets[f]);
+            if (inserted) {
+                if (auto resolved = resolve_symbol(debug_symbols, offsets[f], nullptr)) {
+                    symbol->second = std::move(*resolved);
+                }
+            }
+            
+            StackFrameEntry frame;
+            frame.frame_number = static_cast<uint32_t>(f);
+            frame.instruction_offset = offsets[f];
+            frame.symbol = symbol->second.name;
+            frame.displacement = symbol->second.displacement;
+            frames.push_back(std::move(frame));
+        }
+    }
+    
+    // Most populated stacks first; that is where threads pile up on a lock
+    std::stable_sort(buckets.begin(), buckets.end(), [](const StackBucket& a, const StackBucket& b) {
+        return a.system_ids.size() > b.system_ids.size();
+    });
+    return buckets;
+}
+
+// Sub-registers such as "al" or "ax" are views of a full register and are
+// left out, as "r" does; vector and 80-bit floating point registers have no
+// lossless scalar form and are left out as well
+std::vector<RegisterEntry> WinDbgHelpers::get_register_values(HRESULT* error) {
+    if (error) *error = S_OK;
+    
+    auto* debug_registers = get_debug_registers();
+    if (!debug_registers) {
+        if (error) *error = E_FAIL;
+        return {};
+    }
+    
+    ULONG count = 0;
+    HRESULT hr = debug_registers->GetNumberRegisters(&count);
+    if (FAILED(hr)) {
+        if (error) *error = hr;
+        return {};
+    }
+    if (count == 0) {
+        return {};
+    }
+    
+    // Fetch every value at once; if one of them cannot be read the bulk call
+    // fails and the values are read one by one so the rest still come back
+    std::vector<DEBUG_VALUE> values(count);
+    std::vector<bool> valid(count, true);
+    if (FAILED(debug_registers->GetValues(count, nullptr, 0, values.data()))) {
+        for (ULONG i = 0; i < count; ++i) {
+            valid[i] = SUCCEEDED(debug_registers->GetValue(i, &values[i]));
+        }
+    }
+    
+    std::vector<RegisterEntry> registers;
+    registers.reserve(count);
+    char name_buffer[64];
+    for (ULONG i = 0; i < count; ++i) {
+        if (!valid[i]) {
+            continue;
+        }
+        
+        ULONG name_size = 0;
+        DEBUG_REGISTER_DESCRIPTION description{};
+        if (FAILED(debug_registers->GetDescription(i, name_buffer, sizeof(name_buffer), &name_size, &description)) ||
+            (description.Flags & DEBUG_REGISTER_SUB_REGISTER) != 0) {
+            continue;
+        }
+        
+        RegisterEntry entry;
+        const auto& value = values[i];
+        switch (value.Type) {
+        case DEBUG_VALUE_INT8:    entry.value = value.I8; break;
+        case DEBUG_VALUE_INT16:   entry.value = value.I16; break;
+        case DEBUG_VALUE_INT32:   entry.value = value.I32; break;
+        case DEBUG_VALUE_INT64:   entry.value = value.I64; break;
+        case DEBUG_VALUE_FLOAT32: entry.float_value = value.F32; break;
+        case DEBUG_VALUE_FLOAT64: entry.float_value = value.F64; break;
+        default: continue;
+        }
+        entry.name = from_name_buffer(name_buffer, sizeof(name_buffer), name_size);
+        registers.push_back(std::move(entry));
+    }
+    
+    return registers;
+}
+
+EngineContext WinDbgHelpers::get_engine_context(HRESULT* error) {
+    if (error) *error = S_OK;
+    EngineContext context;
+    
+    auto* system_objects = get_debug_system_objects();
+    auto* debug_symbols = get_debug_symbols();
+    if (!system_objects || !debug_symbols) {
+        if (error) *error = E_FAIL;
+        return context;
+    }
+    
+    ULONG process_id = 0;
+    ULONG thread_id = 0;
+    HRESULT hr = system_objects->GetCurrentProcessId(&process_id);
+    if (SUCCEEDED(hr)) {
+        hr = system_objects->GetCurrentThreadId(&thread_id);
+    }
+    if (SUCCEEDED(hr)) {
+        hr = debug_symbols->GetScope(nullptr, &context.frame, nullptr, 0);
+    }
+    if (FAILED(hr)) {
+        if (error) *error = hr;
+        return context;
+    }
+    
+    context.process_id = process_id;
+    context.thread_id = thread_id;
+    return context;
+}
+
+// Only what differs from the current context is switched. Changing the
+// thread already resets the scope to its innermost frame
+HRESULT WinDbgHelpers::set_engine_context(const EngineContext& context) {
+    auto* system_objects = get_debug_system_objects();
+    auto* debug_symbols = get_debug_symbols();
+    if (!system_objects || !debug_symbols) {
+        return E_FAIL;
+    }
+    
+    HRESULT hr = S_OK;
+    EngineContext current = get_engine_context(&hr);
+    if (FAILED(hr)) {
+        return hr;
+    }
+    
+    if (current.process_id != context.process_id) {
+        hr = system_objects->SetCurrentProcessId(context.process_id);
+        if (FAILED(hr)) {
+            return hr;
+        }
+    }
+    if (current.process_id != context.process_id || current.thread_id != context.thread_id) {
+        hr = system_objects->SetCurrentThreadId(context.thread_id);
+        if (FAILED(hr)) {
+            return hr;
+        }
+        if (context.frame.FrameNumber == 0) {
+            return S_OK;
+        }
+    } else if (current.frame.FrameNumber == context.frame.FrameNumber &&
+               current.frame.InstructionOffset == context.frame.InstructionOffset &&
+               current.frame.StackOffset == context.frame.StackOffset) {
+        return S_OK;
+    }
+    if (context.frame.FrameNumber == 0) {
+        return debug_symbols->ResetScope();
+    }
+    DEBUG_STACK_FRAME frame = context.frame;
+    return debug_symbols->SetScope(0, &frame, nullptr, 0);
 }
 
 std::string WinDbgHelpers::format_windbg_error(HRESULT hr) {
@@ -331,6 +1093,84 @@ std::string WinDbgHelpers::join_lines(const std::vector<std::string>& lines) {
     return result;
 }
 
+std::string WinDbgHelpers::encode_base64(std::string_view data) {
+    static constexpr char alphabet[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    
+    std::string encoded;
+    encoded.reserve((data.size() + 2) / 3 * 4);
+    
+    size_t i = 0;
+    for (; i + 2 < data.size(); i += 3) {
+        uint32_t triple = (static_cast<uint8_t>(data[i]) << 16) |
+                          (static_cast<uint8_t>(data[i + 1]) << 8) |
+                          static_cast<uint8_t>(data[i + 2]);
+        encoded += alphabet[(triple >> 18) & 0x3F];
+        encoded += alphabet[(triple >> 12) & 0x3F];
+        encoded += alphabet[(triple >> 6) & 0x3F];
+        encoded += alphabet[triple & 0x3F];
+    }
+    
+    if (i < data.size()) {
+        uint32_t triple = static_cast<uint8_t>(data[i]) << 16;
+        if (i + 1 < data.size()) {
+            triple |= static_cast<uint8_t>(data[i + 1]) << 8;
+        }
+        encoded += alphabet[(triple >> 18) & 0x3F];
+        encoded += alphabet[(triple >> 12) & 0x3F];
+        encoded += i + 1 < data.size() ? alphabet[(triple >> 6) & 0x3F] : '=';
+        encoded += '=';
+    }
+    
+    return encoded;
+}
+
+// Accepts the byte lists `s -b` takes ("41 42 43"), or one contiguous hex string
+std::optional<std::vector<uint8_t>> WinDbgHelpers::parse_hex_bytes(std::string_view text) {
+    auto hex_value = [](char c) -> int {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    };
+    
+    std::vector<uint8_t> bytes;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        if (text[pos] == ' ' || text[pos] == '\t') {
+            ++pos;
+            continue;
+        }
+        
+        size_t token_end = text.find_first_of(" \t", pos);
+        std::string_view token = text.substr(pos, token_end == std::string_view::npos ? std::string_view::npos : token_end - pos);
+        pos += token.size();
+        
+        if (token.size() > 2 && token.size() % 2 != 0) {
+            return std::nullopt;
+        }
+        
+        // A one or two digit token is one byte; longer tokens are byte pairs
+        size_t digits = token.size() <= 2 ? token.size() : 2;
+        for (size_t i = 0; i < token.size(); i += digits) {
+            int value = 0;
+            for (size_t j = i; j < i + digits; ++j) {
+                int digit = hex_value(token[j]);
+                if (digit < 0) {
+                    return std::nullopt;
+                }
+                value = value * 16 + digit;
+            }
+            bytes.push_back(static_cast<uint8_t>(value));
+        }
+    }
+    
+    if (bytes.empty()) {
+        return std::nullopt;
+    }
+    return bytes;
+}
+
 // Private helper methods
 IDebugControl* WinDbgHelpers::get_debug_control() {
     auto& extension = ExtensionImpl::get_instance();
@@ -357,3 +1197,45 @@ IDebugClient* WinDbgHelpers::get_debug_client() {
     return extension.get_debug_client();
 }
 
+IDebugSystemObjects* WinDbgHelpers::get_debug_system_objects() {
+    auto& extension = ExtensionImpl::get_instance();
+    return extension.get_debug_system_objects();
+}
+
+// Reads as much of [address, address + size) as is accessible. ReadVirtual
+// gives up on a range that crosses into an invalid page, so a failed read is
+// retried page by page to recover the readable prefix.
+size_t WinDbgHelpers::read_virtual_span(
+    IDebugDataSpaces* data_spaces,
+    uintptr_t address,
+    size_t size,
+    uint8_t* destination,
+    HRESULT* error) {
+    
+    constexpr size_t page_size = 0x1000;
+    
+    ULONG bytes_read = 0;
+    HRESULT hr = data_spaces->ReadVirtual(address, destination, static_cast<ULONG>(size), &bytes_read);
+    if (SUCCEEDED(hr) || (address & (page_size - 1)) + size <= page_size) {
+        if (error) *error = hr;
+        return SUCCEEDED(hr) ? bytes_read : 0;
+    }
+    
+    size_t total = 0;
+    while (total < size) {
+        uintptr_t current = address + total;
+        size_t chunk = (std::min)(size - total, page_size - (current & (page_size - 1)));
+        bytes_read = 0;
+        hr = data_spaces->ReadVirtual(current, destination + total, static_cast<ULONG>(chunk), &bytes_read);
+        if (FAILED(hr)) {
+            break;
+        }
+        total += bytes_read;
+        if (bytes_read < chunk) {
+            break;
+        }
+    }
+    
+    if (error) *error = hr;
+    return total;
+}
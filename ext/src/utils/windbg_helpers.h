@@ -2,9 +2,83 @@
 
 #include "../pch.h"
 #include "../../inc/session_manager.h"
+#include "../../inc/command_executor.h"
+#include "disassembly_cache.h"
+#include <optional>
+#include <span>
 
 namespace vibedbg::utils {
 
+struct MemoryRange {
+    uintptr_t address{0};
+    size_t size{0};
+};
+
+// Outcome of one range of a batched read; its bytes start at `offset` in the output buffer
+struct MemoryRangeResult {
+    size_t offset{0};
+    size_t bytes_read{0};
+    HRESULT hr{S_OK};
+};
+
+// Committed region of the target's address space, as QueryVirtual reports it
+struct MemoryRegion {
+    uint64_t base{0};
+    uint64_t size{0};
+    uint32_t type{0};    // MEM_PRIVATE, MEM_MAPPED or MEM_IMAGE
+    uint32_t protect{0}; // PAGE_*
+};
+
+// Target state read straight from the DbgEng interfaces, without formatting
+// it as command text first
+struct ModuleEntry {
+    std::string name;
+    std::string image_name;
+    uint64_t base{0};
+    uint32_t size{0};
+    uint32_t timestamp{0};
+    uint32_t checksum{0};
+    uint32_t symbol_type{0}; // DEBUG_SYMTYPE_*
+    bool unloaded{false};
+};
+
+// Process, thread and scope frame commands are evaluated in
+struct EngineContext {
+    uint32_t process_id{0};     // Engine ids, as "|" and "~" list them
+    uint32_t thread_id{0};
+    DEBUG_STACK_FRAME frame{};  // FrameNumber 0 unless ".frame" moved the scope
+};
+
+struct ThreadEntry {
+    uint32_t engine_id{0};
+    uint32_t system_id{0};
+    bool current{false};
+};
+
+struct StackFrameEntry {
+    uint32_t frame_number{0};
+    uint64_t instruction_offset{0};
+    uint64_t return_offset{0};
+    uint64_t frame_offset{0};
+    uint64_t stack_offset{0};
+    std::string symbol;      // Empty when the address has no symbol
+    uint64_t displacement{0};
+};
+
+// Threads whose stacks walked to the same return addresses, with the frames
+// resolved once for all of them
+struct StackBucket {
+    std::vector<StackFrameEntry> frames;
+    std::vector<uint32_t> system_ids; // Threads sharing the stack, in enumeration order
+};
+
+// Integer registers carry value; floating point registers carry float_value
+struct RegisterEntry {
+    std::string name;
+    uint64_t value{0};
+    std::optional<double> float_value;
+};
+
 class WinDbgHelpers {
 public:
     // Command execution helpers
@@ -12,7 +86,11 @@ public:
     static std::string execute_command_with_timeout(
         std::string_view command, 
         std::chrono::milliseconds timeout,
-        HRESULT* hr = nullptr);
+        HRESULT* hr = nullptr,
+        const core::OutputSink& output_sink = {},
+        std::shared_ptr<const OutputFilter> output_filter = nullptr);
+    static HRESULT interrupt_execution(); // Callable from any thread
+    static void clear_interrupt();
     
     // Output capture
     static std::string capture_command_output(std::string_view command, HRESULT* hr = nullptr);
@@ -34,15 +112,48 @@ public:
     static HRESULT write_memory(
         uintptr_t address, 
         const std::vector<uint8_t>& data);
+    static std::vector<MemoryRangeResult> read_memory_ranges(
+        std::span<const MemoryRange> ranges,
+        std::string& buffer,
+        HRESULT* hr = nullptr);
+    static std::vector<uintptr_t> search_memory(
+        uintptr_t address,
+        uint64_t length,
+        std::span<const uint8_t> pattern,
+        size_t max_hits,
+        HRESULT* hr = nullptr);
+    static std::vector<MemoryRegion> get_committed_regions(HRESULT* hr = nullptr);
+    static uint32_t get_pointer_size(HRESULT* hr = nullptr); // 8 on 64-bit targets, otherwise 4
     
     // Symbol helpers
     static uintptr_t get_symbol_address(std::string_view symbol, HRESULT* hr = nullptr);
     static std::string get_symbol_name(uintptr_t address, HRESULT* hr = nullptr);
+    static std::string get_symbol_path(HRESULT* hr = nullptr);
+    static HRESULT reload_module_symbols(std::string_view module_name); // ".reload /f" for one module
     
     // Module helpers
     static std::vector<std::string> get_loaded_modules(HRESULT* hr = nullptr);
     static uintptr_t get_module_base(std::string_view module_name, HRESULT* hr = nullptr);
     
+    // Structured state queries
+    static std::vector<ModuleEntry> get_module_entries(HRESULT* hr = nullptr);
+    static std::vector<ThreadEntry> get_thread_entries(HRESULT* hr = nullptr);
+    static std::vector<StackFrameEntry> get_stack_frames(size_t max_frames, HRESULT* hr = nullptr);
+    static std::vector<uint64_t> get_stack_offsets(size_t max_frames, HRESULT* hr = nullptr); // Symbols stay unresolved
+    static std::vector<StackBucket> get_stack_buckets(size_t max_frames, size_t* thread_count = nullptr,
+                                                      HRESULT* hr = nullptr);
+    static std::vector<RegisterEntry> get_register_values(HRESULT* hr = nullptr);
+    
+    // Disassembly
+    static std::vector<DecodedInstruction> disassemble(uint64_t address, size_t max_instructions,
+                                                       uint64_t end_address, size_t* cached = nullptr,
+                                                       HRESULT* hr = nullptr);
+    static uint64_t get_instruction_before(uint64_t address, size_t count, HRESULT* hr = nullptr); // As "ub" finds it
+    
+    // Engine context
+    static EngineContext get_engine_context(HRESULT* hr = nullptr);
+    static HRESULT set_engine_context(const EngineContext& context);
+    
     // Error handling
     static std::string format_windbg_error(HRESULT hr);
     static std::string format_last_error();
@@ -51,6 +162,8 @@ public:
     static std::string trim_whitespace(const std::string& str);
     static std::vector<std::string> split_lines(const std::string& str);
     static std::string join_lines(const std::vector<std::string>& lines);
+    static std::string encode_base64(std::string_view data);
+    static std::optional<std::vector<uint8_t>> parse_hex_bytes(std::string_view text);
 
 private:
     // Internal helpers
@@ -59,6 +172,13 @@ private:
     static IDebugSymbols* get_debug_symbols();
     static IDebugRegisters* get_debug_registers();
     static IDebugClient* get_debug_client();
+    static IDebugSystemObjects* get_debug_system_objects();
+    static size_t read_virtual_span(
+        IDebugDataSpaces* data_spaces,
+        uintptr_t address,
+        size_t size,
+        uint8_t* destination,
+        HRESULT* hr);
 };
 
 
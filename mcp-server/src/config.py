@@ -21,6 +21,26 @@ logger = logging.getLogger(__name__)
 DEFAULT_PIPE_NAME = r"\\.\pipe\vibedbg_debug"
 DEFAULT_BUFFER_SIZE = 8192
 
+# Highest wire protocol version the client offers during negotiation
+# (1 = delimited JSON text, 2 = binary length-prefixed frames)
+DEFAULT_PROTOCOL_VERSION = 2
+
+# Preferred protocol v2 envelope encoding ("json", "msgpack" or "cbor");
+# falls back to JSON when the extension or the local Python lacks support
+DEFAULT_PAYLOAD_ENCODING = "msgpack"
+
+# Ask the extension to stream large command output as chunk frames
+DEFAULT_STREAM_RESPONSES = True
+
+# Requests sent on one connection before their responses arrive; the
+# extension advertises its own limit and the lower one applies
+DEFAULT_MAX_IN_FLIGHT = 8
+
+# Session the extension keeps this server's process, thread and frame under;
+# empty picks a random one, so agents sharing a debugger do not see each
+# other's context switches
+DEFAULT_SESSION_ID = ""
+
 # Basic timeout settings (in milliseconds)
 DEFAULT_TIMEOUT_MS = 30000
 QUICK_COMMAND_TIMEOUT_MS = 10000
@@ -149,6 +169,11 @@ class ServerConfig:
     buffer_size: int = DEFAULT_BUFFER_SIZE
     connection_timeout_ms: int = DEFAULT_TIMEOUT_MS
     command_timeout_ms: int = DEFAULT_TIMEOUT_MS
+    protocol_version: int = DEFAULT_PROTOCOL_VERSION
+    payload_encoding: str = DEFAULT_PAYLOAD_ENCODING
+    stream_responses: bool = DEFAULT_STREAM_RESPONSES
+    max_in_flight: int = DEFAULT_MAX_IN_FLIGHT
+    session_id: str = DEFAULT_SESSION_ID
 
     # Server settings
     max_connections: int = 10
@@ -202,6 +227,22 @@ class ServerConfig:
                 command_timeout_ms=int(
                     os.getenv("VIBEDBG_COMMAND_TIMEOUT_MS", str(DEFAULT_TIMEOUT_MS))
                 ),
+                protocol_version=int(
+                    os.getenv(
+                        "VIBEDBG_PROTOCOL_VERSION", str(DEFAULT_PROTOCOL_VERSION)
+                    )
+                ),
+                payload_encoding=os.getenv(
+                    "VIBEDBG_PAYLOAD_ENCODING", DEFAULT_PAYLOAD_ENCODING
+                ).lower(),
+                stream_responses=os.getenv(
+                    "VIBEDBG_STREAM_RESPONSES", str(DEFAULT_STREAM_RESPONSES)
+                ).lower()
+                == "true",
+                max_in_flight=int(
+                    os.getenv("VIBEDBG_MAX_IN_FLIGHT", str(DEFAULT_MAX_IN_FLIGHT))
+                ),
+                session_id=os.getenv("VIBEDBG_SESSION_ID", DEFAULT_SESSION_ID),
                 max_connections=int(os.getenv("VIBEDBG_MAX_CONNECTIONS", "10")),
                 enable_heartbeat=os.getenv("VIBEDBG_ENABLE_HEARTBEAT", "true").lower()
                 == "true",
@@ -188,6 +188,16 @@ class CommandRouter:
             ),
         }
 
+        # Every pattern starts with a literal character, so bucketing the
+        # compiled patterns by it leaves only a handful of candidates per
+        # command. Buckets keep declaration order, which decides ties.
+        self._patterns_by_lead: Dict[str, List[tuple]] = {}
+        for pattern, route in self._command_patterns.items():
+            lead = pattern[2] if pattern[1] == "\\" else pattern[1]
+            self._patterns_by_lead.setdefault(lead, []).append(
+                (re.compile(pattern), route, list(route.parameters.keys()))
+            )
+
     def route_command(self, command: str) -> CommandRoute:
         """
         Route a command to the best handler.
@@ -200,19 +210,16 @@ class CommandRouter:
         """
         command = command.strip()
 
-        # Check specific patterns first
-        for pattern, route in self._command_patterns.items():
-            match = re.match(pattern, command)
+        # Check specific patterns sharing the command's first character
+        for pattern, route, param_names in self._patterns_by_lead.get(command[:1], ()):
+            match = pattern.match(command)
             if match:
                 # Extract parameters from match groups
                 params = route.parameters.copy()
-                if match.groups():
-                    for i, group in enumerate(match.groups()):
-                        if group is not None:
-                            # Map group to parameter based on position
-                            param_names = list(params.keys())
-                            if i < len(param_names):
-                                params[param_names[i]] = group
+                for i, group in enumerate(match.groups()):
+                    if group is not None and i < len(param_names):
+                        # Map group to parameter based on position
+                        params[param_names[i]] = group
 
                 return CommandRoute(
                     route.handler_name, params, route.is_generic, route.confidence
@@ -559,7 +566,10 @@ class CommandExecutor:
             # Don't re-raise during shutdown to avoid masking other issues
 
     async def execute_command(
-        self, command: str, timeout_ms: Optional[int] = None
+        self,
+        command: str,
+        timeout_ms: Optional[int] = None,
+        output_filter: Optional[Dict[str, Any]] = None,
     ) -> CommandResult:
         """
         Execute a WinDbg command with proper timeout and logging.
@@ -567,6 +577,8 @@ class CommandExecutor:
         Args:
             command: WinDbg command to execute
             timeout_ms: Command timeout (default: 30000ms)
+            output_filter: Optional grep, head, tail, max_bytes and fields,
+                applied by the extension before the output is sent
 
         Returns:
             CommandResult with execution details
@@ -634,8 +646,11 @@ class CommandExecutor:
                 command_executed=command,
             )
 
-        # Check cache first
-        cached_result = await self.cache.get_cached_result(command, self.context)
+        # Check cache first; filtered output is a slice of the command's
+        # output, so it is neither served from nor stored in the cache
+        cached_result = None
+        if not output_filter:
+            cached_result = await self.cache.get_cached_result(command, self.context)
         if cached_result:
             logger.debug(f"[CMD_EXEC] Using cached result for: '{command}'")
             return cached_result
@@ -650,12 +665,16 @@ class CommandExecutor:
             # Execute with timeout using asyncio.wait_for
             if route.is_generic:
                 result = await asyncio.wait_for(
-                    self._execute_generic_command(command, timeout, route),
+                    self._execute_generic_command(
+                        command, timeout, route, output_filter
+                    ),
                     timeout=timeout / 1000,  # Convert to seconds
                 )
             else:
                 result = await asyncio.wait_for(
-                    self._execute_routed_command(route, command, timeout),
+                    self._execute_routed_command(
+                        route, command, timeout, output_filter
+                    ),
                     timeout=timeout / 1000,  # Convert to seconds
                 )
         except asyncio.TimeoutError:
@@ -771,7 +790,7 @@ class CommandExecutor:
             )
 
         # Cache successful results
-        if result.success:
+        if result.success and not output_filter:
             await self.cache.cache_result(command, result, self.context)
 
         # Update error tracking
@@ -800,7 +819,11 @@ class CommandExecutor:
         return result
 
     async def _execute_generic_command(
-        self, command: str, timeout_ms: Optional[int], route: CommandRoute
+        self,
+        command: str,
+        timeout_ms: Optional[int],
+        route: CommandRoute,
+        output_filter: Optional[Dict[str, Any]] = None,
     ) -> CommandResult:
         """Execute a generic command directly."""
         timeout = timeout_ms or get_timeout_for_command(command)
@@ -842,7 +865,7 @@ class CommandExecutor:
         )
 
         try:
-            output = self.comm_manager.send_command(command, timeout)
+            output = self.comm_manager.send_command(command, timeout, output_filter)
 
             # Check if output indicates an error - but handle state-dependent commands specially
             serious_error_indicators = [
@@ -994,14 +1017,20 @@ class CommandExecutor:
             )
 
     async def _execute_routed_command(
-        self, route: CommandRoute, original_command: str, timeout_ms: Optional[int]
+        self,
+        route: CommandRoute,
+        original_command: str,
+        timeout_ms: Optional[int],
+        output_filter: Optional[Dict[str, Any]] = None,
     ) -> CommandResult:
         """Execute a command using a specific handler."""
         timeout = timeout_ms or get_timeout_for_command(original_command)
 
         try:
             # Execute the command and get raw output
-            output = self.comm_manager.send_command(original_command, timeout)
+            output = self.comm_manager.send_command(
+                original_command, timeout, output_filter
+            )
 
             # Check if output indicates an error even if no exception was thrown
             # Use same logic as generic command handling
@@ -1179,7 +1208,10 @@ class CommandExecutor:
             return ""
 
     async def execute_sequence(
-        self, commands: List[str], stop_on_error: bool = False
+        self,
+        commands: List[str],
+        stop_on_error: bool = False,
+        timeout_ms: Optional[int] = None,
     ) -> List[CommandResult]:
         """
         Execute a sequence of commands with improved error handling.
@@ -1187,6 +1219,7 @@ class CommandExecutor:
         Args:
             commands: List of commands to execute
             stop_on_error: Whether to stop on first error
+            timeout_ms: Timeout per command (default: 30000ms)
 
         Returns:
             List of command results
@@ -1197,7 +1230,7 @@ class CommandExecutor:
 
         for i, command in enumerate(commands):
             try:
-                result = await self.execute_command(command)
+                result = await self.execute_command(command, timeout_ms)
                 results.append(result)
 
                 if result.success:
@@ -1294,14 +1327,88 @@ class CommandExecutor:
 
         return results
 
-    async def _update_context(self):
-        """Update execution context with current state for user mode debugging."""
+    async def execute_batch(
+        self,
+        commands: List[str],
+        stop_on_error: bool = False,
+        timeout_ms: Optional[int] = None,
+    ) -> List[CommandResult]:
+        """
+        Execute several commands in one round-trip to the extension.
+
+        Falls back to execute_sequence when a command does not pass local
+        validation (so it gets the usual per-command error) or when the
+        extension does not understand batch requests.
+
+        Args:
+            commands: List of commands to execute
+            stop_on_error: Whether to stop on first error
+            timeout_ms: Timeout per command (default: 30000ms)
+
+        Returns:
+            List of command results, one per executed command
+        """
+        if len(commands) < 2 or not all(
+            self.validator.validate_command_syntax(command)
+            and self.validator.is_safe_command(command)
+            for command in commands
+        ):
+            return await self.execute_sequence(commands, stop_on_error, timeout_ms)
+
+        timeout = timeout_ms or 30000
+        logger.info(f"[CMD_EXEC] Executing batch of {len(commands)} commands")
+
         try:
-            # For user mode debugging, set basic context without expensive commands
-            self.context.current_process = "current"
-            self.context.current_thread = 0
+            batch = self.comm_manager.execute_batch(
+                commands, stop_on_error=stop_on_error, timeout_per_command_ms=timeout
+            )
+        except CommunicationError as e:
+            logger.warning(
+                f"[CMD_EXEC] Batch request failed ({e}), executing commands one by one"
+            )
+            return await self.execute_sequence(commands, stop_on_error, timeout_ms)
 
-            # Only user mode debugging is supported
+        entries = batch.get("results") if isinstance(batch, dict) else None
+        if not isinstance(entries, list):
+            # Extensions without batch support run "execute_batch" as a command
+            logger.warning("[CMD_EXEC] Extension has no batch support, executing commands one by one")
+            return await self.execute_sequence(commands, stop_on_error, timeout_ms)
+
+        results = []
+        for entry in entries:
+            output = entry.get("output", "")
+            if entry.get("truncated"):
+                output += "\n... [output truncated: batch response size limit reached]"
+            results.append(
+                CommandResult(
+                    success=bool(entry.get("success")),
+                    output=output,
+                    error_message=entry.get("error_message"),
+                    execution_time_ms=int(entry.get("execution_time_ms", 0)),
+                    command_executed=entry.get("command", ""),
+                    cached=bool(entry.get("cache_hit", False)),
+                )
+            )
+
+        if batch.get("skipped_commands"):
+            logger.info(
+                f"[CMD_EXEC] Batch stopped on error, {batch['skipped_commands']} commands skipped"
+            )
+        return results
+
+    async def _update_context(self):
+        """Update execution context from the session state the extension keeps."""
+        try:
+            # Answered from the extension's own record, no debugger command runs
+            state = self.comm_manager.get_session_state()
+            process = state.get("current_process")
+            thread = state.get("current_thread")
+            self.context.current_process = (
+                process.get("process_name") or str(process.get("process_id"))
+                if process
+                else None
+            )
+            self.context.current_thread = thread.get("thread_id") if thread else None
 
         except Exception as e:
             logger.warning(f"Failed to update context: {e}")
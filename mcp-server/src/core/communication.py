@@ -5,16 +5,31 @@ This module handles all communication with the WinDbg extension via named pipes,
 including message serialization, connection management, and error handling.
 """
 
+import base64
 import json
 import logging
+import queue
+import struct
 import time
 import threading
-from typing import Optional, Dict, Any, List
+import uuid
+from typing import Optional, Dict, Any, List, Tuple
 from dataclasses import dataclass
 from datetime import datetime
 from contextlib import contextmanager
 import win32pipe
 import win32file
+
+try:
+    import msgpack
+except ImportError:  # pragma: no cover - optional encoding
+    msgpack = None
+
+try:
+    import cbor2
+except ImportError:  # pragma: no cover - optional encoding
+    cbor2 = None
+
 import win32api
 import win32event
 import pywintypes
@@ -22,6 +37,7 @@ import pywintypes
 from ..config import (
     config,
     DEFAULT_TIMEOUT_MS,
+    LARGE_ANALYSIS_TIMEOUT_MS,
     get_timeout_for_command,
     MAX_RETRY_ATTEMPTS,
     RETRY_DELAY_MS,
@@ -67,9 +83,65 @@ class NetworkDebuggingError(CommunicationError):
     pass
 
 
+class ServerBusyError(CommunicationError):
+    """Raised when the extension's admission control refuses a request."""
+
+    def __init__(self, message: str, retry_after_ms: int = 0, reason: str = ""):
+        super().__init__(message)
+        self.retry_after_ms = retry_after_ms
+        self.reason = reason
+
+
 # Backward compatibility alias
 TimeoutError = PipeTimeoutError
 
+# ====================================================================
+# PROTOCOL CONSTANTS
+# ====================================================================
+
+MESSAGE_DELIMITER = b"\r\n\r\n"
+PROTOCOL_VERSION_V1 = 1  # JSON text terminated by MESSAGE_DELIMITER
+PROTOCOL_VERSION_V2 = 2  # Binary header followed by a length-delimited body
+SUPPORTED_PROTOCOL_VERSIONS = (PROTOCOL_VERSION_V1, PROTOCOL_VERSION_V2)
+
+# Protocol v2 header: magic, version, message type, flags, body length
+FRAME_MAGIC = b"VDB2"
+FRAME_HEADER = struct.Struct("<4sBBHI")
+FRAME_FLAG_RAW_BODY = 0x0001  # Body is [u32 envelope size][envelope][raw output]
+FRAME_FLAG_PARTIAL = 0x0002  # Response chunk; more frames for the request follow
+FRAME_ENCODING_MASK = 0x0300  # Envelope encoding, shifted by FRAME_ENCODING_SHIFT
+FRAME_ENCODING_SHIFT = 8
+ENVELOPE_SIZE = struct.Struct("<I")
+
+# Protocol v2 envelope encodings (v1 frames are always JSON text)
+ENCODING_JSON = "json"
+ENCODING_MSGPACK = "msgpack"
+ENCODING_CBOR = "cbor"
+ENCODING_IDS = {ENCODING_JSON: 0, ENCODING_MSGPACK: 1, ENCODING_CBOR: 2}
+ENCODING_NAMES = {value: key for key, value in ENCODING_IDS.items()}
+
+MESSAGE_TYPE_COMMAND = 1
+MESSAGE_TYPE_RESPONSE = 2
+MESSAGE_TYPE_ERROR = 3
+MESSAGE_TYPE_HEARTBEAT = 4
+MESSAGE_TYPE_SUBSCRIBE = 5
+MESSAGE_TYPE_EVENT = 6
+
+# Error code of a request refused because the extension is at a limit; the
+# error's details say how long to back off
+ERROR_CODE_BUSY = 23
+
+# Debugger events the extension pushes to subscribed connections
+EVENT_TYPES = (
+    "breakpoint",
+    "exception",
+    "module_load",
+    "module_unload",
+    "process_exit",
+    "state_change",
+    "symbol_load",
+)
+
 # ====================================================================
 # DATA CLASSES
 # ====================================================================
@@ -85,6 +157,12 @@ class ConnectionHandle:
     in_use: bool = False
     use_count: int = 0
     thread_id: int = 0
+    protocol_version: int = PROTOCOL_VERSION_V1
+    encoding: str = ENCODING_JSON
+    # Set when the extension takes several requests at once on the connection;
+    # it is then shared instead of being in_use by one request
+    pipeline: Optional["PipelinedConnection"] = None
+    in_flight: int = 0
 
 
 @dataclass
@@ -194,10 +272,30 @@ class NamedPipeProtocol:
                 raise ConnectionError(f"Failed to write to pipe: {str(e)}")
 
     @staticmethod
-    def read_from_pipe(handle: Any, timeout_ms: int) -> bytes:
-        """Read response from the pipe."""
+    def read_from_pipe(
+        handle: Any, timeout_ms: int, pending: Optional[bytearray] = None
+    ) -> bytes:
+        """
+        Read one response frame from the pipe.
+
+        Args:
+            handle: Connected pipe handle
+            timeout_ms: Maximum time to wait for the frame to complete
+            pending: Optional buffer holding bytes received past the previous
+                frame; consumed first and refilled with any bytes read past
+                this one, so streamed responses can be read frame by frame
+
+        Returns:
+            The bytes of one complete frame
+        """
         start_time = datetime.now()
-        response_data = b""
+        response_data = bytes(pending) if pending else b""
+
+        # A previous read may already hold the whole frame
+        frame_size = MessageProtocolAdapter.complete_frame_size(response_data)
+        if frame_size is not None:
+            pending[:] = response_data[frame_size:]
+            return response_data[:frame_size]
 
         while True:
             elapsed_ms = int((datetime.now() - start_time).total_seconds() * 1000)
@@ -213,9 +311,15 @@ class NamedPipeProtocol:
                         f"Read {len(data)} bytes, total: {len(response_data)} bytes"
                     )
 
-                    # Check for message delimiter
-                    if b"\r\n\r\n" in response_data:
+                    # Check whether a whole frame has arrived
+                    frame_size = MessageProtocolAdapter.complete_frame_size(
+                        response_data
+                    )
+                    if frame_size is not None:
                         logger.debug("Found complete response")
+                        if pending is not None:
+                            pending[:] = response_data[frame_size:]
+                        response_data = response_data[:frame_size]
                         break
                 else:
                     time.sleep(0.01)
@@ -246,6 +350,162 @@ class NamedPipeProtocol:
                 logger.warning(f"Error closing pipe handle: {e}")
 
 
+# ====================================================================
+# EVENT SUBSCRIPTION
+# ====================================================================
+
+
+class EventSubscription:
+    """
+    Debugger events pushed by the extension on a connection of their own.
+
+    The extension writes an event frame as soon as the debugger reports a
+    breakpoint, exception, module load or unload, process exit or state
+    change, so waiting for the target to stop needs no status polling. A
+    background thread reads the frames; next_event() and wait_for() hand
+    them out in order.
+    """
+
+    # A read that sees no event in this long just starts over
+    READ_TIMEOUT_MS = 60000
+
+    def __init__(self, events: List[str], pipe_name: Optional[str] = None):
+        unknown = [event for event in events if event not in EVENT_TYPES]
+        if unknown:
+            raise ValueError(f"Unknown events: {', '.join(unknown)}")
+
+        self.events = list(events)
+        self.dropped = 0  # Events the extension discarded because we fell behind
+        self._pipe_name = pipe_name or config.pipe_name
+        self._handle = None
+        self._pending = bytearray()
+        self._queue: "queue.Queue[Optional[Dict[str, Any]]]" = queue.Queue()
+        self._closed = threading.Event()
+        self._reader: Optional[threading.Thread] = None
+
+    def open(self, timeout_ms: int = DEFAULT_TIMEOUT_MS) -> List[str]:
+        """
+        Connect and subscribe.
+
+        Returns:
+            The events the extension now pushes to this subscription
+        """
+        self._handle = NamedPipeProtocol.connect_to_pipe(self._pipe_name, timeout_ms)
+        try:
+            reply = self._exchange(self.events, timeout_ms)
+        except CommunicationError:
+            NamedPipeProtocol.close_pipe(self._handle)
+            self._handle = None
+            raise
+
+        self._reader = threading.Thread(
+            target=self._read_events, name="vibedbg-events", daemon=True
+        )
+        self._reader.start()
+        return (reply.get("data") or {}).get("events", [])
+
+    def next_event(self, timeout_ms: Optional[int] = None) -> Optional[Dict[str, Any]]:
+        """
+        Return the next event, or None on timeout or once the connection is gone.
+
+        Each event is a dict with event, data, sequence, and the coalesced and
+        dropped counts the extension reported with it.
+        """
+        try:
+            timeout = None if timeout_ms is None else timeout_ms / 1000.0
+            return self._queue.get(timeout=timeout)
+        except queue.Empty:
+            return None
+
+    def wait_for(
+        self, events: List[str], timeout_ms: int = DEFAULT_TIMEOUT_MS
+    ) -> Optional[Dict[str, Any]]:
+        """Return the first event of one of the given types, skipping the rest; None on timeout."""
+        deadline = time.monotonic() + timeout_ms / 1000.0
+        while True:
+            remaining_ms = int((deadline - time.monotonic()) * 1000)
+            if remaining_ms <= 0:
+                return None
+            event = self.next_event(remaining_ms)
+            if event is None or event.get("event") in events:
+                return event
+
+    def close(self):
+        """Unsubscribe and close the connection."""
+        if self._closed.is_set():
+            return
+        self._closed.set()
+
+        if self._handle is not None:
+            # The reply to the unsubscribe wakes the reader out of its read
+            try:
+                message = MessageProtocolAdapter.create_subscribe_message([])
+                NamedPipeProtocol.write_to_pipe(
+                    self._handle, MessageProtocolAdapter.serialize_message(message), 1000
+                )
+            except CommunicationError as e:
+                logger.debug(f"Unsubscribe failed: {e}")
+            if self._reader is not None:
+                self._reader.join(timeout=1.0)
+            NamedPipeProtocol.close_pipe(self._handle)
+            self._handle = None
+        self._queue.put(None)
+
+    def __enter__(self) -> "EventSubscription":
+        self.open()
+        return self
+
+    def __exit__(self, *exc_info):
+        self.close()
+
+    def _exchange(self, events: List[str], timeout_ms: int) -> Dict[str, Any]:
+        """Send a subscription and return the extension's reply."""
+        message = MessageProtocolAdapter.create_subscribe_message(events)
+        NamedPipeProtocol.write_to_pipe(
+            self._handle, MessageProtocolAdapter.serialize_message(message), timeout_ms
+        )
+
+        # Events subscribed to may already arrive ahead of the reply
+        while True:
+            reply = MessageProtocolAdapter.parse_response(
+                NamedPipeProtocol.read_from_pipe(self._handle, timeout_ms, self._pending)
+            )
+            if reply.get("type") != "event":
+                break
+            self._deliver(reply)
+
+        if reply.get("status") != "success":
+            raise CommunicationError(f"Subscription failed: {reply.get('error')}")
+        return reply
+
+    def _read_events(self):
+        """Reader thread: queue every event frame until the subscription closes."""
+        while not self._closed.is_set():
+            try:
+                frame = NamedPipeProtocol.read_from_pipe(
+                    self._handle, self.READ_TIMEOUT_MS, self._pending
+                )
+                response = MessageProtocolAdapter.parse_response(frame)
+            except TimeoutError:
+                continue
+            except CommunicationError as e:
+                if not self._closed.is_set():
+                    logger.warning(f"Event subscription lost: {e}")
+                break
+
+            if response.get("type") == "event":
+                self._deliver(response)
+
+        # Wakes any waiter; next_event() then returns None
+        self._queue.put(None)
+
+    def _deliver(self, event: Dict[str, Any]):
+        if event.get("dropped"):
+            self.dropped += event["dropped"]
+            logger.warning(f"Extension dropped {event['dropped']} events for this subscription")
+        self._queue.put(event)
+
+
 # ====================================================================
 # MESSAGE PROTOCOL ADAPTER
 # ====================================================================
@@ -255,21 +515,32 @@ class MessageProtocolAdapter:
     """Adapter for the existing message protocol to work with the communication layer."""
 
     @staticmethod
-    def create_command_message(command: str, timeout_ms: int) -> Dict[str, Any]:
+    def create_command_message(
+        command: str,
+        timeout_ms: int,
+        stream: bool = False,
+        output_filter: Optional[Dict[str, Any]] = None,
+    ) -> Dict[str, Any]:
         """Create a command message compatible with the WinDbg extension."""
         # Use the proper protocol format that matches C++ extension
-        return {
+        message = {
             "protocol_version": 1,
             "message_type": 1,  # Command type
             "payload": {
                 "type": "command",
-                "request_id": str(int(time.time() * 1000)),
+                "request_id": uuid.uuid4().hex,
                 "command": command,
-                "parameters": {},
+                # grep, head, tail, max_bytes and fields are applied by the
+                # extension, so dropped output never crosses the pipe
+                "parameters": dict(output_filter or {}),
                 "timeout_ms": timeout_ms,
                 "timestamp": int(time.time() * 1000),
             },
         }
+        if stream:
+            # Ask for output as chunk frames while the command runs
+            message["payload"]["stream"] = True
+        return message
 
     @staticmethod
     def create_handler_message(handler_name: str, **kwargs) -> Dict[str, Any]:
@@ -280,7 +551,7 @@ class MessageProtocolAdapter:
             "message_type": 1,  # Command type
             "payload": {
                 "type": "command",
-                "request_id": str(int(time.time() * 1000)),
+                "request_id": uuid.uuid4().hex,
                 "command": handler_name,
                 "parameters": kwargs or {},
                 "timeout_ms": 30000,
@@ -289,61 +560,277 @@ class MessageProtocolAdapter:
         }
 
     @staticmethod
-    def serialize_message(message: Dict[str, Any]) -> bytes:
+    def create_heartbeat_message() -> Dict[str, Any]:
+        """Create a heartbeat message advertising the protocol versions we support."""
+        return {
+            "protocol_version": PROTOCOL_VERSION_V1,
+            "message_type": MESSAGE_TYPE_HEARTBEAT,
+            "payload": {
+                "type": "heartbeat",
+                "session_info": {
+                    "protocol_versions": list(SUPPORTED_PROTOCOL_VERSIONS),
+                    "encodings": MessageProtocolAdapter.available_encodings(),
+                },
+                "timestamp": int(time.time() * 1000),
+            },
+        }
+
+    @staticmethod
+    def create_subscribe_message(events: List[str]) -> Dict[str, Any]:
+        """Create a message selecting the events pushed to this connection."""
+        return {
+            "protocol_version": PROTOCOL_VERSION_V1,
+            "message_type": MESSAGE_TYPE_SUBSCRIBE,
+            "payload": {
+                "type": "subscribe",
+                "request_id": uuid.uuid4().hex,
+                "events": list(events),
+                "timestamp": int(time.time() * 1000),
+            },
+        }
+
+    @staticmethod
+    def negotiate_protocol_version(
+        server_info: Optional[Dict[str, Any]], preferred_version: int
+    ) -> int:
+        """
+        Pick the highest protocol version supported by both sides.
+
+        Args:
+            server_info: session_info from the extension's heartbeat reply
+            preferred_version: Highest version this client is configured to use
+
+        Returns:
+            Negotiated protocol version (1 if the extension did not advertise any)
+        """
+        if not server_info:
+            return PROTOCOL_VERSION_V1
+
+        server_versions = server_info.get("protocol_versions") or [PROTOCOL_VERSION_V1]
+        common = [
+            version
+            for version in SUPPORTED_PROTOCOL_VERSIONS
+            if version in server_versions and version <= preferred_version
+        ]
+        return max(common) if common else PROTOCOL_VERSION_V1
+
+    @staticmethod
+    def available_encodings() -> List[str]:
+        """Return the envelope encodings this Python environment can handle."""
+        encodings = [ENCODING_JSON]
+        if msgpack is not None:
+            encodings.append(ENCODING_MSGPACK)
+        if cbor2 is not None:
+            encodings.append(ENCODING_CBOR)
+        return encodings
+
+    @staticmethod
+    def negotiate_encoding(
+        server_info: Optional[Dict[str, Any]], preferred_encoding: str
+    ) -> str:
+        """
+        Pick the envelope encoding for a v2 connection.
+
+        Args:
+            server_info: session_info from the extension's heartbeat reply
+            preferred_encoding: Encoding this client is configured to prefer
+
+        Returns:
+            preferred_encoding if both sides support it, otherwise JSON
+        """
+        server_encodings = (server_info or {}).get("encodings") or [ENCODING_JSON]
+        if (
+            preferred_encoding in server_encodings
+            and preferred_encoding in MessageProtocolAdapter.available_encodings()
+        ):
+            return preferred_encoding
+        return ENCODING_JSON
+
+    @staticmethod
+    def encode_envelope(payload: Dict[str, Any], encoding: str) -> bytes:
+        """Encode a v2 envelope with the negotiated encoding."""
+        if encoding == ENCODING_MSGPACK:
+            return msgpack.packb(payload, use_bin_type=True)
+        if encoding == ENCODING_CBOR:
+            return cbor2.dumps(payload)
+        return json.dumps(payload, separators=(",", ":")).encode("utf-8")
+
+    @staticmethod
+    def decode_envelope(data: bytes, encoding: str) -> Dict[str, Any]:
+        """Decode a v2 envelope encoded with the given encoding."""
+        if encoding == ENCODING_MSGPACK:
+            if msgpack is None:
+                raise CommunicationError("Received MessagePack frame without msgpack")
+            return msgpack.unpackb(data, raw=False)
+        if encoding == ENCODING_CBOR:
+            if cbor2 is None:
+                raise CommunicationError("Received CBOR frame without cbor2")
+            return cbor2.loads(data)
+        return json.loads(data.decode("utf-8"))
+
+    @staticmethod
+    def serialize_message(
+        message: Dict[str, Any],
+        protocol_version: int = PROTOCOL_VERSION_V1,
+        encoding: str = ENCODING_JSON,
+    ) -> bytes:
         """Serialize a message to bytes for transmission."""
         try:
+            if protocol_version >= PROTOCOL_VERSION_V2:
+                body = MessageProtocolAdapter.encode_envelope(
+                    message["payload"], encoding
+                )
+                flags = ENCODING_IDS[encoding] << FRAME_ENCODING_SHIFT
+                header = FRAME_HEADER.pack(
+                    FRAME_MAGIC,
+                    PROTOCOL_VERSION_V2,
+                    message["message_type"],
+                    flags,
+                    len(body),
+                )
+                return header + body
+
             # Use the same format as C++ extension
             message_str = json.dumps(message, separators=(",", ":"))
             message_bytes = message_str.encode("utf-8")
 
             # Add delimiter to match C++ extension
-            delimiter = b"\r\n\r\n"
-            return message_bytes + delimiter
+            return message_bytes + MESSAGE_DELIMITER
 
-        except (TypeError, ValueError) as e:
+        except (TypeError, ValueError, KeyError, struct.error) as e:
             raise CommunicationError(f"Failed to serialize message: {e}")
 
+    @staticmethod
+    def complete_frame_size(data: bytes) -> Optional[int]:
+        """
+        Return the size of the first complete frame in data, if any.
+
+        Args:
+            data: Bytes received so far
+
+        Returns:
+            Length of the complete frame, or None if more data is needed
+        """
+        if data.startswith(FRAME_MAGIC):
+            if len(data) < FRAME_HEADER.size:
+                return None
+            _, _, _, _, length = FRAME_HEADER.unpack_from(data)
+            frame_size = FRAME_HEADER.size + length
+            return frame_size if len(data) >= frame_size else None
+
+        delimiter_pos = data.find(MESSAGE_DELIMITER)
+        if delimiter_pos == -1:
+            return None
+        return delimiter_pos + len(MESSAGE_DELIMITER)
+
+    @staticmethod
+    def decode_frame(data: bytes) -> Tuple[int, Dict[str, Any], Optional[bytes]]:
+        """
+        Split a frame into its message type, JSON payload and raw body.
+
+        Args:
+            data: One complete v1 or v2 frame
+
+        Returns:
+            Tuple of (message_type, payload, raw_body); raw_body is None unless
+            the frame carries output outside the JSON envelope
+        """
+        if data.startswith(FRAME_MAGIC):
+            _, version, message_type, flags, length = FRAME_HEADER.unpack_from(data)
+            if version != PROTOCOL_VERSION_V2:
+                raise CommunicationError(f"Unsupported protocol version {version}")
+
+            body = data[FRAME_HEADER.size : FRAME_HEADER.size + length]
+            raw_body = None
+            if flags & FRAME_FLAG_RAW_BODY:
+                (envelope_size,) = ENVELOPE_SIZE.unpack_from(body)
+                envelope_end = ENVELOPE_SIZE.size + envelope_size
+                raw_body = body[envelope_end:]
+                body = body[ENVELOPE_SIZE.size : envelope_end]
+
+            encoding = ENCODING_NAMES.get(
+                (flags & FRAME_ENCODING_MASK) >> FRAME_ENCODING_SHIFT
+            )
+            if encoding is None:
+                raise CommunicationError(f"Unsupported frame encoding flags {flags:#x}")
+
+            payload = MessageProtocolAdapter.decode_envelope(body, encoding)
+            return message_type, payload, raw_body
+
+        # Remove delimiter if present
+        if data.endswith(MESSAGE_DELIMITER):
+            data = data[: -len(MESSAGE_DELIMITER)]
+
+        parsed = json.loads(data.decode("utf-8"))
+        if "protocol_version" in parsed and "payload" in parsed:
+            return parsed.get("message_type", 0), parsed["payload"], None
+
+        # Fallback to old format
+        return 0, parsed, None
+
     @staticmethod
     def parse_response(response_data: bytes) -> Dict[str, Any]:
         """Parse the response data from the extension."""
         try:
-            # Remove delimiter if present
-            if response_data.endswith(b"\r\n\r\n"):
-                response_data = response_data[:-4]
-
-            # Decode and parse JSON
-            response_str = response_data.decode("utf-8")
-            parsed = json.loads(response_str)
+            message_type, payload, raw_body = MessageProtocolAdapter.decode_frame(
+                response_data
+            )
+            if raw_body is not None:
+                payload["output"] = raw_body.decode("utf-8", errors="replace")
 
             # Handle the C++ extension response format
-            if "protocol_version" in parsed and "payload" in parsed:
-                # This is the new protocol format
-                payload = parsed["payload"]
-
-                if payload.get("type") == "response":
-                    return {
-                        "status": (
-                            "success" if payload.get("success", False) else "error"
-                        ),
-                        "output": payload.get("output", ""),
-                        "error": (
-                            payload.get("error_message", "")
-                            if not payload.get("success", False)
-                            else None
-                        ),
-                        "execution_time_ms": payload.get("execution_time_ms", 0),
-                        "request_id": payload.get("request_id", ""),
-                    }
-                elif payload.get("type") == "error":
-                    return {
-                        "status": "error",
-                        "error": payload.get("error_message", "Unknown error"),
-                        "error_code": payload.get("error_code", 0),
-                        "request_id": payload.get("request_id", ""),
-                    }
-            else:
+            if message_type == 0:
                 # Fallback to old format
-                return parsed
+                return payload
+
+            if payload.get("type") == "response":
+                return {
+                    "status": (
+                        "success" if payload.get("success", False) else "error"
+                    ),
+                    "output": payload.get("output", ""),
+                    "error": (
+                        payload.get("error_message", "")
+                        if not payload.get("success", False)
+                        else None
+                    ),
+                    "execution_time_ms": payload.get("execution_time_ms", 0),
+                    "request_id": payload.get("request_id", ""),
+                    "sequence": payload.get("sequence", 0),
+                    "final": payload.get("final", True),
+                    "data": payload.get("data"),
+                    "session_data": payload.get("session_data"),
+                    "raw_output": raw_body,
+                }
+            elif payload.get("type") == "error":
+                details = payload.get("details") or {}
+                return {
+                    "status": "error",
+                    "error": payload.get("error_message", "Unknown error"),
+                    "error_code": payload.get("error_code", 0),
+                    "request_id": payload.get("request_id", ""),
+                    "retry_after_ms": (
+                        details.get("retry_after_ms", 0)
+                        if isinstance(details, dict)
+                        else 0
+                    ),
+                }
+            elif payload.get("type") == "heartbeat":
+                return {
+                    "status": "success",
+                    "type": "heartbeat",
+                    "session_info": payload.get("session_info", {}),
+                }
+            elif payload.get("type") == "event":
+                return {
+                    "status": "success",
+                    "type": "event",
+                    "event": payload.get("event", ""),
+                    "data": payload.get("data") or {},
+                    "sequence": payload.get("sequence", 0),
+                    "coalesced": payload.get("coalesced", 0),
+                    "dropped": payload.get("dropped", 0),
+                }
 
         except json.JSONDecodeError as e:
             logger.error(f"Failed to parse response: {e}")
@@ -352,6 +839,18 @@ class MessageProtocolAdapter:
         except UnicodeDecodeError as e:
             logger.error(f"Failed to decode response: {e}")
             raise CommunicationError(f"Invalid response encoding from WinDbg extension")
+        except (struct.error, ValueError) as e:
+            logger.error(f"Malformed binary frame: {e}")
+            raise CommunicationError(f"Invalid response frame from WinDbg extension")
+
+    @staticmethod
+    def raise_if_busy(response: Dict[str, Any]):
+        """Raise ServerBusyError if the response refuses the request as busy."""
+        if response.get("error_code") == ERROR_CODE_BUSY:
+            raise ServerBusyError(
+                response.get("error", "Server busy"),
+                int(response.get("retry_after_ms") or 0),
+            )
 
     @staticmethod
     def validate_response(response: Dict[str, Any]) -> bool:
@@ -394,6 +893,175 @@ class MessageProtocolAdapter:
 # ====================================================================
 
 
+class PipelinedConnection:
+    """
+    A pooled pipe that carries several requests at once.
+
+    Requests are written as they are made and matched to their responses by
+    request_id, so a cached or quick reply overtakes a long command sent
+    before it. One reader thread takes every frame off the pipe. It only reads
+    bytes PeekNamedPipe reports as waiting: the handle is synchronous, and a
+    blocking read on it would hold up every writer.
+    """
+
+    # Poll interval while requests are outstanding; an idle connection does not poll
+    POLL_INTERVAL_S = 0.001
+
+    def __init__(self, handle: Any, max_in_flight: int):
+        self.handle = handle
+        self.max_in_flight = max(1, max_in_flight)
+        self._lock = threading.Lock()
+        self._write_lock = threading.Lock()
+        self._waiters: Dict[str, "queue.Queue[Any]"] = {}  # In the order sent
+        self._pending = bytearray()
+        self._wake = threading.Event()
+        self._error: Optional[Exception] = None
+        self._reader = threading.Thread(
+            target=self._read_frames, name="vibedbg-pipeline", daemon=True
+        )
+        self._reader.start()
+
+    @property
+    def broken(self) -> bool:
+        """True once the pipe failed or was closed; no request can be sent on it."""
+        return self._error is not None
+
+    def request(
+        self, message_data: bytes, request_id: str, timeout_ms: int
+    ) -> Dict[str, Any]:
+        """
+        Send one request and wait for its response.
+
+        The timeout applies to each frame of the response, as for a pipe
+        that carries one request at a time. A response that arrives after
+        its request timed out is dropped.
+        """
+        frames: "queue.Queue[Any]" = queue.Queue()
+        with self._lock:
+            if self._error is not None:
+                raise self._error
+            if request_id in self._waiters:
+                raise ValueError(f"Request id {request_id} is already in flight")
+            self._waiters[request_id] = frames
+        self._wake.set()
+
+        def next_frame() -> Dict[str, Any]:
+            try:
+                frame = frames.get(timeout=timeout_ms / 1000.0)
+            except queue.Empty:
+                raise TimeoutError(
+                    f"No response to request {request_id} after {timeout_ms}ms"
+                )
+            if isinstance(frame, Exception):
+                raise frame
+            return frame
+
+        try:
+            with self._write_lock:
+                NamedPipeProtocol.write_to_pipe(self.handle, message_data, timeout_ms)
+            return assemble_response(next_frame)
+        finally:
+            with self._lock:
+                self._waiters.pop(request_id, None)
+
+    def close(self):
+        """Stop the reader; requests still waiting fail with ConnectionError."""
+        self._fail(ConnectionError("Pipelined connection closed"))
+        if self._reader is not threading.current_thread():
+            self._reader.join(timeout=1.0)
+
+    def _read_frames(self):
+        """Reader thread: hand every response frame to the request it answers."""
+        while True:
+            self._wake.clear()
+            with self._lock:
+                if self._error is not None:
+                    return
+                idle = not self._waiters
+            if idle:
+                self._wake.wait()
+                continue
+
+            try:
+                _, available, _ = win32pipe.PeekNamedPipe(self.handle, 0)
+                if not available:
+                    time.sleep(self.POLL_INTERVAL_S)
+                    continue
+                _, data = win32file.ReadFile(self.handle, available)
+                self._pending += data
+
+                while True:
+                    frame_size = MessageProtocolAdapter.complete_frame_size(
+                        bytes(self._pending)
+                    )
+                    if frame_size is None:
+                        break
+                    frame = bytes(self._pending[:frame_size])
+                    del self._pending[:frame_size]
+                    self._route(MessageProtocolAdapter.parse_response(frame))
+            except pywintypes.error as e:
+                self._fail(ConnectionError(f"Pipelined connection lost: {str(e)}"))
+            except CommunicationError as e:
+                # A frame that cannot be parsed leaves the stream unusable
+                self._fail(e)
+
+    def _route(self, response: Dict[str, Any]):
+        if response.get("type") == "event":
+            # Pushed events may arrive between any two frames
+            return
+
+        request_id = response.get("request_id", "")
+        with self._lock:
+            frames = self._waiters.get(request_id)
+            if frames is None and request_id in ("", "unknown") and self._waiters:
+                # The extension could not read the request's id; it answers
+                # frames that fail to parse as it reads them, so the oldest
+                # request is the likeliest one
+                frames = next(iter(self._waiters.values()))
+        if frames is None:
+            logger.debug(f"Dropped response to request {request_id}, no longer awaited")
+            return
+        frames.put(response)
+
+    def _fail(self, error: Exception):
+        with self._lock:
+            if self._error is None:
+                self._error = error
+            waiters = list(self._waiters.values())
+        for frames in waiters:
+            frames.put(error)
+        self._wake.set()
+
+
+def assemble_response(next_frame) -> Dict[str, Any]:
+    """
+    Assemble one response from its frames, reassembling streamed chunks.
+
+    Args:
+        next_frame: Returns the next parsed frame of the response
+
+    Returns:
+        Parsed final response with the output of all chunks prepended
+    """
+    chunks: List[str] = []
+    while True:
+        response = next_frame()
+        if response.get("final", True):
+            break
+
+        if response.get("sequence") != len(chunks):
+            raise CommunicationError(
+                f"Out of order response chunk {response.get('sequence')}, "
+                f"expected {len(chunks)}"
+            )
+        chunks.append(response.get("output", ""))
+
+    if chunks:
+        logger.debug(f"Reassembled streamed response from {len(chunks)} chunks")
+        response["output"] = "".join(chunks) + response.get("output", "")
+    return response
+
+
 class ConnectionPool:
     """Thread-safe connection pool for named pipe connections."""
 
@@ -424,9 +1092,18 @@ class ConnectionPool:
                 # Wait for available connection
                 start_time = time.time()
                 while (time.time() - start_time) * 1000 < timeout_ms:
+                    # A warm pipelined connection with room takes the request
+                    # before an idle or a new connection does
+                    shared = self._least_loaded_pipeline()
+                    if shared is not None:
+                        shared.in_flight += 1
+                        shared.last_used = datetime.now()
+                        shared.use_count += 1
+                        return shared.pipeline
+
                     # Check for available connection
                     for conn_handle in self._connections:
-                        if not conn_handle.in_use:
+                        if conn_handle.pipeline is None and not conn_handle.in_use:
                             conn_handle.in_use = True
                             conn_handle.last_used = datetime.now()
                             conn_handle.use_count += 1
@@ -440,17 +1117,36 @@ class ConnectionPool:
                             handle = NamedPipeProtocol.connect_to_pipe(
                                 self._pipe_name, timeout_ms
                             )
+                            try:
+                                protocol_version, encoding, max_in_flight = (
+                                    self._negotiate_protocol(handle, timeout_ms)
+                                )
+                            except ServerBusyError:
+                                NamedPipeProtocol.close_pipe(handle)
+                                raise
+                            max_in_flight = min(max_in_flight, config.max_in_flight)
+                            pipeline = (
+                                PipelinedConnection(handle, max_in_flight)
+                                if max_in_flight > 1
+                                else None
+                            )
                             conn_handle = ConnectionHandle(
                                 handle=handle,
                                 created_at=datetime.now(),
                                 last_used=datetime.now(),
-                                in_use=True,
+                                in_use=pipeline is None,
                                 use_count=1,
                                 thread_id=threading.get_ident(),
+                                protocol_version=protocol_version,
+                                encoding=encoding,
+                                pipeline=pipeline,
+                                in_flight=1 if pipeline else 0,
                             )
                             self._connections.append(conn_handle)
                             logger.debug("Created new connection for pool")
-                            return handle
+                            return pipeline or handle
+                        except ServerBusyError:
+                            raise
                         except ConnectionError as ce:
                             logger.warning(
                                 f"Failed to create new connection (connection error): {ce}"
@@ -474,28 +1170,119 @@ class ConnectionPool:
                         break
 
                 raise ConnectionError("Timeout waiting for available connection")
-        except ConnectionError:
+        except (ConnectionError, ServerBusyError):
             raise
         except Exception as e:
             logger.error(f"Unexpected error acquiring connection: {e}", exc_info=True)
             raise ConnectionError(f"Failed to acquire connection: {e}")
 
+    def _least_loaded_pipeline(self) -> Optional[ConnectionHandle]:
+        """Return the usable pipelined connection with the fewest requests in flight."""
+        candidates = [
+            conn_handle
+            for conn_handle in self._connections
+            if conn_handle.pipeline is not None
+            and not conn_handle.pipeline.broken
+            and conn_handle.in_flight < conn_handle.pipeline.max_in_flight
+        ]
+        return min(candidates, key=lambda c: c.in_flight, default=None)
+
+    def _negotiate_protocol(
+        self, handle: Any, timeout_ms: int
+    ) -> Tuple[int, str, int]:
+        """
+        Agree on a wire format for a freshly opened connection.
+
+        The exchange itself always uses v1 framing. Extensions that predate
+        negotiation answer with an error, which leaves the connection on v1.
+
+        Args:
+            handle: Newly connected pipe handle
+            timeout_ms: Timeout for the heartbeat round trip
+
+        Returns:
+            Tuple of (protocol version, envelope encoding, requests the
+            extension takes at once) for this connection
+        """
+        if config.protocol_version <= PROTOCOL_VERSION_V1:
+            return PROTOCOL_VERSION_V1, ENCODING_JSON, 1
+
+        try:
+            message = MessageProtocolAdapter.create_heartbeat_message()
+            NamedPipeProtocol.write_to_pipe(
+                handle, MessageProtocolAdapter.serialize_message(message), timeout_ms
+            )
+            reply = MessageProtocolAdapter.parse_response(
+                NamedPipeProtocol.read_from_pipe(handle, timeout_ms)
+            )
+            # A connection past the extension's limit is refused on its first frame
+            MessageProtocolAdapter.raise_if_busy(reply)
+            server_info = (
+                reply.get("session_info") if reply.get("type") == "heartbeat" else None
+            )
+            version = MessageProtocolAdapter.negotiate_protocol_version(
+                server_info, config.protocol_version
+            )
+            encoding = ENCODING_JSON
+            if version >= PROTOCOL_VERSION_V2:
+                encoding = MessageProtocolAdapter.negotiate_encoding(
+                    server_info, config.payload_encoding
+                )
+            # Extensions that answer one request at a time do not advertise it
+            max_in_flight = 1
+            if isinstance(server_info, dict):
+                max_in_flight = int(server_info.get("max_in_flight", 1) or 1)
+            logger.debug(
+                f"Negotiated protocol version {version} ({encoding}), "
+                f"{max_in_flight} requests in flight"
+            )
+            return version, encoding, max_in_flight
+        except ServerBusyError:
+            raise
+        except CommunicationError as e:
+            logger.debug(f"Protocol negotiation failed, using v1: {e}")
+            return PROTOCOL_VERSION_V1, ENCODING_JSON, 1
+
+    def get_wire_format(self, connection: Any) -> Tuple[int, str]:
+        """Return the (protocol version, encoding) negotiated for a pooled connection."""
+        with self._lock:
+            conn_handle = self._find(connection)
+            if conn_handle is not None:
+                return conn_handle.protocol_version, conn_handle.encoding
+        return PROTOCOL_VERSION_V1, ENCODING_JSON
+
+    def _find(self, connection: Any) -> Optional[ConnectionHandle]:
+        """Find the pool entry of a handle or pipelined connection get_connection yielded."""
+        for conn_handle in self._connections:
+            if conn_handle.handle == connection or (
+                conn_handle.pipeline is not None and conn_handle.pipeline is connection
+            ):
+                return conn_handle
+        return None
+
     def _release_connection(self, connection: Any):
         """Release a connection back to the pool."""
         try:
             with self._lock:
-                for conn_handle in self._connections:
-                    if conn_handle.handle == connection:
+                conn_handle = self._find(connection)
+                if conn_handle is not None:
+                    if conn_handle.pipeline is not None:
+                        conn_handle.in_flight -= 1
+                        if conn_handle.pipeline.broken and conn_handle.in_flight == 0:
+                            # Its last request is done; retries open a new connection
+                            conn_handle.pipeline.close()
+                            NamedPipeProtocol.close_pipe(conn_handle.handle)
+                            self._connections.remove(conn_handle)
+                    else:
                         conn_handle.in_use = False
-                        conn_handle.last_used = datetime.now()
-                        try:
-                            self._queue_condition.notify()
-                        except Exception as e:
-                            logger.warning(
-                                f"Error notifying condition during connection release: {e}"
-                            )
-                        logger.debug("Released connection back to pool")
-                        break
+                    conn_handle.last_used = datetime.now()
+                    try:
+                        self._queue_condition.notify()
+                    except Exception as e:
+                        logger.warning(
+                            f"Error notifying condition during connection release: {e}"
+                        )
+                    logger.debug("Released connection back to pool")
         except Exception as e:
             logger.error(f"Error releasing connection: {e}", exc_info=True)
 
@@ -508,7 +1295,7 @@ class ConnectionPool:
 
                 for conn_handle in self._connections:
                     try:
-                        if not conn_handle.in_use:
+                        if not conn_handle.in_use and conn_handle.in_flight == 0:
                             age_hours = (
                                 current_time - conn_handle.created_at
                             ).total_seconds() / 3600
@@ -521,6 +1308,8 @@ class ConnectionPool:
 
                 for conn_handle in connections_to_remove:
                     try:
+                        if conn_handle.pipeline is not None:
+                            conn_handle.pipeline.close()
                         NamedPipeProtocol.close_pipe(conn_handle.handle)
                         self._connections.remove(conn_handle)
                         logger.debug("Cleaned up old connection from pool")
@@ -540,6 +1329,8 @@ class ConnectionPool:
             with self._lock:
                 for conn_handle in self._connections:
                     try:
+                        if conn_handle.pipeline is not None:
+                            conn_handle.pipeline.close()
                         NamedPipeProtocol.close_pipe(conn_handle.handle)
                     except Exception as e:
                         logger.error(f"Error closing connection: {e}", exc_info=True)
@@ -557,7 +1348,10 @@ class ConnectionPool:
 class CommunicationManager:
     """Main communication manager for WinDbg extension interaction."""
 
-    def __init__(self):
+    def __init__(self, session_id: Optional[str] = None):
+        # Every request carries the session id, so the extension restores
+        # this server's process, thread and frame before running it
+        self.session_id = session_id or config.session_id or uuid.uuid4().hex
         self._connection_health = ConnectionHealth(
             is_connected=True,
             last_successful_command=None,
@@ -570,11 +1364,25 @@ class CommunicationManager:
         self._connection_pool = ConnectionPool()
         self._retry_count = 0
 
-    def send_command(self, command: str, timeout_ms: int = DEFAULT_TIMEOUT_MS) -> str:
-        """Send a command to the WinDbg extension."""
+    def send_command(
+        self,
+        command: str,
+        timeout_ms: int = DEFAULT_TIMEOUT_MS,
+        output_filter: Optional[Dict[str, Any]] = None,
+    ) -> str:
+        """Send a command to the WinDbg extension.
+
+        output_filter holds any of grep, head, tail, max_bytes and fields; the
+        extension applies them to the output before sending it.
+        """
         logger.debug(f"Sending command: {command}")
 
-        message = MessageProtocolAdapter.create_command_message(command, timeout_ms)
+        message = MessageProtocolAdapter.create_command_message(
+            command,
+            timeout_ms,
+            stream=config.stream_responses,
+            output_filter=output_filter,
+        )
 
         try:
             response = self._send_message(message, timeout_ms)
@@ -605,7 +1413,7 @@ class CommunicationManager:
             self._update_health_on_success()
             return response.get("output", "")
 
-        except (TimeoutError, ConnectionError, NetworkDebuggingError):
+        except (TimeoutError, ConnectionError, NetworkDebuggingError, ServerBusyError):
             self._update_health_on_failure(f"Command '{command}' failed")
             raise
         except ValueError as e:
@@ -644,7 +1452,7 @@ class CommunicationManager:
             self._update_health_on_success()
             return response
 
-        except (TimeoutError, ConnectionError):
+        except (TimeoutError, ConnectionError, ServerBusyError):
             self._update_health_on_failure(f"Handler '{handler_name}' failed")
             raise
         except ValueError as e:
@@ -661,8 +1469,399 @@ class CommunicationManager:
             )
             raise CommunicationError(f"Unexpected error executing handler: {str(e)}")
 
+    def read_memory(
+        self, ranges: List[Tuple[int, int]], timeout_ms: int = DEFAULT_TIMEOUT_MS
+    ) -> List[Dict[str, Any]]:
+        """
+        Read target memory directly, without formatting it as a db dump.
+
+        All ranges are served by one request; adjacent ranges are coalesced
+        by the extension into a single read.
+
+        Args:
+            ranges: (address, size) pairs to read
+            timeout_ms: Maximum time to wait for the response
+
+        Returns:
+            One dict per range with address, size, status ("ok", "partial" or
+            "error") and the bytes that could be read
+        """
+        response = self._send_structured(
+            "read_memory",
+            timeout_ms,
+            ranges=[{"address": address, "size": size} for address, size in ranges],
+        )
+        data = response.get("data") or {}
+
+        # v2 frames carry the bytes raw; v1 responses are base64 text
+        if data.get("encoding") == "raw" and response.get("raw_output") is not None:
+            blob = response["raw_output"]
+        else:
+            blob = base64.b64decode(response.get("output", ""))
+
+        results = []
+        for entry in data.get("ranges", []):
+            offset = entry.get("offset", 0)
+            results.append(
+                {
+                    "address": entry.get("address"),
+                    "size": entry.get("size"),
+                    "status": entry.get("status", "error"),
+                    "error": entry.get("error"),
+                    "data": blob[offset : offset + entry.get("bytes_read", 0)],
+                }
+            )
+        return results
+
+    def search_memory(
+        self,
+        address: int,
+        length: int,
+        pattern: bytes,
+        max_hits: Optional[int] = None,
+        timeout_ms: int = DEFAULT_TIMEOUT_MS,
+    ) -> List[int]:
+        """Search target memory for a byte pattern, returning match addresses."""
+        params: Dict[str, Any] = {
+            "address": address,
+            "length": length,
+            "pattern": pattern.hex(),
+        }
+        if max_hits is not None:
+            params["max_hits"] = max_hits
+
+        response = self._send_structured("search_memory", timeout_ms, **params)
+        return list((response.get("data") or {}).get("hits", []))
+
+    def execute_batch(
+        self,
+        commands: List[str],
+        stop_on_error: bool = False,
+        timeout_per_command_ms: int = DEFAULT_TIMEOUT_MS,
+    ) -> Dict[str, Any]:
+        """
+        Execute several commands in a single round-trip.
+
+        The extension runs the commands back-to-back and answers with one
+        response, so a triage script pays one pipe round-trip in total.
+
+        Args:
+            commands: Commands to execute in order
+            stop_on_error: Skip the remaining commands after the first failure
+            timeout_per_command_ms: Timeout applied to each command
+
+        Returns:
+            Batch result with a "results" list holding command, success,
+            output, error_message and execution_time_ms per executed command,
+            plus successful/failed/skipped counts and total_execution_time_ms
+        """
+        # The response only arrives after every command has run
+        timeout_ms = timeout_per_command_ms * max(len(commands), 1)
+        response = self._send_structured(
+            "execute_batch",
+            timeout_ms,
+            commands=list(commands),
+            stop_on_error=stop_on_error,
+            timeout_per_command_ms=timeout_per_command_ms,
+        )
+        return response.get("data") or {}
+
+    def analyze_dumps(
+        self,
+        dumps: List[str],
+        commands: List[str],
+        max_parallel: Optional[int] = None,
+        timeout_per_dump_ms: int = LARGE_ANALYSIS_TIMEOUT_MS,
+        symbol_path: Optional[str] = None,
+    ) -> Dict[str, Any]:
+        """
+        Run the same commands against several crash dumps in parallel.
+
+        Each dump is opened by a worker debugger of its own on the machine
+        running the extension, so the attached target is left alone.
+
+        Args:
+            dumps: Dump file paths, as seen by the extension
+            commands: Commands to run against every dump
+            max_parallel: Workers running at once (default: one per core)
+            timeout_per_dump_ms: Time each worker may run
+            symbol_path: Symbol path for the workers (default: theirs)
+
+        Returns:
+            Result with a "results" list holding dump, success, exit_code,
+            timed_out, output and execution_time_ms per dump, in request
+            order, plus successful_dumps and failed_dumps
+        """
+        params: Dict[str, Any] = {
+            "dumps": list(dumps),
+            "commands": list(commands),
+            "timeout_per_dump_ms": timeout_per_dump_ms,
+        }
+        if max_parallel is not None:
+            params["max_parallel"] = max_parallel
+        if symbol_path:
+            params["symbol_path"] = symbol_path
+
+        # Dumps beyond the worker count wait for a free worker
+        waves = -(-len(dumps) // max(max_parallel or 1, 1))
+        response = self._send_structured(
+            "analyze_dumps", timeout_per_dump_ms * max(waves, 1), **params
+        )
+        return response.get("data") or {}
+
+    def scan_heap(
+        self,
+        region_types: Optional[List[str]] = None,
+        patterns: Optional[List[str]] = None,
+        top: Optional[int] = None,
+        vtables_only: bool = True,
+        max_bytes: Optional[int] = None,
+        max_parallel: Optional[int] = None,
+        timeout_ms: int = 600000,
+    ) -> Dict[str, Any]:
+        """
+        Count the objects in the target's memory by the vtable they point to.
+
+        The extension reads the committed regions in large blocks and matches
+        them on a thread pool, instead of the client looping over "s -d" or
+        parsing "!heap -stat".
+
+        Args:
+            region_types: Any of "private", "mapped" and "image" (default: private)
+            patterns: Hex byte signatures to count alongside, e.g. "4d5a9000"
+            top: Histogram entries to return (extension default: 50)
+            vtables_only: Keep only pointers that resolve to a vftable symbol
+            max_bytes: Committed memory to scan at most (extension default: 4 GB)
+            max_parallel: Matching threads (default: one per core, at most 8)
+
+        Returns:
+            histogram of value, symbol, count and estimated bytes, most
+            frequent first; patterns with count and the lowest hits; plus
+            regions, bytes_scanned, bytes_unreadable, distinct_pointers,
+            resolved, truncated, pointer_size, threads and elapsed_ms
+        """
+        params: Dict[str, Any] = {}
+        if region_types:
+            params["region_types"] = list(region_types)
+        if patterns:
+            params["patterns"] = list(patterns)
+        if top is not None:
+            params["top"] = top
+        if not vtables_only:
+            params["vtables_only"] = False
+        if max_bytes is not None:
+            params["max_bytes"] = max_bytes
+        if max_parallel is not None:
+            params["max_parallel"] = max_parallel
+        response = self._send_structured("scan_heap", timeout_ms, **params)
+        return response.get("data") or {}
+
+    def disassemble(
+        self,
+        ranges: Optional[List[Dict[str, Any]]] = None,
+        stack_frames: Optional[int] = None,
+        count: Optional[int] = None,
+        before: Optional[int] = None,
+        timeout_ms: int = DEFAULT_TIMEOUT_MS,
+    ) -> Dict[str, Any]:
+        """
+        Disassemble several address ranges, or the frames of the current stack, at once.
+
+        The extension decodes every range in one engine job, with symbols and
+        source lines, and serves ranges it decoded before from its cache, so
+        disassembling a whole stack costs one round-trip instead of one "u"
+        per frame.
+
+        Args:
+            ranges: Ranges as {"address", "count", "before", "end"}; addresses
+                may be numbers or hex strings
+            stack_frames: Also disassemble around the first N frames of the
+                current thread's stack
+            count: Instructions per range (extension default: 16, or 8 per frame)
+            before: Instructions before each address, as "ub" would show them
+                (extension default: 0, or 8 per frame)
+
+        Returns:
+            ranges with address, start, frame (for stack frames), cached and
+            instructions, each holding address, size, text and, where they
+            change, symbol, displacement, file and line; plus instructions,
+            cached_instructions, truncated and elapsed_ms
+        """
+        params: Dict[str, Any] = {}
+        if ranges:
+            params["ranges"] = [dict(entry) for entry in ranges]
+        if stack_frames:
+            params["stack_frames"] = stack_frames
+        if count is not None:
+            params["count"] = count
+        if before is not None:
+            params["before"] = before
+        response = self._send_structured("disassemble", timeout_ms, **params)
+        return response.get("data") or {}
+
+    def get_metrics(self, timeout_ms: int = DEFAULT_TIMEOUT_MS) -> Dict[str, Any]:
+        """
+        Read the extension's request counters and latency histograms.
+
+        Returns:
+            Metrics with uptime_ms, "counters" by name, "stages" holding
+            count, mean_us, p50_us, p90_us, p99_us and max_us per pipeline
+            stage, "commands" with the same summary per command name, most
+            total time first, plus symbol_cache and pending_commands
+        """
+        response = self._send_structured("metrics", timeout_ms)
+        return response.get("data") or {}
+
+    def get_modules(self, timeout_ms: int = DEFAULT_TIMEOUT_MS) -> List[Dict[str, Any]]:
+        """
+        List loaded and unloaded modules without parsing "lm" output.
+
+        Returns:
+            One dict per module with name, image_name, base, size, timestamp,
+            checksum, symbol_type and unloaded
+        """
+        return self._query_state("get_modules", "modules", [], timeout_ms)
+
+    def get_threads(self, timeout_ms: int = DEFAULT_TIMEOUT_MS) -> List[Dict[str, Any]]:
+        """List threads as engine_id, system_id and current, without parsing "~" output."""
+        return self._query_state("get_threads", "threads", [], timeout_ms)
+
+    def get_stack_trace(
+        self, max_frames: Optional[int] = None, timeout_ms: int = DEFAULT_TIMEOUT_MS
+    ) -> List[Dict[str, Any]]:
+        """
+        Walk the current thread's stack without parsing "k" output.
+
+        Returns:
+            One dict per frame with frame_number, instruction_offset,
+            return_offset, frame_offset, stack_offset, symbol and displacement
+        """
+        params = {"max_frames": max_frames} if max_frames is not None else {}
+        return self._query_state("get_stack_trace", "frames", [], timeout_ms, **params)
+
+    def get_thread_stacks(
+        self, max_frames: Optional[int] = None, timeout_ms: int = DEFAULT_TIMEOUT_MS
+    ) -> Dict[str, Any]:
+        """
+        Walk every thread's stack with identical stacks folded together.
+
+        Returns:
+            thread_count, unique_stacks and buckets, most common stack first;
+            each bucket has count, threads (system ids) and frames holding
+            instruction_offset, symbol and displacement
+        """
+        params = {"max_frames": max_frames} if max_frames is not None else {}
+        response = self._send_structured("get_thread_stacks", timeout_ms, **params)
+        return response.get("session_data") or {}
+
+    def get_registers(self, timeout_ms: int = DEFAULT_TIMEOUT_MS) -> Dict[str, Any]:
+        """Read the current thread's registers as a name to value mapping."""
+        return self._query_state("get_registers", "registers", {}, timeout_ms)
+
+    def query_data_model(
+        self,
+        expression: str,
+        offset: int = 0,
+        limit: Optional[int] = None,
+        depth: Optional[int] = None,
+        raw: bool = False,
+        timeout_ms: int = DEFAULT_TIMEOUT_MS,
+    ) -> Dict[str, Any]:
+        """
+        Evaluate a dx expression and walk the result through the data model.
+
+        Collections come back one page at a time and nested objects only to
+        the depth asked for, so a large collection is never formatted whole.
+        Every node carries the expression that reaches it; query that to
+        expand a node or fetch the next page of its elements.
+
+        Args:
+            expression: Any expression dx accepts, e.g. "@$curprocess.Threads"
+            offset: Elements of the result's collection to skip
+            limit: Elements per collection (extension default: 100)
+            depth: Levels expanded below the result (extension default: 1)
+            raw: List native fields even where a visualizer supplies the view
+
+        Returns:
+            expression, truncated and result; each node has kind and, where
+            they apply, expression, type, location, value, display, name,
+            index, properties, fields, elements with offset, has_more and
+            next_offset, and expandable
+        """
+        params: Dict[str, Any] = {"expression": expression}
+        if offset:
+            params["offset"] = offset
+        if limit is not None:
+            params["limit"] = limit
+        if depth is not None:
+            params["depth"] = depth
+        if raw:
+            params["raw"] = True
+        response = self._send_structured("dx_query", timeout_ms, **params)
+        return response.get("session_data") or {}
+
+    def get_session_state(self, timeout_ms: int = DEFAULT_TIMEOUT_MS) -> Dict[str, Any]:
+        """
+        Read the session state the extension keeps from debugger events.
+
+        The extension answers from its own record without waiting for the
+        debugger, so this is cheap enough to call before every tool.
+
+        Returns:
+            connected, target_running, thread_count, module_count and
+            generation, plus current_process (process_id, process_name,
+            image_path, is_attached) and current_thread (thread_id,
+            process_id, state) when there is a target
+        """
+        response = self._send_structured("get_session_state", timeout_ms)
+        return response.get("session_data") or {}
+
+    def subscribe_events(
+        self, events: Optional[List[str]] = None, timeout_ms: int = DEFAULT_TIMEOUT_MS
+    ) -> EventSubscription:
+        """
+        Subscribe to debugger events pushed by the extension.
+
+        Args:
+            events: Event types from EVENT_TYPES; all of them when omitted
+
+        Returns:
+            An open subscription; close it when done
+        """
+        subscription = EventSubscription(list(events or EVENT_TYPES))
+        subscription.open(timeout_ms)
+        return subscription
+
+    def _query_state(
+        self, operation: str, key: str, default: Any, timeout_ms: int, **params
+    ) -> Any:
+        """Send a structured state request and return one field of its session_data."""
+        response = self._send_structured(operation, timeout_ms, **params)
+        return (response.get("session_data") or {}).get(key, default)
+
+    def _send_structured(
+        self, handler_name: str, timeout_ms: int, **params
+    ) -> Dict[str, Any]:
+        """Send a structured request and return its parsed response."""
+        message = MessageProtocolAdapter.create_handler_message(handler_name, **params)
+        message["payload"]["timeout_ms"] = timeout_ms
+
+        try:
+            response = self._send_message(message, timeout_ms)
+        except (TimeoutError, ConnectionError, ServerBusyError):
+            self._update_health_on_failure(f"Request '{handler_name}' failed")
+            raise
+
+        if response.get("status") == "error":
+            error_message = response.get("error", "Unknown error")
+            raise CommunicationError(f"{handler_name} failed: {error_message}")
+
+        self._update_health_on_success()
+        return response
+
     def _send_message(self, message: Dict[str, Any], timeout_ms: int) -> Dict[str, Any]:
         """Send a message and receive response with improved retry logic."""
+        message["payload"].setdefault("session_id", self.session_id)
         last_exception = None
         max_attempts = min(
             config.max_retry_attempts + 1, 4
@@ -672,20 +1871,38 @@ class CommunicationManager:
             try:
                 with self._connection_pool.get_connection(timeout_ms) as connection:
                     # Serialize and send message
-                    message_data = MessageProtocolAdapter.serialize_message(message)
-                    NamedPipeProtocol.write_to_pipe(
-                        connection, message_data, timeout_ms
+                    protocol_version, encoding = self._connection_pool.get_wire_format(
+                        connection
                     )
-
-                    # Read response
-                    response_data = NamedPipeProtocol.read_from_pipe(
-                        connection, timeout_ms
+                    message_data = MessageProtocolAdapter.serialize_message(
+                        message, protocol_version, encoding
                     )
+                    if isinstance(connection, PipelinedConnection):
+                        response = connection.request(
+                            message_data, message["payload"]["request_id"], timeout_ms
+                        )
+                    else:
+                        NamedPipeProtocol.write_to_pipe(
+                            connection, message_data, timeout_ms
+                        )
 
-                    # Parse response
-                    response = MessageProtocolAdapter.parse_response(response_data)
+                        # Read response, which may arrive as a stream of chunks
+                        response = self._read_response(connection, timeout_ms)
+                    MessageProtocolAdapter.raise_if_busy(response)
                     return response
 
+            except ServerBusyError as e:
+                # The extension says how long its queue takes to drain; retrying
+                # sooner would only be refused again
+                last_exception = e
+                if attempt < max_attempts - 1:
+                    logger.warning(
+                        f"Extension busy on attempt {attempt + 1}, retrying in {e.retry_after_ms}ms: {e}"
+                    )
+                    time.sleep(e.retry_after_ms / 1000.0)
+                else:
+                    logger.error(f"Extension still busy after {max_attempts} attempts")
+                    raise
             except (TimeoutError, ConnectionError) as e:
                 last_exception = e
                 error_str = str(e)
@@ -736,6 +1953,33 @@ class CommunicationManager:
 
         raise last_exception or CommunicationError("Failed to send message")
 
+    def _read_response(self, connection: Any, timeout_ms: int) -> Dict[str, Any]:
+        """
+        Read a response, reassembling streamed chunk frames.
+
+        The timeout applies to each frame, so long-running commands that keep
+        producing output do not time out while data is still arriving.
+
+        Args:
+            connection: Connected pipe handle
+            timeout_ms: Maximum time to wait for each frame
+
+        Returns:
+            Parsed final response with the output of all chunks prepended
+        """
+        pending = bytearray()
+
+        def next_frame() -> Dict[str, Any]:
+            while True:
+                response = MessageProtocolAdapter.parse_response(
+                    NamedPipeProtocol.read_from_pipe(connection, timeout_ms, pending)
+                )
+                # Pushed events may arrive between any two frames
+                if response.get("type") != "event":
+                    return response
+
+        return assemble_response(next_frame)
+
     def test_connection(self) -> bool:
         """Test if the connection to the WinDbg extension is working."""
         try:
@@ -5,6 +5,7 @@ This module provides the primary tools for executing WinDbg commands,
 managing breakpoints, stepping through code, and analyzing debugging context.
 """
 
+import json
 import logging
 from typing import Dict, Any, List
 
@@ -36,7 +37,11 @@ def get_core_tools(command_executor: CommandExecutor) -> Dict[str, Any]:
             "step_and_analyze": create_step_and_analyze(command_executor),
             "analyze_context": create_analyze_context(command_executor),
             "dx_visualization": create_dx_visualization(command_executor),
+            "dx_query": create_dx_query(command_executor),
             "load_symbols": create_load_symbols(command_executor),
+            "analyze_dumps": create_analyze_dumps(command_executor),
+            "scan_heap": create_scan_heap(command_executor),
+            "disassemble": create_disassemble(command_executor),
         }
     except AttributeError as e:
         logger.error(f"Invalid command executor provided: {e}")
@@ -63,11 +68,18 @@ def create_execute_command(command_executor: CommandExecutor):
         try:
             command = args.get("command", "")
             timeout = args.get("timeout", 30000)
+            output_filter = {
+                key: args[key]
+                for key in ("grep", "head", "tail", "max_bytes", "fields")
+                if args.get(key) is not None
+            }
 
             if not command:
                 return "Error: No command specified"
 
-            result = await command_executor.execute_command(command, timeout_ms=timeout)
+            result = await command_executor.execute_command(
+                command, timeout_ms=timeout, output_filter=output_filter or None
+            )
 
             if result.success:
                 # For successful commands, return raw output for simple commands
@@ -142,70 +154,44 @@ def create_execute_sequence(command_executor: CommandExecutor):
             if not isinstance(commands, list):
                 return "Error: Commands must be a list"
 
+            # One round-trip for the whole sequence; execute_batch falls back
+            # to per-command execution when it has to
+            command_results = await command_executor.execute_batch(
+                commands, stop_on_error=stop_on_error, timeout_ms=timeout_per_command
+            )
+
             results = []
-            for i, command in enumerate(commands):
-                try:
-                    result = await command_executor.execute_command(
-                        command, timeout_ms=timeout_per_command
+            for i, (command, result) in enumerate(zip(commands, command_results)):
+                if result.success:
+                    output = (
+                        result.output.strip()
+                        if result.output
+                        else "Command executed successfully"
                     )
-
-                    if result.success:
-                        output = (
-                            result.output.strip()
-                            if result.output
-                            else "Command executed successfully"
-                        )
-                        if INCLUDE_COMMAND_CONTEXT_IN_SEQUENCES:
-                            results.append(f"[{i+1}] {command}: {output}")
-                        else:
-                            results.append(output)
+                    if INCLUDE_COMMAND_CONTEXT_IN_SEQUENCES:
+                        results.append(f"[{i+1}] {command}: {output}")
                     else:
-                        error_msg = f"Command {i+1} failed: {result.error_message}"
-                        if result.output and result.output.strip():
-                            error_msg += f"\nOutput: {result.output.strip()}"
-
-                        # For communication errors in sequences, provide better guidance
-                        if "Connection lost" in (result.error_message or ""):
-                            # Connection issues are handled in the sequence logic
-                            results.append(error_msg)
-                            break  # Stop on connection issues
-                        elif "Communication error" in (result.error_message or ""):
-                            if (
-                                "pipe is being closed"
-                                in (result.error_message or "").lower()
-                            ):
-                                error_msg += (
-                                    "\n(Connection issue detected - sequence stopped)"
-                                )
-                                results.append(error_msg)
-                                break  # Always stop on pipe errors
-
-                        if stop_on_error:
-                            results.append(error_msg)
-                            break
-                        else:
-                            results.append(error_msg)
+                        results.append(output)
+                    continue
 
-                except ValueError as e:
-                    error_msg = (
-                        f"Command {i+1} failed with invalid parameters: {str(e)}"
-                    )
-                    if stop_on_error:
-                        results.append(error_msg)
-                        break
-                    else:
-                        results.append(error_msg)
-                except Exception as e:
-                    logger.error(
-                        f"Unexpected error in command {i+1} ('{command}'): {e}",
-                        exc_info=True,
-                    )
-                    error_msg = f"Command {i+1} failed with unexpected error: {str(e)}"
-                    if stop_on_error:
-                        results.append(error_msg)
-                        break
-                    else:
+                error_msg = f"Command {i+1} failed: {result.error_message}"
+                if result.output and result.output.strip():
+                    error_msg += f"\nOutput: {result.output.strip()}"
+
+                # For communication errors in sequences, provide better guidance
+                if "Connection lost" in (result.error_message or ""):
+                    # Connection issues are handled in the sequence logic
+                    results.append(error_msg)
+                    break  # Stop on connection issues
+                elif "Communication error" in (result.error_message or ""):
+                    if "pipe is being closed" in (result.error_message or "").lower():
+                        error_msg += "\n(Connection issue detected - sequence stopped)"
                         results.append(error_msg)
+                        break  # Always stop on pipe errors
+
+                results.append(error_msg)
+                if stop_on_error:
+                    break
 
             return "\n".join(results)
         except ValueError as e:
@@ -497,6 +483,41 @@ def create_dx_visualization(command_executor: CommandExecutor):
     return dx_visualization
 
 
+def create_dx_query(command_executor: CommandExecutor):
+    """Create dx_query tool function."""
+
+    async def dx_query(args: Dict[str, Any]) -> str:
+        """Walk a data model expression natively and return it as a JSON tree.
+
+        Collections are paged and nesting stops at the depth budget, so large
+        collections such as @$curprocess.Threads are read on demand instead of
+        being formatted whole as dx text.
+        """
+        try:
+            expression = args.get("expression", "")
+            if not expression:
+                return "Error: No expression specified"
+
+            result = command_executor.comm_manager.query_data_model(
+                expression,
+                offset=args.get("offset", 0),
+                limit=args.get("limit"),
+                depth=args.get("depth"),
+                raw=args.get("raw", False),
+                timeout_ms=args.get("timeout", 30000),
+            )
+
+            header = f"dx Query ({expression})"
+            if result.get("truncated"):
+                header += " [truncated: query a node's expression to see more]"
+            return f"{header}:\n{json.dumps(result.get('result', {}), indent=2)}"
+        except Exception as e:
+            logger.error(f"Unexpected error in dx_query tool: {e}", exc_info=True)
+            return f"Error: Unexpected error - {str(e)}"
+
+    return dx_query
+
+
 def create_load_symbols(command_executor: CommandExecutor):
     """Create load_symbols tool function."""
 
@@ -550,4 +571,145 @@ def create_load_symbols(command_executor: CommandExecutor):
     return load_symbols
 
 
+def create_analyze_dumps(command_executor: CommandExecutor):
+    """Create analyze_dumps tool function."""
+
+    async def analyze_dumps(args: Dict[str, Any]) -> str:
+        """Run the same commands against several crash dumps in parallel.
+
+        Each dump is opened by its own worker debugger next to the extension,
+        so the session being debugged is not disturbed.
+        """
+        try:
+            dumps = args.get("dumps", [])
+            commands = args.get("commands", ["!analyze -v"])
+            if not dumps or not isinstance(dumps, list):
+                return "Error: dumps must be a non-empty list of dump file paths"
+            if not commands or not isinstance(commands, list):
+                return "Error: commands must be a non-empty list"
+
+            analysis = command_executor.comm_manager.analyze_dumps(
+                dumps,
+                commands,
+                max_parallel=args.get("max_parallel"),
+                timeout_per_dump_ms=args.get("timeout_per_dump", 300000),
+                symbol_path=args.get("symbol_path"),
+            )
+
+            sections = []
+            for entry in analysis.get("results", []):
+                status = "ok" if entry.get("success") else f"failed: {entry.get('error_message', 'unknown error')}"
+                header = f"=== {entry.get('dump')} ({status}, {entry.get('execution_time_ms', 0)} ms) ==="
+                output = (entry.get("output") or "").strip()
+                if entry.get("truncated"):
+                    output += "\n... [output truncated]"
+                sections.append(f"{header}\n{output}" if output else header)
+
+            summary = (
+                f"Analyzed {len(sections)} dumps: {analysis.get('successful_dumps', 0)} succeeded, "
+                f"{analysis.get('failed_dumps', 0)} failed"
+            )
+            return "\n\n".join([summary] + sections)
+        except Exception as e:
+            logger.error(f"Unexpected error in analyze_dumps tool: {e}", exc_info=True)
+            return f"Error: Unexpected error - {str(e)}"
+
+    return analyze_dumps
+
+
+def create_scan_heap(command_executor: CommandExecutor):
+    """Create scan_heap tool function."""
+
+    async def scan_heap(args: Dict[str, Any]) -> str:
+        """Count the objects in the target's memory by vtable.
+
+        The extension walks the committed memory natively and in parallel, so
+        this replaces "!heap -stat" and "s -d" loops over the heap.
+        """
+        try:
+            scan = command_executor.comm_manager.scan_heap(
+                region_types=args.get("region_types"),
+                patterns=args.get("patterns"),
+                top=args.get("top"),
+                vtables_only=args.get("vtables_only", True),
+                max_bytes=args.get("max_bytes"),
+                timeout_ms=args.get("timeout", 600000),
+            )
+
+            scanned_mb = scan.get("bytes_scanned", 0) / (1024 * 1024)
+            lines = [
+                f"Scanned {scanned_mb:.1f} MB in {scan.get('regions', 0)} regions "
+                f"({scan.get('elapsed_ms', 0)} ms, {scan.get('threads', 0)} threads)"
+                + (" [truncated at max_bytes]" if scan.get("truncated") else "")
+            ]
+            histogram = scan.get("histogram", [])
+            if histogram:
+                lines.append(f"{'Count':>10} {'Est. bytes':>12}  Pointer")
+                for entry in histogram:
+                    target = entry.get("symbol") or hex(entry.get("value", 0))
+                    lines.append(f"{entry.get('count', 0):>10} {entry.get('bytes', 0):>12}  {target}")
+            else:
+                lines.append("No pointers into loaded images found")
+            for pattern in scan.get("patterns", []):
+                hits = ", ".join(hex(hit) for hit in pattern.get("hits", []))
+                lines.append(f"Pattern {pattern.get('pattern')}: {pattern.get('count', 0)} matches" + (f" at {hits}" if hits else ""))
+            return "\n".join(lines)
+        except Exception as e:
+            logger.error(f"Unexpected error in scan_heap tool: {e}", exc_info=True)
+            return f"Error: Unexpected error - {str(e)}"
+
+    return scan_heap
+
+
+def create_disassemble(command_executor: CommandExecutor):
+    """Create disassemble tool function."""
+
+    async def disassemble(args: Dict[str, Any]) -> str:
+        """Disassemble several addresses or the frames of the current stack.
+
+        The extension decodes all ranges in one call and caches them per
+        module, so this replaces a "u" or "ub" round-trip per frame.
+        """
+        try:
+            ranges = []
+            for address in args.get("addresses", []):
+                ranges.append({"address": address})
+            ranges.extend(args.get("ranges", []))
+            if not ranges and not args.get("stack_frames"):
+                return "Error: Give addresses, ranges or stack_frames to disassemble"
+
+            result = command_executor.comm_manager.disassemble(
+                ranges=ranges,
+                stack_frames=args.get("stack_frames"),
+                count=args.get("count"),
+                before=args.get("before"),
+                timeout_ms=args.get("timeout", 30000),
+            )
+
+            lines = []
+            for entry in result.get("ranges", []):
+                if "frame" in entry:
+                    lines.append(f"Frame {entry['frame']:02d} at {hex(entry.get('address', 0))}:")
+                else:
+                    lines.append(f"{hex(entry.get('address', 0))}:")
+                if entry.get("error"):
+                    lines.append(f"  Error: {entry['error']}")
+                for instruction in entry.get("instructions", []):
+                    if instruction.get("symbol"):
+                        lines.append(f"{instruction['symbol']}+{hex(instruction.get('displacement', 0))}:")
+                    if instruction.get("file"):
+                        lines.append(f"  [{instruction['file']}]")
+                    source = f"  ; line {instruction['line']}" if instruction.get("line") else ""
+                    lines.append(f"{instruction.get('text', '')}{source}")
+                lines.append("")
+            lines.append(
+                f"{result.get('instructions', 0)} instructions, "
+                f"{result.get('cached_instructions', 0)} from cache ({result.get('elapsed_ms', 0)} ms)"
+                + (" [truncated]" if result.get("truncated") else "")
+            )
+            return "\n".join(lines)
+        except Exception as e:
+            logger.error(f"Unexpected error in disassemble tool: {e}", exc_info=True)
+            return f"Error: Unexpected error - {str(e)}"
 
+    return disassemble
@@ -30,6 +30,28 @@ CORE_TOOL_METADATA = {
                     "description": "Timeout in milliseconds (default: 30000)",
                     "default": 30000,
                 },
+                "grep": {
+                    "type": "array",
+                    "items": {"type": "string"},
+                    "description": "Keep only output lines containing any of these strings (case-sensitive)",
+                },
+                "head": {
+                    "type": "integer",
+                    "description": "Keep only the first N lines (after grep)",
+                },
+                "tail": {
+                    "type": "integer",
+                    "description": "Keep only the last N lines (after grep and head)",
+                },
+                "max_bytes": {
+                    "type": "integer",
+                    "description": "Cut the filtered output at this many bytes",
+                },
+                "fields": {
+                    "type": "array",
+                    "items": {"type": "integer"},
+                    "description": "Keep only these zero-based whitespace-separated columns of each line",
+                },
             },
             "required": ["command"],
         },
@@ -45,6 +67,17 @@ CORE_TOOL_METADATA = {
                 "command": "u @rip L5",
                 "description": "Disassemble 5 instructions from current RIP",
             },
+            {
+                "command": "lm",
+                "grep": ["ntdll", "kernel32"],
+                "fields": [0, 2],
+                "description": "Start address and name of the ntdll and kernel32 modules only",
+            },
+            {
+                "command": "k",
+                "head": 5,
+                "description": "Top five stack frames",
+            },
         ],
     },
     "execute_sequence": {
@@ -257,6 +290,60 @@ CORE_TOOL_METADATA = {
             },
         ],
     },
+    "dx_query": {
+        "description": "Evaluate a debugger data model expression natively and return the result as a typed JSON tree instead of dx text. Each node gives its kind, type, location, value or display string, properties and collection elements. Collections are paged with offset and limit, and nesting stops at the depth budget. Every node carries the expression that reaches it, so query that expression to expand it or to fetch the next page of its elements.",
+        "input_schema": {
+            "type": "object",
+            "properties": {
+                "expression": {
+                    "type": "string",
+                    "description": "Expression as dx accepts it, e.g. @$curprocess.Threads",
+                },
+                "offset": {
+                    "type": "integer",
+                    "description": "Elements of the result's collection to skip (default: 0)",
+                    "default": 0,
+                },
+                "limit": {
+                    "type": "integer",
+                    "description": "Elements returned per collection (default: 100, at most 1000)",
+                },
+                "depth": {
+                    "type": "integer",
+                    "description": "Levels expanded below the result (default: 1, at most 8)",
+                },
+                "raw": {
+                    "type": "boolean",
+                    "description": "List native fields even where a NatVis visualizer supplies the view",
+                    "default": False,
+                },
+                "timeout": {
+                    "type": "integer",
+                    "description": "Timeout in milliseconds (default: 30000)",
+                    "default": 30000,
+                },
+            },
+            "required": ["expression"],
+        },
+        "examples": [
+            {
+                "expression": "@$curprocess.Threads",
+                "limit": 20,
+                "description": "List the first 20 threads of the current process",
+            },
+            {
+                "expression": "@$curprocess.Threads",
+                "offset": 20,
+                "limit": 20,
+                "description": "Fetch the next page of threads",
+            },
+            {
+                "expression": "@$curthread.Stack.Frames",
+                "depth": 2,
+                "description": "Walk the current thread's frames two levels deep",
+            },
+        ],
+    },
     "load_symbols": {
         "description": "Load symbols for debugging operations. This tool loads user-mode symbols for comprehensive debugging capabilities.",
         "input_schema": {
@@ -281,6 +368,156 @@ CORE_TOOL_METADATA = {
             {"description": "Load all symbols with default timeout"},
         ],
     },
+    "scan_heap": {
+        "description": "Count the objects in the target's memory by the vtable they point to, without running !heap or s -d. The extension reads the committed memory in large blocks, matches it on a thread pool, and returns a histogram of vtable, count and estimated bytes, most frequent first. Byte signatures can be counted in the same pass.",
+        "input_schema": {
+            "type": "object",
+            "properties": {
+                "region_types": {
+                    "type": "array",
+                    "items": {"type": "string", "enum": ["private", "mapped", "image"]},
+                    "description": "Committed regions to scan (default: [\"private\"], where heaps live)",
+                },
+                "patterns": {
+                    "type": "array",
+                    "items": {"type": "string"},
+                    "description": "Hex byte signatures to count, e.g. \"deadbeef\" (at most 16, 64 bytes each)",
+                },
+                "top": {
+                    "type": "integer",
+                    "description": "Histogram entries to return (default: 50, at most 1000)",
+                },
+                "vtables_only": {
+                    "type": "boolean",
+                    "description": "Only count pointers that resolve to a vftable symbol (default: true)",
+                    "default": True,
+                },
+                "max_bytes": {
+                    "type": "integer",
+                    "description": "Committed memory to scan at most (default: 4 GB)",
+                },
+                "timeout": {
+                    "type": "integer",
+                    "description": "Timeout in milliseconds (default: 600000)",
+                    "default": 600000,
+                },
+            },
+        },
+        "examples": [
+            {"description": "Find which C++ classes have the most live objects"},
+            {
+                "patterns": ["deadbeef"],
+                "description": "Count the objects by vtable and find a signature in the heap",
+            },
+            {
+                "vtables_only": False,
+                "top": 20,
+                "description": "Show the 20 most frequent pointers into loaded images",
+            },
+        ],
+    },
+    "disassemble": {
+        "description": "Disassemble several addresses, or the frames of the current stack, in one call instead of one u or ub per address. Each instruction comes with its symbol and source line, and ranges decoded before are answered from the extension's per-module cache.",
+        "input_schema": {
+            "type": "object",
+            "properties": {
+                "addresses": {
+                    "type": "array",
+                    "items": {"type": ["string", "integer"]},
+                    "description": "Addresses to disassemble from, as numbers or hex strings such as \"0x7ff612341000\"",
+                },
+                "ranges": {
+                    "type": "array",
+                    "items": {
+                        "type": "object",
+                        "properties": {
+                            "address": {"type": ["string", "integer"]},
+                            "count": {"type": "integer"},
+                            "before": {"type": "integer"},
+                            "end": {"type": ["string", "integer"]},
+                        },
+                        "required": ["address"],
+                    },
+                    "description": "Ranges with their own instruction count, instructions before the address, or end address (at most 64 KB past the address)",
+                },
+                "stack_frames": {
+                    "type": "integer",
+                    "description": "Disassemble around each of the first N frames of the current thread's stack",
+                },
+                "count": {
+                    "type": "integer",
+                    "description": "Instructions per range (default: 16, or 8 per stack frame; at most 1024)",
+                },
+                "before": {
+                    "type": "integer",
+                    "description": "Instructions before each address, as ub shows them (default: 0, or 8 per stack frame; at most 64)",
+                },
+                "timeout": {
+                    "type": "integer",
+                    "description": "Timeout in milliseconds (default: 30000)",
+                    "default": 30000,
+                },
+            },
+        },
+        "examples": [
+            {
+                "stack_frames": 10,
+                "description": "Show the code around the call site of every frame on the stack",
+            },
+            {
+                "addresses": ["0x7ff612341000", "0x7ff612345200"],
+                "count": 32,
+                "description": "Disassemble two functions from their start",
+            },
+            {
+                "ranges": [{"address": "0x7ff612341000", "end": "0x7ff612341080"}],
+                "description": "Disassemble a byte range",
+            },
+        ],
+    },
+    "analyze_dumps": {
+        "description": "Analyze several crash dump files in parallel. Each dump is opened by its own worker debugger on the machine running the extension, the same commands run against every dump, and the output comes back tagged by dump. The session being debugged is not affected.",
+        "input_schema": {
+            "type": "object",
+            "properties": {
+                "dumps": {
+                    "type": "array",
+                    "items": {"type": "string"},
+                    "description": "Dump file paths on the machine running WinDbg (at most 64)",
+                },
+                "commands": {
+                    "type": "array",
+                    "items": {"type": "string"},
+                    "description": "Commands to run against every dump (default: [\"!analyze -v\"])",
+                },
+                "max_parallel": {
+                    "type": "integer",
+                    "description": "Dumps analyzed at once (default: one per core, at most 8)",
+                },
+                "timeout_per_dump": {
+                    "type": "integer",
+                    "description": "Timeout per dump in milliseconds (default: 300000)",
+                    "default": 300000,
+                },
+                "symbol_path": {
+                    "type": "string",
+                    "description": "Symbol path for the worker debuggers (default: _NT_SYMBOL_PATH)",
+                },
+            },
+            "required": ["dumps"],
+        },
+        "examples": [
+            {
+                "dumps": ["C:\\crashes\\app1.dmp", "C:\\crashes\\app2.dmp"],
+                "description": "Run !analyze -v on two dumps side by side",
+            },
+            {
+                "dumps": ["C:\\crashes\\app1.dmp"],
+                "commands": ["!analyze -v", "~*k"],
+                "description": "Triage a dump and collect every thread's stack",
+            },
+        ],
+    },
 }
 
 # ====================================================================
@@ -73,6 +73,40 @@ class TestCommandValidator:
         assert validator.validate_command_syntax("   ") is False
 
 
+class TestCommandRouter:
+    """Test CommandRouter functionality."""
+
+    @pytest.fixture
+    def router(self):
+        return CommandRouter()
+
+    def test_route_specific_commands(self, router):
+        """Test routing of commands with a specific handler."""
+        assert router.route_command("k").handler_name == "analyze_stack"
+        assert router.route_command("  lm  ").handler_name == "list_modules"
+        assert router.route_command(".detach").handler_name == "detach_process"
+
+        route = router.route_command("~3s")
+        assert route.handler_name == "switch_thread"
+        assert route.is_generic is False
+
+    def test_route_extracts_parameters(self, router):
+        """Test that match groups fill the route parameters in order."""
+        route = router.route_command("db 0x1000 L20")
+        assert route.handler_name == "read_memory"
+        assert route.parameters == {"address": "0x1000", "size": "20"}
+
+        route = router.route_command("bp kernel32!CreateFileW")
+        assert route.parameters == {"location": "kernel32!CreateFileW"}
+
+    def test_route_unknown_command(self, router):
+        """Test fallback to generic execution."""
+        for command in ["vertarget", "", "kb 10"]:
+            route = router.route_command(command)
+            assert route.handler_name == "execute_generic"
+            assert route.is_generic is True
+
+
 class TestCommandCache:
     """Test CommandCache functionality."""
 
@@ -160,3 +194,44 @@ class TestCommandExecutor:
                 assert result.success is True
 
             assert mock_execute.call_count == 3
+
+    @pytest.mark.asyncio
+    async def test_execute_batch_single_round_trip(self, executor):
+        """Test a batch is sent as one request and mapped to results."""
+        executor.comm_manager.execute_batch = Mock(
+            return_value={
+                "results": [
+                    {"command": "lm", "success": True, "output": "modules", "execution_time_ms": 4},
+                    {
+                        "command": "!peb",
+                        "success": False,
+                        "output": "",
+                        "error_message": "Command execution failed",
+                        "execution_time_ms": 2,
+                    },
+                ],
+                "skipped_commands": 1,
+            }
+        )
+
+        results = await executor.execute_batch(["lm", "!peb", "r"], stop_on_error=True)
+
+        executor.comm_manager.execute_batch.assert_called_once_with(
+            ["lm", "!peb", "r"], stop_on_error=True, timeout_per_command_ms=30000
+        )
+        assert [r.success for r in results] == [True, False]
+        assert results[0].output == "modules"
+        assert results[0].execution_time_ms == 4
+        assert results[1].error_message == "Command execution failed"
+
+    @pytest.mark.asyncio
+    async def test_execute_batch_falls_back_without_batch_support(self, executor):
+        """Test older extensions get one request per command."""
+        executor.comm_manager.execute_batch = Mock(return_value={})
+        with patch.object(executor, "execute_command") as mock_execute:
+            mock_execute.return_value = CommandResult(success=True, output="ok")
+
+            results = await executor.execute_batch(["k", "r"])
+
+            assert len(results) == 2
+            assert mock_execute.call_count == 2
@@ -0,0 +1,881 @@
+"""Tests for the communication layer's message protocol handling."""
+
+import json
+import threading
+import pytest
+from concurrent.futures import ThreadPoolExecutor
+from unittest.mock import patch
+from src.core.communication import (
+    CommunicationError,
+    CommunicationManager,
+    ConnectionPool,
+    EventSubscription,
+    MessageProtocolAdapter,
+    NamedPipeProtocol,
+    PipelinedConnection,
+    FRAME_HEADER,
+    FRAME_MAGIC,
+    FRAME_FLAG_PARTIAL,
+    FRAME_FLAG_RAW_BODY,
+    ENVELOPE_SIZE,
+    MESSAGE_DELIMITER,
+    MESSAGE_TYPE_EVENT,
+    MESSAGE_TYPE_HEARTBEAT,
+    MESSAGE_TYPE_RESPONSE,
+    MESSAGE_TYPE_SUBSCRIBE,
+    PROTOCOL_VERSION_V1,
+    PROTOCOL_VERSION_V2,
+    ENCODING_JSON,
+    ENCODING_MSGPACK,
+    ERROR_CODE_BUSY,
+    MESSAGE_TYPE_ERROR,
+    ServerBusyError,
+)
+
+
+def build_v2_response(
+    envelope: dict, output: bytes, flags: int = FRAME_FLAG_RAW_BODY
+) -> bytes:
+    """Build a v2 response frame the way the extension does."""
+    envelope_bytes = json.dumps(envelope).encode("utf-8")
+    body = ENVELOPE_SIZE.pack(len(envelope_bytes)) + envelope_bytes + output
+    header = FRAME_HEADER.pack(
+        FRAME_MAGIC,
+        PROTOCOL_VERSION_V2,
+        MESSAGE_TYPE_RESPONSE,
+        flags,
+        len(body),
+    )
+    return header + body
+
+
+def build_chunk(sequence: int, output: bytes) -> bytes:
+    """Build a streamed response chunk frame."""
+    envelope = {
+        "type": "response",
+        "request_id": "7",
+        "success": True,
+        "sequence": sequence,
+        "final": False,
+    }
+    return build_v2_response(
+        envelope, output, FRAME_FLAG_RAW_BODY | FRAME_FLAG_PARTIAL
+    )
+
+
+class TestMessageFraming:
+    """Test v1 and v2 framing."""
+
+    def test_v1_serialization_uses_delimiter(self):
+        """Test v1 messages are JSON text terminated by the delimiter."""
+        message = MessageProtocolAdapter.create_command_message("k", 1000)
+        data = MessageProtocolAdapter.serialize_message(message, PROTOCOL_VERSION_V1)
+
+        assert data.endswith(MESSAGE_DELIMITER)
+        assert json.loads(data[: -len(MESSAGE_DELIMITER)])["payload"]["command"] == "k"
+
+    def test_v2_serialization_round_trip(self):
+        """Test v2 messages carry a binary header and the payload as body."""
+        message = MessageProtocolAdapter.create_command_message("lm", 1000)
+        data = MessageProtocolAdapter.serialize_message(message, PROTOCOL_VERSION_V2)
+
+        assert data.startswith(FRAME_MAGIC)
+        assert MessageProtocolAdapter.complete_frame_size(data) == len(data)
+
+        message_type, payload, raw_body = MessageProtocolAdapter.decode_frame(data)
+        assert message_type == 1
+        assert payload["command"] == "lm"
+        assert raw_body is None
+
+    def test_complete_frame_size_waits_for_full_frame(self):
+        """Test partial frames are not reported as complete."""
+        message = MessageProtocolAdapter.create_command_message("r", 1000)
+        v2_data = MessageProtocolAdapter.serialize_message(message, PROTOCOL_VERSION_V2)
+        v1_data = MessageProtocolAdapter.serialize_message(message, PROTOCOL_VERSION_V1)
+
+        assert MessageProtocolAdapter.complete_frame_size(v2_data[:5]) is None
+        assert MessageProtocolAdapter.complete_frame_size(v2_data[:-1]) is None
+        assert MessageProtocolAdapter.complete_frame_size(v1_data[:-2]) is None
+        assert MessageProtocolAdapter.complete_frame_size(v1_data + v1_data) == len(
+            v1_data
+        )
+
+    def test_parse_v2_response_with_raw_output(self):
+        """Test raw output bytes are restored without JSON unescaping."""
+        output = b'line "one"\r\n\tline \\two\\\r\n'
+        frame = build_v2_response(
+            {"type": "response", "request_id": "42", "success": True}, output
+        )
+
+        response = MessageProtocolAdapter.parse_response(frame)
+
+        assert response["status"] == "success"
+        assert response["request_id"] == "42"
+        assert response["output"] == output.decode("utf-8")
+
+
+class TestProtocolNegotiation:
+    """Test protocol version negotiation."""
+
+    def test_negotiates_highest_common_version(self):
+        """Test the highest version supported by both sides is chosen."""
+        server_info = {"protocol_versions": [1, 2]}
+        assert (
+            MessageProtocolAdapter.negotiate_protocol_version(server_info, 2)
+            == PROTOCOL_VERSION_V2
+        )
+
+    def test_respects_preferred_version(self):
+        """Test a client configured for v1 stays on v1."""
+        server_info = {"protocol_versions": [1, 2]}
+        assert (
+            MessageProtocolAdapter.negotiate_protocol_version(server_info, 1)
+            == PROTOCOL_VERSION_V1
+        )
+
+    def test_legacy_extension_falls_back_to_v1(self):
+        """Test extensions without negotiation support stay on v1."""
+        assert (
+            MessageProtocolAdapter.negotiate_protocol_version(None, 2)
+            == PROTOCOL_VERSION_V1
+        )
+
+
+class TestPayloadEncoding:
+    """Test protocol v2 envelope encodings."""
+
+    def test_json_is_always_available(self):
+        """Test JSON is offered even without optional encoders."""
+        assert ENCODING_JSON in MessageProtocolAdapter.available_encodings()
+
+    def test_msgpack_round_trip(self):
+        """Test MessagePack envelopes survive serialization and decoding."""
+        pytest.importorskip("msgpack")
+        message = MessageProtocolAdapter.create_handler_message(
+            "read_memory", address="0x1000", size=16
+        )
+        data = MessageProtocolAdapter.serialize_message(
+            message, PROTOCOL_VERSION_V2, ENCODING_MSGPACK
+        )
+
+        _, payload, _ = MessageProtocolAdapter.decode_frame(data)
+        assert payload["command"] == "read_memory"
+        assert payload["parameters"] == {"address": "0x1000", "size": 16}
+
+    def test_encoding_requires_server_support(self):
+        """Test the client falls back to JSON if the extension lacks an encoding."""
+        server_info = {"protocol_versions": [1, 2], "encodings": ["json"]}
+        assert (
+            MessageProtocolAdapter.negotiate_encoding(server_info, ENCODING_MSGPACK)
+            == ENCODING_JSON
+        )
+
+
+class TestStreamedResponses:
+    """Test reassembly of chunked streaming responses."""
+
+    def test_stream_flag_is_opt_in(self):
+        """Test command messages only request streaming when asked to."""
+        plain = MessageProtocolAdapter.create_command_message("lm v", 1000)
+        streamed = MessageProtocolAdapter.create_command_message(
+            "lm v", 1000, stream=True
+        )
+
+        assert "stream" not in plain["payload"]
+        assert streamed["payload"]["stream"] is True
+
+    def test_chunks_are_reassembled_in_order(self):
+        """Test chunk output is prepended to the final frame's output."""
+        final = build_v2_response(
+            {
+                "type": "response",
+                "request_id": "7",
+                "success": True,
+                "sequence": 2,
+                "final": True,
+                "execution_time_ms": 1500,
+            },
+            b"tail\n",
+        )
+        frames = [build_chunk(0, b"first\n"), build_chunk(1, b"second\n"), final]
+
+        manager = CommunicationManager()
+        with patch.object(NamedPipeProtocol, "read_from_pipe", side_effect=frames):
+            response = manager._read_response(None, 1000)
+
+        assert response["output"] == "first\nsecond\ntail\n"
+        assert response["execution_time_ms"] == 1500
+
+    def test_out_of_order_chunk_is_rejected(self):
+        """Test a gap in the chunk sequence is reported instead of hidden."""
+        frames = [build_chunk(0, b"a\n"), build_chunk(2, b"c\n")]
+
+        manager = CommunicationManager()
+        with patch.object(NamedPipeProtocol, "read_from_pipe", side_effect=frames):
+            with pytest.raises(CommunicationError):
+                manager._read_response(None, 1000)
+
+    def test_read_keeps_bytes_past_the_frame(self):
+        """Test a read returning two frames yields both, one per call."""
+        first = build_chunk(0, b"a\n")
+        second = build_chunk(1, b"b\n")
+        pending = bytearray()
+
+        with patch(
+            "src.core.communication.win32file.ReadFile",
+            create=True,
+            return_value=(0, first + second),
+        ):
+            assert NamedPipeProtocol.read_from_pipe(None, 1000, pending) == first
+            assert NamedPipeProtocol.read_from_pipe(None, 1000, pending) == second
+        assert not pending
+
+
+class TestStructuredMemory:
+    """Test structured memory requests."""
+
+    RANGES_DATA = {
+        "ranges": [
+            {
+                "address": 0x1000,
+                "size": 4,
+                "offset": 0,
+                "bytes_read": 4,
+                "status": "ok",
+            },
+            {
+                "address": 0x2000,
+                "size": 4,
+                "offset": 4,
+                "bytes_read": 2,
+                "status": "partial",
+                "error": "HRESULT: 0x80004005",
+            },
+        ]
+    }
+
+    def read_with_frame(self, frame: bytes):
+        manager = CommunicationManager()
+        response = MessageProtocolAdapter.parse_response(frame)
+        with patch.object(
+            CommunicationManager, "_send_message", return_value=response
+        ) as send:
+            results = manager.read_memory([(0x1000, 4), (0x2000, 4)], 1000)
+        return results, send.call_args[0][0]
+
+    def test_raw_bytes_are_split_per_range(self):
+        """Test v2 raw output keeps non-UTF-8 bytes intact."""
+        data = dict(self.RANGES_DATA, encoding="raw")
+        frame = build_v2_response(
+            {"type": "response", "request_id": "1", "success": True, "data": data},
+            b"\xde\xad\xbe\xef\xff\xfe\x00\x00",
+        )
+
+        results, message = self.read_with_frame(frame)
+
+        assert message["payload"]["command"] == "read_memory"
+        assert message["payload"]["parameters"]["ranges"][1] == {
+            "address": 0x2000,
+            "size": 4,
+        }
+        assert results[0]["data"] == b"\xde\xad\xbe\xef"
+        assert results[1]["data"] == b"\xff\xfe"
+        assert results[1]["status"] == "partial"
+
+    def test_base64_output_is_decoded(self):
+        """Test v1 responses carry the bytes as base64 text."""
+        data = dict(self.RANGES_DATA, encoding="base64")
+        payload = {
+            "type": "response",
+            "request_id": "1",
+            "success": True,
+            "output": "3q2+7//+AAA=",
+            "data": data,
+        }
+        frame = (
+            json.dumps(
+                {"protocol_version": 1, "message_type": 2, "payload": payload}
+            ).encode("utf-8")
+            + MESSAGE_DELIMITER
+        )
+
+        results, _ = self.read_with_frame(frame)
+
+        assert results[0]["data"] == b"\xde\xad\xbe\xef"
+        assert results[1]["data"] == b"\xff\xfe"
+
+    def test_search_returns_hit_addresses(self):
+        """Test search patterns are sent as hex and hits returned as ints."""
+        response = {"status": "success", "output": "", "data": {"hits": [16, 48]}}
+        manager = CommunicationManager()
+        with patch.object(
+            CommunicationManager, "_send_message", return_value=response
+        ) as send:
+            hits = manager.search_memory(0, 64, b"AB", max_hits=2)
+
+        assert hits == [16, 48]
+        assert send.call_args[0][0]["payload"]["parameters"]["pattern"] == "4142"
+
+    def test_batch_sends_all_commands_at_once(self):
+        """Test a batch request carries every command and returns its data."""
+        data = {
+            "results": [
+                {"command": "lm", "success": True, "output": "mod", "execution_time_ms": 3},
+                {"command": "r", "success": True, "output": "rax=0", "execution_time_ms": 1},
+            ],
+            "successful_commands": 2,
+            "failed_commands": 0,
+            "skipped_commands": 0,
+        }
+        response = {"status": "success", "output": "", "data": data}
+        manager = CommunicationManager()
+        with patch.object(
+            CommunicationManager, "_send_message", return_value=response
+        ) as send:
+            batch = manager.execute_batch(
+                ["lm", "r"], stop_on_error=True, timeout_per_command_ms=1000
+            )
+
+        assert send.call_count == 1
+        message, timeout_ms = send.call_args[0]
+        assert message["payload"]["command"] == "execute_batch"
+        assert message["payload"]["parameters"] == {
+            "commands": ["lm", "r"],
+            "stop_on_error": True,
+            "timeout_per_command_ms": 1000,
+        }
+        assert timeout_ms == 2000
+        assert batch["results"][1]["output"] == "rax=0"
+
+
+    def test_dump_analysis_sends_dumps_and_commands(self):
+        """Test a dump analysis carries its dumps and scales its timeout."""
+        data = {
+            "results": [
+                {"dump": "a.dmp", "success": True, "output": "FAILURE_BUCKET_ID", "exit_code": 0},
+                {"dump": "b.dmp", "success": False, "error_message": "Dump file not found"},
+            ],
+            "successful_dumps": 1,
+            "failed_dumps": 1,
+        }
+        response = {"status": "success", "output": "", "data": data}
+        manager = CommunicationManager()
+        with patch.object(
+            CommunicationManager, "_send_message", return_value=response
+        ) as send:
+            analysis = manager.analyze_dumps(
+                ["a.dmp", "b.dmp", "c.dmp"],
+                ["!analyze -v"],
+                max_parallel=2,
+                timeout_per_dump_ms=1000,
+            )
+
+        message, timeout_ms = send.call_args[0]
+        assert message["payload"]["command"] == "analyze_dumps"
+        assert message["payload"]["parameters"] == {
+            "dumps": ["a.dmp", "b.dmp", "c.dmp"],
+            "commands": ["!analyze -v"],
+            "timeout_per_dump_ms": 1000,
+            "max_parallel": 2,
+        }
+        assert timeout_ms == 2000
+        assert analysis["results"][1]["error_message"] == "Dump file not found"
+
+    def test_scan_heap_sends_only_given_options(self):
+        """Test scan_heap forwards what was set and returns the histograms."""
+        data = {
+            "histogram": [
+                {"value": 0x7FF612340000, "symbol": "app!Widget::`vftable'", "count": 812, "bytes": 51968}
+            ],
+            "patterns": [{"pattern": "deadbeef", "count": 3, "hits": [4096, 8192, 12288]}],
+            "bytes_scanned": 1 << 26,
+            "truncated": False,
+        }
+        response = {"status": "success", "output": "", "data": data}
+        manager = CommunicationManager()
+        with patch.object(
+            CommunicationManager, "_send_message", return_value=response
+        ) as send:
+            scan = manager.scan_heap(patterns=["deadbeef"], top=10, vtables_only=False)
+
+        message, timeout_ms = send.call_args[0]
+        assert message["payload"]["command"] == "scan_heap"
+        assert message["payload"]["parameters"] == {
+            "patterns": ["deadbeef"],
+            "top": 10,
+            "vtables_only": False,
+        }
+        assert timeout_ms == 600000
+        assert scan["histogram"][0]["count"] == 812
+
+    def test_disassemble_sends_ranges_and_stack_frames(self):
+        """Test disassemble forwards ranges and frame count and returns the decoded ranges."""
+        data = {
+            "ranges": [
+                {
+                    "address": 0x7FF612341000,
+                    "start": 0x7FF612341000,
+                    "cached": 1,
+                    "instructions": [
+                        {"address": 0x7FF612341000, "size": 4, "text": "sub rsp,28h", "symbol": "app!main"}
+                    ],
+                }
+            ],
+            "instructions": 1,
+            "cached_instructions": 1,
+            "truncated": False,
+        }
+        response = {"status": "success", "output": "", "data": data}
+        manager = CommunicationManager()
+        with patch.object(
+            CommunicationManager, "_send_message", return_value=response
+        ) as send:
+            result = manager.disassemble(
+                ranges=[{"address": "0x7ff612341000", "count": 4}], stack_frames=5
+            )
+
+        message, _ = send.call_args[0]
+        assert message["payload"]["command"] == "disassemble"
+        assert message["payload"]["parameters"] == {
+            "ranges": [{"address": "0x7ff612341000", "count": 4}],
+            "stack_frames": 5,
+        }
+        assert result["cached_instructions"] == 1
+        assert result["ranges"][0]["instructions"][0]["symbol"] == "app!main"
+
+class TestStructuredState:
+    """Test structured state requests answered from session_data."""
+
+    def query(self, session_data, method, *args, **kwargs):
+        response = {"status": "success", "output": "", "session_data": session_data}
+        manager = CommunicationManager()
+        with patch.object(
+            CommunicationManager, "_send_message", return_value=response
+        ) as send:
+            result = getattr(manager, method)(*args, **kwargs)
+        return result, send.call_args[0][0]["payload"]
+
+    def test_modules_come_from_session_data(self):
+        """Test the module list is returned without parsing any text."""
+        modules = [{"name": "ntdll", "base": 0x7FF800000000, "size": 0x1F8000}]
+        result, payload = self.query({"modules": modules}, "get_modules")
+
+        assert payload["command"] == "get_modules"
+        assert result == modules
+
+    def test_stack_trace_forwards_max_frames(self):
+        """Test max_frames is only sent when given."""
+        frames = [{"frame_number": 0, "symbol": "ntdll!NtWaitForSingleObject"}]
+        result, payload = self.query({"frames": frames}, "get_stack_trace", 16)
+        assert payload["parameters"] == {"max_frames": 16}
+        assert result == frames
+
+        _, payload = self.query({"frames": []}, "get_stack_trace")
+        assert payload["parameters"] == {}
+
+    def test_thread_stacks_return_buckets(self):
+        """Test folded stacks are returned as the extension sent them."""
+        stacks = {
+            "thread_count": 3,
+            "unique_stacks": 1,
+            "buckets": [{"count": 3, "threads": [4, 8, 12], "frames": []}],
+        }
+        result, payload = self.query(stacks, "get_thread_stacks")
+
+        assert payload["command"] == "get_thread_stacks"
+        assert result["buckets"][0]["threads"] == [4, 8, 12]
+
+    def test_session_state_comes_from_session_data(self):
+        """Test the session snapshot is returned as the extension sent it."""
+        state = {
+            "connected": True,
+            "target_running": False,
+            "thread_count": 4,
+            "module_count": 27,
+            "generation": 12,
+            "current_process": {"process_id": 1234, "process_name": "notepad.exe"},
+        }
+        result, payload = self.query(state, "get_session_state")
+
+        assert payload["command"] == "get_session_state"
+        assert result == state
+
+    def test_dx_query_sends_only_given_paging(self):
+        """Test dx_query forwards the expression and only the paging asked for."""
+        tree = {
+            "expression": "@$curprocess.Threads",
+            "truncated": False,
+            "result": {
+                "kind": "synthetic",
+                "offset": 20,
+                "elements": [{"kind": "synthetic", "index": 4660,
+                              "expression": "@$curprocess.Threads[4660]"}],
+                "has_more": True,
+                "next_offset": 21,
+            },
+        }
+        result, payload = self.query(
+            tree, "query_data_model", "@$curprocess.Threads", offset=20, limit=1
+        )
+        assert payload["command"] == "dx_query"
+        assert payload["parameters"] == {
+            "expression": "@$curprocess.Threads",
+            "offset": 20,
+            "limit": 1,
+        }
+        assert result["result"]["next_offset"] == 21
+
+        _, payload = self.query({}, "query_data_model", "@$curthread", depth=0, raw=True)
+        assert payload["parameters"] == {"expression": "@$curthread", "depth": 0, "raw": True}
+
+    def test_missing_session_data_yields_empty_result(self):
+        """Test an older extension without session_data gives empty results."""
+        threads, _ = self.query(None, "get_threads")
+        registers, _ = self.query(None, "get_registers")
+
+        assert threads == []
+        assert registers == {}
+
+    def test_parsed_response_keeps_session_data(self):
+        """Test the response parser passes session_data through."""
+        frame = build_v2_response(
+            {
+                "type": "response",
+                "request_id": "1",
+                "success": True,
+                "session_data": {"registers": {"rip": 4096}},
+            },
+            b"",
+        )
+        response = MessageProtocolAdapter.parse_response(frame)
+        assert response["session_data"] == {"registers": {"rip": 4096}}
+
+
+class TestSessions:
+    """Test requests carry the session their engine context is kept under."""
+
+    def send(self, manager, message):
+        with patch.object(manager, "_connection_pool") as pool, patch.object(
+            NamedPipeProtocol, "write_to_pipe"
+        ), patch.object(CommunicationManager, "_read_response", return_value={}):
+            pool.get_wire_format.return_value = (PROTOCOL_VERSION_V1, ENCODING_JSON)
+            manager._send_message(message, 1000)
+        return message["payload"]
+
+    def test_every_request_carries_the_session_id(self):
+        """Test commands and structured requests are sent with the session id."""
+        manager = CommunicationManager(session_id="agent-1")
+        command = MessageProtocolAdapter.create_command_message("~3s", 1000)
+        handler = MessageProtocolAdapter.create_handler_message("get_threads")
+
+        assert self.send(manager, command)["session_id"] == "agent-1"
+        assert self.send(manager, handler)["session_id"] == "agent-1"
+
+    def test_managers_get_distinct_sessions(self):
+        """Test two servers sharing a debugger do not share a context by default."""
+        assert CommunicationManager().session_id != CommunicationManager().session_id
+
+
+class TestMetrics:
+    """Test the metrics request."""
+
+    def test_metrics_are_returned_from_data(self):
+        """Test stage and command latencies come back as the extension sent them."""
+        data = {
+            "uptime_ms": 5000,
+            "counters": {"commands_executed": 3},
+            "stages": {"engine_time": {"count": 3, "p50_us": 1200, "p99_us": 9000}},
+            "commands": [{"command": "!analyze", "count": 1, "p50_us": 9000, "failures": 0}],
+        }
+        response = {"status": "success", "output": "", "data": data}
+        manager = CommunicationManager()
+        with patch.object(
+            CommunicationManager, "_send_message", return_value=response
+        ) as send:
+            metrics = manager.get_metrics(1000)
+
+        message, timeout_ms = send.call_args[0]
+        assert message["payload"]["command"] == "metrics"
+        assert timeout_ms == 1000
+        assert metrics["stages"]["engine_time"]["p99_us"] == 9000
+        assert metrics["commands"][0]["command"] == "!analyze"
+
+
+class TestOutputFilter:
+    """Test output filters are sent as request parameters."""
+
+    def test_filter_is_sent_in_parameters(self):
+        """Test grep, head and fields reach the extension with the command."""
+        output_filter = {"grep": ["ntdll"], "head": 5, "fields": [0, 2]}
+        message = MessageProtocolAdapter.create_command_message(
+            "lm", 1000, output_filter=output_filter
+        )
+
+        assert message["payload"]["parameters"] == output_filter
+        assert message["payload"]["parameters"] is not output_filter
+
+    def test_unfiltered_command_has_no_parameters(self):
+        """Test a command without a filter keeps sending empty parameters."""
+        message = MessageProtocolAdapter.create_command_message("lm", 1000)
+        assert message["payload"]["parameters"] == {}
+
+    def test_send_command_forwards_the_filter(self):
+        """Test send_command passes the filter through to the message."""
+        response = {"status": "success", "output": "00007ffb ntdll\n"}
+        manager = CommunicationManager()
+        with patch.object(
+            CommunicationManager, "_send_message", return_value=response
+        ) as send:
+            output = manager.send_command("lm", 1000, {"grep": "ntdll", "tail": 1})
+
+        message, _ = send.call_args[0]
+        assert message["payload"]["parameters"] == {"grep": "ntdll", "tail": 1}
+        assert output == "00007ffb ntdll\n"
+
+
+def build_v1_frame(message_type: int, payload: dict) -> bytes:
+    """Build a v1 frame the way the extension answers a v1 client."""
+    message = {
+        "protocol_version": PROTOCOL_VERSION_V1,
+        "message_type": message_type,
+        "payload": payload,
+    }
+    return json.dumps(message).encode("utf-8") + MESSAGE_DELIMITER
+
+
+def build_event(event: str, data: dict, sequence: int, **counts) -> bytes:
+    """Build a pushed event frame."""
+    payload = {"type": "event", "event": event, "data": data, "sequence": sequence}
+    payload.update(counts)
+    return build_v1_frame(MESSAGE_TYPE_EVENT, payload)
+
+
+class TestEventSubscription:
+    """Test debugger events pushed by the extension."""
+
+    def test_event_frame_is_parsed(self):
+        """Test an event frame keeps its data and delivery counts."""
+        frame = build_event("breakpoint", {"id": 3}, 12, coalesced=2, dropped=5)
+        event = MessageProtocolAdapter.parse_response(frame)
+
+        assert event["type"] == "event"
+        assert event["event"] == "breakpoint"
+        assert event["data"] == {"id": 3}
+        assert event["sequence"] == 12
+        assert event["coalesced"] == 2
+        assert event["dropped"] == 5
+
+    def test_unknown_event_is_rejected(self):
+        """Test a subscription to an event the extension has no name for fails early."""
+        with pytest.raises(ValueError):
+            EventSubscription(["breakpoint", "page_fault"])
+
+    def test_events_before_the_ack_are_kept(self):
+        """Test events arriving ahead of the subscription reply are delivered first."""
+        ack = build_v1_frame(
+            MESSAGE_TYPE_RESPONSE,
+            {
+                "type": "response",
+                "request_id": "1",
+                "success": True,
+                "data": {"events": ["breakpoint", "exception"]},
+            },
+        )
+        frames = [
+            build_event("breakpoint", {"id": 0}, 0),
+            ack,
+            build_event("exception", {"code": 0xC0000005}, 1, dropped=4),
+            CommunicationError("Pipe closed"),
+        ]
+
+        with patch.object(NamedPipeProtocol, "connect_to_pipe", return_value=object()), \
+             patch.object(NamedPipeProtocol, "write_to_pipe") as write, \
+             patch.object(NamedPipeProtocol, "read_from_pipe", side_effect=frames), \
+             patch.object(NamedPipeProtocol, "close_pipe"):
+            subscription = EventSubscription(["breakpoint", "exception"], "test")
+            assert subscription.open(1000) == ["breakpoint", "exception"]
+
+            first = subscription.next_event(1000)
+            second = subscription.wait_for(["exception"], 1000)
+            assert subscription.next_event(1000) is None
+            subscription.close()
+
+        request = json.loads(write.call_args_list[0][0][1].rstrip(MESSAGE_DELIMITER))
+        assert request["message_type"] == MESSAGE_TYPE_SUBSCRIBE
+        assert request["payload"]["events"] == ["breakpoint", "exception"]
+        assert first["event"] == "breakpoint"
+        assert second["data"] == {"code": 0xC0000005}
+        assert subscription.dropped == 4
+
+    def test_rejected_subscription_raises(self):
+        """Test an error reply to the subscription is raised and the pipe closed."""
+        error = build_v1_frame(
+            MESSAGE_TYPE_RESPONSE,
+            {"type": "response", "success": False, "error_message": "Unknown event: x"},
+        )
+
+        with patch.object(NamedPipeProtocol, "connect_to_pipe", return_value=object()), \
+             patch.object(NamedPipeProtocol, "write_to_pipe"), \
+             patch.object(NamedPipeProtocol, "read_from_pipe", return_value=error), \
+             patch.object(NamedPipeProtocol, "close_pipe") as close:
+            with pytest.raises(CommunicationError):
+                EventSubscription(["breakpoint"], "test").open(1000)
+        close.assert_called_once()
+
+    def test_responses_skip_event_frames(self):
+        """Test a pushed event between response frames is not taken for the reply."""
+        final = build_v2_response(
+            {"type": "response", "request_id": "7", "success": True},
+            b"done\n",
+        )
+        frames = [build_event("state_change", {}, 0), final]
+
+        manager = CommunicationManager()
+        with patch.object(NamedPipeProtocol, "read_from_pipe", side_effect=frames):
+            response = manager._read_response(None, 1000)
+
+        assert response["output"] == "done\n"
+
+
+class TestPipelining:
+    """Test several requests sharing one connection."""
+
+    def heartbeat(self, session_info: dict) -> bytes:
+        return build_v1_frame(
+            MESSAGE_TYPE_HEARTBEAT, {"type": "heartbeat", "session_info": session_info}
+        )
+
+    def test_negotiation_reads_max_in_flight(self):
+        """Test the extension's request limit is taken from its heartbeat."""
+        reply = self.heartbeat({"protocol_versions": [1, 2], "max_in_flight": 4})
+        with patch.object(NamedPipeProtocol, "write_to_pipe"), patch.object(
+            NamedPipeProtocol, "read_from_pipe", return_value=reply
+        ):
+            _, _, max_in_flight = ConnectionPool()._negotiate_protocol(None, 1000)
+        assert max_in_flight == 4
+
+    def test_legacy_extension_gets_one_request_at_a_time(self):
+        """Test an extension that does not advertise a limit keeps exclusive connections."""
+        reply = self.heartbeat({"protocol_versions": [1, 2]})
+        with patch.object(NamedPipeProtocol, "write_to_pipe"), patch.object(
+            NamedPipeProtocol, "read_from_pipe", return_value=reply
+        ):
+            _, _, max_in_flight = ConnectionPool()._negotiate_protocol(None, 1000)
+        assert max_in_flight == 1
+
+    def test_concurrent_requests_share_a_pipelined_connection(self):
+        """Test a second request goes on the warm pipe instead of a new one."""
+        pool = ConnectionPool()
+        with patch.object(
+            NamedPipeProtocol, "connect_to_pipe", return_value=object()
+        ) as connect, patch.object(
+            ConnectionPool, "_negotiate_protocol", return_value=(2, ENCODING_JSON, 4)
+        ), patch.object(NamedPipeProtocol, "close_pipe"):
+            first = pool._acquire_connection(1000)
+            second = pool._acquire_connection(1000)
+            assert isinstance(first, PipelinedConnection)
+            assert second is first
+            assert connect.call_count == 1
+            pool.close_all_connections()
+
+    def test_responses_are_matched_by_request_id(self):
+        """Test a response that overtakes an earlier request reaches its own request."""
+        slow = build_v2_response(
+            {"type": "response", "request_id": "slow", "success": True}, b"slow\n"
+        )
+        fast = build_v2_response(
+            {"type": "response", "request_id": "fast", "success": True}, b"fast\n"
+        )
+        blob = fast + build_event("state_change", {}, 0) + slow
+        pipeline = PipelinedConnection(object(), 4)
+        delivered = threading.Event()
+
+        # Nothing is readable until both requests are waiting
+        def peek(handle, size):
+            with pipeline._lock:
+                ready = len(pipeline._waiters) == 2
+            if ready and not delivered.is_set():
+                delivered.set()
+                return b"", len(blob), 0
+            return b"", 0, 0
+
+        with patch(
+            "src.core.communication.win32pipe.PeekNamedPipe", create=True, side_effect=peek
+        ), patch(
+            "src.core.communication.win32file.ReadFile", create=True, return_value=(0, blob)
+        ), patch.object(NamedPipeProtocol, "write_to_pipe"):
+            with ThreadPoolExecutor(max_workers=2) as executor:
+                slow_reply = executor.submit(pipeline.request, b"", "slow", 5000)
+                fast_reply = executor.submit(pipeline.request, b"", "fast", 5000)
+                assert slow_reply.result()["output"] == "slow\n"
+                assert fast_reply.result()["output"] == "fast\n"
+            pipeline.close()
+
+    def test_broken_pipe_fails_waiting_requests(self):
+        """Test a request waiting on a closed connection fails instead of timing out."""
+        pipeline = PipelinedConnection(object(), 4)
+        pipeline.close()
+        with pytest.raises(CommunicationError):
+            pipeline.request(b"", "1", 1000)
+        assert pipeline.broken
+
+    def test_request_ids_are_unique(self):
+        """Test messages built in the same millisecond do not share a request id."""
+        ids = {
+            MessageProtocolAdapter.create_command_message("r", 1000)["payload"][
+                "request_id"
+            ]
+            for _ in range(100)
+        }
+        assert len(ids) == 100
+
+
+class TestBackpressure:
+    """Test requests the extension refuses while it is at a limit."""
+
+    def busy_frame(self, request_id: str, retry_after_ms: int) -> bytes:
+        return build_v1_frame(
+            MESSAGE_TYPE_ERROR,
+            {
+                "type": "error",
+                "request_id": request_id,
+                "error_code": ERROR_CODE_BUSY,
+                "error_message": "Server busy: server_queue at its limit of 64",
+                "details": {"reason": "server_queue", "retry_after_ms": retry_after_ms},
+            },
+        )
+
+    def test_busy_error_carries_the_retry_hint(self):
+        """Test a Busy error frame keeps its code and retry hint."""
+        response = MessageProtocolAdapter.parse_response(self.busy_frame("9", 250))
+        assert response["status"] == "error"
+        assert response["error_code"] == ERROR_CODE_BUSY
+        assert response["retry_after_ms"] == 250
+        assert response["request_id"] == "9"
+
+    def test_busy_request_is_retried_after_the_hint(self):
+        """Test a refused request is sent again once the hinted time has passed."""
+        manager = CommunicationManager()
+        busy = MessageProtocolAdapter.parse_response(self.busy_frame("1", 200))
+        ok = {"status": "success", "output": "done"}
+        message = MessageProtocolAdapter.create_command_message("k", 1000)
+        with patch.object(manager, "_connection_pool") as pool, patch.object(
+            NamedPipeProtocol, "write_to_pipe"
+        ) as write, patch.object(
+            CommunicationManager, "_read_response", side_effect=[busy, ok]
+        ), patch(
+            "src.core.communication.time.sleep"
+        ) as sleep:
+            pool.get_wire_format.return_value = (PROTOCOL_VERSION_V1, ENCODING_JSON)
+            assert manager._send_message(message, 1000) == ok
+        assert write.call_count == 2
+        sleep.assert_called_once_with(0.2)
+
+    def test_refused_connection_raises_busy(self):
+        """Test a connection past the extension's limit is not used as a v1 pipe."""
+        with patch.object(NamedPipeProtocol, "write_to_pipe"), patch.object(
+            NamedPipeProtocol, "read_from_pipe", return_value=self.busy_frame("", 500)
+        ):
+            with pytest.raises(ServerBusyError) as refused:
+                ConnectionPool()._negotiate_protocol(None, 1000)
+        assert refused.value.retry_after_ms == 500
@@ -3,7 +3,7 @@
 import pytest
 import asyncio
 from unittest.mock import Mock, AsyncMock, patch
-from src.tools.core_tools import create_dx_visualization
+from src.tools.core_tools import create_dx_query, create_dx_visualization
 from src.core.command_executor import CommandExecutor, CommandResult
 
 
@@ -243,3 +243,58 @@ class TestDxVisualization:
             "dx -c 5 Debugger.Sessions",
             timeout_ms=30000
         )
+
+
+class TestDxQuery:
+    """Test the native dx_query tool."""
+
+    @pytest.fixture
+    def mock_command_executor(self):
+        """Create a mock command executor with a communication manager."""
+        executor = Mock(spec=CommandExecutor)
+        executor.comm_manager = Mock()
+        return executor
+
+    @pytest.mark.asyncio
+    async def test_query_returns_json_tree(self, mock_command_executor):
+        """Test the tree is returned as JSON without running dx as text."""
+        mock_command_executor.comm_manager.query_data_model.return_value = {
+            "expression": "@$curprocess.Threads",
+            "truncated": False,
+            "result": {"kind": "synthetic", "elements": [], "has_more": False},
+        }
+        tool = create_dx_query(mock_command_executor)
+
+        result = await tool({"expression": "@$curprocess.Threads", "offset": 100, "limit": 50})
+
+        mock_command_executor.comm_manager.query_data_model.assert_called_once_with(
+            "@$curprocess.Threads",
+            offset=100,
+            limit=50,
+            depth=None,
+            raw=False,
+            timeout_ms=30000,
+        )
+        assert result.startswith("dx Query (@$curprocess.Threads):")
+        assert '"has_more": false' in result
+
+    @pytest.mark.asyncio
+    async def test_truncated_query_says_so(self, mock_command_executor):
+        """Test a query cut off by the node budget is flagged."""
+        mock_command_executor.comm_manager.query_data_model.return_value = {
+            "truncated": True,
+            "result": {"kind": "synthetic"},
+        }
+        tool = create_dx_query(mock_command_executor)
+
+        result = await tool({"expression": "Debugger.Sessions", "depth": 8})
+        assert "[truncated" in result
+
+    @pytest.mark.asyncio
+    async def test_missing_expression(self, mock_command_executor):
+        """Test an empty expression is rejected before any request."""
+        tool = create_dx_query(mock_command_executor)
+
+        result = await tool({})
+        assert result == "Error: No expression specified"
+        mock_command_executor.comm_manager.query_data_model.assert_not_called()